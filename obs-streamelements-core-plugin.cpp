@@ -11,12 +11,16 @@
 #include <sstream>
 #include <thread>
 #include <mutex>
+#include <cstring>
 
 #include "json11/json11.hpp"
 #include "obs-websocket-api/obs-websocket-api.h"
 #include "cef-headers.hpp"
 
 #include "streamelements/audio-wrapper-source.h"
+#include "streamelements/StreamElementsSyntheticBandwidthEncoders.hpp"
+#include "streamelements/StreamElementsLogRing.hpp"
+#include "streamelements/StreamElementsAsyncLog.hpp"
 #include "streamelements/Version.generated.hpp"
 
 #define ENABLE_PLUGIN 1
@@ -97,6 +101,52 @@ static void log_remaining_objects()
 
 /* ========================================================================= */
 
+static log_handler_t s_prevLogHandler = nullptr;
+static void *s_prevLogHandlerParam = nullptr;
+
+static StreamElementsLogRing::Category get_log_ring_category(int level)
+{
+	return level <= LOG_ERROR     ? StreamElementsLogRing::Category::Error
+	       : level <= LOG_WARNING ? StreamElementsLogRing::Category::Warning
+				      : StreamElementsLogRing::Category::Info;
+}
+
+// Copies our own log lines into StreamElementsLogRing on their way to the
+// log file, so crash and issue reports carry the most recent ones even when
+// they have not been flushed to disk yet.
+static void log_ring_handler(int level, const char *format, va_list args,
+			     void *)
+{
+	if (level != LOG_DEBUG &&
+	    (0 == strncmp(format, "obs-streamelements", 18) ||
+	     0 == strncmp(format, "[obs-streamelements", 19))) {
+		va_list copy;
+		va_copy(copy, args);
+
+		StreamElementsLogRing::GetInstance()->AppendFormatV(
+			get_log_ring_category(level), format, copy);
+
+		va_end(copy);
+	}
+
+	if (s_prevLogHandler)
+		s_prevLogHandler(level, format, args, s_prevLogHandlerParam);
+}
+
+// Where SE_LOG() messages end up, on the StreamElementsAsyncLog writer
+// thread. They arrive already formatted as "%s", which log_ring_handler does
+// not recognise, so they are put in the ring here.
+static void async_log_sink(int level, const char *message)
+{
+	if (level != LOG_DEBUG)
+		StreamElementsLogRing::GetInstance()->Append(
+			get_log_ring_category(level), message);
+
+	blog(level, "%s", message);
+}
+
+/* ========================================================================= */
+
 MODULE_EXPORT bool obs_module_load(void)
 {
 #if ENABLE_PLUGIN
@@ -105,7 +155,13 @@ MODULE_EXPORT bool obs_module_load(void)
 	blog(LOG_INFO, "[obs-streamelements-core]: Version %s",
 	     version.c_str());
 
+	base_get_log_handler(&s_prevLogHandler, &s_prevLogHandlerParam);
+	base_set_log_handler(log_ring_handler, nullptr);
+
+	StreamElementsAsyncLog::GetInstance()->SetSink(async_log_sink);
+
 	obs_register_source(&audio_wrapper_source);
+	RegisterSyntheticBandwidthEncoders();
 #endif
 	return true;
 }
@@ -189,5 +245,11 @@ MODULE_EXPORT void obs_module_unload(void)
 	blog(LOG_INFO, "[obs-streamelements-core]: shutdown complete");
 
 	SETRACE_DUMP();
+
+	// The writer thread runs plugin code and must be gone before the
+	// module is; anything logged after this is written synchronously.
+	StreamElementsAsyncLog::GetInstance()->Shutdown();
+
+	base_set_log_handler(s_prevLogHandler, s_prevLogHandlerParam);
 #endif
 }
@@ -11,7 +11,7 @@
 
 #if ENABLE_SETRACE == 1
 
-long g_seTrace_refcountBalance = 0;
+StreamElementsShardedCounter g_seTrace_refcountBalance;
 
 void __SETrace_Dump(const char *file, int line)
 {
@@ -19,7 +19,79 @@ void __SETrace_Dump(const char *file, int line)
 
 	blog(LOG_INFO,
 	     "[obs-streamelements-core]: reference count balance = %ld (0 is good) at %s:%d",
-	     g_seTrace_refcountBalance, p.filename().u8string().c_str(), line);
+	     g_seTrace_refcountBalance.Get(), p.filename().u8string().c_str(),
+	     line);
+}
+
+#elif ENABLE_SETRACE == 2 && !defined(_WIN32)
+
+#include "StreamElementsRefTracker.hpp"
+
+#include <sstream>
+
+static StreamElementsRefTracker *GetRefTracker()
+{
+	// Never destroyed: references are still released while statics are
+	// torn down.
+	static StreamElementsRefTracker *s_tracker = []() {
+		StreamElementsRefTracker::Options options;
+
+		// __SETrace_Trace_*Ref() and the inline template that calls
+		// it.
+		options.skipFrames = 2;
+
+		return new StreamElementsRefTracker(options);
+	}();
+
+	return s_tracker;
+}
+
+void *__SETrace_Trace_AddRef(const char *file, const int line,
+			     const char *statement, void *ptr)
+{
+	GetRefTracker()->AddRef(file, line, statement, ptr);
+
+	return ptr;
+}
+
+void *__SETrace_Trace_DecRef(const char *file, const int line,
+			     const char *statement, void *ptr)
+{
+	if (!GetRefTracker()->DecRef(file, line, statement, ptr)) {
+		std::filesystem::path p = file;
+
+		blog(LOG_ERROR,
+		     "[obs-streamelements-core]: release reference of data which was not previously allocated at '%s' line '%d': %s",
+		     p.filename().u8string().c_str(), line, statement);
+	}
+
+	return ptr;
+}
+
+void __SETrace_Dump(const char *file, int line)
+{
+	std::filesystem::path p = file;
+
+	blog(LOG_INFO,
+	     "[obs-streamelements-core]: --------------------------------------------------------------");
+
+	blog(LOG_INFO,
+	     "[obs-streamelements-core]: start of reference count leak report at %s:%d",
+	     p.filename().u8string().c_str(), line);
+
+	std::istringstream report(GetRefTracker()->FormatLeakReport());
+
+	for (std::string reportLine; std::getline(report, reportLine);) {
+		blog(LOG_INFO, "[obs-streamelements-core]: %s",
+		     reportLine.c_str());
+	}
+
+	blog(LOG_INFO,
+	     "[obs-streamelements-core]: end of reference count leak report at %s:%d",
+	     p.filename().u8string().c_str(), line);
+
+	blog(LOG_INFO,
+	     "[obs-streamelements-core]: --------------------------------------------------------------");
 }
 
 #elif ENABLE_SETRACE == 2
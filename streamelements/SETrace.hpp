@@ -2,7 +2,14 @@
 
 #include <util/threading.h>
 
-#define ENABLE_SETRACE 1 // 0 - disabled, 1 - keep only refcount balance, 2 - detailed trace
+// 0 - disabled, 1 - keep only refcount balance, 2 - detailed trace
+//
+// Set with the STREAMELEMENTS_SETRACE CMake variable. The detailed trace
+// records the stack of every reference taken: StackWalker on Windows,
+// backtrace() elsewhere.
+#ifndef ENABLE_SETRACE
+#define ENABLE_SETRACE 1
+#endif
 
 #if ENABLE_SETRACE == 2
 	void *__SETrace_Trace_AddRef(const char *file, const int line,
@@ -48,13 +55,17 @@
 
 	#define SETRACE_DUMP() __SETrace_Dump(__FILE__, __LINE__)
 #elif ENABLE_SETRACE == 1
-	extern long g_seTrace_refcountBalance;
+	#include "StreamElementsShardedCounter.hpp"
+
+	// Sharded: a single global counter had every thread that touches a
+	// source or scene fighting over one cache line.
+	extern StreamElementsShardedCounter g_seTrace_refcountBalance;
 
 	template<typename T> inline
 	T *__SETrace_Trace_AddRef_Template(T *ptr)
 	{
 		if (ptr) {
-			os_atomic_inc_long(&g_seTrace_refcountBalance);
+			g_seTrace_refcountBalance.Add(1);
 		}
 
 		return static_cast<T *>(ptr);
@@ -64,7 +75,7 @@
 	T *__SETrace_Trace_DecRef_Template(T *ptr)
 	{
 		if (ptr) {
-			os_atomic_dec_long(&g_seTrace_refcountBalance);
+			g_seTrace_refcountBalance.Add(-1);
 		}
 
 		return static_cast<T *>(ptr);
@@ -6,7 +6,33 @@
 #include <util/platform.h>
 #include <string>
 
-StreamElementsAnalyticsEventsManager::StreamElementsAnalyticsEventsManager(size_t numWorkers)
+static const char *const ANALYTICS_URL =
+	"https://api.streamelements.com/science/insert/obslive";
+
+static const char *const ANALYTICS_SPOOL_FILE_NAME = "analytics_spool.jsonl";
+
+static int PostAnalyticsBatch(const std::string &body,
+			      const StreamElementsAnalyticsUploader::headers_t &headers)
+{
+	http_client_headers_t requestHeaders(headers.begin(), headers.end());
+
+	int status = 0;
+
+	auto callback = [&](void *, size_t, void *, char *, int http_code)
+		-> bool {
+		if (http_code)
+			status = http_code;
+
+		return true;
+	};
+
+	HttpPost(ANALYTICS_URL, requestHeaders, (void *)body.data(),
+		 body.size(), callback, nullptr);
+
+	return status;
+}
+
+StreamElementsAnalyticsEventsManager::StreamElementsAnalyticsEventsManager()
 {
 	uint64_t now = os_gettime_ns();
 	m_startTime = now;
@@ -15,37 +41,40 @@ StreamElementsAnalyticsEventsManager::StreamElementsAnalyticsEventsManager(size_
 	m_sessionId = CreateGloballyUniqueIdString();
 	m_identity = GetComputerSystemUniqueId();
 
-	m_taskConsumersKeepRunning = true;
+	char *configDir = obs_module_config_path("");
+	configDir[strlen(configDir) - 1] = 0; // remove last char
+	os_mkdirs(configDir);
+	bfree(configDir);
 
-	for (size_t i = 0; i < numWorkers; ++i) {
-		m_taskConsumers.push_back(std::thread([this]() {
-			task_queue_item_t task;
+	char *spoolPath = obs_module_config_path(ANALYTICS_SPOOL_FILE_NAME);
 
-			while (m_taskConsumersKeepRunning || m_taskQueue.size_approx()) {
-				if (m_taskQueue.wait_dequeue_timed(task, std::chrono::milliseconds(100))) {
-					task();
-				}
-			}
-		}));
-	}
+	StreamElementsAnalyticsUploader::Options options;
+
+	options.log = [](const std::string &message) {
+		blog(LOG_WARNING, "obs-streamelements-core: analytics: %s",
+		     message.c_str());
+	};
+
+	m_uploader = std::make_unique<StreamElementsAnalyticsUploader>(
+		spoolPath, PostAnalyticsBatch, options);
+
+	bfree(spoolPath);
 }
 
 StreamElementsAnalyticsEventsManager::~StreamElementsAnalyticsEventsManager()
 {
-	m_taskConsumersKeepRunning = false;
+	// Give what is queued one chance to leave; the rest stays spooled for
+	// the next session.
+	m_uploader->Flush(std::chrono::seconds(2));
 
-	for (size_t i = 0; i < m_taskConsumers.size(); ++i) {
-		if (m_taskConsumers[i].joinable()) {
-			m_taskConsumers[i].join();
-		}
-	}
+	auto stats = m_uploader->GetStats();
 
-	m_taskConsumers.clear();
-}
+	blog(LOG_INFO,
+	     "obs-streamelements-core: analytics: %zu events queued, %zu sent, %zu rejected, %zu dropped in %zu requests (%zu failed)",
+	     stats.eventsQueued, stats.eventsSent, stats.eventsRejected,
+	     stats.eventsDropped, stats.requestsSent, stats.requestsFailed);
 
-void StreamElementsAnalyticsEventsManager::Enqueue(task_queue_item_t task)
-{
-	m_taskQueue.enqueue(task);
+	m_uploader = nullptr;
 }
 
 #ifndef _WIN32
@@ -115,38 +144,9 @@ void StreamElementsAnalyticsEventsManager::AddRawEvent(
 
 	json11::Json json = props;
 
-	std::string httpRequestBody = "[" + json.dump() + "]";
-
 	if (!synchronous) {
-		Enqueue([=]() {
-			http_client_headers_t headers;
-
-			headers.emplace(
-				std::make_pair<std::string, std::string>(
-					"Content-Type", "application/json"));
-
-			HttpPost(
-				"https://api.streamelements.com/science/insert/obslive",
-				headers,
-				(void*)httpRequestBody.c_str(),
-				httpRequestBody.size(),
-				nullptr,
-				nullptr);
-		});
-	}
-	else {
-		http_client_headers_t headers;
-
-		headers.emplace(
-			std::make_pair<std::string, std::string>(
-				"Content-Type", "application/json"));
-
-		HttpPost(
-			"https://api.streamelements.com/science/insert/obslive",
-			headers,
-			(void*)httpRequestBody.c_str(),
-			httpRequestBody.size(),
-			nullptr,
-			nullptr);
+		m_uploader->Add(json.dump());
+	} else {
+		m_uploader->SendNow(json.dump());
 	}
 }
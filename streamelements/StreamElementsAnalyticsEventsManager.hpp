@@ -1,12 +1,10 @@
 #pragma once
 
 #include "StreamElementsUtils.hpp"
-#include "deps/moodycamel/concurrentqueue.h"
-#include "deps/moodycamel/blockingconcurrentqueue.h"
+#include "StreamElementsAnalyticsUploader.hpp"
 #include "json11/json11.hpp"
 
-#include <vector>
-#include <thread>
+#include <memory>
 #include <string>
 
 #include <QDockWidget>
@@ -14,7 +12,7 @@
 class StreamElementsAnalyticsEventsManager
 {
 public:
-	StreamElementsAnalyticsEventsManager(size_t numWorkers = 4);
+	StreamElementsAnalyticsEventsManager();
 	~StreamElementsAnalyticsEventsManager();
 
 	void trackSynchronousEvent(
@@ -44,9 +42,6 @@ public:
 	std::string sessionId() { return m_sessionId; }
 
 protected:
-	typedef std::function<void()> task_queue_item_t;
-
-	void Enqueue(task_queue_item_t task);
 	void AddRawEvent(
 		const char *eventName,
 		json11::Json::object propertiesJson = json11::Json::object{},
@@ -59,7 +54,5 @@ private:
 	std::string m_sessionId;
 	std::string m_identity;
 
-	moodycamel::BlockingConcurrentQueue<task_queue_item_t> m_taskQueue;
-	bool m_taskConsumersKeepRunning;
-	std::vector<std::thread> m_taskConsumers;
+	std::unique_ptr<StreamElementsAnalyticsUploader> m_uploader;
 };
@@ -0,0 +1,274 @@
+#include "StreamElementsAnalyticsSpool.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#ifdef _WIN32
+#define spool_fseek _fseeki64
+#define spool_ftell _ftelli64
+#else
+#define spool_fseek fseeko
+#define spool_ftell ftello
+#endif
+
+static FILE *OpenFile(const std::string &path, const char *mode)
+{
+#ifdef _WIN32
+	std::wstring wpath = std::filesystem::u8path(path).wstring();
+	std::wstring wmode(mode, mode + strlen(mode));
+
+	return _wfopen(wpath.c_str(), wmode.c_str());
+#else
+	return fopen(path.c_str(), mode);
+#endif
+}
+
+/* ================================================================= */
+
+StreamElementsAnalyticsSpool::StreamElementsAnalyticsSpool(std::string path)
+	: m_path(path), m_offsetPath(path + ".offset")
+{
+}
+
+StreamElementsAnalyticsSpool::~StreamElementsAnalyticsSpool()
+{
+	std::lock_guard<decltype(m_mutex)> guard(m_mutex);
+
+	if (m_file)
+		fclose(m_file);
+
+	m_file = nullptr;
+}
+
+bool StreamElementsAnalyticsSpool::Open()
+{
+	std::lock_guard<decltype(m_mutex)> guard(m_mutex);
+
+	if (m_file)
+		return true;
+
+	m_file = OpenFile(m_path, "r+b");
+
+	if (!m_file)
+		m_file = OpenFile(m_path, "w+b");
+
+	if (!m_file)
+		return false;
+
+	{
+		std::ifstream in(std::filesystem::u8path(m_offsetPath));
+
+		if (!(in >> m_readOffset))
+			m_readOffset = 0;
+	}
+
+	// Count the records past the read offset, and cut off a record torn
+	// by a crash mid-append.
+	uint64_t offset = 0;
+	uint64_t lastRecordEnd = 0;
+
+	m_pendingCount = 0;
+
+	char buffer[64 * 1024];
+
+	spool_fseek(m_file, 0, SEEK_SET);
+
+	for (;;) {
+		const size_t read = fread(buffer, 1, sizeof(buffer), m_file);
+
+		if (!read)
+			break;
+
+		for (size_t i = 0; i < read; ++i) {
+			if (buffer[i] != '\n')
+				continue;
+
+			lastRecordEnd = offset + i + 1;
+
+			if (lastRecordEnd > m_readOffset)
+				++m_pendingCount;
+		}
+
+		offset += read;
+	}
+
+	if (offset != lastRecordEnd) {
+		fclose(m_file);
+
+		std::error_code ec;
+		std::filesystem::resize_file(std::filesystem::u8path(m_path),
+					     lastRecordEnd, ec);
+
+		m_file = OpenFile(m_path, "r+b");
+
+		if (!m_file)
+			return false;
+	}
+
+	m_writeOffset = lastRecordEnd;
+
+	if (m_readOffset > m_writeOffset) {
+		m_readOffset = m_writeOffset;
+
+		SaveReadOffset();
+	}
+
+	if (!m_pendingCount && m_writeOffset)
+		Truncate();
+
+	return true;
+}
+
+bool StreamElementsAnalyticsSpool::Append(const std::string &record)
+{
+	std::lock_guard<decltype(m_mutex)> guard(m_mutex);
+
+	if (!m_file)
+		return false;
+
+	if (m_writeOffset + record.size() + 1 > MAX_SPOOL_BYTES)
+		return false;
+
+	spool_fseek(m_file, (int64_t)m_writeOffset, SEEK_SET);
+
+	if (fwrite(record.data(), 1, record.size(), m_file) != record.size() ||
+	    fputc('\n', m_file) == EOF || fflush(m_file) != 0) {
+		// Whatever made it to disk is cut off on the next Open().
+		return false;
+	}
+
+	m_appendTimes.emplace_back(m_writeOffset,
+				   std::chrono::steady_clock::now());
+
+	m_writeOffset += record.size() + 1;
+	++m_pendingCount;
+
+	return true;
+}
+
+void StreamElementsAnalyticsSpool::Peek(size_t maxRecords, size_t maxBytes,
+					std::vector<std::string> &records,
+					uint64_t &endOffset)
+{
+	std::lock_guard<decltype(m_mutex)> guard(m_mutex);
+
+	records.clear();
+	endOffset = m_readOffset;
+
+	if (!m_file)
+		return;
+
+	spool_fseek(m_file, (int64_t)m_readOffset, SEEK_SET);
+
+	size_t bytes = 0;
+	std::string record;
+
+	while (endOffset < m_writeOffset && records.size() < maxRecords) {
+		record.clear();
+
+		int ch;
+
+		while ((ch = fgetc(m_file)) != EOF && ch != '\n')
+			record += (char)ch;
+
+		if (ch == EOF)
+			break;
+
+		if (!records.empty() && bytes + record.size() > maxBytes)
+			break;
+
+		bytes += record.size();
+		endOffset += record.size() + 1;
+
+		records.push_back(record);
+	}
+}
+
+void StreamElementsAnalyticsSpool::Commit(uint64_t endOffset)
+{
+	std::lock_guard<decltype(m_mutex)> guard(m_mutex);
+
+	if (endOffset <= m_readOffset || endOffset > m_writeOffset)
+		return;
+
+	// Count the records consumed.
+	spool_fseek(m_file, (int64_t)m_readOffset, SEEK_SET);
+
+	for (uint64_t offset = m_readOffset; offset < endOffset; ++offset) {
+		if (fgetc(m_file) == '\n')
+			--m_pendingCount;
+	}
+
+	m_readOffset = endOffset;
+
+	while (!m_appendTimes.empty() &&
+	       m_appendTimes.front().first < m_readOffset)
+		m_appendTimes.pop_front();
+
+	if (m_readOffset == m_writeOffset)
+		Truncate();
+	else
+		SaveReadOffset();
+}
+
+size_t StreamElementsAnalyticsSpool::GetPendingCount()
+{
+	std::lock_guard<decltype(m_mutex)> guard(m_mutex);
+
+	return m_pendingCount;
+}
+
+uint64_t StreamElementsAnalyticsSpool::GetPendingBytes()
+{
+	std::lock_guard<decltype(m_mutex)> guard(m_mutex);
+
+	return m_writeOffset - m_readOffset;
+}
+
+std::chrono::steady_clock::time_point
+StreamElementsAnalyticsSpool::GetOldestPendingTime()
+{
+	std::lock_guard<decltype(m_mutex)> guard(m_mutex);
+
+	// Appended before Open(), or nothing pending at all.
+	if (m_appendTimes.empty() ||
+	    m_appendTimes.front().first != m_readOffset)
+		return std::chrono::steady_clock::time_point();
+
+	return m_appendTimes.front().second;
+}
+
+void StreamElementsAnalyticsSpool::SaveReadOffset()
+{
+	const std::string tempPath = m_offsetPath + ".tmp";
+
+	{
+		std::ofstream out(std::filesystem::u8path(tempPath),
+				  std::ios::trunc);
+
+		out << m_readOffset;
+
+		if (!out)
+			return;
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(std::filesystem::u8path(tempPath),
+				std::filesystem::u8path(m_offsetPath), ec);
+}
+
+void StreamElementsAnalyticsSpool::Truncate()
+{
+	fclose(m_file);
+
+	m_file = OpenFile(m_path, "w+b");
+
+	m_readOffset = 0;
+	m_writeOffset = 0;
+	m_pendingCount = 0;
+
+	m_appendTimes.clear();
+
+	SaveReadOffset();
+}
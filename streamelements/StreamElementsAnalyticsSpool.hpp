@@ -0,0 +1,73 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+//
+// On-disk, append-only queue of analytics events.
+//
+// Events are appended as single-line JSON records to the spool file and
+// consumed from a read offset persisted next to it, so events which could not
+// be delivered yet survive a restart or an offline period. Once everything
+// appended has been consumed the file is truncated, which keeps it from
+// growing while the network is fine.
+//
+// A record torn by a crash mid-append is cut off when the spool is opened.
+// Past MAX_SPOOL_BYTES new events are dropped rather than appended: an
+// analytics backlog is not worth unbounded disk space.
+//
+class StreamElementsAnalyticsSpool {
+public:
+	static const uint64_t MAX_SPOOL_BYTES = 8 * 1024 * 1024;
+
+public:
+	StreamElementsAnalyticsSpool(std::string path);
+	~StreamElementsAnalyticsSpool();
+
+	// Opens or creates the spool. Returns false if it cannot be written.
+	bool Open();
+
+	// Appends one record. `record` must not contain a newline. Returns
+	// false if the record was dropped.
+	bool Append(const std::string &record);
+
+	// Reads up to `maxRecords` records, and no more than `maxBytes` of
+	// them unless a single record is larger, starting at the read offset.
+	// `endOffset` is what to pass to Commit() once they were delivered.
+	void Peek(size_t maxRecords, size_t maxBytes,
+		  std::vector<std::string> &records, uint64_t &endOffset);
+
+	// Marks everything before `endOffset` as consumed.
+	void Commit(uint64_t endOffset);
+
+	size_t GetPendingCount();
+	uint64_t GetPendingBytes();
+
+	// When the oldest pending record was appended. Records left over from
+	// an earlier session report the epoch: they are long overdue.
+	std::chrono::steady_clock::time_point GetOldestPendingTime();
+
+private:
+	void SaveReadOffset();
+	void Truncate();
+
+private:
+	std::string m_path;
+	std::string m_offsetPath;
+
+	std::recursive_mutex m_mutex;
+	FILE *m_file = nullptr;
+
+	uint64_t m_readOffset = 0;
+	uint64_t m_writeOffset = 0;
+	size_t m_pendingCount = 0;
+
+	// Offset and append time of each record appended since Open().
+	std::deque<std::pair<uint64_t, std::chrono::steady_clock::time_point>>
+		m_appendTimes;
+};
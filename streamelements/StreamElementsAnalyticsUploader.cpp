@@ -0,0 +1,304 @@
+#include "StreamElementsAnalyticsUploader.hpp"
+
+#define MINIZ_HEADER_FILE_ONLY
+#define MINIZ_NO_ZLIB_COMPATIBLE_NAMES
+#include "deps/zip/miniz.h"
+
+#include <algorithm>
+
+/* ================================================================= */
+
+StreamElementsAnalyticsUploader::StreamElementsAnalyticsUploader(
+	std::string spoolPath, transport_t transport, Options options)
+	: m_spool(spoolPath),
+	  m_transport(transport),
+	  m_options(options),
+	  m_compress(options.compress)
+{
+	std::lock_guard<decltype(m_mutex)> guard(m_mutex);
+
+	m_spoolOpen = m_spool.Open();
+
+	// Left over from an earlier session: long overdue.
+	if (m_spoolOpen && m_spool.GetPendingCount())
+		StartSender();
+}
+
+StreamElementsAnalyticsUploader::~StreamElementsAnalyticsUploader()
+{
+	{
+		std::lock_guard<decltype(m_mutex)> guard(m_mutex);
+
+		m_stop = true;
+
+		m_cv.notify_all();
+	}
+
+	// Whatever is still spooled goes out with the next session.
+	if (m_sender.joinable())
+		m_sender.join();
+}
+
+void StreamElementsAnalyticsUploader::Add(const std::string &eventJson)
+{
+	std::lock_guard<decltype(m_mutex)> guard(m_mutex);
+
+	if (!m_spoolOpen || !m_spool.Append(eventJson)) {
+		++m_stats.eventsDropped;
+
+		return;
+	}
+
+	++m_stats.eventsQueued;
+
+	StartSender();
+
+	m_cv.notify_all();
+}
+
+void StreamElementsAnalyticsUploader::SendNow(const std::string &eventJson)
+{
+	bool compress;
+
+	{
+		std::lock_guard<decltype(m_mutex)> guard(m_mutex);
+
+		compress = m_compress;
+	}
+
+	const int status = Post({eventJson}, compress);
+
+	std::lock_guard<decltype(m_mutex)> guard(m_mutex);
+
+	++m_stats.requestsSent;
+
+	if (status >= 200 && status < 300) {
+		++m_stats.eventsSent;
+
+		return;
+	}
+
+	++m_stats.requestsFailed;
+
+	// Not started from here: the caller may be a dying process.
+	if (m_spoolOpen && m_spool.Append(eventJson))
+		++m_stats.eventsQueued;
+	else
+		++m_stats.eventsDropped;
+}
+
+bool StreamElementsAnalyticsUploader::Flush(std::chrono::milliseconds timeout)
+{
+	std::unique_lock<decltype(m_mutex)> lock(m_mutex);
+
+	if (!m_spool.GetPendingCount())
+		return true;
+
+	StartSender();
+
+	m_flush = true;
+	m_cv.notify_all();
+
+	return m_drained.wait_for(lock, timeout, [this]() {
+		return !m_spool.GetPendingCount();
+	});
+}
+
+StreamElementsAnalyticsUploader::Stats
+StreamElementsAnalyticsUploader::GetStats()
+{
+	std::lock_guard<decltype(m_mutex)> guard(m_mutex);
+
+	return m_stats;
+}
+
+/* ================================================================= */
+
+void StreamElementsAnalyticsUploader::StartSender()
+{
+	if (m_running || m_stop)
+		return;
+
+	m_running = true;
+
+	m_sender = std::thread([this]() { SenderThreadProc(); });
+}
+
+void StreamElementsAnalyticsUploader::SenderThreadProc()
+{
+	std::unique_lock<decltype(m_mutex)> lock(m_mutex);
+
+	std::chrono::milliseconds backoff(0);
+
+	// The batch at the head of the spool was rejected compressed.
+	bool plainRetry = false;
+
+	while (!m_stop) {
+		const size_t pending = m_spool.GetPendingCount();
+
+		if (!pending) {
+			m_flush = false;
+			m_drained.notify_all();
+
+			m_cv.wait(lock, [this]() {
+				return m_stop || m_spool.GetPendingCount();
+			});
+
+			continue;
+		}
+
+		const auto now = std::chrono::steady_clock::now();
+		const auto due =
+			m_spool.GetOldestPendingTime() + m_options.maxBatchAge;
+
+		const bool full =
+			pending >= m_options.maxBatchEvents ||
+			m_spool.GetPendingBytes() >= m_options.maxBatchBytes;
+
+		if (!full && !m_flush && now < due) {
+			m_cv.wait_until(lock, due);
+
+			continue;
+		}
+
+		std::vector<std::string> events;
+		uint64_t endOffset = 0;
+
+		m_spool.Peek(m_options.maxBatchEvents, m_options.maxBatchBytes,
+			     events, endOffset);
+
+		const bool compress = m_compress && !plainRetry;
+
+		lock.unlock();
+
+		const int status = Post(events, compress);
+
+		lock.lock();
+
+		++m_stats.requestsSent;
+
+		if (status >= 200 && status < 300) {
+			m_spool.Commit(endOffset);
+
+			m_stats.eventsSent += events.size();
+
+			backoff = std::chrono::milliseconds(0);
+
+			if (plainRetry) {
+				// The server does not take gzip: stop sending
+				// it.
+				m_compress = false;
+				plainRetry = false;
+			}
+
+			continue;
+		}
+
+		++m_stats.requestsFailed;
+
+		if (status == 0 || status == 408 || status == 429 ||
+		    status >= 500) {
+			backoff = backoff.count() ? std::min(backoff * 2,
+							     m_options.maxBackoff)
+						  : m_options.initialBackoff;
+
+			m_cv.wait_for(lock, backoff, [this]() { return m_stop; });
+
+			continue;
+		}
+
+		if (compress) {
+			plainRetry = true;
+
+			continue;
+		}
+
+		// Rejected: retrying would not help, and would hold up every
+		// event behind these.
+		m_spool.Commit(endOffset);
+
+		m_stats.eventsRejected += events.size();
+
+		plainRetry = false;
+
+		lock.unlock();
+
+		Log("batch of " + std::to_string(events.size()) +
+		    " event(s) rejected with HTTP status " +
+		    std::to_string(status) + ", dropped");
+
+		lock.lock();
+	}
+}
+
+void StreamElementsAnalyticsUploader::Log(const std::string &message)
+{
+	if (m_options.log)
+		m_options.log(message);
+}
+
+int StreamElementsAnalyticsUploader::Post(const std::vector<std::string> &events,
+					  bool compress)
+{
+	std::string body = "[";
+
+	for (size_t i = 0; i < events.size(); ++i) {
+		if (i)
+			body += ",";
+
+		body += events[i];
+	}
+
+	body += "]";
+
+	headers_t headers;
+
+	headers.emplace("Content-Type", "application/json");
+
+	if (compress) {
+		std::string compressed = Gzip(body);
+
+		if (!compressed.empty()) {
+			body = std::move(compressed);
+
+			headers.emplace("Content-Encoding", "gzip");
+		}
+	}
+
+	return m_transport(body, headers);
+}
+
+std::string StreamElementsAnalyticsUploader::Gzip(const std::string &input)
+{
+	size_t deflatedSize = 0;
+
+	// Raw deflate: without TDEFL_WRITE_ZLIB_HEADER.
+	void *deflated = tdefl_compress_mem_to_heap(
+		input.data(), input.size(), &deflatedSize,
+		TDEFL_DEFAULT_MAX_PROBES);
+
+	if (!deflated)
+		return "";
+
+	static const unsigned char HEADER[10] = {0x1f, 0x8b, 8, 0, 0,
+						 0,    0,    0, 0, 0xff};
+
+	std::string result((const char *)HEADER, sizeof(HEADER));
+
+	result.append((const char *)deflated, deflatedSize);
+
+	mz_free(deflated);
+
+	const uint32_t crc = (uint32_t)mz_crc32(
+		MZ_CRC32_INIT, (const unsigned char *)input.data(),
+		input.size());
+	const uint32_t size = (uint32_t)input.size();
+
+	for (int i = 0; i < 4; ++i)
+		result += (char)((crc >> (8 * i)) & 0xff);
+
+	for (int i = 0; i < 4; ++i)
+		result += (char)((size >> (8 * i)) & 0xff);
+
+	return result;
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "StreamElementsAnalyticsSpool.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+//
+// Delivers analytics events in batches, from an on-disk spool.
+//
+// Events used to be POSTed one at a time, each as a one-element array, by a
+// pool of consumer threads polling their queue every 100 ms. A burst of UI
+// events became a burst of TLS requests, and any event in flight during a
+// network failure or at shutdown was lost.
+//
+// Events are now appended to a StreamElementsAnalyticsSpool and drained by a
+// single sender thread, started with the first event. The sender waits until
+// a batch is full by count or bytes, or its oldest event reaches the maximum
+// age, and POSTs it as one JSON array, gzip-compressed. A batch is consumed
+// from the spool only once the server accepted it:
+//
+// * 2xx: delivered.
+// * 408, 429, 5xx or no response: retried with exponential backoff.
+// * Any other status: rejected; the batch is dropped so it cannot block
+//   the queue forever, and Options::log is told. A compressed batch is
+//   retried uncompressed first: servers refuse an encoding they do not
+//   take with all sorts of 4xx, not just 415. If that goes through, the
+//   rest of the session is sent uncompressed.
+//
+// Events left in the spool at shutdown are sent by the next session. When
+// idle the sender sleeps until there is something to send.
+//
+// The HTTP client is a transport function supplied by the caller.
+//
+class StreamElementsAnalyticsUploader {
+public:
+	typedef std::multimap<std::string, std::string> headers_t;
+
+	// POSTs `body` with `headers`; returns the HTTP status, or 0 when
+	// there was no response at all.
+	typedef std::function<int(const std::string &body,
+				  const headers_t &headers)>
+		transport_t;
+
+	typedef std::function<void(const std::string &message)> log_t;
+
+	struct Options {
+		size_t maxBatchEvents = 100;
+		size_t maxBatchBytes = 256 * 1024;
+		std::chrono::milliseconds maxBatchAge =
+			std::chrono::seconds(5);
+
+		std::chrono::milliseconds initialBackoff =
+			std::chrono::seconds(1);
+		std::chrono::milliseconds maxBackoff = std::chrono::minutes(5);
+
+		bool compress = true;
+
+		// Invoked on the sender thread for every batch dropped.
+		log_t log;
+	};
+
+	struct Stats {
+		size_t eventsQueued = 0;
+		size_t eventsDropped = 0;
+		size_t eventsSent = 0;
+		size_t eventsRejected = 0;
+
+		size_t requestsSent = 0;
+		size_t requestsFailed = 0;
+	};
+
+public:
+	StreamElementsAnalyticsUploader(std::string spoolPath,
+					transport_t transport, Options options);
+	~StreamElementsAnalyticsUploader();
+
+	// Queues one event, a single JSON object.
+	void Add(const std::string &eventJson);
+
+	// Sends one event right away on the calling thread, for when there
+	// may not be a later: the crash handler. Spools it if that fails.
+	void SendNow(const std::string &eventJson);
+
+	// Asks for everything queued to be sent now, regardless of age, and
+	// waits up to `timeout` for the spool to drain. Returns true if it
+	// did.
+	bool Flush(std::chrono::milliseconds timeout);
+
+	Stats GetStats();
+
+	// gzip (RFC 1952) encoding of `input`.
+	static std::string Gzip(const std::string &input);
+
+private:
+	void StartSender();
+	void SenderThreadProc();
+
+	// Returns the HTTP status of POSTing `events` as one array.
+	int Post(const std::vector<std::string> &events, bool compress);
+
+	void Log(const std::string &message);
+
+private:
+	StreamElementsAnalyticsSpool m_spool;
+	transport_t m_transport;
+	Options m_options;
+
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+	std::condition_variable m_drained;
+	std::thread m_sender;
+	bool m_spoolOpen = false;
+	bool m_running = false;
+	bool m_stop = false;
+	bool m_flush = false;
+	bool m_compress;
+
+	Stats m_stats;
+};
@@ -683,6 +683,24 @@ void StreamElementsApiMessageHandler::RegisterIncomingApiCallHandlers()
 	}
 	API_HANDLER_END();
 
+	API_HANDLER_BEGIN("getLogLevel");
+	{
+		result->SetInt(StreamElementsAsyncLog::GetInstance()->GetMinLevel());
+	}
+	API_HANDLER_END();
+
+	API_HANDLER_BEGIN("setLogLevel");
+	{
+		if (args->GetSize() && args->GetType(0) == VTYPE_INT &&
+		    StreamElementsAsyncLog::IsValidLevel(args->GetInt(0))) {
+			StreamElementsConfig::GetInstance()->SetLogMinLevel(
+				args->GetInt(0));
+
+			result->SetBool(true);
+		}
+	}
+	API_HANDLER_END();
+
 	API_HANDLER_BEGIN("deleteAllCookies");
 	{
 		StreamElementsGlobalStateManager::GetInstance()->DeleteCookies();
@@ -1918,6 +1936,24 @@ void StreamElementsApiMessageHandler::RegisterIncomingApiCallHandlers()
 	}
 	API_HANDLER_END();
 
+	API_HANDLER_BEGIN("getSceneItemListSnapshot");
+	{
+		if (args->GetSize()) {
+			StreamElementsGlobalStateManager::GetInstance()
+				->GetObsSceneManager()
+				->SerializeObsSceneItemsSnapshot(
+					args->GetValue(0), result);
+		} else {
+			CefRefPtr<CefValue> nullArg = CefValue::Create();
+
+			StreamElementsGlobalStateManager::GetInstance()
+				->GetObsSceneManager()
+				->SerializeObsSceneItemsSnapshot(nullArg,
+								 result);
+		}
+	}
+	API_HANDLER_END();
+
 	API_HANDLER_BEGIN("removeCurrentSceneItemsByIds");
 	{
 		if (args->GetSize()) {
@@ -2022,6 +2058,32 @@ void StreamElementsApiMessageHandler::RegisterIncomingApiCallHandlers()
 	}
 	API_HANDLER_END();
 
+	API_HANDLER_BEGIN("setSceneItemsPropertiesById");
+	{
+		if (args->GetSize()) {
+			StreamElementsGlobalStateManager::GetInstance()
+				->GetObsSceneManager()
+				->SetObsSceneItemsPropertiesById(
+					args->GetValue(0), result);
+		}
+	}
+	API_HANDLER_END();
+
+	API_HANDLER_BEGIN("getWorkspaceSnapshot");
+	{
+		if (args->GetSize()) {
+			StreamElementsGlobalStateManager::GetInstance()
+				->SerializeWorkspaceSnapshot(args->GetValue(0),
+							     result);
+		} else {
+			CefRefPtr<CefValue> nullArg = CefValue::Create();
+
+			StreamElementsGlobalStateManager::GetInstance()
+				->SerializeWorkspaceSnapshot(nullArg, result);
+		}
+	}
+	API_HANDLER_END();
+
 	API_HANDLER_BEGIN("getCurrentSceneItemPropertiesById");
 	{
 		if (args->GetSize()) {
@@ -2664,6 +2726,14 @@ void StreamElementsApiMessageHandler::RegisterIncomingApiCallHandlers()
 	}
 	API_HANDLER_END();
 
+	API_HANDLER_BEGIN("getStreamingOutputListSnapshot");
+	{
+		StreamElementsGlobalStateManager::GetInstance()
+			->GetOutputManager()
+			->SerializeAllOutputsSnapshot(StreamingOutput, result);
+	}
+	API_HANDLER_END();
+
 	API_HANDLER_BEGIN("addStreamingOutput");
 	{
 		if (args->GetSize()) {
@@ -2722,6 +2792,14 @@ void StreamElementsApiMessageHandler::RegisterIncomingApiCallHandlers()
 	}
 	API_HANDLER_END();
 
+	API_HANDLER_BEGIN("getRecordingOutputListSnapshot");
+	{
+		StreamElementsGlobalStateManager::GetInstance()
+			->GetOutputManager()
+			->SerializeAllOutputsSnapshot(RecordingOutput, result);
+	}
+	API_HANDLER_END();
+
 	API_HANDLER_BEGIN("addRecordingOutput");
 	{
 		if (args->GetSize()) {
@@ -2791,6 +2869,14 @@ void StreamElementsApiMessageHandler::RegisterIncomingApiCallHandlers()
 	}
 	API_HANDLER_END();
 
+	API_HANDLER_BEGIN("getReplayBufferOutputListSnapshot");
+	{
+		StreamElementsGlobalStateManager::GetInstance()
+			->GetOutputManager()
+			->SerializeAllOutputsSnapshot(ReplayBufferOutput, result);
+	}
+	API_HANDLER_END();
+
 	API_HANDLER_BEGIN("addReplayBufferOutput");
 	{
 		if (args->GetSize()) {
@@ -2929,6 +3015,14 @@ void StreamElementsApiMessageHandler::RegisterIncomingApiCallHandlers()
 	}
 	API_HANDLER_END();
 
+	API_HANDLER_BEGIN("getVideoCompositionListSnapshot");
+	{
+		StreamElementsGlobalStateManager::GetInstance()
+			->GetVideoCompositionManager()
+			->SerializeAllCompositionsSnapshot(result);
+	}
+	API_HANDLER_END();
+
 	API_HANDLER_BEGIN("getAllAudioCompositions");
 	{
 		StreamElementsGlobalStateManager::GetInstance()
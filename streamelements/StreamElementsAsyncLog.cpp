@@ -0,0 +1,403 @@
+#include "StreamElementsAsyncLog.hpp"
+#include "StreamElementsUtilsBase.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
+// Ends a message which vsnprintf() cut at `size` bytes with this, so that a
+// cut message does not read as a complete one.
+static const char TRUNCATION_MARKER[] = " [truncated]";
+
+// `message` holds `size - 1` characters. Returns the new length.
+static size_t MarkTruncated(char *message, size_t size)
+{
+	size_t length = size - sizeof(TRUNCATION_MARKER);
+
+	// Do not leave half a UTF-8 sequence in front of the marker.
+	while (length && ((unsigned char)message[length] & 0xC0) == 0x80)
+		--length;
+
+	memcpy(message + length, TRUNCATION_MARKER, sizeof(TRUNCATION_MARKER));
+
+	return length + sizeof(TRUNCATION_MARKER) - 1;
+}
+
+/* ================================================================= */
+
+StreamElementsAsyncLog::StreamElementsAsyncLog(sink_t sink, Options options)
+	: m_options(options),
+	  m_enqueue(0),
+	  m_minLevel(options.minLevel),
+	  m_stopped(false),
+	  m_writerIdle(false),
+	  m_sites(nullptr),
+	  m_suppressed(0),
+	  m_dropped(0),
+	  m_written(0),
+	  m_sink(sink)
+{
+	const size_t capacity =
+		RoundUpToPowerOfTwo(std::max<size_t>(options.capacity, 2));
+
+	m_slots.reset(new Slot[capacity]);
+	m_mask = capacity - 1;
+
+	for (size_t i = 0; i < capacity; ++i)
+		m_slots[i].sequence.store(i, std::memory_order_relaxed);
+
+	m_lastSummary = GetCoarseMilliseconds();
+
+	m_thread = std::thread([this]() { WriterThread(); });
+}
+
+StreamElementsAsyncLog::~StreamElementsAsyncLog()
+{
+	Shutdown();
+}
+
+void StreamElementsAsyncLog::SetSink(sink_t sink)
+{
+	std::lock_guard<std::mutex> guard(m_sinkMutex);
+
+	m_sink = sink;
+}
+
+void StreamElementsAsyncLog::Log(CallSite &site, int level,
+				 const char *format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	LogV(site, level, format, args);
+	va_end(args);
+}
+
+void StreamElementsAsyncLog::LogV(CallSite &site, int level,
+				  const char *format, va_list args)
+{
+	if (!IsEnabled(level) || !Admit(site, level))
+		return;
+
+	if (m_stopped.load(std::memory_order_acquire)) {
+		char buffer[MAX_MESSAGE_SIZE];
+
+		const int result =
+			vsnprintf(buffer, sizeof(buffer), format, args);
+
+		if (result < 0)
+			return;
+
+		if ((size_t)result >= sizeof(buffer))
+			MarkTruncated(buffer, sizeof(buffer));
+
+		Write(level, buffer);
+
+		return;
+	}
+
+	uint64_t position = m_enqueue.load(std::memory_order_relaxed);
+	Slot *slot;
+
+	for (;;) {
+		slot = &m_slots[position & m_mask];
+
+		const uint64_t sequence =
+			slot->sequence.load(std::memory_order_acquire);
+
+		if (sequence == position) {
+			if (m_enqueue.compare_exchange_weak(
+				    position, position + 1,
+				    std::memory_order_relaxed))
+				break;
+		} else if (sequence < position) {
+			// The writer has not freed this slot since the last
+			// lap: the queue is full.
+			m_dropped.fetch_add(1, std::memory_order_relaxed);
+
+			return;
+		} else {
+			position = m_enqueue.load(std::memory_order_relaxed);
+		}
+	}
+
+	// Formatted only now that there is somewhere to put the result.
+	const int result =
+		vsnprintf(slot->message, MAX_MESSAGE_SIZE, format, args);
+
+	size_t size = result < 0 ? 0 : (size_t)result;
+
+	if (size >= MAX_MESSAGE_SIZE)
+		size = MarkTruncated(slot->message, MAX_MESSAGE_SIZE);
+
+	slot->level = level;
+	slot->size = (uint16_t)size;
+
+	slot->sequence.store(position + 1, std::memory_order_release);
+
+	// The writer picks messages up on its own every flushIntervalMs; it is
+	// only woken early when a quarter of the queue has filled up, so most
+	// calls never touch the mutex.
+	if (((position + 1) & (m_mask >> 2)) == 0) {
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		if (m_writerIdle.load(std::memory_order_relaxed))
+			Wake();
+	}
+}
+
+bool StreamElementsAsyncLog::Admit(CallSite &site, int level)
+{
+	if (!m_options.burst)
+		return true;
+
+	const int64_t now = GetCoarseMilliseconds();
+
+	int64_t start = site.m_windowStart.load(std::memory_order_relaxed);
+
+	if (start == INT64_MIN || now - start >= (int64_t)m_options.windowMs) {
+		if (site.m_windowStart.compare_exchange_strong(
+			    start, now, std::memory_order_relaxed))
+			site.m_count.store(0, std::memory_order_relaxed);
+	}
+
+	if (site.m_count.fetch_add(1, std::memory_order_relaxed) <
+	    m_options.burst)
+		return true;
+
+	site.m_level.store(level, std::memory_order_relaxed);
+	site.m_suppressed.fetch_add(1, std::memory_order_relaxed);
+	m_suppressed.fetch_add(1, std::memory_order_relaxed);
+
+	if (!site.m_registered.load(std::memory_order_relaxed))
+		Register(site);
+
+	return false;
+}
+
+void StreamElementsAsyncLog::Register(CallSite &site)
+{
+	if (site.m_registered.exchange(true))
+		return;
+
+	// Push-only list: sites are statics and live as long as the process.
+	CallSite *head = m_sites.load(std::memory_order_relaxed);
+
+	do {
+		site.m_next = head;
+	} while (!m_sites.compare_exchange_weak(head, &site,
+						std::memory_order_release,
+						std::memory_order_relaxed));
+}
+
+void StreamElementsAsyncLog::Flush()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	if (m_stopping)
+		return;
+
+	const uint64_t ticket = ++m_flushRequested;
+
+	m_wake.notify_one();
+
+	m_flushed.wait(lock, [&]() { return m_flushCompleted >= ticket; });
+}
+
+void StreamElementsAsyncLog::Shutdown()
+{
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+
+		if (m_stopping)
+			return;
+
+		m_stopping = true;
+
+		m_wake.notify_one();
+	}
+
+	// From here on callers write synchronously.
+	m_stopped.store(true, std::memory_order_release);
+
+	m_thread.join();
+
+	// Anything queued by callers that had already passed the check.
+	Drain();
+	ReportSummaries(true);
+}
+
+StreamElementsAsyncLog::Stats StreamElementsAsyncLog::GetStats() const
+{
+	Stats result;
+
+	result.written = m_written.load(std::memory_order_relaxed);
+	result.suppressed = m_suppressed.load(std::memory_order_relaxed);
+	result.dropped = m_dropped.load(std::memory_order_relaxed);
+
+	return result;
+}
+
+/* ================================================================= */
+
+void StreamElementsAsyncLog::Wake()
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+
+	m_wake.notify_one();
+}
+
+bool StreamElementsAsyncLog::HasPending() const
+{
+	return m_slots[m_dequeue & m_mask].sequence.load(
+		       std::memory_order_acquire) == m_dequeue + 1;
+}
+
+void StreamElementsAsyncLog::Drain()
+{
+	while (HasPending()) {
+		Slot &slot = m_slots[m_dequeue & m_mask];
+
+		slot.message[slot.size] = '\0';
+
+		Write(slot.level, slot.message);
+
+		slot.sequence.store(m_dequeue + m_mask + 1,
+				    std::memory_order_release);
+
+		++m_dequeue;
+	}
+}
+
+void StreamElementsAsyncLog::ReportSummaries(bool force)
+{
+	const int64_t now = GetCoarseMilliseconds();
+
+	if (!force && now - m_lastSummary < (int64_t)m_options.windowMs)
+		return;
+
+	m_lastSummary = now;
+
+	char buffer[MAX_MESSAGE_SIZE];
+
+	for (CallSite *site = m_sites.load(std::memory_order_acquire); site;
+	     site = site->m_next) {
+		const uint64_t count = site->m_suppressed.exchange(
+			0, std::memory_order_relaxed);
+
+		if (!count)
+			continue;
+
+		snprintf(buffer, sizeof(buffer),
+			 "obs-streamelements-core: suppressed %llu messages from %s:%d",
+			 (unsigned long long)count, GetFileName(site->m_file),
+			 site->m_line);
+
+		Write(site->m_level.load(std::memory_order_relaxed), buffer);
+	}
+
+	const uint64_t dropped = m_dropped.load(std::memory_order_relaxed);
+
+	if (dropped != m_droppedReported) {
+		snprintf(buffer, sizeof(buffer),
+			 "obs-streamelements-core: log queue full, dropped %llu messages",
+			 (unsigned long long)(dropped - m_droppedReported));
+
+		m_droppedReported = dropped;
+
+		Write(LEVEL_WARNING, buffer);
+	}
+}
+
+void StreamElementsAsyncLog::Write(int level, const char *message)
+{
+	std::lock_guard<std::mutex> guard(m_sinkMutex);
+
+	if (m_sink)
+		m_sink(level, message);
+
+	m_written.fetch_add(1, std::memory_order_relaxed);
+}
+
+void StreamElementsAsyncLog::WriterThread()
+{
+	for (;;) {
+		Drain();
+		ReportSummaries(false);
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		if (m_flushRequested != m_flushCompleted) {
+			const uint64_t ticket = m_flushRequested;
+
+			lock.unlock();
+
+			Drain();
+			ReportSummaries(true);
+
+			lock.lock();
+
+			m_flushCompleted = ticket;
+			m_flushed.notify_all();
+
+			continue;
+		}
+
+		if (m_stopping)
+			break;
+
+		// Pairs with the fence in LogV(): either the producer sees the
+		// writer idle and wakes it, or the check below sees the
+		// message.
+		m_writerIdle.store(true, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		m_wake.wait_for(
+			lock,
+			std::chrono::milliseconds(m_options.flushIntervalMs),
+			[this]() {
+				return m_stopping ||
+				       m_flushRequested != m_flushCompleted ||
+				       HasPending();
+			});
+
+		m_writerIdle.store(false, std::memory_order_relaxed);
+	}
+
+	Drain();
+	ReportSummaries(true);
+}
+
+int64_t StreamElementsAsyncLog::GetCoarseMilliseconds()
+{
+#ifdef _WIN32
+	return (int64_t)GetTickCount64();
+#elif defined(CLOCK_MONOTONIC_COARSE)
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+
+	return (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+#else
+	return std::chrono::duration_cast<std::chrono::milliseconds>(
+		       std::chrono::steady_clock::now().time_since_epoch())
+		.count();
+#endif
+}
+
+/* ================================================================= */
+
+StreamElementsAsyncLog *StreamElementsAsyncLog::GetInstance()
+{
+	static StreamElementsAsyncLog *s_instance =
+		new StreamElementsAsyncLog(nullptr, Options());
+
+	return s_instance;
+}
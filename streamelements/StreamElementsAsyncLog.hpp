@@ -0,0 +1,217 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+//
+// Asynchronous, rate-limited logging for hot paths.
+//
+// blog() formats, takes the libobs log mutex and writes to the log file on
+// the calling thread. That is fine for one-off messages, but request
+// handlers, websocket connections and scene signal tracing can call it
+// hundreds of times a second from threads that have better things to do.
+//
+// Log() returns without formatting when the level is filtered out or when
+// the call site has used up its burst for the current window. Otherwise it
+// claims a slot in a bounded lock-free queue, formats the message straight
+// into the slot, and a background writer hands it to the sink later. The
+// caller never takes a lock and never waits on I/O. When the queue is full
+// the message is dropped and counted.
+//
+// The writer reports suppressed messages once per window as
+// "suppressed N messages from file:line" summaries, along with any messages
+// dropped because the queue was full. Flush() and Shutdown() report
+// whatever is still pending.
+//
+// Levels are libobs's LOG_* values: lower is more severe.
+//
+class StreamElementsAsyncLog {
+public:
+	static const int LEVEL_ERROR = 100;
+	static const int LEVEL_WARNING = 200;
+	static const int LEVEL_INFO = 300;
+	static const int LEVEL_DEBUG = 400;
+
+	// One slot is 512 bytes, header included. Longer messages are cut
+	// short and end in " [truncated]".
+	static constexpr size_t MAX_MESSAGE_SIZE = 496;
+
+	typedef std::function<void(int level, const char *message)> sink_t;
+
+	struct Options {
+		// Rounded up to a power of two.
+		size_t capacity = 1024;
+
+		// Messages each call site may log per window; 0 for no limit.
+		uint32_t burst = 20;
+		uint32_t windowMs = 5000;
+
+		// How long the writer sleeps between drains when nobody wakes
+		// it up.
+		uint32_t flushIntervalMs = 100;
+
+		int minLevel = LEVEL_INFO;
+	};
+
+	// Per-call-site rate limiter state. Meant to be a function-local
+	// static, see SE_LOG(); it is constant-initialized, so declaring one
+	// costs nothing. A site belongs to the first logger it suppresses
+	// messages for.
+	class CallSite {
+	public:
+		constexpr CallSite(const char *file, int line)
+			: m_file(file),
+			  m_line(line),
+			  m_windowStart(INT64_MIN),
+			  m_count(0),
+			  m_suppressed(0),
+			  m_level(LEVEL_INFO),
+			  m_registered(false),
+			  m_next(nullptr)
+		{
+		}
+
+	private:
+		friend class StreamElementsAsyncLog;
+
+		const char *m_file;
+		int m_line;
+
+		std::atomic<int64_t> m_windowStart;
+		std::atomic<uint32_t> m_count;
+		std::atomic<uint64_t> m_suppressed;
+		std::atomic<int> m_level;
+
+		std::atomic<bool> m_registered;
+		CallSite *m_next;
+	};
+
+	struct Stats {
+		uint64_t written = 0;
+		uint64_t suppressed = 0;
+		uint64_t dropped = 0;
+	};
+
+public:
+	StreamElementsAsyncLog(sink_t sink, Options options);
+	~StreamElementsAsyncLog();
+
+	// Replaces the sink. The sink runs on the writer thread, or on the
+	// caller's after Shutdown().
+	void SetSink(sink_t sink);
+
+	void SetMinLevel(int level)
+	{
+		m_minLevel.store(level, std::memory_order_relaxed);
+	}
+
+	int GetMinLevel() const
+	{
+		return m_minLevel.load(std::memory_order_relaxed);
+	}
+
+	bool IsEnabled(int level) const { return level <= GetMinLevel(); }
+
+	// Minimum levels outside LEVEL_ERROR..LEVEL_DEBUG would filter out
+	// errors, or nothing at all.
+	static bool IsValidLevel(int level)
+	{
+		return level >= LEVEL_ERROR && level <= LEVEL_DEBUG;
+	}
+
+	void Log(CallSite &site, int level, const char *format, ...);
+	void LogV(CallSite &site, int level, const char *format, va_list args);
+
+	// Blocks until everything logged before the call has reached the
+	// sink, and pending suppression summaries with it.
+	void Flush();
+
+	// Drains the queue and stops the writer thread. Messages logged
+	// afterwards are written synchronously.
+	void Shutdown();
+
+	Stats GetStats() const;
+
+	// Process-wide logger SE_LOG() writes to. Its sink discards messages
+	// until the plugin installs one. Never destroyed.
+	static StreamElementsAsyncLog *GetInstance();
+
+private:
+	struct alignas(64) Slot {
+		// Vyukov bounded queue: index when free, index + 1 when it
+		// holds a message for the writer.
+		std::atomic<uint64_t> sequence;
+
+		int32_t level;
+		uint16_t size;
+
+		char message[MAX_MESSAGE_SIZE];
+	};
+
+	static_assert(sizeof(Slot) == 512, "slot layout");
+
+	bool Admit(CallSite &site, int level);
+	void Register(CallSite &site);
+
+	void Wake();
+	void WriterThread();
+	bool HasPending() const;
+	void Drain();
+	void ReportSummaries(bool force);
+	void Write(int level, const char *message);
+
+	static int64_t GetCoarseMilliseconds();
+
+private:
+	Options m_options;
+
+	std::unique_ptr<Slot[]> m_slots;
+	size_t m_mask = 0;
+
+	alignas(64) std::atomic<uint64_t> m_enqueue;
+	alignas(64) std::atomic<int> m_minLevel;
+	std::atomic<bool> m_stopped;
+	std::atomic<bool> m_writerIdle;
+	std::atomic<CallSite *> m_sites;
+
+	alignas(64) std::atomic<uint64_t> m_suppressed;
+	alignas(64) std::atomic<uint64_t> m_dropped;
+
+	// Writer thread only.
+	uint64_t m_dequeue = 0;
+	uint64_t m_droppedReported = 0;
+	int64_t m_lastSummary = 0;
+
+	std::atomic<uint64_t> m_written;
+
+	std::mutex m_sinkMutex;
+	sink_t m_sink;
+
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::condition_variable m_flushed;
+	bool m_stopping = false;
+	uint64_t m_flushRequested = 0;
+	uint64_t m_flushCompleted = 0;
+
+	std::thread m_thread;
+};
+
+// Logs through StreamElementsAsyncLog::GetInstance() with a rate limiter of
+// its own. The arguments are not evaluated when the level is filtered out.
+#define SE_LOG(level, ...)                                                   \
+	do {                                                                 \
+		static StreamElementsAsyncLog::CallSite _se_log_site(        \
+			__FILE__, __LINE__);                                 \
+		StreamElementsAsyncLog *_se_log =                            \
+			StreamElementsAsyncLog::GetInstance();               \
+		if (_se_log->IsEnabled(level))                               \
+			_se_log->Log(_se_log_site, level, __VA_ARGS__);      \
+	} while (0)
@@ -7,6 +7,10 @@
 #include <obs-frontend-api.h>
 #include <util/config-file.h>
 
+#include "StreamElementsParallelZipWriter.hpp"
+#include "StreamElementsBackupManifest.hpp"
+#include "StreamElementsParallelZipExtractor.hpp"
+
 #include "deps/zip/zip.h"
 
 #ifdef WIN32
@@ -20,7 +24,11 @@
 
 #include <vector>
 #include <map>
+#include <set>
 #include <regex>
+#include <algorithm>
+#include <chrono>
+#include <memory>
 
 #ifndef BYTE
 typedef unsigned char BYTE;
@@ -124,71 +132,30 @@ static bool GetLocalPathFromURL(std::string url, std::string &path)
 	return result;
 }
 
-static bool AddFileToZip(zip_t *zip, std::string localPath, std::string zipPath)
+//
+// Backup entries are queued on a StreamElementsParallelZipWriter, which reads
+// and compresses them on its worker pool. These only verify what can be
+// verified up front; read failures surface in the writer's
+// GetFailedEntries() once it is flushed.
+//
+static bool AddFileToZip(StreamElementsParallelZipWriter *zip,
+			 std::string localPath, std::string zipPath)
 {
-#ifdef WIN32
-	int fd = _wsopen(utf8_to_wstring(localPath).c_str(),
-			 O_RDONLY | O_BINARY, SH_DENYNO,
-			 0 /*S_IREAD | S_IWRITE*/);
-#else
-    int fd = ::open(localPath.c_str(),
-             O_RDONLY);
-#endif
-    
-	if (-1 != fd) {
-		size_t BUF_LEN = 32768;
-
-		BYTE *buf = new BYTE[BUF_LEN];
-
-		if (0 == zip_entry_open(zip, zipPath.c_str())) {
-			bool success = true;
-
-			int read = ::read(fd, buf, BUF_LEN);
-			while (read > 0 && success) {
-				int retVal = zip_entry_write(zip, buf, read);
-				if (retVal < 0) {
-					success = false;
-
-					break;
-				}
-
-				read = ::read(fd, buf, BUF_LEN);
-			}
-
-			zip_entry_close(zip);
-
-			delete[] buf;
+	if (!os_file_exists(localPath.c_str()))
+		return false;
 
-			::close(fd);
+	zip->AddFile(localPath, zipPath);
 
-			return success;
-		} else {
-			// Filed opening ZIP entry for writing
-		}
-	} else {
-		// Failed opening file for reading
-		//
-		// This is a crash handler: you can't really do anything
-		// here to mitigate.
-	}
-
-	return false;
+	return true;
 }
 
-static bool AddBufferToZip(zip_t *zip, BYTE *buf, size_t bufLen,
-			   std::string zipPath)
+static bool AddBufferToZip(StreamElementsParallelZipWriter *zip, BYTE *buf,
+			   size_t bufLen, std::string zipPath)
 {
-	bool result = false;
+	zip->AddBuffer(std::string((const char *)buf, bufLen), zipPath);
 
-	if (0 == zip_entry_open(zip, zipPath.c_str())) {
-		if (0 == zip_entry_write(zip, buf, bufLen))
-			result = true;
-
-		zip_entry_close(zip);
-	}
-
-	return result;
-};
+	return true;
+}
 
 static const std::string MONIKER_START =
 	"<streamelements:relative-path:obs-studio>";
@@ -329,10 +296,8 @@ ScanScenesForFileReferencesMonikersToRestore(std::string srcBasePath,
 
 		std::string fileName = entry->d_name;
 
-		std::smatch match;
-
-		if (!std::regex_search(fileName, match,
-				       std::regex("^(.+?)\\.json$")))
+		if (fileName.size() <= 5 ||
+		    fileName.compare(fileName.size() - 5, 5, ".json") != 0)
 			continue;
 
 		std::string srcFilePath = srcScanPath + "/" + fileName;
@@ -437,8 +402,15 @@ ScanForFileReferences(CefRefPtr<CefValue> &node, std::map<std::string, std::stri
 	return true;
 }
 
+//
+// With a manifest (incremental mode) referenced files are archived under
+// their content-addressed path, and only when the manifest's chain does not
+// hold them yet; the moniker points at the object path either way.
+//
 static bool
-ScanForFileReferencesToBackup(zip_t *zip, CefRefPtr<CefValue> &node,
+ScanForFileReferencesToBackup(StreamElementsParallelZipWriter *zip,
+			      StreamElementsBackupManifest *manifest,
+			      CefRefPtr<CefValue> &node,
 			      std::map<std::string, std::string> &filesMap,
 			      std::string timestamp,
 			      CefRefPtr<CefValue> &result)
@@ -460,7 +432,20 @@ ScanForFileReferencesToBackup(zip_t *zip, CefRefPtr<CefValue> &node,
 				     "obs-streamelements-core: backup: file skipped due to unsafe file type: %s",
 				     path.c_str());
 			} else {
-				if (!filesMap.count(path)) {
+				if (!filesMap.count(path) && manifest) {
+					std::string zipPath;
+					bool include = false;
+
+					if (!manifest->AddFile(path, zipPath,
+							       include))
+						return false;
+
+					if (include &&
+					    !AddFileToZip(zip, path, zipPath))
+						return false;
+
+					filesMap[path] = zipPath;
+				} else if (!filesMap.count(path)) {
 					std::string fileName =
 						GetUniqueFileNameFromPath(path,
 									  48);
@@ -490,8 +475,9 @@ ScanForFileReferencesToBackup(zip_t *zip, CefRefPtr<CefValue> &node,
 			CefRefPtr<CefValue> value =
 				list->GetValue(index)->Copy();
 
-			if (!ScanForFileReferencesToBackup(zip, value, filesMap,
-							   timestamp, value))
+			if (!ScanForFileReferencesToBackup(zip, manifest, value,
+							   filesMap, timestamp,
+							   value))
 				return false;
 
 			out->SetValue(index, value);
@@ -510,8 +496,8 @@ ScanForFileReferencesToBackup(zip_t *zip, CefRefPtr<CefValue> &node,
 					d->GetValue(key)->Copy();
 
 				if (!ScanForFileReferencesToBackup(
-					    zip, value, filesMap, timestamp,
-					    value))
+					    zip, manifest, value, filesMap,
+					    timestamp, value))
 					return false;
 
 				out->SetValue(key, value);
@@ -524,14 +510,114 @@ ScanForFileReferencesToBackup(zip_t *zip, CefRefPtr<CefValue> &node,
 	return true;
 }
 
-static bool AddReferencedFilesToZip(zip_t *zip, std::string timestamp,
+static bool AddReferencedFilesToZip(StreamElementsParallelZipWriter *zip,
+				    StreamElementsBackupManifest *manifest,
+				    std::string timestamp,
 				    CefRefPtr<CefValue> &content,
+				    std::map<std::string, std::string> &filesMap,
 				    CefRefPtr<CefValue> &result)
 {
+	return ScanForFileReferencesToBackup(zip, manifest, content, filesMap,
+					     timestamp, result);
+}
+
+//
+// Points the monikers of referenced files which could not be archived back
+// at their original path, as if they had been skipped.
+//
+static void
+RevertFailedFileReferences(CefRefPtr<CefValue> &node,
+			   std::map<std::string, std::string> &zipToLocalPath,
+			   std::set<std::string> &failedZipPaths,
+			   CefRefPtr<CefValue> &result)
+{
+	result = node->Copy();
+
+	if (node->GetType() == VTYPE_STRING) {
+		std::string moniker = node->GetString().ToString();
+
+		if (moniker.size() >= MONIKER_START.size() + MONIKER_END.size() &&
+		    moniker.substr(0, MONIKER_START.size()) == MONIKER_START &&
+		    moniker.substr(moniker.size() - MONIKER_END.size()) ==
+			    MONIKER_END) {
+			std::string zipPath = moniker.substr(
+				MONIKER_START.size(),
+				moniker.size() - (MONIKER_START.size() +
+						  MONIKER_END.size()));
+
+			if (failedZipPaths.count(zipPath) &&
+			    zipToLocalPath.count(zipPath))
+				result->SetString(zipToLocalPath[zipPath]);
+		}
+	} else if (node->GetType() == VTYPE_LIST) {
+		CefRefPtr<CefListValue> list = node->GetList();
+		CefRefPtr<CefListValue> out = CefListValue::Create();
+
+		for (size_t index = 0; index < list->GetSize(); ++index) {
+			CefRefPtr<CefValue> value =
+				list->GetValue(index)->Copy();
+
+			RevertFailedFileReferences(value, zipToLocalPath,
+						   failedZipPaths, value);
+
+			out->SetValue(index, value);
+		}
+
+		result->SetList(out);
+	} else if (node->GetType() == VTYPE_DICTIONARY) {
+		CefRefPtr<CefDictionaryValue> d = node->GetDictionary();
+		CefRefPtr<CefDictionaryValue> out =
+			CefDictionaryValue::Create();
+
+		CefDictionaryValue::KeyList keys;
+		if (d->GetKeys(keys)) {
+			for (auto key : keys) {
+				CefRefPtr<CefValue> value =
+					d->GetValue(key)->Copy();
+
+				RevertFailedFileReferences(value, zipToLocalPath,
+							   failedZipPaths,
+							   value);
+
+				out->SetValue(key, value);
+			}
+		}
+
+		result->SetDictionary(out);
+	}
+}
+
+//
+// A JSON document whose referenced files are queued. It is archived once
+// the writer is flushed, so that its monikers only point at files which made
+// it into the package.
+//
+struct PendingBackupDocument {
+	std::string zipPath;
+	CefRefPtr<CefValue> content;
 	std::map<std::string, std::string> filesMap;
+};
+
+static bool AddPendingDocumentToZip(StreamElementsParallelZipWriter *zip,
+				    PendingBackupDocument &document,
+				    std::set<std::string> &failedZipPaths)
+{
+	CefRefPtr<CefValue> content = document.content;
+
+	if (!failedZipPaths.empty()) {
+		std::map<std::string, std::string> zipToLocalPath;
 
-	return ScanForFileReferencesToBackup(zip, content, filesMap, timestamp,
-					     result);
+		for (auto &kv : document.filesMap)
+			zipToLocalPath[kv.second] = kv.first;
+
+		RevertFailedFileReferences(document.content, zipToLocalPath,
+					   failedZipPaths, content);
+	}
+
+	std::string json = CefWriteJSON(content, JSON_WRITER_PRETTY_PRINT);
+
+	return AddBufferToZip(zip, (BYTE *)json.c_str(), json.size(),
+			      document.zipPath);
 }
 
 static CefRefPtr<CefValue> ReadCollectionById(std::string basePath,
@@ -557,18 +643,29 @@ static CefRefPtr<CefValue> ReadCollectionById(std::string basePath,
 	return result;
 }
 
-static bool AddCollectionToZip(zip_t *zip, std::string basePath,
+// Queues a scene collection. Without referenced files the collection file
+// itself is queued and `fileZipPath` is set to its archive path; otherwise
+// its content is appended to `documents`.
+static bool AddCollectionToZip(StreamElementsParallelZipWriter *zip,
+			       StreamElementsBackupManifest *manifest,
+			       std::string basePath,
 			       std::string collection,
 			       bool includeReferencedFiles,
-			       std::string timestamp)
+			       std::string timestamp,
+			       std::vector<PendingBackupDocument> &documents,
+			       std::string &fileZipPath)
 {
 	std::string relPath = "basic/scenes/" + collection + ".json";
 	std::string absPath = basePath + "/" + relPath;
 
+	fileZipPath.clear();
+
 	if (!os_file_exists(absPath.c_str()))
 		return false;
 
 	if (!includeReferencedFiles) {
+		fileZipPath = relPath;
+
 		return AddFileToZip(zip, absPath, relPath);
 	}
 
@@ -580,29 +677,36 @@ static bool AddCollectionToZip(zip_t *zip, std::string basePath,
 	if (!content.get() || content->GetType() == VTYPE_NULL)
 		return false;
 
-	std::map<std::string, std::string> filesMap;
-	CefRefPtr<CefValue> resultContent = CefValue::Create();
+	PendingBackupDocument document;
+	document.zipPath = relPath;
+	document.content = CefValue::Create();
 
-	if (!AddReferencedFilesToZip(zip, timestamp, content, resultContent))
+	if (!AddReferencedFilesToZip(zip, manifest, timestamp, content,
+				     document.filesMap, document.content))
 		return false;
 
-	std::string json =
-		CefWriteJSON(resultContent, JSON_WRITER_PRETTY_PRINT);
+	documents.push_back(document);
 
-	return AddBufferToZip(zip, (BYTE *)json.c_str(), json.size(), relPath);
+	return true;
 }
 
-static bool AddProfileToZip(zip_t *zip, std::string basePath,
-			    std::string profile)
+// Queues a profile. `fileZipPath` is set to the archive path of its
+// basic.ini, without which the profile is not restorable.
+static bool AddProfileToZip(StreamElementsParallelZipWriter *zip,
+			    std::string basePath,
+			    std::string profile,
+			    std::string &fileZipPath)
 {
 	std::string relPath = "basic/profiles/" +
 			      std::regex_replace(profile, std::regex(" "), "_");
 	std::string absPath = basePath + "/" + relPath;
 
+	fileZipPath = relPath + "/basic.ini";
+
 	if (!os_file_exists(absPath.c_str()))
 		return false;
 
-	if (!AddFileToZip(zip, absPath + "/basic.ini", relPath + "/basic.ini"))
+	if (!AddFileToZip(zip, absPath + "/basic.ini", fileZipPath))
 		return false;
 
 	AddFileToZip(zip, absPath + "/service.json", relPath + "/service.json");
@@ -639,60 +743,50 @@ static bool AddProfileToZip(zip_t *zip, std::string basePath,
 	return true;
 }
 
-static bool AddScopedStorageToZip(zip_t *zip, std::string timestamp)
+static bool AddScopedStorageToZip(StreamElementsParallelZipWriter *zip,
+				  StreamElementsBackupManifest *manifest,
+				  std::string timestamp,
+				  std::vector<PendingBackupDocument> &documents)
 {
-	std::string basePath = StreamElementsConfig::GetInstance()
-				       ->GetScopedConfigStorageRootPath();
-
-	std::map<std::string, std::string> relToAbsMap;
-
-	glob_dirs(basePath + "/*", [&](std::string scope) {
-		glob_dirs(basePath + "/" + scope + "/*", [&](std::string
-								     container) {
-			glob_files(
-				basePath + "/" + scope + "/" + container +
-					"/*.json",
-				[&](std::string file) {
-					// TODO: We should calculate this better
-					std::string relPath =
-						"plugin_config/obs-streamelements-core/scoped_config_storage/" +
-						scope + "/" + container + "/" +
-						file;
-
-					std::string absPath =
-						basePath + "/" + scope + "/" +
-						container + "/" + file;
-
-					relToAbsMap[relPath] = absPath;
-				});
+	// Items are archived in the legacy file-per-item layout: restore
+	// extracts them as plain files, which the scoped storage imports the
+	// next time it is opened.
+	std::map<std::string, std::string> relToContentMap;
+
+	StreamElementsConfig::GetInstance()->GetScopedStorage()->Enumerate(
+		[&](const std::string &scope, const std::string &container,
+		    const std::string &item, const std::string &content) {
+			if (item.size() <= 5 ||
+			    item.compare(item.size() - 5, 5, ".json") != 0)
+				return;
+
+			// TODO: We should calculate this better
+			std::string relPath =
+				"plugin_config/obs-streamelements-core/scoped_config_storage/" +
+				scope + "/" + container + "/" + item;
+
+			relToContentMap[relPath] = content;
 		});
-	});
 
-	for (auto kv : relToAbsMap) {
+	for (auto kv : relToContentMap) {
 		auto relPath = kv.first;
-		auto absPath = kv.second;
 
-		char *buffer = os_quick_read_utf8_file(absPath.c_str());
 		CefRefPtr<CefValue> content = CefParseJSON(
-			CefString(buffer), JSON_PARSER_ALLOW_TRAILING_COMMAS);
-		bfree(buffer);
+			CefString(kv.second), JSON_PARSER_ALLOW_TRAILING_COMMAS);
 
 		if (!content.get() || content->GetType() == VTYPE_NULL)
 			return false;
 
-		std::map<std::string, std::string> filesMap;
-		CefRefPtr<CefValue> resultContent = CefValue::Create();
+		PendingBackupDocument document;
+		document.zipPath = relPath;
+		document.content = CefValue::Create();
 
-		if (!AddReferencedFilesToZip(zip, timestamp, content,
-					     resultContent))
+		if (!AddReferencedFilesToZip(zip, manifest, timestamp, content,
+					     document.filesMap,
+					     document.content))
 			return false;
 
-		std::string json =
-			CefWriteJSON(resultContent, JSON_WRITER_PRETTY_PRINT);
-
-		if (!AddBufferToZip(zip, (BYTE *)json.c_str(), json.size(),
-				    relPath))
-			return false;
+		documents.push_back(document);
 	}
 
 	return true;
@@ -840,14 +934,31 @@ void StreamElementsBackupManager::CreateLocalBackupPackage(
 	std::vector<std::string> requestCollections;
 	std::vector<std::string> requestProfiles;
 	bool includeReferencedFiles = true;
+	bool incremental = false;
+	bool resetIncrementalChain = false;
 
 	CefRefPtr<CefListValue> addedCollections = CefListValue::Create();
 	CefRefPtr<CefListValue> addedProfiles = CefListValue::Create();
 
+	StreamElementsParallelZipWriter::Options zipOptions;
+	zipOptions.level = ZIP_DEFAULT_COMPRESSION_LEVEL;
+
 	if (in->HasKey("includeReferencedFiles") &&
 	    in->GetType("includeReferencedFiles") == VTYPE_BOOL)
 		includeReferencedFiles = in->GetBool("includeReferencedFiles");
 
+	if (in->HasKey("incremental") && in->GetType("incremental") == VTYPE_BOOL)
+		incremental = in->GetBool("incremental");
+
+	if (in->HasKey("resetIncrementalChain") &&
+	    in->GetType("resetIncrementalChain") == VTYPE_BOOL)
+		resetIncrementalChain = in->GetBool("resetIncrementalChain");
+
+	if (in->HasKey("compressionLevel") &&
+	    in->GetType("compressionLevel") == VTYPE_INT)
+		zipOptions.level =
+			std::max(0, std::min(9, in->GetInt("compressionLevel")));
+
 	if (in->HasKey("sceneCollections") &&
 	    in->GetType("sceneCollections") == VTYPE_LIST) {
 		ReadListOfIdsFromCefValue(in->GetValue("sceneCollections"),
@@ -874,25 +985,83 @@ void StreamElementsBackupManager::CreateLocalBackupPackage(
 	std::string basePath = basePathPtr;
 	bfree(basePathPtr);
 
-	zip_t *zip = zip_open(backupPackagePath.c_str(), 9, 'w');
+	// Only referenced files are content-addressed; without them there is
+	// nothing for an incremental package to skip.
+	std::unique_ptr<StreamElementsBackupManifest> manifest;
 
-	if (!zip)
+	if (incremental && includeReferencedFiles) {
+		char *statePath = obs_module_config_path("backup_manifest.json");
+		manifest = std::make_unique<StreamElementsBackupManifest>(
+			statePath);
+		bfree(statePath);
+
+		if (!manifest->Load()) {
+			blog(LOG_WARNING,
+			     "obs-streamelements-core: backup: incremental backup state is unreadable, starting a new chain");
+		}
+
+		manifest->BeginPackage(CreateGloballyUniqueIdString(),
+				       resetIncrementalChain);
+	}
+
+	StreamElementsParallelZipWriter zipWriter(zipOptions);
+	StreamElementsParallelZipWriter *zip = &zipWriter;
+
+	if (!zip->Open(backupPackagePath))
 		return;
 
 	StreamElementsGlobalStateManager::GetInstance()
 		->GetCleanupManager()
 		->AddPath(backupPackagePath);
 
-	for (auto profile : requestProfiles) {
-		if (!AddProfileToZip(zip, basePath, profile))
-			continue;
+	// Runs on the writer thread; throttled so a package of thousands of
+	// small files does not turn into thousands of events.
+	auto lastProgressTime = std::chrono::steady_clock::now();
 
-		CefRefPtr<CefDictionaryValue> d = CefDictionaryValue::Create();
+	zip->SetProgressCallback(
+		[&lastProgressTime](
+			const StreamElementsParallelZipWriter::Stats &stats) {
+			auto now = std::chrono::steady_clock::now();
 
-		d->SetString("id", profile);
-		d->SetString("name", profile);
+			if (now - lastProgressTime <
+				    std::chrono::milliseconds(250) &&
+			    stats.entriesWritten + stats.entriesFailed <
+				    stats.entriesQueued)
+				return;
 
-		addedProfiles->SetDictionary(addedProfiles->GetSize(), d);
+			lastProgressTime = now;
+
+			CefRefPtr<CefDictionaryValue> d =
+				CefDictionaryValue::Create();
+
+			d->SetInt("entriesQueued", (int)stats.entriesQueued);
+			d->SetInt("entriesWritten", (int)stats.entriesWritten);
+			d->SetDouble("bytesIn", (double)stats.bytesIn);
+			d->SetDouble("bytesPerSecond",
+				     stats.GetBytesPerSecond());
+
+			CefRefPtr<CefValue> v = CefValue::Create();
+			v->SetDictionary(d);
+
+			DispatchJSEventGlobal(
+				"hostBackupPackageProgress",
+				CefWriteJSON(v, JSON_WRITER_DEFAULT).ToString());
+		});
+
+	// Profiles and collections which were queued, with the archive path
+	// of the file they cannot be restored without (if any).
+	std::vector<std::pair<std::string, std::string>> queuedProfiles;
+	std::vector<std::pair<std::string, std::string>> queuedCollections;
+
+	std::vector<PendingBackupDocument> documents;
+
+	for (auto profile : requestProfiles) {
+		std::string fileZipPath;
+
+		if (!AddProfileToZip(zip, basePath, profile, fileZipPath))
+			continue;
+
+		queuedProfiles.push_back({profile, fileZipPath});
 	}
 
 	char timestampBuf[16];
@@ -902,34 +1071,168 @@ void StreamElementsBackupManager::CreateLocalBackupPackage(
 	std::string timestamp = timestampBuf;
 
 	for (auto collection : requestCollections) {
-		if (!AddCollectionToZip(zip, basePath, collection,
-					includeReferencedFiles, timestamp))
+		std::string fileZipPath;
+
+		if (!AddCollectionToZip(zip, manifest.get(), basePath, collection,
+					includeReferencedFiles, timestamp,
+					documents, fileZipPath))
+			continue;
+
+		queuedCollections.push_back({collection, fileZipPath});
+	}
+
+	if (!AddScopedStorageToZip(zip, manifest.get(), timestamp, documents)) {
+		// NOP
+	}
+
+	// Everything read from disk is written or has failed by now: only
+	// report what made it into the package, and only reference files
+	// which did.
+	zip->Flush();
+
+	std::set<std::string> failedZipPaths;
+
+	for (auto &zipPath : zip->GetFailedEntries()) {
+		blog(LOG_WARNING,
+		     "obs-streamelements-core: backup: file could not be added to the package: %s",
+		     zipPath.c_str());
+
+		failedZipPaths.insert(zipPath);
+	}
+
+	for (auto &kv : queuedProfiles) {
+		if (failedZipPaths.count(kv.second))
 			continue;
 
 		CefRefPtr<CefDictionaryValue> d = CefDictionaryValue::Create();
 
-		d->SetString("id", collection);
-		d->SetString("name", collection);
+		d->SetString("id", kv.first);
+		d->SetString("name", kv.first);
+
+		addedProfiles->SetDictionary(addedProfiles->GetSize(), d);
+	}
+
+	for (auto &kv : queuedCollections) {
+		if (!kv.second.empty() && failedZipPaths.count(kv.second))
+			continue;
+
+		CefRefPtr<CefDictionaryValue> d = CefDictionaryValue::Create();
+
+		d->SetString("id", kv.first);
+		d->SetString("name", kv.first);
 
 		addedCollections->SetDictionary(addedCollections->GetSize(), d);
 	}
 
-	if (!AddScopedStorageToZip(zip, timestamp)) {
-		// NOP
+	for (auto &document : documents)
+		AddPendingDocumentToZip(zip, document, failedZipPaths);
+
+	if (manifest) {
+		zip->AddBuffer(manifest->GetPackageManifest().ToJson(),
+			       StreamElementsBackupManifest::MANIFEST_ZIP_PATH);
 	}
 
-	zip_close(zip);
+	if (!zip->Close()) {
+		blog(LOG_WARNING,
+		     "obs-streamelements-core: backup: one or more files could not be added to the package");
+	} else if (manifest) {
+		// Only a complete package may become part of the chain: a
+		// later package skipping files this one lacks could never be
+		// restored.
+		manifest->CommitPackage();
+
+		if (!manifest->Save()) {
+			blog(LOG_WARNING,
+			     "obs-streamelements-core: backup: failed saving incremental backup state");
+		}
+	}
+
+	auto stats = zip->GetStats();
+
+	blog(LOG_INFO,
+	     "obs-streamelements-core: backup: packaged %zu file(s), %zu stored without recompression, %.1f MB in %.2f s (%.1f MB/s) at level %d",
+	     stats.entriesWritten, stats.entriesStored,
+	     (double)stats.bytesIn / 1048576.0, stats.elapsedSeconds,
+	     stats.GetBytesPerSecond() / 1048576.0, zipOptions.level);
+
+	CefRefPtr<CefDictionaryValue> compression =
+		CefDictionaryValue::Create();
+
+	compression->SetInt("level", zipOptions.level);
+	compression->SetInt("entriesWritten", (int)stats.entriesWritten);
+	compression->SetInt("entriesStored", (int)stats.entriesStored);
+	compression->SetInt("entriesFailed", (int)stats.entriesFailed);
+	compression->SetDouble("bytesIn", (double)stats.bytesIn);
+	compression->SetDouble("bytesOut", (double)stats.bytesOut);
+	compression->SetDouble("elapsedSeconds", stats.elapsedSeconds);
+	compression->SetDouble("bytesPerSecond", stats.GetBytesPerSecond());
 
 	CefRefPtr<CefDictionaryValue> out = CefDictionaryValue::Create();
 
 	out->SetList("profiles", addedProfiles);
 	out->SetList("sceneCollections", addedCollections);
+	out->SetDictionary("compression", compression);
+
+	if (manifest) {
+		auto &package = manifest->GetPackageManifest();
+		auto &manifestStats = manifest->GetStats();
+
+		blog(LOG_INFO,
+		     "obs-streamelements-core: backup: incremental package %s: %zu referenced file(s) included (%.1f MB), %zu unchanged skipped (%.1f MB), %zu hashed",
+		     package.packageId.c_str(), manifestStats.filesIncluded,
+		     (double)manifestStats.bytesIncluded / 1048576.0,
+		     manifestStats.filesSkipped,
+		     (double)manifestStats.bytesSkipped / 1048576.0,
+		     manifestStats.filesHashed);
+
+		CefRefPtr<CefListValue> basePackageIds = CefListValue::Create();
+
+		for (auto &id : package.basePackageIds)
+			basePackageIds->SetString(basePackageIds->GetSize(), id);
+
+		CefRefPtr<CefDictionaryValue> d = CefDictionaryValue::Create();
+
+		d->SetString("packageId", package.packageId);
+		d->SetList("basePackageIds", basePackageIds);
+		d->SetInt("filesIncluded", (int)manifestStats.filesIncluded);
+		d->SetInt("filesSkipped", (int)manifestStats.filesSkipped);
+		d->SetDouble("bytesIncluded",
+			     (double)manifestStats.bytesIncluded);
+		d->SetDouble("bytesSkipped", (double)manifestStats.bytesSkipped);
+
+		out->SetDictionary("incremental", d);
+	}
 	out->SetString("url", CreateSessionSignedAbsolutePathURL(
 				      utf8_to_wstring(backupPackagePath)));
 
 	output->SetDictionary(out);
 }
 
+static bool
+ReadPackageManifest(zip_t *zip,
+		    StreamElementsBackupManifest::PackageManifest &result)
+{
+	if (0 != zip_entry_open(zip,
+				StreamElementsBackupManifest::MANIFEST_ZIP_PATH))
+		return false;
+
+	void *buf = nullptr;
+	size_t bufSize = 0;
+
+	bool success = false;
+
+	if (0 == zip_entry_read(zip, &buf, &bufSize)) {
+		success = StreamElementsBackupManifest::PackageManifest::FromJson(
+			std::string((const char *)buf, bufSize), result);
+
+		free(buf);
+	}
+
+	zip_entry_close(zip);
+
+	return success;
+}
+
 void StreamElementsBackupManager::QueryBackupPackageContent(
 	CefRefPtr<CefValue> input, CefRefPtr<CefValue> &output)
 {
@@ -967,25 +1270,32 @@ void StreamElementsBackupManager::QueryBackupPackageContent(
 
 		if (namePtr) {
 			std::string name = namePtr;
-
-			std::smatch match;
-
-			if (std::regex_search(
-				    name, match,
-				    std::regex(
-					    "^basic/profiles/(.+?)/basic.ini$"))) {
-				profiles[match[1].str()] = name;
-			} else if (std::regex_search(
-					   name, match,
-					   std::regex(
-						   "^basic/scenes/(.+?)\\.json$"))) {
-				collections[match[1].str()] = name;
+			std::string id;
+
+			switch (StreamElementsBackupManifest::ClassifyPackagePath(
+				name, id)) {
+			case StreamElementsBackupManifest::PackagePathKind::
+				Profile:
+				if (name == "basic/profiles/" + id + "/basic.ini")
+					profiles[id] = name;
+				break;
+
+			case StreamElementsBackupManifest::PackagePathKind::
+				SceneCollection:
+				collections[id] = name;
+				break;
+
+			default:
+				break;
 			}
 		}
 
 		zip_entry_close(zip);
 	}
 
+	StreamElementsBackupManifest::PackageManifest manifest;
+	const bool hasManifest = ReadPackageManifest(zip, manifest);
+
 	zip_close(zip);
 
 	CefRefPtr<CefListValue> profilesList = CefListValue::Create();
@@ -1016,6 +1326,18 @@ void StreamElementsBackupManager::QueryBackupPackageContent(
 	result->SetList("profiles", profilesList);
 	result->SetList("sceneCollections", collectionsList);
 
+	if (hasManifest) {
+		// Restoring an incremental package requires its base packages
+		// to be passed along as "basePackageUrls".
+		CefRefPtr<CefListValue> basePackageIds = CefListValue::Create();
+
+		for (auto &id : manifest.basePackageIds)
+			basePackageIds->SetString(basePackageIds->GetSize(), id);
+
+		result->SetString("packageId", manifest.packageId);
+		result->SetList("basePackageIds", basePackageIds);
+	}
+
 	output->SetDictionary(result);
 }
 
@@ -1024,47 +1346,43 @@ static bool IsQualifiedFileForRestore(
 	std::unordered_map<std::string, bool> &requestProfiles,
 	std::unordered_map<std::string, bool> &requestCollections)
 {
-	std::smatch match;
+	std::string id;
 
-	if (std::regex_search(zipPath, match,
-			      std::regex("^basic/profiles/(.+?)/"))) {
-		if (!requestProfiles.empty()) {
-			std::string id = match[1].str();
+	switch (StreamElementsBackupManifest::ClassifyPackagePath(zipPath, id)) {
+	case StreamElementsBackupManifest::PackagePathKind::Profile:
+		return requestProfiles.empty() || requestProfiles.count(id);
 
-			if (requestProfiles.count(id))
-				return true;
-			else
-				return false;
-		} else
-			return true;
-	} else if (std::regex_search(
-			   zipPath, match,
-			   std::regex("^basic/scenes/(.+?)\\.json$"))) {
-		if (!requestCollections.empty()) {
-			std::string id = match[1].str();
-
-			if (requestCollections.count(id))
-				return true;
-			else
-				return false;
-		} else
-			return true;
-	} else {
+	case StreamElementsBackupManifest::PackagePathKind::SceneCollection:
+		return requestCollections.empty() ||
+		       requestCollections.count(id);
+
+	default:
 		return true;
 	}
 }
 
-struct zip_extract_context_t {
-	int handle;
-};
-
-static size_t HandleZipExtract(void *arg, unsigned long long offset,
-			       const void *data, size_t size)
+static void DispatchRestoreProgressEvent(
+	const StreamElementsParallelZipExtractor::Stats &stats,
+	double scanSeconds, bool done)
 {
-	zip_extract_context_t *context = (zip_extract_context_t *)arg;
-
-	return ::write(context->handle, data, size);
-};
+	CefRefPtr<CefDictionaryValue> d = CefDictionaryValue::Create();
+
+	d->SetInt("entriesQueued", (int)stats.entriesQueued);
+	d->SetInt("entriesExtracted", (int)stats.entriesExtracted);
+	d->SetDouble("bytesQueued", (double)stats.bytesQueued);
+	d->SetDouble("bytesExtracted", (double)stats.bytesExtracted);
+	d->SetDouble("bytesPerSecond", stats.GetBytesPerSecond());
+	d->SetDouble("scanSeconds", scanSeconds);
+	d->SetDouble("extractSeconds", stats.extractSeconds);
+	d->SetDouble("commitSeconds", stats.commitSeconds);
+	d->SetBool("done", done);
+
+	CefRefPtr<CefValue> v = CefValue::Create();
+	v->SetDictionary(d);
+
+	DispatchJSEventGlobal("hostBackupRestoreProgress",
+			      CefWriteJSON(v, JSON_WRITER_DEFAULT).ToString());
+}
 
 void StreamElementsBackupManager::RestoreBackupPackageContent(
 	CefRefPtr<CefValue> input, CefRefPtr<CefValue> &output)
@@ -1147,86 +1465,111 @@ void StreamElementsBackupManager::RestoreBackupPackageContent(
 	if (!GetLocalPathFromURL(url, localPath))
 		return;
 
+	const auto scanStart = std::chrono::steady_clock::now();
+
 	zip_t *zip = zip_open(localPath.c_str(), 0, 'r');
 
 	if (!zip)
 		return;
 
+	// An incremental package only carries the files its base packages
+	// lack; resolve every other object up front so a missing base fails
+	// the restore before anything is overwritten.
+	StreamElementsBackupManifest::PackageManifest manifest;
+	std::vector<StreamElementsBackupManifest::PackageManifest> baseManifests;
+	std::vector<std::string> baseLocalPaths;
+	std::map<std::string, size_t> baseObjectSources;
+
 	bool success = true;
 
+	if (ReadPackageManifest(zip, manifest)) {
+		std::vector<std::string> baseUrls;
+
+		if (in->HasKey("basePackageUrls") &&
+		    in->GetType("basePackageUrls") == VTYPE_LIST) {
+			CefRefPtr<CefListValue> list =
+				in->GetList("basePackageUrls");
+
+			for (size_t index = 0; index < list->GetSize();
+			     ++index) {
+				if (list->GetType(index) == VTYPE_STRING)
+					baseUrls.push_back(
+						list->GetString(index)
+							.ToString());
+			}
+		}
+
+		for (auto baseUrl : baseUrls) {
+			std::string baseLocalPath;
+
+			if (!GetLocalPathFromURL(baseUrl, baseLocalPath))
+				continue;
+
+			zip_t *baseZip = zip_open(baseLocalPath.c_str(), 0, 'r');
+
+			if (!baseZip)
+				continue;
+
+			StreamElementsBackupManifest::PackageManifest
+				baseManifest;
+
+			if (ReadPackageManifest(baseZip, baseManifest)) {
+				baseManifests.push_back(baseManifest);
+				baseLocalPaths.push_back(baseLocalPath);
+			}
+
+			zip_close(baseZip);
+		}
+
+		std::vector<std::string> missing;
+
+		if (!StreamElementsBackupManifest::ResolveObjects(
+			    manifest, baseManifests, baseObjectSources,
+			    missing)) {
+			blog(LOG_WARNING,
+			     "obs-streamelements-core: restore: %zu file(s) of incremental package %s are missing from the base packages provided",
+			     missing.size(), manifest.packageId.c_str());
+
+			success = false;
+		}
+	}
+
+	// Entries are filtered here, on this thread, and extracted by the
+	// extractor's workers into temporary files which are only moved into
+	// place once every entry made it.
+	StreamElementsParallelZipExtractor extractor(
+		extractPath, StreamElementsParallelZipExtractor::Options());
+
+	size_t skippedEntries = 0;
+
 	for (int index = 0; index < zip_total_entries(zip) &&
 			    0 == zip_entry_openbyindex(zip, index) && success;
 	     ++index) {
 		const char *namePtr = zip_entry_name(zip);
 
-		if (namePtr) {
+		if (namePtr && !zip_entry_isdir(zip)) {
 			std::string name = namePtr;
 
-			if (!IsSafeFileExtension(name)) {
+			if (name == StreamElementsBackupManifest::
+					    MANIFEST_ZIP_PATH) {
+				/* Package metadata, not content */
+			} else if (!IsSafeFileExtension(name)) {
 				blog(LOG_WARNING,
 				     "obs-streamelements-core: restore: file skipped due to unsafe file type: %s",
 				     name.c_str());
+
+				++skippedEntries;
 			} else if (!IsQualifiedFileForRestore(
 					   name, requestProfiles,
 					   requestCollections)) {
+				++skippedEntries;
+			} else if (!extractor.Add(localPath, index, name,
+						  zip_entry_size(zip))) {
 				blog(LOG_WARNING,
-				     "obs-streamelements-core: restore: file skipped due to user selection: %s",
+				     "obs-streamelements-core: restore: file skipped due to unsafe path: %s",
 				     name.c_str());
-			} else {
-				std::string destFilePath =
-					extractPath + "/" + name;
-
-				std::string extractDirPath =
-					GetFolderPathFromFilePath(destFilePath);
 
-				/* Create output base directory & extract file */
-				if (MKDIR_ERROR ==
-				    os_mkdirs(extractDirPath.c_str())) {
-					/* Mkdir failed*/
-					success = false;
-				} else {
-					zip_extract_context_t context;
-
-#ifdef WIN32
-                    std::transform(
-                        destFilePath.begin(),
-                        destFilePath.end(),
-                        destFilePath.begin(),
-                        [](char ch) {
-                            if (ch == '/')
-                                return '\\';
-                            else
-                                return ch;
-                        });
-
-                    context.handle = _wopen(
-						utf8_to_wstring(destFilePath)
-							.c_str(),
-						O_WRONLY | O_CREAT |
-							O_BINARY,
-						S_IREAD | S_IWRITE);
-#else
-                    context.handle = ::open(
-                        destFilePath.c_str(),
-                        O_WRONLY | O_CREAT, S_IRUSR | S_IWUSR);
-#endif
-                    
-					if (-1 == context.handle) {
-						success = false;
-					} else {
-						if (0 !=
-						    zip_entry_extract(
-							    zip,
-							    HandleZipExtract,
-							    &context)) {
-							success = false;
-						} else {
-							/* Success */
-						}
-
-						::close(context.handle);
-					}
-				}
+				++skippedEntries;
 			}
 		}
 
@@ -1235,6 +1578,78 @@ void StreamElementsBackupManager::RestoreBackupPackageContent(
 
 	zip_close(zip);
 
+	for (size_t i = 0; i < baseLocalPaths.size() && success; ++i) {
+		zip_t *baseZip = zip_open(baseLocalPaths[i].c_str(), 0, 'r');
+
+		if (!baseZip) {
+			success = false;
+
+			break;
+		}
+
+		for (auto &kv : baseObjectSources) {
+			if (kv.second != i)
+				continue;
+
+			if (!IsSafeFileExtension(kv.first)) {
+				blog(LOG_WARNING,
+				     "obs-streamelements-core: restore: file skipped due to unsafe file type: %s",
+				     kv.first.c_str());
+
+				++skippedEntries;
+
+				continue;
+			}
+
+			if (0 != zip_entry_open(baseZip, kv.first.c_str())) {
+				success = false;
+
+				break;
+			}
+
+			extractor.Add(baseLocalPaths[i], zip_entry_index(baseZip),
+				      kv.first, zip_entry_size(baseZip));
+
+			zip_entry_close(baseZip);
+		}
+
+		zip_close(baseZip);
+	}
+
+	if (!success)
+		return;
+
+	if (skippedEntries) {
+		blog(LOG_INFO,
+		     "obs-streamelements-core: restore: %zu file(s) skipped due to user selection or file type",
+		     skippedEntries);
+	}
+
+	const double scanSeconds =
+		std::chrono::duration<double>(std::chrono::steady_clock::now() -
+					      scanStart)
+			.count();
+
+	extractor.SetProgressCallback(
+		[scanSeconds](
+			const StreamElementsParallelZipExtractor::Stats &stats) {
+			DispatchRestoreProgressEvent(stats, scanSeconds, false);
+		});
+
+	success = extractor.Run();
+
+	auto stats = extractor.GetStats();
+
+	DispatchRestoreProgressEvent(stats, scanSeconds, true);
+
+	blog(success ? LOG_INFO : LOG_WARNING,
+	     "obs-streamelements-core: restore: %s: %zu of %zu file(s), %.1f MB at %.1f MB/s; scan %.2f s, extract %.2f s, commit %.2f s",
+	     success ? "extracted" : "failed",
+	     stats.entriesExtracted, stats.entriesQueued,
+	     (double)stats.bytesExtracted / 1048576.0,
+	     stats.GetBytesPerSecond() / 1048576.0, scanSeconds,
+	     stats.extractSeconds, stats.commitSeconds);
+
 	if (!success)
 		return;
 
@@ -0,0 +1,538 @@
+#include "StreamElementsBackupManifest.hpp"
+
+#include "deps/picosha2/picosha2.h"
+#include "json11/json11.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+const char *const StreamElementsBackupManifest::MANIFEST_ZIP_PATH =
+	"obslive_backup_manifest.json";
+const char *const StreamElementsBackupManifest::OBJECTS_ZIP_FOLDER =
+	"obslive_restored_files/objects/";
+
+// 2: chain objects are keyed by archive path rather than by hash.
+static const int STATE_VERSION = 2;
+static const int MANIFEST_VERSION = 1;
+
+static const size_t HASH_CHUNK_SIZE = 1024 * 1024;
+
+// Longer "extensions" are more likely part of a file name than a type.
+static const size_t MAX_EXTENSION_LENGTH = 16;
+
+/* ================================================================= */
+
+static bool GetFileSizeAndTime(const std::string &path, uint64_t &size,
+			       int64_t &mtime)
+{
+	std::error_code ec;
+	const auto fsPath = std::filesystem::u8path(path);
+
+	const uintmax_t fileSize = std::filesystem::file_size(fsPath, ec);
+
+	if (ec)
+		return false;
+
+	const auto writeTime = std::filesystem::last_write_time(fsPath, ec);
+
+	if (ec)
+		return false;
+
+	size = (uint64_t)fileSize;
+	mtime = (int64_t)writeTime.time_since_epoch().count();
+
+	return true;
+}
+
+static bool IsValidHash(const std::string &hash)
+{
+	if (hash.size() != 64)
+		return false;
+
+	for (char ch : hash) {
+		if (!std::isxdigit((unsigned char)ch) ||
+		    std::isupper((unsigned char)ch))
+			return false;
+	}
+
+	return true;
+}
+
+static bool IsValidExtension(const std::string &ext)
+{
+	if (ext.size() <= 1 || ext.size() > MAX_EXTENSION_LENGTH || ext[0] != '.')
+		return false;
+
+	for (size_t i = 1; i < ext.size(); ++i) {
+		if (!std::isalnum((unsigned char)ext[i]) ||
+		    std::isupper((unsigned char)ext[i]))
+			return false;
+	}
+
+	return true;
+}
+
+// The exact shape GetObjectZipPath() produces: the objects folder, the hash
+// and an optional extension. With a non-empty `hash`, the hash must match.
+static bool IsValidObjectZipPath(const std::string &zipPath,
+				 const std::string &hash = "")
+{
+	const size_t folderLength =
+		strlen(StreamElementsBackupManifest::OBJECTS_ZIP_FOLDER);
+
+	if (zipPath.size() < folderLength + 64 ||
+	    zipPath.compare(0, folderLength,
+			    StreamElementsBackupManifest::OBJECTS_ZIP_FOLDER) !=
+		    0)
+		return false;
+
+	const std::string pathHash = zipPath.substr(folderLength, 64);
+	const std::string ext = zipPath.substr(folderLength + 64);
+
+	if (!IsValidHash(pathHash) || (!hash.empty() && pathHash != hash))
+		return false;
+
+	return ext.empty() || IsValidExtension(ext);
+}
+
+/* ================================================================= */
+
+std::string StreamElementsBackupManifest::PackageManifest::ToJson() const
+{
+	json11::Json::array bases;
+
+	for (auto &id : basePackageIds)
+		bases.push_back(id);
+
+	json11::Json::array items;
+
+	for (auto &object : objects) {
+		items.push_back(json11::Json::object{
+			{"path", object.zipPath},
+			{"hash", object.hash},
+			{"size", (double)object.size},
+			{"packageId", object.packageId}});
+	}
+
+	return json11::Json(json11::Json::object{{"version", MANIFEST_VERSION},
+						 {"packageId", packageId},
+						 {"basePackageIds", bases},
+						 {"objects", items}})
+		.dump();
+}
+
+bool StreamElementsBackupManifest::PackageManifest::FromJson(
+	const std::string &json, PackageManifest &result)
+{
+	std::string err;
+	json11::Json root = json11::Json::parse(json, err);
+
+	if (!err.empty() || !root.is_object() ||
+	    root["version"].int_value() != MANIFEST_VERSION ||
+	    !root["packageId"].is_string())
+		return false;
+
+	result = PackageManifest();
+	result.packageId = root["packageId"].string_value();
+
+	for (auto &id : root["basePackageIds"].array_items()) {
+		if (id.is_string())
+			result.basePackageIds.push_back(id.string_value());
+	}
+
+	for (auto &item : root["objects"].array_items()) {
+		Object object;
+
+		object.zipPath = item["path"].string_value();
+		object.hash = item["hash"].string_value();
+		object.size = (uint64_t)item["size"].number_value();
+		object.packageId = item["packageId"].string_value();
+
+		// Object paths end up on disk at restore: only accept the
+		// exact shape GetObjectZipPath() produces.
+		if (!IsValidHash(object.hash) || object.packageId.empty() ||
+		    !IsValidObjectZipPath(object.zipPath, object.hash))
+			return false;
+
+		result.objects.push_back(object);
+	}
+
+	return true;
+}
+
+/* ================================================================= */
+
+StreamElementsBackupManifest::StreamElementsBackupManifest(
+	std::string statePath)
+	: m_statePath(statePath)
+{
+}
+
+StreamElementsBackupManifest::~StreamElementsBackupManifest() {}
+
+bool StreamElementsBackupManifest::Load()
+{
+	m_chain.clear();
+	m_objects.clear();
+	m_files.clear();
+
+	std::ifstream in(std::filesystem::u8path(m_statePath),
+			 std::ios::binary);
+
+	if (!in)
+		return true; // no state yet: empty chain
+
+	std::stringstream buffer;
+	buffer << in.rdbuf();
+
+	std::string err;
+	json11::Json root = json11::Json::parse(buffer.str(), err);
+
+	if (!err.empty() || !root.is_object() ||
+	    root["version"].int_value() != STATE_VERSION)
+		return false;
+
+	for (auto &id : root["chain"].array_items())
+		m_chain.push_back(id.string_value());
+
+	for (auto &kv : root["objects"].object_items()) {
+		ChainObject object;
+
+		object.size = (uint64_t)kv.second["size"].number_value();
+		object.packageId = kv.second["packageId"].string_value();
+
+		if (IsValidObjectZipPath(kv.first))
+			m_objects[kv.first] = object;
+	}
+
+	for (auto &kv : root["files"].object_items()) {
+		FileState state;
+
+		state.size = (uint64_t)kv.second["size"].number_value();
+		// Not a time in any particular unit: only ever compared for
+		// equality with what the filesystem reports.
+		state.mtime = std::strtoll(
+			kv.second["mtime"].string_value().c_str(), nullptr, 10);
+		state.hash = kv.second["hash"].string_value();
+
+		if (IsValidHash(state.hash))
+			m_files[kv.first] = state;
+	}
+
+	return true;
+}
+
+bool StreamElementsBackupManifest::Save()
+{
+	json11::Json::array chain;
+
+	for (auto &id : m_chain)
+		chain.push_back(id);
+
+	json11::Json::object objects;
+
+	for (auto &kv : m_objects) {
+		objects[kv.first] = json11::Json::object{
+			{"size", (double)kv.second.size},
+			{"packageId", kv.second.packageId}};
+	}
+
+	json11::Json::object files;
+
+	for (auto &kv : m_files) {
+		files[kv.first] = json11::Json::object{
+			{"size", (double)kv.second.size},
+			{"mtime", std::to_string(kv.second.mtime)},
+			{"hash", kv.second.hash}};
+	}
+
+	const std::string json =
+		json11::Json(json11::Json::object{{"version", STATE_VERSION},
+						  {"chain", chain},
+						  {"objects", objects},
+						  {"files", files}})
+			.dump();
+
+	// Write-then-rename: a crash mid-save must not lose the chain, or
+	// the next incremental package would silently become a full one.
+	const auto path = std::filesystem::u8path(m_statePath);
+	auto tempPath = path;
+	tempPath += ".tmp";
+
+	{
+		std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+
+		if (!out)
+			return false;
+
+		out.write(json.data(), json.size());
+
+		if (!out.flush())
+			return false;
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(tempPath, path, ec);
+
+	return !ec;
+}
+
+/* ================================================================= */
+
+void StreamElementsBackupManifest::BeginPackage(std::string packageId,
+						bool resetChain)
+{
+	m_resetChain = resetChain || m_chain.empty();
+
+	m_package = PackageManifest();
+	m_package.packageId = packageId;
+
+	if (!m_resetChain)
+		m_package.basePackageIds = m_chain;
+
+	m_packageHashes.clear();
+	m_packagePaths.clear();
+	m_packageObjects.clear();
+
+	m_stats = Stats();
+}
+
+bool StreamElementsBackupManifest::AddFile(const std::string &localPath,
+					   std::string &zipPath,
+					   bool &include)
+{
+	include = false;
+
+	uint64_t size = 0;
+	int64_t mtime = 0;
+
+	if (!GetFileSizeAndTime(localPath, size, mtime))
+		return false;
+
+	std::string hash;
+
+	auto cached = m_files.find(localPath);
+
+	if (cached != m_files.end() && cached->second.size == size &&
+	    cached->second.mtime == mtime) {
+		hash = cached->second.hash;
+	} else {
+		if (!HashFile(localPath, hash, size))
+			return false;
+
+		++m_stats.filesHashed;
+		m_stats.bytesHashed += size;
+
+		FileState state;
+		state.size = size;
+		state.mtime = mtime;
+		state.hash = hash;
+
+		m_files[localPath] = state;
+	}
+
+	zipPath = GetObjectZipPath(localPath, hash);
+
+	m_packageHashes.insert(hash);
+
+	// Objects are keyed by their path rather than their hash: the same
+	// content under another extension is restored to another path, so it
+	// is another object.
+	if (m_packagePaths.count(zipPath)) {
+		// Referenced more than once: one copy per package is enough.
+		return true;
+	}
+
+	m_packagePaths.insert(zipPath);
+
+	Object object;
+	object.zipPath = zipPath;
+	object.hash = hash;
+	object.size = size;
+
+	auto held = m_objects.find(zipPath);
+
+	if (!m_resetChain && held != m_objects.end()) {
+		object.packageId = held->second.packageId;
+
+		++m_stats.filesSkipped;
+		m_stats.bytesSkipped += size;
+	} else {
+		object.packageId = m_package.packageId;
+
+		ChainObject chainObject;
+		chainObject.size = size;
+		chainObject.packageId = m_package.packageId;
+
+		m_packageObjects[zipPath] = chainObject;
+
+		include = true;
+
+		++m_stats.filesIncluded;
+		m_stats.bytesIncluded += size;
+	}
+
+	m_package.objects.push_back(object);
+
+	return true;
+}
+
+void StreamElementsBackupManifest::CommitPackage()
+{
+	if (m_resetChain) {
+		m_chain.clear();
+		m_objects.clear();
+	}
+
+	m_chain.push_back(m_package.packageId);
+
+	for (auto &kv : m_packageObjects)
+		m_objects[kv.first] = kv.second;
+
+	// Only keep hashes of files the latest package referenced; anything
+	// else would grow the state file forever.
+	std::map<std::string, FileState> files;
+
+	for (auto &kv : m_files) {
+		if (m_packageHashes.count(kv.second.hash))
+			files.insert(kv);
+	}
+
+	m_files.swap(files);
+
+	m_resetChain = false;
+	m_packageObjects.clear();
+}
+
+/* ================================================================= */
+
+bool StreamElementsBackupManifest::HashFile(const std::string &path,
+					    std::string &hash, uint64_t &size)
+{
+	std::ifstream in(std::filesystem::u8path(path), std::ios::binary);
+
+	if (!in)
+		return false;
+
+	picosha2::hash256_one_by_one hasher;
+	std::vector<char> buf(HASH_CHUNK_SIZE);
+
+	size = 0;
+
+	while (in) {
+		in.read(buf.data(), buf.size());
+
+		const size_t read = (size_t)in.gcount();
+
+		if (!read)
+			break;
+
+		hasher.process(buf.begin(), buf.begin() + read);
+		size += read;
+	}
+
+	if (in.bad())
+		return false;
+
+	hasher.finish();
+
+	hash = picosha2::get_hash_hex_string(hasher);
+
+	return true;
+}
+
+bool StreamElementsBackupManifest::ResolveObjects(
+	const PackageManifest &package,
+	const std::vector<PackageManifest> &bases,
+	std::map<std::string, size_t> &sources,
+	std::vector<std::string> &missing)
+{
+	std::map<std::string, size_t> basesById;
+
+	for (size_t i = 0; i < bases.size(); ++i)
+		basesById[bases[i].packageId] = i;
+
+	for (auto &object : package.objects) {
+		if (object.packageId == package.packageId)
+			continue;
+
+		auto base = basesById.find(object.packageId);
+
+		// The base must actually list the object as its own content,
+		// not merely reference it.
+		bool found = false;
+
+		if (base != basesById.end()) {
+			for (auto &held : bases[base->second].objects) {
+				if (held.zipPath == object.zipPath &&
+				    held.hash == object.hash &&
+				    held.packageId == object.packageId) {
+					found = true;
+
+					break;
+				}
+			}
+		}
+
+		if (found)
+			sources[object.zipPath] = base->second;
+		else
+			missing.push_back(object.zipPath);
+	}
+
+	return missing.empty();
+}
+
+StreamElementsBackupManifest::PackagePathKind
+StreamElementsBackupManifest::ClassifyPackagePath(const std::string &zipPath,
+						  std::string &id)
+{
+	static const std::string PROFILES_PREFIX = "basic/profiles/";
+	static const std::string SCENES_PREFIX = "basic/scenes/";
+	static const std::string SCENES_SUFFIX = ".json";
+
+	// basic/profiles/<id>/...
+	if (zipPath.compare(0, PROFILES_PREFIX.size(), PROFILES_PREFIX) == 0) {
+		const size_t end = zipPath.find('/', PROFILES_PREFIX.size());
+
+		if (end != std::string::npos && end > PROFILES_PREFIX.size()) {
+			id = zipPath.substr(PROFILES_PREFIX.size(),
+					    end - PROFILES_PREFIX.size());
+
+			return PackagePathKind::Profile;
+		}
+	}
+
+	// basic/scenes/<id>.json
+	if (zipPath.size() > SCENES_PREFIX.size() + SCENES_SUFFIX.size() &&
+	    zipPath.compare(0, SCENES_PREFIX.size(), SCENES_PREFIX) == 0 &&
+	    zipPath.compare(zipPath.size() - SCENES_SUFFIX.size(),
+			    SCENES_SUFFIX.size(), SCENES_SUFFIX) == 0) {
+		id = zipPath.substr(SCENES_PREFIX.size(),
+				    zipPath.size() - SCENES_PREFIX.size() -
+					    SCENES_SUFFIX.size());
+
+		return PackagePathKind::SceneCollection;
+	}
+
+	return PackagePathKind::Other;
+}
+
+std::string
+StreamElementsBackupManifest::GetObjectZipPath(const std::string &localPath,
+					       const std::string &hash)
+{
+	// Keep the extension: sources pick decoders by it.
+	std::string ext = std::filesystem::u8path(localPath).extension().u8string();
+
+	std::transform(ext.begin(), ext.end(), ext.begin(),
+		       [](unsigned char ch) { return (char)std::tolower(ch); });
+
+	return std::string(OBJECTS_ZIP_FOLDER) + hash +
+	       (IsValidExtension(ext) ? ext : "");
+}
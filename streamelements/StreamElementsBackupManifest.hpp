@@ -0,0 +1,146 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <cstdint>
+
+//
+// Content-addressed index behind incremental backup packages.
+//
+// A regular backup package carries a copy of every file the scene collections
+// and scoped storage reference, so consecutive backups of an unchanged setup
+// re-package the same media every time. In incremental mode referenced files
+// are archived under a path derived from their SHA-256 instead:
+//
+//	obslive_restored_files/objects/<sha256><ext>
+//
+// and a package only carries objects that no earlier package of the same
+// chain already holds. An object is identified by that path, so the same
+// content under two extensions is two objects. Every package embeds a
+// manifest (MANIFEST_ZIP_PATH) listing all the objects it references and
+// which package of the chain holds each of them, so a restore can rebuild the
+// full tree from the package plus its base packages.
+//
+// It also owns the package layout both backup and restore rely on; see
+// ClassifyPackagePath().
+//
+// Local state -- the chain, the objects it holds and a size/mtime-keyed cache
+// of file hashes, so unchanged files are not re-read -- persists in a JSON file
+// next to the other module config files.
+//
+class StreamElementsBackupManifest {
+public:
+	static const char *const MANIFEST_ZIP_PATH;
+	static const char *const OBJECTS_ZIP_FOLDER;
+
+	struct Object {
+		std::string zipPath;
+		std::string hash;
+		uint64_t size = 0;
+		// Package of the chain which carries the object's content.
+		std::string packageId;
+	};
+
+	struct PackageManifest {
+		std::string packageId;
+		// Packages this one depends on, oldest first.
+		std::vector<std::string> basePackageIds;
+		std::vector<Object> objects;
+
+		std::string ToJson() const;
+		static bool FromJson(const std::string &json,
+				     PackageManifest &result);
+	};
+
+	enum class PackagePathKind { Other, Profile, SceneCollection };
+
+	struct Stats {
+		size_t filesIncluded = 0;
+		size_t filesSkipped = 0;
+		uint64_t bytesIncluded = 0;
+		uint64_t bytesSkipped = 0;
+
+		// Files whose hash could not be taken from the cache.
+		size_t filesHashed = 0;
+		uint64_t bytesHashed = 0;
+	};
+
+public:
+	StreamElementsBackupManifest(std::string statePath);
+	~StreamElementsBackupManifest();
+
+	// Loads local state. A missing state file is an empty chain; a
+	// corrupt one is discarded, which makes the next package a full one.
+	bool Load();
+	bool Save();
+
+	// Starts a package. With `resetChain`, or when there is no chain yet,
+	// the package becomes the base of a new chain and carries every file.
+	void BeginPackage(std::string packageId, bool resetChain);
+
+	// Resolves the archive path of `localPath`. `include` is set when the
+	// content is not held by the chain yet and has to be added to the
+	// package being built. Returns false if the file cannot be read.
+	bool AddFile(const std::string &localPath, std::string &zipPath,
+		     bool &include);
+
+	// Appends the package to the chain. Call only once the package has
+	// been written successfully; an uncommitted package leaves the chain
+	// as it was, so its files are included again next time.
+	void CommitPackage();
+
+	const PackageManifest &GetPackageManifest() const { return m_package; }
+	const Stats &GetStats() const { return m_stats; }
+	const std::vector<std::string> &GetChain() const { return m_chain; }
+
+	// SHA-256 of a file's content, as lower case hex.
+	static bool HashFile(const std::string &path, std::string &hash,
+			     uint64_t &size);
+
+	// Classifies an archive path of a backup package, setting `id` to
+	// the profile or scene collection it belongs to. Plain string
+	// matching: restore runs this for every entry of the package.
+	static PackagePathKind ClassifyPackagePath(const std::string &zipPath,
+						   std::string &id);
+
+	// Maps every object of `package` carried by another package to the
+	// index in `bases` of the package holding it. Objects none of the
+	// bases hold are reported in `missing`. Returns missing.empty().
+	static bool ResolveObjects(const PackageManifest &package,
+				   const std::vector<PackageManifest> &bases,
+				   std::map<std::string, size_t> &sources,
+				   std::vector<std::string> &missing);
+
+private:
+	struct FileState {
+		uint64_t size = 0;
+		int64_t mtime = 0;
+		std::string hash;
+	};
+
+	struct ChainObject {
+		uint64_t size = 0;
+		std::string packageId;
+	};
+
+	static std::string GetObjectZipPath(const std::string &localPath,
+					    const std::string &hash);
+
+private:
+	std::string m_statePath;
+
+	std::vector<std::string> m_chain;
+	// By object archive path
+	std::map<std::string, ChainObject> m_objects;
+	std::map<std::string, FileState> m_files;
+
+	PackageManifest m_package;
+	std::set<std::string> m_packageHashes;
+	std::set<std::string> m_packagePaths;
+	std::map<std::string, ChainObject> m_packageObjects;
+	bool m_resetChain = false;
+
+	Stats m_stats;
+};
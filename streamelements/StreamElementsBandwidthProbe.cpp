@@ -0,0 +1,348 @@
+#include "StreamElementsBandwidthProbe.hpp"
+
+#define ASIO_STANDALONE
+#include <asio.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+
+// C0 (protocol version) followed by C1 (time, zero, random bytes).
+static const size_t RTMP_HANDSHAKE_PACKET_SIZE = 1 + 1536;
+static const unsigned char RTMP_PROTOCOL_VERSION = 3;
+
+/* ================================================================= */
+
+bool StreamElementsBandwidthProbe::ParseIngestUrl(const std::string &url,
+						  std::string &host,
+						  std::string &port,
+						  bool &rtmpHandshake)
+{
+	const size_t schemeEnd = url.find("://");
+
+	if (schemeEnd == std::string::npos)
+		return false;
+
+	std::string scheme = url.substr(0, schemeEnd);
+	std::transform(scheme.begin(), scheme.end(), scheme.begin(),
+		       [](unsigned char c) { return (char)std::tolower(c); });
+
+	rtmpHandshake = scheme == "rtmp";
+	port = scheme == "rtmps" ? "443" : "1935";
+
+	const size_t authorityStart = schemeEnd + 3;
+	size_t authorityEnd = url.find_first_of("/?#", authorityStart);
+
+	if (authorityEnd == std::string::npos)
+		authorityEnd = url.size();
+
+	std::string authority =
+		url.substr(authorityStart, authorityEnd - authorityStart);
+
+	const size_t at = authority.rfind('@');
+
+	if (at != std::string::npos)
+		authority = authority.substr(at + 1);
+
+	size_t portStart = std::string::npos;
+
+	if (!authority.empty() && authority[0] == '[') {
+		// [IPv6]:port
+		const size_t close = authority.find(']');
+
+		if (close == std::string::npos)
+			return false;
+
+		host = authority.substr(1, close - 1);
+
+		if (close + 1 < authority.size()) {
+			if (authority[close + 1] != ':')
+				return false;
+
+			portStart = close + 2;
+		}
+	} else {
+		const size_t colon = authority.find(':');
+
+		host = authority.substr(0, colon);
+
+		if (colon != std::string::npos)
+			portStart = colon + 1;
+	}
+
+	if (portStart != std::string::npos) {
+		port = authority.substr(portStart);
+
+		if (port.empty() ||
+		    port.find_first_not_of("0123456789") != std::string::npos)
+			return false;
+	}
+
+	return !host.empty();
+}
+
+/* ================================================================= */
+
+namespace {
+
+struct probe_t {
+	probe_t(asio::io_context &io) : resolver(io), socket(io) {}
+
+	asio::ip::tcp::resolver resolver;
+	asio::ip::tcp::socket socket;
+
+	std::string host;
+	std::string port;
+	bool rtmpHandshake = false;
+
+	// Unspecified: not bound.
+	asio::ip::address bindAddress;
+
+	std::array<unsigned char, RTMP_HANDSHAKE_PACKET_SIZE> packet;
+	std::chrono::steady_clock::time_point start;
+
+	StreamElementsBandwidthProbe::RttResult result;
+};
+
+typedef std::chrono::microseconds usec_t;
+
+static usec_t ElapsedSince(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration_cast<usec_t>(
+		std::chrono::steady_clock::now() - start);
+}
+
+static void BeginHandshake(probe_t *probe)
+{
+	// C0+C1. The server echoes C1 in S2 only, which is not waited for:
+	// S0+S1 alone complete the round trip.
+	std::mt19937 random((unsigned int)std::random_device()());
+
+	probe->packet.fill(0);
+	probe->packet[0] = RTMP_PROTOCOL_VERSION;
+
+	for (size_t i = 9; i < probe->packet.size(); ++i)
+		probe->packet[i] = (unsigned char)random();
+
+	probe->start = std::chrono::steady_clock::now();
+
+	asio::async_write(
+		probe->socket, asio::buffer(probe->packet),
+		[probe](const asio::error_code &ec, size_t) {
+			if (ec)
+				return;
+
+			asio::async_read(
+				probe->socket, asio::buffer(probe->packet),
+				[probe](const asio::error_code &ec, size_t) {
+					if (ec || probe->packet[0] !=
+							  RTMP_PROTOCOL_VERSION)
+						return;
+
+					probe->result.handshakeTime =
+						ElapsedSince(probe->start);
+					probe->result.reachable = true;
+
+					asio::error_code ignored;
+					probe->socket.close(ignored);
+				});
+		});
+}
+
+static void BeginProbe(probe_t *probe)
+{
+	probe->resolver.async_resolve(
+		probe->host, probe->port,
+		[probe](const asio::error_code &ec,
+			asio::ip::tcp::resolver::results_type endpoints) {
+			if (ec)
+				return;
+
+			auto onConnect = [probe](const asio::error_code &ec) {
+				if (ec)
+					return;
+
+				probe->result.connectTime =
+					ElapsedSince(probe->start);
+
+				if (probe->rtmpHandshake) {
+					BeginHandshake(probe);
+				} else {
+					probe->result.reachable = true;
+
+					asio::error_code ignored;
+					probe->socket.close(ignored);
+				}
+			};
+
+			if (probe->bindAddress.is_unspecified()) {
+				// Name resolution is not part of the round
+				// trip.
+				probe->start = std::chrono::steady_clock::now();
+
+				asio::async_connect(
+					probe->socket, endpoints,
+					[onConnect](const asio::error_code &ec,
+						    const asio::ip::tcp::endpoint
+							    &) { onConnect(ec); });
+
+				return;
+			}
+
+			// async_connect() reopens the socket for every
+			// endpoint it tries, which would drop the binding:
+			// connect to the first endpoint of the bound family.
+			for (auto &entry : endpoints) {
+				const auto endpoint = entry.endpoint();
+
+				if (endpoint.address().is_v4() !=
+				    probe->bindAddress.is_v4())
+					continue;
+
+				asio::error_code ec;
+
+				probe->socket.open(endpoint.protocol(), ec);
+
+				if (!ec)
+					probe->socket.bind(
+						asio::ip::tcp::endpoint(
+							probe->bindAddress, 0),
+						ec);
+
+				if (ec)
+					return;
+
+				probe->start = std::chrono::steady_clock::now();
+
+				probe->socket.async_connect(endpoint, onConnect);
+
+				return;
+			}
+		});
+}
+
+}
+
+std::vector<StreamElementsBandwidthProbe::RttResult>
+StreamElementsBandwidthProbe::MeasureRtt(const std::vector<std::string> &urls,
+					 std::chrono::milliseconds timeout,
+					 const std::string &bindAddress)
+{
+	asio::ip::address bindTo;
+
+	if (!bindAddress.empty() && bindAddress != "default") {
+		asio::error_code ec;
+
+		bindTo = asio::ip::make_address(bindAddress, ec);
+
+		// Not an address: connect unbound, as the output would.
+		if (ec)
+			bindTo = asio::ip::address();
+	}
+
+	// One thread drives every probe; the io_context outlives the sockets.
+	asio::io_context io;
+
+	std::vector<std::unique_ptr<probe_t>> probes;
+
+	for (auto &url : urls) {
+		probes.emplace_back(std::make_unique<probe_t>(io));
+
+		probe_t *probe = probes.back().get();
+
+		probe->bindAddress = bindTo;
+
+		if (ParseIngestUrl(url, probe->host, probe->port,
+				   probe->rtmpHandshake))
+			BeginProbe(probe);
+	}
+
+	// Returns early once every probe has completed or failed. Whatever is
+	// still outstanding at the deadline is unreachable.
+	io.run_for(timeout);
+
+	std::vector<RttResult> results;
+
+	for (auto &probe : probes)
+		results.push_back(probe->result);
+
+	return results;
+}
+
+std::vector<size_t>
+StreamElementsBandwidthProbe::Rank(const std::vector<RttResult> &results,
+				   size_t maxCount)
+{
+	std::vector<size_t> indices;
+
+	for (size_t i = 0; i < results.size(); ++i) {
+		if (results[i].reachable)
+			indices.push_back(i);
+	}
+
+	std::stable_sort(indices.begin(), indices.end(),
+			 [&](size_t a, size_t b) {
+				 return results[a].GetRoundTripTime() <
+					results[b].GetRoundTripTime();
+			 });
+
+	// Nothing answered: the pre-screen tells nothing, so it rules nothing
+	// out.
+	if (indices.empty()) {
+		for (size_t i = 0; i < results.size(); ++i)
+			indices.push_back(i);
+	}
+
+	if (maxCount && indices.size() > maxCount)
+		indices.resize(maxCount);
+
+	return indices;
+}
+
+void StreamElementsBandwidthProbe::RunTests(const std::vector<size_t> &indices,
+					    size_t concurrency, test_t test)
+{
+	std::mutex mutex;
+	size_t next = 0;
+	bool stopped = false;
+
+	auto worker = [&]() {
+		for (;;) {
+			size_t index;
+
+			{
+				std::lock_guard<std::mutex> guard(mutex);
+
+				if (stopped || next >= indices.size())
+					return;
+
+				index = indices[next++];
+			}
+
+			if (!test(index)) {
+				std::lock_guard<std::mutex> guard(mutex);
+
+				stopped = true;
+			}
+		}
+	};
+
+	const size_t workerCount =
+		std::min(std::max<size_t>(concurrency, 1), indices.size());
+
+	std::vector<std::thread> workers;
+
+	// The calling thread is one of the workers.
+	for (size_t i = 1; i < workerCount; ++i)
+		workers.emplace_back(worker);
+
+	if (workerCount)
+		worker();
+
+	for (auto &thread : workers)
+		thread.join();
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <functional>
+
+//
+// Two-phase ingest server selection for bandwidth tests.
+//
+// A full throughput test builds encoders, an RTMP service and an output and
+// warms up for seconds before it measures anything, so testing every ingest
+// server one after another takes minutes. Most candidates can be ruled out
+// far more cheaply:
+//
+// 1. MeasureRtt() opens a TCP connection to every candidate at once, from
+//    the address the test will stream from, and for rtmp:// URLs exchanges
+//    the first leg of the RTMP handshake (C0+C1 for S0+S1). Candidates which
+//    do not answer within the timeout are unreachable.
+//
+// 2. Rank() keeps the reachable candidates, lowest round trip first, and
+//    RunTests() runs the full throughput test on those only, at most
+//    `concurrency` at a time. Each test reports its own result as soon as it
+//    finishes. When no candidate answers at all -- probes blocked by a
+//    firewall which lets the stream through, say -- every candidate is tested
+//    as if there had been no pre-screen.
+//
+class StreamElementsBandwidthProbe {
+public:
+	struct Options {
+		// Deadline of the whole RTT phase.
+		std::chrono::milliseconds rttTimeout =
+			std::chrono::milliseconds(2000);
+
+		// Candidates which get a full throughput test, lowest round
+		// trip first; 0 tests every reachable candidate.
+		size_t maxServersToTest = 0;
+
+		// Throughput tests running at once. They share the uplink they
+		// measure, so more than one trades accuracy for time.
+		size_t maxConcurrentTests = 1;
+	};
+
+	struct RttResult {
+		bool reachable = false;
+
+		std::chrono::microseconds connectTime{0};
+		// Zero when no RTMP handshake was attempted.
+		std::chrono::microseconds handshakeTime{0};
+
+		std::chrono::microseconds GetRoundTripTime() const
+		{
+			return connectTime + handshakeTime;
+		}
+	};
+
+	// Runs the throughput test of candidate `index`. Returns false to
+	// start no further tests (e.g. when cancelled).
+	typedef std::function<bool(size_t index)> test_t;
+
+public:
+	// Splits an ingest URL into host and port. `rtmpHandshake` is set for
+	// plain rtmp:// URLs, whose handshake can be started without TLS.
+	static bool ParseIngestUrl(const std::string &url, std::string &host,
+				   std::string &port, bool &rtmpHandshake);
+
+	// Probes every URL in parallel. Results are in the order of `urls`.
+	// Connections are made from `bindAddress` unless it is empty or
+	// "default", like the bind_ip setting of an RTMP output.
+	static std::vector<RttResult>
+	MeasureRtt(const std::vector<std::string> &urls,
+		   std::chrono::milliseconds timeout,
+		   const std::string &bindAddress = "");
+
+	// Indices of the reachable candidates, lowest round trip first, at
+	// most `maxCount` of them (0 for all). When none is reachable, the
+	// first `maxCount` of every candidate, in their original order.
+	static std::vector<size_t> Rank(const std::vector<RttResult> &results,
+					size_t maxCount);
+
+	// Calls `test` for every index, in order, at most `concurrency` at a
+	// time. Returns once every started test has finished.
+	static void RunTests(const std::vector<size_t> &indices,
+			     size_t concurrency, test_t test);
+};
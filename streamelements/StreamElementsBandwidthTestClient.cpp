@@ -1,4 +1,5 @@
 #include "StreamElementsBandwidthTestClient.hpp"
+#include "StreamElementsSyntheticBandwidthEncoders.hpp"
 #include "SETrace.hpp"
 
 #include <thread>
@@ -6,7 +7,6 @@
 StreamElementsBandwidthTestClient::StreamElementsBandwidthTestClient()
 	//: m_taskQueue("StreamElementsBandwidthTestClient task queue")
 {
-	os_event_init(&m_event_state_changed, OS_EVENT_TYPE_AUTO);
 	os_event_init(&m_event_async_done, OS_EVENT_TYPE_MANUAL);
 
 	// Initially done
@@ -19,7 +19,6 @@ StreamElementsBandwidthTestClient::~StreamElementsBandwidthTestClient()
 	CancelAll();
 
 	os_event_destroy(m_event_async_done);
-	os_event_destroy(m_event_state_changed);
 }
 
 void StreamElementsBandwidthTestClient::TestServerBitsPerSecond(
@@ -31,16 +30,34 @@ void StreamElementsBandwidthTestClient::TestServerBitsPerSecond(
 	const bool useAuth,
 	const char* const authUsername,
 	const char* const authPassword,
+	const bool syntheticPayload,
 	StreamElementsBandwidthTestClient::Result* result)
 {
 	result->serverUrl = serverUrl;
 	result->streamKey = streamKey;
 
-	m_state = Running;
-	os_event_reset(m_event_state_changed);
+	TestState state;
 
-	obs_encoder_t* vencoder = SETRACE_ADDREF(obs_video_encoder_create("obs_x264", "test_x264", nullptr, nullptr));
-	obs_encoder_t* aencoder = SETRACE_ADDREF(obs_audio_encoder_create("ffmpeg_aac", "test_aac", nullptr, 0, nullptr));
+	{
+		std::lock_guard<std::mutex> guard(m_active_tests_mutex);
+
+		if (m_cancelled) {
+			result->cancelled = true;
+
+			return;
+		}
+
+		m_active_tests.insert(&state);
+	}
+
+	// The synthetic encoders take the same settings, without encoding
+	// anything.
+	obs_encoder_t* vencoder = SETRACE_ADDREF(syntheticPayload
+		? obs_video_encoder_create(SYNTHETIC_BANDWIDTH_VIDEO_ENCODER_ID, "test_synthetic_h264", nullptr, nullptr)
+		: obs_video_encoder_create("obs_x264", "test_x264", nullptr, nullptr));
+	obs_encoder_t* aencoder = SETRACE_ADDREF(syntheticPayload
+		? obs_audio_encoder_create(SYNTHETIC_BANDWIDTH_AUDIO_ENCODER_ID, "test_synthetic_aac", nullptr, 0, nullptr)
+		: obs_audio_encoder_create("ffmpeg_aac", "test_aac", nullptr, 0, nullptr));
 	obs_service_t* service = SETRACE_ADDREF(obs_service_create("rtmp_custom", "test_service", nullptr, nullptr));
 
 	obs_data_t* service_settings = SETRACE_ADDREF(obs_data_create());
@@ -106,35 +123,35 @@ void StreamElementsBandwidthTestClient::TestServerBitsPerSecond(
 
 	auto on_started = [](void* data, calldata_t*)
 	{
-		StreamElementsBandwidthTestClient* self = (StreamElementsBandwidthTestClient*)data;
+		TestState* state = (TestState*)data;
 
-		self->set_state(Running);
+		state->set_state(Running);
 	};
 
 	auto on_stopped = [](void* data, calldata_t*)
 	{
-		StreamElementsBandwidthTestClient* self = (StreamElementsBandwidthTestClient*)data;
+		TestState* state = (TestState*)data;
 
-		self->set_state(Stopped);
+		state->set_state(Stopped);
 	};
 
 	signal_handler *output_signal_handler = obs_output_get_signal_handler(output);
-	signal_handler_connect(output_signal_handler, "start", on_started, this);
-	signal_handler_connect(output_signal_handler, "stop", on_stopped, this);
+	signal_handler_connect(output_signal_handler, "start", on_started, &state);
+	signal_handler_connect(output_signal_handler, "stop", on_stopped, &state);
 
 	// Start testing
 
 	if (obs_output_start(output))
 	{
-		wait_state_changed();
+		state.wait_state_changed();
 
-		if (m_state == Running)
+		if (state.get_state() == Running)
 		{
 			// ignore first WARMUP_DURATION_MS due to possible buffering skewing
 			// the result
-			wait_state_changed(WARMUP_DURATION_MS);
+			state.wait_state_changed(WARMUP_DURATION_MS);
 
-			if (m_state == Running)
+			if (state.get_state() == Running)
 			{
 				// Test bandwidth
 
@@ -142,15 +159,15 @@ void StreamElementsBandwidthTestClient::TestServerBitsPerSecond(
 				uint64_t start_bytes = obs_output_get_total_bytes(output);
 				uint64_t start_time_ns = os_gettime_ns();
 
-				wait_state_changed((unsigned long)durationSeconds * 1000L);
+				state.wait_state_changed((unsigned long)durationSeconds * 1000L);
 
-				if (m_state == Running)
+				if (state.get_state() == Running)
 				{
 					// Still running
 					obs_output_stop(output);
 
 					// Wait for stopped
-					wait_state_changed();
+					state.wait_state_changed();
 
 					// Get end metrics
 					uint64_t end_bytes = obs_output_get_total_bytes(output);
@@ -191,17 +208,23 @@ void StreamElementsBandwidthTestClient::TestServerBitsPerSecond(
 
 	if (!result->success)
 	{
-		if (m_state == Cancelled) {
+		if (state.get_state() == Cancelled) {
 			result->cancelled = true;
 
 			obs_output_force_stop(output);
 
-			wait_state_changed();
+			state.wait_state_changed();
 		}
 	}
 
-	signal_handler_disconnect(output_signal_handler, "start", on_started, this);
-	signal_handler_disconnect(output_signal_handler, "stop", on_stopped, this);
+	signal_handler_disconnect(output_signal_handler, "start", on_started, &state);
+	signal_handler_disconnect(output_signal_handler, "stop", on_stopped, &state);
+
+	{
+		std::lock_guard<std::mutex> guard(m_active_tests_mutex);
+
+		m_active_tests.erase(&state);
+	}
 
 	///
 	// This part is copied as-is with minor modifications from
@@ -251,6 +274,8 @@ void StreamElementsBandwidthTestClient::TestServerBitsPerSecondAsync(
 	// Not done
 	os_event_reset(m_event_async_done);
 
+	m_cancelled = false;
+
 	struct local_context {
 		StreamElementsBandwidthTestClient* self = nullptr;
 		std::string serverUrl;
@@ -297,6 +322,7 @@ void StreamElementsBandwidthTestClient::TestServerBitsPerSecondAsync(
 			context->useAuth,
 			context->authUsername.c_str(),
 			context->authPassword.c_str(),
+			false,
 			&result);
 
 		context->callback(&result, context->data);
@@ -312,7 +338,14 @@ void StreamElementsBandwidthTestClient::TestServerBitsPerSecondAsync(
 
 void StreamElementsBandwidthTestClient::CancelAll()
 {
-	set_state(Cancelled);
+	{
+		std::lock_guard<std::mutex> guard(m_active_tests_mutex);
+
+		m_cancelled = true;
+
+		for (auto state : m_active_tests)
+			state->set_state(Cancelled);
+	}
 
 	if (m_async_busy) {
 		os_event_wait(m_event_async_done);
@@ -324,10 +357,17 @@ void StreamElementsBandwidthTestClient::TestMultipleServersBitsPerSecondAsync(
 	const uint64_t maxBitrateBitsPerSecond,
 	const char* const bindToIP,
 	const int durationSeconds,
+	const StreamElementsBandwidthProbe::Options probeOptions,
+	const bool syntheticPayload,
 	const TestMultipleServersBitsPerSecondAsyncCallback progress_callback,
 	const TestMultipleServersBitsPerSecondAsyncCallback callback,
 	void* const data)
 {
+	// Not done
+	os_event_reset(m_event_async_done);
+
+	m_cancelled = false;
+
 	struct local_context {
 		StreamElementsBandwidthTestClient* self = nullptr;
 		TestMultipleServersBitsPerSecondAsyncCallback callback = nullptr;
@@ -338,6 +378,8 @@ void StreamElementsBandwidthTestClient::TestMultipleServersBitsPerSecondAsync(
 		uint64_t maxBitrateBitsPerSecond = 0;
 		std::string bindToIP;
 		int durationSeconds = 0;
+		StreamElementsBandwidthProbe::Options probeOptions;
+		bool syntheticPayload = false;
 	};
 
 	local_context* context = new local_context();
@@ -353,38 +395,68 @@ void StreamElementsBandwidthTestClient::TestMultipleServersBitsPerSecondAsync(
 
 	context->maxBitrateBitsPerSecond = maxBitrateBitsPerSecond;
 	context->durationSeconds = durationSeconds;
+	context->probeOptions = probeOptions;
+	context->syntheticPayload = syntheticPayload;
 
 	context->self->m_async_busy = true;
 
 	std::thread worker = std::thread([=]() {
-		for (size_t i = 0; i < context->servers.size(); ++i) {
-			Result testResult;
-
-			TestServerBitsPerSecond(
-				context->servers[i].url.c_str(),
-				context->servers[i].streamKey.c_str(),
-				context->maxBitrateBitsPerSecond,
-				context->bindToIP.empty() ? nullptr : context->bindToIP.c_str(),
-				context->durationSeconds,
-				false,
-				nullptr,
-				nullptr,
-				&testResult);
-
-			if (testResult.cancelled)
-				break;
-
-			context->results.push_back(testResult);
-
-			if (progress_callback) {
-				progress_callback(&context->results, context->data);
-			}
-		}
+		// Phase 1: round trip to every server, in parallel
+		std::vector<std::string> urls;
+
+		for (auto& server : context->servers)
+			urls.push_back(server.url);
+
+		const auto rtt = StreamElementsBandwidthProbe::MeasureRtt(
+			urls, context->probeOptions.rttTimeout, context->bindToIP);
+
+		const auto selected = StreamElementsBandwidthProbe::Rank(
+			rtt, context->probeOptions.maxServersToTest);
+
+		// Phase 2: throughput of the best servers only
+		std::mutex resultsMutex;
+
+		StreamElementsBandwidthProbe::RunTests(
+			selected, context->probeOptions.maxConcurrentTests,
+			[&](size_t index) {
+				Result testResult;
+
+				TestServerBitsPerSecond(
+					context->servers[index].url.c_str(),
+					context->servers[index].streamKey.c_str(),
+					context->maxBitrateBitsPerSecond,
+					context->bindToIP.empty() ? nullptr : context->bindToIP.c_str(),
+					context->durationSeconds,
+					false,
+					nullptr,
+					nullptr,
+					context->syntheticPayload,
+					&testResult);
+
+				if (testResult.cancelled)
+					return false;
+
+				std::lock_guard<std::mutex> guard(resultsMutex);
+
+				context->results.push_back(testResult);
+
+				if (progress_callback) {
+					progress_callback(&context->results, context->data);
+				}
+
+				return true;
+			});
+
+		blog(LOG_INFO,
+		     "obs-streamelements-core: bandwidth test: %zu of %zu servers tested after round trip pre-screen",
+		     selected.size(), context->servers.size());
 
 		context->callback(&context->results, context->data);
 
 		context->self->m_async_busy = false;
 
+		os_event_signal(context->self->m_event_async_done);
+
 		delete context;
 	});
 
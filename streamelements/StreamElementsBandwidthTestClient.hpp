@@ -1,9 +1,13 @@
 #pragma once
 
 #include "StreamElementsAsyncTaskQueue.hpp"
+#include "StreamElementsBandwidthProbe.hpp"
 
 #include <string>
 #include <vector>
+#include <set>
+#include <mutex>
+#include <atomic>
 
 #include <obs.h>
 #include <util/platform.h>
@@ -71,16 +75,31 @@ private:
 		Cancelled = 2
 	};
 
-	os_event_t* m_event_state_changed;
+	// State of one throughput test. Several tests may run at once.
+	class TestState
+	{
+	public:
+		TestState() { os_event_init(&m_event_state_changed, OS_EVENT_TYPE_AUTO); }
+		~TestState() { os_event_destroy(m_event_state_changed); }
+
+		state_enum get_state() { return m_state; }
+
+		void wait_state_changed() { os_event_wait(m_event_state_changed); }
+		void wait_state_changed(unsigned long milliseconds) { os_event_timedwait(m_event_state_changed, milliseconds); }
+		void set_state(const state_enum new_state) { m_state = new_state; os_event_signal(m_event_state_changed); }
+
+	private:
+		os_event_t* m_event_state_changed;
+		std::atomic<state_enum> m_state{Running};
+	};
+
 	os_event_t* m_event_async_done;
-	state_enum m_state = Stopped;
 	bool m_async_busy = false;
 
-private:
-	void wait_state_changed() { os_event_wait(m_event_state_changed); }
-	void wait_state_changed(unsigned long milliseconds) { os_event_timedwait(m_event_state_changed, milliseconds); }
-	void signal_state_changed() { os_event_signal(m_event_state_changed); }
-	void set_state(const state_enum new_state) { m_state = new_state; signal_state_changed(); }
+	std::atomic<bool> m_cancelled{false};
+
+	std::mutex m_active_tests_mutex;
+	std::set<TestState*> m_active_tests;
 
 public:
 	typedef void(*TestServerBitsPerSecondAsyncCallback)(Result*, void*);
@@ -101,11 +120,20 @@ public:
 		const TestServerBitsPerSecondAsyncCallback callback,
 		void* const data);
 
+	// Pre-screens every server by round trip time, in parallel, then
+	// tests the throughput of the best ones only. Progress is reported as
+	// each test finishes. Servers ruled out are not tested and get no
+	// result.
+	//
+	// With `syntheticPayload`, pre-generated packets at the requested
+	// bitrate are sent instead of encoding the live video and audio.
 	void TestMultipleServersBitsPerSecondAsync(
 		std::vector<Server> servers,
 		const uint64_t maxBitrateBitsPerSecond,
 		const char* const bindToIP,
 		const int durationSeconds,
+		const StreamElementsBandwidthProbe::Options probeOptions,
+		const bool syntheticPayload,
 		const TestMultipleServersBitsPerSecondAsyncCallback progress_callback,
 		const TestMultipleServersBitsPerSecondAsyncCallback callback,
 		void* const data);
@@ -122,5 +150,6 @@ private:
 		const bool useAuth,
 		const char* const authUsername,
 		const char* const authPassword,
+		const bool syntheticPayload,
 		StreamElementsBandwidthTestClient::Result* result);
 };
@@ -1,6 +1,8 @@
 #include "StreamElementsBandwidthTestManager.hpp"
 #include "StreamElementsUtils.hpp"
 
+#include <algorithm>
+
 StreamElementsBandwidthTestManager::StreamElementsBandwidthTestManager()
 {
 	m_isTestInProgress = false;
@@ -30,6 +32,22 @@ bool StreamElementsBandwidthTestManager::BeginBandwidthTest(CefRefPtr<CefValue>
 			int maxBitsPerSecond = settings->GetInt("maxBitsPerSecond");
 			int serverTestDurationSeconds = settings->GetInt("serverTestDurationSeconds");
 
+			StreamElementsBandwidthProbe::Options probeOptions;
+
+			bool syntheticPayload = false;
+
+			if (settings->HasKey("syntheticPayload") && settings->GetType("syntheticPayload") == VTYPE_BOOL) {
+				syntheticPayload = settings->GetBool("syntheticPayload");
+			}
+
+			if (settings->HasKey("maxServersToTest") && settings->GetType("maxServersToTest") == VTYPE_INT) {
+				probeOptions.maxServersToTest = std::max(0, settings->GetInt("maxServersToTest"));
+			}
+
+			if (settings->HasKey("maxConcurrentServerTests") && settings->GetType("maxConcurrentServerTests") == VTYPE_INT) {
+				probeOptions.maxConcurrentTests = std::max(1, settings->GetInt("maxConcurrentServerTests"));
+			}
+
 			m_last_test_servers.clear();
 
 			for (size_t i = 0; i < servers->GetSize(); ++i) {
@@ -79,6 +97,8 @@ bool StreamElementsBandwidthTestManager::BeginBandwidthTest(CefRefPtr<CefValue>
 					maxBitsPerSecond,
 					nullptr,
 					serverTestDurationSeconds,
+					probeOptions,
+					syntheticPayload,
 					[](std::vector<StreamElementsBandwidthTestClient::Result>* results, void* data) {
 						local_context* context = (local_context*)data;
 
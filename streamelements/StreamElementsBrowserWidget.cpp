@@ -261,16 +261,25 @@ StreamElementsBrowserWidget::StreamElementsBrowserWidget(
 
 	m_msgHandler = [this](std::shared_ptr<StreamElementsWebsocketApiServer::ClientInfo> source,
 			      CefRefPtr<CefProcessMessage> msg) {
-		std::shared_lock<decltype(s_widgetRegistryMutex)> lock;
+		// Messages of different clients are handled concurrently:
+		// the handler is kept alive, but not the registry locked, while
+		// it runs.
+		std::shared_ptr<StreamElementsApiMessageHandler> handler;
 
-		if (!s_widgetRegistry.count(this))
-			return;
+		{
+			std::shared_lock<decltype(s_widgetRegistryMutex)> lock(
+				s_widgetRegistryMutex);
+
+			if (!s_widgetRegistry.count(this))
+				return;
+
+			handler = m_requestedApiMessageHandler;
+		}
 
-		if (!m_requestedApiMessageHandler.get())
+		if (!handler.get())
 			return;
 
-		m_requestedApiMessageHandler->OnProcessMessageReceived(source,
-								       msg, 0);
+		handler->OnProcessMessageReceived(source, msg, 0);
 	};
 
 	StreamElementsGlobalStateManager::GetInstance()
@@ -0,0 +1,73 @@
+#include "StreamElementsCompositionSceneIndex.hpp"
+
+StreamElementsCompositionSceneIndex::StreamElementsCompositionSceneIndex() {}
+
+StreamElementsCompositionSceneIndex::~StreamElementsCompositionSceneIndex() {}
+
+void StreamElementsCompositionSceneIndex::Invalidate()
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+
+	++m_generation;
+}
+
+std::string StreamElementsCompositionSceneIndex::Find(const void *key,
+						      const collect_t &collect)
+{
+	uint64_t generation;
+
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+
+		if (m_builtGeneration == m_generation) {
+			auto it = m_map.find(key);
+
+			if (it == m_map.end())
+				return "";
+
+			return it->second;
+		}
+
+		generation = m_generation;
+	}
+
+	// Collect without holding the lock: the compositions take their own
+	// locks, and may invalidate the index meanwhile.
+	entries_t entries;
+	collect(entries);
+
+	std::unordered_map<const void *, std::string> map;
+	map.reserve(entries.size());
+
+	for (auto &entry : entries)
+		map.emplace(entry.first, std::move(entry.second));
+
+	std::string result;
+
+	{
+		auto it = map.find(key);
+
+		if (it != map.end())
+			result = it->second;
+	}
+
+	std::lock_guard<std::mutex> guard(m_mutex);
+
+	++m_rebuildCount;
+
+	// Invalidated while collecting: the answer stands for this lookup,
+	// but the next one rebuilds again.
+	if (generation == m_generation) {
+		m_map.swap(map);
+		m_builtGeneration = generation;
+	}
+
+	return result;
+}
+
+uint64_t StreamElementsCompositionSceneIndex::GetRebuildCount() const
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+
+	return m_rebuildCount;
+}
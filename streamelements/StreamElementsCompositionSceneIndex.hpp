@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+//
+// Reverse index from scenes to the id of the video composition which owns
+// them.
+//
+// Finding the composition of a scene used to walk every scene of every
+// composition, and SerializeSourceAndSceneItem() did that for each item it
+// serialized, so serializing a scene cost a walk of the whole workspace per
+// item.
+//
+// The index is not patched entry by entry. It is invalidated whenever a
+// composition is created or removed, a composition's scene list changes or a
+// scene collection loads, and the next lookup rebuilds it from the
+// compositions in one pass. Scene lists change far less often than they are
+// looked up.
+//
+// Keys are scene and scene source pointers. They are only compared, never
+// dereferenced, so ids which arrive from clients can be looked up before
+// they are validated.
+//
+// When a key is listed by more than one composition, the first one listed
+// wins; the native compositions share OBS's own scene list.
+//
+class StreamElementsCompositionSceneIndex {
+public:
+	typedef std::vector<std::pair<const void *, std::string>> entries_t;
+
+	// Lists every key with the id of the composition which owns it.
+	typedef std::function<void(entries_t &)> collect_t;
+
+public:
+	StreamElementsCompositionSceneIndex();
+	~StreamElementsCompositionSceneIndex();
+
+	void Invalidate();
+
+	// Id of the composition which owns `key`, or an empty string. Calls
+	// `collect` first if the index was invalidated since it was built.
+	std::string Find(const void *key, const collect_t &collect);
+
+	uint64_t GetRebuildCount() const;
+
+private:
+	mutable std::mutex m_mutex;
+
+	std::unordered_map<const void *, std::string> m_map;
+
+	// The index is current while both are equal.
+	uint64_t m_generation = 1;
+	uint64_t m_builtGeneration = 0;
+
+	uint64_t m_rebuildCount = 0;
+};
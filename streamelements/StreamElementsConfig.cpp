@@ -25,6 +25,8 @@ StreamElementsConfig::~StreamElementsConfig()
 	if (m_obsUserConfig) {
 		m_obsUserConfig = nullptr;
 	}
+
+	m_scopedStorage.reset();
 }
 
 
@@ -48,6 +50,16 @@ config_t* StreamElementsConfig::GetConfig()
 		config_set_default_string(m_config, "Startup", "State", "");
 		config_set_default_bool(m_config, "Startup",
 					"ShowBuiltInMenuItems", true);
+		config_set_default_uint(m_config, "MessageBus",
+					"HttpRequestTimeoutMs", 15000);
+		config_set_default_uint(m_config, "MessageBus",
+					"HttpMaxWaitingRequests", 16);
+		config_set_default_int(m_config, "Logging", "MinLevel",
+				       LOG_INFO);
+		config_set_default_uint(m_config, "WebsocketApiServer",
+					"IoThreadCount", 0);
+		config_set_default_uint(m_config, "WebsocketApiServer",
+					"WorkerThreadCount", 0);
 	}
 
 	return m_config;
@@ -140,32 +152,35 @@ std::string StreamElementsConfig::GetScopedConfigStorageRootPath()
 	return root;
 }
 
-bool StreamElementsConfig::GetScopedTextFileFolderPath(
-	std::string scope,
-	std::string container,
-	std::string &result)
+StreamElementsScopedStorage *StreamElementsConfig::GetScopedStorage()
 {
-	if (!isSecureFilename(scope))
-		return false;
-
-	if (!isSecureFilename(container))
-		return false;
+	std::lock_guard<decltype(m_scopedStorageMutex)> guard(
+		m_scopedStorageMutex);
+
+	if (!m_scopedStorage) {
+		char *journalPath = obs_module_config_path(
+			"scoped_config_storage.journal");
+		m_scopedStorage =
+			std::make_unique<StreamElementsScopedStorage>(
+				journalPath);
+		bfree(journalPath);
+
+		if (!m_scopedStorage->Open()) {
+			blog(LOG_ERROR,
+			     "obs-streamelements-core: scoped storage: failed opening journal");
+		}
 
-	std::string root = GetScopedConfigStorageRootPath();
-	root += "/";
-	root += scope;
-	root += "/";
-	root += container;
+		size_t imported = m_scopedStorage->ImportLegacyFiles(
+			GetScopedConfigStorageRootPath());
 
-#ifdef _WIN32
-	char *abs = os_get_abs_path_ptr(root.c_str());
-	result = abs;
-	bfree(abs);
-#else
-	result = root;
-#endif
+		if (imported) {
+			blog(LOG_INFO,
+			     "obs-streamelements-core: scoped storage: imported %zu legacy item(s)",
+			     imported);
+		}
+	}
 
-	return true;
+	return m_scopedStorage.get();
 }
 
 bool StreamElementsConfig::ReadScopedTextFile(std::string scope,
@@ -173,30 +188,11 @@ bool StreamElementsConfig::ReadScopedTextFile(std::string scope,
 					      std::string filename,
 					      std::string &result)
 {
-	if (!isSecureFilename(filename))
-		return false;
-
-	std::string root;
-	if (!GetScopedTextFileFolderPath(scope, container, root))
-		return false;
-
-	os_mkdirs(root.c_str());
-
-	std::string path = root + "/" + filename;
-
-	if (!os_file_exists(path.c_str()))
+	if (!isSecureFilename(scope) || !isSecureFilename(container) ||
+	    !isSecureFilename(filename))
 		return false;
 
-	char *data = os_quick_read_utf8_file(path.c_str());
-
-	if (!data)
-		return false;
-
-	result = data;
-
-	bfree(data);
-
-	return true;
+	return GetScopedStorage()->Read(scope, container, filename, result);
 }
 
 bool StreamElementsConfig::WriteScopedTextFile(std::string scope,
@@ -204,75 +200,32 @@ bool StreamElementsConfig::WriteScopedTextFile(std::string scope,
 					       std::string filename,
 					       std::string content)
 {
-	if (!isSecureFilename(filename))
-		return false;
-
-	std::string root;
-	if (!GetScopedTextFileFolderPath(scope, container, root))
+	if (!isSecureFilename(scope) || !isSecureFilename(container) ||
+	    !isSecureFilename(filename))
 		return false;
 
-	os_mkdirs(root.c_str());
-
-	std::string path = root + "/" + filename;
-
-	os_quick_write_utf8_file(path.c_str(), content.c_str(), content.size(),
-				 true);
-
-	return true;
+	return GetScopedStorage()->Write(scope, container, filename, content);
 }
 
 bool StreamElementsConfig::RemoveScopedFile(std::string scope,
-						std::string container,
-						std::string filename)
+					    std::string container,
+					    std::string filename)
 {
-	if (!isSecureFilename(filename))
-		return false;
-
-	std::string root;
-	if (!GetScopedTextFileFolderPath(scope, container, root))
+	if (!isSecureFilename(scope) || !isSecureFilename(container) ||
+	    !isSecureFilename(filename))
 		return false;
 
-	os_mkdirs(root.c_str());
-
-	std::string path = root + "/" + filename;
-
-	if (!os_file_exists(path.c_str()))
-		return false;
-
-	return (os_unlink(path.c_str()) == 0);
+	return GetScopedStorage()->Remove(scope, container, filename);
 }
 
-bool StreamElementsConfig::ReadScopedFilesList(std::string scope,
-					       std::string container,
-					       std::string pattern,
-					       std::vector<std::string> &result)
+bool StreamElementsConfig::ReadScopedFilesList(
+	std::string scope, std::string container, std::string prefix,
+	std::vector<StreamElementsScopedStorage::ItemInfo> &result)
 {
-	std::string root;
-	if (!GetScopedTextFileFolderPath(scope, container, root))
-		return false;
-
-	os_mkdirs(root.c_str());
-
-	std::string path = root + "/" + pattern;
-
-	os_glob_t *glob;
-	if (os_glob(path.c_str(), 0, &glob) != 0)
+	if (!isSecureFilename(scope) || !isSecureFilename(container))
 		return false;
 
-	for (size_t i = 0; i < glob->gl_pathc; i++) {
-		struct os_globent ent = glob->gl_pathv[i];
-
-		if (ent.directory)
-			continue;
-
-		QFile file(ent.path);
-
-		result.push_back(file.fileName().toStdString());
-	}
-
-	os_globfree(glob);
-
-	return true;
+	return GetScopedStorage()->List(scope, container, prefix, result);
 }
 
 void StreamElementsConfig::ReadScopedJsonFile(
@@ -382,22 +335,25 @@ void StreamElementsConfig::ReadScopedJsonFilesList(
 	std::string scope = d->GetString("scope");
 	std::string container = d->GetString("container");
 
-	std::vector<std::string> result;
-	if (!ReadScopedFilesList(scope, container, "*.json", result))
+	std::vector<StreamElementsScopedStorage::ItemInfo> result;
+	if (!ReadScopedFilesList(scope, container, "", result))
 		return;
 
 	auto r = CefListValue::Create();
 
-	for (auto path : result) {
-		auto f = CefDictionaryValue::Create();
+	for (auto info : result) {
+		const std::string &file = info.item;
 
-		std::string file =
-			path.substr(path.find_last_of("/\\") + 1);
+		if (file.size() <= 5 ||
+		    file.compare(file.size() - 5, 5, ".json") != 0)
+			continue;
+
+		auto f = CefDictionaryValue::Create();
 
 		f->SetString("item", file.substr(0, file.size() - 5)); // remove ".json" suffix
 		f->SetString("scope", scope);
 		f->SetString("container", container);
-		f->SetInt("contentLength", os_get_file_size(path.c_str()));
+		f->SetInt("contentLength", (int)info.contentLength);
 
 		r->SetDictionary(r->GetSize(), f);
 	}
@@ -7,9 +7,12 @@
 #include <mutex>
 #include <shared_mutex>
 #include <set>
+#include <memory>
 
 #include "StreamElementsUtils.hpp"
 #include "StreamElementsMessageBus.hpp"
+#include "StreamElementsScopedStorage.hpp"
+#include "StreamElementsAsyncLog.hpp"
 
 class StreamElementsConfig
 {
@@ -67,9 +70,9 @@ public:
 public:
 	std::string GetScopedConfigStorageRootPath();
 
-	bool GetScopedTextFileFolderPath(std::string scope,
-					 std::string container,
-					 std::string &result);
+	// Opened on first use, importing any legacy file-per-item content
+	// found under GetScopedConfigStorageRootPath().
+	StreamElementsScopedStorage *GetScopedStorage();
 
 	bool ReadScopedTextFile(std::string scope, std::string container,
 				std::string filename, std::string &result);
@@ -78,9 +81,9 @@ public:
 	bool RemoveScopedFile(std::string scope, std::string container,
 			      std::string filename);
 
-	bool ReadScopedFilesList(std::string scope, std::string container,
-				 std::string pattern,
-				 std::vector<std::string> &result);
+	bool ReadScopedFilesList(
+		std::string scope, std::string container, std::string prefix,
+		std::vector<StreamElementsScopedStorage::ItemInfo> &result);
 
 public:
 	void ReadScopedJsonFile(CefRefPtr<CefValue> input,
@@ -316,6 +319,58 @@ public:
 		SaveConfig();
 	}
 
+	// Message bus HTTP bridge: how long a request waits for the browser
+	// to answer it, and how many requests may wait at once.
+	int GetMessageBusHttpRequestTimeoutMs()
+	{
+		return (int)config_get_uint(
+			StreamElementsConfig::GetInstance()->GetConfig(),
+			"MessageBus", "HttpRequestTimeoutMs");
+	}
+
+	int GetMessageBusHttpMaxWaitingRequests()
+	{
+		return (int)config_get_uint(
+			StreamElementsConfig::GetInstance()->GetConfig(),
+			"MessageBus", "HttpMaxWaitingRequests");
+	}
+
+	// Least severe LOG_* level SE_LOG() lets through.
+	int GetLogMinLevel()
+	{
+		const int level = (int)config_get_int(
+			StreamElementsConfig::GetInstance()->GetConfig(),
+			"Logging", "MinLevel");
+
+		return StreamElementsAsyncLog::IsValidLevel(level) ? level
+								    : LOG_INFO;
+	}
+
+	void SetLogMinLevel(int value)
+	{
+		config_set_int(StreamElementsConfig::GetInstance()->GetConfig(),
+			       "Logging", "MinLevel", value);
+
+		SaveConfig();
+
+		StreamElementsAsyncLog::GetInstance()->SetMinLevel(value);
+	}
+
+	// 0 lets the websocket API server pick.
+	size_t GetWebsocketApiServerIoThreadCount()
+	{
+		return (size_t)config_get_uint(
+			StreamElementsConfig::GetInstance()->GetConfig(),
+			"WebsocketApiServer", "IoThreadCount");
+	}
+
+	size_t GetWebsocketApiServerWorkerThreadCount()
+	{
+		return (size_t)config_get_uint(
+			StreamElementsConfig::GetInstance()->GetConfig(),
+			"WebsocketApiServer", "WorkerThreadCount");
+	}
+
 	bool IsOnBoardingMode() {
 		return (GetStartupFlags() & STARTUP_FLAGS_ONBOARDING_MODE) != 0;
 	}
@@ -324,6 +379,9 @@ private:
 	config_t* m_config = nullptr;
 	config_t *m_obsUserConfig = nullptr;
 
+	std::unique_ptr<StreamElementsScopedStorage> m_scopedStorage;
+	std::mutex m_scopedStorageMutex;
+
 private:
 	static StreamElementsConfig* s_instance;
 	static bool s_destroyed;
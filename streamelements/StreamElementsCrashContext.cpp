@@ -2,9 +2,9 @@
 
 #include "cef-headers.hpp"
 #include "StreamElementsGlobalStateManager.hpp"
-#include "StreamElementsSecretRedactor.hpp"
+#include "StreamElementsDiagnosticsArchive.hpp"
+#include "StreamElementsLogRing.hpp"
 #include "StreamElementsUtils.hpp"
-#include "deps/zip/zip.h"
 
 #include <util/base.h>
 #include <util/platform.h>
@@ -31,22 +31,9 @@
 #include <dlfcn.h>
 #include <sys/types.h>
 
-// Windows spellings used throughout the collection below, so the shared code
-// does not have to fork for the sake of a type name or an underscore.
+// Windows spelling used throughout the collection below, so the shared code
+// does not have to fork for the sake of a type name.
 typedef unsigned char BYTE;
-
-// Functions rather than macros on purpose: the read loops below keep their
-// byte count in a local called `read`, which a macro would rewrite into a call
-// on an int.
-static inline int _read(int fd, void *buffer, size_t count)
-{
-	return (int)::read(fd, buffer, count);
-}
-
-static inline int _close(int fd)
-{
-	return ::close(fd);
-}
 #endif
 
 /* ================================================================= */
@@ -465,31 +452,39 @@ StreamElementsCrashContext::Result StreamElementsCrashContext::Collect()
 	std::wstring obsDataPath = utf8_to_wstring(programDataPathBuf);
 #endif
 
-	zip_t *zip = zip_open(tempBufPath.c_str(), 9, 'w');
+	// Level 3 rather than 9 and deflated in parallel: this runs while the
+	// user waits on a dying process, and the archive is almost all text,
+	// which level 9 barely shrinks further. See
+	// StreamElementsDiagnosticsArchive for the limits applied below.
+	StreamElementsDiagnosticsArchive::Options archiveOptions;
+
+	// Hard ceilings on the configuration tree, explained where it is
+	// collected below.
+	archiveOptions.maxFileBytes = 4ull * 1024 * 1024;
+	archiveOptions.maxTotalBytes = 40ull * 1024 * 1024;
+
+	StreamElementsDiagnosticsArchive archive(archiveOptions);
 
-	if (!zip) {
+	if (!archive.Open(tempBufPath)) {
 		return result;
 	}
 
 	auto addBufferToZip = [&](BYTE *buf, size_t bufLen,
 				  std::wstring zipPath) {
-		zip_entry_open(zip, wstring_to_utf8(zipPath).c_str());
-
-		zip_entry_write(zip, buf, bufLen);
-
-		zip_entry_close(zip);
+		archive.AddBuffer(std::string((const char *)buf, bufLen),
+				  wstring_to_utf8(zipPath));
 	};
 
 	auto addLinesBufferToZip = [&](std::vector<std::string> &lines,
 				       std::wstring zipPath) {
-		zip_entry_open(zip, wstring_to_utf8(zipPath).c_str());
+		std::string buf;
 
-		for (auto line : lines) {
-			zip_entry_write(zip, line.c_str(), line.size());
-			zip_entry_write(zip, "\r\n", 2);
+		for (auto &line : lines) {
+			buf += line;
+			buf += "\r\n";
 		}
 
-		zip_entry_close(zip);
+		archive.AddBuffer(std::move(buf), wstring_to_utf8(zipPath));
 	};
 
 	auto addCefValueToZip = [&](CefRefPtr<CefValue> &input,
@@ -498,75 +493,7 @@ StreamElementsCrashContext::Result StreamElementsCrashContext::Collect()
 			CefWriteJSON(input, JSON_WRITER_PRETTY_PRINT)
 				.ToWString());
 
-		zip_entry_open(zip, wstring_to_utf8(zipPath).c_str());
-
-		zip_entry_write(zip, buf.c_str(), buf.size());
-
-		zip_entry_close(zip);
-	};
-
-	auto addFileToZip = [&](std::wstring localPath, std::wstring zipPath) {
-		// service.json carries the stream key in plaintext, so it is
-		// buffered whole and sanitized rather than streamed straight
-		// through. It is a few hundred bytes; everything else keeps the
-		// chunked path.
-		const bool redact =
-			StreamElementsSecretRedactor::IsSensitivePath(zipPath);
-
-#ifdef WIN32
-		int fd = _wsopen(localPath.c_str(), _O_RDONLY | _O_BINARY,
-				 _SH_DENYNO, 0 /*_S_IREAD | _S_IWRITE*/);
-#else
-		int fd = open(wstring_to_utf8(localPath).c_str(), O_RDONLY);
-#endif
-
-		if (-1 != fd) {
-			size_t BUF_LEN = 32768;
-
-			BYTE *buf = new BYTE[BUF_LEN];
-
-			zip_entry_open(zip, wstring_to_utf8(zipPath).c_str());
-
-			if (redact) {
-				std::string content;
-
-				int read = _read(fd, buf, BUF_LEN);
-				while (read > 0) {
-					content.append((const char *)buf,
-						       (size_t)read);
-
-					read = _read(fd, buf, BUF_LEN);
-				}
-
-				const std::string sanitized =
-					StreamElementsSecretRedactor::Redact(
-						content);
-
-				zip_entry_write(zip, sanitized.c_str(),
-						sanitized.size());
-			} else {
-				int read = _read(fd, buf, BUF_LEN);
-				while (read > 0) {
-					if (0 !=
-					    zip_entry_write(zip, buf, read)) {
-						break;
-					}
-
-					read = _read(fd, buf, BUF_LEN);
-				}
-			}
-
-			zip_entry_close(zip);
-
-			delete[] buf;
-
-			_close(fd);
-		} else {
-			// Failed opening file for reading
-			//
-			// This is a crash handler: you can't really do anything
-			// here to mitigate.
-		}
+		archive.AddBuffer(std::move(buf), wstring_to_utf8(zipPath));
 	};
 
 #ifdef WIN32
@@ -663,7 +590,7 @@ StreamElementsCrashContext::Result StreamElementsCrashContext::Collect()
 				 sizeof(BITMAPINFOHEADER) +
 				 sizeof(RGBQUAD) * nColorTableEntries;
 
-		zip_entry_open(zip, wstring_to_utf8(zipPath).c_str());
+		std::string bmp;
 
 		DWORD nColorTableSize = 0;
 		if (nBitCount != 24) {
@@ -672,8 +599,8 @@ StreamElementsCrashContext::Result StreamElementsCrashContext::Collect()
 			nColorTableSize = 0L;
 		}
 
-		zip_entry_write(zip, &bmfh, sizeof(BITMAPFILEHEADER));
-		zip_entry_write(zip, lpBitmapInfoHeader, nHeaderSize);
+		bmp.append((const char *)&bmfh, sizeof(BITMAPFILEHEADER));
+		bmp.append((const char *)lpBitmapInfoHeader, nHeaderSize);
 
 		if (nBitCount < 16) {
 			//int nBytesWritten = 0;
@@ -685,16 +612,16 @@ StreamElementsCrashContext::Result StreamElementsCrashContext::Collect()
 					rgbTable[i].rgbBlue = i;
 				rgbTable[i].rgbReserved = 0;
 
-				zip_entry_write(zip, &rgbTable[i],
-						sizeof(RGBQUAD));
+				bmp.append((const char *)&rgbTable[i],
+					   sizeof(RGBQUAD));
 			}
 
 			delete[] rgbTable;
 		}
 
-		zip_entry_write(zip, lpDibBits, dwSizeImage);
+		bmp.append((const char *)lpDibBits, dwSizeImage);
 
-		zip_entry_close(zip);
+		archive.AddBuffer(std::move(bmp), wstring_to_utf8(zipPath));
 
 		::DeleteObject(hBMP);
 		::DeleteObject(hBitmap);
@@ -731,6 +658,18 @@ StreamElementsCrashContext::Result StreamElementsCrashContext::Collect()
 	addBufferToZip((BYTE *)obsCrashLog.c_str(), obsCrashLog.size(),
 		       L"obs-studio/crashes/crash.log");
 
+	// The plugin's most recent activity, straight from memory: the last
+	// lines before the crash are the ones most likely to be missing from
+	// the log file on disk. Lock-free, so safe with other threads stopped
+	// mid-append.
+	{
+		std::string activity =
+			StreamElementsLogRing::GetInstance()->Format();
+
+		addBufferToZip((BYTE *)activity.c_str(), activity.size(),
+			       L"obs-streamelements-core-activity.txt");
+	}
+
 	// Add window capture
 	//
 	// Windows only. The equivalent on macOS is CGWindowListCreateImage,
@@ -785,21 +724,20 @@ StreamElementsCrashContext::Result StreamElementsCrashContext::Collect()
 	// inside Sentry's 40MB *compressed* envelope cap -- binaries compress
 	// roughly 2-3x, so a full 40MB of them lands near 16MB, leaving room for
 	// the ~6.5MB minidump.
-	const uintmax_t maxFileBytes = 4ull * 1024 * 1024;
-	const uintmax_t maxPluginFileBytes = 32ull * 1024 * 1024;
-	const uintmax_t maxTotalBytes = 40ull * 1024 * 1024;
-
-	struct CandidateFile {
-		std::wstring localPath;
-		std::wstring zipPath;
-		uintmax_t size;
-
-		// Under the auxiliary plugins folder, so subject to
-		// maxPluginFileBytes and taken last -- see the sort below.
-		bool isPlugin;
-	};
+	//
+	// Logs over the general limit are cut down to their head and tail
+	// rather than dropped -- see StreamElementsDiagnosticsArchive. The
+	// general ceilings themselves are set on archiveOptions above, where the
+	// archive is opened.
+	const uint64_t maxPluginFileBytes = 32ull * 1024 * 1024;
+
+	std::vector<StreamElementsDiagnosticsArchive::Candidate> candidates;
 
-	std::vector<CandidateFile> candidates;
+	// OBS names its logs by start time, so the greatest name in logs/ is the
+	// session that crashed.
+	const std::wstring logsPrefix = L"logs/";
+	std::wstring newestLog;
+	size_t newestLogIndex = SIZE_MAX;
 
 	// Collect files
 	//
@@ -891,6 +829,11 @@ StreamElementsCrashContext::Result StreamElementsCrashContext::Collect()
 				std::error_code ec;
 				const uintmax_t size = i.file_size(ec);
 
+				// Gone or unreadable: planning it as empty
+				// would let it into the archive unbounded.
+				if (ec)
+					continue;
+
 				// The auxiliary plugins folder, which is inside
 				// the configuration tree on both platforms:
 				// ~/Library/Application Support/obs-studio/
@@ -906,85 +849,70 @@ StreamElementsCrashContext::Result StreamElementsCrashContext::Collect()
 						0, pluginsPrefix.size()) ==
 						pluginsPrefix;
 
-				candidates.push_back(
-					{local_path, L"obs-studio\\" + zip_path,
-					 ec ? 0 : size, isPlugin});
+				StreamElementsDiagnosticsArchive::Candidate
+					candidate;
+
+				candidate.localPath =
+					wstring_to_utf8(local_path);
+				candidate.zipPath = wstring_to_utf8(
+					L"obs-studio\\" + zip_path);
+				candidate.size = size;
+
+				if (isPlugin) {
+					candidate.priority =
+						StreamElementsDiagnosticsArchive::
+							PRIORITY_LOW;
+					candidate.maxBytes = maxPluginFileBytes;
+				}
+
+				if (zip_path_lcase.size() > logsPrefix.size() &&
+				    zip_path_lcase.substr(
+					    0, logsPrefix.size()) ==
+					    logsPrefix &&
+				    zip_path_lcase > newestLog) {
+					newestLog = zip_path_lcase;
+					newestLogIndex = candidates.size();
+				}
+
+				candidates.push_back(candidate);
 			}
 		}
 	}
 
-	// Everything else before the plugins, and smallest first within each, so
-	// the budget buys the largest number of files and a single huge one can
-	// never crowd out the small text files that carry almost all of the
-	// diagnostic value.
+	if (newestLogIndex < candidates.size()) {
+		candidates[newestLogIndex].priority =
+			StreamElementsDiagnosticsArchive::PRIORITY_HIGH;
+	}
+
+	// The crashed session's log first, then everything else before the
+	// plugins, and smallest first within each, so the budget buys the
+	// largest number of files and a single huge one can never crowd out the
+	// small text files that carry almost all of the diagnostic value.
 	//
-	// Plugin binaries are the reason for the two tiers rather than one sort
-	// by size. They are wanted, but they are also the only things here large
-	// enough to exhaust the budget, so they take what is left after the
-	// configuration tree -- a few hundred KB -- rather than competing with
+	// Plugin binaries are the reason for the separate tiers rather than one
+	// sort by size. They are wanted, but they are also the only things here
+	// large enough to exhaust the budget, so they take what is left after
+	// the configuration tree -- a few hundred KB -- rather than competing with
 	// it. Sorting purely by size would have let a handful of plugins push
 	// out the text files instead.
-	std::sort(candidates.begin(), candidates.end(),
-		  [](const CandidateFile &a, const CandidateFile &b) {
-			  if (a.isPlugin != b.isPlugin)
-				  return !a.isPlugin;
-
-			  return a.size < b.size;
-		  });
-
-	std::vector<std::string> omitted;
-	uintmax_t totalBytes = 0;
-
-	for (auto &candidate : candidates) {
-		const uintmax_t fileLimit = candidate.isPlugin
-						    ? maxPluginFileBytes
-						    : maxFileBytes;
-
-		const bool tooBig = candidate.size > fileLimit;
-		const bool overBudget = totalBytes + candidate.size >
-					maxTotalBytes;
-
-		if (tooBig || overBudget) {
-			omitted.push_back(
-				wstring_to_utf8(candidate.zipPath) + " (" +
-				std::to_string(candidate.size) + " bytes, " +
-				(tooBig ? "over per-file limit"
-					: "archive budget exhausted") +
-				")");
-
-			continue;
-		}
-
-		totalBytes += candidate.size;
-
-		addFileToZip(candidate.localPath, candidate.zipPath);
-	}
+	auto plan = archive.AddCandidates(candidates);
 
 	// Always written, even when nothing was dropped. A truncated archive that
 	// does not say it was truncated reads as a complete picture of the
 	// machine, and someone will eventually conclude a file was missing when it
 	// was only omitted.
 	{
-		std::vector<std::string> manifest;
-
-		manifest.push_back(
-			"Files collected: " +
-			std::to_string(candidates.size() - omitted.size()) +
-			" (" + std::to_string(totalBytes) + " bytes)");
-		manifest.push_back("Files omitted: " +
-				   std::to_string(omitted.size()));
-		manifest.push_back("Per-file limit: " +
-				   std::to_string(maxFileBytes) + " bytes");
-		manifest.push_back("Per-file limit (plugins): " +
-				   std::to_string(maxPluginFileBytes) +
-				   " bytes");
-		manifest.push_back("Archive budget: " +
-				   std::to_string(maxTotalBytes) + " bytes");
-		manifest.push_back("");
-
-		for (auto &line : omitted) {
-			manifest.push_back(line);
-		}
+		std::vector<std::string> manifest =
+			StreamElementsDiagnosticsArchive::DescribePlan(
+				plan, archiveOptions);
+
+		// With the other limits, ahead of the blank line that ends
+		// them.
+		manifest.insert(std::find(manifest.begin(), manifest.end(),
+					  std::string()),
+				"Per-file limit (plugins): " +
+					std::to_string(maxPluginFileBytes) +
+					" bytes");
 
 		addLinesBufferToZip(manifest, L"omitted-files.txt");
 	}
@@ -1171,7 +1099,7 @@ StreamElementsCrashContext::Result StreamElementsCrashContext::Collect()
 		result.attachments.push_back({wstring_to_utf8(wtempBufPath)});
 	});
 
-	zip_close(zip);
+	archive.Close();
 
 	result.attachments.push_back({tempBufPath});
 
@@ -0,0 +1,410 @@
+#include "StreamElementsDiagnosticsArchive.hpp"
+#include "StreamElementsSecretRedactor.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+// A log the budget leaves less room for than this is omitted instead: a few
+// lines either side of a marker tell nobody anything.
+static const uint64_t MIN_TRUNCATED_LOG_BYTES = 64 * 1024;
+
+// How far a cut may move to land on a line boundary, as a fraction of the
+// slice.
+static const uint64_t LINE_BOUNDARY_SLACK_DIVISOR = 8;
+
+static const size_t REDACT_CHUNK_SIZE = 32 * 1024;
+
+static StreamElementsParallelZipWriter::Options
+GetWriterOptions(const StreamElementsDiagnosticsArchive::Options &options)
+{
+	StreamElementsParallelZipWriter::Options result;
+
+	result.level = options.level;
+	result.workerCount = options.workerCount;
+
+	return result;
+}
+
+static bool IsSensitive(const std::string &zipPath)
+{
+	// IsSensitivePath() only matches ASCII names, so widening byte by byte
+	// is enough.
+	return StreamElementsSecretRedactor::IsSensitivePath(
+		std::wstring(zipPath.begin(), zipPath.end()));
+}
+
+// Reads up to `maxBytes` of `path` through the redactor a chunk at a time, so
+// that the unredacted file is never held whole. A file which has grown past
+// `maxBytes` since it was planned ends in a truncation marker.
+static bool ReadRedacted(const std::string &path, uint64_t maxBytes,
+			 std::string &content)
+{
+	std::ifstream in(std::filesystem::u8path(path), std::ios::binary);
+
+	if (!in)
+		return false;
+
+	in.seekg(0, std::ios::end);
+	const uint64_t size = (uint64_t)in.tellg();
+	in.seekg(0, std::ios::beg);
+
+	if (!in)
+		return false;
+
+	StreamElementsSecretRedactor::Stream redactor;
+	std::vector<char> buf(REDACT_CHUNK_SIZE);
+
+	content.clear();
+
+	uint64_t remaining = std::min(size, maxBytes);
+
+	while (in && remaining) {
+		in.read(buf.data(),
+			(std::streamsize)std::min<uint64_t>(buf.size(),
+							    remaining));
+
+		const size_t read = (size_t)in.gcount();
+
+		if (!read)
+			break;
+
+		remaining -= read;
+
+		redactor.Write(buf.data(), read, content);
+	}
+
+	if (in.bad())
+		return false;
+
+	redactor.Finish(content);
+
+	if (size > maxBytes) {
+		if (content.size() && content.back() != '\n')
+			content += "\n";
+
+		content += StreamElementsDiagnosticsArchive::GetTruncationMarker(
+			size - maxBytes);
+		content += "\n";
+	}
+
+	return true;
+}
+
+/* ================================================================= */
+
+StreamElementsDiagnosticsArchive::StreamElementsDiagnosticsArchive(
+	Options options)
+	: m_options(options), m_writer(GetWriterOptions(options))
+{
+}
+
+StreamElementsDiagnosticsArchive::~StreamElementsDiagnosticsArchive()
+{
+	Close();
+}
+
+bool StreamElementsDiagnosticsArchive::Open(const std::string &path)
+{
+	return m_writer.Open(path);
+}
+
+void StreamElementsDiagnosticsArchive::AddBuffer(std::string content,
+						  const std::string &zipPath)
+{
+	m_writer.AddBuffer(std::move(content), zipPath);
+}
+
+std::vector<StreamElementsDiagnosticsArchive::Decision>
+StreamElementsDiagnosticsArchive::AddCandidates(
+	std::vector<Candidate> candidates, cancelled_t cancelled)
+{
+	std::vector<Decision> plan = Plan(std::move(candidates), m_options);
+
+	bool wasCancelled = false;
+
+	for (auto &decision : plan) {
+		if (decision.disposition == Disposition::Omitted)
+			continue;
+
+		if (!wasCancelled && cancelled)
+			wasCancelled = cancelled();
+
+		if (wasCancelled) {
+			decision.disposition = Disposition::Omitted;
+			decision.headBytes = 0;
+			decision.tailBytes = 0;
+			decision.reason = "cancelled";
+
+			continue;
+		}
+
+		const bool truncated =
+			decision.disposition == Disposition::Truncated;
+		// Logs are free text which anything may have written a
+		// credential to.
+		const bool sensitive =
+			IsSensitive(decision.candidate.zipPath) ||
+			IsLogFile(decision.candidate.zipPath);
+
+		if (!truncated && !sensitive) {
+			// Read and deflated by a worker.
+			m_writer.AddFile(decision.candidate.localPath,
+					 decision.candidate.zipPath);
+
+			continue;
+		}
+
+		// Bounded by the plan, so cheap enough to read here; the
+		// deflate still happens on a worker.
+		std::string content;
+
+		if (!truncated) {
+			if (!ReadRedacted(decision.candidate.localPath,
+					  decision.headBytes, content))
+				continue;
+		} else {
+			if (!ReadSlices(decision.candidate.localPath,
+					decision.headBytes, decision.tailBytes,
+					content))
+				continue;
+
+			if (sensitive)
+				content = StreamElementsSecretRedactor::Redact(
+					content);
+		}
+
+		m_writer.AddBuffer(std::move(content),
+				   decision.candidate.zipPath);
+	}
+
+	return plan;
+}
+
+bool StreamElementsDiagnosticsArchive::Close()
+{
+	return m_writer.Close();
+}
+
+StreamElementsParallelZipWriter::Stats
+StreamElementsDiagnosticsArchive::GetStats()
+{
+	return m_writer.GetStats();
+}
+
+void StreamElementsDiagnosticsArchive::SetProgressCallback(
+	StreamElementsParallelZipWriter::progress_callback_t callback)
+{
+	m_writer.SetProgressCallback(callback);
+}
+
+/* ================================================================= */
+
+std::vector<StreamElementsDiagnosticsArchive::Decision>
+StreamElementsDiagnosticsArchive::Plan(std::vector<Candidate> candidates,
+				       const Options &options)
+{
+	std::stable_sort(candidates.begin(), candidates.end(),
+			 [](const Candidate &a, const Candidate &b) {
+				 if (a.priority != b.priority)
+					 return a.priority < b.priority;
+
+				 return a.size < b.size;
+			 });
+
+	std::vector<Decision> result;
+	result.reserve(candidates.size());
+
+	uint64_t totalBytes = 0;
+
+	for (auto &candidate : candidates) {
+		Decision decision;
+		decision.candidate = candidate;
+
+		const uint64_t fileLimit = candidate.maxBytes
+						   ? candidate.maxBytes
+						   : options.maxFileBytes;
+
+		const uint64_t remaining =
+			options.maxTotalBytes
+				? options.maxTotalBytes -
+					  std::min(totalBytes,
+						   options.maxTotalBytes)
+				: UINT64_MAX;
+
+		const uint64_t available = std::min(fileLimit, remaining);
+
+		if (candidate.size <= available) {
+			decision.disposition = Disposition::Included;
+			decision.headBytes = candidate.size;
+		} else if (IsLogFile(candidate.zipPath) &&
+			   available >= MIN_TRUNCATED_LOG_BYTES) {
+			decision.disposition = Disposition::Truncated;
+			decision.headBytes =
+				std::min(options.logHeadBytes, available / 2);
+			decision.tailBytes = available - decision.headBytes;
+		} else {
+			decision.disposition = Disposition::Omitted;
+			decision.reason = candidate.size > fileLimit
+						  ? "over per-file limit"
+						  : "archive budget exhausted";
+		}
+
+		totalBytes += decision.GetBytes();
+
+		result.push_back(decision);
+	}
+
+	return result;
+}
+
+std::vector<std::string> StreamElementsDiagnosticsArchive::DescribePlan(
+	const std::vector<Decision> &plan, const Options &options)
+{
+	size_t included = 0;
+	size_t truncated = 0;
+	size_t omitted = 0;
+	uint64_t totalBytes = 0;
+
+	for (auto &decision : plan) {
+		switch (decision.disposition) {
+		case Disposition::Included:
+			++included;
+			break;
+		case Disposition::Truncated:
+			++truncated;
+			break;
+		case Disposition::Omitted:
+			++omitted;
+			break;
+		}
+
+		totalBytes += decision.GetBytes();
+	}
+
+	std::vector<std::string> lines;
+
+	lines.push_back("Files collected: " +
+			std::to_string(included + truncated) + " (" +
+			std::to_string(totalBytes) + " bytes)");
+	lines.push_back("Files truncated: " + std::to_string(truncated));
+	lines.push_back("Files omitted: " + std::to_string(omitted));
+	lines.push_back("Per-file limit: " +
+			std::to_string(options.maxFileBytes) + " bytes");
+	lines.push_back("Archive budget: " +
+			(options.maxTotalBytes
+				 ? std::to_string(options.maxTotalBytes) +
+					   " bytes"
+				 : std::string("unlimited")));
+	lines.push_back("");
+
+	for (auto &decision : plan) {
+		const std::string prefix = decision.candidate.zipPath + " (" +
+					   std::to_string(
+						   decision.candidate.size) +
+					   " bytes, ";
+
+		if (decision.disposition == Disposition::Truncated) {
+			lines.push_back(prefix + "truncated to " +
+					std::to_string(decision.GetBytes()) +
+					" bytes)");
+		} else if (decision.disposition == Disposition::Omitted) {
+			lines.push_back(prefix + decision.reason + ")");
+		}
+	}
+
+	return lines;
+}
+
+bool StreamElementsDiagnosticsArchive::IsLogFile(const std::string &zipPath)
+{
+	const size_t dot = zipPath.find_last_of('.');
+
+	if (dot == std::string::npos ||
+	    zipPath.find_first_of("/\\", dot) != std::string::npos)
+		return false;
+
+	std::string ext = zipPath.substr(dot);
+	std::transform(ext.begin(), ext.end(), ext.begin(),
+		       [](unsigned char ch) { return (char)std::tolower(ch); });
+
+	return ext == ".log" || ext == ".txt";
+}
+
+std::string
+StreamElementsDiagnosticsArchive::GetTruncationMarker(uint64_t truncatedBytes)
+{
+	return "[... " + std::to_string(truncatedBytes) +
+	       " bytes truncated ...]";
+}
+
+bool StreamElementsDiagnosticsArchive::ReadSlices(const std::string &path,
+						  uint64_t headBytes,
+						  uint64_t tailBytes,
+						  std::string &content)
+{
+	std::ifstream in(std::filesystem::u8path(path), std::ios::binary);
+
+	if (!in)
+		return false;
+
+	in.seekg(0, std::ios::end);
+	const uint64_t size = (uint64_t)in.tellg();
+	in.seekg(0, std::ios::beg);
+
+	if (!in)
+		return false;
+
+	// Sizes are re-read here rather than taken from the plan: logs are
+	// still being written to while the archive is built.
+	if (headBytes >= size || tailBytes >= size - headBytes) {
+		content.resize((size_t)size);
+
+		return (bool)in.read(&content[0], (std::streamsize)size);
+	}
+
+	std::string head((size_t)headBytes, '\0');
+	std::string tail((size_t)tailBytes, '\0');
+
+	if (!in.read(&head[0], (std::streamsize)head.size()))
+		return false;
+
+	in.seekg((std::streamoff)(size - tailBytes), std::ios::beg);
+
+	if (!in.read(&tail[0], (std::streamsize)tail.size()))
+		return false;
+
+	// End the head after its last complete line, and start the tail at
+	// the beginning of its first one.
+	{
+		const size_t newline = head.find_last_of('\n');
+
+		if (newline != std::string::npos &&
+		    head.size() - (newline + 1) <=
+			    head.size() / LINE_BOUNDARY_SLACK_DIVISOR)
+			head.resize(newline + 1);
+	}
+
+	{
+		const size_t newline = tail.find('\n');
+
+		if (newline != std::string::npos &&
+		    newline + 1 <= tail.size() / LINE_BOUNDARY_SLACK_DIVISOR)
+			tail.erase(0, newline + 1);
+	}
+
+	const uint64_t truncatedBytes = size - head.size() - tail.size();
+
+	content = std::move(head);
+
+	if (content.size() && content.back() != '\n')
+		content += "\n";
+
+	content += GetTruncationMarker(truncatedBytes);
+	content += "\n";
+	content += tail;
+
+	return true;
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "StreamElementsParallelZipWriter.hpp"
+
+#include <functional>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+//
+// Builds the diagnostics archives sent with crash reports and user issue
+// reports.
+//
+// Both used to deflate every file at level 9, one after another, 32KB at a
+// time, on the thread that asked for the report. Most of the content is
+// text -- logs and configuration -- which level 3 compresses within a few
+// percent of level 9 at several times the speed, and the work is now done by
+// StreamElementsParallelZipWriter's workers. Entries still land in the
+// archive in the order they were added.
+//
+// What goes in is decided up front by Plan(), against a per-file limit and an
+// overall budget on uncompressed bytes:
+//
+//  - Candidates are taken by priority, and smallest first within a priority,
+//    so the budget buys the largest number of files and a single huge one can
+//    never crowd out the small files that carry most of the diagnostic value.
+//
+//  - A log over its limit is truncated rather than dropped: the head of a log
+//    records versions, settings and loaded modules, the tail records what
+//    happened last, and the middle is almost always the same lines repeated.
+//    What is cut is replaced by a one-line marker saying how much was.
+//
+//  - Anything else over its limit, and whatever the budget no longer has room
+//    for, is omitted. DescribePlan() lists it, so an archive never reads as
+//    complete when it is not.
+//
+// Files known to carry credentials, and every log, are passed through
+// StreamElementsSecretRedactor on their way in.
+//
+class StreamElementsDiagnosticsArchive {
+public:
+	// Lower is taken first.
+	static const int PRIORITY_HIGH = 0;
+	static const int PRIORITY_NORMAL = 1;
+	static const int PRIORITY_LOW = 2;
+
+	struct Options {
+		int level = 3;
+
+		// 0 picks a default based on hardware concurrency.
+		size_t workerCount = 0;
+
+		// Applies to candidates which do not set their own.
+		uint64_t maxFileBytes = 4ull * 1024 * 1024;
+
+		// Uncompressed bytes taken from candidates, in total. 0 is
+		// unlimited. Buffers added with AddBuffer() do not count.
+		uint64_t maxTotalBytes = 40ull * 1024 * 1024;
+
+		// How much of a truncated log's limit goes to its head; the
+		// rest goes to its tail.
+		uint64_t logHeadBytes = 512 * 1024;
+	};
+
+	struct Candidate {
+		std::string localPath;
+		std::string zipPath;
+		uint64_t size = 0;
+
+		int priority = PRIORITY_NORMAL;
+
+		// 0 uses Options::maxFileBytes.
+		uint64_t maxBytes = 0;
+	};
+
+	// Polled between candidates; true stops adding them.
+	typedef std::function<bool()> cancelled_t;
+
+	enum class Disposition { Included, Truncated, Omitted };
+
+	struct Decision {
+		Candidate candidate;
+		Disposition disposition = Disposition::Omitted;
+
+		// Bytes of the file that go into the archive.
+		uint64_t headBytes = 0;
+		uint64_t tailBytes = 0;
+
+		// Why an omitted candidate was omitted.
+		std::string reason;
+
+		uint64_t GetBytes() const { return headBytes + tailBytes; }
+	};
+
+public:
+	StreamElementsDiagnosticsArchive(Options options);
+	~StreamElementsDiagnosticsArchive();
+
+	bool Open(const std::string &path);
+
+	void AddBuffer(std::string content, const std::string &zipPath);
+
+	// Plans `candidates` and queues what the plan includes, in plan
+	// order. Returns the plan, omitted candidates included. Candidates
+	// not yet queued when `cancelled` returns true are omitted as
+	// "cancelled".
+	std::vector<Decision> AddCandidates(std::vector<Candidate> candidates,
+					    cancelled_t cancelled = nullptr);
+
+	// Waits for every queued entry and finalizes the archive.
+	bool Close();
+
+	StreamElementsParallelZipWriter::Stats GetStats();
+
+	void SetProgressCallback(
+		StreamElementsParallelZipWriter::progress_callback_t callback);
+
+	/* ----------------------------------------------------------------- */
+
+	static std::vector<Decision> Plan(std::vector<Candidate> candidates,
+					  const Options &options);
+
+	// Human-readable summary of a plan: totals, limits and every omitted
+	// or truncated file.
+	static std::vector<std::string>
+	DescribePlan(const std::vector<Decision> &plan, const Options &options);
+
+	// True for text logs (.log, .txt), which are truncated rather than
+	// omitted when over their limit.
+	static bool IsLogFile(const std::string &zipPath);
+
+	// Reads up to `headBytes` from the start of `path` and `tailBytes` from
+	// its end, joined by a truncation marker when anything lies between
+	// them. Cuts are moved to line boundaries when one is near.
+	static bool ReadSlices(const std::string &path, uint64_t headBytes,
+			       uint64_t tailBytes, std::string &content);
+
+	static std::string GetTruncationMarker(uint64_t truncatedBytes);
+
+private:
+	Options m_options;
+
+	StreamElementsParallelZipWriter m_writer;
+};
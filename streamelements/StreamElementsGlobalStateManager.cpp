@@ -4,6 +4,7 @@
 #include "Version.hpp"
 #include "StreamElementsBrowserDialog.hpp"
 #include "StreamElementsReportIssueDialog.hpp"
+#include "StreamElementsWorkspaceSnapshot.hpp"
 
 #include "base64/base64.hpp"
 #include "json11/json11.hpp"
@@ -21,6 +22,7 @@
 #ifndef WIN32
 #include <errno.h>
 #include <string.h>
+#include <climits>
 #endif
 
 #include <future>
@@ -344,6 +346,39 @@ bool StreamElementsGlobalStateManager::IsInstanceAvailable()
 	return s_instance->IsInitialized();
 }
 
+// Events which describe current state, and are replayed to browsers which
+// ask for it when they register.
+static void add_state_events(StreamElementsWebsocketApiServer *server)
+{
+	for (auto name : {"Streaming", "Recording"}) {
+		const std::string prefix = std::string("host") + name;
+
+		for (auto state : {"Starting", "Started", "Stopping", "Stopped"})
+			server->AddStateEvent(prefix + state, prefix + "State");
+	}
+
+	for (auto name : {"StreamingOutput", "RecordingOutput",
+			  "ReplayBufferOutput"}) {
+		const std::string prefix = std::string("host") + name;
+
+		for (auto state : {"Starting", "Started", "Stopping", "Stopped",
+				   "Reconnecting", "Reconnected"})
+			server->AddStateEvent(prefix + state, prefix + "State",
+					      "outputId");
+
+		for (auto state : {"Paused", "Unpaused"})
+			server->AddStateEvent(prefix + state,
+					      prefix + "PauseState", "outputId");
+	}
+
+	server->AddStateEvent("hostActiveSceneChanged",
+			      "hostActiveSceneChanged", "videoCompositionId");
+	server->AddStateEvent("hostActiveTransitionChanged",
+			      "hostActiveTransitionChanged",
+			      "videoCompositionId");
+	server->AddStateEvent("hostUIThemeChanged", "hostUIThemeChanged");
+}
+
 #include <QWindow>
 #include <QObjectList>
 
@@ -358,6 +393,12 @@ void StreamElementsGlobalStateManager::Initialize(QMainWindow *obs_main_window)
 	// returns nullptr when crash reporting is compiled out.
 	m_crashHandler = StreamElementsCrashHandler::Create();
 
+	// --setrace turns on everything, including debug messages.
+	StreamElementsAsyncLog::GetInstance()->SetMinLevel(
+		IsTraceLogLevel()
+			? LOG_DEBUG
+			: StreamElementsConfig::GetInstance()->GetLogMinLevel());
+
 	/*
 	struct local_context {
 		StreamElementsGlobalStateManager *self;
@@ -455,7 +496,12 @@ void StreamElementsGlobalStateManager::Initialize(QMainWindow *obs_main_window)
 			mainWindow());
 
 	m_websocketApiServer = std::make_shared<
-		StreamElementsWebsocketApiServer>();
+		StreamElementsWebsocketApiServer>(
+		StreamElementsConfig::GetInstance()
+			->GetWebsocketApiServerIoThreadCount(),
+		StreamElementsConfig::GetInstance()
+			->GetWebsocketApiServerWorkerThreadCount());
+	add_state_events(m_websocketApiServer.get());
 	m_windowStateEventFilter =
 		std::make_shared<WindowStateChangeEventFilter>(
 			mainWindow());
@@ -1040,6 +1086,265 @@ bool StreamElementsGlobalStateManager::DeserializeUserInterfaceState(
 	return result;
 }
 
+// Workspace snapshots are serialized straight to CefValue.
+struct cef_workspace_snapshot_traits {
+	typedef CefRefPtr<CefValue> value_t;
+
+	static value_t Bool(bool value)
+	{
+		value_t result = CefValue::Create();
+		result->SetBool(value);
+		return result;
+	}
+
+	static value_t Number(double value)
+	{
+		value_t result = CefValue::Create();
+
+		if (value >= INT_MIN && value <= INT_MAX && value == (int)value)
+			result->SetInt((int)value);
+		else
+			result->SetDouble(value);
+
+		return result;
+	}
+
+	static value_t Array(const std::vector<value_t> &items)
+	{
+		CefRefPtr<CefListValue> list = CefListValue::Create();
+
+		for (auto &item : items)
+			list->SetValue(list->GetSize(), item);
+
+		value_t result = CefValue::Create();
+		result->SetList(list);
+		return result;
+	}
+
+	static value_t Object(const std::map<std::string, value_t> &items)
+	{
+		CefRefPtr<CefDictionaryValue> d = CefDictionaryValue::Create();
+
+		for (auto &kv : items)
+			d->SetValue(kv.first, kv.second);
+
+		value_t result = CefValue::Create();
+		result->SetDictionary(d);
+		return result;
+	}
+
+	static bool IsString(const value_t &value)
+	{
+		return value.get() && value->GetType() == VTYPE_STRING;
+	}
+
+	static std::string GetString(const value_t &value)
+	{
+		return value->GetString().ToString();
+	}
+
+	static bool IsArray(const value_t &value)
+	{
+		return value.get() && value->GetType() == VTYPE_LIST;
+	}
+
+	static bool IsObject(const value_t &value)
+	{
+		return value.get() && value->GetType() == VTYPE_DICTIONARY;
+	}
+
+	static value_t Get(const value_t &value, const std::string &key)
+	{
+		if (IsObject(value) && value->GetDictionary()->HasKey(key))
+			return value->GetDictionary()->GetValue(key);
+
+		return CefValue::Create();
+	}
+
+	template<typename TFunc>
+	static void ForEachArrayItem(const value_t &value, TFunc &&func)
+	{
+		if (!IsArray(value))
+			return;
+
+		CefRefPtr<CefListValue> list = value->GetList();
+
+		for (size_t i = 0; i < list->GetSize(); ++i)
+			func(list->GetValue(i));
+	}
+
+	template<typename TFunc>
+	static void ForEachObjectItem(const value_t &value, TFunc &&func)
+	{
+		if (!IsObject(value))
+			return;
+
+		CefRefPtr<CefDictionaryValue> d = value->GetDictionary();
+
+		CefDictionaryValue::KeyList keys;
+		d->GetKeys(keys);
+
+		for (auto &key : keys)
+			func(key.ToString(), d->GetValue(key));
+	}
+};
+
+void StreamElementsGlobalStateManager::SerializeWorkspaceSnapshot(
+	CefRefPtr<CefValue> input, CefRefPtr<CefValue> &output)
+{
+	auto videoCompositionManager = m_videoCompositionManager;
+	auto audioCompositionManager = m_audioCompositionManager;
+	auto outputManager = m_outputManager;
+	auto sceneManager = m_obsSceneManager;
+	auto websocketApiServer = m_websocketApiServer;
+
+	output->SetNull();
+
+	if (!videoCompositionManager || !audioCompositionManager ||
+	    !outputManager || !sceneManager)
+		return;
+
+	StreamElementsWorkspaceSnapshot<cef_workspace_snapshot_traits> snapshot(
+		[websocketApiServer]() {
+			return websocketApiServer
+				       ? websocketApiServer->GetEventGeneration()
+				       : (uint64_t)0;
+		});
+
+	// Compositions and their scene lists, serialized once per attempt for
+	// every section which needs them
+	typedef std::vector<std::pair<std::string, CefRefPtr<CefValue>>>
+		scene_lists_t;
+
+	struct attempt_state_t {
+		CefRefPtr<CefValue> videoCompositions;
+
+		// Scene list of each composition, in composition order
+		bool hasScenes = false;
+		scene_lists_t scenes;
+	};
+
+	auto state = std::make_shared<attempt_state_t>();
+
+	snapshot.SetAttemptCallback([state]() { *state = attempt_state_t(); });
+
+	auto getVideoCompositions = [state, videoCompositionManager]() {
+		if (!state->videoCompositions.get()) {
+			state->videoCompositions = CefValue::Create();
+			videoCompositionManager->SerializeAllCompositions(
+				state->videoCompositions);
+		}
+
+		return state->videoCompositions;
+	};
+
+	auto getScenes = [state, sceneManager,
+			  getVideoCompositions]() -> const scene_lists_t & {
+		if (!state->hasScenes) {
+			state->hasScenes = true;
+
+			cef_workspace_snapshot_traits::ForEachObjectItem(
+				getVideoCompositions(),
+				[&](const std::string &videoCompositionId,
+				    const CefRefPtr<CefValue> &) {
+					CefRefPtr<CefValue> request =
+						CefValue::Create();
+					CefRefPtr<CefDictionaryValue> d =
+						CefDictionaryValue::Create();
+					d->SetString("videoCompositionId",
+						     videoCompositionId);
+					request->SetDictionary(d);
+
+					CefRefPtr<CefValue> scenes =
+						CefValue::Create();
+					sceneManager->SerializeObsScenes(request,
+									 scenes);
+
+					state->scenes.push_back(
+						{videoCompositionId, scenes});
+				});
+		}
+
+		return state->scenes;
+	};
+
+	// Sections hand out copies: the snapshot takes ownership of what it is
+	// given, and the attempt state is still read by later sections.
+	snapshot.AddSection("videoCompositions", [getVideoCompositions]() {
+		return getVideoCompositions()->Copy();
+	});
+
+	// { "<videoCompositionId>": [ scene, ... ], ... }
+	snapshot.AddSection("scenes", [getScenes]() {
+		CefRefPtr<CefDictionaryValue> d = CefDictionaryValue::Create();
+
+		for (auto &kv : getScenes())
+			d->SetValue(kv.first, kv.second->Copy());
+
+		CefRefPtr<CefValue> result = CefValue::Create();
+		result->SetDictionary(d);
+		return result;
+	});
+
+	// { "<sceneId>": [ sceneItem, ... ], ... }
+	snapshot.AddSection("sceneItems", [getScenes, sceneManager]() {
+		CefRefPtr<CefDictionaryValue> d = CefDictionaryValue::Create();
+
+		for (auto &kv : getScenes()) {
+			cef_workspace_snapshot_traits::ForEachArrayItem(
+				kv.second, [&](const CefRefPtr<CefValue> &scene) {
+					auto id = cef_workspace_snapshot_traits::Get(
+						scene, "id");
+
+					if (!cef_workspace_snapshot_traits::IsString(
+						    id) ||
+					    id->GetString().empty())
+						return;
+
+					CefRefPtr<CefValue> request =
+						CefValue::Create();
+					CefRefPtr<CefDictionaryValue> args =
+						CefDictionaryValue::Create();
+					args->SetString("videoCompositionId",
+							kv.first);
+					args->SetString("id", id->GetString());
+					request->SetDictionary(args);
+
+					CefRefPtr<CefValue> items =
+						CefValue::Create();
+					sceneManager->SerializeObsSceneItems(
+						request, items, false);
+
+					d->SetValue(id->GetString(), items);
+				});
+		}
+
+		CefRefPtr<CefValue> result = CefValue::Create();
+		result->SetDictionary(d);
+		return result;
+	});
+
+	auto addOutputsSection = [&](const char *name, ObsOutputType type) {
+		snapshot.AddSection(name, [outputManager, type]() {
+			CefRefPtr<CefValue> result = CefValue::Create();
+			outputManager->SerializeAllOutputs(type, result);
+			return result;
+		});
+	};
+
+	addOutputsSection("streamingOutputs", StreamingOutput);
+	addOutputsSection("recordingOutputs", RecordingOutput);
+	addOutputsSection("replayBufferOutputs", ReplayBufferOutput);
+
+	snapshot.AddSection("audioCompositions", [audioCompositionManager]() {
+		CefRefPtr<CefValue> result = CefValue::Create();
+		audioCompositionManager->SerializeAllCompositions(result);
+		return result;
+	});
+
+	output = snapshot.Capture(input);
+}
+
 void StreamElementsGlobalStateManager::PersistState(bool sendEventToGuest)
 {
 	PREVENT_RECURSIVE_REENTRY();
@@ -230,6 +230,9 @@ public:
 	void SerializeUserInterfaceState(CefRefPtr<CefValue> &output);
 	bool DeserializeUserInterfaceState(CefRefPtr<CefValue> input);
 
+	void SerializeWorkspaceSnapshot(CefRefPtr<CefValue> input,
+					CefRefPtr<CefValue> &output);
+
 public:
 	std::shared_ptr<std::promise<CefRefPtr<CefValue>>>
 	DeserializeNonModalDialog(CefRefPtr<CefValue> input);
@@ -2,14 +2,20 @@
 #include "StreamElementsUtils.hpp"
 
 StreamElementsHttpServerManager::StreamElementsHttpServerManager(
-	HttpServer::request_handler_t handler)
-	: m_handler(handler)
+	HttpServer::request_handler_t handler, size_t threadCount,
+	std::shared_ptr<StreamElementsSharedHttpServer> sharedServer)
+	: m_handler(handler),
+	  m_threadCount(threadCount),
+	  m_sharedServer(sharedServer)
 {
 }
 
 StreamElementsHttpServerManager::~StreamElementsHttpServerManager()
 {
-	m_servers.clear();
+	std::lock_guard<decltype(m_mutex)> guard(m_mutex);
+
+	while (!m_servers.empty())
+		RemoveServer(m_servers.begin()->first);
 }
 
 void StreamElementsHttpServerManager::DeserializeHttpServer(
@@ -26,6 +32,7 @@ void StreamElementsHttpServerManager::DeserializeHttpServer(
 
 	int portNumber = 0;
 	std::string ipAddress = "127.0.0.1";
+	bool usePathPrefix = false;
 
 	if (d->HasKey("portNumber") && d->GetType("portNumber") == VTYPE_INT) {
 		portNumber = d->GetInt("portNumber");
@@ -35,23 +42,36 @@ void StreamElementsHttpServerManager::DeserializeHttpServer(
 		ipAddress = d->GetString("ipAddress").ToString();
 	}
 
+	if (d->HasKey("usePathPrefix") &&
+	    d->GetType("usePathPrefix") == VTYPE_BOOL) {
+		usePathPrefix = d->GetBool("usePathPrefix");
+	}
+
 	std::string id = CreateGloballyUniqueIdString();
-	std::shared_ptr<HttpServer> server = std::make_shared<HttpServer>(m_handler);
 
-	portNumber = server->Start(portNumber, ipAddress);
+	Server entry;
 
-	if (portNumber > 0) {
-		m_servers[id] = server;
+	if (usePathPrefix && m_sharedServer && portNumber <= 0 &&
+	    ipAddress == m_sharedServer->GetIpAddress()) {
+		entry.route = m_sharedServer->AddRoute(m_handler);
 
-		CefRefPtr<CefDictionaryValue> result =
-			CefDictionaryValue::Create();
+		if (entry.route.empty())
+			return;
 
-		result->SetString("id", id.c_str());
-		result->SetInt("portNumber", portNumber);
-		result->SetString("ipAddress", ipAddress.c_str());
+		entry.portNumber = m_sharedServer->GetPortNumber();
+	} else {
+		entry.server = std::make_shared<HttpServer>(m_handler,
+							    m_threadCount);
 
-		output->SetDictionary(result);
+		entry.portNumber = entry.server->Start(portNumber, ipAddress);
+
+		if (entry.portNumber <= 0)
+			return;
 	}
+
+	m_servers[id] = entry;
+
+	output->SetDictionary(SerializeServer(id, entry));
 }
 
 void StreamElementsHttpServerManager::SerializeHttpServers(
@@ -62,16 +82,8 @@ void StreamElementsHttpServerManager::SerializeHttpServers(
 	CefRefPtr<CefListValue> list = CefListValue::Create();
 
 	for (auto kv : m_servers) {
-		auto id = kv.first;
-		auto server = kv.second;
-
-		CefRefPtr<CefDictionaryValue> d = CefDictionaryValue::Create();
-
-		d->SetString("id", id.c_str());
-		d->SetString("ipAddress", server->GetIpAddress().c_str());
-		d->SetInt("portNumber", server->GetPortNumber());
-
-		list->SetDictionary(list->GetSize(), d);
+		list->SetDictionary(list->GetSize(),
+				    SerializeServer(kv.first, kv.second));
 	}
 
 	output->SetList(list);
@@ -83,24 +95,53 @@ void StreamElementsHttpServerManager::RemoveHttpServersByIds(
 	std::lock_guard<decltype(m_mutex)> guard(m_mutex);
 
 	if (input->GetType() == VTYPE_STRING) {
-		std::string id = input->GetString().ToString();
-
-		if (m_servers.count(id)) {
-			m_servers.erase(id);
-		}
+		RemoveServer(input->GetString().ToString());
 	} else if (input->GetType() == VTYPE_LIST) {
 		CefRefPtr<CefListValue> list = input->GetList();
 
 		for (size_t index = 0; index < list->GetSize(); ++index) {
 			if (list->GetType(index) == VTYPE_STRING) {
-				std::string id = list->GetString(index);
-
-				if (m_servers.count(id)) {
-					m_servers.erase(id);
-				}
+				RemoveServer(list->GetString(index));
 			}
 		}
 	}
 
 	output->SetBool(true);
 }
+
+void StreamElementsHttpServerManager::RemoveServer(std::string id)
+{
+	auto it = m_servers.find(id);
+
+	if (it == m_servers.end())
+		return;
+
+	if (!it->second.route.empty())
+		m_sharedServer->RemoveRoute(it->second.route);
+
+	m_servers.erase(it);
+}
+
+CefRefPtr<CefDictionaryValue>
+StreamElementsHttpServerManager::SerializeServer(std::string id,
+						 const Server &server)
+{
+	CefRefPtr<CefDictionaryValue> d = CefDictionaryValue::Create();
+
+	d->SetString("id", id.c_str());
+	d->SetInt("portNumber", server.portNumber);
+
+	if (server.server) {
+		d->SetString("ipAddress", server.server->GetIpAddress().c_str());
+		d->SetString("pathPrefix", "");
+	} else {
+		d->SetString("ipAddress",
+			     m_sharedServer->GetIpAddress().c_str());
+		d->SetString("pathPrefix",
+			     StreamElementsSharedHttpServer::GetRoutePathPrefix(
+				     server.route)
+				     .c_str());
+	}
+
+	return d;
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "deps/server/HttpServer.hpp"
+#include "StreamElementsSharedHttpServer.hpp"
 
 #include <string>
 #include <map>
@@ -8,10 +9,28 @@
 
 #include "cef-headers.hpp"
 
+//
+// The HTTP servers of one browser.
+//
+// A server is a dedicated HttpServer, which receives requests at their
+// original paths. A caller which sets "usePathPrefix" gets a route on the
+// StreamElementsSharedHttpServer instead: its requests arrive under the path
+// prefix reported as "pathPrefix". A caller asking for a specific port or a
+// non-loopback address always gets a dedicated HttpServer, since a route
+// cannot honour either.
+//
+// Only routes share a thread pool. Each dedicated HttpServer still brings
+// its own, so the thread count is bounded only for callers which opt in.
+//
 class StreamElementsHttpServerManager
 {
 public:
-	StreamElementsHttpServerManager(HttpServer::request_handler_t handler);
+	// `threadCount` is passed on to every dedicated HttpServer created; 0
+	// keeps httplib's default.
+	StreamElementsHttpServerManager(
+		HttpServer::request_handler_t handler, size_t threadCount = 0,
+		std::shared_ptr<StreamElementsSharedHttpServer> sharedServer =
+			nullptr);
 	~StreamElementsHttpServerManager();
 
 	void DeserializeHttpServer(CefRefPtr<CefValue> input,
@@ -22,8 +41,24 @@ public:
 	void RemoveHttpServersByIds(CefRefPtr<CefValue> input,
 				    CefRefPtr<CefValue> &output);
 
+private:
+	struct Server {
+		// Either a dedicated server...
+		std::shared_ptr<HttpServer> server;
+
+		// ...or a route on the shared one.
+		std::string route;
+		int portNumber = 0;
+	};
+
+	void RemoveServer(std::string id);
+	CefRefPtr<CefDictionaryValue> SerializeServer(std::string id,
+						      const Server &server);
+
 private:
 	std::recursive_mutex m_mutex;
-	std::map<std::string, std::shared_ptr<HttpServer>> m_servers;
+	std::map<std::string, Server> m_servers;
 	HttpServer::request_handler_t m_handler;
+	size_t m_threadCount;
+	std::shared_ptr<StreamElementsSharedHttpServer> m_sharedServer;
 };
@@ -1,5 +1,6 @@
 #include "StreamElementsLocalFilesystemHttpServer.hpp" 
 #include "StreamElementsUtils.hpp"
+#include "StreamElementsAsyncLog.hpp"
 
 #include <obs.h>
 #include <QUrl>
@@ -32,9 +33,9 @@ StreamElementsLocalFilesystemHttpServer() {
 		std::string path;
 
 		if (!VerifySessionSignedAbsolutePathURL(urlString, path)) {
-			blog(LOG_WARNING,
-			     "StreamElementsLocalFilesystemHttpServer: invalid request signature: %s",
-			     urlString.c_str());
+			SE_LOG(LOG_WARNING,
+			       "StreamElementsLocalFilesystemHttpServer: invalid request signature: %s",
+			       urlString.c_str());
 
 			res.status = 429;
 			res.reason = "Invalid Request Signature";
@@ -43,9 +44,9 @@ StreamElementsLocalFilesystemHttpServer() {
 				"application/json");
 		}
 
-		blog(LOG_INFO,
-			"StreamElementsLocalFilesystemHttpServer: serving file from path: %s",
-			path.c_str());
+		SE_LOG(LOG_INFO,
+		       "StreamElementsLocalFilesystemHttpServer: serving file from path: %s",
+		       path.c_str());
 
 		#ifdef _WIN32
 		std::wstring wpath = utf8_to_wstring(path);
@@ -55,9 +56,9 @@ StreamElementsLocalFilesystemHttpServer() {
 		#endif
 
 		if (handle < 0) {
-			blog(LOG_WARNING,
-				"StreamElementsLocalFilesystemHttpServer: file not found: %s",
-				path.c_str());
+			SE_LOG(LOG_WARNING,
+			       "StreamElementsLocalFilesystemHttpServer: file not found: %s",
+			       path.c_str());
 
 			res.status = 404;
 			res.reason = "Not Found";
@@ -0,0 +1,251 @@
+#include "StreamElementsLogRing.hpp"
+#include "StreamElementsUtilsBase.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <pthread.h>
+#else
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+static uint32_t GetCurrentThreadIdCached()
+{
+	// The OS id, so records can be matched against the OBS log; looked up
+	// once per thread since it is a system call on Linux.
+	static thread_local uint32_t id = []() -> uint32_t {
+#ifdef _WIN32
+		return (uint32_t)GetCurrentThreadId();
+#elif defined(__APPLE__)
+		uint64_t tid = 0;
+		pthread_threadid_np(nullptr, &tid);
+		return (uint32_t)tid;
+#else
+		return (uint32_t)syscall(SYS_gettid);
+#endif
+	}();
+
+	return id;
+}
+
+// Wall clock, nanoseconds since the epoch, from the cheap tick-resolution
+// clock where there is one: the precise clocks cost more than the rest of an
+// append put together, and records are ordered by sequence, not by time.
+static int64_t GetCoarseTimestamp()
+{
+#ifdef _WIN32
+	FILETIME fileTime;
+	GetSystemTimeAsFileTime(&fileTime);
+
+	// 100ns units since 1601-01-01.
+	const uint64_t ticks = ((uint64_t)fileTime.dwHighDateTime << 32) |
+			       fileTime.dwLowDateTime;
+
+	return (int64_t)(ticks - 116444736000000000ull) * 100;
+#elif defined(CLOCK_REALTIME_COARSE)
+	struct timespec now;
+	clock_gettime(CLOCK_REALTIME_COARSE, &now);
+
+	return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+#else
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		       std::chrono::system_clock::now().time_since_epoch())
+		.count();
+#endif
+}
+
+/* ================================================================= */
+
+StreamElementsLogRing::StreamElementsLogRing(size_t capacity)
+	: m_next(0), m_dropped(0)
+{
+	capacity = RoundUpToPowerOfTwo(std::max<size_t>(capacity, 2));
+
+	m_slots.reset(new Slot[capacity]);
+	m_mask = capacity - 1;
+
+	for (size_t i = 0; i < capacity; ++i)
+		m_slots[i].stamp.store(0, std::memory_order_relaxed);
+}
+
+StreamElementsLogRing::~StreamElementsLogRing() {}
+
+void StreamElementsLogRing::Append(Category category, const char *message,
+				   size_t size)
+{
+	const uint64_t sequence =
+		m_next.fetch_add(1, std::memory_order_relaxed);
+
+	Slot &slot = m_slots[sequence & m_mask];
+
+	// Claim the slot. It may still be held by a writer a full lap behind,
+	// or already hold a newer record if this writer stalled for a lap; the
+	// record is dropped in both cases rather than waited for or torn.
+	uint64_t stamp = slot.stamp.load(std::memory_order_relaxed);
+
+	if ((stamp & 1) || stamp > 2 * sequence ||
+	    !slot.stamp.compare_exchange_strong(stamp, 2 * sequence + 1,
+						std::memory_order_acquire,
+						std::memory_order_relaxed)) {
+		m_dropped.fetch_add(1, std::memory_order_relaxed);
+
+		return;
+	}
+
+	// Keeps the writes below from becoming visible before the claim.
+	std::atomic_thread_fence(std::memory_order_release);
+
+	size = std::min(size, MAX_MESSAGE_SIZE);
+
+	slot.timestamp = GetCoarseTimestamp();
+	slot.thread = GetCurrentThreadIdCached();
+	slot.category = (uint8_t)category;
+	slot.size = (uint8_t)size;
+	memcpy(slot.message, message, size);
+
+	slot.stamp.store(2 * (sequence + 1), std::memory_order_release);
+}
+
+void StreamElementsLogRing::Append(Category category, const char *message)
+{
+	Append(category, message, strlen(message));
+}
+
+void StreamElementsLogRing::AppendFormat(Category category,
+					 const char *format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	AppendFormatV(category, format, args);
+	va_end(args);
+}
+
+void StreamElementsLogRing::AppendFormatV(Category category,
+					  const char *format, va_list args)
+{
+	char buffer[MAX_MESSAGE_SIZE + 1];
+
+	const int result = vsnprintf(buffer, sizeof(buffer), format, args);
+
+	if (result < 0)
+		return;
+
+	Append(category, buffer,
+	       std::min<size_t>((size_t)result, MAX_MESSAGE_SIZE));
+}
+
+std::vector<StreamElementsLogRing::Record>
+StreamElementsLogRing::Snapshot() const
+{
+	std::vector<Record> result;
+	result.reserve(GetCapacity());
+
+	for (size_t i = 0; i <= m_mask; ++i) {
+		const Slot &slot = m_slots[i];
+
+		const uint64_t before = slot.stamp.load(std::memory_order_acquire);
+
+		if (!before || (before & 1))
+			continue;
+
+		Record record;
+
+		record.timestamp = slot.timestamp;
+		record.thread = slot.thread;
+		record.category = (Category)slot.category;
+
+		const size_t size = std::min<size_t>(slot.size, MAX_MESSAGE_SIZE);
+		record.message.assign(slot.message, size);
+
+		// Seqlock read: the copy counts only if nobody claimed the slot
+		// while it was being made.
+		std::atomic_thread_fence(std::memory_order_acquire);
+
+		if (slot.stamp.load(std::memory_order_relaxed) != before)
+			continue;
+
+		record.sequence = before / 2 - 1;
+
+		result.push_back(std::move(record));
+	}
+
+	std::sort(result.begin(), result.end(),
+		  [](const Record &a, const Record &b) {
+			  return a.sequence < b.sequence;
+		  });
+
+	return result;
+}
+
+const char *StreamElementsLogRing::GetCategoryName(Category category)
+{
+	switch (category) {
+	case Category::Info:
+		return "info";
+	case Category::Warning:
+		return "warning";
+	case Category::Error:
+		return "error";
+	case Category::ApiCall:
+		return "api-call";
+	case Category::ApiReturn:
+		return "api-return";
+	case Category::Event:
+		return "event";
+	}
+
+	return "unknown";
+}
+
+std::string StreamElementsLogRing::FormatRecord(const Record &record)
+{
+	const time_t seconds = (time_t)(record.timestamp / 1000000000);
+	const int millis = (int)((record.timestamp / 1000000) % 1000);
+
+	struct tm local = {};
+#ifdef _WIN32
+	localtime_s(&local, &seconds);
+#else
+	localtime_r(&seconds, &local);
+#endif
+
+	char prefix[96];
+	snprintf(prefix, sizeof(prefix),
+		 "%04d-%02d-%02d %02d:%02d:%02d.%03d [%u] %-10s ",
+		 local.tm_year + 1900, local.tm_mon + 1, local.tm_mday,
+		 local.tm_hour, local.tm_min, local.tm_sec, millis,
+		 record.thread, GetCategoryName(record.category));
+
+	return prefix + record.message;
+}
+
+std::string StreamElementsLogRing::Format() const
+{
+	std::string result;
+
+	for (auto &record : Snapshot()) {
+		result += FormatRecord(record);
+		result += "\n";
+	}
+
+	return result;
+}
+
+StreamElementsLogRing *StreamElementsLogRing::GetInstance()
+{
+	// 4096 records, 1MB.
+	static StreamElementsLogRing *s_instance =
+		new StreamElementsLogRing(4096);
+
+	return s_instance;
+}
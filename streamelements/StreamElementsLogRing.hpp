@@ -0,0 +1,112 @@
+#pragma once
+
+#include <atomic>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+//
+// Fixed-size, lock-free, in-memory record of recent plugin activity: API
+// calls, events, warnings and errors, each with a timestamp and thread id.
+//
+// Crash and issue reports used to recover recent activity only from the OBS
+// log files on disk. The lines that matter most are the last ones before a
+// crash, and those are often still sitting in an unflushed buffer. Reading
+// and redacting multi-megabyte logs was also the slowest part of building a
+// report. The ring keeps the last GetCapacity() records in memory, and the
+// report collectors write them out as a single file.
+//
+// Append() takes a sequence number with one atomic increment, claims the
+// matching slot with a compare-and-swap on its stamp, and publishes the slot
+// by storing the final stamp. There is no lock and no allocation, so any
+// thread can call it at any rate. Messages longer than MAX_MESSAGE_SIZE are
+// cut short.
+//
+// Snapshot() can run while writers append, including from a crash handler
+// while other threads are suspended mid-append. A slot that is being
+// written, or that is rewritten while it is being copied, is skipped rather
+// than returned torn. A writer that laps the ring onto a slot another
+// writer still holds drops its record and counts it in GetDroppedCount().
+//
+class StreamElementsLogRing {
+public:
+	enum class Category : uint8_t {
+		Info,
+		Warning,
+		Error,
+		ApiCall,
+		ApiReturn,
+		Event
+	};
+
+	// One slot is 256 bytes, header included.
+	static constexpr size_t MAX_MESSAGE_SIZE = 232;
+
+	struct Record {
+		uint64_t sequence = 0;
+
+		// System clock, nanoseconds since the epoch.
+		int64_t timestamp = 0;
+
+		uint32_t thread = 0;
+		Category category = Category::Info;
+
+		std::string message;
+	};
+
+public:
+	// `capacity` is rounded up to a power of two.
+	StreamElementsLogRing(size_t capacity);
+	~StreamElementsLogRing();
+
+	void Append(Category category, const char *message, size_t size);
+	void Append(Category category, const char *message);
+
+	// Formats into a stack buffer; nothing is allocated.
+	void AppendFormat(Category category, const char *format, ...);
+	void AppendFormatV(Category category, const char *format,
+			   va_list args);
+
+	// Complete records, oldest first.
+	std::vector<Record> Snapshot() const;
+
+	// Snapshot() as text, one line per record.
+	std::string Format() const;
+
+	static std::string FormatRecord(const Record &record);
+	static const char *GetCategoryName(Category category);
+
+	size_t GetCapacity() const { return m_mask + 1; }
+	uint64_t GetAppendCount() const { return m_next.load(); }
+	uint64_t GetDroppedCount() const { return m_dropped.load(); }
+
+	// Process-wide ring the plugin records into. Never destroyed, so it
+	// stays usable from a crash during shutdown.
+	static StreamElementsLogRing *GetInstance();
+
+private:
+	struct alignas(64) Slot {
+		// 0: never written. Odd: being written. Otherwise
+		// 2 * (sequence + 1).
+		std::atomic<uint64_t> stamp;
+
+		int64_t timestamp;
+		uint32_t thread;
+		uint8_t category;
+		uint8_t size;
+
+		char message[MAX_MESSAGE_SIZE];
+	};
+
+	static_assert(sizeof(Slot) == 256, "slot layout");
+
+private:
+	std::unique_ptr<Slot[]> m_slots;
+	size_t m_mask = 0;
+
+	alignas(64) std::atomic<uint64_t> m_next;
+	alignas(64) std::atomic<uint64_t> m_dropped;
+};
@@ -1,6 +1,9 @@
 #include "StreamElementsMessageBus.hpp"
 #include "StreamElementsConfig.hpp"
 #include "StreamElementsGlobalStateManager.hpp"
+#include "StreamElementsLogRing.hpp"
+
+#include <algorithm>
 
 std::shared_ptr<StreamElementsMessageBus> StreamElementsMessageBus::s_instance = nullptr;
 
@@ -19,6 +22,8 @@ const char* const StreamElementsMessageBus::SOURCE_WEB = "web";
 const char* const StreamElementsMessageBus::SOURCE_EXTERNAL = "external";
 
 StreamElementsMessageBus::StreamElementsMessageBus(Private) :
+	m_listener_routes({DEST_ALL, DEST_ALL_LOCAL, DEST_UI, DEST_WORKER,
+			   DEST_BROWSER_SOURCE}),
 	m_external_controller_server(this)
 {
 
@@ -47,7 +52,7 @@ void StreamElementsMessageBus::AddListener(std::string target, message_destinati
 {
 	std::lock_guard<std::recursive_mutex> guard(m_listener_list_mutex);
 
-	m_listener_list[target] = std::make_shared<ListenerItem>(target, type);
+	m_listener_routes.Set(target, type);
 
 	auto httpRequestHandler = [this, target](const HttpServer::request_t &req,
 					 HttpServer::response_t &res) -> void {
@@ -90,56 +95,57 @@ void StreamElementsMessageBus::AddListener(std::string target, message_destinati
 
 		root->SetDictionary(rootDict);
 
-		auto requestState = std::make_shared<WaitingHttpRequestState>(&req,
-									      &res);
-		
-		{
-			std::lock_guard<decltype(m_waiting_http_requests_mutex)>
-				guard(m_waiting_http_requests_mutex);
+		// Registered before it is forwarded, so that an answer arriving
+		// straight away finds it.
+		if (!m_waiting_http_requests.Begin(requestId)) {
+			res.status = 503;
+			res.reason = "Too Many Waiting Requests";
 
-			m_waiting_http_requests[requestId] = requestState;
-				
+			return;
 		}
 
 		NotifyEventListener(target, "browser", "http",
 				    "urn:http:server:browser",
 				    "hostMessageReceived", root);
 
-		bool requestHandled = false;
-		
-		for (int i = 0; i < 15000 / 10 && !requestHandled; ++i) {
-			if (requestState->future.wait_for(std::chrono::milliseconds(10)) != std::future_status::timeout)
-			{
-				requestHandled = true;
-			} else {
-				QApplication::processEvents();
-			}
-		}
-		
-		if (!requestHandled) {
-			// Nobody handled the request
-			res.status = 404;
-			res.reason = "Request Not Handled";
-		}
-
-		{
-			std::lock_guard<decltype(m_waiting_http_requests_mutex)>
-				guard(m_waiting_http_requests_mutex);
-
-			m_waiting_http_requests.erase(requestId);
-		}
+		// Blocks this HTTP worker until the browser answers through
+		// DeserializeHttpRequestResponse() or the request times out.
+		m_waiting_http_requests.Wait(requestId, res);
 	};
 
+	StreamElementsPendingHttpRequests::Options options;
+
+	options.timeout = std::chrono::milliseconds(
+		StreamElementsConfig::GetInstance()
+			->GetMessageBusHttpRequestTimeoutMs());
+	options.maxWaitingRequests = std::max(
+		1, StreamElementsConfig::GetInstance()
+			   ->GetMessageBusHttpMaxWaitingRequests());
+
+	m_waiting_http_requests.SetOptions(options);
+
+	// The shared server gets one thread more than may wait, so that a
+	// request past the cap is still refused promptly. This bounds the
+	// threads of listeners whose servers opt in to "usePathPrefix" only.
+	// Every other server is a dedicated HttpServer with httplib's default
+	// pool: the wait cap is shared by all servers, so a larger pool would
+	// only add idle threads per listener.
+	if (!m_shared_http_server) {
+		m_shared_http_server =
+			std::make_shared<StreamElementsSharedHttpServer>(
+				options.maxWaitingRequests + 1);
+	}
+
 	m_listener_http_servers[target] =
 		std::make_shared<StreamElementsHttpServerManager>(
-			httpRequestHandler);
+			httpRequestHandler, 0, m_shared_http_server);
 }
 
 void StreamElementsMessageBus::RemoveListener(std::string target)
 {
 	std::lock_guard<std::recursive_mutex> guard(m_listener_list_mutex);
 
-	m_listener_list.erase(target);
+	m_listener_routes.Remove(target);
 
 	m_listener_http_servers.erase(target);
 }
@@ -148,11 +154,6 @@ void StreamElementsMessageBus::DeserializeHttpRequestResponse(
 	CefRefPtr<CefValue> idInput, CefRefPtr<CefValue> responseInput,
 	CefRefPtr<CefValue> &output)
 {
-	std::lock_guard<std::recursive_mutex> browser_list_guard(m_listener_list_mutex);
-
-	std::lock_guard<decltype(m_waiting_http_requests_mutex)> waiting_http_requests_guard(
-		m_waiting_http_requests_mutex);
-
 	output->SetBool(false);
 
 	if (idInput->GetType() != VTYPE_STRING)
@@ -160,62 +161,64 @@ void StreamElementsMessageBus::DeserializeHttpRequestResponse(
 
 	std::string requestId = idInput->GetString();
 
-	if (!m_waiting_http_requests.count(requestId))
-		return;
-
 	if (responseInput->GetType() != VTYPE_DICTIONARY)
 		return;
 
 	CefRefPtr<CefDictionaryValue> d = responseInput->GetDictionary();
 
-	auto res = m_waiting_http_requests[requestId]->response;
+	auto writeResponse = [d](HttpServer::response_t &res) {
+		res.status = 200;
+		res.reason = "OK";
+		res.body = "";
 
-	res->status = 200;
-	res->reason = "OK";
-	res->body = "";
-
-	if (d->HasKey("statusCode") && d->GetType("statusCode") == VTYPE_INT) {
-		res->status = d->GetInt("statusCode");
-	}
-
-	if (d->HasKey("statusText") &&
-	    d->GetType("statusText") == VTYPE_STRING) {
-		res->reason = d->GetString("statusText");
-	}
-
-	if (d->HasKey("body")) {
-		if (d->GetType("body") == VTYPE_STRING) {
-			res->set_content(d->GetString("body").ToString(),
-					 "text/plain");
-		} else {
-			res->set_content(CefWriteJSON(d->GetValue("body"),
-						      JSON_WRITER_DEFAULT)
-						 .ToString(),
-					 "application/json");
+		if (d->HasKey("statusCode") &&
+		    d->GetType("statusCode") == VTYPE_INT) {
+			res.status = d->GetInt("statusCode");
 		}
-	}
 
-	if (d->HasKey("headers") && d->GetType("headers") == VTYPE_DICTIONARY) {
-		CefRefPtr<CefDictionaryValue> headers =
-			d->GetDictionary("headers");
+		if (d->HasKey("statusText") &&
+		    d->GetType("statusText") == VTYPE_STRING) {
+			res.reason = d->GetString("statusText");
+		}
 
-		CefDictionaryValue::KeyList keys;
-		if (headers->GetKeys(keys)) {
-			for (auto key : keys) {
-				if (headers->GetType(key) == VTYPE_STRING) {
-					std::string val =
-						headers->GetString(key)
-							.ToString();
+		if (d->HasKey("body")) {
+			if (d->GetType("body") == VTYPE_STRING) {
+				res.set_content(d->GetString("body").ToString(),
+						"text/plain");
+			} else {
+				res.set_content(
+					CefWriteJSON(d->GetValue("body"),
+						     JSON_WRITER_DEFAULT)
+						.ToString(),
+					"application/json");
+			}
+		}
 
-					res->set_header(key.ToString().c_str(), val.c_str());
+		if (d->HasKey("headers") &&
+		    d->GetType("headers") == VTYPE_DICTIONARY) {
+			CefRefPtr<CefDictionaryValue> headers =
+				d->GetDictionary("headers");
+
+			CefDictionaryValue::KeyList keys;
+			if (headers->GetKeys(keys)) {
+				for (auto key : keys) {
+					if (headers->GetType(key) ==
+					    VTYPE_STRING) {
+						std::string val =
+							headers->GetString(key)
+								.ToString();
+
+						res.set_header(
+							key.ToString().c_str(),
+							val.c_str());
+					}
 				}
 			}
 		}
-	}
-
-	m_waiting_http_requests[requestId]->promise.set_value();
+	};
 
-	output->SetBool(true);
+	output->SetBool(
+		m_waiting_http_requests.Complete(requestId, writeResponse));
 }
 
 void StreamElementsMessageBus::DeserializeBrowserHttpServer(
@@ -280,6 +283,10 @@ void StreamElementsMessageBus::NotifyEventListener(std::string target,
 
 	std::string payloadJson = CefWriteJSON(root, JSON_WRITER_DEFAULT);
 
+	StreamElementsLogRing::GetInstance()->AppendFormat(
+		StreamElementsLogRing::Category::Event, "%s -> %s (%s)",
+		event.c_str(), target.c_str(), source.c_str());
+
 	DispatchJSEventContainer(target, event, payloadJson);
 }
 
@@ -290,9 +297,11 @@ void StreamElementsMessageBus::NotifyAllLocalEventListeners(
 	std::string event,
 	CefRefPtr<CefValue> payload)
 {
-	std::lock_guard<std::recursive_mutex> guard(m_listener_list_mutex);
+	// No lock: the snapshot stays valid however listeners change while
+	// the message is dispatched.
+	auto targets = m_listener_routes.GetSnapshot()->Resolve(types);
 
-	if (m_listener_list.empty()) {
+	if (targets->empty()) {
 		return;
 	}
 
@@ -308,13 +317,13 @@ void StreamElementsMessageBus::NotifyAllLocalEventListeners(
 
 	std::string payloadJson = CefWriteJSON(root, JSON_WRITER_DEFAULT);
 
-	for (auto kv : m_listener_list) {
-		auto browser = kv.first;
+	StreamElementsLogRing::GetInstance()->AppendFormat(
+		StreamElementsLogRing::Category::Event,
+		"%s -> %zu listener(s) (%s)", event.c_str(), targets->size(),
+		source.c_str());
 
-		if (kv.second->flags & types) {
-			DispatchJSEventContainer(kv.second->target, event,
-					      payloadJson);
-		}
+	for (auto &target : *targets) {
+		DispatchJSEventContainer(target, event, payloadJson);
 	}
 }
 
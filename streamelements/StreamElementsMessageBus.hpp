@@ -8,11 +8,11 @@
 
 #include "StreamElementsControllerServer.hpp"
 #include "StreamElementsHttpServerManager.hpp"
+#include "StreamElementsPendingHttpRequests.hpp"
+#include "StreamElementsMessageRoutingTable.hpp"
 
 #include <util/threading.h>
 
-#include <future>
-
 // Message bus for exchanging messages between:
 //
 // * Background Workers
@@ -144,52 +144,21 @@ public:
 	//
 	virtual void PublishSystemState();
 
-private:
-	class WaitingHttpRequestState {
-	public:
-		WaitingHttpRequestState(const HttpServer::request_t *req,
-					HttpServer::response_t *res)
-			: request(req), response(res)
-		{
-		}
-		~WaitingHttpRequestState()
-		{
-		}
-
-	public:
-		std::promise<void> promise;
-		std::shared_future<void> future = promise.get_future();
-		const HttpServer::request_t *request;
-		HttpServer::response_t *response;
-	};
-
 public:
 	void DeserializeHttpRequestResponse(CefRefPtr<CefValue> idInput,
 					    CefRefPtr<CefValue> responseInput,
 					    CefRefPtr<CefValue> &output);
 
 private:
-	class ListenerItem {
-	public:
-		ListenerItem(std::string target_,
-			     message_destination_filter_flags_t flags_)
-			: target(target_), flags(flags_)
-		{
-		}
-
-	public:
-		std::string target;
-		message_destination_filter_flags_t flags;
-	};
-
+	// Guards the HTTP servers of listeners. Routing needs no lock: see
+	// StreamElementsMessageRoutingTable.
 	std::recursive_mutex m_listener_list_mutex;
-	std::map<std::string, std::shared_ptr<ListenerItem>> m_listener_list;
+	StreamElementsMessageRoutingTable m_listener_routes;
 	std::map<std::string,
 		 std::shared_ptr<StreamElementsHttpServerManager>>
 		m_listener_http_servers;
-	std::recursive_mutex m_waiting_http_requests_mutex;
-	std::map<std::string, std::shared_ptr<WaitingHttpRequestState>>
-		m_waiting_http_requests;
+	std::shared_ptr<StreamElementsSharedHttpServer> m_shared_http_server;
+	StreamElementsPendingHttpRequests m_waiting_http_requests;
 	StreamElementsControllerServer m_external_controller_server;
 
 private:
@@ -0,0 +1,100 @@
+#include "StreamElementsMessageRoutingTable.hpp"
+
+#include <set>
+
+/* ================================================================= */
+
+StreamElementsMessageRoutingTable::Snapshot::Snapshot(
+	std::map<std::string, flags_t> listeners,
+	const std::vector<flags_t> &masks)
+	: m_listeners(listeners)
+{
+	std::set<flags_t> routed(masks.begin(), masks.end());
+
+	for (auto &kv : m_listeners)
+		routed.insert(kv.second);
+
+	for (auto mask : routed)
+		m_routes[mask] = Build(mask);
+}
+
+std::shared_ptr<const StreamElementsMessageRoutingTable::targets_t>
+StreamElementsMessageRoutingTable::Snapshot::Build(flags_t types) const
+{
+	auto targets = std::make_shared<targets_t>();
+
+	for (auto &kv : m_listeners) {
+		if (kv.second & types)
+			targets->push_back(kv.first);
+	}
+
+	return targets;
+}
+
+std::shared_ptr<const StreamElementsMessageRoutingTable::targets_t>
+StreamElementsMessageRoutingTable::Snapshot::Resolve(flags_t types) const
+{
+	auto it = m_routes.find(types);
+
+	if (it != m_routes.end())
+		return it->second;
+
+	return Build(types);
+}
+
+bool StreamElementsMessageRoutingTable::Snapshot::GetFlags(
+	const std::string &target, flags_t &flags) const
+{
+	auto it = m_listeners.find(target);
+
+	if (it == m_listeners.end())
+		return false;
+
+	flags = it->second;
+
+	return true;
+}
+
+/* ================================================================= */
+
+StreamElementsMessageRoutingTable::StreamElementsMessageRoutingTable(
+	std::vector<flags_t> masks)
+	: m_masks(masks)
+{
+	Publish();
+}
+
+StreamElementsMessageRoutingTable::~StreamElementsMessageRoutingTable() {}
+
+void StreamElementsMessageRoutingTable::Set(std::string target, flags_t flags)
+{
+	std::lock_guard<decltype(m_mutex)> guard(m_mutex);
+
+	m_listeners[target] = flags;
+
+	Publish();
+}
+
+void StreamElementsMessageRoutingTable::Remove(std::string target)
+{
+	std::lock_guard<decltype(m_mutex)> guard(m_mutex);
+
+	if (!m_listeners.erase(target))
+		return;
+
+	Publish();
+}
+
+std::shared_ptr<const StreamElementsMessageRoutingTable::Snapshot>
+StreamElementsMessageRoutingTable::GetSnapshot() const
+{
+	return std::atomic_load(&m_snapshot);
+}
+
+void StreamElementsMessageRoutingTable::Publish()
+{
+	std::atomic_store(&m_snapshot,
+			  std::shared_ptr<const Snapshot>(
+				  std::make_shared<Snapshot>(m_listeners,
+							     m_masks)));
+}
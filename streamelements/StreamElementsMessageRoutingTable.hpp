@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+//
+// Destination routing for StreamElementsMessageBus.
+//
+// Broadcasting a message used to walk the whole listener map under the
+// listener mutex, testing every listener's destination flags and dispatching
+// with the lock held -- for every message, at UI event rates.
+//
+// Routing is now worked out when listeners change rather than when messages
+// are sent. Every change builds a new immutable Snapshot: the listeners, and
+// for each commonly used destination mask the list of targets it reaches.
+// The snapshot is published with an atomic pointer swap; senders take a
+// reference to the current one and dispatch from it without holding any
+// lock, while listeners keep coming and going.
+//
+class StreamElementsMessageRoutingTable {
+public:
+	typedef uint32_t flags_t;
+	typedef std::vector<std::string> targets_t;
+
+	class Snapshot {
+	public:
+		Snapshot(std::map<std::string, flags_t> listeners,
+			 const std::vector<flags_t> &masks);
+
+		// Targets of the listeners whose flags intersect `types`, in
+		// target order. Precomputed for the masks the table was
+		// created with and for every flag value a listener uses;
+		// other masks are resolved on the spot.
+		std::shared_ptr<const targets_t> Resolve(flags_t types) const;
+
+		bool IsEmpty() const { return m_listeners.empty(); }
+
+		bool GetFlags(const std::string &target, flags_t &flags) const;
+
+		const std::map<std::string, flags_t> &GetListeners() const
+		{
+			return m_listeners;
+		}
+
+	private:
+		std::shared_ptr<const targets_t> Build(flags_t types) const;
+
+	private:
+		std::map<std::string, flags_t> m_listeners;
+		std::map<flags_t, std::shared_ptr<const targets_t>> m_routes;
+	};
+
+public:
+	// `masks` are the destination masks worth precomputing.
+	StreamElementsMessageRoutingTable(std::vector<flags_t> masks);
+	~StreamElementsMessageRoutingTable();
+
+	void Set(std::string target, flags_t flags);
+	void Remove(std::string target);
+
+	// The current snapshot. Never null; safe to call from any thread.
+	std::shared_ptr<const Snapshot> GetSnapshot() const;
+
+private:
+	void Publish();
+
+private:
+	// Serializes writers only.
+	std::mutex m_mutex;
+	std::map<std::string, flags_t> m_listeners;
+	std::vector<flags_t> m_masks;
+
+	// Accessed through std::atomic_load() / std::atomic_store().
+	std::shared_ptr<const Snapshot> m_snapshot;
+};
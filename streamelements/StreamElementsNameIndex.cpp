@@ -0,0 +1,221 @@
+#include "StreamElementsNameIndex.hpp"
+
+#include <algorithm>
+
+static std::string GetCandidate(const std::string &name, uint64_t suffix)
+{
+	if (!suffix)
+		return name;
+
+	return name + " " + std::to_string(suffix);
+}
+
+/* ================================================================= */
+
+StreamElementsNameIndex::StreamElementsNameIndex() {}
+
+StreamElementsNameIndex::~StreamElementsNameIndex() {}
+
+std::string StreamElementsNameIndex::GetKey(const std::string &name)
+{
+	std::string result(name);
+
+	for (auto &ch : result) {
+		if (ch >= 'A' && ch <= 'Z')
+			ch = ch - 'A' + 'a';
+	}
+
+	return result;
+}
+
+void StreamElementsNameIndex::Set(const void *owner, const std::string &name)
+{
+	const std::string key = GetKey(name);
+
+	std::lock_guard<std::mutex> guard(m_mutex);
+
+	auto it = m_owners.find(owner);
+
+	if (it != m_owners.end() && it->second == key)
+		return;
+
+	EraseInternal(owner);
+	AddInternal(owner, key);
+}
+
+void StreamElementsNameIndex::Rename(const void *owner,
+				     const std::string &name)
+{
+	const std::string key = GetKey(name);
+
+	std::lock_guard<std::mutex> guard(m_mutex);
+
+	auto it = m_owners.find(owner);
+
+	if (it == m_owners.end() || it->second == key)
+		return;
+
+	EraseInternal(owner);
+	AddInternal(owner, key);
+}
+
+void StreamElementsNameIndex::Erase(const void *owner)
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+
+	EraseInternal(owner);
+}
+
+void StreamElementsNameIndex::Clear()
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+
+	m_names.clear();
+	m_owners.clear();
+	m_cursors.clear();
+}
+
+bool StreamElementsNameIndex::Contains(const std::string &name) const
+{
+	const std::string key = GetKey(name);
+
+	std::lock_guard<std::mutex> guard(m_mutex);
+
+	return m_names.count(key) > 0;
+}
+
+std::vector<const void *>
+StreamElementsNameIndex::GetOwners(const std::string &name) const
+{
+	const std::string key = GetKey(name);
+
+	std::lock_guard<std::mutex> guard(m_mutex);
+
+	auto it = m_names.find(key);
+
+	if (it == m_names.end())
+		return std::vector<const void *>();
+
+	return it->second;
+}
+
+bool StreamElementsNameIndex::IsTaken(const std::string &name,
+				      const void *except) const
+{
+	const std::string key = GetKey(name);
+
+	std::lock_guard<std::mutex> guard(m_mutex);
+
+	auto it = m_names.find(key);
+
+	if (it == m_names.end())
+		return false;
+
+	for (auto owner : it->second) {
+		if (owner != except)
+			return true;
+	}
+
+	return false;
+}
+
+std::string StreamElementsNameIndex::GetUniqueName(const std::string &name)
+{
+	const std::string key = GetKey(name);
+
+	std::lock_guard<std::mutex> guard(m_mutex);
+
+	uint64_t &cursor = m_cursors[key];
+
+	while (m_names.count(GetCandidate(key, cursor)))
+		++cursor;
+
+	return GetCandidate(name, cursor);
+}
+
+size_t StreamElementsNameIndex::GetSize() const
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+
+	return m_owners.size();
+}
+
+/* ================================================================= */
+
+void StreamElementsNameIndex::AddInternal(const void *owner,
+					  const std::string &key)
+{
+	m_owners[owner] = key;
+	m_names[key].push_back(owner);
+}
+
+void StreamElementsNameIndex::EraseInternal(const void *owner)
+{
+	auto it = m_owners.find(owner);
+
+	if (it == m_owners.end())
+		return;
+
+	const std::string key = it->second;
+
+	m_owners.erase(it);
+
+	auto names = m_names.find(key);
+
+	if (names == m_names.end())
+		return;
+
+	auto &owners = names->second;
+	owners.erase(std::remove(owners.begin(), owners.end(), owner),
+		     owners.end());
+
+	if (owners.empty()) {
+		m_names.erase(names);
+
+		ReleaseSuffix(key);
+	}
+}
+
+void StreamElementsNameIndex::ReleaseSuffix(const std::string &key)
+{
+	// The key is free again as a base name...
+	{
+		auto it = m_cursors.find(key);
+
+		if (it != m_cursors.end())
+			it->second = 0;
+	}
+
+	// ...and, if it ends in " N", as suffix N of the part before it.
+	const size_t space = key.find_last_of(' ');
+
+	if (space == std::string::npos || space + 1 == key.size() ||
+	    key[space + 1] == '0' || key.size() - space - 1 > 18)
+		return;
+
+	uint64_t suffix = 0;
+
+	for (size_t i = space + 1; i < key.size(); ++i) {
+		if (key[i] < '0' || key[i] > '9')
+			return;
+
+		suffix = suffix * 10 + (uint64_t)(key[i] - '0');
+	}
+
+	auto it = m_cursors.find(key.substr(0, space));
+
+	if (it != m_cursors.end())
+		it->second = std::min(it->second, suffix);
+}
+
+/* ================================================================= */
+
+StreamElementsNameIndex *StreamElementsNameIndex::GetInstance()
+{
+	// Never destroyed: sources are still destroyed, and their signals
+	// still fire, while statics are torn down.
+	static StreamElementsNameIndex *s_instance =
+		new StreamElementsNameIndex();
+
+	return s_instance;
+}
@@ -6,6 +6,7 @@
 #include <util/platform.h>
 #include <string.h>
 
+#include <set>
 #include <unordered_map>
 #include <regex>
 
@@ -17,6 +18,12 @@
 #include <QPushButton>
 
 #include "StreamElementsGlobalStateManager.hpp"
+#include "StreamElementsNameIndex.hpp"
+#include "StreamElementsSceneItemBatch.hpp"
+#include "StreamElementsSceneItemEventSuppressor.hpp"
+#include "StreamElementsSceneItemFragmentCache.hpp"
+#include "StreamElementsSceneItemSerializationContext.hpp"
+#include "StreamElementsVersionedList.hpp"
 
 #include "canvas-mutate.hpp"
 #include "canvas-scan.hpp"
@@ -391,9 +398,16 @@ static vec2 DeserializeVec2(CefRefPtr<CefValue> input)
 	return result;
 }
 
+// Reads the "composition" of `input` into `info` and `crop`.
+//
+// Unless `merge` is set, the composition replaces the item's: fields it
+// leaves out take their defaults. With `merge`, `info` and `crop` are
+// expected to hold the item's current settings, and fields left out, crop
+// edges included, keep them.
 static bool DeserializeSceneItemComposition(CefRefPtr<CefValue> input,
 					    obs_transform_info &info,
-					    obs_sceneitem_crop &crop)
+					    obs_sceneitem_crop &crop,
+					    bool merge = false)
 {
 	if (!input.get() || input->GetType() != VTYPE_DICTIONARY) {
 		return false;
@@ -406,8 +420,13 @@ static bool DeserializeSceneItemComposition(CefRefPtr<CefValue> input,
 		return false;
 	}
 
-	memset(&info, 0, sizeof(info));
-	memset(&crop, 0, sizeof(crop));
+	if (!merge) {
+		memset(&info, 0, sizeof(info));
+		memset(&crop, 0, sizeof(crop));
+
+		info.scale = {1, 1};
+		info.alignment = OBS_ALIGN_LEFT | OBS_ALIGN_TOP;
+	}
 
 	CefRefPtr<CefDictionaryValue> d = root->GetDictionary("composition");
 
@@ -416,8 +435,6 @@ static bool DeserializeSceneItemComposition(CefRefPtr<CefValue> input,
 
 	if (d->HasKey("scale"))
 		info.scale = DeserializeVec2(d->GetValue("scale"));
-	else
-		info.scale = {1, 1};
 
 	if (d->HasKey("rotationDegrees"))
 		info.rot = DeserializeDoubleValue(
@@ -426,7 +443,7 @@ static bool DeserializeSceneItemComposition(CefRefPtr<CefValue> input,
 	if (d->HasKey("crop") && d->GetType("crop") == VTYPE_DICTIONARY) {
 		CefRefPtr<CefDictionaryValue> c = d->GetDictionary("crop");
 
-		auto get = [&](const char *key, double defaultValue = 0) {
+		auto get = [&](const char *key, double defaultValue) {
 			if (!c->HasKey(key))
 				return defaultValue;
 
@@ -438,17 +455,15 @@ static bool DeserializeSceneItemComposition(CefRefPtr<CefValue> input,
 				return defaultValue;
 		};
 
-		crop.left = get("left");
-		crop.top = get("top");
-		crop.right = get("right");
-		crop.bottom = get("bottom");
+		crop.left = get("left", crop.left);
+		crop.top = get("top", crop.top);
+		crop.right = get("right", crop.right);
+		crop.bottom = get("bottom", crop.bottom);
 	}
 
 	if (d->HasKey("alignment")) {
 		info.alignment =
 			GetInt32FromAlignmentId(d->GetString("alignment"));
-	} else {
-		info.alignment = OBS_ALIGN_LEFT | OBS_ALIGN_TOP;
 	}
 
 	if (d->HasKey("boundsType")) {
@@ -470,19 +485,18 @@ static bool DeserializeSceneItemComposition(CefRefPtr<CefValue> input,
 			info.bounds_type = OBS_BOUNDS_MAX_ONLY;
 		else
 			return false;
+	}
 
-		if (info.bounds_type != OBS_BOUNDS_NONE) {
-			if (d->HasKey("bounds"))
-				info.bounds =
-					DeserializeVec2(d->GetValue("bounds"));
+	if (info.bounds_type != OBS_BOUNDS_NONE) {
+		if (d->HasKey("bounds"))
+			info.bounds = DeserializeVec2(d->GetValue("bounds"));
 
-			if (d->HasKey("boundsAlignment") &&
-			    d->GetType("boundsAlignment") == VTYPE_STRING)
-				info.bounds_alignment = GetInt32FromAlignmentId(
-					d->GetString("boundsAlignment"));
-			else
-				info.bounds_alignment = OBS_ALIGN_CENTER;
-		}
+		if (d->HasKey("boundsAlignment") &&
+		    d->GetType("boundsAlignment") == VTYPE_STRING)
+			info.bounds_alignment = GetInt32FromAlignmentId(
+				d->GetString("boundsAlignment"));
+		else if (!merge)
+			info.bounds_alignment = OBS_ALIGN_CENTER;
 	}
 
 	return true;
@@ -551,6 +565,148 @@ SerializeObsSceneItemCompositionSettings(obs_source_t *source,
 	return d;
 }
 
+// Scene item fragments by the scene and composition they were serialized for
+typedef std::pair<const void *, const void *> scene_item_fragment_variant_t;
+typedef StreamElementsSceneItemFragmentCache<CefRefPtr<CefValue>,
+					     scene_item_fragment_variant_t>
+	scene_item_fragment_cache_t;
+
+static scene_item_fragment_cache_t *GetSceneItemFragmentCache()
+{
+	// Never destroyed: scene item signals may still fire while statics
+	// are torn down.
+	static scene_item_fragment_cache_t *s_instance =
+		new scene_item_fragment_cache_t();
+
+	return s_instance;
+}
+
+// Drops the cached fragments of the item or source a signal is about.
+static void invalidate_scene_item_fragments(calldata_t *cd)
+{
+	auto cache = GetSceneItemFragmentCache();
+
+	obs_sceneitem_t *sceneitem =
+		(obs_sceneitem_t *)calldata_ptr(cd, "item");
+
+	if (sceneitem)
+		cache->InvalidateItem(sceneitem);
+
+	obs_source_t *source = (obs_source_t *)calldata_ptr(cd, "source");
+
+	// Filters are serialized with the items of the source they are on
+	if (source && obs_source_get_type(source) == OBS_SOURCE_TYPE_FILTER)
+		source = obs_filter_get_parent(source);
+
+	if (source)
+		cache->InvalidateSource(source);
+}
+
+static StreamElementsSceneItemEventSuppressor *GetSceneItemEventSuppressor()
+{
+	// Never destroyed: scene item signals may still fire while statics
+	// are torn down.
+	static StreamElementsSceneItemEventSuppressor *s_instance =
+		new StreamElementsSceneItemEventSuppressor();
+
+	return s_instance;
+}
+
+// Whether the item or scene a signal is about is being changed by a batch,
+// which dispatches one consolidated change instead.
+static bool is_scene_item_signal_suppressed(calldata_t *cd)
+{
+	auto suppressor = GetSceneItemEventSuppressor();
+
+	return suppressor->IsSuppressed(calldata_ptr(cd, "item")) ||
+	       suppressor->IsSuppressed(calldata_ptr(cd, "scene"));
+}
+
+void StreamElementsObsSceneManager::InvalidateSerializedSceneItem(
+	obs_sceneitem_t *sceneitem)
+{
+	GetSceneItemFragmentCache()->InvalidateItem(sceneitem);
+}
+
+typedef StreamElementsSceneItemSerializationContext<
+	obs_scene_t, obs_sceneitem_t, StreamElementsVideoCompositionBase>
+	scene_item_serialization_context_t;
+
+// Looks up what serializing the items of `root_scene` needs, once: the
+// current scene and the group membership of its items.
+static scene_item_serialization_context_t CreateSceneItemSerializationContext(
+	obs_scene_t *root_scene,
+	StreamElementsVideoCompositionBase *videoComposition)
+{
+	obs_source_t *current_scene_source =
+		SETRACE_ADDREF(obs_frontend_get_current_scene());
+
+	obs_scene_t *current_scene =
+		current_scene_source
+			? obs_scene_from_source(current_scene_source)
+			: nullptr;
+
+	scene_item_serialization_context_t context(root_scene, current_scene,
+						   videoComposition);
+
+	if (current_scene) {
+		std::vector<obs_sceneitem_t *> groups;
+
+		obs_scene_enum_items(
+			current_scene,
+			[](obs_scene_t *scene, obs_sceneitem_t *sceneitem,
+			   void *param) {
+				auto groups =
+					(std::vector<obs_sceneitem_t *> *)param;
+
+				if (obs_sceneitem_is_group(sceneitem)) {
+					obs_sceneitem_addref(SETRACE_ADDREF(
+						sceneitem)); // released below
+
+					groups->push_back(sceneitem);
+				}
+
+				// Continue iteration
+				return true;
+			},
+			&groups);
+
+		// Each group is enumerated after the scene, rather than from
+		// within its enumeration, so no two scene locks are held at
+		// once.
+		struct local_context {
+			scene_item_serialization_context_t *context;
+			obs_sceneitem_t *group;
+		};
+
+		for (auto group : groups) {
+			local_context param = {&context, group};
+
+			obs_sceneitem_group_enum_items(
+				group,
+				[](obs_scene_t *scene,
+				   obs_sceneitem_t *sceneitem, void *param) {
+					local_context *local =
+						(local_context *)param;
+
+					local->context->AddGroupItem(
+						local->group, sceneitem);
+
+					// Continue iteration
+					return true;
+				},
+				&param);
+
+			obs_sceneitem_release(SETRACE_DECREF(group));
+		}
+	}
+
+	if (current_scene_source)
+		obs_source_release(SETRACE_DECREF(current_scene_source));
+
+	return context;
+}
+
 static void SerializeSourceAndSceneItem(CefRefPtr<CefValue> &result,
 					obs_scene_t* root_scene,
 					obs_source_t *source,
@@ -558,7 +714,19 @@ static void SerializeSourceAndSceneItem(CefRefPtr<CefValue> &result,
 					const int order = -1,
 					bool serializeDetails = true,
 					bool serializeProperties = false,
-					StreamElementsVideoCompositionBase *videoComposition = nullptr)
+					StreamElementsVideoCompositionBase *videoComposition = nullptr);
+
+static void SerializeSourceAndSceneItem(
+	CefRefPtr<CefValue> &result,
+	const scene_item_serialization_context_t &serializationContext,
+	obs_source_t *source, obs_sceneitem_t *sceneitem, const int order,
+	bool serializeDetails, bool serializeProperties);
+
+static void SerializeSourceAndSceneItemInternal(
+	CefRefPtr<CefValue> &result,
+	const scene_item_serialization_context_t &serializationContext,
+	obs_source_t *source, obs_sceneitem_t *sceneitem, const int order,
+	bool serializeDetails, bool serializeProperties)
 {
 	result->SetNull();
 
@@ -566,27 +734,15 @@ static void SerializeSourceAndSceneItem(CefRefPtr<CefValue> &result,
 
 	std::string sceneItemId = GetIdFromPointer(sceneitem);
 
-	if (!videoComposition) {
-		auto videoCompositionManager =
-			StreamElementsGlobalStateManager::GetInstance()
-				->GetVideoCompositionManager();
-
-		if (!videoCompositionManager.get())
-			return;
-
-		videoComposition = videoCompositionManager
-				->GetVideoCompositionBySceneItemId(sceneItemId,
-								   &root_scene).get();
-	}
-
 	root->SetString("id", sceneItemId);
 
-	if (videoComposition) {
-		root->SetString("videoCompositionId",
-				videoComposition->GetId());
+	if (serializationContext.GetComposition()) {
 		root->SetString(
-			"sceneId",
-			GetIdFromPointer(obs_scene_get_source(root_scene)));
+			"videoCompositionId",
+			serializationContext.GetComposition()->GetId());
+		root->SetString("sceneId",
+				GetIdFromPointer(obs_scene_get_source(
+					serializationContext.GetRootScene())));
 	}
 
 	if (source) {
@@ -620,26 +776,12 @@ static void SerializeSourceAndSceneItem(CefRefPtr<CefValue> &result,
 		}
 
 		{
-			obs_source_t *parent_scene = SETRACE_ADDREF(
-				obs_frontend_get_current_scene());
-
-			if (!!parent_scene) {
-				obs_scene_t *scene =
-					obs_scene_from_source(parent_scene);
-
-				if (!!scene) {
-					obs_sceneitem_t *group =
-						obs_sceneitem_get_group(
-							scene, sceneitem);
-					if (!!group) {
-						root->SetString(
-							"parentId",
-							GetIdFromPointer(
-								group));
-					}
-				}
+			obs_sceneitem_t *group =
+				serializationContext.GetGroup(sceneitem);
 
-				obs_source_release(SETRACE_DECREF(parent_scene));
+			if (!!group) {
+				root->SetString("parentId",
+						GetIdFromPointer(group));
 			}
 		}
 
@@ -693,10 +835,9 @@ static void SerializeSourceAndSceneItem(CefRefPtr<CefValue> &result,
 				CefRefPtr<CefValue> item = CefValue::Create();
 
 				SerializeSourceAndSceneItem(
-					item, root_scene, source, *it,
-					context.list->GetSize(),
-					serializeDetails, serializeProperties,
-					videoComposition);
+					item, serializationContext, source,
+					*it, context.list->GetSize(),
+					serializeDetails, serializeProperties);
 
 				context.list->SetValue(context.list->GetSize(),
 						       item);
@@ -762,6 +903,150 @@ static void SerializeSourceAndSceneItem(CefRefPtr<CefValue> &result,
 	result->SetDictionary(root);
 }
 
+// Properties can change without a signal, and groups embed their items:
+// neither is cached.
+static bool IsSceneItemFragmentCacheable(obs_sceneitem_t *sceneitem,
+					 bool serializeDetails,
+					 bool serializeProperties)
+{
+	return serializeDetails && !serializeProperties && sceneitem &&
+	       !obs_sceneitem_is_group(sceneitem);
+}
+
+// Serializes `sceneitem` into a fragment and caches it under `generation`,
+// taken before anything the fragment depends on was looked up.
+static CefRefPtr<CefValue> CreateSceneItemFragment(
+	const scene_item_serialization_context_t &serializationContext,
+	obs_source_t *source, obs_sceneitem_t *sceneitem,
+	const scene_item_fragment_variant_t &variant, uint64_t generation)
+{
+	CefRefPtr<CefValue> fragment = CefValue::Create();
+
+	SerializeSourceAndSceneItemInternal(fragment, serializationContext,
+					    source, sceneitem, -1, true, false);
+
+	GetSceneItemFragmentCache()->Put(sceneitem, source, variant, fragment,
+					 generation);
+
+	return fragment;
+}
+
+// The fragment is shared: hands out a copy, completed with what changes
+// without a signal.
+static void CompleteSceneItemFragment(CefRefPtr<CefValue> &result,
+				      CefRefPtr<CefValue> fragment,
+				      obs_source_t *source, const int order)
+{
+	if (fragment->GetType() != VTYPE_DICTIONARY)
+		return;
+
+	auto root = fragment->GetDictionary()->Copy(false);
+
+	if (order >= 0) {
+		root->SetInt("order", order);
+	}
+
+	if (source && root->GetType("composition") == VTYPE_DICTIONARY) {
+		auto composition = root->GetDictionary("composition");
+
+		composition->SetInt("srcWidth", obs_source_get_width(source));
+		composition->SetInt("srcHeight", obs_source_get_height(source));
+	}
+
+	result->SetDictionary(root);
+}
+
+static void SerializeSourceAndSceneItem(CefRefPtr<CefValue> &result,
+					obs_scene_t* root_scene,
+					obs_source_t *source,
+					obs_sceneitem_t *sceneitem,
+					const int order,
+					bool serializeDetails,
+					bool serializeProperties,
+					StreamElementsVideoCompositionBase *videoComposition)
+{
+	result->SetNull();
+
+	if (!videoComposition) {
+		auto videoCompositionManager =
+			StreamElementsGlobalStateManager::GetInstance()
+				->GetVideoCompositionManager();
+
+		if (!videoCompositionManager.get())
+			return;
+
+		videoComposition = videoCompositionManager
+				->GetVideoCompositionBySceneItem(sceneitem,
+								 &root_scene).get();
+	}
+
+	if (!IsSceneItemFragmentCacheable(sceneitem, serializeDetails,
+					  serializeProperties)) {
+		SerializeSourceAndSceneItemInternal(
+			result,
+			CreateSceneItemSerializationContext(root_scene,
+							    videoComposition),
+			source, sceneitem, order, serializeDetails,
+			serializeProperties);
+
+		return;
+	}
+
+	// A cached fragment needs no context, and building one walks the
+	// current scene and its groups.
+	auto cache = GetSceneItemFragmentCache();
+
+	const scene_item_fragment_variant_t variant(root_scene,
+						    videoComposition);
+
+	CefRefPtr<CefValue> fragment;
+
+	if (!cache->Get(sceneitem, variant, fragment)) {
+		const uint64_t generation = cache->GetGeneration();
+
+		fragment = CreateSceneItemFragment(
+			CreateSceneItemSerializationContext(root_scene,
+							    videoComposition),
+			source, sceneitem, variant, generation);
+	}
+
+	CompleteSceneItemFragment(result, fragment, source, order);
+}
+
+static void SerializeSourceAndSceneItem(
+	CefRefPtr<CefValue> &result,
+	const scene_item_serialization_context_t &serializationContext,
+	obs_source_t *source, obs_sceneitem_t *sceneitem, const int order,
+	bool serializeDetails, bool serializeProperties)
+{
+	result->SetNull();
+
+	if (!IsSceneItemFragmentCacheable(sceneitem, serializeDetails,
+					  serializeProperties)) {
+		SerializeSourceAndSceneItemInternal(
+			result, serializationContext, source, sceneitem,
+			order, serializeDetails, serializeProperties);
+
+		return;
+	}
+
+	auto cache = GetSceneItemFragmentCache();
+
+	const scene_item_fragment_variant_t variant(
+		serializationContext.GetRootScene(),
+		serializationContext.GetComposition());
+
+	CefRefPtr<CefValue> fragment;
+
+	if (!cache->Get(sceneitem, variant, fragment)) {
+		fragment = CreateSceneItemFragment(serializationContext, source,
+						   sceneitem, variant,
+						   cache->GetGeneration());
+	}
+
+	CompleteSceneItemFragment(result, fragment, source, order);
+}
+
 static void SerializeObsScene(obs_source_t *sceneSource, CefRefPtr<CefValue> &result)
 {
 	result->SetNull();
@@ -788,6 +1073,234 @@ static void SerializeObsScene(obs_scene_t *scene, CefRefPtr<CefValue> &result)
 	SerializeObsScene(obs_scene_get_source(scene), result);
 }
 
+static void SerializeObsSceneItemList(
+	obs_scene_t *scene, StreamElementsVideoCompositionBase *videoComposition,
+	bool serializeProperties, CefRefPtr<CefValue> &output)
+{
+	struct local_context {
+		CefRefPtr<CefListValue> list;
+		std::vector<obs_sceneitem_t *> sceneItems;
+
+		~local_context()
+		{
+			for (const auto &item : sceneItems) {
+				obs_sceneitem_release(SETRACE_DECREF(item));
+			}
+		}
+	};
+
+	local_context context;
+
+	context.list = CefListValue::Create();
+
+	// For each scene item
+	obs_scene_enum_items(
+		scene,
+		[](obs_scene_t *scene, obs_sceneitem_t *sceneitem,
+		   void *param) {
+			local_context *context = (local_context *)param;
+
+			obs_sceneitem_addref(SETRACE_ADDREF(sceneitem)); // Will be auto-released
+
+			context->sceneItems.push_back(sceneitem);
+
+			// Continue iteration
+			return true;
+		},
+		&context);
+
+	// Looked up once for all items
+	auto serializationContext =
+		CreateSceneItemSerializationContext(scene, videoComposition);
+
+	for (const auto &it : context.sceneItems) {
+		obs_source_t *source =
+			obs_sceneitem_get_source(it); // does not increase refcount
+
+		CefRefPtr<CefValue> item = CefValue::Create();
+
+		SerializeSourceAndSceneItem(item, serializationContext, source,
+					    it, context.list->GetSize(), true,
+					    serializeProperties);
+
+		context.list->SetValue(context.list->GetSize(), item);
+	}
+
+	output->SetList(context.list);
+}
+
+///////////////////////////////////////////////////////////////////////
+
+// Versioned item lists behind the hostSceneItemListDelta event, by scene
+// source.
+struct scene_item_lists_t {
+	std::mutex mutex;
+	std::map<const void *, std::shared_ptr<StreamElementsVersionedList>>
+		lists;
+
+	// Scenes with a delta scheduled and not computed yet.
+	std::set<const void *> pending;
+};
+
+// Scene update signals fire on every tick of a drag in the preview. Deltas
+// are computed once per scene per this many milliseconds at most, from the
+// scene as it is by then, rather than once per signal.
+static const int SCENE_ITEM_LIST_DELTA_DELAY_MS = 100;
+
+static scene_item_lists_t *GetSceneItemLists()
+{
+	// Never destroyed: scene item signals may still fire while statics
+	// are torn down.
+	static scene_item_lists_t *s_instance = new scene_item_lists_t();
+
+	return s_instance;
+}
+
+static std::shared_ptr<StreamElementsVersionedList>
+GetSceneItemList(obs_source_t *sceneSource)
+{
+	auto instance = GetSceneItemLists();
+
+	std::lock_guard<std::mutex> guard(instance->mutex);
+
+	auto &list = instance->lists[sceneSource];
+
+	if (!list)
+		list = std::make_shared<StreamElementsVersionedList>();
+
+	return list;
+}
+
+static void RemoveSceneItemList(obs_source_t *sceneSource)
+{
+	auto instance = GetSceneItemLists();
+
+	std::lock_guard<std::mutex> guard(instance->mutex);
+
+	instance->lists.erase(sceneSource);
+	instance->pending.erase(sceneSource);
+}
+
+static void RemoveAllSceneItemLists()
+{
+	auto instance = GetSceneItemLists();
+
+	std::lock_guard<std::mutex> guard(instance->mutex);
+
+	instance->lists.clear();
+	instance->pending.clear();
+}
+
+// Marks `sceneSource` as having a delta scheduled. False if it already had.
+static bool SetSceneItemListPending(obs_source_t *sceneSource)
+{
+	auto instance = GetSceneItemLists();
+
+	std::lock_guard<std::mutex> guard(instance->mutex);
+
+	return instance->pending.insert(sceneSource).second;
+}
+
+// False if the list was removed, with its scene, since it was marked.
+static bool ClearSceneItemListPending(obs_source_t *sceneSource)
+{
+	auto instance = GetSceneItemLists();
+
+	std::lock_guard<std::mutex> guard(instance->mutex);
+
+	return instance->pending.erase(sceneSource) > 0;
+}
+
+// Moves the versioned item list of `scene` to its current serialization.
+// Returns the delta, completed with the scene and composition it is about,
+// or null if nothing changed.
+static json11::Json
+UpdateSceneItemList(obs_scene_t *scene,
+		    StreamElementsVideoCompositionBase *videoComposition)
+{
+	obs_source_t *sceneSource = obs_scene_get_source(scene);
+
+	CefRefPtr<CefValue> items = CefValue::Create();
+
+	SerializeObsSceneItemList(scene, videoComposition, false, items);
+
+	auto delta = GetSceneItemList(sceneSource)->Update(
+		CefWriteJSON(items, JSON_WRITER_DEFAULT).ToString());
+
+	if (delta.is_null())
+		return delta;
+
+	auto result = delta.object_items();
+
+	result["sceneId"] = GetIdFromPointer(sceneSource);
+	result["videoCompositionId"] = videoComposition->GetId();
+
+	return result;
+}
+
+static void dispatch_pending_scene_item_list_delta(obs_scene_t *scene)
+{
+	if (s_shutdown)
+		return;
+
+	if (!obs_initialized())
+		return;
+
+	// Cleared before serializing, so that changes made meanwhile schedule
+	// another delta.
+	if (!ClearSceneItemListPending(obs_scene_get_source(scene)))
+		return;
+
+	auto videoCompositionManager =
+		StreamElementsGlobalStateManager::GetInstance()
+			->GetVideoCompositionManager();
+
+	if (!videoCompositionManager.get())
+		return;
+
+	auto videoComposition =
+		videoCompositionManager->GetVideoCompositionByScene(scene);
+
+	if (!videoComposition.get())
+		return;
+
+	auto delta = UpdateSceneItemList(scene, videoComposition.get());
+
+	if (delta.is_null())
+		return;
+
+	DispatchJSEventGlobal("hostSceneItemListDelta", delta.dump());
+}
+
+// Schedules a delta for `scene`, unless one is scheduled already.
+static void dispatch_scene_item_list_delta(obs_scene_t *scene)
+{
+	if (s_shutdown)
+		return;
+
+	if (!obs_initialized())
+		return;
+
+	if (!SetSceneItemListPending(obs_scene_get_source(scene)))
+		return;
+
+	auto sceneRef = SETRACE_ADDREF(obs_scene_get_ref(scene));
+
+	if (!sceneRef) {
+		ClearSceneItemListPending(obs_scene_get_source(scene));
+
+		return;
+	}
+
+	QtDelayTask(
+		[sceneRef]() {
+			dispatch_pending_scene_item_list_delta(sceneRef);
+
+			obs_scene_release(SETRACE_DECREF(sceneRef));
+		},
+		SCENE_ITEM_LIST_DELTA_DELAY_MS);
+}
+
 ///////////////////////////////////////////////////////////////////////
 
 static void dispatch_scene_event(obs_scene_t *scene,
@@ -833,6 +1346,9 @@ static void dispatch_scene_event(void *my_data, calldata_t *cd,
 	if (s_shutdown)
 		return;
 
+	if (is_scene_item_signal_suppressed(cd))
+		return;
+
 	obs_scene_t *scene = (obs_scene_t *)calldata_ptr(cd, "scene");
 
 	if (!scene) {
@@ -872,20 +1388,29 @@ static void dispatch_scene_update(obs_scene_t* scene,
 					     "hostActiveSceneItemListChanged",
 					     "hostSceneItemListChanged");
 
+			dispatch_scene_item_list_delta(sceneRef);
+
 			obs_scene_release(SETRACE_DECREF(sceneRef));
 		});
 	} else {
 		dispatch_scene_event(scene, "hostActiveSceneItemListChanged",
 				     "hostSceneItemListChanged");
+
+		dispatch_scene_item_list_delta(scene);
 	}
 }
 
 static void dispatch_scene_update(void *my_data, calldata_t *cd,
 					  bool shouldDelay)
 {
+	invalidate_scene_item_fragments(cd);
+
 	if (s_shutdown)
 		return;
 
+	if (is_scene_item_signal_suppressed(cd))
+		return;
+
 	auto signalHandlerData = static_cast<SESignalHandlerData *>(my_data);
 
 	if (!signalHandlerData) {
@@ -927,7 +1452,8 @@ static void dispatch_sceneitem_event(void *my_data, obs_sceneitem_t *sceneitem,
 		obs_source_t *sceneitem_source =
 			obs_sceneitem_get_source(sceneitem);
 
-		// this can deadlock due to full_lock(obs_scene) in obs_sceneitem_get_group
+		// takes the current scene's lock, and then each group's, to
+		// look up group membership
 		SerializeSourceAndSceneItem(
 			item, obs_sceneitem_get_scene(sceneitem),
 			sceneitem_source, sceneitem, -1, serializeDetails,
@@ -979,6 +1505,9 @@ static void dispatch_sceneitem_event(void *my_data, calldata_t *cd,
 	if (!signalHandlerData)
 		return;
 
+	if (is_scene_item_signal_suppressed(cd))
+		return;
+
 	if (shouldDelay) {
 		obs_sceneitem_addref(SETRACE_ADDREF(sceneitem));
 		
@@ -1042,10 +1571,51 @@ static void dispatch_source_event(void *my_data, calldata_t *cd,
 	obs_source_release(SETRACE_DECREF(scene_source));
 }
 
+static void index_source_rename(calldata_t *cd)
+{
+	obs_source_t *source = (obs_source_t *)calldata_ptr(cd, "source");
+	const char *name = calldata_string(cd, "new_name");
+
+	if (!source || !name)
+		return;
+
+	StreamElementsNameIndex::GetInstance()->Rename(source, name);
+}
+
+static void handle_indexed_source_destroy(void *, calldata_t *cd)
+{
+	obs_source_t *source = (obs_source_t *)calldata_ptr(cd, "source");
+
+	if (!source)
+		return;
+
+	StreamElementsNameIndex::GetInstance()->Erase(source);
+}
+
+// Private sources, such as the scenes of non-native video compositions and
+// the sources in them, do not raise global signals. Index them as they are
+// seen, and drop them when they are destroyed.
+static void index_source(obs_source_t *source)
+{
+	const char *name = obs_source_get_name(source);
+
+	if (!name)
+		return;
+
+	StreamElementsNameIndex::GetInstance()->Set(source, name);
+
+	// Connecting the same callback and data twice is a no-op, and the
+	// connection goes away with the source.
+	signal_handler_connect(obs_source_get_signal_handler(source), "destroy",
+			       handle_indexed_source_destroy, nullptr);
+}
+
 static void handle_scene_rename(void *my_data, calldata_t *cd)
 {
 	SEAsyncCallContextMarker asyncMarker(__FILE__, __LINE__);
 
+	index_source_rename(cd);
+
 	dispatch_scene_event(my_data, cd, "hostActiveSceneRenamed",
 			      "hostSceneRenamed");
 }
@@ -1063,6 +1633,14 @@ static void handle_scene_item_transform(void *my_data, calldata_t *cd)
 {
 	SEAsyncCallContextMarker asyncMarker(__FILE__, __LINE__);
 
+	// Raised on the video tick after a batch changed the item's transform
+	if (GetSceneItemEventSuppressor()->ConsumeExpectedSignal(
+		    calldata_ptr(cd, "item"))) {
+		invalidate_scene_item_fragments(cd);
+
+		return;
+	}
+
 	dispatch_sceneitem_event(my_data, cd, "hostActiveSceneItemTransformed",
 				 "hostSceneItemTransformed", false, true);
 	dispatch_scene_update(my_data, cd, true);
@@ -1118,6 +1696,9 @@ static void handle_scene_item_reorder(void *my_data, calldata_t *cd)
 {
 	SEAsyncCallContextMarker asyncMarker(__FILE__, __LINE__);
 
+	// Items may have moved in or out of groups
+	GetSceneItemFragmentCache()->InvalidateAll();
+
 	dispatch_scene_event(my_data, cd, "hostActiveSceneItemsOrderChanged",
 			     "hostSceneItemOrderChanged");
 
@@ -1156,6 +1737,8 @@ static void handle_scene_item_source_rename(void *my_data, calldata_t *cd)
 {
 	SEAsyncCallContextMarker asyncMarker(__FILE__, __LINE__);
 
+	index_source_rename(cd);
+
 	dispatch_source_event(my_data, cd, "hostActiveSceneItemRenamed",
 			      "hostSceneItemRenamed");
 	dispatch_scene_update(my_data, cd, true);
@@ -1166,6 +1749,8 @@ static void handle_scene_item_source_filter_update_props(void *my_data,
 {
 	SEAsyncCallContextMarker asyncMarker(__FILE__, __LINE__);
 
+	invalidate_scene_item_fragments(cd);
+
 	auto signalHandlerData = static_cast<SESignalHandlerData *>(my_data);
 
 	if (!signalHandlerData)
@@ -1185,6 +1770,8 @@ static void handle_scene_item_source_filter_update_settings(void *my_data,
 {
 	SEAsyncCallContextMarker asyncMarker(__FILE__, __LINE__);
 
+	invalidate_scene_item_fragments(cd);
+
 	auto signalHandlerData = static_cast<SESignalHandlerData *>(my_data);
 
 	if (!signalHandlerData)
@@ -1204,6 +1791,8 @@ static void handle_scene_item_source_filter_rename(void *my_data,
 {
 	SEAsyncCallContextMarker asyncMarker(__FILE__, __LINE__);
 
+	invalidate_scene_item_fragments(cd);
+
 	auto signalHandlerData = static_cast<SESignalHandlerData *>(my_data);
 
 	if (!signalHandlerData)
@@ -1262,6 +1851,8 @@ static void handle_scene_item_source_filter_add(void *my_data, calldata_t *cd)
 {
 	SEAsyncCallContextMarker asyncMarker(__FILE__, __LINE__);
 
+	invalidate_scene_item_fragments(cd);
+
 	// obs_source_t *source = (obs_source_t *)calldata_ptr(cd, "source");
 	obs_source_t *filter = (obs_source_t *)calldata_ptr(cd, "filter");
 
@@ -1285,6 +1876,8 @@ static void handle_scene_item_source_filter_remove(void *my_data, calldata_t *cd
 {
 	SEAsyncCallContextMarker asyncMarker(__FILE__, __LINE__);
 
+	invalidate_scene_item_fragments(cd);
+
 	obs_source_t *source = (obs_source_t *)calldata_ptr(cd, "source");
 
 	if (obs_source_removed(source)) {
@@ -1321,6 +1914,8 @@ static void handle_scene_item_source_filter_reorder(void *my_data,
 {
 	SEAsyncCallContextMarker asyncMarker(__FILE__, __LINE__);
 
+	invalidate_scene_item_fragments(cd);
+
 	// obs_source_t *source = (obs_source_t *)calldata_ptr(cd, "source");
 
 	auto signalHandlerData = static_cast<SESignalHandlerData *>(my_data);
@@ -1413,6 +2008,8 @@ static void handle_scene_item_add(void *my_data, calldata_t *cd)
 	auto source = obs_sceneitem_get_source(sceneitem);
 
 	if (source) {
+		index_source(source);
+
 		add_source_signals(source,
 				   static_cast<SESignalHandlerData *>(my_data));
 	}
@@ -1447,6 +2044,9 @@ static void process_scene_item_remove(obs_sceneitem_t *sceneitem,
 	if (!signalHandlerData)
 		return;
 
+	// The address may be reused by the next item
+	GetSceneItemFragmentCache()->InvalidateItem(sceneitem);
+
 	remove_filter_signals(sceneitem, signalHandlerData);
 
 	auto source = obs_sceneitem_get_source(sceneitem);
@@ -1626,6 +2226,8 @@ void add_scene_signals(obs_scene_t *scene, SESignalHandlerData *data)
 
 	auto handler = obs_source_get_signal_handler(source);
 
+	index_source(source);
+
 	add_source_signals(source, signalHandlerData);
 
 	signal_handler_connect(handler, "item_add", handle_scene_item_add,
@@ -1693,6 +2295,16 @@ void StreamElementsObsSceneManager::handle_obs_frontend_event(
 		self->CleanObsSceneSignals();
 	}
 
+	// Group membership ("parentId") is looked up in the current scene
+	if (event == OBS_FRONTEND_EVENT_SCENE_CHANGED ||
+	    event == OBS_FRONTEND_EVENT_SCENE_COLLECTION_CLEANUP) {
+		GetSceneItemFragmentCache()->InvalidateAll();
+	}
+
+	if (event == OBS_FRONTEND_EVENT_SCENE_COLLECTION_CLEANUP) {
+		RemoveAllSceneItemLists();
+	}
+
 	if (event != OBS_FRONTEND_EVENT_SCENE_CHANGED &&
 	    event != OBS_FRONTEND_EVENT_SCENE_COLLECTION_CHANGED)
 		return;
@@ -1713,6 +2325,15 @@ static void handle_source_create(void *data, calldata_t *cd)
 	if (!source)
 		return;
 
+	switch (obs_source_get_type(source)) {
+	case OBS_SOURCE_TYPE_INPUT:
+	case OBS_SOURCE_TYPE_SCENE:
+		index_source(source);
+		break;
+	default:
+		break;
+	}
+
 	add_scene_signals(source, (SESignalHandlerData *)data);
 }
 
@@ -1725,9 +2346,21 @@ static void handle_source_remove(void *data, calldata_t *cd)
 	if (!source)
 		return;
 
+	StreamElementsNameIndex::GetInstance()->Erase(source);
+
+	if (obs_source_is_scene(source))
+		RemoveSceneItemList(source);
+
 	remove_scene_signals(source, (SESignalHandlerData *)data);
 }
 
+static void handle_source_rename(void *, calldata_t *cd)
+{
+	SEAsyncCallContextMarker asyncMarker(__FILE__, __LINE__);
+
+	index_source_rename(cd);
+}
+
 ///////////////////////////////////////////////////////////////////////
 
 static std::shared_ptr<StreamElementsVideoCompositionBase>
@@ -1787,6 +2420,18 @@ StreamElementsObsSceneManager::StreamElementsObsSceneManager(QMainWindow *parent
 	signal_handler_connect(handler, "source_remove", handle_source_remove,
 			       m_signalHandlerData);
 
+	signal_handler_connect(handler, "source_rename", handle_source_rename,
+			       nullptr);
+
+	// Index existing inputs; scenes are indexed by add_scene_signals()
+	obs_enum_sources(
+		[](void *, obs_source_t *source) -> bool {
+			index_source(source);
+
+			return true;
+		},
+		nullptr);
+
 	// Add signals to existing scenes
 	obs_enum_scenes(
 		[](void * data, obs_source_t *scene_source) -> bool {
@@ -1856,6 +2501,9 @@ StreamElementsObsSceneManager::~StreamElementsObsSceneManager()
 					  handle_source_remove,
 					  m_signalHandlerData);
 
+		signal_handler_disconnect(handler, "source_rename",
+					  handle_source_rename, nullptr);
+
 		// Remove signals from existing scenes
 		CleanObsSceneSignals();
 
@@ -2024,34 +2672,7 @@ void StreamElementsObsSceneManager::ObsAddSourceInternal(
 }
 
 static bool isSourceNameUnique(obs_source_t* source, std::string name) {
-	if (source) {
-		OBSSourceAutoRelease existing =
-			SETRACE_SCOPEREF(obs_get_source_by_name(name.c_str()));
-
-		if (existing && existing == source) {
-			return true;
-		} else if (existing) {
-			return false;
-		}
-	}
-
-	auto videoComposition =
-		StreamElementsGlobalStateManager::GetInstance()
-			->GetVideoCompositionManager()
-			->GetVideoCompositionBySceneName(name);
-
-	if (videoComposition.get())
-		return false;
-
-	videoComposition =
-		StreamElementsGlobalStateManager::GetInstance()
-			->GetVideoCompositionManager()
-			->GetVideoCompositionBySceneItemName(name, nullptr);
-
-	if (videoComposition.get())
-		return false;
-
-	return true;
+	return !StreamElementsNameIndex::GetInstance()->IsTaken(name, source);
 }
 
 std::string
@@ -2076,20 +2697,7 @@ StreamElementsObsSceneManager::ObsGetUniqueSourceName(std::string name)
 {
 	std::lock_guard<decltype(m_mutex)> guard(m_mutex);
 
-	std::string result(name);
-
-	int sequence = 0;
-
-	while (!isSourceNameUnique(nullptr, result)) {
-		++sequence;
-
-		char buf[32];
-		sprintf(buf, "%d", sequence);
-		result = name + " ";
-		result += buf;
-	}
-
-	return result;
+	return StreamElementsNameIndex::GetInstance()->GetUniqueName(name);
 }
 
 void StreamElementsObsSceneManager::DeserializeObsBrowserSource(
@@ -2675,6 +3283,25 @@ void StreamElementsObsSceneManager::DeserializeObsSceneItemGroup(
 	RefreshObsSceneItemsList(videoComposition);
 }
 
+// The scene `input` names by "id", or the current scene of the composition
+// when there is no input. Returns a new reference.
+static obs_scene_t *
+GetInputSceneRef(StreamElementsVideoCompositionBase *videoComposition,
+		 CefRefPtr<CefValue> input)
+{
+	if (input.get() && input->GetType() == VTYPE_DICTIONARY) {
+		auto root = input->GetDictionary();
+
+		if (!root->HasKey("id") || root->GetType("id") != VTYPE_STRING)
+			return nullptr;
+
+		// Get scene handle
+		return videoComposition->GetSceneByIdRef(root->GetString("id"));
+	}
+
+	return videoComposition->GetCurrentSceneRef();
+}
+
 void StreamElementsObsSceneManager::SerializeObsSceneItems(
 	CefRefPtr<CefValue> input, CefRefPtr<CefValue> &output,
 	bool serializeProperties)
@@ -2687,75 +3314,52 @@ void StreamElementsObsSceneManager::SerializeObsSceneItems(
 	if (!videoComposition.get())
 		return;
 
-	OBSSceneAutoRelease scene = nullptr;
-
-	if (input.get() && input->GetType() == VTYPE_DICTIONARY) {
-		auto root = input->GetDictionary();
-
-		if (!root->HasKey("id") || root->GetType("id") != VTYPE_STRING)
-			return;
-
-		// Get scene handle
-		scene = SETRACE_AUTODECREF(videoComposition->GetSceneByIdRef(
-			root->GetString("id")));
-	} else {
-		scene = SETRACE_AUTODECREF(
-			videoComposition->GetCurrentSceneRef());
-	}
+	OBSSceneAutoRelease scene = SETRACE_AUTODECREF(
+		GetInputSceneRef(videoComposition.get(), input));
 
 	if (scene) {
-		struct local_context {
-			CefRefPtr<CefListValue> list;
-			decltype(videoComposition) videoComposition;
-			std::vector<obs_sceneitem_t*> sceneItems;
-
-			~local_context()
-			{
-				for (const auto &item : sceneItems) {
-					obs_sceneitem_release(
-						SETRACE_DECREF(item));
-				}
-			}
-		};
+		SerializeObsSceneItemList(scene, videoComposition.get(),
+					  serializeProperties, output);
+	}
+}
 
-		local_context context;
+void StreamElementsObsSceneManager::SerializeObsSceneItemsSnapshot(
+	CefRefPtr<CefValue> input, CefRefPtr<CefValue> &output)
+{
+	std::lock_guard<decltype(m_mutex)> guard(m_mutex);
 
-		context.list = CefListValue::Create();
-		context.videoComposition = videoComposition;	
+	output->SetNull();
 
-		// For each scene item
-		obs_scene_enum_items(
-			scene,
-			[](obs_scene_t *scene, obs_sceneitem_t *sceneitem,
-			   void *param) {
-				local_context *context = (local_context *)param;
+	auto videoComposition = GetVideoComposition(input);
+	if (!videoComposition.get())
+		return;
 
-				obs_sceneitem_addref(SETRACE_ADDREF(sceneitem)); // Will be auto-released
+	OBSSceneAutoRelease scene = SETRACE_AUTODECREF(
+		GetInputSceneRef(videoComposition.get(), input));
 
-				context->sceneItems.push_back(sceneitem);
+	if (!scene)
+		return;
 
-				// Continue iteration
-				return true;
-			},
-			&context);
+	// Item changes which were not announced yet, such as source size, are
+	// published first, so clients holding an older version do not miss
+	// them.
+	auto delta = UpdateSceneItemList(scene, videoComposition.get());
 
-		for (const auto &it : context.sceneItems) {
-			obs_source_t *source = obs_sceneitem_get_source(
-				it); // does not increase refcount
+	if (!delta.is_null())
+		DispatchJSEventGlobal("hostSceneItemListDelta", delta.dump());
 
-			CefRefPtr<CefValue> item = CefValue::Create();
+	obs_source_t *sceneSource = obs_scene_get_source(scene);
 
-			SerializeSourceAndSceneItem(
-				item, scene, source, it,
-				context.list->GetSize(), true,
-				serializeProperties,
-				context.videoComposition.get());
+	auto snapshot =
+		GetSceneItemList(sceneSource)->GetSnapshot().object_items();
 
-			context.list->SetValue(context.list->GetSize(), item);
-		}
+	snapshot["sceneId"] = GetIdFromPointer(sceneSource);
+	snapshot["videoCompositionId"] = videoComposition->GetId();
 
-		output->SetList(context.list);
-	}
+	output->SetDictionary(
+		CefParseJSON(json11::Json(snapshot).dump(),
+			     JSON_PARSER_ALLOW_TRAILING_COMMAS)
+			->GetDictionary());
 }
 
 void StreamElementsObsSceneManager::SerializeObsCurrentScene(
@@ -3067,6 +3671,33 @@ void StreamElementsObsSceneManager::RemoveObsSceneItemsByIds(
 	}
 }
 
+static void SetObsSceneItemOrderPosition(obs_sceneitem_t *sceneitem, int order)
+{
+	auto scene = obs_sceneitem_get_scene(sceneitem);
+
+	int itemsCount = 0;
+	obs_scene_enum_items(
+		scene,
+		[](obs_scene_t *, obs_sceneitem_t *, void *data) -> bool {
+			auto itemsCountPtr = static_cast<int *>(data);
+
+			++(*itemsCountPtr);
+
+			return (*itemsCountPtr) < 2;
+		},
+		&itemsCount);
+
+	if (itemsCount > 1) {
+		// We need the IF case due to a bug in OBS whcih should be fixed by this PR:
+		// https://github.com/obsproject/obs-studio/pull/11985
+		//
+		// TL;DR: When setting non-zero order on the first and only scene item in a scene
+		//        libobs crashes
+		//
+		obs_sceneitem_set_order_position(sceneitem, order);
+	}
+}
+
 void StreamElementsObsSceneManager::DeserializeAuxiliaryObsSceneItemProperties(
 	std::shared_ptr<StreamElementsVideoCompositionBase> videoComposition,
 	obs_sceneitem_t *sceneitem, CefRefPtr<CefDictionaryValue> d)
@@ -3175,32 +3806,7 @@ void StreamElementsObsSceneManager::DeserializeAuxiliaryObsSceneItemProperties(
 #endif
 
 	if (d->HasKey("order") && d->GetType("order") == VTYPE_INT) {
-		int order = d->GetInt("order");
-
-		auto scene = obs_sceneitem_get_scene(sceneitem);
-
-		int itemsCount = 0;
-		obs_scene_enum_items(
-			scene,
-			[](obs_scene_t *, obs_sceneitem_t *,
-			   void *data) -> bool {
-				auto itemsCountPtr = static_cast<int *>(data);
-
-				++(*itemsCountPtr);
-
-				return (*itemsCountPtr) < 2;
-			},
-			&itemsCount);
-
-		if (itemsCount > 1) {
-			// We need the IF case due to a bug in OBS whcih should be fixed by this PR:
-			// https://github.com/obsproject/obs-studio/pull/11985
-			//
-			// TL;DR: When setting non-zero order on the first and only scene item in a scene
-			//        libobs crashes
-			//
-			obs_sceneitem_set_order_position(sceneitem, order);
-		}
+		SetObsSceneItemOrderPosition(sceneitem, d->GetInt("order"));
 	}
 
 	if (d->HasKey("visible") && d->GetType("visible") == VTYPE_BOOL) {
@@ -3301,6 +3907,185 @@ void StreamElementsObsSceneManager::SetObsSceneItemPropertiesById(
 					videoComposition.get());
 }
 
+typedef StreamElementsSceneItemBatch<obs_scene_t, obs_sceneitem_t,
+				     CefRefPtr<CefValue>>
+	scene_item_batch_t;
+
+// Applies the properties a batch accepts to one item, inside the atomic
+// update of its scene.
+static void ApplySceneItemBatchEntry(const scene_item_batch_t::Entry &entry)
+{
+	obs_sceneitem_t *sceneitem = entry.item;
+
+	// Fields the entry leaves out keep their current values, so a batch
+	// can move items without restating their scale, crop and bounds.
+	obs_transform_info info;
+	obs_sceneitem_crop crop;
+
+	obs_sceneitem_get_info2(sceneitem, &info);
+	obs_sceneitem_get_crop(sceneitem, &crop);
+
+	if (DeserializeSceneItemComposition(entry.props, info, crop, true)) {
+		obs_sceneitem_set_info2(sceneitem, &info);
+		obs_sceneitem_set_crop(sceneitem, &crop);
+	}
+
+	CefRefPtr<CefDictionaryValue> d = entry.props->GetDictionary();
+
+	if (d->HasKey("visible") && d->GetType("visible") == VTYPE_BOOL) {
+		obs_sceneitem_set_visible(sceneitem, d->GetBool("visible"));
+	}
+
+	if (d->HasKey("locked") && d->GetType("locked") == VTYPE_BOOL) {
+		obs_sceneitem_set_locked(sceneitem, d->GetBool("locked"));
+	}
+
+	if (d->HasKey("order") && d->GetType("order") == VTYPE_INT) {
+		SetObsSceneItemOrderPosition(sceneitem, d->GetInt("order"));
+	}
+}
+
+void StreamElementsObsSceneManager::SetObsSceneItemsPropertiesById(
+	CefRefPtr<CefValue> input, CefRefPtr<CefValue> &output)
+{
+	std::lock_guard<decltype(m_mutex)> guard(m_mutex);
+
+	if (!input.get() || input->GetType() != VTYPE_DICTIONARY)
+		return;
+
+	auto videoComposition = GetVideoComposition(input);
+	if (!videoComposition.get())
+		return;
+
+	CefRefPtr<CefDictionaryValue> root = input->GetDictionary();
+
+	if (!root->HasKey("items") || root->GetType("items") != VTYPE_LIST)
+		return;
+
+	CefRefPtr<CefListValue> list = root->GetList("items");
+
+	scene_item_batch_t batch;
+
+	for (size_t i = 0; i < list->GetSize(); ++i) {
+		CefRefPtr<CefValue> props = list->GetValue(i);
+
+		std::string id;
+
+		if (props->GetType() == VTYPE_DICTIONARY &&
+		    props->GetDictionary()->GetType("id") == VTYPE_STRING)
+			id = props->GetDictionary()->GetString("id").ToString();
+
+		batch.Add(id, id.size() ? GetPointerFromId(id.c_str()) : nullptr,
+			  props);
+	}
+
+	// Resolve every id in a single pass over the composition's scenes
+	StreamElementsVideoCompositionBase::scenes_t scenes;
+	videoComposition->GetAllScenes(scenes);
+
+	for (auto scene : scenes) {
+		if (batch.IsResolved())
+			break;
+
+		scanSceneItems(
+			scene,
+			[&](obs_sceneitem_t *sceneitem,
+			    obs_sceneitem_t * /*parent*/) -> bool {
+				if (batch.Resolve(sceneitem,
+						  obs_sceneitem_get_scene(
+							  sceneitem),
+						  scene))
+					obs_sceneitem_addref(
+						SETRACE_ADDREF(sceneitem));
+
+				return !batch.IsResolved();
+			},
+			true);
+	}
+
+	// Browsers see one consolidated change per scene instead of the
+	// signals of each item
+	auto suppressor = GetSceneItemEventSuppressor();
+
+	for (auto &entry : batch.GetEntries()) {
+		if (entry.status != scene_item_batch_t::STATUS_OK)
+			continue;
+
+		suppressor->Suppress(entry.item);
+
+		if (entry.props->GetDictionary()->HasKey("composition"))
+			suppressor->ExpectSignal(entry.item);
+	}
+
+	batch.ForEachScene(
+		[&](obs_scene_t *scene,
+		    const std::vector<const scene_item_batch_t::Entry *>
+			    &entries) {
+			suppressor->Suppress(scene);
+
+			obs_scene_atomic_update(
+				scene,
+				[](void *data, obs_scene_t *) {
+					auto entries = (const std::vector<
+							const scene_item_batch_t::
+								Entry *> *)data;
+
+					for (auto entry : *entries)
+						ApplySceneItemBatchEntry(*entry);
+				},
+				(void *)&entries);
+
+			suppressor->Resume(scene);
+		});
+
+	// Only the fragments of the items changed are stale. An item's order
+	// is not part of its fragment, it is filled in on every call by
+	// CompleteSceneItemFragment(), and a reorder keeps items in their
+	// scene, so their siblings' fragments and group membership still hold.
+	auto cache = GetSceneItemFragmentCache();
+
+	CefRefPtr<CefListValue> results = CefListValue::Create();
+
+	for (auto &entry : batch.GetEntries()) {
+		CefRefPtr<CefDictionaryValue> d = CefDictionaryValue::Create();
+
+		d->SetString("id", entry.id);
+		d->SetBool("success",
+			   entry.status == scene_item_batch_t::STATUS_OK);
+
+		if (entry.status != scene_item_batch_t::STATUS_OK)
+			d->SetString("error", scene_item_batch_t::GetStatusName(
+						      entry.status));
+
+		results->SetDictionary(results->GetSize(), d);
+
+		if (entry.status != scene_item_batch_t::STATUS_OK)
+			continue;
+
+		suppressor->Resume(entry.item);
+		cache->InvalidateItem(entry.item);
+	}
+
+	for (auto scene : batch.GetRootScenes()) {
+		dispatch_scene_event(scene, "hostActiveSceneItemListChanged",
+				     "hostSceneItemListChanged");
+
+		dispatch_scene_item_list_delta(scene);
+	}
+
+	for (auto &entry : batch.GetEntries()) {
+		if (entry.status == scene_item_batch_t::STATUS_OK)
+			obs_sceneitem_release(SETRACE_DECREF(entry.item));
+	}
+
+	Update();
+
+	CefRefPtr<CefDictionaryValue> result = CefDictionaryValue::Create();
+	result->SetList("items", results);
+
+	output->SetDictionary(result);
+}
+
 void StreamElementsObsSceneManager::GetObsSceneItemPropertiesById(
 	CefRefPtr<CefValue> input, CefRefPtr<CefValue> &output)
 {
@@ -52,6 +52,10 @@ public:
 		Update();
 	}
 
+	// Drops the cached serialization of a scene item, for changes which
+	// OBS does not signal, such as to its private settings.
+	static void InvalidateSerializedSceneItem(obs_sceneitem_t *sceneitem);
+
 	/* Sources */
 
 	void SerializeInputSourceClasses(CefRefPtr<CefValue> &output);
@@ -79,6 +83,8 @@ public:
 	void SerializeObsSceneItems(CefRefPtr<CefValue> input,
 				    CefRefPtr<CefValue> &output,
 				    bool serializeProperties);
+	void SerializeObsSceneItemsSnapshot(CefRefPtr<CefValue> input,
+					    CefRefPtr<CefValue> &output);
 
 	void RemoveObsSceneItemsByIds(CefRefPtr<CefValue> input,
 				      CefRefPtr<CefValue> &output);
@@ -86,6 +92,9 @@ public:
 	void SetObsSceneItemPropertiesById(CefRefPtr<CefValue> input,
 					   CefRefPtr<CefValue> &output);
 
+	void SetObsSceneItemsPropertiesById(CefRefPtr<CefValue> input,
+					    CefRefPtr<CefValue> &output);
+
 	void GetObsSceneItemPropertiesById(CefRefPtr<CefValue> input,
 					   CefRefPtr<CefValue> &output);
 
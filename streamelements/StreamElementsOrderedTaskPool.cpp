@@ -0,0 +1,123 @@
+#include "StreamElementsOrderedTaskPool.hpp"
+
+#include <algorithm>
+
+StreamElementsOrderedTaskPool::StreamElementsOrderedTaskPool(size_t workerCount)
+{
+	if (!workerCount) {
+		const size_t cpus = std::thread::hardware_concurrency();
+
+		workerCount = std::min<size_t>(std::max<size_t>(cpus / 2, 1), 4);
+	}
+
+	for (size_t i = 0; i < workerCount; ++i)
+		m_workers.emplace_back([this]() { WorkerMain(); });
+}
+
+StreamElementsOrderedTaskPool::~StreamElementsOrderedTaskPool()
+{
+	Stop();
+}
+
+void StreamElementsOrderedTaskPool::Post(const void *key, task_t task)
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+
+	if (m_stopped)
+		return;
+
+	auto &queue = m_queues[key];
+
+	queue.tasks.push_back(task);
+	++m_pendingCount;
+
+	if (!queue.running && queue.tasks.size() == 1) {
+		m_ready.push_back(key);
+		m_taskAvailable.notify_one();
+	}
+}
+
+void StreamElementsOrderedTaskPool::Flush()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	m_idle.wait(lock, [this]() { return !m_pendingCount; });
+}
+
+void StreamElementsOrderedTaskPool::Stop()
+{
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+
+		if (m_stopped)
+			return;
+
+		m_stopped = true;
+
+		for (auto &kv : m_queues) {
+			m_pendingCount -= kv.second.tasks.size();
+			kv.second.tasks.clear();
+		}
+
+		m_ready.clear();
+	}
+
+	m_taskAvailable.notify_all();
+
+	for (auto &worker : m_workers) {
+		if (worker.joinable())
+			worker.join();
+	}
+
+	std::lock_guard<std::mutex> guard(m_mutex);
+
+	m_queues.clear();
+	m_idle.notify_all();
+}
+
+void StreamElementsOrderedTaskPool::WorkerMain()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	while (true) {
+		m_taskAvailable.wait(
+			lock, [this]() { return m_stopped || !m_ready.empty(); });
+
+		if (m_stopped)
+			return;
+
+		const void *key = m_ready.front();
+		m_ready.pop_front();
+
+		auto &queue = m_queues[key];
+
+		task_t task = std::move(queue.tasks.front());
+		queue.tasks.pop_front();
+		queue.running = true;
+
+		lock.unlock();
+
+		task();
+
+		lock.lock();
+
+		--m_pendingCount;
+
+		auto it = m_queues.find(key);
+
+		if (it != m_queues.end()) {
+			it->second.running = false;
+
+			if (it->second.tasks.empty())
+				m_queues.erase(it);
+			else if (!m_stopped)
+				m_ready.push_back(key);
+		}
+
+		if (!m_pendingCount)
+			m_idle.notify_all();
+
+		if (!m_ready.empty())
+			m_taskAvailable.notify_one();
+	}
+}
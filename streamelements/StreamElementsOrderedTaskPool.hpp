@@ -0,0 +1,66 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+//
+// A pool of worker threads which runs tasks in order per key.
+//
+// The websocket API server parsed and handled every incoming message on its
+// network thread, so one large payload from one client stalled framing for
+// every other client. Messages are now posted here, keyed by connection:
+// tasks of the same key run one at a time, in the order they were posted,
+// and tasks of different keys run concurrently.
+//
+// A key with more tasks goes to the back of the line after each task, so
+// that a client which sends a burst does not starve the others.
+//
+// Stop() discards the tasks which have not started, waits for the running
+// ones and joins the workers; tasks posted afterwards are discarded.
+//
+class StreamElementsOrderedTaskPool {
+public:
+	typedef std::function<void()> task_t;
+
+public:
+	// 0 picks a default based on hardware concurrency.
+	StreamElementsOrderedTaskPool(size_t workerCount = 0);
+	~StreamElementsOrderedTaskPool();
+
+	void Post(const void *key, task_t task);
+
+	// Waits until every task posted so far has run.
+	void Flush();
+
+	void Stop();
+
+	size_t GetWorkerCount() const { return m_workers.size(); }
+
+private:
+	void WorkerMain();
+
+private:
+	struct Queue {
+		std::deque<task_t> tasks;
+		bool running = false;
+	};
+
+	std::mutex m_mutex;
+	std::condition_variable m_taskAvailable;
+	std::condition_variable m_idle;
+
+	bool m_stopped = false;
+	size_t m_pendingCount = 0;
+
+	std::unordered_map<const void *, Queue> m_queues;
+	// Keys with tasks which are not running
+	std::deque<const void *> m_ready;
+
+	std::vector<std::thread> m_workers;
+};
@@ -224,6 +224,21 @@ static void dispatch_list_change_event(StreamElementsOutputBase *output)
 		DispatchJSEventGlobal("hostRecordingOutputListChanged", "null");
 	else
 		DispatchJSEventGlobal("hostReplayBufferOutputListChanged", "null");
+
+	// Outputs are created and destroyed with the output manager's lock
+	// held, and the delta serializes the list under that lock.
+	auto outputType = output->GetOutputType();
+
+	QtPostTask([outputType]() {
+		if (!StreamElementsGlobalStateManager::IsInstanceAvailable())
+			return;
+
+		auto outputManager = StreamElementsGlobalStateManager::GetInstance()
+					     ->GetOutputManager();
+
+		if (outputManager)
+			outputManager->PublishOutputListDelta(outputType);
+	});
 }
 
 static void dispatch_event(
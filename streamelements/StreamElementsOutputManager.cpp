@@ -1,6 +1,16 @@
 #include "StreamElementsOutputManager.hpp"
 #include "StreamElementsUtils.hpp"
 
+static const char *get_list_delta_event_name(ObsOutputType outputType)
+{
+	if (outputType == StreamingOutput)
+		return "hostStreamingOutputListDelta";
+	else if (outputType == RecordingOutput)
+		return "hostRecordingOutputListDelta";
+	else
+		return "hostReplayBufferOutputListDelta";
+}
+
 StreamElementsOutputManager::StreamElementsOutputManager(
 	std::shared_ptr<StreamElementsVideoCompositionManager>
 		videoCompositionManager,
@@ -41,6 +51,10 @@ StreamElementsOutputManager::StreamElementsOutputManager(
 
 	(*m_map[ReplayBufferOutput].get())[nativeReplayBufferOutput->GetId()] =
 		nativeReplayBufferOutput;
+
+	for (auto &kv : m_map)
+		m_versionedLists[kv.first] =
+			std::make_shared<StreamElementsVersionedList>();
 }
 
 StreamElementsOutputManager::~StreamElementsOutputManager()
@@ -139,6 +153,12 @@ void StreamElementsOutputManager::SerializeAllOutputs(
 {
 	std::shared_lock<decltype(m_mutex)> lock(m_mutex);
 
+	SerializeAllOutputsInternal(outputType, output);
+}
+
+void StreamElementsOutputManager::SerializeAllOutputsInternal(
+	ObsOutputType outputType, CefRefPtr<CefValue> &output)
+{
 	auto d = CefDictionaryValue::Create();
 
 	for (auto &kv : (*m_map[outputType].get())) {
@@ -152,6 +172,49 @@ void StreamElementsOutputManager::SerializeAllOutputs(
 	output->SetDictionary(d);
 }
 
+void StreamElementsOutputManager::SerializeAllOutputsSnapshot(
+	ObsOutputType outputType, CefRefPtr<CefValue> &output)
+{
+	std::shared_lock<decltype(m_mutex)> lock(m_mutex);
+
+	// Whatever changed without a list change event is published first, so
+	// clients holding an older version do not miss it.
+	PublishOutputListDeltaInternal(outputType);
+
+	auto snapshot = CefParseJSON(
+		m_versionedLists[outputType]->GetSnapshot().dump(),
+		JSON_PARSER_ALLOW_TRAILING_COMMAS);
+
+	output->SetDictionary(snapshot->GetDictionary());
+}
+
+void StreamElementsOutputManager::PublishOutputListDelta(
+	ObsOutputType outputType)
+{
+	std::shared_lock<decltype(m_mutex)> lock(m_mutex);
+
+	PublishOutputListDeltaInternal(outputType);
+}
+
+void StreamElementsOutputManager::PublishOutputListDeltaInternal(
+	ObsOutputType outputType)
+{
+	if (!m_versionedLists.count(outputType))
+		return;
+
+	auto list = CefValue::Create();
+	SerializeAllOutputsInternal(outputType, list);
+
+	auto delta = m_versionedLists[outputType]->Update(
+		CefWriteJSON(list, JSON_WRITER_DEFAULT).ToString());
+
+	if (delta.is_null())
+		return;
+
+	DispatchJSEventGlobal(get_list_delta_event_name(outputType),
+			      delta.dump());
+}
+
 void StreamElementsOutputManager::RemoveOutputsByIds(ObsOutputType outputType,
 	CefRefPtr<CefValue> input, CefRefPtr<CefValue> &output)
 {
@@ -167,6 +230,8 @@ void StreamElementsOutputManager::RemoveOutputsByIds(ObsOutputType outputType,
 	// Remove all valid IDs
 	for (const auto &kv : map) {
 		m_map[outputType]->erase(kv.first);
+
+		RemoveStateEventScopeGlobal("outputId", kv.first);
 	}
 
 	output->SetBool(true);
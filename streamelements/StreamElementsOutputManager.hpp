@@ -3,6 +3,7 @@
 #include "StreamElementsOutput.hpp"
 #include "StreamElementsVideoCompositionManager.hpp"
 #include "StreamElementsAudioCompositionManager.hpp"
+#include "StreamElementsVersionedList.hpp"
 
 #include <shared_mutex>
 
@@ -17,6 +18,11 @@ private:
 	std::shared_ptr<StreamElementsAudioCompositionManager>
 		m_audioCompositionManager;
 
+	// Versioned serializations of m_map, behind the output list delta
+	// events.
+	std::map<ObsOutputType, std::shared_ptr<StreamElementsVersionedList>>
+		m_versionedLists;
+
 public:
 	StreamElementsOutputManager(
 		std::shared_ptr<StreamElementsVideoCompositionManager>
@@ -31,6 +37,8 @@ public:
 			  CefRefPtr<CefValue> &output);
 	void SerializeAllOutputs(ObsOutputType outputType,
 				 CefRefPtr<CefValue> &output);
+	void SerializeAllOutputsSnapshot(ObsOutputType outputType,
+					 CefRefPtr<CefValue> &output);
 	void RemoveOutputsByIds(ObsOutputType outputType,
 			   CefRefPtr<CefValue> input,
 			   CefRefPtr<CefValue> &output);
@@ -49,7 +57,16 @@ public:
 
 	void Reset();
 
+	// Dispatches what changed in the list since its last version, if
+	// anything did.
+	void PublishOutputListDelta(ObsOutputType outputType);
+
 private:
+	// Call with m_mutex held.
+	void SerializeAllOutputsInternal(ObsOutputType outputType,
+					 CefRefPtr<CefValue> &output);
+	void PublishOutputListDeltaInternal(ObsOutputType outputType);
+
 	bool GetValidIds(ObsOutputType outputType,
 			 CefRefPtr<CefValue> input,
 			 std::map<std::string, bool> &output, bool testRemove,
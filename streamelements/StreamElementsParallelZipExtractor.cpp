@@ -0,0 +1,340 @@
+#include "StreamElementsParallelZipExtractor.hpp"
+
+#include "deps/zip/zip.h"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <thread>
+
+static const char *const TEMP_FILE_SUFFIX = ".se-restore.tmp";
+
+static const size_t MAX_DEFAULT_WORKER_COUNT = 8;
+
+/* ================================================================= */
+
+bool StreamElementsParallelZipExtractor::IsSafeEntryPath(
+	const std::string &zipPath)
+{
+	if (zipPath.empty() || zipPath.front() == '/' ||
+	    zipPath.back() == '/')
+		return false;
+
+	// Backslashes are separators on Windows, and a colon makes a drive
+	// letter or an NTFS stream name. Neither belongs in a zip path.
+	if (zipPath.find_first_of("\\:") != std::string::npos)
+		return false;
+
+	size_t start = 0;
+
+	while (start <= zipPath.size()) {
+		size_t end = zipPath.find('/', start);
+
+		if (end == std::string::npos)
+			end = zipPath.size();
+
+		const std::string component = zipPath.substr(start, end - start);
+
+		if (component.empty() || component == "." || component == "..")
+			return false;
+
+		start = end + 1;
+	}
+
+	return true;
+}
+
+/* ================================================================= */
+
+StreamElementsParallelZipExtractor::StreamElementsParallelZipExtractor(
+	std::string destRootPath, Options options)
+	: m_destRootPath(destRootPath), m_options(options)
+{
+	if (!m_options.workerCount) {
+		m_options.workerCount = std::max<size_t>(
+			1, std::min<size_t>(std::thread::hardware_concurrency(),
+					    MAX_DEFAULT_WORKER_COUNT));
+	}
+}
+
+StreamElementsParallelZipExtractor::~StreamElementsParallelZipExtractor() {}
+
+bool StreamElementsParallelZipExtractor::Add(const std::string &archivePath,
+					     int entryIndex,
+					     const std::string &zipPath,
+					     uint64_t size)
+{
+	if (!IsSafeEntryPath(zipPath))
+		return false;
+
+	Job job;
+
+	job.archivePath = archivePath;
+	job.entryIndex = entryIndex;
+	job.zipPath = zipPath;
+	job.size = size;
+	job.destPath = m_destRootPath + "/" + zipPath;
+	job.tempPath = job.destPath + TEMP_FILE_SUFFIX;
+
+	std::lock_guard<decltype(m_mutex)> guard(m_mutex);
+
+	m_jobs.push_back(job);
+
+	++m_stats.entriesQueued;
+	m_stats.bytesQueued += size;
+
+	return true;
+}
+
+StreamElementsParallelZipExtractor::Stats
+StreamElementsParallelZipExtractor::GetStats()
+{
+	std::lock_guard<decltype(m_mutex)> guard(m_mutex);
+
+	Stats stats = m_stats;
+	stats.bytesExtracted = m_bytesExtracted;
+
+	return stats;
+}
+
+void StreamElementsParallelZipExtractor::SetProgressCallback(
+	progress_callback_t callback)
+{
+	std::lock_guard<decltype(m_mutex)> guard(m_mutex);
+
+	m_progressCallback = callback;
+}
+
+/* ================================================================= */
+
+bool StreamElementsParallelZipExtractor::Run()
+{
+	const auto extractStart = std::chrono::steady_clock::now();
+
+	auto updateElapsed = [&]() {
+		m_stats.extractSeconds =
+			std::chrono::duration<double>(
+				std::chrono::steady_clock::now() - extractStart)
+				.count();
+	};
+
+	const size_t workerCount =
+		std::min(m_options.workerCount, m_jobs.size());
+
+	std::vector<std::thread> workers;
+
+	{
+		std::lock_guard<decltype(m_mutex)> guard(m_mutex);
+
+		m_activeWorkers = workerCount;
+	}
+
+	for (size_t i = 0; i < workerCount; ++i)
+		workers.emplace_back([this]() { WorkerThreadProc(); });
+
+	for (;;) {
+		std::unique_lock<decltype(m_mutex)> lock(m_mutex);
+
+		const bool done = m_workersDone.wait_for(
+			lock, m_options.progressInterval,
+			[this]() { return !m_activeWorkers; });
+
+		updateElapsed();
+
+		if (done)
+			break;
+
+		progress_callback_t callback = m_progressCallback;
+
+		lock.unlock();
+
+		if (callback)
+			callback(GetStats());
+	}
+
+	for (auto &worker : workers)
+		worker.join();
+
+	bool success = !m_failed;
+
+	if (success) {
+		const auto commitStart = std::chrono::steady_clock::now();
+
+		success = Commit();
+
+		std::lock_guard<decltype(m_mutex)> guard(m_mutex);
+
+		m_stats.commitSeconds =
+			std::chrono::duration<double>(
+				std::chrono::steady_clock::now() - commitStart)
+				.count();
+	} else {
+		Rollback();
+	}
+
+	progress_callback_t callback;
+
+	{
+		std::lock_guard<decltype(m_mutex)> guard(m_mutex);
+
+		callback = m_progressCallback;
+	}
+
+	if (callback)
+		callback(GetStats());
+
+	return success;
+}
+
+void StreamElementsParallelZipExtractor::WorkerThreadProc()
+{
+	// One read handle per archive per worker: miniz seeks and reads
+	// through a single FILE* per handle.
+	std::map<std::string, zip_t *> archives;
+
+	for (;;) {
+		size_t index;
+
+		{
+			std::lock_guard<decltype(m_mutex)> guard(m_mutex);
+
+			if (m_failed || m_nextJob >= m_jobs.size())
+				break;
+
+			index = m_nextJob++;
+		}
+
+		Job &job = m_jobs[index];
+
+		zip_t *&zip = archives[job.archivePath];
+
+		if (!zip)
+			zip = zip_open(job.archivePath.c_str(), 0, 'r');
+
+		const bool success = zip && ExtractJob(zip, job);
+
+		std::lock_guard<decltype(m_mutex)> guard(m_mutex);
+
+		if (success) {
+			++m_stats.entriesExtracted;
+		} else {
+			++m_stats.entriesFailed;
+
+			// Nothing gets committed anyway: stop early.
+			m_failed = true;
+		}
+	}
+
+	for (auto &kv : archives) {
+		if (kv.second)
+			zip_close(kv.second);
+	}
+
+	std::lock_guard<decltype(m_mutex)> guard(m_mutex);
+
+	--m_activeWorkers;
+
+	m_workersDone.notify_all();
+}
+
+struct extract_context_t {
+	std::ofstream *out;
+	std::atomic<uint64_t> *bytesExtracted;
+};
+
+static size_t HandleExtract(void *arg, unsigned long long offset,
+			    const void *data, size_t size)
+{
+	(void)offset;
+
+	extract_context_t *context = (extract_context_t *)arg;
+
+	if (!context->out->write((const char *)data, size))
+		return 0;
+
+	*context->bytesExtracted += size;
+
+	return size;
+}
+
+bool StreamElementsParallelZipExtractor::ExtractJob(zip_t *zip, Job &job)
+{
+	if (0 != zip_entry_openbyindex(zip, job.entryIndex))
+		return false;
+
+	const auto tempPath = std::filesystem::u8path(job.tempPath);
+
+	std::error_code ec;
+	std::filesystem::create_directories(tempPath.parent_path(), ec);
+
+	bool success = false;
+
+	if (!ec) {
+		std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+
+		if (out) {
+			extract_context_t context = {&out, &m_bytesExtracted};
+
+			success = 0 == zip_entry_extract(zip, HandleExtract,
+							 &context);
+
+			out.close();
+
+			success = success && !out.fail();
+		}
+	}
+
+	zip_entry_close(zip);
+
+	if (!success)
+		std::filesystem::remove(tempPath, ec);
+
+	job.extracted = success;
+
+	return success;
+}
+
+bool StreamElementsParallelZipExtractor::Commit()
+{
+	bool success = true;
+
+	for (auto &job : m_jobs) {
+		std::error_code ec;
+
+		if (success) {
+			// Replaces an existing destination in one step, on
+			// Windows as well.
+			std::filesystem::rename(
+				std::filesystem::u8path(job.tempPath),
+				std::filesystem::u8path(job.destPath), ec);
+
+			if (!ec)
+				continue;
+
+			success = false;
+		}
+
+		// Past a failed rename: drop what is left rather than leave
+		// temporaries behind.
+		std::filesystem::remove(std::filesystem::u8path(job.tempPath),
+					ec);
+	}
+
+	return success;
+}
+
+void StreamElementsParallelZipExtractor::Rollback()
+{
+	for (auto &job : m_jobs) {
+		if (!job.extracted)
+			continue;
+
+		std::error_code ec;
+		std::filesystem::remove(std::filesystem::u8path(job.tempPath),
+					ec);
+
+		job.extracted = false;
+	}
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <functional>
+#include <chrono>
+#include <cstdint>
+#include <atomic>
+#include <condition_variable>
+
+struct zip_t;
+
+//
+// Extracts entries of one or more zip archives into a folder, in parallel.
+//
+// Restoring a backup package used to extract entries one after another,
+// straight over the files they replace: a package of thousands of small files
+// was bound by per-file latency, and a failure half way through left a mix of
+// restored and original files behind.
+//
+// Entries are queued with Add() and extracted by a pool of workers, each with
+// its own read handle on every archive it touches -- miniz readers are not
+// safe to share between threads. Every entry is written to a temporary file
+// next to its destination; only once all of them were extracted successfully
+// are the temporary files renamed over their destinations. Should any entry
+// fail, the temporaries are removed and the destination folder is left as it
+// was.
+//
+// Entry paths are validated on Add(): absolute paths, drive letters,
+// backslashes and "." or ".." components are refused, so a crafted archive
+// cannot write outside the destination folder.
+//
+class StreamElementsParallelZipExtractor {
+public:
+	struct Options {
+		// 0 picks a default based on hardware concurrency.
+		size_t workerCount = 0;
+
+		// Minimum interval between progress callbacks.
+		std::chrono::milliseconds progressInterval =
+			std::chrono::milliseconds(250);
+	};
+
+	struct Stats {
+		size_t entriesQueued = 0;
+		size_t entriesExtracted = 0;
+		size_t entriesFailed = 0;
+
+		uint64_t bytesQueued = 0;
+		uint64_t bytesExtracted = 0;
+
+		double extractSeconds = 0.0;
+		double commitSeconds = 0.0;
+
+		double GetBytesPerSecond() const
+		{
+			return extractSeconds > 0.0 ? (double)bytesExtracted /
+							      extractSeconds
+						    : 0.0;
+		}
+	};
+
+	// Invoked on the thread calling Run(), throttled to
+	// Options::progressInterval, and once more when extraction ends.
+	typedef std::function<void(const Stats &stats)> progress_callback_t;
+
+public:
+	StreamElementsParallelZipExtractor(std::string destRootPath,
+					   Options options);
+	~StreamElementsParallelZipExtractor();
+
+	// Queues entry `entryIndex` of `archivePath` for extraction to
+	// <destRootPath>/<zipPath>. `size` is the uncompressed size, used for
+	// progress only. Returns false, queueing nothing, when `zipPath` is
+	// not safe to extract.
+	bool Add(const std::string &archivePath, int entryIndex,
+		 const std::string &zipPath, uint64_t size);
+
+	// Extracts every queued entry, then moves them into place. Returns
+	// false if any entry failed; the destination is then left untouched.
+	bool Run();
+
+	Stats GetStats();
+
+	void SetProgressCallback(progress_callback_t callback);
+
+	// True when `zipPath` is a relative path confined to the folder it
+	// is extracted into.
+	static bool IsSafeEntryPath(const std::string &zipPath);
+
+private:
+	struct Job {
+		std::string archivePath;
+		int entryIndex;
+		std::string zipPath;
+		uint64_t size;
+
+		std::string destPath;
+		std::string tempPath;
+		bool extracted = false;
+	};
+
+	void WorkerThreadProc();
+	bool ExtractJob(zip_t *zip, Job &job);
+
+	bool Commit();
+	void Rollback();
+
+private:
+	std::string m_destRootPath;
+	Options m_options;
+
+	std::vector<Job> m_jobs;
+
+	std::mutex m_mutex;
+	std::condition_variable m_workersDone;
+	size_t m_nextJob = 0;
+	size_t m_activeWorkers = 0;
+	bool m_failed = false;
+
+	std::atomic<uint64_t> m_bytesExtracted{0};
+
+	Stats m_stats;
+	progress_callback_t m_progressCallback;
+};
@@ -0,0 +1,692 @@
+#include "StreamElementsParallelZipWriter.hpp"
+
+#include "deps/zip/zip.h"
+
+#define MINIZ_HEADER_FILE_ONLY
+#include "deps/zip/miniz.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+
+/* ================================================================= */
+
+static const size_t STREAM_CHUNK_SIZE = 1024 * 1024;
+
+// Prepared chunks of a streamed entry the writer has not taken yet; the worker
+// waits beyond this.
+static const size_t MAX_QUEUED_STREAM_CHUNKS = 8;
+static const size_t ENTROPY_SAMPLE_SIZE = 64 * 1024;
+
+// Below this there is not enough content for the entropy estimate to mean
+// anything; only the extension is consulted.
+static const size_t ENTROPY_MIN_SAMPLE_SIZE = 4096;
+
+// Bits per byte. Deflate output itself sits at ~7.99; text and uncompressed
+// media are well below 7.
+static const double INCOMPRESSIBLE_ENTROPY = 7.5;
+
+static const char *const INCOMPRESSIBLE_EXTENSIONS[] = {
+	".mp4", ".m4v", ".mov", ".mkv", ".webm", ".flv", ".avi", ".ts",
+	".mp3", ".m4a", ".aac", ".ogg", ".opus", ".flac", ".png", ".jpg",
+	".jpeg", ".gif", ".webp", ".avif", ".heic", ".zip", ".7z", ".rar",
+	".gz", ".bz2", ".xz", ".zst", ".woff", ".woff2"};
+
+static bool HasIncompressibleExtension(const std::string &path)
+{
+	const size_t dot = path.find_last_of('.');
+
+	if (dot == std::string::npos ||
+	    path.find_first_of("/\\", dot) != std::string::npos)
+		return false;
+
+	std::string ext = path.substr(dot);
+	std::transform(ext.begin(), ext.end(), ext.begin(),
+		       [](unsigned char ch) { return (char)std::tolower(ch); });
+
+	for (auto item : INCOMPRESSIBLE_EXTENSIONS) {
+		if (ext == item)
+			return true;
+	}
+
+	return false;
+}
+
+static double GetShannonEntropy(const unsigned char *data, size_t size)
+{
+	size_t histogram[256] = {0};
+
+	for (size_t i = 0; i < size; ++i)
+		++histogram[data[i]];
+
+	double entropy = 0.0;
+
+	for (size_t count : histogram) {
+		if (!count)
+			continue;
+
+		const double p = (double)count / (double)size;
+
+		entropy -= p * std::log2(p);
+	}
+
+	return entropy;
+}
+
+static mz_bool AppendToString(const void *buf, int len, void *user)
+{
+	((std::string *)user)->append((const char *)buf, (size_t)len);
+
+	return MZ_TRUE;
+}
+
+bool StreamElementsParallelZipWriter::IsIncompressible(
+	const std::string &path, const unsigned char *sample, size_t sampleSize)
+{
+	if (HasIncompressibleExtension(path))
+		return true;
+
+	if (sampleSize < ENTROPY_MIN_SAMPLE_SIZE)
+		return false;
+
+	return GetShannonEntropy(sample, sampleSize) > INCOMPRESSIBLE_ENTROPY;
+}
+
+/* ================================================================= */
+
+StreamElementsParallelZipWriter::StreamElementsParallelZipWriter(
+	Options options)
+	: m_options(options)
+{
+	if (m_options.level < 0)
+		m_options.level = 0;
+
+	if (m_options.level > 9)
+		m_options.level = 9;
+
+	if (!m_options.workerCount) {
+		const size_t cpus = std::thread::hardware_concurrency();
+
+		// Leave a core for the writer and for OBS itself.
+		m_options.workerCount =
+			std::max<size_t>(1, std::min<size_t>(cpus - 1, 8));
+
+		if (cpus <= 1)
+			m_options.workerCount = 1;
+	}
+}
+
+StreamElementsParallelZipWriter::~StreamElementsParallelZipWriter()
+{
+	Close();
+}
+
+bool StreamElementsParallelZipWriter::Open(const std::string &path)
+{
+	if (m_zip)
+		return false;
+
+	m_zip = zip_open(path.c_str(), m_options.level, 'w');
+
+	if (!m_zip)
+		return false;
+
+	m_startTime = std::chrono::steady_clock::now();
+
+	for (size_t i = 0; i < m_options.workerCount; ++i)
+		m_workers.emplace_back([this]() { WorkerThreadProc(); });
+
+	m_writer = std::thread([this]() { WriterThreadProc(); });
+
+	return true;
+}
+
+void StreamElementsParallelZipWriter::AddFile(const std::string &localPath,
+					      const std::string &zipPath)
+{
+	Entry entry;
+
+	entry.localPath = localPath;
+	entry.zipPath = zipPath;
+	entry.reservedBytes = EstimateEntryBytes(entry);
+
+	std::lock_guard<decltype(m_mutex)> guard(m_mutex);
+
+	if (!m_zip || m_closing)
+		return;
+
+	m_entries.push_back(std::move(entry));
+	++m_stats.entriesQueued;
+
+	m_workAvailable.notify_one();
+}
+
+void StreamElementsParallelZipWriter::AddBuffer(std::string content,
+						const std::string &zipPath)
+{
+	Entry entry;
+
+	entry.zipPath = zipPath;
+	entry.isBuffer = true;
+	entry.data = std::move(content);
+	entry.reservedBytes = entry.data.size();
+
+	std::lock_guard<decltype(m_mutex)> guard(m_mutex);
+
+	if (!m_zip || m_closing)
+		return;
+
+	m_inFlightBytes += entry.reservedBytes;
+
+	m_entries.push_back(std::move(entry));
+	++m_stats.entriesQueued;
+
+	m_workAvailable.notify_one();
+}
+
+bool StreamElementsParallelZipWriter::Close()
+{
+	{
+		std::lock_guard<decltype(m_mutex)> guard(m_mutex);
+
+		if (!m_zip)
+			return false;
+
+		m_closing = true;
+
+		m_workAvailable.notify_all();
+		m_entryReady.notify_all();
+	}
+
+	for (auto &worker : m_workers)
+		worker.join();
+
+	m_workers.clear();
+
+	if (m_writer.joinable())
+		m_writer.join();
+
+	zip_close(m_zip);
+	m_zip = nullptr;
+
+	std::lock_guard<decltype(m_mutex)> guard(m_mutex);
+
+	m_stats.elapsedSeconds =
+		std::chrono::duration<double>(std::chrono::steady_clock::now() -
+					      m_startTime)
+			.count();
+
+	return !m_writeFailed && !m_stats.entriesFailed;
+}
+
+void StreamElementsParallelZipWriter::Flush()
+{
+	std::unique_lock<decltype(m_mutex)> lock(m_mutex);
+
+	const size_t count = m_entries.size();
+
+	m_entryWritten.wait(lock, [this, count]() {
+		return !m_writer.joinable() || m_nextToWrite >= count;
+	});
+}
+
+std::vector<std::string> StreamElementsParallelZipWriter::GetFailedEntries()
+{
+	std::lock_guard<decltype(m_mutex)> guard(m_mutex);
+
+	return m_failedEntries;
+}
+
+StreamElementsParallelZipWriter::Stats
+StreamElementsParallelZipWriter::GetStats()
+{
+	std::lock_guard<decltype(m_mutex)> guard(m_mutex);
+
+	return m_stats;
+}
+
+void StreamElementsParallelZipWriter::SetProgressCallback(
+	progress_callback_t callback)
+{
+	std::lock_guard<decltype(m_mutex)> guard(m_mutex);
+
+	m_progressCallback = callback;
+}
+
+size_t StreamElementsParallelZipWriter::EstimateEntryBytes(Entry &entry)
+{
+	std::error_code ec;
+	const uintmax_t size = std::filesystem::file_size(
+		std::filesystem::u8path(entry.localPath), ec);
+
+	if (ec || size > m_options.maxInMemoryEntryBytes)
+		return 0; // streamed in bounded chunks
+
+	return (size_t)size;
+}
+
+/* ================================================================= */
+
+void StreamElementsParallelZipWriter::WorkerThreadProc()
+{
+	for (;;) {
+		std::unique_lock<decltype(m_mutex)> lock(m_mutex);
+
+		// Buffers arrive already prepared and already counted in
+		// m_inFlightBytes; only file entries need a budget check. The
+		// entry the writer is waiting on is always claimable, whatever
+		// the budget, or queued buffers could starve it.
+		m_workAvailable.wait(lock, [this]() {
+			if (m_nextToClaim >= m_entries.size())
+				return m_closing;
+
+			const Entry &next = m_entries[m_nextToClaim];
+
+			return next.isBuffer || m_nextToClaim == m_nextToWrite ||
+			       m_inFlightBytes + next.reservedBytes <=
+				       m_options.maxInFlightBytes;
+		});
+
+		if (m_nextToClaim >= m_entries.size())
+			return;
+
+		Entry &entry = m_entries[m_nextToClaim++];
+
+		entry.claimed = true;
+
+		if (!entry.isBuffer)
+			m_inFlightBytes += entry.reservedBytes;
+
+		lock.unlock();
+
+		PrepareEntry(entry);
+
+		lock.lock();
+
+		entry.ready = true;
+
+		m_entryReady.notify_all();
+
+		if (entry.mode == EntryMode::Stream) {
+			// The writer appends the chunks as they come.
+			lock.unlock();
+
+			ProduceStreamEntry(entry);
+		}
+	}
+}
+
+void StreamElementsParallelZipWriter::PrepareEntry(Entry &entry)
+{
+	const int level = m_options.level;
+
+	if (!entry.isBuffer) {
+		const auto path = std::filesystem::u8path(entry.localPath);
+
+		std::ifstream in(path, std::ios::binary);
+
+		if (!in) {
+			entry.mode = EntryMode::Failed;
+
+			return;
+		}
+
+		std::error_code ec;
+		const uintmax_t size = std::filesystem::file_size(path, ec);
+
+		if (ec) {
+			entry.mode = EntryMode::Failed;
+
+			return;
+		}
+
+		if (size > m_options.maxInMemoryEntryBytes) {
+			// Decide the level from a sample; the content is read
+			// by ProduceStreamEntry().
+			std::string sample(ENTROPY_SAMPLE_SIZE, '\0');
+			in.read(&sample[0], sample.size());
+			sample.resize((size_t)in.gcount());
+
+			entry.mode = EntryMode::Stream;
+			entry.streamLevel =
+				IsIncompressible(entry.localPath,
+						 (const unsigned char *)
+							 sample.data(),
+						 sample.size())
+					? 0
+					: level;
+
+			return;
+		}
+
+		entry.data.resize((size_t)size);
+
+		if (size)
+			in.read(&entry.data[0], entry.data.size());
+
+		if ((uintmax_t)in.gcount() != size) {
+			entry.data.clear();
+			entry.mode = EntryMode::Failed;
+
+			return;
+		}
+	}
+
+	entry.uncompressedSize = entry.data.size();
+
+	const unsigned char *data = (const unsigned char *)entry.data.data();
+
+	// miniz stores anything this small regardless of level.
+	if (!level || entry.data.size() <= 3 ||
+	    IsIncompressible(entry.isBuffer ? entry.zipPath : entry.localPath,
+			     data,
+			     std::min(entry.data.size(), ENTROPY_SAMPLE_SIZE))) {
+		entry.mode = EntryMode::Stored;
+
+		return;
+	}
+
+	entry.uncompressedCrc32 = (uint32_t)mz_crc32(MZ_CRC32_INIT, data, entry.data.size());
+
+	size_t deflatedSize = 0;
+	void *deflated = tdefl_compress_mem_to_heap(
+		data, entry.data.size(), &deflatedSize,
+		(int)tdefl_create_comp_flags_from_zip_params(level, -15,
+							     MZ_DEFAULT_STRATEGY));
+
+	if (!deflated || deflatedSize >= entry.data.size()) {
+		// Did not shrink after all: storing is both smaller and
+		// cheaper to extract.
+		mz_free(deflated);
+
+		entry.mode = EntryMode::Stored;
+
+		return;
+	}
+
+	entry.data.assign((const char *)deflated, deflatedSize);
+	entry.mode = EntryMode::Deflated;
+
+	mz_free(deflated);
+}
+
+void StreamElementsParallelZipWriter::ProduceStreamEntry(Entry &entry)
+{
+	std::ifstream in(std::filesystem::u8path(entry.localPath),
+			 std::ios::binary);
+
+	bool success = !!in;
+
+	std::unique_ptr<tdefl_compressor> compressor;
+	std::string output;
+
+	if (success && entry.streamLevel) {
+		compressor.reset(new tdefl_compressor);
+
+		success = TDEFL_STATUS_OKAY ==
+			  tdefl_init(compressor.get(), AppendToString, &output,
+				     (int)tdefl_create_comp_flags_from_zip_params(
+					     entry.streamLevel, -15,
+					     MZ_DEFAULT_STRATEGY));
+	}
+
+	uint32_t crc = MZ_CRC32_INIT;
+	uint64_t size = 0;
+
+	std::vector<char> buf(STREAM_CHUNK_SIZE);
+
+	while (success) {
+		in.read(buf.data(), buf.size());
+
+		const size_t read = (size_t)in.gcount();
+
+		if (in.bad()) {
+			success = false;
+
+			break;
+		}
+
+		const bool last = read < buf.size();
+
+		crc = (uint32_t)mz_crc32(crc, (const unsigned char *)buf.data(),
+				       read);
+		size += read;
+
+		output.clear();
+
+		if (compressor) {
+			const tdefl_status status = tdefl_compress_buffer(
+				compressor.get(), buf.data(), read,
+				last ? TDEFL_FINISH : TDEFL_NO_FLUSH);
+
+			if (status != TDEFL_STATUS_OKAY &&
+			    status != TDEFL_STATUS_DONE) {
+				success = false;
+
+				break;
+			}
+		} else {
+			output.assign(buf.data(), read);
+		}
+
+		if (!output.empty()) {
+			std::unique_lock<decltype(m_mutex)> lock(m_mutex);
+
+			m_streamChanged.wait(lock, [&entry]() {
+				return entry.chunks.size() <
+				       MAX_QUEUED_STREAM_CHUNKS;
+			});
+
+			entry.compressedSize += output.size();
+			entry.chunks.push_back(std::move(output));
+			output = std::string();
+
+			m_streamChanged.notify_all();
+		}
+
+		if (last)
+			break;
+	}
+
+	std::lock_guard<decltype(m_mutex)> guard(m_mutex);
+
+	entry.uncompressedSize = size;
+	entry.uncompressedCrc32 = crc;
+	entry.streamFailed = !success;
+	entry.streamDone = true;
+
+	m_streamChanged.notify_all();
+}
+
+/* ================================================================= */
+
+void StreamElementsParallelZipWriter::WriterThreadProc()
+{
+	for (;;) {
+		std::unique_lock<decltype(m_mutex)> lock(m_mutex);
+
+		m_entryReady.wait(lock, [this]() {
+			if (m_nextToWrite >= m_entries.size())
+				return m_closing;
+
+			return m_entries[m_nextToWrite].ready;
+		});
+
+		if (m_nextToWrite >= m_entries.size())
+			return;
+
+		Entry &entry = m_entries[m_nextToWrite];
+
+		// Only ever touched from this thread once set.
+		const bool writeFailed = m_writeFailed;
+
+		lock.unlock();
+
+		bool success = false;
+
+		if (!writeFailed)
+			success = WriteEntry(entry);
+		else if (entry.mode == EntryMode::Stream)
+			StreamEntry(entry, true);
+
+		lock.lock();
+
+		if (success) {
+			++m_stats.entriesWritten;
+
+			if (entry.mode == EntryMode::Stored ||
+			    (entry.mode == EntryMode::Stream &&
+			     !entry.streamLevel))
+				++m_stats.entriesStored;
+
+			m_stats.bytesIn += entry.uncompressedSize;
+
+			if (entry.mode == EntryMode::Deflated)
+				m_stats.bytesOut += entry.data.size();
+			else if (entry.mode == EntryMode::Stream)
+				m_stats.bytesOut += entry.compressedSize;
+			else
+				m_stats.bytesOut += entry.uncompressedSize;
+		} else {
+			++m_stats.entriesFailed;
+
+			m_failedEntries.push_back(entry.zipPath);
+
+			// A failed read leaves the archive consistent; a
+			// failed archive write does not.
+			if (entry.mode != EntryMode::Failed)
+				m_writeFailed = true;
+		}
+
+		m_stats.elapsedSeconds =
+			std::chrono::duration<double>(
+				std::chrono::steady_clock::now() - m_startTime)
+				.count();
+
+		m_inFlightBytes -= entry.reservedBytes;
+		entry.reservedBytes = 0;
+
+		std::string().swap(entry.data);
+
+		++m_nextToWrite;
+
+		m_workAvailable.notify_all();
+		m_entryWritten.notify_all();
+
+		Stats stats = m_stats;
+		progress_callback_t callback = m_progressCallback;
+
+		lock.unlock();
+
+		if (callback)
+			callback(stats);
+	}
+}
+
+bool StreamElementsParallelZipWriter::WriteEntry(Entry &entry)
+{
+	switch (entry.mode) {
+	case EntryMode::Deflated:
+		return 0 == zip_entry_write_deflated(
+				    m_zip, entry.zipPath.c_str(),
+				    entry.data.data(), entry.data.size(),
+				    entry.uncompressedSize, entry.uncompressedCrc32);
+
+	case EntryMode::Stored: {
+		zip_set_level(m_zip, 0);
+
+		bool success = false;
+
+		if (0 == zip_entry_open(m_zip, entry.zipPath.c_str())) {
+			success = 0 == zip_entry_write(m_zip, entry.data.data(),
+						       entry.data.size());
+
+			if (0 != zip_entry_close(m_zip))
+				success = false;
+		}
+
+		zip_set_level(m_zip, m_options.level);
+
+		return success;
+	}
+
+	case EntryMode::Stream:
+		return StreamEntry(entry);
+
+	case EntryMode::Failed:
+	default:
+		return false;
+	}
+}
+
+bool StreamElementsParallelZipWriter::StreamEntry(Entry &entry, bool discard)
+{
+	bool opened = false;
+	bool success = !discard;
+	bool readFailed = false;
+
+	// Drain every chunk, even after a failure, or the worker producing
+	// them would wait forever.
+	for (;;) {
+		std::string chunk;
+		bool done = false;
+
+		{
+			std::unique_lock<decltype(m_mutex)> lock(m_mutex);
+
+			m_streamChanged.wait(lock, [&entry]() {
+				return !entry.chunks.empty() || entry.streamDone;
+			});
+
+			if (entry.chunks.empty()) {
+				readFailed = entry.streamFailed;
+				done = true;
+			} else {
+				chunk = std::move(entry.chunks.front());
+				entry.chunks.pop_front();
+
+				m_streamChanged.notify_all();
+			}
+		}
+
+		if (readFailed && !opened) {
+			// Nothing reached the archive: a plain read failure.
+			entry.mode = EntryMode::Failed;
+
+			return false;
+		}
+
+		// Opened on the first chunk, so a file which cannot be read
+		// leaves no trace in the archive.
+		if (success && !opened) {
+			zip_set_level(m_zip, 0);
+
+			opened = 0 == zip_entry_open(m_zip, entry.zipPath.c_str());
+			success = opened;
+		}
+
+		if (done) {
+			if (readFailed)
+				success = false;
+
+			break;
+		}
+
+		if (success &&
+		    0 != zip_entry_write_raw(m_zip, chunk.data(), chunk.size()))
+			success = false;
+	}
+
+	if (opened &&
+	    0 != zip_entry_close_raw(m_zip, entry.streamLevel ? 1 : 0,
+				     entry.uncompressedSize,
+				     entry.uncompressedCrc32))
+		success = false;
+
+	zip_set_level(m_zip, m_options.level);
+
+	return success;
+}
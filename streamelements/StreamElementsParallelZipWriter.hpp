@@ -0,0 +1,177 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
+#include <cstdint>
+
+struct zip_t;
+
+//
+// Writes a zip archive, compressing entries in parallel.
+//
+// zip_entry_write() deflates on the calling thread, one entry after another,
+// so packaging a few gigabytes pins one core for minutes. Here entries are
+// queued with AddFile()/AddBuffer() and prepared by a bounded pool of workers
+// -- read, checked for compressibility and deflated into memory -- while a
+// single writer thread appends them to the archive in the order they were
+// queued. The archive layout is therefore deterministic and identical to what
+// a sequential writer would produce, entry for entry.
+//
+// Entries that are already compressed -- by extension (mp4, png, webm, ...) or
+// because a sample of their content has near-maximal entropy -- are stored
+// rather than deflated a second time. Files too large to hold in memory are
+// read and deflated by a worker in chunks, which the writer appends as they
+// arrive, so the writer only ever copies bytes.
+//
+// Memory is bounded by Options::maxInFlightBytes: a worker does not claim the
+// next entry while prepared-but-unwritten data exceeds it. Entries are claimed
+// in queue order and written in queue order, so the writer always drains what
+// the workers are waiting on.
+//
+// Output is a plain zip readable by zip_open(..., 'r').
+//
+class StreamElementsParallelZipWriter {
+public:
+	struct Options {
+		// 0-9, zlib-style.
+		int level = 6;
+
+		// 0 picks a default based on hardware concurrency.
+		size_t workerCount = 0;
+
+		size_t maxInFlightBytes = 256 * 1024 * 1024;
+
+		// Files larger than this are prepared in chunks rather than
+		// whole.
+		size_t maxInMemoryEntryBytes = 64 * 1024 * 1024;
+	};
+
+	struct Stats {
+		size_t entriesQueued = 0;
+		size_t entriesWritten = 0;
+		size_t entriesStored = 0;
+		size_t entriesFailed = 0;
+
+		uint64_t bytesIn = 0;
+		uint64_t bytesOut = 0;
+
+		double elapsedSeconds = 0.0;
+
+		double GetBytesPerSecond() const
+		{
+			return elapsedSeconds > 0.0 ? (double)bytesIn /
+							      elapsedSeconds
+						    : 0.0;
+		}
+	};
+
+	// Invoked on the writer thread after every entry.
+	typedef std::function<void(const Stats &stats)> progress_callback_t;
+
+public:
+	StreamElementsParallelZipWriter(Options options);
+	~StreamElementsParallelZipWriter();
+
+	bool Open(const std::string &path);
+
+	// Queues an entry. Failures -- an unreadable file, a failed archive
+	// write -- surface in GetFailedEntries(), Stats::entriesFailed and
+	// Close()'s result; the failed entry is omitted and the rest of the
+	// archive is unaffected.
+	void AddFile(const std::string &localPath, const std::string &zipPath);
+	void AddBuffer(std::string content, const std::string &zipPath);
+
+	// Waits until every entry queued so far is written or has failed.
+	void Flush();
+
+	// Archive paths of the entries which failed so far, in queue order.
+	std::vector<std::string> GetFailedEntries();
+
+	// Waits for every queued entry, finalizes the archive and stops the
+	// threads. Returns false if the archive could not be finalized or any
+	// entry failed.
+	bool Close();
+
+	Stats GetStats();
+
+	void SetProgressCallback(progress_callback_t callback);
+
+	// True when the content of `path` is unlikely to shrink under deflate.
+	// `sample` is a prefix of the content.
+	static bool IsIncompressible(const std::string &path,
+				     const unsigned char *sample,
+				     size_t sampleSize);
+
+private:
+	enum class EntryMode { Deflated, Stored, Stream, Failed };
+
+	struct Entry {
+		std::string localPath;
+		std::string zipPath;
+
+		bool isBuffer = false;
+		bool claimed = false;
+		bool ready = false;
+
+		EntryMode mode = EntryMode::Failed;
+		int streamLevel = 0;
+
+		std::string data;
+
+		// EntryMode::Stream: filled by a worker while the writer
+		// drains it.
+		std::deque<std::string> chunks;
+		bool streamDone = false;
+		bool streamFailed = false;
+		uint64_t compressedSize = 0;
+
+		uint64_t uncompressedSize = 0;
+		uint32_t uncompressedCrc32 = 0;
+
+		size_t reservedBytes = 0;
+	};
+
+	void WorkerThreadProc();
+	void WriterThreadProc();
+
+	void PrepareEntry(Entry &entry);
+	void ProduceStreamEntry(Entry &entry);
+	bool WriteEntry(Entry &entry);
+	// With `discard`, only takes the chunks off the worker.
+	bool StreamEntry(Entry &entry, bool discard = false);
+
+	size_t EstimateEntryBytes(Entry &entry);
+
+private:
+	Options m_options;
+
+	zip_t *m_zip = nullptr;
+
+	std::mutex m_mutex;
+	std::condition_variable m_workAvailable;
+	std::condition_variable m_entryReady;
+	std::condition_variable m_entryWritten;
+	std::condition_variable m_streamChanged;
+
+	std::deque<Entry> m_entries;
+	size_t m_nextToClaim = 0;
+	size_t m_nextToWrite = 0;
+	size_t m_inFlightBytes = 0;
+	bool m_closing = false;
+	bool m_writeFailed = false;
+
+	std::vector<std::thread> m_workers;
+	std::thread m_writer;
+
+	Stats m_stats;
+	std::vector<std::string> m_failedEntries;
+	progress_callback_t m_progressCallback;
+
+	std::chrono::steady_clock::time_point m_startTime;
+};
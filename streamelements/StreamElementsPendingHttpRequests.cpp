@@ -0,0 +1,94 @@
+#include "StreamElementsPendingHttpRequests.hpp"
+
+StreamElementsPendingHttpRequests::StreamElementsPendingHttpRequests() {}
+
+StreamElementsPendingHttpRequests::~StreamElementsPendingHttpRequests() {}
+
+void StreamElementsPendingHttpRequests::SetOptions(Options options)
+{
+	std::lock_guard<decltype(m_mutex)> guard(m_mutex);
+
+	m_options = options;
+}
+
+StreamElementsPendingHttpRequests::Options
+StreamElementsPendingHttpRequests::GetOptions()
+{
+	std::lock_guard<decltype(m_mutex)> guard(m_mutex);
+
+	return m_options;
+}
+
+bool StreamElementsPendingHttpRequests::Begin(std::string id)
+{
+	std::lock_guard<decltype(m_mutex)> guard(m_mutex);
+
+	if (m_requests.size() >= m_options.maxWaitingRequests)
+		return false;
+
+	if (m_requests.count(id))
+		return false;
+
+	m_requests[id] = std::make_shared<Request>();
+
+	return true;
+}
+
+void StreamElementsPendingHttpRequests::Wait(std::string id,
+					     HttpServer::response_t &response)
+{
+	std::unique_lock<decltype(m_mutex)> lock(m_mutex);
+
+	if (!m_requests.count(id))
+		return;
+
+	std::shared_ptr<Request> request = m_requests[id];
+
+	request->cv.wait_for(lock, m_options.timeout,
+			     [&]() { return request->completed; });
+
+	m_requests.erase(id);
+
+	if (!request->completed) {
+		// Nobody handled the request
+		response.status = 404;
+		response.reason = "Request Not Handled";
+
+		return;
+	}
+
+	auto &answer = request->response;
+
+	response.status = answer.status;
+	response.reason = answer.reason;
+	response.body = answer.body;
+
+	// Headers the server set already (CORS) stay.
+	for (auto &header : answer.headers)
+		response.headers.emplace(header);
+}
+
+bool StreamElementsPendingHttpRequests::Complete(std::string id,
+						 response_writer_t writer)
+{
+	std::lock_guard<decltype(m_mutex)> guard(m_mutex);
+
+	auto it = m_requests.find(id);
+
+	if (it == m_requests.end() || it->second->completed)
+		return false;
+
+	writer(it->second->response);
+
+	it->second->completed = true;
+	it->second->cv.notify_all();
+
+	return true;
+}
+
+size_t StreamElementsPendingHttpRequests::GetWaitingCount()
+{
+	std::lock_guard<decltype(m_mutex)> guard(m_mutex);
+
+	return m_requests.size();
+}
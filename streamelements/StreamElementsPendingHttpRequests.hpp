@@ -0,0 +1,75 @@
+#pragma once
+
+#include "deps/server/HttpServer.hpp"
+
+#include <string>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <functional>
+#include <condition_variable>
+
+//
+// HTTP requests forwarded to a browser, waiting for the browser to answer.
+//
+// The message bus HTTP bridge hands every request it receives to a browser as
+// a hostMessageReceived event and answers it with whatever the browser later
+// passes to DeserializeHttpRequestResponse(), from a different thread.
+//
+// httplib has no asynchronous response path: the handler has to fill the
+// response before it returns. So the HTTP worker blocks in Wait() until the
+// answer arrives -- woken by Complete() the moment it does, not by polling --
+// or the timeout passes. The number of requests allowed to wait at once is
+// capped, so a browser which stops answering cannot tie up the server's
+// threads: past the cap, requests are refused immediately.
+//
+// The browser's answer is written to a response owned by the waiting request,
+// and copied to httplib's response by the HTTP worker itself: a late answer
+// racing a timeout never touches a response httplib is already sending.
+//
+class StreamElementsPendingHttpRequests {
+public:
+	struct Options {
+		std::chrono::milliseconds timeout = std::chrono::seconds(15);
+		size_t maxWaitingRequests = 16;
+	};
+
+	typedef std::function<void(HttpServer::response_t &response)>
+		response_writer_t;
+
+public:
+	StreamElementsPendingHttpRequests();
+	~StreamElementsPendingHttpRequests();
+
+	void SetOptions(Options options);
+	Options GetOptions();
+
+	// Registers request `id` before it is forwarded. Returns false,
+	// registering nothing, when the cap on waiting requests is reached.
+	bool Begin(std::string id);
+
+	// Blocks until request `id` is completed or times out, then fills
+	// `response` and forgets the request. A timed out request is answered
+	// with 404, as nobody handled it.
+	void Wait(std::string id, HttpServer::response_t &response);
+
+	// Answers request `id` through `writer`, which is called with the
+	// lock held. Returns false when no such request is waiting, e.g.
+	// because it already timed out or was answered.
+	bool Complete(std::string id, response_writer_t writer);
+
+	size_t GetWaitingCount();
+
+private:
+	struct Request {
+		bool completed = false;
+		HttpServer::response_t response;
+		std::condition_variable cv;
+	};
+
+private:
+	std::mutex m_mutex;
+	Options m_options;
+	std::map<std::string, std::shared_ptr<Request>> m_requests;
+};
@@ -0,0 +1,276 @@
+#include "StreamElementsRefTracker.hpp"
+#include "StreamElementsUtilsBase.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <tuple>
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <execinfo.h>
+#define SE_REF_TRACKER_BACKTRACE 1
+#endif
+
+template<typename T>
+static void Increment(std::vector<std::pair<const T *, long>> &counts,
+		      const T *key)
+{
+	// A pointer is referenced from a handful of sites; a linear scan beats
+	// a map at that size.
+	for (auto &count : counts) {
+		if (count.first == key) {
+			++count.second;
+			return;
+		}
+	}
+
+	counts.emplace_back(key, 1);
+}
+
+/* ================================================================= */
+
+StreamElementsRefTracker::StreamElementsRefTracker(Options options)
+	: m_options(options)
+{
+	m_options.frameCount =
+		std::max(0, std::min(m_options.frameCount, (int)MAX_FRAMES));
+	m_options.skipFrames = std::max(0, m_options.skipFrames);
+
+	const size_t count =
+		RoundUpToPowerOfTwo(std::max<size_t>(options.stripeCount, 1));
+
+	m_stripes.reset(new Stripe[count]);
+	m_siteStripes.reset(new SiteStripe[count]);
+	m_mask = count - 1;
+}
+
+StreamElementsRefTracker::~StreamElementsRefTracker() {}
+
+bool StreamElementsRefTracker::IsStackCaptureSupported()
+{
+#ifdef SE_REF_TRACKER_BACKTRACE
+	return true;
+#else
+	return false;
+#endif
+}
+
+uint64_t StreamElementsRefTracker::Hash(const void *data, size_t size,
+					uint64_t seed)
+{
+	// FNV-1a
+	uint64_t hash = seed ^ 14695981039346656037ull;
+
+	const uint8_t *bytes = (const uint8_t *)data;
+
+	for (size_t i = 0; i < size; ++i) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+
+	return hash;
+}
+
+const StreamElementsRefTracker::Site *
+StreamElementsRefTracker::InternSite(const char *file, int line,
+				     const char *statement)
+{
+	Site site;
+	site.file = file;
+	site.line = line;
+	site.statement = statement;
+	site.frameCount = 0;
+
+#ifdef SE_REF_TRACKER_BACKTRACE
+	if (m_options.frameCount) {
+		// This frame, AddRef()/DecRef(), and whatever the caller asked
+		// to skip.
+		const int skip = 2 + m_options.skipFrames;
+
+		void *frames[MAX_FRAMES * 2];
+		const int wanted =
+			std::min(m_options.frameCount + skip, MAX_FRAMES * 2);
+
+		const int captured = backtrace(frames, wanted);
+
+		if (captured > skip) {
+			site.frameCount = captured - skip;
+			memcpy(site.frames, frames + skip,
+			       site.frameCount * sizeof(void *));
+		}
+	}
+#endif
+
+	// String literals: their addresses identify them.
+	uint64_t hash = Hash(&site.file, sizeof(site.file), 0);
+	hash = Hash(&site.line, sizeof(site.line), hash);
+	hash = Hash(&site.statement, sizeof(site.statement), hash);
+	hash = Hash(site.frames, site.frameCount * sizeof(void *), hash);
+
+	SiteStripe &stripe = m_siteStripes[(hash >> 32) & m_mask];
+
+	std::lock_guard<std::mutex> guard(stripe.mutex);
+
+	auto range = stripe.sites.equal_range(hash);
+
+	for (auto it = range.first; it != range.second; ++it) {
+		const Site &existing = *it->second;
+
+		if (existing.file == site.file && existing.line == site.line &&
+		    existing.statement == site.statement &&
+		    existing.frameCount == site.frameCount &&
+		    0 == memcmp(existing.frames, site.frames,
+				site.frameCount * sizeof(void *)))
+			return &existing;
+	}
+
+	auto result = stripe.sites.emplace(hash, std::make_unique<Site>(site));
+
+	return result->second.get();
+}
+
+void StreamElementsRefTracker::AddRef(const char *file, int line,
+				      const char *statement, const void *ptr)
+{
+	const Site *site = InternSite(file, line, statement);
+
+	Stripe &stripe = m_stripes[Hash(&ptr, sizeof(ptr), 0) & m_mask];
+
+	std::lock_guard<std::mutex> guard(stripe.mutex);
+
+	Entry &entry = stripe.entries[ptr];
+
+	++entry.balance;
+	Increment(entry.addRefs, site);
+}
+
+bool StreamElementsRefTracker::DecRef(const char *file, int line,
+				      const char *statement, const void *ptr)
+{
+	const Site *site = InternSite(file, line, statement);
+
+	Stripe &stripe = m_stripes[Hash(&ptr, sizeof(ptr), 0) & m_mask];
+
+	std::lock_guard<std::mutex> guard(stripe.mutex);
+
+	auto it = stripe.entries.find(ptr);
+
+	if (it == stripe.entries.end())
+		return false;
+
+	Entry &entry = it->second;
+
+	--entry.balance;
+	Increment(entry.decRefs, site);
+
+	// Balanced: nothing left to report, and the address may be reused.
+	if (!entry.balance)
+		stripe.entries.erase(it);
+
+	return true;
+}
+
+size_t StreamElementsRefTracker::GetTrackedCount() const
+{
+	size_t result = 0;
+
+	for (size_t i = 0; i <= m_mask; ++i) {
+		std::lock_guard<std::mutex> guard(m_stripes[i].mutex);
+
+		result += m_stripes[i].entries.size();
+	}
+
+	return result;
+}
+
+std::vector<StreamElementsRefTracker::LeakSite>
+StreamElementsRefTracker::GetLeaks() const
+{
+	// Sites are compared by content: the same file:line can come from
+	// different copies of the same literal.
+	typedef std::tuple<std::string, int, std::string,
+			   std::vector<void *>>
+		key_t;
+
+	std::map<key_t, LeakSite> groups;
+
+	for (size_t i = 0; i <= m_mask; ++i) {
+		std::lock_guard<std::mutex> guard(m_stripes[i].mutex);
+
+		for (auto &kv : m_stripes[i].entries) {
+			for (auto &count : kv.second.addRefs) {
+				const Site *site = count.first;
+
+				key_t key(GetFileName(site->file), site->line,
+					  site->statement,
+					  std::vector<void *>(
+						  site->frames,
+						  site->frames +
+							  site->frameCount));
+
+				LeakSite &group = groups[key];
+
+				if (!group.pointers) {
+					group.file = std::get<0>(key);
+					group.line = site->line;
+					group.statement = site->statement;
+				}
+
+				++group.pointers;
+				group.references += count.second;
+			}
+		}
+	}
+
+	std::vector<LeakSite> result;
+	result.reserve(groups.size());
+
+	for (auto &kv : groups) {
+		LeakSite site = kv.second;
+
+#ifdef SE_REF_TRACKER_BACKTRACE
+		const std::vector<void *> &frames = std::get<3>(kv.first);
+
+		if (frames.size()) {
+			char **symbols = backtrace_symbols(frames.data(),
+							   (int)frames.size());
+
+			for (size_t i = 0; symbols && i < frames.size(); ++i)
+				site.stack.push_back(symbols[i]);
+
+			free(symbols);
+		}
+#endif
+
+		result.push_back(std::move(site));
+	}
+
+	std::stable_sort(result.begin(), result.end(),
+			 [](const LeakSite &a, const LeakSite &b) {
+				 return a.pointers > b.pointers;
+			 });
+
+	return result;
+}
+
+std::string StreamElementsRefTracker::FormatLeakReport() const
+{
+	const auto leaks = GetLeaks();
+
+	std::string result = std::to_string(GetTrackedCount()) +
+			     " pointers with outstanding references, from " +
+			     std::to_string(leaks.size()) + " call sites\n";
+
+	for (auto &leak : leaks) {
+		result += "  " + std::to_string(leak.pointers) + " pointers, " +
+			  std::to_string(leak.references) + " references: " +
+			  leak.file + ":" + std::to_string(leak.line) + " " +
+			  leak.statement + "\n";
+
+		for (auto &frame : leak.stack)
+			result += "      " + frame + "\n";
+	}
+
+	return result;
+}
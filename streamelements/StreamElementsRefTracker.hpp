@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//
+// Per-pointer reference tracking for SETrace's detailed mode.
+//
+// Every AddRef() and DecRef() is recorded against the pointer and against
+// its call site: the file, line and statement, plus the caller's stack where
+// backtrace() is available. A pointer whose references balance out is
+// forgotten. GetLeaks() groups the pointers that are still referenced by the
+// call sites that took those references, so a leak shows up as one line per
+// site rather than one per object.
+//
+// Pointers and call sites are spread over lock stripes by hash, so threads
+// touching different objects rarely wait on each other. Stacks are only
+// symbolized when a report is built.
+//
+class StreamElementsRefTracker {
+public:
+	static const int MAX_FRAMES = 24;
+
+	struct Options {
+		// Rounded up to a power of two.
+		size_t stripeCount = 64;
+
+		// Frames to capture per call site, and innermost frames to
+		// drop: the tracker's own, and whatever wrapper calls it.
+		int frameCount = 16;
+		int skipFrames = 0;
+	};
+
+	struct LeakSite {
+		std::string file;
+		int line = 0;
+		std::string statement;
+
+		// Symbolized, innermost first. Empty where stacks are not
+		// captured.
+		std::vector<std::string> stack;
+
+		// Objects still referenced from this site, and how many
+		// references they hold.
+		size_t pointers = 0;
+		long references = 0;
+	};
+
+public:
+	StreamElementsRefTracker(Options options);
+	~StreamElementsRefTracker();
+
+	void AddRef(const char *file, int line, const char *statement,
+		    const void *ptr);
+
+	// False for a pointer that holds no references.
+	bool DecRef(const char *file, int line, const char *statement,
+		    const void *ptr);
+
+	// Pointers that still hold references.
+	size_t GetTrackedCount() const;
+
+	// Sorted by number of pointers, most first.
+	std::vector<LeakSite> GetLeaks() const;
+
+	std::string FormatLeakReport() const;
+
+	static bool IsStackCaptureSupported();
+
+private:
+	struct Site {
+		const char *file;
+		int line;
+		const char *statement;
+
+		int frameCount;
+		void *frames[MAX_FRAMES];
+	};
+
+	struct Entry {
+		long balance = 0;
+
+		// Count per call site.
+		std::vector<std::pair<const Site *, long>> addRefs;
+		std::vector<std::pair<const Site *, long>> decRefs;
+	};
+
+	struct alignas(64) Stripe {
+		std::mutex mutex;
+		std::unordered_map<const void *, Entry> entries;
+	};
+
+	struct alignas(64) SiteStripe {
+		std::mutex mutex;
+		std::unordered_multimap<uint64_t, std::unique_ptr<Site>> sites;
+	};
+
+	const Site *InternSite(const char *file, int line,
+			       const char *statement);
+
+	static uint64_t Hash(const void *data, size_t size, uint64_t seed);
+
+private:
+	Options m_options;
+
+	std::unique_ptr<Stripe[]> m_stripes;
+	std::unique_ptr<SiteStripe[]> m_siteStripes;
+	size_t m_mask = 0;
+};
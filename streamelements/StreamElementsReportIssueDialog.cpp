@@ -3,7 +3,8 @@
 #include "StreamElementsUtils.hpp"
 #include "StreamElementsGlobalStateManager.hpp"
 #include "StreamElementsNetworkDialog.hpp"
-#include "StreamElementsSecretRedactor.hpp"
+#include "StreamElementsDiagnosticsArchive.hpp"
+#include "StreamElementsLogRing.hpp"
 #include "StreamElementsConfig.hpp"
 #include "Version.hpp"
 #include "ui_StreamElementsReportIssueDialog.h"
@@ -227,27 +228,36 @@ void StreamElementsReportIssueDialog::accept()
 
 		std::wstring obsDataPath = QString(programDataPathBuf).toStdWString();
 
-		zip_t* zip = zip_open(tempBufPath.c_str(), 9, 'w');
+		// Same archive as the crash report builds, with the same
+		// limits: logs over the per-file limit are cut to their head
+		// and tail, and whatever the budget has no room for is listed
+		// in omitted-files.txt instead.
+		StreamElementsDiagnosticsArchive::Options archiveOptions;
 
-		auto addBufferToZip = [&](BYTE* buf, size_t bufLen, std::wstring zipPath)
-		{
-			zip_entry_open(zip, wstring_to_utf8(zipPath).c_str());
+		// Third-party plugin binaries, kept for the same reason as in
+		// StreamElementsCrashContext.cpp.
+		const uint64_t maxPluginFileBytes = 32ull * 1024 * 1024;
+
+		StreamElementsDiagnosticsArchive archive(archiveOptions);
 
-			zip_entry_write(zip, buf, bufLen);
+		archive.Open(tempBufPath);
 
-			zip_entry_close(zip);
+		auto addBufferToZip = [&](BYTE* buf, size_t bufLen, std::wstring zipPath)
+		{
+			archive.AddBuffer(std::string((const char *)buf, bufLen),
+					  wstring_to_utf8(zipPath));
 		};
 
 		auto addLinesBufferToZip = [&](std::vector<std::string>& lines, std::wstring zipPath)
 		{
-			zip_entry_open(zip, wstring_to_utf8(zipPath).c_str());
+			std::string buf;
 
-			for (auto line : lines) {
-				zip_entry_write(zip, line.c_str(), line.size());
-				zip_entry_write(zip, "\r\n", 2);
+			for (auto &line : lines) {
+				buf += line;
+				buf += "\r\n";
 			}
 
-			zip_entry_close(zip);
+			archive.AddBuffer(std::move(buf), wstring_to_utf8(zipPath));
 		};
 
 		auto addCefValueToZip = [&](CefRefPtr<CefValue>& input, std::wstring zipPath)
@@ -259,79 +269,7 @@ void StreamElementsReportIssueDialog::accept()
 						JSON_WRITER_PRETTY_PRINT)
 					.ToWString());
 
-			zip_entry_open(zip, wstring_to_utf8(zipPath).c_str());
-
-			zip_entry_write(zip, buf.c_str(), buf.size());
-
-			zip_entry_close(zip);
-		};
-
-		auto addFileToZip = [&](std::wstring localPath, std::wstring zipPath)
-		{
-#ifdef WIN32
-			int fd = _wsopen(
-				localPath.c_str(),
-				O_RDONLY | O_BINARY,
-				SH_DENYNO,
-				0 /*_S_IREAD | _S_IWRITE*/);
-#else
-			int fd = ::open(wstring_to_utf8(localPath).c_str(),
-					 O_RDONLY);
-#endif
-			if (-1 != fd) {
-				size_t BUF_LEN = 32768;
-
-				BYTE* buf = new BYTE[BUF_LEN];
-
-				zip_entry_open(zip, wstring_to_utf8(zipPath).c_str());
-
-				// service.json carries the stream key in
-				// plaintext, so it is buffered whole and
-				// sanitized rather than streamed straight
-				// through to the upload.
-				if (StreamElementsSecretRedactor::IsSensitivePath(
-					    zipPath)) {
-					std::string content;
-
-					int read = ::read(fd, buf, BUF_LEN);
-					while (read > 0) {
-						content.append(
-							(const char *)buf,
-							(size_t)read);
-
-						read = ::read(fd, buf, BUF_LEN);
-					}
-
-					const std::string sanitized =
-						StreamElementsSecretRedactor::
-							Redact(content);
-
-					zip_entry_write(zip, sanitized.c_str(),
-							sanitized.size());
-				} else {
-					int read = ::read(fd, buf, BUF_LEN);
-					while (read > 0) {
-						if (0 !=
-						    zip_entry_write(zip, buf,
-								    read)) {
-							break;
-						}
-
-						read = ::read(fd, buf, BUF_LEN);
-					}
-				}
-
-				zip_entry_close(zip);
-
-				delete[] buf;
-
-				::close(fd);
-			}
-			else {
-				blog(LOG_ERROR,
-					"obs-streamelements-core: report issue: failed opening file for reading: %s",
-					wstring_to_utf8(zipPath).c_str());
-			}
+			archive.AddBuffer(std::move(buf), wstring_to_utf8(zipPath));
 		};
 
 		auto addWindowCaptureToZip = [&](std::wstring zipPath)
@@ -364,12 +302,9 @@ void StreamElementsReportIssueDialog::accept()
 			buffer.open(QIODevice::WriteOnly);
 			pixmap.save(&buffer, "BMP");
 
-			zip_entry_open(zip, wstring_to_utf8(zipPath).c_str());
-
-			zip_entry_write(zip, buffer.data().constData(),
-					buffer.size());
-
-			zip_entry_close(zip);
+			archive.AddBuffer(std::string(buffer.data().constData(),
+						      buffer.size()),
+					  wstring_to_utf8(zipPath));
 
 			return true;
 		};
@@ -383,6 +318,15 @@ void StreamElementsReportIssueDialog::accept()
 		// Add window capture
 		addWindowCaptureToZip(L"obs-main-window.bmp");
 
+		// Recent plugin activity, including lines not yet flushed to
+		// the log file.
+		{
+			std::string activity =
+				StreamElementsLogRing::GetInstance()->Format();
+
+			addBufferToZip((BYTE*)activity.c_str(), activity.size(), L"obs-streamelements-core-activity.txt");
+		}
+
 		std::map<std::wstring, std::wstring> local_to_zip_files_map;
 
 		if (collect_all) {
@@ -530,19 +474,92 @@ void StreamElementsReportIssueDialog::accept()
 
 		dialog.setMessage(obs_module_text("StreamElements.ReportIssue.Progress.Message.CollectingFiles"));
 
-		size_t count = 0;
-		size_t total = local_to_zip_files_map.size();
+		if (!dialog.cancelled()) {
+			std::vector<StreamElementsDiagnosticsArchive::Candidate>
+				candidates;
+
+			// OBS names its logs by start time, so the greatest name
+			// in logs/ is the current session.
+			const std::wstring logsPrefix = L"obs-studio/logs/";
+			const std::wstring pluginsPrefix = L"obs-studio/plugins/";
+			std::wstring newestLog;
+			size_t newestLogIndex = SIZE_MAX;
+
+			for (auto item : local_to_zip_files_map) {
+				StreamElementsDiagnosticsArchive::Candidate candidate;
+
+				std::error_code ec;
+				const uintmax_t size = std::filesystem::file_size(
+					std::filesystem::path(item.first), ec);
+
+				// Gone or unreadable: planning it as empty
+				// would let it into the archive unbounded.
+				if (ec)
+					continue;
+
+				candidate.localPath = wstring_to_utf8(item.first);
+				candidate.zipPath = wstring_to_utf8(item.second);
+				candidate.size = size;
+
+				// Zip paths mix separators on macOS.
+				std::wstring zip_path_lcase = item.second;
+				std::transform(zip_path_lcase.begin(), zip_path_lcase.end(), zip_path_lcase.begin(), [](wchar_t ch) {
+					return ch == L'\\' ? L'/' : (wchar_t)::towlower(ch);
+				});
+
+				if (zip_path_lcase.substr(0, pluginsPrefix.size()) ==
+				    pluginsPrefix) {
+					candidate.priority =
+						StreamElementsDiagnosticsArchive::
+							PRIORITY_LOW;
+					candidate.maxBytes = maxPluginFileBytes;
+				} else if (zip_path_lcase ==
+					   L"obs-studio/crashes/crash.log") {
+					candidate.priority =
+						StreamElementsDiagnosticsArchive::
+							PRIORITY_HIGH;
+				}
 
-		for (auto item : local_to_zip_files_map) {
-			if (dialog.cancelled()) {
-				break;
-			}
+				if (zip_path_lcase.substr(0, logsPrefix.size()) ==
+					    logsPrefix &&
+				    zip_path_lcase > newestLog) {
+					newestLog = zip_path_lcase;
+					newestLogIndex = candidates.size();
+				}
 
-			++count;
+				candidates.push_back(candidate);
+			}
 
-			addFileToZip(item.first, item.second);
+			if (newestLogIndex < candidates.size()) {
+				candidates[newestLogIndex].priority =
+					StreamElementsDiagnosticsArchive::PRIORITY_HIGH;
+			}
 
-			dialog.setProgress(0, (int)total, (int)count);
+			// Called on the archive's writer thread, as entries
+			// land in the archive.
+			archive.SetProgressCallback(
+				[&](const StreamElementsParallelZipWriter::Stats
+					    &stats) {
+					dialog.setProgress(
+						0, (int)stats.entriesQueued,
+						(int)stats.entriesWritten);
+				});
+
+			auto plan = archive.AddCandidates(
+				candidates, [&]() { return dialog.cancelled(); });
+
+			std::vector<std::string> manifest =
+				StreamElementsDiagnosticsArchive::DescribePlan(
+					plan, archiveOptions);
+
+			manifest.insert(
+				std::find(manifest.begin(), manifest.end(),
+					  std::string()),
+				"Per-file limit (plugins): " +
+					std::to_string(maxPluginFileBytes) +
+					" bytes");
+
+			addLinesBufferToZip(manifest, L"omitted-files.txt");
 		}
 
 		double cpu_benchmark = 0;
@@ -720,7 +737,18 @@ void StreamElementsReportIssueDialog::accept()
 			}
 		}
 
-		zip_close(zip);
+		archive.Close();
+
+		{
+			auto stats = archive.GetStats();
+
+			blog(LOG_INFO,
+			     "obs-streamelements-core: report issue: archived %zu entries (%llu bytes in, %llu bytes out) in %.2f seconds",
+			     stats.entriesWritten,
+			     (unsigned long long)stats.bytesIn,
+			     (unsigned long long)stats.bytesOut,
+			     stats.elapsedSeconds);
+		}
 
 		if (!dialog.cancelled()) {
 			StreamElementsGlobalStateManager::GetInstance()
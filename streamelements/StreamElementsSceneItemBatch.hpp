@@ -0,0 +1,162 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//
+// The scene items a batch of property changes is about, resolved and grouped
+// by scene.
+//
+// Applying a layout took one API call per item per property, and each call
+// looked its item up by walking every scene of the composition. A batch is
+// given all item ids first (Add()), then sees every item of the composition
+// once (Resolve()), and hands back the items grouped by the scene which
+// holds them, so that each scene can be changed in a single atomic update.
+//
+// Each requested id gets a status: ids which do not parse are invalid, ids
+// requested again are duplicates (the first request wins), and ids which
+// were not seen by Resolve() were not found.
+//
+template<typename TScene, typename TItem, typename TProps>
+class StreamElementsSceneItemBatch {
+public:
+	enum Status {
+		STATUS_OK,
+		STATUS_INVALID,
+		STATUS_DUPLICATE,
+		STATUS_NOT_FOUND
+	};
+
+	struct Entry {
+		std::string id;
+		TProps props;
+		Status status = STATUS_NOT_FOUND;
+
+		TItem *item = nullptr;
+		// The scene which holds `item`: its group's scene for items
+		// in groups
+		TScene *scene = nullptr;
+		// The scene `item` was found in
+		TScene *rootScene = nullptr;
+	};
+
+public:
+	StreamElementsSceneItemBatch() {}
+	~StreamElementsSceneItemBatch() {}
+
+	// Call for each requested item, in request order. `key` is what the id
+	// refers to, or nullptr if it is not a valid id.
+	void Add(const std::string &id, const void *key, const TProps &props)
+	{
+		Entry entry;
+		entry.id = id;
+		entry.props = props;
+
+		if (!key)
+			entry.status = STATUS_INVALID;
+		else if (m_pending.count(key) || m_resolved.count(key))
+			entry.status = STATUS_DUPLICATE;
+		else
+			m_pending[key] = m_entries.size();
+
+		m_entries.push_back(entry);
+	}
+
+	// Call for every item of every scene the requested items may be in.
+	// Returns true if `item` was requested: the caller should hold a
+	// reference to it until the batch has been applied.
+	bool Resolve(TItem *item, TScene *scene, TScene *rootScene)
+	{
+		auto it = m_pending.find(item);
+
+		if (it == m_pending.end())
+			return false;
+
+		Entry &entry = m_entries[it->second];
+		entry.status = STATUS_OK;
+		entry.item = item;
+		entry.scene = scene;
+		entry.rootScene = rootScene;
+
+		m_resolved[item] = it->second;
+		m_pending.erase(it);
+
+		return true;
+	}
+
+	// Whether every valid id has been resolved, and the scan can stop.
+	bool IsResolved() const { return m_pending.empty(); }
+
+	// In request order.
+	const std::vector<Entry> &GetEntries() const { return m_entries; }
+
+	// func: void(TScene *scene, const std::vector<const Entry *> &entries)
+	//
+	// Resolved entries, grouped by the scene which holds them, in order of
+	// first request; entries of each scene are in request order.
+	template<typename TFunc> void ForEachScene(TFunc &&func) const
+	{
+		std::vector<TScene *> scenes;
+		std::unordered_map<TScene *, std::vector<const Entry *>> entries;
+
+		for (auto &entry : m_entries) {
+			if (entry.status != STATUS_OK)
+				continue;
+
+			auto &sceneEntries = entries[entry.scene];
+
+			if (sceneEntries.empty())
+				scenes.push_back(entry.scene);
+
+			sceneEntries.push_back(&entry);
+		}
+
+		for (auto scene : scenes)
+			func(scene, entries[scene]);
+	}
+
+	// The scenes resolved entries were found in, in order of first
+	// request.
+	std::vector<TScene *> GetRootScenes() const
+	{
+		std::vector<TScene *> result;
+
+		for (auto &entry : m_entries) {
+			if (entry.status != STATUS_OK)
+				continue;
+
+			bool found = false;
+
+			for (auto scene : result)
+				found = found || scene == entry.rootScene;
+
+			if (!found)
+				result.push_back(entry.rootScene);
+		}
+
+		return result;
+	}
+
+	static const char *GetStatusName(Status status)
+	{
+		switch (status) {
+		case STATUS_OK:
+			return "ok";
+		case STATUS_INVALID:
+			return "invalid";
+		case STATUS_DUPLICATE:
+			return "duplicate";
+		default:
+			return "notFound";
+		}
+	}
+
+private:
+	std::vector<Entry> m_entries;
+
+	// Valid keys not resolved yet, and resolved keys, to their entry
+	std::unordered_map<const void *, size_t> m_pending;
+	std::unordered_map<const void *, size_t> m_resolved;
+};
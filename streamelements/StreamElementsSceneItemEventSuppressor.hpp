@@ -0,0 +1,115 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <unordered_map>
+
+//
+// Scene items and scenes whose change signals are not dispatched to
+// browsers one by one, because whoever changes them dispatches one
+// consolidated change instead.
+//
+// Signals raised while a batch of changes is applied are covered by
+// Suppress() and Resume() around it. libobs raises some signals later
+// though: transforms and crops are applied on the next video tick, which
+// raises "item_transform" then. ExpectSignal() covers one such signal for
+// an item; ConsumeExpectedSignal() returns true, once, if it arrives within
+// EXPECTED_SIGNAL_TIMEOUT_MS, so that an expectation which is never met
+// does not swallow a later change.
+//
+class StreamElementsSceneItemEventSuppressor {
+public:
+	typedef std::chrono::steady_clock clock_t;
+
+	static constexpr int EXPECTED_SIGNAL_TIMEOUT_MS = 1000;
+
+public:
+	StreamElementsSceneItemEventSuppressor() {}
+	~StreamElementsSceneItemEventSuppressor() {}
+
+	void Suppress(const void *key)
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+
+		++m_suppressed[key];
+	}
+
+	void Resume(const void *key)
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+
+		auto it = m_suppressed.find(key);
+
+		if (it == m_suppressed.end())
+			return;
+
+		if (--it->second == 0)
+			m_suppressed.erase(it);
+	}
+
+	bool IsSuppressed(const void *key) const
+	{
+		if (!key)
+			return false;
+
+		std::lock_guard<std::mutex> guard(m_mutex);
+
+		return m_suppressed.count(key) > 0;
+	}
+
+	void ExpectSignal(const void *key, clock_t::time_point now = clock_t::now())
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+
+		// Expectations which were never met
+		for (auto it = m_expected.begin(); it != m_expected.end();) {
+			if (IsExpired(it->second, now))
+				it = m_expected.erase(it);
+			else
+				++it;
+		}
+
+		m_expected[key] = now;
+	}
+
+	bool ConsumeExpectedSignal(const void *key,
+				   clock_t::time_point now = clock_t::now())
+	{
+		if (!key)
+			return false;
+
+		std::lock_guard<std::mutex> guard(m_mutex);
+
+		auto it = m_expected.find(key);
+
+		if (it == m_expected.end())
+			return false;
+
+		const bool expired = IsExpired(it->second, now);
+
+		m_expected.erase(it);
+
+		return !expired;
+	}
+
+	size_t GetExpectedSignalCount() const
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+
+		return m_expected.size();
+	}
+
+private:
+	static bool IsExpired(clock_t::time_point since, clock_t::time_point now)
+	{
+		return now - since >
+		       std::chrono::milliseconds(EXPECTED_SIGNAL_TIMEOUT_MS);
+	}
+
+private:
+	mutable std::mutex m_mutex;
+
+	std::unordered_map<const void *, size_t> m_suppressed;
+	std::unordered_map<const void *, clock_t::time_point> m_expected;
+};
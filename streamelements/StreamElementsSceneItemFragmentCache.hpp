@@ -0,0 +1,180 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+//
+// Cache of serialized scene item fragments, keyed by item.
+//
+// Every getSceneItems-style call, typically made in response to a
+// hostSceneItemListChanged event, serialized every item of the scene again:
+// transform, crop, bounds, source settings through obs_data JSON, private
+// settings and filters, although usually one or two items had changed.
+//
+// Fragments are dropped by the signals which announce a change: per item
+// (transform, visibility, lock, selection, private settings, add and remove)
+// or per source (rename, settings and filter updates), in which case every
+// item showing that source goes. InvalidateAll() covers changes which are not
+// announced per item, such as reorders.
+//
+// A fragment is stored together with a variant: whatever else the
+// serialization depended on, such as the scene and composition it was
+// serialized for. Get() only returns fragments of the same variant.
+//
+// Serializing takes time, and a signal may arrive meanwhile. Take
+// GetGeneration() before serializing and pass it to Put(): a fragment is
+// only stored if nothing was invalidated since.
+//
+template<typename TFragment, typename TVariant>
+class StreamElementsSceneItemFragmentCache {
+public:
+	struct Stats {
+		uint64_t hits = 0;
+		uint64_t misses = 0;
+		uint64_t invalidations = 0;
+	};
+
+public:
+	StreamElementsSceneItemFragmentCache() {}
+	~StreamElementsSceneItemFragmentCache() {}
+
+	bool Get(const void *item, const TVariant &variant, TFragment &result)
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+
+		auto it = m_entries.find(item);
+
+		if (it == m_entries.end() || !(it->second.variant == variant)) {
+			++m_stats.misses;
+
+			return false;
+		}
+
+		++m_stats.hits;
+
+		result = it->second.fragment;
+
+		return true;
+	}
+
+	uint64_t GetGeneration() const
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+
+		return m_generation;
+	}
+
+	void Put(const void *item, const void *source, const TVariant &variant,
+		 const TFragment &fragment, uint64_t generation)
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+
+		if (generation != m_generation)
+			return;
+
+		EraseInternal(item);
+
+		Entry &entry = m_entries[item];
+		entry.source = source;
+		entry.variant = variant;
+		entry.fragment = fragment;
+
+		if (source)
+			m_sourceItems[source].insert(item);
+	}
+
+	void InvalidateItem(const void *item)
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+
+		++m_generation;
+		++m_stats.invalidations;
+
+		EraseInternal(item);
+	}
+
+	// Every item showing `source`.
+	void InvalidateSource(const void *source)
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+
+		++m_generation;
+		++m_stats.invalidations;
+
+		auto it = m_sourceItems.find(source);
+
+		if (it == m_sourceItems.end())
+			return;
+
+		for (auto item : it->second)
+			m_entries.erase(item);
+
+		m_sourceItems.erase(it);
+	}
+
+	void InvalidateAll()
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+
+		++m_generation;
+		++m_stats.invalidations;
+
+		m_entries.clear();
+		m_sourceItems.clear();
+	}
+
+	size_t GetSize() const
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+
+		return m_entries.size();
+	}
+
+	Stats GetStats() const
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+
+		return m_stats;
+	}
+
+private:
+	struct Entry {
+		const void *source = nullptr;
+		TVariant variant;
+		TFragment fragment;
+	};
+
+	void EraseInternal(const void *item)
+	{
+		auto it = m_entries.find(item);
+
+		if (it == m_entries.end())
+			return;
+
+		auto items = m_sourceItems.find(it->second.source);
+
+		if (items != m_sourceItems.end()) {
+			items->second.erase(item);
+
+			if (items->second.empty())
+				m_sourceItems.erase(items);
+		}
+
+		m_entries.erase(it);
+	}
+
+private:
+	mutable std::mutex m_mutex;
+
+	std::unordered_map<const void *, Entry> m_entries;
+	std::unordered_map<const void *, std::unordered_set<const void *>>
+		m_sourceItems;
+
+	uint64_t m_generation = 0;
+
+	Stats m_stats;
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <unordered_map>
+
+//
+// What serializing any item of a scene looks up, computed once per
+// top-level serialization call rather than once per item.
+//
+// SerializeSourceAndSceneItem() used to resolve the item's composition,
+// fetch the frontend's current scene and call obs_sceneitem_get_group() for
+// every item it serialized. Each of these takes libobs locks, and
+// obs_sceneitem_get_group() takes the full scene lock while it walks the
+// scene; a scene list of N items repeated all of them N times.
+//
+// The context carries the scene being serialized, its composition, the
+// current scene and the group membership of the current scene's items: the
+// direct children of each of its top-level groups, which is exactly what
+// obs_sceneitem_get_group() on the current scene finds. Items in groups
+// nested deeper, and items of any other scene, have no group.
+//
+// The pointers are only compared, never dereferenced, so the context does
+// not hold references: build it and use it while the caller holds the root
+// scene.
+//
+template<typename TScene, typename TItem, typename TComposition>
+class StreamElementsSceneItemSerializationContext {
+public:
+	StreamElementsSceneItemSerializationContext(TScene *rootScene,
+						    TScene *currentScene,
+						    TComposition *composition)
+		: m_rootScene(rootScene),
+		  m_currentScene(currentScene),
+		  m_composition(composition)
+	{
+	}
+	~StreamElementsSceneItemSerializationContext() {}
+
+	TScene *GetRootScene() const { return m_rootScene; }
+	TScene *GetCurrentScene() const { return m_currentScene; }
+	TComposition *GetComposition() const { return m_composition; }
+
+	// Call while building the context, for each direct child of each
+	// top-level group of the current scene. As with
+	// obs_sceneitem_get_group(), the first group listed wins.
+	void AddGroupItem(TItem *group, TItem *item)
+	{
+		m_groups.emplace(item, group);
+	}
+
+	// The top-level group of the current scene which lists `item`, or
+	// nullptr.
+	TItem *GetGroup(TItem *item) const
+	{
+		auto it = m_groups.find(item);
+
+		if (it == m_groups.end())
+			return nullptr;
+
+		return it->second;
+	}
+
+	size_t GetGroupItemCount() const { return m_groups.size(); }
+
+private:
+	TScene *m_rootScene;
+	TScene *m_currentScene;
+	TComposition *m_composition;
+
+	std::unordered_map<TItem *, TItem *> m_groups;
+};
@@ -3,6 +3,7 @@
 #include "StreamElementsApiMessageHandler.hpp"
 #include "StreamElementsRemoteIconLoader.hpp"
 #include "StreamElementsConfig.hpp"
+#include "StreamElementsObsSceneManager.hpp"
 
 #include <obs.h>
 #include <obs.hpp>
@@ -93,20 +94,26 @@ static obs_sceneitem_t *FindSceneItemByIdAddRef(std::string id)
 	obs_scene_t *scene = obs_scene_from_source(
 		currentScene); // does not increment refcount
 
-	ObsSceneEnumAllItems(scene, [&](obs_sceneitem_t *sceneitem) {
-		if (context.searchPtr == sceneitem) {
-			context.sceneitem = sceneitem;
+	// Only compares pointers: scan under the scene's lock, and take the
+	// reference before the lock is released
+	scanSceneItems(
+		scene,
+		[&](obs_sceneitem_t *sceneitem,
+		    obs_sceneitem_t * /*parent*/) -> bool {
+			if (context.searchPtr == sceneitem) {
+				context.sceneitem = sceneitem;
 
-			return false;
-		}
+				obs_sceneitem_addref(
+					SETRACE_ADDREF(context.sceneitem));
 
-		return true;
-	});
+				return false;
+			}
 
-	obs_source_release(SETRACE_DECREF(currentScene));
+			return true;
+		},
+		true);
 
-	if (context.sceneitem)
-		obs_sceneitem_addref(SETRACE_ADDREF(context.sceneitem));
+	obs_source_release(SETRACE_DECREF(currentScene));
 
 	return context.sceneitem;
 }
@@ -776,6 +783,8 @@ void StreamElementsSceneItemsMonitor::SetSceneItemPropertyValue(
 
 	obs_data_release(SETRACE_DECREF(scene_item_private_data));
 
+	StreamElementsObsSceneManager::InvalidateSerializedSceneItem(scene_item);
+
 	#if SE_ENABLE_SCENEITEM_UI_EXTENSIONS
 	if (triggerUpdate) {
 		ScheduleUpdateSceneItemsWidgets();
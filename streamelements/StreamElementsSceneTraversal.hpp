@@ -0,0 +1,185 @@
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+//
+// Fixed-capacity buffer which only allocates once it outgrows N elements.
+//
+template<typename T, size_t N> class StreamElementsSmallBuffer {
+public:
+	StreamElementsSmallBuffer() {}
+	~StreamElementsSmallBuffer() {}
+
+	StreamElementsSmallBuffer(const StreamElementsSmallBuffer &) = delete;
+	StreamElementsSmallBuffer &
+	operator=(const StreamElementsSmallBuffer &) = delete;
+
+	void push_back(const T &value)
+	{
+		if (m_size < N) {
+			m_inline[m_size] = value;
+		} else {
+			if (m_overflow.empty())
+				m_overflow.reserve(N);
+
+			m_overflow.push_back(value);
+		}
+
+		++m_size;
+	}
+
+	size_t size() const { return m_size; }
+
+	T &operator[](size_t index)
+	{
+		return index < N ? m_inline[index] : m_overflow[index - N];
+	}
+
+private:
+	T m_inline[N];
+	size_t m_size = 0;
+
+	std::vector<T> m_overflow;
+};
+
+//
+// Scene item traversal with the visitor as a template parameter.
+//
+// The traversal helpers took std::function callbacks, and
+// ObsSceneEnumAllItems() collected every item into vectors first, taking a
+// reference to each. They run on every lookup, render tick and
+// serialization, which made for a steady stream of allocations and refcount
+// atomics.
+//
+// Two kinds of traversal are offered:
+//
+// ScanScene() and ScanGroup() call the visitor from within the scene's
+// enumeration, while libobs holds the scene's lock: items cannot go away,
+// so no references are taken. The visitor must not change the scene.
+// Groups are visited after their items, and the visitor receives the group
+// an item belongs to, or nullptr for top-level items.
+//
+// ForEachItem() takes a reference to every item and calls the visitor once
+// the enumeration is over, so the visitor may change the scene. Items are
+// visited in scene order, each group followed by its direct items.
+// References are collected into buffers of N items on the stack, which only
+// allocate for larger scenes. Groups are enumerated after the scene's lock
+// is released, so no two scene locks are held at once.
+//
+// Visitors return false to stop the traversal; so do the traversals.
+//
+// TApi adapts the scene graph:
+//
+//	typedef ... scene_t;
+//	typedef ... item_t;
+//	static void enum_items(scene_t *, bool (*)(scene_t *, item_t *, void *),
+//			       void *);
+//	static void group_enum_items(item_t *,
+//				     bool (*)(scene_t *, item_t *, void *),
+//				     void *);
+//	static bool is_group(item_t *);
+//	static void addref(item_t *);
+//	static void release(item_t *);
+//
+template<typename TApi> class StreamElementsSceneTraversal {
+public:
+	typedef typename TApi::scene_t scene_t;
+	typedef typename TApi::item_t item_t;
+
+	static const size_t DEFAULT_BUFFER_SIZE = 64;
+
+	template<typename TVisitor>
+	static bool ScanScene(scene_t *scene, TVisitor &&visitor, bool recursive)
+	{
+		typedef typename std::remove_reference<TVisitor>::type visitor_t;
+
+		scan_context<visitor_t> context = {&visitor, nullptr, recursive,
+						   true};
+
+		TApi::enum_items(scene, &ScanItem<visitor_t>, &context);
+
+		return context.result;
+	}
+
+	template<typename TVisitor>
+	static bool ScanGroup(item_t *group, TVisitor &&visitor, bool recursive)
+	{
+		typedef typename std::remove_reference<TVisitor>::type visitor_t;
+
+		scan_context<visitor_t> context = {&visitor, group, recursive,
+						   true};
+
+		TApi::group_enum_items(group, &ScanItem<visitor_t>, &context);
+
+		return context.result;
+	}
+
+	template<size_t N = DEFAULT_BUFFER_SIZE, typename TVisitor>
+	static bool ForEachItem(scene_t *scene, TVisitor &&visitor)
+	{
+		StreamElementsSmallBuffer<item_t *, N> topLevelItems;
+
+		TApi::enum_items(scene, &CollectItem<N>, &topLevelItems);
+
+		// Each group's items go right after it.
+		StreamElementsSmallBuffer<item_t *, N> items;
+
+		for (size_t i = 0; i < topLevelItems.size(); ++i) {
+			items.push_back(topLevelItems[i]);
+
+			if (TApi::is_group(topLevelItems[i]))
+				TApi::group_enum_items(topLevelItems[i],
+						       &CollectItem<N>, &items);
+		}
+
+		bool result = true;
+
+		for (size_t i = 0; i < items.size(); ++i) {
+			if (result)
+				result = visitor(items[i]);
+
+			TApi::release(items[i]);
+		}
+
+		return result;
+	}
+
+private:
+	template<typename TVisitor> struct scan_context {
+		TVisitor *visitor;
+		item_t *parent;
+		bool recursive;
+		bool result;
+	};
+
+	template<typename TVisitor>
+	static bool ScanItem(scene_t *, item_t *item, void *param)
+	{
+		auto context = static_cast<scan_context<TVisitor> *>(param);
+
+		if (context->recursive && TApi::is_group(item))
+			context->result = ScanGroup(item, *context->visitor,
+						    context->recursive);
+
+		if (context->result)
+			context->result = (*context->visitor)(item,
+							      context->parent);
+
+		return context->result;
+	}
+
+	template<size_t N>
+	static bool CollectItem(scene_t *, item_t *item, void *param)
+	{
+		auto items = static_cast<StreamElementsSmallBuffer<item_t *, N> *>(
+			param);
+
+		TApi::addref(item);
+
+		items->push_back(item);
+
+		return true;
+	}
+};
@@ -0,0 +1,623 @@
+#include "StreamElementsScopedStorage.hpp"
+
+#include <filesystem>
+#include <mutex>
+#include <sstream>
+
+/* ================================================================= */
+
+//
+// Journal layout:
+//
+//     header:  "SESTOR01"
+//     record:  op:u8  keyLen:u32  valueLen:u32  key  value  checksum:u32
+//
+// Integers are little-endian. `op` is RECORD_PUT or RECORD_REMOVE; a remove
+// carries an empty value. The checksum is FNV-1a over everything in the record
+// before it, which is what lets a torn tail be told apart from a valid record.
+//
+static const char JOURNAL_MAGIC[] = "SESTOR01";
+static const size_t JOURNAL_MAGIC_LEN = sizeof(JOURNAL_MAGIC) - 1;
+
+static const char RECORD_PUT = 'P';
+static const char RECORD_REMOVE = 'R';
+
+static const size_t RECORD_OVERHEAD = 1 + 4 + 4 + 4;
+
+// Compaction is not worth a rewrite until the journal is at least this large,
+// and then only once superseded records make up half of it.
+static const size_t COMPACT_MIN_JOURNAL_BYTES = 1024 * 1024;
+
+static const char *const UTF8_BOM = "\xEF\xBB\xBF";
+
+static uint32_t Fnv1a(uint32_t hash, const char *data, size_t len)
+{
+	for (size_t i = 0; i < len; ++i) {
+		hash ^= (uint8_t)data[i];
+		hash *= 16777619U;
+	}
+
+	return hash;
+}
+
+static void PutUInt32(std::string &out, uint32_t value)
+{
+	out.push_back((char)(value & 0xFF));
+	out.push_back((char)((value >> 8) & 0xFF));
+	out.push_back((char)((value >> 16) & 0xFF));
+	out.push_back((char)((value >> 24) & 0xFF));
+}
+
+static uint32_t GetUInt32(const char *p)
+{
+	return (uint32_t)(uint8_t)p[0] | ((uint32_t)(uint8_t)p[1] << 8) |
+	       ((uint32_t)(uint8_t)p[2] << 16) |
+	       ((uint32_t)(uint8_t)p[3] << 24);
+}
+
+static void EncodeRecord(std::string &out, char op, const std::string &key,
+			 const std::string &value)
+{
+	const size_t start = out.size();
+
+	out.push_back(op);
+	PutUInt32(out, (uint32_t)key.size());
+	PutUInt32(out, (uint32_t)value.size());
+	out.append(key);
+	out.append(value);
+
+	PutUInt32(out, Fnv1a(2166136261U, out.data() + start,
+			     out.size() - start));
+}
+
+static size_t RecordSize(const std::string &key, const std::string &value)
+{
+	return RECORD_OVERHEAD + key.size() + value.size();
+}
+
+static bool ReadWholeFile(const std::filesystem::path &path,
+			  std::string &result)
+{
+	std::ifstream in(path, std::ios::binary);
+
+	if (!in)
+		return false;
+
+	std::stringstream ss;
+	ss << in.rdbuf();
+
+	result = ss.str();
+
+	return true;
+}
+
+/* ================================================================= */
+
+StreamElementsScopedStorage::Batch::Batch(StreamElementsScopedStorage *storage)
+	: m_storage(storage)
+{
+	m_storage->BeginBatch();
+}
+
+StreamElementsScopedStorage::Batch::~Batch()
+{
+	m_storage->EndBatch();
+}
+
+/* ================================================================= */
+
+StreamElementsScopedStorage::StreamElementsScopedStorage(
+	std::string journalPath)
+	: m_journalPath(journalPath)
+{
+}
+
+StreamElementsScopedStorage::~StreamElementsScopedStorage()
+{
+	std::unique_lock<decltype(m_mutex)> lock(m_mutex);
+
+	FlushPending();
+
+	if (m_journal.is_open())
+		m_journal.close();
+}
+
+std::string StreamElementsScopedStorage::MakeKey(const std::string &scope,
+						 const std::string &container,
+						 const std::string &item)
+{
+	std::string key;
+	key.reserve(scope.size() + container.size() + item.size() + 2);
+
+	key += scope;
+	key.push_back('\0');
+	key += container;
+	key.push_back('\0');
+	key += item;
+
+	return key;
+}
+
+bool StreamElementsScopedStorage::IsValidKeyPart(const std::string &part)
+{
+	// '\0' separates the parts of a key and cannot appear inside one.
+	return part.find('\0') == std::string::npos;
+}
+
+bool StreamElementsScopedStorage::Open()
+{
+	std::unique_lock<decltype(m_mutex)> lock(m_mutex);
+
+	const auto path = std::filesystem::u8path(m_journalPath);
+
+	m_items.clear();
+	m_pending.clear();
+	m_undo.clear();
+	m_liveBytes = JOURNAL_MAGIC_LEN;
+	m_journalBytes = 0;
+
+	if (m_journal.is_open())
+		m_journal.close();
+
+	std::string data;
+
+	std::error_code ec;
+	if (std::filesystem::exists(path, ec) && !ReadWholeFile(path, data))
+		return false;
+
+	if (data.size() < JOURNAL_MAGIC_LEN ||
+	    data.compare(0, JOURNAL_MAGIC_LEN, JOURNAL_MAGIC) != 0) {
+		if (data.size()) {
+			// Not ours, or damaged beyond the header. Keep it
+			// aside rather than appending to it.
+			std::filesystem::rename(
+				path,
+				std::filesystem::u8path(m_journalPath +
+							".corrupt"),
+				ec);
+		}
+
+		std::ofstream out(path, std::ios::binary | std::ios::trunc);
+		out.write(JOURNAL_MAGIC, JOURNAL_MAGIC_LEN);
+		out.close();
+
+		if (!out)
+			return false;
+
+		data = JOURNAL_MAGIC;
+	}
+
+	size_t offset = JOURNAL_MAGIC_LEN;
+
+	while (data.size() - offset >= RECORD_OVERHEAD) {
+		const char *p = data.data() + offset;
+
+		const char op = p[0];
+		const size_t keyLen = GetUInt32(p + 1);
+		const size_t valueLen = GetUInt32(p + 5);
+
+		if (op != RECORD_PUT && op != RECORD_REMOVE)
+			break;
+
+		if (data.size() - offset - RECORD_OVERHEAD < keyLen + valueLen)
+			break;
+
+		const size_t bodyLen = 1 + 4 + 4 + keyLen + valueLen;
+
+		if (GetUInt32(p + bodyLen) != Fnv1a(2166136261U, p, bodyLen))
+			break;
+
+		std::string key(p + 9, keyLen);
+
+		auto it = m_items.find(key);
+		if (it != m_items.end()) {
+			m_liveBytes -= RecordSize(it->first, it->second);
+			m_items.erase(it);
+		}
+
+		if (op == RECORD_PUT) {
+			std::string value(p + 9 + keyLen, valueLen);
+
+			m_liveBytes += RecordSize(key, value);
+			m_items.emplace(std::move(key), std::move(value));
+		}
+
+		offset += bodyLen + 4;
+	}
+
+	if (offset < data.size()) {
+		// Torn or corrupt tail: drop it so new records are not
+		// appended after garbage.
+		std::filesystem::resize_file(path, offset, ec);
+
+		if (ec)
+			return false;
+	}
+
+	m_journalBytes = offset;
+
+	m_journal.open(path, std::ios::binary | std::ios::app);
+
+	if (!m_journal.is_open())
+		return false;
+
+	if (ShouldCompact())
+		CompactInternal();
+
+	return true;
+}
+
+bool StreamElementsScopedStorage::Read(const std::string &scope,
+				       const std::string &container,
+				       const std::string &item,
+				       std::string &result)
+{
+	std::shared_lock<decltype(m_mutex)> lock(m_mutex);
+
+	auto it = m_items.find(MakeKey(scope, container, item));
+
+	if (it == m_items.end())
+		return false;
+
+	result = it->second;
+
+	return true;
+}
+
+bool StreamElementsScopedStorage::Write(const std::string &scope,
+					const std::string &container,
+					const std::string &item,
+					const std::string &content)
+{
+	if (!IsValidKeyPart(scope) || !IsValidKeyPart(container) ||
+	    !IsValidKeyPart(item))
+		return false;
+
+	std::unique_lock<decltype(m_mutex)> lock(m_mutex);
+
+	WaitForOtherBatches(lock);
+
+	std::string key = MakeKey(scope, container, item);
+
+	SetItem(key, &content);
+
+	AppendRecord(RECORD_PUT, key, content);
+
+	if (m_batchDepth)
+		return true;
+
+	return FlushPending();
+}
+
+bool StreamElementsScopedStorage::Remove(const std::string &scope,
+					 const std::string &container,
+					 const std::string &item)
+{
+	std::unique_lock<decltype(m_mutex)> lock(m_mutex);
+
+	WaitForOtherBatches(lock);
+
+	std::string key = MakeKey(scope, container, item);
+
+	if (!m_items.count(key))
+		return false;
+
+	SetItem(key, nullptr);
+
+	AppendRecord(RECORD_REMOVE, key, std::string());
+
+	if (m_batchDepth)
+		return true;
+
+	return FlushPending();
+}
+
+bool StreamElementsScopedStorage::List(const std::string &scope,
+				       const std::string &container,
+				       const std::string &prefix,
+				       std::vector<ItemInfo> &result)
+{
+	std::shared_lock<decltype(m_mutex)> lock(m_mutex);
+
+	const std::string containerKey = MakeKey(scope, container, "");
+	const std::string prefixKey = containerKey + prefix;
+
+	for (auto it = m_items.lower_bound(prefixKey);
+	     it != m_items.end() &&
+	     it->first.compare(0, prefixKey.size(), prefixKey) == 0;
+	     ++it) {
+		result.push_back({it->first.substr(containerKey.size()),
+				  it->second.size()});
+	}
+
+	return true;
+}
+
+void StreamElementsScopedStorage::Enumerate(
+	std::function<void(const std::string &scope,
+			   const std::string &container,
+			   const std::string &item,
+			   const std::string &content)>
+		callback)
+{
+	std::map<std::string, std::string> items;
+
+	{
+		std::shared_lock<decltype(m_mutex)> lock(m_mutex);
+
+		items = m_items;
+	}
+
+	for (auto &kv : items) {
+		const size_t scopeEnd = kv.first.find('\0');
+		const size_t containerEnd = kv.first.find('\0', scopeEnd + 1);
+
+		callback(kv.first.substr(0, scopeEnd),
+			 kv.first.substr(scopeEnd + 1,
+					 containerEnd - scopeEnd - 1),
+			 kv.first.substr(containerEnd + 1), kv.second);
+	}
+}
+
+size_t StreamElementsScopedStorage::ImportLegacyFiles(
+	const std::string &rootPath)
+{
+	namespace fs = std::filesystem;
+
+	const auto root = fs::u8path(rootPath);
+
+	std::error_code ec;
+	if (!fs::is_directory(root, ec))
+		return 0;
+
+	std::vector<fs::path> importedFiles;
+	std::vector<fs::path> visitedDirs;
+
+	BeginBatch();
+
+	for (auto &scopeEntry : fs::directory_iterator(root, ec)) {
+		if (!scopeEntry.is_directory(ec))
+			continue;
+
+		const std::string scope =
+			scopeEntry.path().filename().u8string();
+
+		for (auto &containerEntry :
+		     fs::directory_iterator(scopeEntry.path(), ec)) {
+			if (!containerEntry.is_directory(ec))
+				continue;
+
+			const std::string container =
+				containerEntry.path().filename().u8string();
+
+			for (auto &itemEntry : fs::directory_iterator(
+				     containerEntry.path(), ec)) {
+				if (!itemEntry.is_regular_file(ec))
+					continue;
+
+				std::string content;
+				if (!ReadWholeFile(itemEntry.path(), content))
+					continue;
+
+				// os_quick_write_utf8_file() wrote a BOM,
+				// which os_quick_read_utf8_file() skipped.
+				if (content.compare(0, 3, UTF8_BOM) == 0)
+					content.erase(0, 3);
+
+				if (!Write(scope, container,
+					   itemEntry.path()
+						   .filename()
+						   .u8string(),
+					   content))
+					continue;
+
+				importedFiles.push_back(itemEntry.path());
+			}
+
+			visitedDirs.push_back(containerEntry.path());
+		}
+
+		visitedDirs.push_back(scopeEntry.path());
+	}
+
+	if (!EndBatch())
+		return 0;
+
+	// Only now that the batch is durable in the journal.
+	for (auto &path : importedFiles)
+		fs::remove(path, ec);
+
+	// Removes empty directories only; anything we did not import stays.
+	for (auto &path : visitedDirs)
+		fs::remove(path, ec);
+
+	return importedFiles.size();
+}
+
+bool StreamElementsScopedStorage::Compact()
+{
+	std::unique_lock<decltype(m_mutex)> lock(m_mutex);
+
+	WaitForOtherBatches(lock);
+
+	if (!FlushPending())
+		return false;
+
+	return CompactInternal();
+}
+
+void StreamElementsScopedStorage::AppendRecord(char op, const std::string &key,
+					       const std::string &value)
+{
+	EncodeRecord(m_pending, op, key, value);
+}
+
+void StreamElementsScopedStorage::SetItem(const std::string &key,
+					  const std::string *value)
+{
+	auto it = m_items.find(key);
+
+	if (it != m_items.end()) {
+		m_undo.push_back({key, true, it->second});
+		m_liveBytes -= RecordSize(it->first, it->second);
+
+		if (value)
+			it->second = *value;
+		else
+			m_items.erase(it);
+	} else {
+		m_undo.push_back({key, false, std::string()});
+
+		if (value)
+			m_items.emplace(key, *value);
+	}
+
+	if (value)
+		m_liveBytes += RecordSize(key, *value);
+}
+
+bool StreamElementsScopedStorage::FlushPending()
+{
+	if (m_pending.empty())
+		return true;
+
+	if (!m_journal.is_open()) {
+		Rollback();
+
+		return false;
+	}
+
+	m_journal.write(m_pending.data(), m_pending.size());
+	m_journal.flush();
+
+	if (!m_journal) {
+		// Cut off whatever part of m_pending made it to disk, so
+		// that later records are not appended after a torn one.
+		m_journal.close();
+
+		std::error_code ec;
+		std::filesystem::resize_file(
+			std::filesystem::u8path(m_journalPath), m_journalBytes,
+			ec);
+
+		m_journal.open(std::filesystem::u8path(m_journalPath),
+			       std::ios::binary | std::ios::app);
+
+		Rollback();
+
+		return false;
+	}
+
+	m_journalBytes += m_pending.size();
+	m_pending.clear();
+	m_undo.clear();
+
+	if (ShouldCompact())
+		CompactInternal();
+
+	return true;
+}
+
+void StreamElementsScopedStorage::Rollback()
+{
+	for (auto it = m_undo.rbegin(); it != m_undo.rend(); ++it) {
+		auto item = m_items.find(it->key);
+
+		if (item != m_items.end()) {
+			m_liveBytes -= RecordSize(item->first, item->second);
+			m_items.erase(item);
+		}
+
+		if (it->existed) {
+			m_liveBytes += RecordSize(it->key, it->value);
+			m_items.emplace(it->key, it->value);
+		}
+	}
+
+	m_undo.clear();
+	m_pending.clear();
+}
+
+bool StreamElementsScopedStorage::ShouldCompact()
+{
+	return m_journalBytes > COMPACT_MIN_JOURNAL_BYTES &&
+	       m_journalBytes > 2 * m_liveBytes;
+}
+
+bool StreamElementsScopedStorage::CompactInternal()
+{
+	namespace fs = std::filesystem;
+
+	const auto path = fs::u8path(m_journalPath);
+	const auto tmpPath = fs::u8path(m_journalPath + ".tmp");
+
+	std::string snapshot;
+	snapshot.reserve(m_liveBytes);
+	snapshot.append(JOURNAL_MAGIC, JOURNAL_MAGIC_LEN);
+
+	for (auto &kv : m_items)
+		EncodeRecord(snapshot, RECORD_PUT, kv.first, kv.second);
+
+	{
+		std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+		out.write(snapshot.data(), snapshot.size());
+		out.close();
+
+		if (!out)
+			return false;
+	}
+
+	// Windows will not replace a file which is still open.
+	m_journal.close();
+
+	std::error_code ec;
+	fs::rename(tmpPath, path, ec);
+
+	m_journal.open(path, std::ios::binary | std::ios::app);
+
+	if (ec) {
+		fs::remove(tmpPath, ec);
+
+		return false;
+	}
+
+	m_journalBytes = snapshot.size();
+
+	return m_journal.is_open();
+}
+
+void StreamElementsScopedStorage::BeginBatch()
+{
+	std::unique_lock<decltype(m_mutex)> lock(m_mutex);
+
+	WaitForOtherBatches(lock);
+
+	m_batchOwner = std::this_thread::get_id();
+
+	++m_batchDepth;
+}
+
+bool StreamElementsScopedStorage::EndBatch()
+{
+	std::unique_lock<decltype(m_mutex)> lock(m_mutex);
+
+	if (--m_batchDepth)
+		return true;
+
+	m_batchOwner = std::thread::id();
+
+	const bool result = FlushPending();
+
+	m_batchEnded.notify_all();
+
+	return result;
+}
+
+void StreamElementsScopedStorage::WaitForOtherBatches(
+	std::unique_lock<std::shared_mutex> &lock)
+{
+	m_batchEnded.wait(lock, [this]() {
+		return !m_batchDepth ||
+		       m_batchOwner == std::this_thread::get_id();
+	});
+}
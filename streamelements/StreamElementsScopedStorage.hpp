@@ -0,0 +1,141 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <functional>
+#include <shared_mutex>
+#include <condition_variable>
+#include <thread>
+
+//
+// Key/value store backing the scopedStorage* API family.
+//
+// Scoped storage used to be one file per item under
+// scoped_config_storage/<scope>/<container>/, which meant a directory create
+// and a full file rewrite per write, and an os_glob() directory scan per list.
+// Widgets storing many small items ended up with thousands of tiny files.
+//
+// Everything now lives in a single append-only journal: each write appends one
+// checksummed record, and the full key space is replayed into a sorted
+// in-memory index at open. Reads never touch the disk, listing a container is a
+// range scan over the index, and several writes can be committed as a single
+// append by holding a Batch. The journal is compacted into a fresh snapshot
+// once superseded records dominate it.
+//
+// A torn record at the tail -- a crash mid-append -- fails its checksum and is
+// truncated away at the next open; every record before it survives.
+//
+class StreamElementsScopedStorage {
+public:
+	struct ItemInfo {
+		std::string item;
+		size_t contentLength;
+	};
+
+	// Groups writes into a single journal append. Nestable; the append
+	// happens when the outermost Batch goes out of scope, and if it fails
+	// every write of the batch is undone.
+	//
+	// A batch belongs to the thread which opened it. Writes, batches and
+	// compactions from other threads wait for it to end, so that they
+	// are neither swept into it nor undone with it. Reads do not wait,
+	// and see the batch's writes as they happen.
+	class Batch {
+	public:
+		Batch(StreamElementsScopedStorage *storage);
+		~Batch();
+
+	private:
+		StreamElementsScopedStorage *m_storage;
+	};
+
+public:
+	StreamElementsScopedStorage(std::string journalPath);
+	~StreamElementsScopedStorage();
+
+	// Replays the journal into memory. Returns false if the journal
+	// exists but could not be read or reopened for appending.
+	bool Open();
+
+	bool Read(const std::string &scope, const std::string &container,
+		  const std::string &item, std::string &result);
+
+	// Write() and Remove() return false, and leave the item as it was,
+	// if the record could not be appended to the journal.
+	bool Write(const std::string &scope, const std::string &container,
+		   const std::string &item, const std::string &content);
+	bool Remove(const std::string &scope, const std::string &container,
+		    const std::string &item);
+
+	// Lists items of a container whose name starts with `prefix`, in
+	// lexicographic order.
+	bool List(const std::string &scope, const std::string &container,
+		  const std::string &prefix, std::vector<ItemInfo> &result);
+
+	// Invokes `callback` for every stored item. The callback runs on a
+	// copy taken under the lock, so it may call back into the store.
+	void Enumerate(std::function<void(const std::string &scope,
+					  const std::string &container,
+					  const std::string &item,
+					  const std::string &content)>
+			       callback);
+
+	// One-time migration from the legacy file-per-item layout:
+	// <rootPath>/<scope>/<container>/<item>. Every file found is imported
+	// in a single batch and deleted once the batch is on disk, so running
+	// this again is a no-op. Files appearing later -- a backup restore
+	// extracts the legacy layout -- are absorbed by the next call.
+	//
+	// Returns the number of items imported.
+	size_t ImportLegacyFiles(const std::string &rootPath);
+
+	// Rewrites the journal as a snapshot of the live items.
+	bool Compact();
+
+private:
+	static std::string MakeKey(const std::string &scope,
+				   const std::string &container,
+				   const std::string &item);
+	static bool IsValidKeyPart(const std::string &part);
+
+	void AppendRecord(char op, const std::string &key,
+			  const std::string &value);
+	void SetItem(const std::string &key, const std::string *value);
+	bool FlushPending();
+	void Rollback();
+	bool CompactInternal();
+	bool ShouldCompact();
+
+	void BeginBatch();
+	bool EndBatch();
+
+	// Waits, with `lock` held on m_mutex, until no other thread has a
+	// batch open.
+	void WaitForOtherBatches(std::unique_lock<std::shared_mutex> &lock);
+
+private:
+	std::string m_journalPath;
+	std::shared_mutex m_mutex;
+
+	std::map<std::string, std::string> m_items;
+	std::ofstream m_journal;
+
+	std::string m_pending;
+	int m_batchDepth = 0;
+	std::thread::id m_batchOwner;
+	std::condition_variable_any m_batchEnded;
+
+	// Previous values of the items changed by m_pending, oldest first,
+	// restored if m_pending fails to reach the journal.
+	struct Undo {
+		std::string key;
+		bool existed;
+		std::string value;
+	};
+	std::vector<Undo> m_undo;
+
+	size_t m_journalBytes = 0;
+	size_t m_liveBytes = 0;
+};
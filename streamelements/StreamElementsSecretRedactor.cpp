@@ -3,6 +3,7 @@
 #include <algorithm>
 #include <cctype>
 #include <cwctype>
+#include <cstring>
 
 /* ================================================================= */
 
@@ -20,24 +21,60 @@ static bool IsSecretKeyName(const std::string &name)
 	return name == "key" || name == "password" || name == "bearer_token";
 }
 
+// Longest key name Redact() looks at: "bearer_token". Longer quoted tokens
+// are streamed straight through.
+static const size_t MAX_KEY_NAME_LENGTH = 12;
+
+static bool IsCandidateKeyName(const std::string &name)
+{
+	return IsSecretKeyName(name) || name == "server";
+}
+
+//
+// Finds the next unescaped '"' in data[start, size). `escape` says whether
+// data[start] is escaped by a backslash ending the previous chunk, and is
+// updated to the same for data[size] when no quote is found.
 //
-// Finds the closing quote of a JSON string whose contents start at `start`,
-// honouring backslash escapes. Returns npos when the string is unterminated.
+// Quotes are located with memchr(); only the run of backslashes directly in
+// front of a candidate is inspected to tell whether it is escaped.
 //
-static size_t FindClosingQuote(const std::string &s, size_t start)
+static size_t FindUnescapedQuote(const char *data, size_t start, size_t size,
+				 bool &escape)
 {
-	for (size_t i = start; i < s.size(); ++i) {
-		if (s[i] == '\\') {
-			++i; // skip the escaped character
+	while (start < size) {
+		const char *quote =
+			(const char *)memchr(data + start, '"', size - start);
+		const size_t end = quote ? (size_t)(quote - data) : size;
+
+		size_t run = 0;
+
+		while (end - run > start && data[end - run - 1] == '\\')
+			++run;
+
+		// A backslash carried over from the previous chunk escapes
+		// data[start], which shifts the parity of a run starting there.
+		if (end - run == start && escape)
+			++run;
+
+		const bool escaped = run % 2 == 1;
+
+		if (!quote) {
+			escape = escaped;
+
+			return size;
+		}
+
+		if (!escaped) {
+			escape = false;
 
-			continue;
+			return end;
 		}
 
-		if (s[i] == '"')
-			return i;
+		start = end + 1;
+		escape = false;
 	}
 
-	return std::string::npos;
+	return size;
 }
 
 //
@@ -112,90 +149,251 @@ std::string StreamElementsSecretRedactor::Redact(const std::string &content)
 	std::string result;
 	result.reserve(content.size() + 64);
 
+	Stream stream;
+
+	stream.Write(content.data(), content.size(), result);
+	stream.Finish(result);
+
+	return result;
+}
+
+/* ================================================================= */
+
+//
+// The stream mirrors a scanner that walks quoted tokens: a token followed by
+// a colon and a quoted value is a key, and a key/value pair is either
+// redacted as a whole or -- when it turns out not to be a secret -- only the
+// key is copied and scanning resumes right after it, so that the would-be
+// value gets its own chance to be a key. Replay() is that resumption: it
+// feeds what was held back past the key through the stream again.
+//
+void StreamElementsSecretRedactor::Stream::Write(const char *data, size_t size,
+						 std::string &output)
+{
 	size_t i = 0;
 
-	while (i < content.size()) {
-		if (content[i] != '"') {
-			result += content[i++];
+	while (i < size) {
+		switch (m_state) {
+		case State::Text: {
+			const char *quote =
+				(const char *)memchr(data + i, '"', size - i);
+
+			if (!quote) {
+				output.append(data + i, size - i);
+
+				i = size;
+
+				break;
+			}
+
+			output.append(data + i, quote - (data + i));
 
-			continue;
+			i = quote - data + 1;
+
+			m_pending.assign(1, '"');
+			m_escape = false;
+			m_state = State::Name;
+
+			break;
 		}
 
-		// A quoted token. It is a key if a colon follows it.
-		const size_t nameStart = i + 1;
-		const size_t nameEnd = FindClosingQuote(content, nameStart);
+		case State::Name:
+		case State::StringTail: {
+			const size_t end =
+				FindUnescapedQuote(data, i, size, m_escape);
+
+			if (m_state == State::Name &&
+			    m_pending.size() - 1 + (end - i) >
+				    MAX_KEY_NAME_LENGTH) {
+				output += m_pending;
+				m_pending.clear();
+
+				m_state = State::StringTail;
+			}
+
+			if (m_state == State::StringTail) {
+				output.append(data + i, end - i);
+
+				if (end < size) {
+					output += '"';
+
+					m_state = State::Text;
+				}
+			} else {
+				m_pending.append(data + i, end - i);
+
+				if (end < size) {
+					m_pending += '"';
+
+					if (IsCandidateKeyName(m_pending.substr(
+						    1, m_pending.size() - 2))) {
+						m_nameSize = m_pending.size();
+						m_state = State::AfterName;
+					} else {
+						output += m_pending;
+						m_pending.clear();
+
+						m_state = State::Text;
+					}
+				}
+			}
 
-		if (nameEnd == std::string::npos) {
-			// Unterminated: copy the remainder verbatim.
-			result.append(content, i, std::string::npos);
+			i = end < size ? end + 1 : size;
 
 			break;
 		}
 
-		const std::string name =
-			content.substr(nameStart, nameEnd - nameStart);
+		case State::AfterName:
+		case State::AfterColon: {
+			const char ch = data[i];
+
+			if (m_pending.size() >= MAX_PENDING_BYTES) {
+				Replay(output);
+			} else if (isspace((unsigned char)ch)) {
+				m_pending += ch;
+				++i;
+			} else if (ch == ':' && m_state == State::AfterName) {
+				m_pending += ch;
+				++i;
+
+				m_state = State::AfterColon;
+			} else if (ch == '"' && m_state == State::AfterColon) {
+				m_pending += ch;
+				++i;
+
+				m_valueStart = m_pending.size();
+				m_escape = false;
+				m_state = State::Value;
+			} else {
+				// Not a key after all. `ch` is left for the
+				// state the replay ends in.
+				Replay(output);
+			}
 
-		size_t cursor = nameEnd + 1;
+			break;
+		}
 
-		while (cursor < content.size() &&
-		       isspace((unsigned char)content[cursor]))
-			++cursor;
+		case State::Value: {
+			const size_t end =
+				FindUnescapedQuote(data, i, size, m_escape);
 
-		bool handled = false;
+			m_pending.append(data + i, end - i);
 
-		if (cursor < content.size() && content[cursor] == ':') {
-			++cursor;
+			i = end < size ? end + 1 : size;
 
-			while (cursor < content.size() &&
-			       isspace((unsigned char)content[cursor]))
-				++cursor;
+			if (end < size) {
+				m_pending += '"';
 
-			if (cursor < content.size() && content[cursor] == '"') {
-				const size_t valueStart = cursor + 1;
-				const size_t valueEnd =
-					FindClosingQuote(content, valueStart);
+				if (!RedactPending(output))
+					Replay(output);
+			} else if (m_pending.size() > MAX_PENDING_BYTES) {
+				RedactOversizedValue(output);
+			}
 
-				if (valueEnd != std::string::npos) {
-					const std::string value =
-						content.substr(
-							valueStart,
-							valueEnd - valueStart);
+			break;
+		}
 
-					std::string replacement;
-					bool redact = false;
+		case State::ValueDiscard: {
+			const size_t end =
+				FindUnescapedQuote(data, i, size, m_escape);
 
-					if (IsSecretKeyName(name)) {
-						replacement = REDACTED;
-						redact = true;
-					} else if (name == "server") {
-						redact = RedactUrlUserInfo(
-							value, replacement);
-					}
+			if (end < size) {
+				output += '"';
 
-					if (redact) {
-						// Everything up to and including
-						// the value's opening quote is
-						// copied byte for byte.
-						result.append(content, i,
-							      valueStart - i);
-						result += replacement;
-						result += '"';
-
-						i = valueEnd + 1;
-						handled = true;
-					}
-				}
+				m_state = State::Text;
 			}
+
+			i = end < size ? end + 1 : size;
+
+			break;
+		}
 		}
+	}
+}
 
-		if (!handled) {
-			// Copy the quoted token and carry on from just after
-			// it, so its contents are never rescanned as keys.
-			result.append(content, i, nameEnd + 1 - i);
+void StreamElementsSecretRedactor::Stream::Finish(std::string &output)
+{
+	// Whatever is still held back is an unterminated token, or a key not
+	// followed by a complete value; either way it is copied verbatim.
+	if (m_state != State::ValueDiscard)
+		output += m_pending;
+
+	m_pending.clear();
+	m_escape = false;
+	m_state = State::Text;
+}
+
+bool StreamElementsSecretRedactor::Stream::RedactPending(std::string &output)
+{
+	const std::string name = m_pending.substr(1, m_nameSize - 2);
+	const std::string value = m_pending.substr(
+		m_valueStart, m_pending.size() - 1 - m_valueStart);
+
+	std::string replacement;
+
+	if (IsSecretKeyName(name))
+		replacement = REDACTED;
+	else if (!RedactUrlUserInfo(value, replacement))
+		return false;
 
-			i = nameEnd + 1;
+	// Everything up to and including the value's opening quote is copied
+	// byte for byte.
+	output.append(m_pending, 0, m_valueStart);
+	output += replacement;
+	output += '"';
+
+	m_pending.clear();
+	m_state = State::Text;
+
+	return true;
+}
+
+void StreamElementsSecretRedactor::Stream::RedactOversizedValue(
+	std::string &output)
+{
+	const std::string name = m_pending.substr(1, m_nameSize - 2);
+	const std::string value = m_pending.substr(m_valueStart);
+
+	std::string replacement = REDACTED;
+	State next = State::ValueDiscard;
+
+	if (!IsSecretKeyName(name)) {
+		// The userinfo of a "server" URL is decided as soon as its
+		// authority is complete; the rest of the value is copied.
+		const size_t schemeEnd = value.find("://");
+
+		if (schemeEnd != std::string::npos &&
+		    value.find_first_of("/?#", schemeEnd + 3) !=
+			    std::string::npos) {
+			if (!RedactUrlUserInfo(value, replacement)) {
+				Replay(output);
+
+				return;
+			}
+
+			next = State::StringTail;
 		}
+
+		// Otherwise the value cannot be decided without holding more
+		// of it: it is redacted whole.
 	}
 
-	return result;
+	output.append(m_pending, 0, m_valueStart);
+	output += replacement;
+
+	m_pending.clear();
+	m_state = next;
+}
+
+void StreamElementsSecretRedactor::Stream::Replay(std::string &output)
+{
+	output.append(m_pending, 0, m_nameSize);
+
+	const std::string replay = m_pending.substr(m_nameSize);
+
+	m_pending.clear();
+	m_escape = false;
+	m_state = State::Text;
+
+	Write(replay.data(), replay.size(), output);
 }
@@ -30,10 +30,12 @@ public:
 	// True when `zipPath` names a file known to carry credentials. Matching
 	// is case-insensitive and accepts either slash direction.
 	//
-	// Redact() is only ever applied to paths this accepts. That containment
-	// is what makes it safe to treat a field as generic as "key" as a
-	// secret: in service.json it is the stream key, whereas elsewhere in the
-	// configuration tree it would mean something else entirely.
+	// Redact() is only ever applied to paths this accepts, and to logs.
+	// That containment is what makes it safe to treat a field as generic
+	// as "key" as a secret: in service.json it is the stream key, and a log
+	// only carries one when something dumped service settings into it,
+	// whereas elsewhere in the configuration tree it would mean something
+	// else entirely.
 	static bool IsSensitivePath(const std::wstring &zipPath);
 
 	// Returns `content` with credential values replaced by [redacted].
@@ -49,4 +51,59 @@ public:
 	// recognise, such as a non-string value or a key spelled differently by
 	// a future OBS version, passes through untouched.
 	static std::string Redact(const std::string &content);
+
+	//
+	// Incremental form of Redact(), for content that should not be held in
+	// memory whole. Feed chunks of any size through Write() and call
+	// Finish() once; the concatenated output is byte for byte what
+	// Redact() returns for the concatenated input.
+	//
+	// Only a "name": "value" pair that might need redacting is held back,
+	// and only until it is decided, so memory is bounded by
+	// MAX_PENDING_BYTES rather than by the input. A value longer than
+	// that is decided without waiting for its closing quote: a secret is
+	// redacted, and so is the userinfo of a "server" URL once its
+	// authority has been seen. That departs from Redact() in two corner
+	// cases, both towards not leaking: a value the input ends inside of is
+	// redacted where Redact() would copy it, and a "server" value whose
+	// authority is not complete within the limit is redacted whole.
+	//
+	// Between candidate pairs the input is scanned with memchr(), which
+	// the C runtime vectorizes, rather than a byte at a time.
+	//
+	class Stream {
+	public:
+		static const size_t MAX_PENDING_BYTES = 64 * 1024;
+
+		// Appends redacted output for `data` to `output`.
+		void Write(const char *data, size_t size, std::string &output);
+
+		// Flushes anything held back. The stream can be reused
+		// afterwards.
+		void Finish(std::string &output);
+
+	private:
+		enum class State {
+			Text,
+			Name,       // a short quoted token, held back
+			StringTail, // rest of a decided string, copied through
+			AfterName,  // "key" seen, expecting a colon
+			AfterColon, // "key": seen, expecting a value
+			Value,      // "key": "..., held back
+			ValueDiscard, // value already redacted, skipping to its end
+		};
+
+		void Replay(std::string &output);
+		void RedactOversizedValue(std::string &output);
+		bool RedactPending(std::string &output);
+
+	private:
+		State m_state = State::Text;
+		bool m_escape = false;
+
+		// The undecided pair, starting at the key's opening quote.
+		std::string m_pending;
+		size_t m_nameSize = 0;
+		size_t m_valueStart = 0;
+	};
 };
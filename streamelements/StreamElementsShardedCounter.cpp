@@ -0,0 +1,20 @@
+#include "StreamElementsShardedCounter.hpp"
+
+long StreamElementsShardedCounter::Get() const
+{
+	long result = 0;
+
+	for (auto &shard : m_shards)
+		result += shard.value.load(std::memory_order_relaxed);
+
+	return result;
+}
+
+size_t StreamElementsShardedCounter::AssignShardIndex()
+{
+	// Round-robin rather than hashing the thread id: consecutive threads
+	// get distinct shards until there are more than SHARD_COUNT of them.
+	static std::atomic<size_t> s_next(0);
+
+	return s_next.fetch_add(1, std::memory_order_relaxed) % SHARD_COUNT;
+}
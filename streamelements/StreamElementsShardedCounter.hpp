@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+//
+// A counter that many threads update often and that is read rarely.
+//
+// Add() lands on one of SHARD_COUNT cache-line-sized shards, picked once per
+// thread, so threads do not keep stealing one cache line from each other.
+// Get() sums the shards. A sum taken while other threads are adding is only
+// a snapshot, but one taken after they have stopped is exact.
+//
+// Constant-initialized, so it can be a global that is used before static
+// constructors run.
+//
+class StreamElementsShardedCounter {
+public:
+	static constexpr size_t SHARD_COUNT = 64;
+
+public:
+	constexpr StreamElementsShardedCounter() {}
+
+	void Add(long delta)
+	{
+		m_shards[GetShardIndex()].value.fetch_add(
+			delta, std::memory_order_relaxed);
+	}
+
+	long Get() const;
+
+private:
+	static size_t GetShardIndex()
+	{
+		static thread_local size_t index = AssignShardIndex();
+
+		return index;
+	}
+
+	static size_t AssignShardIndex();
+
+private:
+	struct alignas(64) Shard {
+		std::atomic<long> value{0};
+	};
+
+	Shard m_shards[SHARD_COUNT];
+};
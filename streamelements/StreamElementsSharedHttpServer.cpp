@@ -0,0 +1,136 @@
+#include "StreamElementsSharedHttpServer.hpp"
+
+#include <random>
+
+StreamElementsSharedHttpServer::StreamElementsSharedHttpServer(
+	size_t threadCount)
+	: m_threadCount(threadCount)
+{
+}
+
+StreamElementsSharedHttpServer::~StreamElementsSharedHttpServer()
+{
+	std::lock_guard<decltype(m_mutex)> guard(m_mutex);
+
+	m_server = nullptr;
+}
+
+std::string StreamElementsSharedHttpServer::CreateRouteToken()
+{
+	static std::mutex s_mutex;
+	static std::random_device s_device;
+
+	std::lock_guard<std::mutex> guard(s_mutex);
+
+	std::uniform_int_distribution<int> digit(0, 15);
+
+	std::string token;
+
+	for (int i = 0; i < 32; ++i)
+		token += "0123456789abcdef"[digit(s_device)];
+
+	return token;
+}
+
+std::string
+StreamElementsSharedHttpServer::AddRoute(HttpServer::request_handler_t handler)
+{
+	std::lock_guard<decltype(m_mutex)> guard(m_mutex);
+
+	if (!m_server) {
+		auto server = std::make_unique<HttpServer>(
+			[this](const HttpServer::request_t &req,
+			       HttpServer::response_t &res) {
+				HandleRequest(req, res);
+			},
+			m_threadCount);
+
+		if (server->Start(0, GetIpAddress()) <= 0)
+			return "";
+
+		m_server = std::move(server);
+	}
+
+	std::string route = CreateRouteToken();
+
+	std::unique_lock<decltype(m_routesMutex)> routesGuard(m_routesMutex);
+
+	m_routes[route] =
+		std::make_shared<HttpServer::request_handler_t>(handler);
+
+	return route;
+}
+
+void StreamElementsSharedHttpServer::RemoveRoute(std::string route)
+{
+	std::unique_ptr<HttpServer> stopped;
+
+	{
+		std::lock_guard<decltype(m_mutex)> guard(m_mutex);
+
+		std::unique_lock<decltype(m_routesMutex)> routesGuard(
+			m_routesMutex);
+
+		m_routes.erase(route);
+
+		if (m_routes.empty())
+			stopped = std::move(m_server);
+	}
+
+	// Stopping waits for requests in flight, which must hold neither
+	// lock: AddRoute() starts a new server meanwhile if it has to.
+	stopped = nullptr;
+}
+
+size_t StreamElementsSharedHttpServer::GetRouteCount()
+{
+	std::shared_lock<decltype(m_routesMutex)> guard(m_routesMutex);
+
+	return m_routes.size();
+}
+
+int StreamElementsSharedHttpServer::GetPortNumber()
+{
+	std::lock_guard<decltype(m_mutex)> guard(m_mutex);
+
+	return m_server ? m_server->GetPortNumber() : 0;
+}
+
+void StreamElementsSharedHttpServer::HandleRequest(
+	const HttpServer::request_t &req, HttpServer::response_t &res)
+{
+	// /<route>[/rest]
+	const size_t routeEnd = req.path.find('/', 1);
+
+	const std::string route =
+		req.path.size() > 1
+			? req.path.substr(1, routeEnd == std::string::npos
+						     ? std::string::npos
+						     : routeEnd - 1)
+			: "";
+
+	std::shared_ptr<HttpServer::request_handler_t> handler;
+
+	{
+		std::shared_lock<decltype(m_routesMutex)> guard(m_routesMutex);
+
+		auto it = m_routes.find(route);
+
+		if (it != m_routes.end())
+			handler = it->second;
+	}
+
+	if (!handler) {
+		res.status = 404;
+		res.reason = "Not Found";
+
+		return;
+	}
+
+	HttpServer::request_t routed = req;
+
+	routed.path = routeEnd == std::string::npos ? "/"
+						    : req.path.substr(routeEnd);
+
+	(*handler)(routed, res);
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "deps/server/HttpServer.hpp"
+
+#include <string>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+
+//
+// One loopback HTTP server shared by the browser scoped HTTP servers which
+// opt in to it.
+//
+// Each browser HTTP server is an HttpServer of its own by default: a
+// listening socket and a full thread pool per server, most of them idle, so
+// the thread count grows with every widget that asks for one.
+//
+// A browser HTTP server which opts in is a route on this server instead: a
+// random token used as the first path segment. A request to
+//
+//	http://127.0.0.1:<port>/<route>/some/path
+//
+// is handed to the route's handler as a request for /some/path. Routes are
+// added and removed at any time, from any thread; a request already being
+// handled keeps its handler alive until it is done. The server is started
+// with the first route and stopped with the last one, and its thread pool has
+// a fixed size however many routes there are.
+//
+// The route token doubles as a capability: another process on the machine
+// cannot reach a route without knowing it.
+//
+class StreamElementsSharedHttpServer {
+public:
+	// `threadCount` sizes the thread pool of the server; 0 keeps
+	// httplib's default.
+	StreamElementsSharedHttpServer(size_t threadCount = 0);
+	~StreamElementsSharedHttpServer();
+
+	// Adds a route for `handler`, starting the server if needed. Returns
+	// the route token, or an empty string if the server failed to start.
+	std::string AddRoute(HttpServer::request_handler_t handler);
+
+	// Removes a route; the server is stopped once no route is left. The
+	// stop waits for requests in flight, without blocking other calls.
+	void RemoveRoute(std::string route);
+
+	size_t GetRouteCount();
+
+	int GetPortNumber();
+	std::string GetIpAddress() { return "127.0.0.1"; }
+
+	// "/<route>", the path prefix of the route.
+	static std::string GetRoutePathPrefix(const std::string &route)
+	{
+		return "/" + route;
+	}
+
+private:
+	void HandleRequest(const HttpServer::request_t &req,
+			   HttpServer::response_t &res);
+
+	static std::string CreateRouteToken();
+
+private:
+	size_t m_threadCount;
+
+	// Serializes start, stop and route changes.
+	std::mutex m_mutex;
+	std::unique_ptr<HttpServer> m_server;
+
+	// Looked up on every request.
+	std::shared_mutex m_routesMutex;
+	std::map<std::string, std::shared_ptr<HttpServer::request_handler_t>>
+		m_routes;
+};
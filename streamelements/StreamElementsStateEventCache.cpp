@@ -0,0 +1,171 @@
+#include "StreamElementsStateEventCache.hpp"
+
+#include "json11/json11.hpp"
+
+// The value of `field` in the JSON object `json`, as a string.
+static std::string get_scope(const std::string &json, const std::string &field)
+{
+	if (field.empty())
+		return "";
+
+	std::string err;
+	auto root = json11::Json::parse(json, err);
+
+	auto &value = root[field];
+
+	if (value.is_string())
+		return value.string_value();
+
+	if (value.is_null())
+		return "";
+
+	return value.dump();
+}
+
+static size_t get_entry_bytes(const std::string &key,
+			      const StreamElementsStateEventCache::Entry &entry)
+{
+	return key.size() + entry.source.size() + entry.target.size() +
+	       entry.event.size() + entry.json.size();
+}
+
+/* ========================================================================= */
+
+StreamElementsStateEventCache::StreamElementsStateEventCache(size_t maxEntries,
+							     size_t maxBytes)
+	: m_maxEntries(maxEntries), m_maxBytes(maxBytes)
+{
+}
+
+StreamElementsStateEventCache::~StreamElementsStateEventCache() {}
+
+void StreamElementsStateEventCache::AddStateEvent(const std::string &event,
+						  const std::string &group,
+						  const std::string &scopeField)
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+
+	m_stateEvents[event] = {group, scopeField};
+}
+
+bool StreamElementsStateEventCache::Update(const std::string &source,
+					   const std::string &target,
+					   const std::string &event,
+					   const std::string &json,
+					   uint64_t generation)
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+
+	auto stateEvent = m_stateEvents.find(event);
+
+	if (stateEvent == m_stateEvents.end())
+		return false;
+
+	const std::string scope =
+		get_scope(json, stateEvent->second.scopeField);
+	const std::string key =
+		stateEvent->second.group + '\n' + target + '\n' + scope;
+
+	Remove(key);
+
+	CachedEntry cached;
+	cached.scopeField = stateEvent->second.scopeField;
+	cached.scope = scope;
+	cached.entry.source = source;
+	cached.entry.target = target;
+	cached.entry.event = event;
+	cached.entry.json = json;
+	cached.entry.generation = generation;
+	cached.sequence = ++m_sequence;
+
+	const size_t bytes = get_entry_bytes(key, cached.entry);
+
+	if (bytes > m_maxBytes)
+		return false;
+
+	while (!m_order.empty() && (m_entries.size() >= m_maxEntries ||
+				    m_bytes + bytes > m_maxBytes)) {
+		Remove(m_order.begin()->second);
+	}
+
+	if (m_entries.size() >= m_maxEntries)
+		return false;
+
+	m_order[cached.sequence] = key;
+	m_entries[key] = cached;
+	m_bytes += bytes;
+
+	return true;
+}
+
+void StreamElementsStateEventCache::Remove(const std::string &key)
+{
+	auto it = m_entries.find(key);
+
+	if (it == m_entries.end())
+		return;
+
+	m_bytes -= get_entry_bytes(key, it->second.entry);
+	m_order.erase(it->second.sequence);
+	m_entries.erase(it);
+}
+
+std::vector<StreamElementsStateEventCache::Entry>
+StreamElementsStateEventCache::GetEntries(const std::string &target) const
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+
+	std::vector<Entry> result;
+	result.reserve(m_order.size());
+
+	for (auto &kv : m_order) {
+		auto &entry = m_entries.at(kv.second).entry;
+
+		if (entry.target.empty() || entry.target == target)
+			result.push_back(entry);
+	}
+
+	return result;
+}
+
+size_t StreamElementsStateEventCache::RemoveScope(const std::string &scopeField,
+						 const std::string &scope)
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+
+	std::vector<std::string> keys;
+
+	for (auto &kv : m_entries) {
+		if (kv.second.scopeField == scopeField &&
+		    kv.second.scope == scope)
+			keys.push_back(kv.first);
+	}
+
+	for (auto &key : keys)
+		Remove(key);
+
+	return keys.size();
+}
+
+void StreamElementsStateEventCache::Clear()
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+
+	m_entries.clear();
+	m_order.clear();
+	m_bytes = 0;
+}
+
+size_t StreamElementsStateEventCache::GetCount() const
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+
+	return m_entries.size();
+}
+
+size_t StreamElementsStateEventCache::GetBytes() const
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+
+	return m_bytes;
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//
+// The last payload of each state-style event, so that it can be replayed to
+// clients which connect after the event was dispatched.
+//
+// A browser which reconnects, or a dock which opens, used to call one API
+// after another for streaming and recording state, the active scene and
+// such, which the host had already broadcast as events: ten docks opening at
+// startup meant ten times the same serialization work.
+//
+// Events are designated with AddStateEvent(). Events of the same `group`
+// describe the same state, the way hostStreamingStarting, Started, Stopping
+// and Stopped do, and each one replaces the previous one of its group. When
+// `scopeField` is set, the state is kept per value of that field of the
+// payload, such as one per "outputId". Events dispatched to a single target
+// are kept for that target only.
+//
+// GetEntries() returns the entries a client of a target is to receive, in
+// the order they were dispatched. Payloads are kept as they were
+// dispatched, along with their event generation, and are not serialized
+// again.
+//
+// Memory is bounded by `maxEntries` and `maxBytes`: the entries which were
+// updated least recently are evicted first. RemoveScope() evicts the state
+// of something which is gone, such as a removed output, right away.
+//
+class StreamElementsStateEventCache {
+public:
+	static const size_t DEFAULT_MAX_ENTRIES = 256;
+	static const size_t DEFAULT_MAX_BYTES = 1024 * 1024;
+
+	struct Entry {
+		std::string source;
+		std::string target;
+		std::string event;
+		std::string json;
+		uint64_t generation = 0;
+	};
+
+public:
+	StreamElementsStateEventCache(size_t maxEntries = DEFAULT_MAX_ENTRIES,
+				      size_t maxBytes = DEFAULT_MAX_BYTES);
+	~StreamElementsStateEventCache();
+
+	void AddStateEvent(const std::string &event, const std::string &group,
+			   const std::string &scopeField = "");
+
+	// `target` is empty for events dispatched to all clients.
+	//
+	// Returns true if `event` is a state event and was kept.
+	bool Update(const std::string &source, const std::string &target,
+		    const std::string &event, const std::string &json,
+		    uint64_t generation);
+
+	// Entries for all clients and for clients of `target`, in the order
+	// they were dispatched.
+	std::vector<Entry> GetEntries(const std::string &target) const;
+
+	// Removes the entries of every state event scoped by `scopeField`
+	// whose scope is `scope`. Returns how many were removed.
+	size_t RemoveScope(const std::string &scopeField,
+			   const std::string &scope);
+
+	void Clear();
+
+	size_t GetCount() const;
+	size_t GetBytes() const;
+
+private:
+	struct StateEvent {
+		std::string group;
+		std::string scopeField;
+	};
+
+	struct CachedEntry {
+		Entry entry;
+		std::string scopeField;
+		std::string scope;
+		uint64_t sequence;
+	};
+
+	void Remove(const std::string &key);
+
+private:
+	mutable std::mutex m_mutex;
+
+	size_t m_maxEntries;
+	size_t m_maxBytes;
+	size_t m_bytes = 0;
+	uint64_t m_sequence = 0;
+
+	std::unordered_map<std::string, StateEvent> m_stateEvents;
+
+	// Group, scope and target to entry
+	std::unordered_map<std::string, CachedEntry> m_entries;
+	// Dispatch order to key in m_entries
+	std::map<uint64_t, std::string> m_order;
+};
@@ -0,0 +1,284 @@
+#include "StreamElementsSyntheticBandwidthEncoders.hpp"
+#include "StreamElementsSyntheticMediaPayload.hpp"
+
+#include <obs-module.h>
+#include <obs-avc.h>
+
+#include <algorithm>
+#include <memory>
+
+typedef StreamElementsSyntheticMediaPayload::Video synthetic_video_t;
+typedef StreamElementsSyntheticMediaPayload::Audio synthetic_audio_t;
+
+/* ================================================================= */
+
+struct synthetic_video_encoder {
+	obs_encoder_t *encoder = nullptr;
+
+	uint64_t bitsPerSecond = 0;
+	uint32_t keyframeIntervalSeconds = 2;
+
+	// Built once the encoder is attached to a video output.
+	std::unique_ptr<synthetic_video_t> payload;
+	uint32_t fpsDen = 1;
+};
+
+static void synthetic_video_update_settings(synthetic_video_encoder *context,
+					    obs_data_t *settings)
+{
+	context->bitsPerSecond =
+		(uint64_t)obs_data_get_int(settings, "bitrate") * 1000;
+	context->keyframeIntervalSeconds =
+		(uint32_t)obs_data_get_int(settings, "keyint_sec");
+
+	// 0 is "auto" for obs_x264
+	if (!context->keyframeIntervalSeconds)
+		context->keyframeIntervalSeconds = 2;
+
+	context->payload = nullptr;
+}
+
+static synthetic_video_t *
+synthetic_video_get_payload(synthetic_video_encoder *context)
+{
+	if (context->payload)
+		return context->payload.get();
+
+	video_t *video = obs_encoder_video(context->encoder);
+
+	if (!video)
+		return nullptr;
+
+	const struct video_output_info *info = video_output_get_info(video);
+
+	synthetic_video_t::Options options;
+
+	options.bitsPerSecond = context->bitsPerSecond;
+	options.fpsNum = info->fps_num;
+	options.fpsDen = info->fps_den;
+	options.keyframeIntervalFrames =
+		context->keyframeIntervalSeconds * info->fps_num /
+		std::max<uint32_t>(info->fps_den, 1);
+	options.width = obs_encoder_get_width(context->encoder);
+	options.height = obs_encoder_get_height(context->encoder);
+
+	context->payload = std::make_unique<synthetic_video_t>(options);
+	context->fpsDen = std::max<uint32_t>(info->fps_den, 1);
+
+	return context->payload.get();
+}
+
+static const char *synthetic_video_get_name(void *)
+{
+	return "SE.Live bandwidth test (synthetic H.264)";
+}
+
+static void *synthetic_video_create(obs_data_t *settings,
+				    obs_encoder_t *encoder)
+{
+	synthetic_video_encoder *context = new synthetic_video_encoder();
+
+	context->encoder = encoder;
+
+	synthetic_video_update_settings(context, settings);
+
+	return context;
+}
+
+static void synthetic_video_destroy(void *data)
+{
+	delete (synthetic_video_encoder *)data;
+}
+
+static bool synthetic_video_update(void *data, obs_data_t *settings)
+{
+	synthetic_video_update_settings((synthetic_video_encoder *)data,
+					settings);
+
+	return true;
+}
+
+static void synthetic_video_get_defaults(obs_data_t *settings)
+{
+	obs_data_set_default_int(settings, "bitrate", 2500);
+	obs_data_set_default_int(settings, "keyint_sec", 2);
+}
+
+static bool synthetic_video_encode(void *data, struct encoder_frame *frame,
+				   struct encoder_packet *packet,
+				   bool *received_packet)
+{
+	synthetic_video_encoder *context = (synthetic_video_encoder *)data;
+
+	synthetic_video_t *payload = synthetic_video_get_payload(context);
+
+	if (!payload)
+		return false;
+
+	// libobs advances video pts by fps_den per frame.
+	const int64_t index = frame->pts / context->fpsDen;
+
+	const uint8_t *buffer = nullptr;
+	size_t size = 0;
+	bool keyframe = false;
+
+	payload->GetPacket(index, buffer, size, keyframe);
+
+	packet->data = (uint8_t *)buffer;
+	packet->size = size;
+	packet->type = OBS_ENCODER_VIDEO;
+	packet->pts = frame->pts;
+	packet->dts = frame->pts;
+	packet->keyframe = keyframe;
+	packet->priority = keyframe ? OBS_NAL_PRIORITY_HIGHEST
+				    : OBS_NAL_PRIORITY_HIGH;
+	packet->drop_priority = packet->priority;
+
+	*received_packet = true;
+
+	return true;
+}
+
+static bool synthetic_video_get_extra_data(void *data, uint8_t **extra_data,
+					   size_t *size)
+{
+	synthetic_video_t *payload =
+		synthetic_video_get_payload((synthetic_video_encoder *)data);
+
+	if (!payload)
+		return false;
+
+	*extra_data = (uint8_t *)payload->GetHeader().data();
+	*size = payload->GetHeader().size();
+
+	return true;
+}
+
+/* ================================================================= */
+
+struct synthetic_audio_encoder {
+	std::unique_ptr<synthetic_audio_t> payload;
+};
+
+static const char *synthetic_audio_get_name(void *)
+{
+	return "SE.Live bandwidth test (synthetic AAC)";
+}
+
+static void *synthetic_audio_create(obs_data_t *settings,
+				    obs_encoder_t *encoder)
+{
+	audio_t *audio = obs_encoder_audio(encoder);
+
+	if (!audio)
+		return nullptr;
+
+	synthetic_audio_t::Options options;
+
+	options.bitsPerSecond =
+		(uint64_t)obs_data_get_int(settings, "bitrate") * 1000;
+	options.sampleRate = audio_output_get_sample_rate(audio);
+	options.channels = (uint32_t)audio_output_get_channels(audio);
+
+	synthetic_audio_encoder *context = new synthetic_audio_encoder();
+
+	context->payload = std::make_unique<synthetic_audio_t>(options);
+
+	return context;
+}
+
+static void synthetic_audio_destroy(void *data)
+{
+	delete (synthetic_audio_encoder *)data;
+}
+
+static void synthetic_audio_get_defaults(obs_data_t *settings)
+{
+	obs_data_set_default_int(settings, "bitrate", 128);
+}
+
+static bool synthetic_audio_encode(void *data, struct encoder_frame *frame,
+				   struct encoder_packet *packet,
+				   bool *received_packet)
+{
+	synthetic_audio_encoder *context = (synthetic_audio_encoder *)data;
+
+	// Audio pts is in samples.
+	const int64_t index = frame->pts / synthetic_audio_t::FRAME_SAMPLES;
+
+	const uint8_t *buffer = nullptr;
+	size_t size = 0;
+
+	context->payload->GetPacket(index, buffer, size);
+
+	packet->data = (uint8_t *)buffer;
+	packet->size = size;
+	packet->type = OBS_ENCODER_AUDIO;
+	packet->pts = frame->pts;
+	packet->dts = frame->pts;
+	packet->keyframe = true;
+
+	*received_packet = true;
+
+	return true;
+}
+
+static size_t synthetic_audio_get_frame_size(void *)
+{
+	return synthetic_audio_t::FRAME_SAMPLES;
+}
+
+static bool synthetic_audio_get_extra_data(void *data, uint8_t **extra_data,
+					   size_t *size)
+{
+	synthetic_audio_encoder *context = (synthetic_audio_encoder *)data;
+
+	*extra_data = (uint8_t *)context->payload->GetHeader().data();
+	*size = context->payload->GetHeader().size();
+
+	return true;
+}
+
+static void synthetic_audio_get_audio_info(void *,
+					   struct audio_convert_info *info)
+{
+	info->format = AUDIO_FORMAT_FLOAT_PLANAR;
+}
+
+/* ================================================================= */
+
+void RegisterSyntheticBandwidthEncoders()
+{
+	struct obs_encoder_info video = {};
+
+	video.id = SYNTHETIC_BANDWIDTH_VIDEO_ENCODER_ID;
+	video.type = OBS_ENCODER_VIDEO;
+	video.codec = "h264";
+	video.caps = OBS_ENCODER_CAP_INTERNAL;
+	video.get_name = synthetic_video_get_name;
+	video.create = synthetic_video_create;
+	video.destroy = synthetic_video_destroy;
+	video.update = synthetic_video_update;
+	video.get_defaults = synthetic_video_get_defaults;
+	video.encode = synthetic_video_encode;
+	video.get_extra_data = synthetic_video_get_extra_data;
+
+	obs_register_encoder(&video);
+
+	struct obs_encoder_info audio = {};
+
+	audio.id = SYNTHETIC_BANDWIDTH_AUDIO_ENCODER_ID;
+	audio.type = OBS_ENCODER_AUDIO;
+	audio.codec = "aac";
+	audio.caps = OBS_ENCODER_CAP_INTERNAL;
+	audio.get_name = synthetic_audio_get_name;
+	audio.create = synthetic_audio_create;
+	audio.destroy = synthetic_audio_destroy;
+	audio.get_defaults = synthetic_audio_get_defaults;
+	audio.encode = synthetic_audio_encode;
+	audio.get_frame_size = synthetic_audio_get_frame_size;
+	audio.get_extra_data = synthetic_audio_get_extra_data;
+	audio.get_audio_info = synthetic_audio_get_audio_info;
+
+	obs_register_encoder(&audio);
+}
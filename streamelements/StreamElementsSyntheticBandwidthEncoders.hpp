@@ -0,0 +1,19 @@
+#pragma once
+
+#include <obs.h>
+
+#define SYNTHETIC_BANDWIDTH_VIDEO_ENCODER_ID \
+	"streamelements_synthetic_bandwidth_h264"
+#define SYNTHETIC_BANDWIDTH_AUDIO_ENCODER_ID \
+	"streamelements_synthetic_bandwidth_aac"
+
+//
+// Internal H.264 and AAC "encoders" for bandwidth tests.
+//
+// They never look at the frames they are given: every frame is answered with
+// a pre-generated StreamElementsSyntheticMediaPayload packet sized to the
+// "bitrate" setting (kbps, as obs_x264 and ffmpeg_aac read it), so an output
+// driven by them sends exactly the requested rate, paced by the video and
+// audio clocks, at next to no CPU cost.
+//
+void RegisterSyntheticBandwidthEncoders();
@@ -0,0 +1,304 @@
+#include "StreamElementsSyntheticMediaPayload.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <random>
+
+// Start code and NAL unit header.
+static const size_t NAL_PREFIX_SIZE = 5;
+
+static const uint8_t NAL_IDR_SLICE = 0x65;
+static const uint8_t NAL_SLICE = 0x41;
+static const uint8_t NAL_SPS = 0x67;
+static const uint8_t NAL_PPS = 0x68;
+
+static const uint8_t H264_PROFILE_BASELINE = 66;
+static const uint8_t H264_LEVEL_4_1 = 41;
+
+static const uint32_t AAC_OBJECT_TYPE_LC = 2;
+
+/* ================================================================= */
+
+namespace {
+
+// Writes bit fields MSB first; for H.264, wraps them in a NAL unit.
+class BitWriter {
+public:
+	void Bits(uint32_t value, int count)
+	{
+		for (int i = count - 1; i >= 0; --i)
+			Bit((value >> i) & 1);
+	}
+
+	void Bit(uint32_t bit)
+	{
+		if (m_used == 0)
+			m_bytes.push_back(0);
+
+		if (bit)
+			m_bytes.back() |= (uint8_t)(0x80 >> m_used);
+
+		m_used = (m_used + 1) % 8;
+	}
+
+	// Exp-Golomb
+	void UE(uint32_t value)
+	{
+		const uint64_t coded = (uint64_t)value + 1;
+
+		int bits = 0;
+		while ((coded >> bits) > 1)
+			++bits;
+
+		Bits(0, bits);
+		Bits((uint32_t)coded, bits + 1);
+	}
+
+	void SE(int32_t value)
+	{
+		UE(value > 0 ? (uint32_t)(2 * value - 1)
+			     : (uint32_t)(-2 * (int64_t)value));
+	}
+
+	const std::vector<uint8_t> &GetBytes() const { return m_bytes; }
+
+	void AppendNal(uint8_t header, std::vector<uint8_t> &out)
+	{
+		// rbsp_trailing_bits
+		Bit(1);
+		while (m_used)
+			Bit(0);
+
+		const uint8_t startCode[] = {0, 0, 0, 1};
+		out.insert(out.end(), startCode, startCode + sizeof(startCode));
+		out.push_back(header);
+
+		// Emulation prevention
+		int zeros = 0;
+
+		for (uint8_t byte : m_bytes) {
+			if (zeros >= 2 && byte <= 3) {
+				out.push_back(3);
+				zeros = 0;
+			}
+
+			out.push_back(byte);
+			zeros = byte ? 0 : zeros + 1;
+		}
+	}
+
+private:
+	std::vector<uint8_t> m_bytes;
+	int m_used = 0;
+};
+
+}
+
+static std::vector<uint8_t> CreateFiller(size_t size, uint32_t seed)
+{
+	std::mt19937 random(seed);
+	std::uniform_int_distribution<int> distribution(1, 255);
+
+	std::vector<uint8_t> result(size);
+
+	for (auto &byte : result)
+		byte = (uint8_t)distribution(random);
+
+	return result;
+}
+
+/* ================================================================= */
+
+uint64_t StreamElementsSyntheticMediaPayload::GetScheduledBytes(
+	uint64_t bitsPerSecond, uint64_t timebaseNum, uint64_t timebaseDen,
+	int64_t count)
+{
+	if (count <= 0 || !timebaseDen)
+		return 0;
+
+	// floor(count * bitsPerSecond * num / (den * 8)), without overflow.
+	const uint64_t numerator = bitsPerSecond * timebaseNum;
+	const uint64_t denominator = timebaseDen * 8;
+	const uint64_t units = (uint64_t)count;
+
+	return (units / denominator) * numerator +
+	       ((units % denominator) * numerator) / denominator;
+}
+
+/* ================================================================= */
+
+StreamElementsSyntheticMediaPayload::Video::Video(Options options)
+	: m_options(options)
+{
+	m_options.fpsNum = std::max<uint32_t>(m_options.fpsNum, 1);
+	m_options.fpsDen = std::max<uint32_t>(m_options.fpsDen, 1);
+	m_options.keyframeIntervalFrames =
+		std::max<uint32_t>(m_options.keyframeIntervalFrames, 1);
+	m_options.width = std::max<uint32_t>(m_options.width, 16);
+	m_options.height = std::max<uint32_t>(m_options.height, 16);
+
+	// Sequence parameter set: progressive 4:2:0 baseline, cropped to the
+	// exact frame size.
+	{
+		const uint32_t widthMbs = (m_options.width + 15) / 16;
+		const uint32_t heightMbs = (m_options.height + 15) / 16;
+
+		const uint32_t cropRight = (widthMbs * 16 - m_options.width) / 2;
+		const uint32_t cropBottom =
+			(heightMbs * 16 - m_options.height) / 2;
+
+		BitWriter sps;
+
+		sps.Bits(H264_PROFILE_BASELINE, 8);
+		sps.Bits(0xC0, 8); // constraint_set0 and set1
+		sps.Bits(H264_LEVEL_4_1, 8);
+		sps.UE(0); // seq_parameter_set_id
+		sps.UE(0); // log2_max_frame_num_minus4
+		sps.UE(2); // pic_order_cnt_type
+		sps.UE(1); // max_num_ref_frames
+		sps.Bit(0); // gaps_in_frame_num_value_allowed_flag
+		sps.UE(widthMbs - 1);
+		sps.UE(heightMbs - 1);
+		sps.Bit(1); // frame_mbs_only_flag
+		sps.Bit(1); // direct_8x8_inference_flag
+
+		if (cropRight || cropBottom) {
+			sps.Bit(1);
+			sps.UE(0);
+			sps.UE(cropRight);
+			sps.UE(0);
+			sps.UE(cropBottom);
+		} else {
+			sps.Bit(0);
+		}
+
+		sps.Bit(0); // vui_parameters_present_flag
+
+		sps.AppendNal(NAL_SPS, m_header);
+	}
+
+	{
+		BitWriter pps;
+
+		pps.UE(0); // pic_parameter_set_id
+		pps.UE(0); // seq_parameter_set_id
+		pps.Bit(0); // entropy_coding_mode_flag
+		pps.Bit(0); // bottom_field_pic_order_in_frame_present_flag
+		pps.UE(0); // num_slice_groups_minus1
+		pps.UE(0); // num_ref_idx_l0_default_active_minus1
+		pps.UE(0); // num_ref_idx_l1_default_active_minus1
+		pps.Bit(0); // weighted_pred_flag
+		pps.Bits(0, 2); // weighted_bipred_idc
+		pps.SE(0); // pic_init_qp_minus26
+		pps.SE(0); // pic_init_qs_minus26
+		pps.SE(0); // chroma_qp_index_offset
+		pps.Bit(1); // deblocking_filter_control_present_flag
+		pps.Bit(0); // constrained_intra_pred_flag
+		pps.Bit(0); // redundant_pic_cnt_present_flag
+
+		pps.AppendNal(NAL_PPS, m_header);
+	}
+
+	// Largest packet the schedule can ask for.
+	const size_t maxSize =
+		(size_t)GetScheduledBytes(m_options.bitsPerSecond,
+					  m_options.fpsDen, m_options.fpsNum,
+					  1) +
+		1 + NAL_PREFIX_SIZE;
+
+	m_keyframe = CreateFiller(maxSize, 1);
+	m_frame = CreateFiller(maxSize, 2);
+
+	const uint8_t keyframePrefix[] = {0, 0, 0, 1, NAL_IDR_SLICE};
+	const uint8_t framePrefix[] = {0, 0, 0, 1, NAL_SLICE};
+
+	std::copy(keyframePrefix, keyframePrefix + NAL_PREFIX_SIZE,
+		  m_keyframe.begin());
+	std::copy(framePrefix, framePrefix + NAL_PREFIX_SIZE, m_frame.begin());
+}
+
+void StreamElementsSyntheticMediaPayload::Video::GetPacket(int64_t index,
+							    const uint8_t *&data,
+							    size_t &size,
+							    bool &keyframe) const
+{
+	index = std::max<int64_t>(index, 0);
+
+	const uint64_t scheduled =
+		GetScheduledBytes(m_options.bitsPerSecond, m_options.fpsDen,
+				  m_options.fpsNum, index + 1) -
+		GetScheduledBytes(m_options.bitsPerSecond, m_options.fpsDen,
+				  m_options.fpsNum, index);
+
+	keyframe = index % m_options.keyframeIntervalFrames == 0;
+
+	const std::vector<uint8_t> &packet = keyframe ? m_keyframe : m_frame;
+
+	size = std::min(std::max<size_t>((size_t)scheduled, NAL_PREFIX_SIZE + 1),
+			packet.size());
+	data = packet.data();
+}
+
+/* ================================================================= */
+
+StreamElementsSyntheticMediaPayload::Audio::Audio(Options options)
+	: m_options(options)
+{
+	m_options.sampleRate = std::max<uint32_t>(m_options.sampleRate, 1);
+	m_options.channels = std::max<uint32_t>(m_options.channels, 1);
+
+	static const uint32_t sampleRates[] = {96000, 88200, 64000, 48000,
+					       44100, 32000, 24000, 22050,
+					       16000, 12000, 11025, 8000,
+					       7350};
+
+	const uint32_t *found =
+		std::find(std::begin(sampleRates), std::end(sampleRates),
+			  m_options.sampleRate);
+
+	BitWriter config;
+
+	config.Bits(AAC_OBJECT_TYPE_LC, 5);
+
+	if (found != std::end(sampleRates)) {
+		config.Bits((uint32_t)(found - std::begin(sampleRates)), 4);
+	} else {
+		// Escape: explicit sample rate
+		config.Bits(15, 4);
+		config.Bits(m_options.sampleRate, 24);
+	}
+
+	// channelConfiguration: 1 to 6 channels as is, 7.1 is 7.
+	config.Bits(m_options.channels == 8
+			    ? 7
+			    : std::min<uint32_t>(m_options.channels, 6),
+		    4);
+	config.Bits(0, 3); // GASpecificConfig: 1024 samples, no extensions
+
+	// Byte aligned either way: 16 or 40 bits.
+	m_header = config.GetBytes();
+
+	m_frame = CreateFiller(
+		(size_t)GetScheduledBytes(m_options.bitsPerSecond,
+					  FRAME_SAMPLES, m_options.sampleRate,
+					  1) +
+			1,
+		3);
+}
+
+void StreamElementsSyntheticMediaPayload::Audio::GetPacket(int64_t index,
+							    const uint8_t *&data,
+							    size_t &size) const
+{
+	index = std::max<int64_t>(index, 0);
+
+	const uint64_t scheduled =
+		GetScheduledBytes(m_options.bitsPerSecond, FRAME_SAMPLES,
+				  m_options.sampleRate, index + 1) -
+		GetScheduledBytes(m_options.bitsPerSecond, FRAME_SAMPLES,
+				  m_options.sampleRate, index);
+
+	size = std::min(std::max<size_t>((size_t)scheduled, 1),
+			m_frame.size());
+	data = m_frame.data();
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+//
+// Pre-generated H.264 and AAC packets for encoder-free bandwidth tests.
+//
+// A bandwidth test only needs bytes on the wire at a known rate, yet it used
+// to run real x264 and AAC encoders fed by the live video pipeline: costly
+// while the user is already live, and the bitrate actually produced depended
+// on scene complexity. The synthetic payload produces well formed packets
+// (Annex-B H.264 with valid SPS/PPS headers, raw AAC frames with a matching
+// AudioSpecificConfig) whose content is never decoded, sized so that the
+// total after any number of frames is exactly what the target bitrate
+// allows: the stream is paced by the frame clock alone.
+//
+// Packet content is generated once; GetPacket() only picks a length. Payload
+// bytes are never zero, so no start code can appear inside a NAL unit.
+//
+class StreamElementsSyntheticMediaPayload {
+public:
+	// Bytes the first `count` units may carry at `bitsPerSecond`, where a
+	// unit lasts `timebaseNum / timebaseDen` seconds.
+	static uint64_t GetScheduledBytes(uint64_t bitsPerSecond,
+					  uint64_t timebaseNum,
+					  uint64_t timebaseDen, int64_t count);
+
+	class Video {
+	public:
+		struct Options {
+			uint64_t bitsPerSecond = 2500000;
+
+			uint32_t fpsNum = 30;
+			uint32_t fpsDen = 1;
+
+			uint32_t keyframeIntervalFrames = 60;
+
+			uint32_t width = 1280;
+			uint32_t height = 720;
+		};
+
+	public:
+		Video(Options options);
+
+		// Annex-B SPS and PPS, as encoders report their extra data.
+		const std::vector<uint8_t> &GetHeader() const
+		{
+			return m_header;
+		}
+
+		// Packet of frame `index`, valid for the lifetime of this
+		// object.
+		void GetPacket(int64_t index, const uint8_t *&data,
+			       size_t &size, bool &keyframe) const;
+
+	private:
+		Options m_options;
+
+		std::vector<uint8_t> m_header;
+		std::vector<uint8_t> m_keyframe;
+		std::vector<uint8_t> m_frame;
+	};
+
+	class Audio {
+	public:
+		static const uint32_t FRAME_SAMPLES = 1024;
+
+		struct Options {
+			uint64_t bitsPerSecond = 128000;
+
+			uint32_t sampleRate = 48000;
+			uint32_t channels = 2;
+		};
+
+	public:
+		Audio(Options options);
+
+		// AAC-LC AudioSpecificConfig.
+		const std::vector<uint8_t> &GetHeader() const
+		{
+			return m_header;
+		}
+
+		// Packet of frame `index` (FRAME_SAMPLES samples each), valid
+		// for the lifetime of this object.
+		void GetPacket(int64_t index, const uint8_t *&data,
+			       size_t &size) const;
+
+	private:
+		Options m_options;
+
+		std::vector<uint8_t> m_header;
+		std::vector<uint8_t> m_frame;
+	};
+};
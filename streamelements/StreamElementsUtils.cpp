@@ -6,6 +6,7 @@
 #include "StreamElementsGlobalStateManager.hpp"
 #include "StreamElementsRemoteIconLoader.hpp"
 #include "StreamElementsPleaseWaitWindow.hpp"
+#include "StreamElementsLogRing.hpp"
 #include "Version.hpp"
 #include "wide-string.hpp"
 #include "deps/utf8.h"
@@ -237,6 +238,10 @@ std::shared_ptr<StreamElementsApiContextItem> PushApiContext(CefString method, C
 
 	s_apiContext.push_back(item);
 
+	StreamElementsLogRing::GetInstance()->Append(
+		StreamElementsLogRing::Category::ApiCall,
+		method.ToString().c_str());
+
 	return item;
 }
 
@@ -245,6 +250,11 @@ void RemoveApiContext(std::shared_ptr<StreamElementsApiContextItem> item)
 	std::unique_lock lock(s_apiContextMutex);
 
 	s_apiContext.remove(item);
+
+	if (item)
+		StreamElementsLogRing::GetInstance()->Append(
+			StreamElementsLogRing::Category::ApiReturn,
+			item->method.ToString().c_str());
 }
 
 /* ========================================================= */
@@ -3347,75 +3357,6 @@ bool DeserializeAndInvokeAction(CefRefPtr<CefValue> input,
 	}
 }
 
-void ObsSceneEnumAllItems(obs_scene_t *scene,
-			  std::function<bool(obs_sceneitem_t *)> func)
-{
-	struct local_context {
-		std::vector<obs_sceneitem_t *> items;
-	};
-
-	local_context pass1_context;
-
-	obs_scene_enum_items(
-		scene,
-		[](obs_scene_t *scene, obs_sceneitem_t *sceneitem,
-		   void *param) {
-			local_context *context = (local_context *)param;
-
-			obs_sceneitem_addref(SETRACE_ADDREF(sceneitem));
-
-			context->items.push_back(sceneitem);
-
-			return true;
-		},
-		&pass1_context);
-
-	local_context pass2_context;
-
-	for (auto item : pass1_context.items) {
-		pass2_context.items.push_back(item);
-
-		if (obs_sceneitem_is_group(item)) {
-			obs_sceneitem_group_enum_items(
-				item,
-				[](obs_scene_t *scene,
-				   obs_sceneitem_t *sceneitem, void *param) {
-					local_context *context =
-						(local_context *)param;
-
-					obs_sceneitem_addref(SETRACE_ADDREF(sceneitem));
-
-					context->items.push_back(sceneitem);
-
-					return true;
-				},
-				&pass2_context);
-		}
-	}
-
-	bool keepCalling = true;
-
-	for (auto item : pass2_context.items) {
-		if (keepCalling) {
-			keepCalling = func(item);
-		}
-
-		obs_sceneitem_release(SETRACE_DECREF(item));
-	}
-}
-
-void ObsSceneEnumAllItems(obs_source_t *source,
-			  std::function<bool(obs_sceneitem_t *)> func)
-{
-	if (!source)
-		return;
-
-	obs_scene_t *scene =
-		obs_scene_from_source(source); // does not increment refcount
-
-	ObsSceneEnumAllItems(scene, func);
-}
-
 void ObsCurrentSceneEnumAllItems(std::function<bool(obs_sceneitem_t *)> func)
 {
 	obs_source_t *sceneSource =
@@ -3684,6 +3625,20 @@ void DispatchJSEventGlobal(std::string event, std::string eventArgsJson)
 	apiServer->DispatchJSEvent("system", event, eventArgsJson);
 }
 
+void RemoveStateEventScopeGlobal(std::string scopeField, std::string scope)
+{
+	if (!StreamElementsGlobalStateManager::IsInstanceAvailable())
+		return;
+
+	auto apiServer = StreamElementsGlobalStateManager::GetInstance()
+				 ->GetWebsocketApiServer();
+
+	if (!apiServer)
+		return;
+
+	apiServer->RemoveStateEventScope(scopeField, scope);
+}
+
 void DispatchJSEventContainer(std::string target, std::string event, std::string eventArgsJson)
 {
 	if (!StreamElementsGlobalStateManager::IsInstanceAvailable())
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "SETrace.hpp"
+#include "canvas-scan.hpp"
+#include "StreamElementsUtilsBase.hpp"
 
 #include <cef-headers.hpp>
 #include <obs.h>
@@ -495,11 +497,27 @@ QWidget *DeserializeRemoteIconWidget(CefRefPtr<CefValue> input,
 
 /* ========================================================= */
 
-void ObsSceneEnumAllItems(obs_scene_t *scene,
-			  std::function<bool(obs_sceneitem_t *)> func);
+// func: bool(obs_sceneitem_t *sceneitem)
+//
+// Calls func for each item of the scene and the items of its groups, outside
+// the scene's lock; see StreamElementsSceneTraversal.
+template<typename TFunc>
+static inline void ObsSceneEnumAllItems(obs_scene_t *scene, TFunc &&func)
+{
+	ObsSceneTraversal::ForEachItem(scene, func);
+}
 
-void ObsSceneEnumAllItems(obs_source_t *source,
-			  std::function<bool(obs_sceneitem_t *)> func);
+template<typename TFunc>
+static inline void ObsSceneEnumAllItems(obs_source_t *source, TFunc &&func)
+{
+	if (!source)
+		return;
+
+	obs_scene_t *scene =
+		obs_scene_from_source(source); // does not increment refcount
+
+	ObsSceneEnumAllItems(scene, func);
+}
 
 void ObsCurrentSceneEnumAllItems(std::function<bool(obs_sceneitem_t *)> func);
 
@@ -534,6 +552,10 @@ void DispatchJSEventContainer(std::string target, std::string event,
 
 void DispatchJSEventGlobal(std::string event, std::string eventArgsJson);
 
+// Drops the state events kept for replay about something which was removed,
+// such as an output by its "outputId".
+void RemoveStateEventScopeGlobal(std::string scopeField, std::string scope);
+
 /* ========================================================= */
 
 bool SecureJoinPaths(std::string base, std::string subpath,
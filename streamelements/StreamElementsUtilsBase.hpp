@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+
+//
+// The part of StreamElementsUtils which needs neither libobs, Qt nor CEF, so
+// the classes under tests/ can share it. StreamElementsUtils.hpp includes it.
+//
+
+/* ========================================================= */
+
+// The smallest power of two which is not less than `value`.
+inline size_t RoundUpToPowerOfTwo(size_t value)
+{
+	size_t result = 1;
+
+	while (result < value)
+		result <<= 1;
+
+	return result;
+}
+
+// The part of `path` after its last '/' or '\\'.
+inline const char *GetFileName(const char *path)
+{
+	const char *result = path;
+
+	for (const char *p = path; *p; ++p) {
+		if (*p == '/' || *p == '\\')
+			result = p + 1;
+	}
+
+	return result;
+}
@@ -0,0 +1,241 @@
+#include "StreamElementsVersionedList.hpp"
+
+#include <atomic>
+
+static std::atomic<uint64_t> s_nextVersion(1);
+
+static std::string get_item_id(const json11::Json &item)
+{
+	if (!item.is_object())
+		return "";
+
+	auto &id = item["id"];
+
+	if (!id.is_string())
+		return "";
+
+	return id.string_value();
+}
+
+// Items without an id, and repeats of an id, are left out.
+static void collect_items(const json11::Json &items,
+			  json11::Json::array &result,
+			  std::vector<std::string> &ids,
+			  std::unordered_map<std::string, size_t> &index)
+{
+	auto add = [&](const json11::Json &item) {
+		auto id = get_item_id(item);
+
+		if (id.empty() || !index.emplace(id, ids.size()).second)
+			return;
+
+		result.push_back(item);
+		ids.push_back(id);
+	};
+
+	if (items.is_array()) {
+		for (auto &item : items.array_items())
+			add(item);
+	} else if (items.is_object()) {
+		for (auto &kv : items.object_items())
+			add(kv.second);
+	}
+}
+
+/* ========================================================================= */
+
+StreamElementsVersionedList::StreamElementsVersionedList()
+	: m_version(s_nextVersion++)
+{
+}
+
+StreamElementsVersionedList::~StreamElementsVersionedList() {}
+
+json11::Json StreamElementsVersionedList::Update(const std::string &itemsJson)
+{
+	std::string error;
+
+	auto items = json11::Json::parse(itemsJson, error);
+
+	if (!error.empty())
+		return json11::Json();
+
+	return Update(items);
+}
+
+json11::Json StreamElementsVersionedList::Update(const json11::Json &items)
+{
+	json11::Json::array newItems;
+	std::vector<std::string> newIds;
+	std::unordered_map<std::string, size_t> newIndex;
+
+	collect_items(items, newItems, newIds, newIndex);
+
+	std::lock_guard<std::mutex> guard(m_mutex);
+
+	json11::Json::array added;
+	json11::Json::array removed;
+	json11::Json::array changed;
+
+	// Where applying the rest of the delta leaves the items
+	std::vector<std::string> appliedOrder;
+	appliedOrder.reserve(newIds.size());
+
+	for (auto &oldItem : m_items) {
+		auto id = get_item_id(oldItem);
+
+		if (!newIndex.count(id)) {
+			removed.push_back(id);
+			continue;
+		}
+
+		appliedOrder.push_back(id);
+
+		auto &oldFields = oldItem.object_items();
+		auto &newFields = newItems[newIndex[id]].object_items();
+
+		json11::Json::object fields;
+		json11::Json::array removedFields;
+
+		for (auto &kv : newFields) {
+			auto it = oldFields.find(kv.first);
+
+			if (it == oldFields.end() || it->second != kv.second)
+				fields[kv.first] = kv.second;
+		}
+
+		for (auto &kv : oldFields) {
+			if (!newFields.count(kv.first))
+				removedFields.push_back(kv.first);
+		}
+
+		if (fields.empty() && removedFields.empty())
+			continue;
+
+		json11::Json::object change{{"id", id}, {"fields", fields}};
+
+		if (!removedFields.empty())
+			change["removedFields"] = removedFields;
+
+		changed.push_back(change);
+	}
+
+	for (size_t i = 0; i < newIds.size(); ++i) {
+		if (m_index.count(newIds[i]))
+			continue;
+
+		added.push_back(newItems[i]);
+		appliedOrder.push_back(newIds[i]);
+	}
+
+	const bool reordered = appliedOrder != newIds;
+
+	if (added.empty() && removed.empty() && changed.empty() && !reordered)
+		return json11::Json();
+
+	const uint64_t baseVersion = m_version;
+
+	m_version = s_nextVersion++;
+	m_items.swap(newItems);
+	m_index.swap(newIndex);
+
+	json11::Json::object delta{{"baseVersion", (double)baseVersion},
+				   {"version", (double)m_version},
+				   {"added", added},
+				   {"removed", removed},
+				   {"changed", changed}};
+
+	if (reordered)
+		delta["order"] = json11::Json::array(newIds.begin(),
+						     newIds.end());
+
+	return delta;
+}
+
+json11::Json StreamElementsVersionedList::GetSnapshot() const
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+
+	return json11::Json::object{{"version", (double)m_version},
+				    {"items", m_items}};
+}
+
+uint64_t StreamElementsVersionedList::GetVersion() const
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+
+	return m_version;
+}
+
+bool StreamElementsVersionedList::Apply(json11::Json &snapshot,
+					const json11::Json &delta)
+{
+	if (!snapshot["version"].is_number() ||
+	    snapshot["version"].number_value() !=
+		    delta["baseVersion"].number_value())
+		return false;
+
+	std::vector<std::string> order;
+	std::unordered_map<std::string, json11::Json::object> items;
+
+	for (auto &item : snapshot["items"].array_items()) {
+		auto id = get_item_id(item);
+
+		order.push_back(id);
+		items[id] = item.object_items();
+	}
+
+	for (auto &id : delta["removed"].array_items())
+		items.erase(id.string_value());
+
+	for (auto &change : delta["changed"].array_items()) {
+		auto it = items.find(change["id"].string_value());
+
+		if (it == items.end())
+			return false;
+
+		for (auto &kv : change["fields"].object_items())
+			it->second[kv.first] = kv.second;
+
+		for (auto &field : change["removedFields"].array_items())
+			it->second.erase(field.string_value());
+	}
+
+	std::vector<std::string> appliedOrder;
+
+	for (auto &id : order) {
+		if (items.count(id))
+			appliedOrder.push_back(id);
+	}
+
+	for (auto &item : delta["added"].array_items()) {
+		auto id = get_item_id(item);
+
+		items[id] = item.object_items();
+		appliedOrder.push_back(id);
+	}
+
+	if (delta["order"].is_array()) {
+		appliedOrder.clear();
+
+		for (auto &id : delta["order"].array_items())
+			appliedOrder.push_back(id.string_value());
+	}
+
+	json11::Json::array result;
+	result.reserve(appliedOrder.size());
+
+	for (auto &id : appliedOrder) {
+		auto it = items.find(id);
+
+		if (it == items.end())
+			return false;
+
+		result.push_back(it->second);
+	}
+
+	snapshot = json11::Json::object{{"version", delta["version"]},
+					{"items", result}};
+
+	return true;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "json11/json11.hpp"
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//
+// A list of JSON objects identified by their "id" field, which carries a
+// version and turns each change of its contents into a delta.
+//
+// List change events used to carry no list, and every client then fetched
+// the whole list again and diffed it itself: for a 300 item scene, some
+// 300 KB per client for a change of a single item.
+//
+// Update() takes the current serialization of the list and, when it differs
+// from the previous one, moves to a new version and returns the delta:
+//
+//	{
+//		"baseVersion": 17,
+//		"version": 18,
+//		"added": [ { ...whole item... } ],
+//		"removed": [ "<id>" ],
+//		"changed": [ {
+//			"id": "<id>",
+//			"fields": { ...changed and new fields... },
+//			"removedFields": [ "<field>" ]
+//		} ],
+//		"order": [ "<id>" ]
+//	}
+//
+// Applying a delta removes the removed items, patches the changed ones and
+// appends the added ones. "order" is only present when the result of that is
+// not in the list's order. Fields are compared at the top level: a nested
+// value which changed is sent whole.
+//
+// A delta only applies to the list at exactly its "baseVersion". A client
+// which receives one for any other version missed a delta, and fetches
+// GetSnapshot() again.
+//
+// Versions are drawn from one process-wide counter. They increase on every
+// list, and a list created for a new scene never reuses the versions of a
+// destroyed one.
+//
+class StreamElementsVersionedList {
+public:
+	StreamElementsVersionedList();
+	~StreamElementsVersionedList();
+
+	// `items` is either an array of objects, or an object whose values are
+	// the objects, as the output and composition lists are serialized.
+	// Objects without a string "id" are left out.
+	//
+	// Returns the delta, or null if nothing changed.
+	json11::Json Update(const json11::Json &items);
+	json11::Json Update(const std::string &itemsJson);
+
+	// { "version": <version>, "items": [ ... ] }
+	json11::Json GetSnapshot() const;
+
+	uint64_t GetVersion() const;
+
+	// What a client does with a delta. Returns false and leaves `snapshot`
+	// alone if the delta does not apply to the snapshot's version.
+	static bool Apply(json11::Json &snapshot, const json11::Json &delta);
+
+private:
+	mutable std::mutex m_mutex;
+
+	uint64_t m_version;
+
+	json11::Json::array m_items;
+	std::unordered_map<std::string, size_t> m_index;
+};
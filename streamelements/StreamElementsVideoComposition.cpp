@@ -8,6 +8,7 @@
 #include "StreamElementsObsSceneManager.hpp"
 #include "StreamElementsMessageBus.hpp"
 #include "StreamElementsGlobalStateManager.hpp"
+#include "StreamElementsNameIndex.hpp"
 
 #include "audio-wrapper-source.h"
 
@@ -148,9 +149,24 @@ dispatch_scene_changed_event(StreamElementsVideoCompositionBase *self,
 	dispatch_external_event(name, args);
 }
 
+static void invalidate_composition_scene_index()
+{
+	if (!StreamElementsGlobalStateManager::IsInstanceAvailable())
+		return;
+
+	auto videoCompositionManager =
+		StreamElementsGlobalStateManager::GetInstance()
+			->GetVideoCompositionManager();
+
+	if (videoCompositionManager)
+		videoCompositionManager->InvalidateSceneIndex();
+}
+
 static void
 dispatch_scene_list_changed_event(StreamElementsVideoCompositionBase *self)
 {
+	invalidate_composition_scene_index();
+
 	json11::Json json = json11::Json::object{
 		{"videoCompositionId", self->GetId()},
 	};
@@ -165,6 +181,8 @@ dispatch_scene_list_changed_event(StreamElementsVideoCompositionBase *self)
 static void
 dispatch_scenes_reset_begin_event(StreamElementsVideoCompositionBase *self)
 {
+	invalidate_composition_scene_index();
+
 	json11::Json json = json11::Json::object{
 		{"videoCompositionId", self->GetId()},
 	};
@@ -506,82 +524,20 @@ void StreamElementsVideoCompositionBase::SetName(std::string name)
 	dispatch_external_event("hostVideoCompositionChanged", json);
 }
 
-static std::string GetUniqueSceneNameInternal(std::string name, StreamElementsVideoCompositionBase::scenes_t& scenes)
-{
-	std::string result(name);
-
-	auto hasSceneName = [&](std::string name) -> bool {
-		for (auto it = scenes.cbegin(); it != scenes.cend(); ++it) {
-			if (strcasecmp(name.c_str(),
-				    obs_source_get_name(
-					    obs_scene_get_source(*it))) == 0)
-				return true;
-		}
-
-		return false;
-	};
-
-	int sequence = 0;
-	bool isUnique = false;
-
-	while (!isUnique) {
-		isUnique = true;
-
-		if (hasSceneName(result)) {
-			isUnique = false;
-		}
-
-		if (!isUnique) {
-			++sequence;
-
-			char buf[32];
-			sprintf(buf, "%d", sequence);
-			result = name + " ";
-			result += buf;
-		}
-	}
-
-	return result;
-}
-
 static std::string
 GetUniqueSceneNameInternal(std::string name,
 			   std::vector<obs_scene_t*> &scenes)
 {
-	std::string result(name);
-
-	auto hasSceneName = [&](std::string name) -> bool {
-		for (auto it = scenes.cbegin(); it != scenes.cend(); ++it) {
-			if (strcasecmp(name.c_str(),
-				    obs_source_get_name(
-					    obs_scene_get_source(*it))) == 0)
-				return true;
-		}
-
-		return false;
-	};
-
-	int sequence = 0;
-	bool isUnique = false;
-
-	while (!isUnique) {
-		isUnique = true;
-
-		if (hasSceneName(result)) {
-			isUnique = false;
-		}
+	// Index the names once rather than scanning every scene per candidate.
+	StreamElementsNameIndex index;
 
-		if (!isUnique) {
-			++sequence;
+	for (auto scene : scenes) {
+		auto source = obs_scene_get_source(scene);
 
-			char buf[32];
-			sprintf(buf, "%d", sequence);
-			result = name + " ";
-			result += buf;
-		}
+		index.Set(source, obs_source_get_name(source));
 	}
 
-	return result;
+	return index.GetUniqueName(name);
 }
 
 std::string
@@ -651,18 +607,26 @@ obs_sceneitem_t *StreamElementsVideoCompositionBase::GetSceneItemById(
 	obs_sceneitem_t *result = nullptr;
 
 	for (auto it = scenes.cbegin(); it != scenes.cend(); ++it) {
-		ObsSceneEnumAllItems(*it,
-				     [&](obs_sceneitem_t *sceneitem) -> bool {
-					     if (searchPtr == sceneitem) {
-						     result = sceneitem;
+		// Only compares pointers: scan under the scene's lock, and
+		// take the reference before the lock is released
+		scanSceneItems(
+			*it,
+			[&](obs_sceneitem_t *sceneitem,
+			    obs_sceneitem_t * /*parent*/) -> bool {
+				if (searchPtr == sceneitem) {
+					result = sceneitem;
 
-						     /* Found what we're looking for, stop iteration */
-						     return false;
-					     }
+					if (addRef)
+						obs_sceneitem_addref(
+							SETRACE_ADDREF(result));
 
-					     /* Continue or stop iteration */
-					     return !result;
-				     });
+					/* Found what we're looking for, stop iteration */
+					return false;
+				}
+
+				return true;
+			},
+			true);
 
 		if (result) {
 			if (result_scene) {
@@ -673,10 +637,6 @@ obs_sceneitem_t *StreamElementsVideoCompositionBase::GetSceneItemById(
 		}
 	}
 
-	if (result && addRef) {
-		obs_sceneitem_addref(SETRACE_ADDREF(result));
-	}
-
 	return result;
 }
 
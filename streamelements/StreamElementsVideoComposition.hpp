@@ -6,6 +6,7 @@
 #include "cef-headers.hpp"
 
 #include "StreamElementsUtils.hpp"
+#include "StreamElementsAsyncLog.hpp"
 #include "StreamElementsScenesListWidgetManager.hpp"
 
 #include <shared_mutex>
@@ -158,10 +159,10 @@ private:
 				str += buf;
 			}
 
-			blog(LOG_ERROR,
-			     "[obs-streamelements-core]: videoComposition('%s').addRef('%s'); refcount: %ld; ref holders: %s",
-			     m_id.c_str(), holder.c_str(), m_refCounter,
-			     str.c_str());
+			SE_LOG(LOG_ERROR,
+			       "[obs-streamelements-core]: videoComposition('%s').addRef('%s'); refcount: %ld; ref holders: %s",
+			       m_id.c_str(), holder.c_str(), m_refCounter,
+			       str.c_str());
 		}
 	}
 
@@ -196,10 +197,10 @@ private:
 				str += buf;
 			}
 
-			blog(LOG_ERROR,
-			     "[obs-streamelements-core]: videoComposition('%s').removeRef('%s'); remaining refs: %ld; ref holders: %s",
-			     m_id.c_str(), holder.c_str(), m_refCounter,
-			     str.c_str());
+			SE_LOG(LOG_ERROR,
+			       "[obs-streamelements-core]: videoComposition('%s').removeRef('%s'); remaining refs: %ld; ref holders: %s",
+			       m_id.c_str(), holder.c_str(), m_refCounter,
+			       str.c_str());
 		}
 	}
 
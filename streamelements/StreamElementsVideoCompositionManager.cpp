@@ -41,10 +41,14 @@ StreamElementsVideoCompositionManager::StreamElementsVideoCompositionManager()
 	m_nativeVideoComposition = StreamElementsObsNativeVideoComposition::Create();
 
 	m_videoCompositionsMap[m_nativeVideoComposition->GetId()] = m_nativeVideoComposition;
+
+	obs_frontend_add_event_callback(handle_obs_frontend_event, this);
 }
 
 StreamElementsVideoCompositionManager::~StreamElementsVideoCompositionManager()
 {
+	obs_frontend_remove_event_callback(handle_obs_frontend_event, this);
+
 	//Reset();
 
 	m_videoCompositionsMap.clear();
@@ -65,8 +69,45 @@ void StreamElementsVideoCompositionManager::Reset()
 		m_videoCompositionsMap.erase(key);
 	}
 
+	m_sceneIndex.Invalidate();
+
 	dispatch_js_event("hostVideoCompositionListChanged", "null");
 	dispatch_external_event("hostVideoCompositionListChanged", "null");
+
+	PublishCompositionListDeltaInternal();
+}
+
+void StreamElementsVideoCompositionManager::handle_obs_frontend_event(
+	enum obs_frontend_event event, void *data)
+{
+	auto self = static_cast<StreamElementsVideoCompositionManager *>(data);
+
+	switch (event) {
+	// The native compositions list OBS's own scenes
+	case OBS_FRONTEND_EVENT_SCENE_LIST_CHANGED:
+	case OBS_FRONTEND_EVENT_SCENE_COLLECTION_CHANGED:
+	case OBS_FRONTEND_EVENT_SCENE_COLLECTION_CLEANUP:
+		self->InvalidateSceneIndex();
+		break;
+	default:
+		break;
+	}
+}
+
+void StreamElementsVideoCompositionManager::CollectSceneIndexEntries(
+	StreamElementsCompositionSceneIndex::entries_t &entries)
+{
+	for (auto kv : m_videoCompositionsMap) {
+		StreamElementsVideoCompositionBase::scenes_t scenes;
+		kv.second->GetAllScenes(scenes);
+
+		// Scenes are looked up by either pointer
+		for (auto scene : scenes) {
+			entries.emplace_back(scene, kv.first);
+			entries.emplace_back(obs_scene_get_source(scene),
+					     kv.first);
+		}
+	}
 }
 
 void StreamElementsVideoCompositionManager::
@@ -181,11 +222,15 @@ void StreamElementsVideoCompositionManager::DeserializeComposition(
 
 		m_videoCompositionsMap[id] = composition;
 
+		m_sceneIndex.Invalidate();
+
 		composition->SerializeComposition(output);
 
 		dispatch_js_event("hostVideoCompositionListChanged", "null");
 		dispatch_external_event("hostVideoCompositionListChanged",
 					"null");
+
+		PublishCompositionListDeltaInternal();
 	} catch (...) {
 		// Creation failed
 		return;
@@ -197,6 +242,45 @@ void StreamElementsVideoCompositionManager::SerializeAllCompositions(
 {
 	std::shared_lock<decltype(m_mutex)> lock(m_mutex);
 
+	SerializeAllCompositionsInternal(output);
+}
+
+void StreamElementsVideoCompositionManager::SerializeAllCompositionsSnapshot(
+	CefRefPtr<CefValue> &output)
+{
+	std::shared_lock<decltype(m_mutex)> lock(m_mutex);
+
+	// Composition changes announced by hostVideoCompositionChanged are not
+	// published as they happen: publish them first, so clients holding an
+	// older version do not miss them.
+	PublishCompositionListDeltaInternal();
+
+	auto snapshot = CefParseJSON(m_versionedList.GetSnapshot().dump(),
+				     JSON_PARSER_ALLOW_TRAILING_COMMAS);
+
+	output->SetDictionary(snapshot->GetDictionary());
+}
+
+void StreamElementsVideoCompositionManager::PublishCompositionListDeltaInternal()
+{
+	auto list = CefValue::Create();
+	SerializeAllCompositionsInternal(list);
+
+	auto delta = m_versionedList.Update(
+		CefWriteJSON(list, JSON_WRITER_DEFAULT).ToString());
+
+	if (delta.is_null())
+		return;
+
+	std::string json = delta.dump();
+
+	dispatch_js_event("hostVideoCompositionListDelta", json);
+	dispatch_external_event("hostVideoCompositionListDelta", json);
+}
+
+void StreamElementsVideoCompositionManager::SerializeAllCompositionsInternal(
+	CefRefPtr<CefValue> &output)
+{
 	CefRefPtr<CefDictionaryValue> d = CefDictionaryValue::Create();
 
 	for (auto kv : m_videoCompositionsMap) {
@@ -246,11 +330,17 @@ void StreamElementsVideoCompositionManager::RemoveCompositionsByIds(
 	// Remove all valid IDs
 	for (auto kv : map) {
 		m_videoCompositionsMap.erase(kv.first);
+
+		RemoveStateEventScopeGlobal("videoCompositionId", kv.first);
 	}
 
+	m_sceneIndex.Invalidate();
+
 	dispatch_js_event("hostVideoCompositionListChanged", "null");
 	dispatch_external_event("hostVideoCompositionListChanged", "null");
 
+	PublishCompositionListDeltaInternal();
+
 	output->SetBool(true);
 }
 
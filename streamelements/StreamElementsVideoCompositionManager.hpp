@@ -1,6 +1,9 @@
 #pragma once
 
 #include "StreamElementsVideoComposition.hpp"
+#include "StreamElementsCompositionSceneIndex.hpp"
+#include "StreamElementsNameIndex.hpp"
+#include "StreamElementsVersionedList.hpp"
 #include <shared_mutex>
 #include <string>
 #include <map>
@@ -15,10 +18,68 @@ private:
 	std::map<std::string, CefRefPtr<CefDictionaryValue>>
 		m_availableEncoderClassesCache;
 
+	StreamElementsCompositionSceneIndex m_sceneIndex;
+
+	// Versioned serialization of m_videoCompositionsMap, behind the
+	// hostVideoCompositionListDelta event.
+	StreamElementsVersionedList m_versionedList;
+
 public:
 	StreamElementsVideoCompositionManager();
 	~StreamElementsVideoCompositionManager();
 
+private:
+	static void handle_obs_frontend_event(enum obs_frontend_event event,
+					      void *data);
+
+	// Call with m_mutex held.
+	void SerializeAllCompositionsInternal(CefRefPtr<CefValue> &output);
+
+	// Call with m_mutex held. Dispatches what changed in the list since
+	// its last version, if anything did.
+	void PublishCompositionListDeltaInternal();
+
+	// Call with m_mutex held.
+	void CollectSceneIndexEntries(
+		StreamElementsCompositionSceneIndex::entries_t &entries);
+
+	// Call with m_mutex held.
+	std::shared_ptr<StreamElementsVideoCompositionBase>
+	GetVideoCompositionBySceneKeyInternal(const void *key)
+	{
+		if (!key)
+			return nullptr;
+
+		auto id = m_sceneIndex.Find(
+			key,
+			[this](StreamElementsCompositionSceneIndex::entries_t
+				       &entries) {
+				CollectSceneIndexEntries(entries);
+			});
+
+		auto it = m_videoCompositionsMap.find(id);
+
+		if (it == m_videoCompositionsMap.end())
+			return nullptr;
+
+		return it->second;
+	}
+
+	// Call with m_mutex held. What HasSceneId() and HasSceneName() make of
+	// an empty id or name: the first composition.
+	std::shared_ptr<StreamElementsVideoCompositionBase>
+	GetFirstVideoCompositionInternal()
+	{
+		if (m_videoCompositionsMap.empty())
+			return nullptr;
+
+		return m_videoCompositionsMap.begin()->second;
+	}
+
+public:
+	// Call when a composition's scene list changes.
+	void InvalidateSceneIndex() { m_sceneIndex.Invalidate(); }
+
 public:
 	void
 	DeserializeExistingCompositionProperties(CefRefPtr<CefValue> input,
@@ -26,6 +87,7 @@ public:
 	void DeserializeComposition(CefRefPtr<CefValue> input,
 				    CefRefPtr<CefValue> &output);
 	void SerializeAllCompositions(CefRefPtr<CefValue> &output);
+	void SerializeAllCompositionsSnapshot(CefRefPtr<CefValue> &output);
 	void RemoveCompositionsByIds(
 		CefRefPtr<CefValue> input, CefRefPtr<CefValue> &output);
 
@@ -85,12 +147,7 @@ public:
 	{
 		std::shared_lock<decltype(m_mutex)> lock(m_mutex);
 
-		for (auto kv : m_videoCompositionsMap) {
-			if (kv.second->HasScene(lookupScene))
-				return kv.second;
-		}
-
-		return nullptr;
+		return GetVideoCompositionBySceneKeyInternal(lookupScene);
 	}
 
 	std::shared_ptr<StreamElementsVideoCompositionBase>
@@ -98,22 +155,34 @@ public:
 	{
 		std::shared_lock<decltype(m_mutex)> lock(m_mutex);
 
-		for (auto kv : m_videoCompositionsMap) {
-			if (kv.second->HasSceneId(lookupId))
-				return kv.second;
-		}
+		if (!lookupId.size())
+			return GetFirstVideoCompositionInternal();
 
-		return nullptr;
+		// Either the scene or its source
+		return GetVideoCompositionBySceneKeyInternal(
+			GetPointerFromId(lookupId.c_str()));
 	}
 
 	std::shared_ptr<StreamElementsVideoCompositionBase>
 	GetVideoCompositionBySceneName(std::string lookupName)
 	{
+		if (!lookupName.size()) {
+			std::shared_lock<decltype(m_mutex)> lock(m_mutex);
+
+			return GetFirstVideoCompositionInternal();
+		}
+
+		// Sources holding the name, some of which may be scenes
+		auto owners = StreamElementsNameIndex::GetInstance()->GetOwners(
+			lookupName);
+
 		std::shared_lock<decltype(m_mutex)> lock(m_mutex);
 
-		for (auto kv : m_videoCompositionsMap) {
-			if (kv.second->HasSceneName(lookupName))
-				return kv.second;
+		for (auto owner : owners) {
+			auto result = GetVideoCompositionBySceneKeyInternal(owner);
+
+			if (result)
+				return result;
 		}
 
 		return nullptr;
@@ -164,10 +233,46 @@ public:
 		return nullptr;
 	}
 
+	// Unlike GetVideoCompositionBySceneItemId(), takes an item which is
+	// known to be valid.
+	std::shared_ptr<StreamElementsVideoCompositionBase>
+	GetVideoCompositionBySceneItem(obs_sceneitem_t *sceneitem,
+				       obs_scene_t **result_scene)
+	{
+		if (!sceneitem)
+			return nullptr;
+
+		obs_scene_t *parent = obs_sceneitem_get_scene(sceneitem);
+
+		if (!parent)
+			return nullptr;
+
+		// The scene a group is in can not be reached from the items in
+		// it: walk the compositions.
+		if (obs_source_is_group(obs_scene_get_source(parent)))
+			return GetVideoCompositionBySceneItemId(
+				GetIdFromPointer(sceneitem), result_scene);
+
+		std::shared_lock<decltype(m_mutex)> lock(m_mutex);
+
+		auto result = GetVideoCompositionBySceneKeyInternal(parent);
+
+		if (result && result_scene)
+			*result_scene = parent;
+
+		return result;
+	}
+
 	std::shared_ptr<StreamElementsVideoCompositionBase>
 	GetVideoCompositionBySceneItemName(std::string lookupSceneItemName,
 					   obs_scene_t **result_scene)
 	{
+		// Items are named by their sources: a name no source holds is
+		// in no scene.
+		if (!StreamElementsNameIndex::GetInstance()->Contains(
+			    lookupSceneItemName))
+			return nullptr;
+
 		std::shared_lock<decltype(m_mutex)> lock(m_mutex);
 
 		for (auto kv : m_videoCompositionsMap) {
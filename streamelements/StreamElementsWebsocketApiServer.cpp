@@ -5,14 +5,13 @@
 #include <asio/ts/buffer.hpp>
 #include <asio/ts/internet.hpp>
 
-std::shared_ptr<StreamElementsWebsocketApiServer::ClientInfo>
-StreamElementsWebsocketApiServer::AddConnection(std::string target,
-	std::string unique_id,
-	connection_hdl_t con_hdl)
+void StreamElementsWebsocketApiServer::AddConnection(
+	std::shared_ptr<ClientInfo> clientInfo)
 {
 	std::unique_lock<decltype(m_mutex)> guard(m_mutex);
 
-	auto clientInfo = std::make_shared<ClientInfo>(target, unique_id, con_hdl);
+	const std::string &target = clientInfo->m_target;
+	const connection_hdl_t &con_hdl = clientInfo->m_con_hdl;
 
 	m_connection_map[con_hdl] = clientInfo;
 
@@ -22,8 +21,6 @@ StreamElementsWebsocketApiServer::AddConnection(std::string target,
 
 	m_target_to_connection_hdl_map[target]->m_con_hdl_map[con_hdl] =
 		clientInfo;
-
-	return clientInfo;
 }
 
 void StreamElementsWebsocketApiServer::RemoveConnection(
@@ -53,12 +50,29 @@ void StreamElementsWebsocketApiServer::RemoveConnection(
 }
 
 
-StreamElementsWebsocketApiServer::StreamElementsWebsocketApiServer()
+// Tasks of a connection run in order on the task pool.
+static const void *get_connection_key(
+	StreamElementsWebsocketApiServer::connection_hdl_t con_hdl)
+{
+	return con_hdl.lock().get();
+}
+
+StreamElementsWebsocketApiServer::StreamElementsWebsocketApiServer(
+	size_t ioThreadCount, size_t workerCount)
+	: m_taskPool(workerCount)
 {
 	// Set logging settings
-	m_endpoint.set_error_channels(websocketpp::log::elevel::all);
-	m_endpoint.set_access_channels(websocketpp::log::alevel::all ^
-				       websocketpp::log::alevel::frame_payload);
+	//
+	// websocketpp writes its log synchronously on the io thread; frame
+	// headers and control frames alone meant a line per message. Keep
+	// connection lifecycle and real errors only.
+	m_endpoint.set_error_channels(websocketpp::log::elevel::warn |
+				      websocketpp::log::elevel::rerror |
+				      websocketpp::log::elevel::fatal);
+	m_endpoint.clear_access_channels(websocketpp::log::alevel::all);
+	m_endpoint.set_access_channels(websocketpp::log::alevel::connect |
+				       websocketpp::log::alevel::disconnect |
+				       websocketpp::log::alevel::fail);
 
 	m_endpoint.init_asio();
 
@@ -74,22 +88,27 @@ StreamElementsWebsocketApiServer::StreamElementsWebsocketApiServer()
 		});
 	*/
 
+	// After the messages received before it
 	m_endpoint.set_close_handler(
 		[this](websocketpp::connection_hdl con_hdl) {
-			// Disconnect
-			RemoveConnection(con_hdl);
+			m_taskPool.Post(get_connection_key(con_hdl),
+					[this, con_hdl]() {
+						// Disconnect
+						RemoveConnection(con_hdl);
+					});
 		});
 
+	// Network threads only do framing: parsing and handling happen on the
+	// task pool.
 	m_endpoint.set_message_handler(
 		[this](websocketpp::connection_hdl con_hdl,
 		       std::shared_ptr<message_t> msg) {
-			auto connection = m_endpoint.get_con_from_hdl(con_hdl);
-
-			std::string msgData = msg->get_payload();
-
-			ParseIncomingMessage(con_hdl, msgData);
-
-			//connection->send(msgData + " - test");
+			m_taskPool.Post(get_connection_key(con_hdl),
+					[this, con_hdl, msg]() {
+						ParseIncomingMessage(
+							con_hdl,
+							msg->get_payload());
+					});
 		});
 
 	websocketpp::lib::error_code ec;
@@ -113,13 +132,22 @@ StreamElementsWebsocketApiServer::StreamElementsWebsocketApiServer()
 
 	m_endpoint.start_accept();
 
-	m_thread = std::thread([this]() { m_endpoint.run(); });
+	if (!ioThreadCount)
+		ioThreadCount = DEFAULT_IO_THREAD_COUNT;
+
+	for (size_t i = 0; i < ioThreadCount; ++i)
+		m_threads.emplace_back([this]() { m_endpoint.run(); });
 }
 
 StreamElementsWebsocketApiServer::~StreamElementsWebsocketApiServer()
 {
+	// Handlers which are running may still send
+	m_taskPool.Stop();
+
 	m_endpoint.stop();
-	m_thread.join();
+
+	for (auto &thread : m_threads)
+		thread.join();
 }
 
 void StreamElementsWebsocketApiServer::ParseIncomingMessage(
@@ -168,7 +196,31 @@ void StreamElementsWebsocketApiServer::ParseIncomingRegisterMessage(
 			return;
 	}
 
-	auto clientInfo = AddConnection(id, unique_id, con_hdl);
+	// Cached state events are only replayed to clients which ask: others
+	// would take them for live changes.
+	const bool replayStateEvents =
+		payload->GetType("replayStateEvents") == VTYPE_BOOL &&
+		payload->GetBool("replayStateEvents");
+
+	auto clientInfo = std::make_shared<ClientInfo>(id, unique_id, con_hdl);
+
+	// Events dispatched once the client is added wait for this
+	std::lock_guard<decltype(clientInfo->m_send_mutex)> sendGuard(
+		clientInfo->m_send_mutex);
+
+	std::vector<StreamElementsStateEventCache::Entry> entries;
+
+	{
+		std::lock_guard<decltype(m_state_events_mutex)> stateGuard(
+			m_state_events_mutex);
+
+		AddConnection(clientInfo);
+
+		clientInfo->m_registered_generation = m_eventGeneration;
+
+		if (replayStateEvents)
+			entries = m_stateEventCache.GetEntries(id);
+	}
 
 	auto response = CefValue::Create();
 	auto responseDict = CefDictionaryValue::Create();
@@ -177,6 +229,17 @@ void StreamElementsWebsocketApiServer::ParseIncomingRegisterMessage(
 	response->SetDictionary(responseDict);
 
 	DispatchClientMessage("system", clientInfo, "register:response", response);
+
+	for (auto &entry : entries) {
+		auto msg = CefProcessMessage::Create("DispatchJSEvent");
+		CefRefPtr<CefListValue> args = msg->GetArgumentList();
+
+		args->SetString(0, entry.event);
+		args->SetString(1, entry.json);
+		args->SetDouble(2, (double)entry.generation);
+
+		DispatchClientMessage(entry.source, clientInfo, msg);
+	}
 }
 
 bool StreamElementsWebsocketApiServer::DispatchClientMessage(
@@ -262,12 +325,20 @@ bool StreamElementsWebsocketApiServer::UnregisterMessageHandler(
 void StreamElementsWebsocketApiServer::ParseIncomingDispatchMessage(
 	connection_hdl_t con_hdl, CefRefPtr<CefDictionaryValue> root)
 {
-	// Check if msg target registered
-	if (!m_connection_map.count(con_hdl))
-		return;
+	std::shared_ptr<ClientInfo> clientInfo;
 
-	// Get msg source from connection
-	auto clientInfo = m_connection_map[con_hdl];
+	{
+		std::shared_lock<decltype(m_mutex)> guard(m_mutex);
+
+		// Check if msg target registered
+		auto it = m_connection_map.find(con_hdl);
+
+		if (it == m_connection_map.end())
+			return;
+
+		// Get msg source from connection
+		clientInfo = it->second;
+	}
 
 	if (root->GetType("payload") != VTYPE_DICTIONARY)
 		return;
@@ -292,10 +363,12 @@ void StreamElementsWebsocketApiServer::ParseIncomingDispatchMessage(
 		lock(m_dispatch_handlers_map_mutex);
 
 	// Check if handlers are registered
-	if (!m_dispatch_handlers_map.count(clientInfo->m_target))
+	auto handler = m_dispatch_handlers_map.find(clientInfo->m_target);
+
+	if (handler == m_dispatch_handlers_map.end())
 		return;
 
-	m_dispatch_handlers_map[clientInfo->m_target](clientInfo, msg);
+	handler->second(clientInfo, msg);
 }
 
 bool StreamElementsWebsocketApiServer::DispatchJSEvent(std::string source, std::shared_ptr<ClientInfo> clientInfo,
@@ -307,6 +380,7 @@ bool StreamElementsWebsocketApiServer::DispatchJSEvent(std::string source, std::
 
 	args->SetString(0, event);
 	args->SetString(1, json);
+	args->SetDouble(2, (double)++m_eventGeneration);
 
 	return DispatchClientMessage(source, clientInfo, msg);
 }
@@ -317,8 +391,20 @@ bool StreamElementsWebsocketApiServer::DispatchJSEvent(std::string source, std::
 	auto msg = CefProcessMessage::Create("DispatchJSEvent");
 	CefRefPtr<CefListValue> args = msg->GetArgumentList();
 
+	uint64_t generation;
+
+	{
+		std::lock_guard<decltype(m_state_events_mutex)> stateGuard(
+			m_state_events_mutex);
+
+		generation = ++m_eventGeneration;
+
+		m_stateEventCache.Update(source, "", event, json, generation);
+	}
+
 	args->SetString(0, event);
 	args->SetString(1, json);
+	args->SetDouble(2, (double)generation);
 
 	std::vector<std::shared_ptr<ClientInfo>> targets;
 
@@ -331,7 +417,8 @@ bool StreamElementsWebsocketApiServer::DispatchJSEvent(std::string source, std::
 	}
 
 	for (auto target : targets) {
-		DispatchClientMessage(source, target, msg);
+		DispatchStateOrderedClientMessage(source, target, msg,
+						  generation);
 	}
 
 	return true;
@@ -345,8 +432,21 @@ bool StreamElementsWebsocketApiServer::DispatchTargetJSEvent(std::string source,
 	auto msg = CefProcessMessage::Create("DispatchJSEvent");
 	CefRefPtr<CefListValue> args = msg->GetArgumentList();
 
+	uint64_t generation;
+
+	{
+		std::lock_guard<decltype(m_state_events_mutex)> stateGuard(
+			m_state_events_mutex);
+
+		generation = ++m_eventGeneration;
+
+		m_stateEventCache.Update(source, target, event, json,
+					 generation);
+	}
+
 	args->SetString(0, event);
 	args->SetString(1, json);
+	args->SetDouble(2, (double)generation);
 
 	std::vector<std::shared_ptr<ClientInfo>> targets;
 
@@ -363,12 +463,28 @@ bool StreamElementsWebsocketApiServer::DispatchTargetJSEvent(std::string source,
 	}
 
 	for (auto target : targets) {
-		DispatchClientMessage(source, target, msg);
+		DispatchStateOrderedClientMessage(source, target, msg,
+						  generation);
 	}
 
 	return true;
 }
 
+bool StreamElementsWebsocketApiServer::DispatchStateOrderedClientMessage(
+	std::string source, std::shared_ptr<ClientInfo> clientInfo,
+	CefRefPtr<CefProcessMessage> msg, uint64_t generation)
+{
+	std::lock_guard<decltype(clientInfo->m_send_mutex)> sendGuard(
+		clientInfo->m_send_mutex);
+
+	// Dispatched before the client registered: either in its replay, or
+	// not meant for it.
+	if (generation <= clientInfo->m_registered_generation)
+		return false;
+
+	return DispatchClientMessage(source, clientInfo, msg);
+}
+
 bool StreamElementsWebsocketApiServer::DispatchTargetClientMessage(
 	std::string source, std::string target,
 	CefRefPtr<CefProcessMessage> msg)
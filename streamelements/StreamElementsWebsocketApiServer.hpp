@@ -5,6 +5,7 @@
 #include <websocketpp/server.hpp>
 #include <websocketpp/config/asio_no_tls.hpp>
 
+#include <atomic>
 #include <functional>
 #include <thread>
 #include <string>
@@ -16,6 +17,8 @@
 #include <shared_mutex>
 
 #include "cef-headers.hpp"
+#include "StreamElementsStateEventCache.hpp"
+#include "StreamElementsOrderedTaskPool.hpp"
 
 class StreamElementsWebsocketApiServer {
 public:
@@ -25,6 +28,16 @@ public:
 		std::string m_unique_id;
 		websocketpp::connection_hdl m_con_hdl;
 
+		// Held while the client is sent its register:response and its
+		// replayed state events, and while events dispatched to all
+		// clients or to its target are sent to it, so that none of
+		// them precede its replay.
+		std::mutex m_send_mutex;
+		// The last event generation at registration. Events up to it
+		// were dispatched before the client registered and are not
+		// sent to it.
+		uint64_t m_registered_generation = 0;
+
 		ClientInfo(std::string target, std::string unique_id,
 			websocketpp::connection_hdl con_hdl =
 				StreamElementsWebsocketApiServer::connection_hdl_t(
@@ -66,11 +79,40 @@ public:
 		message_handler_t;
 
 public:
-	StreamElementsWebsocketApiServer();
+	static const size_t DEFAULT_IO_THREAD_COUNT = 2;
+
+public:
+	// Connections are served by `ioThreadCount` network threads, each
+	// connection on its own strand, and incoming messages are parsed and
+	// handled by `workerCount` workers, in order per connection. 0 picks
+	// the defaults.
+	StreamElementsWebsocketApiServer(size_t ioThreadCount = 0,
+					 size_t workerCount = 0);
 	~StreamElementsWebsocketApiServer();
 
 	uint16_t GetPort() const { return m_port; }
 
+	// The generation of the last event dispatched. Each event carries its
+	// generation as its third argument, so that clients holding a snapshot
+	// tagged with a generation can tell which events follow it.
+	uint64_t GetEventGeneration() const { return m_eventGeneration; }
+
+	// Keeps the last `event` dispatched to all clients or to a target, and
+	// replays it to clients which register with "replayStateEvents": true.
+	// See StreamElementsStateEventCache.
+	void AddStateEvent(std::string event, std::string group,
+			   std::string scopeField = "")
+	{
+		m_stateEventCache.AddStateEvent(event, group, scopeField);
+	}
+
+	// Forgets the state kept for something which was removed, such as an
+	// output by its "outputId".
+	void RemoveStateEventScope(std::string scopeField, std::string scope)
+	{
+		m_stateEventCache.RemoveScope(scopeField, scope);
+	}
+
 	bool DispatchJSEvent(std::string source,
 			     std::shared_ptr<ClientInfo> clientInfo,
 			     std::string event, std::string json);
@@ -99,18 +141,33 @@ private:
 	void ParseIncomingDispatchMessage(connection_hdl_t con_hdl,
 					  CefRefPtr<CefDictionaryValue> root);
 
-	std::shared_ptr<ClientInfo> AddConnection(std::string target,
-						  std::string unique_id,
-						  connection_hdl_t con_hdl);
+	void AddConnection(std::shared_ptr<ClientInfo> clientInfo);
 	void RemoveConnection(connection_hdl_t con_hdl);
 
+	// Sends an event of `generation` dispatched to all clients or to a
+	// target, once `clientInfo` has received its replay.
+	bool DispatchStateOrderedClientMessage(
+		std::string source, std::shared_ptr<ClientInfo> clientInfo,
+		CefRefPtr<CefProcessMessage> msg, uint64_t generation);
+
 private:
 	std::shared_mutex m_mutex;
 	std::shared_mutex m_dispatch_handlers_map_mutex;
 
 	uint16_t m_port = 27952;
+	std::atomic<uint64_t> m_eventGeneration = {0};
+
+	// Held while an event dispatched to all clients or to a target takes
+	// its generation and updates the cache, and while a registering
+	// client is added and takes its registered generation and replay.
+	// Never held while sending: see ClientInfo::m_send_mutex.
+	std::mutex m_state_events_mutex;
+	StreamElementsStateEventCache m_stateEventCache;
+
 	server_t m_endpoint;
-	std::thread m_thread;
+	std::vector<std::thread> m_threads;
+
+	StreamElementsOrderedTaskPool m_taskPool;
 
 	std::map<connection_hdl_t, std::shared_ptr<ClientInfo>, std::owner_less<connection_hdl_t>>
 		m_connection_map;
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+//
+// A point-in-time snapshot of several state sections (compositions, scenes,
+// scene items, outputs...) tagged with the event generation it reflects.
+//
+// Clients rebuilt their state from 10-30 separate API calls, and whatever
+// changed between the calls left them with an inconsistent picture and no
+// way to tell which events they had already seen.
+//
+// Capture() reads the event generation, serializes every requested section
+// and reads the generation again. If events were dispatched meanwhile, it
+// starts over, up to `maxAttempts` times. The result is:
+//
+//	{
+//		"generation": 1234,
+//		"consistent": true,
+//		"<section>": ...,
+//		...
+//	}
+//
+// Every event dispatched with a generation greater than "generation" may
+// not be reflected in the snapshot, and is to be applied on top of it.
+// Events up to "generation" are. "consistent" is false if events kept
+// arriving during every attempt: the snapshot may then already reflect some
+// of the events which follow it, which carry whole objects and may safely
+// be applied again.
+//
+// The request selects sections and, per section, fields:
+//
+//	{
+//		"sections": [ "<section>", ... ],
+//		"fields": { "<section>": [ "<field>", ... ] }
+//	}
+//
+// Both are optional: all sections, all fields. Field selection applies to
+// every object with an "id" in the section, however deeply nested, and
+// always keeps "id".
+//
+// Sections which serialize the same state (scene items are listed per scene
+// of every composition, say) share it through the attempt callback, which
+// runs before the sections of every attempt: state cached by one section is
+// then never carried over into the next attempt.
+//
+// TTraits is the value type the sections are serialized to, e.g. CefValue:
+//
+//	typedef ... value_t;
+//
+//	static value_t Bool(bool value);
+//	static value_t Number(double value);
+//	static value_t Array(const std::vector<value_t> &items);
+//	static value_t Object(const std::map<std::string, value_t> &items);
+//
+//	static bool IsString(const value_t &value);
+//	static std::string GetString(const value_t &value);
+//	static bool IsArray(const value_t &value);
+//	static bool IsObject(const value_t &value);
+//	// Member `key` of an object, or a null value
+//	static value_t Get(const value_t &value, const std::string &key);
+//
+//	// Neither calls `func` for a value of another type.
+//	// func: void(const value_t &item)
+//	template<typename TFunc>
+//	static void ForEachArrayItem(const value_t &value, TFunc &&func);
+//	// func: void(const std::string &key, const value_t &item)
+//	template<typename TFunc>
+//	static void ForEachObjectItem(const value_t &value, TFunc &&func);
+//
+template<typename TTraits> class StreamElementsWorkspaceSnapshot {
+public:
+	typedef typename TTraits::value_t value_t;
+
+	typedef std::function<value_t()> serializer_t;
+	typedef std::function<uint64_t()> generation_source_t;
+	typedef std::function<void()> attempt_callback_t;
+
+	static const int DEFAULT_MAX_ATTEMPTS = 3;
+
+public:
+	StreamElementsWorkspaceSnapshot(generation_source_t generationSource)
+		: m_generationSource(generationSource)
+	{
+	}
+
+	~StreamElementsWorkspaceSnapshot() {}
+
+	void AddSection(const std::string &name, serializer_t serializer)
+	{
+		m_sections.push_back({name, serializer});
+	}
+
+	// Called at the start of every attempt, before its sections.
+	void SetAttemptCallback(attempt_callback_t callback)
+	{
+		m_attemptCallback = callback;
+	}
+
+	value_t Capture(const value_t &request,
+			int maxAttempts = DEFAULT_MAX_ATTEMPTS) const
+	{
+		const bool allSections =
+			!TTraits::IsArray(TTraits::Get(request, "sections"));
+		const auto sections =
+			GetStrings(TTraits::Get(request, "sections"));
+
+		std::map<std::string, value_t> result;
+
+		uint64_t generation = 0;
+		bool consistent = false;
+
+		for (int attempt = 0; attempt < maxAttempts && !consistent;
+		     ++attempt) {
+			result.clear();
+
+			generation = m_generationSource();
+
+			if (m_attemptCallback)
+				m_attemptCallback();
+
+			for (auto &section : m_sections) {
+				if (!allSections &&
+				    !sections.count(section.first))
+					continue;
+
+				result[section.first] = section.second();
+			}
+
+			consistent = m_generationSource() == generation;
+		}
+
+		// Selected after capturing, to keep the window between the two
+		// generation reads short
+		TTraits::ForEachObjectItem(
+			TTraits::Get(request, "fields"),
+			[&](const std::string &key, const value_t &fields) {
+				if (!TTraits::IsArray(fields) ||
+				    !result.count(key))
+					return;
+
+				result[key] = SelectFields(result[key],
+							   GetStrings(fields));
+			});
+
+		result["generation"] = TTraits::Number((double)generation);
+		result["consistent"] = TTraits::Bool(consistent);
+
+		return TTraits::Object(result);
+	}
+
+	// `value` with every object which has an "id" reduced to `fields` and
+	// "id".
+	static value_t SelectFields(const value_t &value,
+				    const std::set<std::string> &fields)
+	{
+		if (TTraits::IsArray(value)) {
+			std::vector<value_t> result;
+
+			TTraits::ForEachArrayItem(value, [&](const value_t &item) {
+				result.push_back(SelectFields(item, fields));
+			});
+
+			return TTraits::Array(result);
+		}
+
+		if (!TTraits::IsObject(value))
+			return value;
+
+		const bool isRecord =
+			TTraits::IsString(TTraits::Get(value, "id"));
+
+		std::map<std::string, value_t> result;
+
+		TTraits::ForEachObjectItem(
+			value, [&](const std::string &key, const value_t &item) {
+				if (isRecord && key != "id" && !fields.count(key))
+					return;
+
+				result[key] = SelectFields(item, fields);
+			});
+
+		return TTraits::Object(result);
+	}
+
+private:
+	static std::set<std::string> GetStrings(const value_t &list)
+	{
+		std::set<std::string> result;
+
+		TTraits::ForEachArrayItem(list, [&](const value_t &item) {
+			if (TTraits::IsString(item))
+				result.insert(TTraits::GetString(item));
+		});
+
+		return result;
+	}
+
+private:
+	generation_source_t m_generationSource;
+	attempt_callback_t m_attemptCallback;
+
+	std::vector<std::pair<std::string, serializer_t>> m_sections;
+};
@@ -2,86 +2,64 @@
 
 #include <obs.h>
 
-static inline bool
-scanGroupSceneItems(obs_sceneitem_t *group,
-		    std::function<bool(obs_sceneitem_t * /*item*/,
-				       obs_sceneitem_t * /*parent*/)>
-			    callback,
-		    bool recursive)
-{
-	struct data_t {
-		std::function<bool(obs_sceneitem_t * /*item*/,
-				   obs_sceneitem_t * /*parent*/)>
-			callback;
-		bool recursive;
-		obs_sceneitem_t *group;
-		bool result;
-	};
-
-	data_t data = {};
-	data.callback = callback;
-	data.recursive = recursive;
-	data.group = group;
-	data.result = true;
-
-	obs_sceneitem_group_enum_items(
-		group,
-		[](obs_scene_t *scene, obs_sceneitem_t *item, void *data_p) {
-			auto data = (data_t *)data_p;
-
-			if (data->recursive && obs_sceneitem_is_group(item)) {
-				data->result = scanGroupSceneItems(
-					item, data->callback, data->recursive);
-			}
-
-			if (data->result)
-				data->result =
-					data->callback(item, data->group);
+#include "SETrace.hpp"
+#include "StreamElementsSceneTraversal.hpp"
 
-			return data->result;
-		},
-		&data);
+struct ObsSceneTraversalApi {
+	typedef obs_scene_t scene_t;
+	typedef obs_sceneitem_t item_t;
 
-	return data.result;
-}
+	static void enum_items(obs_scene_t *scene,
+			       bool (*callback)(obs_scene_t *,
+						obs_sceneitem_t *, void *),
+			       void *param)
+	{
+		obs_scene_enum_items(scene, callback, param);
+	}
 
-static inline bool
-scanSceneItems(obs_scene_t *scene,
-	       std::function<bool(obs_sceneitem_t * /*item*/,
-				  obs_sceneitem_t * /*parent*/)>
-		       callback,
-	       bool recursive)
-{
-	struct data_t {
-		std::function<bool(obs_sceneitem_t * /*item*/,
-				   obs_sceneitem_t * /*parent*/)>
-			callback;
-		bool recursive;
-		bool result;
-	};
+	static void group_enum_items(obs_sceneitem_t *group,
+				     bool (*callback)(obs_scene_t *,
+						      obs_sceneitem_t *,
+						      void *),
+				     void *param)
+	{
+		obs_sceneitem_group_enum_items(group, callback, param);
+	}
 
-	data_t data = {};
-	data.callback = callback;
-	data.recursive = recursive;
-	data.result = true;
+	static bool is_group(obs_sceneitem_t *item)
+	{
+		return obs_sceneitem_is_group(item);
+	}
 
-	obs_scene_enum_items(
-		scene,
-		[](obs_scene_t * /* scene */, obs_sceneitem_t *item,
-		   void *data_p) -> bool {
-			auto data = (data_t *)data_p;
+	static void addref(obs_sceneitem_t *item)
+	{
+		obs_sceneitem_addref(SETRACE_ADDREF(item));
+	}
 
-			if (data->recursive && obs_sceneitem_is_group(item)) {
-				data->result = scanGroupSceneItems(
-					item, data->callback, data->recursive);
-			}
+	static void release(obs_sceneitem_t *item)
+	{
+		obs_sceneitem_release(SETRACE_DECREF(item));
+	}
+};
 
-			if (data->result)
-				data->result = data->callback(item, nullptr);
+typedef StreamElementsSceneTraversal<ObsSceneTraversalApi> ObsSceneTraversal;
 
-			return data->result;
-		},
-		&data);
+// callback: bool(obs_sceneitem_t *item, obs_sceneitem_t *parent)
+//
+// Called under the group's lock; see StreamElementsSceneTraversal.
+template<typename TCallback>
+static inline bool scanGroupSceneItems(obs_sceneitem_t *group,
+				       TCallback &&callback, bool recursive)
+{
+	return ObsSceneTraversal::ScanGroup(group, callback, recursive);
+}
 
-	return data.result;
+// callback: bool(obs_sceneitem_t *item, obs_sceneitem_t *parent)
+//
+// Called under the scene's lock; see StreamElementsSceneTraversal.
+template<typename TCallback>
+static inline bool scanSceneItems(obs_scene_t *scene, TCallback &&callback,
+				  bool recursive)
+{
+	return ObsSceneTraversal::ScanScene(scene, callback, recursive);
 }
@@ -1,9 +1,14 @@
 #include "HttpServer.hpp"
 
-#include <QApplication>
-
-HttpServer::HttpServer(request_handler_t requestHandler) : m_requestHandler(requestHandler)
+HttpServer::HttpServer(request_handler_t requestHandler, size_t threadCount)
+	: m_requestHandler(requestHandler)
 {
+	if (threadCount > 0) {
+		m_server.new_task_queue = [threadCount]() {
+			return new httplib::ThreadPool(threadCount);
+		};
+	}
+
 	auto reqHandler = [this](const httplib::Request& req,
 				 httplib::Response& res) -> void {
 		if (req.has_header("Origin")) {
@@ -39,8 +44,15 @@ void HttpServer::Stop()
 
 	m_running = false;
 
-	if (m_server.is_running()) {
-		m_server.stop();
+	if (m_thread.joinable()) {
+		// stop() has no effect until the listening thread has entered
+		// its loop, which a server stopped right after Start() may
+		// not have done yet.
+		while (!m_server.is_running() && !m_listenerExited)
+			std::this_thread::yield();
+
+		if (m_server.is_running())
+			m_server.stop();
 
 		m_thread.join();
 	}
@@ -74,6 +86,7 @@ int HttpServer::Start(int bindToPort /*= 0*/,
 	m_ipAddress = bindToIpAddress;
 
 	m_running = true;
+	m_listenerExited = false;
 
 	m_thread = std::thread([this]() {
 		//m_server.set_read_timeout(0, 0);
@@ -85,6 +98,7 @@ int HttpServer::Start(int bindToPort /*= 0*/,
 		m_server.listen_after_bind();
 
 		m_running = false;
+		m_listenerExited = true;
 	});
 
 	return port;
@@ -4,6 +4,7 @@
 #include <mutex>
 #include <thread>
 #include <functional>
+#include <atomic>
 
 #include "../cpp-httplib/httplib.h"
 
@@ -15,7 +16,9 @@ public:
 	typedef std::function<void(const request_t &, response_t &)> request_handler_t;
 
 public:
-	HttpServer(request_handler_t requestHandler);
+	// `threadCount` sizes the pool of threads serving requests; 0 keeps
+	// httplib's default.
+	HttpServer(request_handler_t requestHandler, size_t threadCount = 0);
 	~HttpServer();
 
 	int Start(int bindToPort = 0,
@@ -29,6 +32,7 @@ private:
 	std::recursive_mutex m_mutex;
 	std::thread m_thread;
 	bool m_running = false;
+	std::atomic<bool> m_listenerExited{false};
 
 	request_handler_t m_requestHandler;
 
@@ -568,6 +568,98 @@ int zip_entry_write(struct zip_t *zip, const void *buf, size_t bufsize) {
 	return 0;
 }
 
+int zip_set_level(struct zip_t *zip, int level) {
+	if (!zip) {
+		// zip_t handler is not initialized
+		return -1;
+	}
+
+	if (level < 0)
+		level = MZ_DEFAULT_LEVEL;
+	if ((level & 0xF) > MZ_UBER_COMPRESSION) {
+		// Wrong compression level
+		return -1;
+	}
+
+	zip->level = (zip->level & ~0xF) | (level & 0xF);
+
+	return 0;
+}
+
+int zip_entry_write_deflated(struct zip_t *zip, const char *entryname,
+	const void *buf, size_t bufsize,
+	unsigned long long uncomp_size,
+	unsigned int uncomp_crc32) {
+	char *name = NULL;
+	int status = -1;
+
+	if (!zip || !entryname || strlen(entryname) < 1) {
+		return -1;
+	}
+
+	name = strrpl(entryname, strlen(entryname), '\\', '/');
+	if (!name) {
+		// Cannot parse zip entry name
+		return -1;
+	}
+
+	if (mz_zip_writer_add_mem_ex(&(zip->archive), name, buf, bufsize, NULL, 0,
+		MZ_ZIP_FLAG_COMPRESSED_DATA, uncomp_size,
+		uncomp_crc32)) {
+		status = 0;
+	}
+
+	CLEANUP(name);
+	return status;
+}
+
+int zip_entry_write_raw(struct zip_t *zip, const void *buf, size_t bufsize) {
+	mz_zip_archive *pzip = NULL;
+
+	if (!zip) {
+		// zip_t handler is not initialized
+		return -1;
+	}
+
+	if (zip->level & 0xF) {
+		// The entry must have been opened at level 0
+		return -1;
+	}
+
+	pzip = &(zip->archive);
+	if (buf && bufsize > 0) {
+		if ((pzip->m_pWrite(pzip->m_pIO_opaque, zip->entry.offset, buf,
+			bufsize) != bufsize)) {
+			// Cannot write buffer
+			return -1;
+		}
+		zip->entry.offset += bufsize;
+		zip->entry.comp_size += bufsize;
+	}
+
+	return 0;
+}
+
+int zip_entry_close_raw(struct zip_t *zip, int deflated,
+	unsigned long long uncomp_size,
+	unsigned int uncomp_crc32) {
+	if (!zip) {
+		// zip_t handler is not initialized
+		return -1;
+	}
+
+	if (zip->level & 0xF) {
+		// The entry must have been opened at level 0
+		return -1;
+	}
+
+	zip->entry.uncomp_size = uncomp_size;
+	zip->entry.uncomp_crc32 = uncomp_crc32;
+	zip->entry.method = deflated ? MZ_DEFLATED : 0;
+
+	return zip_entry_close(zip);
+}
+
 int zip_entry_fwrite(struct zip_t *zip, const char *filename) {
 	int status = 0;
 	size_t n = 0;
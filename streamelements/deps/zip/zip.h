@@ -146,6 +146,62 @@ extern "C" {
 	*/
 	extern int zip_entry_write(struct zip_t *zip, const void *buf, size_t bufsize);
 
+	/*
+	Changes the compression level used by entries opened after this call.
+	Must not be called while an entry is open for writing.
+	Args:
+	zip: zip archive handler.
+	level: compression level (0-9 are the standard zlib-style levels).
+	Returns:
+	The return code - 0 on success, negative number (< 0) on error.
+	*/
+	extern int zip_set_level(struct zip_t *zip, int level);
+
+	/*
+	Appends a complete entry whose content has already been compressed as a
+	raw deflate stream (no zlib header), e.g. on another thread.
+	Must not be called while an entry is open for writing.
+	Args:
+	zip: zip archive handler.
+	entryname: an entry name in local dictionary.
+	buf: raw deflate data.
+	bufsize: raw deflate data size (in bytes).
+	uncomp_size: size of the original, uncompressed data.
+	uncomp_crc32: CRC-32 checksum of the original, uncompressed data.
+	Returns:
+	The return code - 0 on success, negative number (< 0) on error.
+	*/
+	extern int zip_entry_write_deflated(struct zip_t *zip,
+		const char *entryname, const void *buf, size_t bufsize,
+		unsigned long long uncomp_size, unsigned int uncomp_crc32);
+
+	/*
+	Appends data which is already in its final, stored or raw deflate, form
+	to the entry open for writing. The entry must have been opened at level
+	0, and must be closed with zip_entry_close_raw().
+	Args:
+	zip: zip archive handler.
+	buf: entry data.
+	bufsize: entry data size (in bytes).
+	Returns:
+	The return code - 0 on success, negative number (< 0) on error.
+	*/
+	extern int zip_entry_write_raw(struct zip_t *zip, const void *buf,
+		size_t bufsize);
+
+	/*
+	Closes an entry written with zip_entry_write_raw().
+	Args:
+	zip: zip archive handler.
+	deflated: non-zero if the data is a raw deflate stream, zero if stored.
+	uncomp_size: size of the original, uncompressed data.
+	uncomp_crc32: CRC-32 checksum of the original, uncompressed data.
+	Returns:
+	The return code - 0 on success, negative number (< 0) on error.
+	*/
+	extern int zip_entry_close_raw(struct zip_t *zip, int deflated,
+		unsigned long long uncomp_size, unsigned int uncomp_crc32);
+
 	/*
 	Compresses a file for the current zip entry.
 	Args:
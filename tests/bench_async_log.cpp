@@ -0,0 +1,147 @@
+// Benchmark for streamelements/StreamElementsAsyncLog.
+//
+// Times the caller side of a typical log line from 1 and 4 threads: written
+// by a synchronous writer which formats, locks and flushes a file on the
+// calling thread the way blog() does, queued to the async log, suppressed
+// by a call site which has used up its burst, and filtered out by level.
+// Not a test: it checks nothing and is not registered with ctest.
+
+#include "streamelements/StreamElementsAsyncLog.hpp"
+
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+typedef StreamElementsAsyncLog log_t;
+
+typedef std::chrono::steady_clock clock_type;
+
+static double elapsed_ms(clock_type::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(clock_type::now() -
+							 start)
+		.count();
+}
+
+// What a blog() call costs its caller.
+struct SyncWriter {
+	std::mutex mutex;
+	FILE *file;
+
+	void Write(const char *format, ...)
+	{
+		char buffer[log_t::MAX_MESSAGE_SIZE];
+
+		va_list args;
+		va_start(args, format);
+		vsnprintf(buffer, sizeof(buffer), format, args);
+		va_end(args);
+
+		std::lock_guard<std::mutex> guard(mutex);
+		std::fputs(buffer, file);
+		std::fputc('\n', file);
+		std::fflush(file);
+	}
+};
+
+// Nanoseconds per call of `fn`, called `perThread` times on each of
+// `threads` threads.
+template<typename F>
+static double measure(unsigned threads, uint64_t perThread, F fn)
+{
+	const auto start = clock_type::now();
+
+	std::vector<std::thread> workers;
+	for (unsigned t = 0; t < threads; ++t) {
+		workers.emplace_back([&]() {
+			for (uint64_t i = 0; i < perThread; ++i)
+				fn();
+		});
+	}
+
+	for (auto &worker : workers)
+		worker.join();
+
+	return elapsed_ms(start) * 1e6 / (double)(perThread * threads);
+}
+
+int main()
+{
+	const uint64_t TOTAL = 50000;
+	static const char format[] =
+		"obs-streamelements-core: serving file from path: %s";
+	static const char path[] =
+		"/home/user/.config/obs-studio/plugin_config/obs-streamelements-core/assets/overlay.png";
+
+	FILE *file = std::tmpfile();
+
+	if (!file) {
+		std::puts("no temporary file");
+		return 1;
+	}
+
+	for (unsigned threads : {1u, 4u}) {
+		const uint64_t perThread = TOTAL / threads;
+
+		SyncWriter sync;
+		sync.file = file;
+
+		const double syncNs = measure(threads, perThread, [&]() {
+			sync.Write(format, path);
+		});
+
+		// Room for every message, so nothing is dropped and each call
+		// does the full claim and format.
+		log_t::Options options;
+		options.capacity = 1 << 16;
+		options.burst = 0;
+
+		log_t log(
+			[&](int, const char *message) {
+				std::fputs(message, file);
+				std::fputc('\n', file);
+				std::fflush(file);
+			},
+			options);
+
+		static log_t::CallSite site(__FILE__, __LINE__);
+
+		const double queuedNs = measure(threads, perThread, [&]() {
+			log.Log(site, log_t::LEVEL_INFO, format, path);
+		});
+
+		log.Flush();
+
+		const uint64_t dropped = log.GetStats().dropped;
+
+		log_t::Options limited;
+		limited.burst = 20;
+
+		log_t limitedLog([](int, const char *) {}, limited);
+		static log_t::CallSite limitedSite(__FILE__, __LINE__);
+
+		const double suppressedNs = measure(threads, perThread, [&]() {
+			limitedLog.Log(limitedSite, log_t::LEVEL_INFO, format,
+				       path);
+		});
+
+		const double filteredNs = measure(threads, perThread, [&]() {
+			limitedLog.Log(limitedSite, log_t::LEVEL_DEBUG, format,
+				       path);
+		});
+
+		std::printf("%u caller(s), ns per call:\n", threads);
+		std::printf("  synchronous: %7.1f\n", syncNs);
+		std::printf("  queued:      %7.1f  (%llu dropped)\n", queuedNs,
+			    (unsigned long long)dropped);
+		std::printf("  suppressed:  %7.1f\n", suppressedNs);
+		std::printf("  filtered:    %7.1f\n", filteredNs);
+	}
+
+	std::fclose(file);
+
+	return 0;
+}
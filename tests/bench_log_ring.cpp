@@ -0,0 +1,63 @@
+// Benchmark for streamelements/StreamElementsLogRing.
+//
+// Appends a typical API call record from 1, 2, 4 and 8 concurrent writers
+// and prints the cost per append and how many records were dropped because
+// a writer lapped the ring onto a slot another writer still held. Not a
+// test: it checks nothing and is not registered with ctest.
+
+#include "streamelements/StreamElementsLogRing.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+typedef StreamElementsLogRing ring_t;
+
+typedef std::chrono::steady_clock clock_type;
+
+static double elapsed_ms(clock_type::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(clock_type::now() -
+							 start)
+		.count();
+}
+
+int main()
+{
+	const uint64_t TOTAL = 4000000;
+	static const char message[] =
+		"obs-streamelements-core: api call getCurrentSceneItems";
+
+	std::printf("%llu appends into a 4096 record ring:\n",
+		    (unsigned long long)TOTAL);
+
+	for (unsigned threads : {1u, 2u, 4u, 8u}) {
+		ring_t ring(4096);
+
+		const uint64_t perThread = TOTAL / threads;
+
+		const auto start = clock_type::now();
+
+		std::vector<std::thread> workers;
+		for (unsigned t = 0; t < threads; ++t) {
+			workers.emplace_back([&]() {
+				for (uint64_t i = 0; i < perThread; ++i)
+					ring.Append(ring_t::Category::ApiCall,
+						    message,
+						    sizeof(message) - 1);
+			});
+		}
+
+		for (auto &worker : workers)
+			worker.join();
+
+		const double ms = elapsed_ms(start);
+
+		std::printf("  %u writer(s): %6.1f ns/append  %llu dropped\n",
+			    threads, ms * 1e6 / (double)(perThread * threads),
+			    (unsigned long long)ring.GetDroppedCount());
+	}
+
+	return 0;
+}
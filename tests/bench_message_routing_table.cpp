@@ -0,0 +1,133 @@
+// Benchmark for streamelements/StreamElementsMessageRoutingTable.
+//
+// Routes broadcasts to 24 listeners the way NotifyAllLocalEventListeners()
+// used to -- walking the listener map under its mutex and testing every
+// listener's flags -- and through a routing table snapshot, from one thread
+// and from four at once, and prints the cost per message. Not a test: it
+// checks nothing and is not registered with ctest.
+
+#include "streamelements/StreamElementsMessageRoutingTable.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef StreamElementsMessageRoutingTable::flags_t flags_t;
+
+typedef std::chrono::steady_clock clock_type;
+
+// Same values as StreamElementsMessageBus.
+static const flags_t DEST_ALL = 0xFFFFFFFFUL;
+static const flags_t DEST_ALL_LOCAL = 0x0000FFFFUL;
+static const flags_t DEST_UI = 0x00000001UL;
+static const flags_t DEST_WORKER = 0x00000002UL;
+static const flags_t DEST_BROWSER_SOURCE = 0x00000004UL;
+
+static const std::vector<flags_t> MASKS = {DEST_ALL, DEST_ALL_LOCAL, DEST_UI,
+					   DEST_WORKER, DEST_BROWSER_SOURCE};
+
+static const flags_t SAMPLE_FLAGS[] = {DEST_UI, DEST_WORKER,
+				       DEST_BROWSER_SOURCE};
+
+static double elapsed_ms(clock_type::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(clock_type::now() -
+							 start)
+		.count();
+}
+
+// The per-message work NotifyAllLocalEventListeners() used to do.
+struct LockedListeners {
+	struct Item {
+		std::string target;
+		flags_t flags;
+	};
+
+	std::recursive_mutex mutex;
+	std::map<std::string, std::shared_ptr<Item>> list;
+
+	size_t Dispatch(flags_t types)
+	{
+		std::lock_guard<std::recursive_mutex> guard(mutex);
+
+		size_t count = 0;
+		for (auto kv : list)
+			if (kv.second->flags & types)
+				count += kv.second->target.size();
+		return count;
+	}
+};
+
+// Runs `dispatch` `messageCount` times on each of `threadCount` threads and
+// prints the wall clock cost per message.
+static void bench(const char *name, int threadCount, int messageCount,
+		  std::function<size_t()> dispatch)
+{
+	std::vector<size_t> sinks(threadCount);
+	std::vector<std::thread> threads;
+
+	const auto start = clock_type::now();
+
+	for (int t = 0; t < threadCount; ++t) {
+		threads.emplace_back([&, t]() {
+			for (int i = 0; i < messageCount; ++i)
+				sinks[t] += dispatch();
+		});
+	}
+
+	for (auto &thread : threads)
+		thread.join();
+
+	const double ms = elapsed_ms(start);
+
+	std::printf("  %-20s %d thread(s): %7.0f ns/message\n", name,
+		    threadCount,
+		    ms * 1e6 / ((double)messageCount * threadCount));
+}
+
+int main()
+{
+	const int listenerCount = 24;
+	const int messageCount = 500000;
+
+	StreamElementsMessageRoutingTable table(MASKS);
+	LockedListeners locked;
+
+	for (int i = 0; i < listenerCount; ++i) {
+		const std::string target = "browser-" + std::to_string(i) +
+					   "-0123456789abcdef0123456789abcdef";
+		const flags_t flags = SAMPLE_FLAGS[i % 3];
+		table.Set(target, flags);
+		locked.list[target] = std::make_shared<LockedListeners::Item>(
+			LockedListeners::Item{target, flags});
+	}
+
+	auto lockedDispatch = [&]() -> size_t {
+		return locked.Dispatch(DEST_UI);
+	};
+
+	auto snapshotDispatch = [&]() -> size_t {
+		size_t count = 0;
+		auto targets = table.GetSnapshot()->Resolve(DEST_UI);
+		for (auto &target : *targets)
+			count += target.size();
+		return count;
+	};
+
+	std::printf("%d listeners, DEST_UI broadcasts:\n", listenerCount);
+
+	for (int threadCount : {1, 4}) {
+		bench("locked map walk,", threadCount,
+		      messageCount / threadCount, lockedDispatch);
+		bench("snapshot,", threadCount, messageCount / threadCount,
+		      snapshotDispatch);
+	}
+
+	return 0;
+}
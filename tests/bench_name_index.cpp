@@ -0,0 +1,90 @@
+// Benchmark for streamelements/StreamElementsNameIndex.
+//
+// Imports 100 and 400 copies of one widget into a collection of 500 sources,
+// naming every copy uniquely the way ObsGetUniqueSourceName() used to --
+// probing suffixes and scanning every name for each -- and through the
+// index, and prints how long each import took. Not a test: it checks
+// nothing and is not registered with ctest.
+
+#include "streamelements/StreamElementsNameIndex.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <strings.h>
+#include <vector>
+
+typedef StreamElementsNameIndex index_t;
+
+typedef std::chrono::steady_clock clock_type;
+
+static double elapsed_ms(clock_type::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(clock_type::now() -
+							 start)
+		.count();
+}
+
+// What ObsGetUniqueSourceName() used to do, over a plain list of names.
+static std::string brute_force_unique(const std::map<int, std::string> &names,
+				      const std::string &name)
+{
+	auto taken = [&](const std::string &candidate) {
+		for (auto &kv : names) {
+			if (0 == strcasecmp(kv.second.c_str(),
+					    candidate.c_str()))
+				return true;
+		}
+
+		return false;
+	};
+
+	std::string result(name);
+
+	for (int sequence = 1; taken(result); ++sequence)
+		result = name + " " + std::to_string(sequence);
+
+	return result;
+}
+
+int main()
+{
+	const int EXISTING = 500;
+
+	std::printf("importing into %d existing sources:\n", EXISTING);
+
+	for (int count : {100, 400}) {
+		std::map<int, std::string> names;
+		for (int i = 0; i < EXISTING; ++i)
+			names[i] = "Existing source " + std::to_string(i);
+
+		const auto scanStart = clock_type::now();
+
+		for (int i = 0; i < count; ++i)
+			names[EXISTING + i] =
+				brute_force_unique(names, "Alert Box");
+
+		const double scanMs = elapsed_ms(scanStart);
+
+		index_t index;
+		std::vector<int> owners(EXISTING + count);
+
+		for (int i = 0; i < EXISTING; ++i)
+			index.Set(&owners[i],
+				  "Existing source " + std::to_string(i));
+
+		const auto indexStart = clock_type::now();
+
+		for (int i = 0; i < count; ++i)
+			index.Set(&owners[EXISTING + i],
+				  index.GetUniqueName("Alert Box"));
+
+		const double indexMs = elapsed_ms(indexStart);
+
+		std::printf("  %3d copies: scan %9.2f ms, index %6.2f ms\n",
+			    count, scanMs, indexMs);
+	}
+
+	return 0;
+}
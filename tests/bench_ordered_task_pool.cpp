@@ -0,0 +1,68 @@
+// Benchmark for streamelements/StreamElementsOrderedTaskPool.
+//
+// Serves 8 local websocket clients sending 2000 small requests each, alone
+// and while another client sends a 16 MB request, the way
+// StreamElementsWebsocketApiServer does -- 2 io threads, parsed and
+// answered on a 4 worker task pool -- and on a single io thread which
+// parses on the network thread, the way it used to. Prints how long the
+// slowest client waited for its first and its last reply. Not a test: it
+// checks nothing and is not registered with ctest.
+
+#include "ordered_task_pool_echo.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+static double get_slowest(const std::vector<ClientStats> &stats,
+			  double ClientStats::*field)
+{
+	double result = 0.0;
+
+	for (auto &client : stats)
+		result = std::max(result, client.*field);
+
+	return result;
+}
+
+static void bench(const char *name, uint16_t port)
+{
+	const int clientCount = 8;
+	const int requestCount = 2000;
+	const size_t largePayloadBytes = 16 * 1024 * 1024;
+
+	auto stats = run_clients(port, clientCount, requestCount);
+
+	const double aloneMs = get_slowest(stats, &ClientStats::seconds) * 1000.0;
+
+	LargeRequestClient largeClient(port, largePayloadBytes);
+
+	// Let the large request arrive first
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+	stats = run_clients(port, clientCount, requestCount);
+
+	std::printf("  %-27s %8.1f ms  %8.1f ms  %8.1f ms\n", name, aloneMs,
+		    get_slowest(stats, &ClientStats::firstSeconds) * 1000.0,
+		    get_slowest(stats, &ClientStats::seconds) * 1000.0);
+}
+
+int main()
+{
+	std::printf("8 clients x 2000 requests: all replies alone; first and "
+		    "all replies next to a 16 MB request:\n");
+
+	{
+		StreamElementsOrderedTaskPool pool(4);
+		EchoServer server(2, &pool);
+
+		bench("2 io threads, 4 workers:", server.GetPort());
+	}
+
+	{
+		EchoServer server(1, nullptr);
+
+		bench("1 io thread, inline:", server.GetPort());
+	}
+
+	return 0;
+}
@@ -0,0 +1,169 @@
+// Benchmark for streamelements/StreamElementsParallelZipWriter.
+//
+// Packages a generated backup tree -- scene collection JSON and media which is
+// already compressed -- the way CreateLocalBackupPackage() used to, deflating
+// every entry at level 9 on the calling thread, and through the parallel
+// writer at several levels and worker counts, and prints how long each took
+// and how large the archive came out. Not a test: it checks nothing and is
+// not registered with ctest.
+
+#include "streamelements/StreamElementsParallelZipWriter.hpp"
+#include "streamelements/deps/zip/zip.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+typedef std::chrono::steady_clock clock_type;
+
+static double elapsed_ms(clock_type::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(clock_type::now() -
+							 start)
+		.count();
+}
+
+static void write_file(const fs::path &path, const std::string &content)
+{
+	fs::create_directories(path.parent_path());
+	std::ofstream out(path, std::ios::binary);
+	out << content;
+}
+
+static std::string random_bytes(size_t size, unsigned seed)
+{
+	std::mt19937 rng(seed);
+	std::string result(size, '\0');
+	for (auto &ch : result)
+		ch = (char)(rng() & 0xFF);
+	return result;
+}
+
+static std::string text(size_t size, unsigned seed)
+{
+	static const char *words[] = {"scene", "source", "item", "\"name\": ",
+				      "{", "}", "\n", "transform", "0.5"};
+	std::mt19937 rng(seed);
+	std::string result;
+	while (result.size() < size)
+		result += words[rng() % 9];
+	result.resize(size);
+	return result;
+}
+
+struct TreeEntry {
+	fs::path localPath;
+	std::string zipPath;
+};
+
+static std::vector<TreeEntry> make_tree(const fs::path &dir, uint64_t &bytes)
+{
+	std::vector<TreeEntry> result;
+
+	bytes = 0;
+
+	auto add = [&](const std::string &zipPath, const std::string &content) {
+		write_file(dir / zipPath, content);
+		result.push_back({dir / zipPath, zipPath});
+		bytes += content.size();
+	};
+
+	for (unsigned i = 0; i < 24; ++i)
+		add("basic/scenes/collection" + std::to_string(i) + ".json",
+		    text(1024 * 1024 + i * 997, i));
+
+	for (unsigned i = 0; i < 8; ++i)
+		add("media/clip" + std::to_string(i) + ".webm",
+		    random_bytes(4 * 1024 * 1024, 100 + i));
+
+	return result;
+}
+
+// What CreateLocalBackupPackage() did before the parallel writer.
+static void bench_sequential(const std::vector<TreeEntry> &tree,
+			     const fs::path &archive, uint64_t bytes)
+{
+	const auto start = clock_type::now();
+
+	zip_t *zip = zip_open(archive.string().c_str(), 9, 'w');
+
+	for (auto &entry : tree) {
+		if (0 != zip_entry_open(zip, entry.zipPath.c_str()))
+			continue;
+
+		zip_entry_fwrite(zip, entry.localPath.string().c_str());
+		zip_entry_close(zip);
+	}
+
+	zip_close(zip);
+
+	const double ms = elapsed_ms(start);
+
+	std::printf("  sequential, level 9:           %8.1f ms  %7.1f MB/s  %6.1f MB\n",
+		    ms, bytes / 1048576.0 / (ms / 1000.0),
+		    fs::file_size(archive) / 1048576.0);
+}
+
+static void bench_parallel(const std::vector<TreeEntry> &tree,
+			   const fs::path &archive, uint64_t bytes, int level,
+			   size_t workers)
+{
+	StreamElementsParallelZipWriter::Options options;
+	options.level = level;
+	options.workerCount = workers;
+
+	const auto start = clock_type::now();
+
+	StreamElementsParallelZipWriter writer(options);
+	writer.Open(archive.string());
+
+	for (auto &entry : tree)
+		writer.AddFile(entry.localPath.string(), entry.zipPath);
+
+	writer.Close();
+
+	const double ms = elapsed_ms(start);
+
+	std::printf("  parallel, level %d, %2zu workers: %8.1f ms  %7.1f MB/s"
+		    "  %6.1f MB\n",
+		    level, workers, ms, bytes / 1048576.0 / (ms / 1000.0),
+		    fs::file_size(archive) / 1048576.0);
+}
+
+int main()
+{
+	const fs::path dir = fs::temp_directory_path() / "se_bench_zip_writer";
+	fs::remove_all(dir);
+
+	uint64_t bytes = 0;
+	const auto tree = make_tree(dir / "tree", bytes);
+	const fs::path archive = dir / "package.zip";
+
+	std::printf("%zu files, %.1f MB:\n", tree.size(), bytes / 1048576.0);
+
+	bench_sequential(tree, archive, bytes);
+
+	const size_t cores =
+		std::max<size_t>(1, std::thread::hardware_concurrency());
+
+	for (int level : {9, 6, 1}) {
+		for (size_t workers : {(size_t)1, (size_t)2, cores}) {
+			bench_parallel(tree, archive, bytes, level, workers);
+
+			if (workers >= cores)
+				break;
+		}
+	}
+
+	fs::remove_all(dir);
+
+	return 0;
+}
@@ -0,0 +1,72 @@
+// Benchmark for streamelements/StreamElementsSceneItemBatch.
+//
+// Applies a 500-item layout to fake scenes with groups, one item at a time
+// the way setSceneItemPropertiesById did and as one batch, and prints the
+// lookups, atomic scene updates, browser events and serialized items each
+// path took, and how long it ran. Not a test: it checks nothing and is not
+// registered with ctest.
+
+#include "scene_item_batch_fakes.hpp"
+
+#include <chrono>
+#include <cstdio>
+
+typedef std::chrono::steady_clock clock_type;
+
+static double elapsed_ms(clock_type::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(clock_type::now() -
+							 start)
+		.count();
+}
+
+static void print_result(const char *name, const FakeWorld &world, double ms)
+{
+	std::printf("  %-9s %7zu lookups  %4zu atomic updates  %4zu events  "
+		    "%6zu items serialized  %8.2f ms\n",
+		    name, world.lookups, world.atomicUpdates, world.events,
+		    world.serializedItems, ms);
+}
+
+int main()
+{
+	std::mt19937 rng(500);
+
+	FakeWorld perItem, batched;
+
+	{
+		std::mt19937 a(500), b(500);
+		build_world(perItem, a, 4, 105);
+		build_world(batched, b, 4, 105);
+	}
+
+	const size_t ITEMS = std::min((size_t)500, perItem.items.size());
+
+	std::vector<FakeProps> props;
+	for (size_t i = 0; i < ITEMS; ++i)
+		props.push_back(random_props(rng, false));
+
+	auto requests_for = [&](FakeWorld &world) {
+		std::vector<FakeRequest> requests;
+
+		for (size_t i = 0; i < ITEMS; ++i)
+			requests.push_back({id_of(world.items[i]), props[i]});
+
+		return requests;
+	};
+
+	auto perItemRequests = requests_for(perItem);
+	auto batchRequests = requests_for(batched);
+
+	std::printf("%zu items in 4 root scenes and their groups:\n", ITEMS);
+
+	auto start = clock_type::now();
+	apply_per_item(perItem, perItemRequests);
+	print_result("per item:", perItem, elapsed_ms(start));
+
+	start = clock_type::now();
+	apply_batch(batched, batchRequests);
+	print_result("batch:", batched, elapsed_ms(start));
+
+	return 0;
+}
@@ -0,0 +1,57 @@
+// Benchmark for streamelements/StreamElementsSceneItemFragmentCache.
+//
+// Serializes a fake 500-item scene after changing one item per round, from
+// scratch and through the cache, and prints the cost per round. Not a test:
+// it checks nothing and is not registered with ctest.
+
+#include "scene_item_fragment_cache_fakes.hpp"
+
+#include <chrono>
+#include <cstdio>
+
+typedef std::chrono::steady_clock clock_type;
+
+static double elapsed_ms(clock_type::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(clock_type::now() -
+							 start)
+		.count();
+}
+
+int main()
+{
+	const int ROUNDS = 100;
+
+	FakeScene scene;
+	build_scene(scene, 500, 500, 30);
+
+	size_t sink = 0;
+
+	const auto freshStart = clock_type::now();
+
+	for (int r = 0; r < ROUNDS; ++r) {
+		scene.items[r].x += 1;
+		sink += serialize_scene_fresh(scene).size();
+	}
+
+	const double freshMs = elapsed_ms(freshStart);
+
+	cache_t cache;
+	serialize_scene_cached(scene, cache, &scene);
+
+	const auto cachedStart = clock_type::now();
+
+	for (int r = 0; r < ROUNDS; ++r) {
+		scene.items[r].x += 1;
+		raise_item_signal(cache, &scene.items[r]);
+		sink += serialize_scene_cached(scene, cache, &scene).size();
+	}
+
+	const double cachedMs = elapsed_ms(cachedStart);
+
+	std::printf("500 items, one changed per round (%zu bytes):\n", sink);
+	std::printf("  fresh:  %6.2f ms/round\n", freshMs / ROUNDS);
+	std::printf("  cached: %6.2f ms/round\n", cachedMs / ROUNDS);
+
+	return 0;
+}
@@ -0,0 +1,87 @@
+// Benchmark for streamelements/StreamElementsSceneTraversal.
+//
+// Walks a fake scene of 300 top-level items, with groups, the way the
+// std::function based scanSceneItems() and ObsSceneEnumAllItems() used to
+// and through ScanScene() and ForEachItem(), and prints the time and heap
+// allocations per walk. Not a test: it checks nothing and is not registered
+// with ctest.
+
+#include "scene_traversal_fakes.hpp"
+
+#include <chrono>
+#include <cstdio>
+
+typedef std::chrono::steady_clock clock_type;
+
+static const int ROUNDS = 2000;
+
+static double elapsed_ms(clock_type::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(clock_type::now() -
+							 start)
+		.count();
+}
+
+template<typename F> static void measure(const char *name, F round)
+{
+	s_allocations = 0;
+
+	const auto start = clock_type::now();
+
+	for (int r = 0; r < ROUNDS; ++r)
+		round();
+
+	const double ms = elapsed_ms(start);
+
+	std::printf("  %-32s %7.2f us/walk  %4zu allocations/walk\n", name,
+		    ms * 1000.0 / ROUNDS, s_allocations / ROUNDS);
+}
+
+int main()
+{
+	std::mt19937 rng(300);
+
+	FakeWorld world;
+	auto scene = build_scene(world, rng, 300, 1);
+
+	// Keeps the visitors from being optimized away
+	volatile size_t sink = 0;
+
+	std::printf("%zu items:\n", world.items.size());
+
+	measure("scanSceneItems() (old):", [&] {
+		old_scan_scene(
+			scene,
+			[&](FakeItem *item, FakeItem *) {
+				sink += item->serial;
+				return true;
+			},
+			true);
+	});
+
+	measure("ScanScene():", [&] {
+		traversal_t::ScanScene(
+			scene,
+			[&](FakeItem *item, FakeItem *) {
+				sink += item->serial;
+				return true;
+			},
+			true);
+	});
+
+	measure("ObsSceneEnumAllItems() (old):", [&] {
+		old_enum_all_items(scene, [&](FakeItem *item) {
+			sink += item->serial;
+			return true;
+		});
+	});
+
+	measure("ForEachItem():", [&] {
+		traversal_t::ForEachItem(scene, [&](FakeItem *item) {
+			sink += item->serial;
+			return true;
+		});
+	});
+
+	return 0;
+}
@@ -0,0 +1,146 @@
+// Benchmark for streamelements/StreamElementsScopedStorage.
+//
+// Writes, lists and reads back small items through the journal, and through
+// the file-per-item layout it replaced, and prints how long each took. Not a
+// test: it checks nothing and is not registered with ctest.
+
+#include "streamelements/StreamElementsScopedStorage.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+typedef std::chrono::steady_clock clock_type;
+
+static double elapsed_ms(clock_type::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(clock_type::now() -
+							 start)
+		.count();
+}
+
+static fs::path make_temp_dir(const char *name)
+{
+	fs::path dir = fs::temp_directory_path() / name;
+	fs::remove_all(dir);
+	fs::create_directories(dir);
+	return dir;
+}
+
+static std::string item_name(int i)
+{
+	return "item" + std::to_string(i) + ".json";
+}
+
+static void bench_journal(int items, const std::string &content)
+{
+	fs::path dir = make_temp_dir("se_bench_scoped_storage_journal");
+
+	StreamElementsScopedStorage s((dir / "store.journal").string());
+	s.Open();
+
+	auto start = clock_type::now();
+
+	for (int i = 0; i < items; ++i)
+		s.Write("scope", "container", item_name(i), content);
+
+	const double writeTime = elapsed_ms(start);
+
+	start = clock_type::now();
+
+	{
+		StreamElementsScopedStorage::Batch batch(&s);
+
+		for (int i = 0; i < items; ++i)
+			s.Write("scope", "container", item_name(i), content);
+	}
+
+	const double batchTime = elapsed_ms(start);
+
+	start = clock_type::now();
+
+	std::vector<StreamElementsScopedStorage::ItemInfo> list;
+	s.List("scope", "container", "", list);
+
+	const double listTime = elapsed_ms(start);
+
+	start = clock_type::now();
+
+	std::string value;
+	for (int i = 0; i < items; ++i)
+		s.Read("scope", "container", item_name(i), value);
+
+	const double readTime = elapsed_ms(start);
+
+	std::printf("  journal:  write %8.1f ms  batch %8.1f ms  list %6.2f ms"
+		    "  read %6.2f ms\n",
+		    writeTime, batchTime, listTime, readTime);
+
+	fs::remove_all(dir);
+}
+
+static void bench_files(int items, const std::string &content)
+{
+	fs::path dir = make_temp_dir("se_bench_scoped_storage_files");
+	fs::path container = dir / "scope" / "container";
+
+	auto start = clock_type::now();
+
+	for (int i = 0; i < items; ++i) {
+		fs::create_directories(container);
+
+		std::ofstream out(container / item_name(i),
+				  std::ios::binary | std::ios::trunc);
+		out << content;
+	}
+
+	const double writeTime = elapsed_ms(start);
+
+	start = clock_type::now();
+
+	size_t listed = 0;
+	for (auto &entry : fs::directory_iterator(container)) {
+		listed += entry.file_size();
+	}
+
+	const double listTime = elapsed_ms(start);
+
+	start = clock_type::now();
+
+	for (int i = 0; i < items; ++i) {
+		std::ifstream in(container / item_name(i), std::ios::binary);
+
+		std::stringstream ss;
+		ss << in.rdbuf();
+	}
+
+	const double readTime = elapsed_ms(start);
+
+	std::printf("  files:    write %8.1f ms                   list %6.2f ms"
+		    "  read %6.2f ms\n",
+		    writeTime, listTime, readTime);
+
+	(void)listed;
+
+	fs::remove_all(dir);
+}
+
+int main()
+{
+	const std::string content(256, 'x');
+
+	for (int items : {100, 1000, 10000}) {
+		std::printf("%d items of %zu bytes:\n", items, content.size());
+
+		bench_journal(items, content);
+		bench_files(items, content);
+	}
+
+	return 0;
+}
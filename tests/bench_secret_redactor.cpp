@@ -0,0 +1,82 @@
+// Benchmark for streamelements/StreamElementsSecretRedactor.
+//
+// Redacts a 16 MiB document of mostly ordinary settings with a few secrets,
+// streamed in the 32 KiB chunks the diagnostics paths read, and through the
+// whole-buffer implementation the streaming redactor replaced, and prints
+// the throughput of each. Not a test: it checks nothing and is not
+// registered with ctest.
+
+#include "streamelements/StreamElementsSecretRedactor.hpp"
+#include "secret_redactor_reference.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+typedef std::chrono::steady_clock clock_type;
+
+static double elapsed_ms(clock_type::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(clock_type::now() -
+							 start)
+		.count();
+}
+
+static std::string make_document(size_t size)
+{
+	std::string result;
+
+	while (result.size() < size) {
+		result += "{\"name\": \"Scene item\", \"visible\": true, "
+			  "\"settings\": {\"url\": \"https://example.com/a\", "
+			  "\"width\": 1920, \"height\": 1080}},\n";
+		result += "{\"key\": \"secret\", \"server\": \"rtmp://u:p@h/x\"},\n";
+	}
+
+	return result;
+}
+
+static void print_result(const char *name, size_t bytes, double ms)
+{
+	std::printf("  %-28s %8.1f ms  %7.1f MiB/s\n", name, ms,
+		    bytes / 1048576.0 / (ms / 1000.0));
+}
+
+int main()
+{
+	const size_t CHUNK_SIZE = 32768;
+
+	const std::string input = make_document(16 * 1024 * 1024);
+
+	std::printf("%.1f MiB:\n", input.size() / 1048576.0);
+
+	{
+		const auto start = clock_type::now();
+
+		StreamElementsSecretRedactor::Stream stream;
+		std::string output;
+
+		for (size_t offset = 0; offset < input.size();
+		     offset += CHUNK_SIZE)
+			stream.Write(input.data() + offset,
+				     std::min(CHUNK_SIZE, input.size() - offset),
+				     output);
+
+		stream.Finish(output);
+
+		print_result("stream, 32 KiB chunks:", input.size(),
+			     elapsed_ms(start));
+	}
+
+	{
+		const auto start = clock_type::now();
+
+		const std::string output = reference::Redact(input);
+
+		print_result("whole buffer (reference):", input.size(),
+			     elapsed_ms(start));
+	}
+
+	return 0;
+}
@@ -0,0 +1,93 @@
+// Benchmark for the counters behind streamelements/SETrace.hpp.
+//
+// Times an AddRef/DecRef pair from 1 and 4 threads in each ENABLE_SETRACE
+// mode -- off, the single global atomic mode 1 used to have,
+// StreamElementsShardedCounter and StreamElementsRefTracker -- and prints
+// the cost per operation. Not a test: it checks nothing and is not
+// registered with ctest.
+
+#include "streamelements/StreamElementsRefTracker.hpp"
+#include "streamelements/StreamElementsShardedCounter.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock clock_type;
+
+// Constant-initialized, like g_seTrace_refcountBalance.
+static StreamElementsShardedCounter s_counter;
+
+static std::atomic<long> s_global(0);
+
+static double elapsed_ms(clock_type::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(clock_type::now() -
+							 start)
+		.count();
+}
+
+// Nanoseconds per operation of `fn`, which does an AddRef/DecRef pair and
+// is called `pairs` times on each of `threads` threads.
+template<typename F>
+static double measure(unsigned threads, int pairs, F fn)
+{
+	const auto start = clock_type::now();
+
+	std::vector<std::thread> workers;
+	for (unsigned t = 0; t < threads; ++t) {
+		workers.emplace_back([&]() {
+			int object = 0;
+
+			for (int i = 0; i < pairs; ++i)
+				fn(&object);
+		});
+	}
+
+	for (auto &worker : workers)
+		worker.join();
+
+	return elapsed_ms(start) * 1e6 / ((double)pairs * threads * 2);
+}
+
+int main()
+{
+	const int PAIRS = 200000;
+
+	StreamElementsRefTracker tracker(StreamElementsRefTracker::Options{});
+
+	std::printf("ns per operation:\n");
+
+	for (unsigned threads : {1u, 4u}) {
+		const double none = measure(threads, PAIRS, [](int *ptr) {
+			// Mode 0: the macros expand to their argument.
+			std::atomic_signal_fence(std::memory_order_seq_cst);
+			(void)ptr;
+		});
+
+		const double global = measure(threads, PAIRS, [](int *) {
+			s_global.fetch_add(1);
+			s_global.fetch_sub(1);
+		});
+
+		const double sharded = measure(threads, PAIRS, [](int *) {
+			s_counter.Add(1);
+			s_counter.Add(-1);
+		});
+
+		// Fewer pairs: a stack is captured per operation.
+		const double detailed =
+			measure(threads, PAIRS / 10, [&](int *ptr) {
+				tracker.AddRef(__FILE__, __LINE__, "ptr", ptr);
+				tracker.DecRef(__FILE__, __LINE__, "ptr", ptr);
+			});
+
+		std::printf("  %u thread(s): off %6.1f, global atomic %6.1f, "
+			    "sharded %6.1f, detailed %8.1f\n",
+			    threads, none, global, sharded, detailed);
+	}
+
+	return 0;
+}
@@ -0,0 +1,274 @@
+#pragma once
+
+// A websocket echo server wired the way StreamElementsWebsocketApiServer
+// is, and local clients which time its replies, shared by
+// test_ordered_task_pool and bench_ordered_task_pool.
+
+#define _WEBSOCKETPP_CPP11_TYPE_TRAITS_
+#define ASIO_STANDALONE
+#include <websocketpp/server.hpp>
+#include <websocketpp/client.hpp>
+#include <websocketpp/config/asio_no_tls.hpp>
+#include <websocketpp/config/asio_no_tls_client.hpp>
+
+#include "streamelements/StreamElementsOrderedTaskPool.hpp"
+
+#include "json11/json11.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef websocketpp::server<websocketpp::config::asio> server_t;
+typedef websocketpp::client<websocketpp::config::asio_client> client_t;
+
+// Answers each { "seq": n, ... } request with { "seq": n }.
+class EchoServer {
+public:
+	// No pool: parse on the network thread.
+	EchoServer(size_t ioThreadCount, StreamElementsOrderedTaskPool *pool)
+		: m_pool(pool)
+	{
+		m_endpoint.clear_access_channels(websocketpp::log::alevel::all);
+		m_endpoint.clear_error_channels(websocketpp::log::elevel::all);
+
+		m_endpoint.init_asio();
+		m_endpoint.set_reuse_addr(true);
+
+		m_endpoint.set_message_handler(
+			[this](websocketpp::connection_hdl con_hdl,
+			       server_t::message_ptr msg) {
+				if (!m_pool) {
+					Handle(con_hdl, msg->get_payload());
+					return;
+				}
+
+				m_pool->Post(con_hdl.lock().get(),
+					     [this, con_hdl, msg]() {
+						     Handle(con_hdl,
+							    msg->get_payload());
+					     });
+			});
+
+		websocketpp::lib::error_code ec;
+
+		m_endpoint.listen(asio::ip::tcp::endpoint(
+					  asio::ip::make_address_v4("127.0.0.1"),
+					  0),
+				  ec);
+		m_endpoint.start_accept(ec);
+
+		m_port = m_endpoint.get_local_endpoint(ec).port();
+
+		for (size_t i = 0; i < ioThreadCount; ++i)
+			m_threads.emplace_back([this]() { m_endpoint.run(); });
+	}
+
+	~EchoServer()
+	{
+		if (m_pool)
+			m_pool->Stop();
+
+		m_endpoint.stop();
+
+		for (auto &thread : m_threads)
+			thread.join();
+	}
+
+	uint16_t GetPort() const { return m_port; }
+
+private:
+	void Handle(websocketpp::connection_hdl con_hdl,
+		    const std::string &payload)
+	{
+		std::string err;
+		auto request = json11::Json::parse(payload, err);
+
+		websocketpp::lib::error_code ec;
+
+		m_endpoint.send(
+			con_hdl,
+			json11::Json(json11::Json::object{
+					     {"seq", request["seq"]}})
+				.dump(),
+			websocketpp::frame::opcode::text, ec);
+	}
+
+private:
+	StreamElementsOrderedTaskPool *m_pool;
+
+	server_t m_endpoint;
+	uint16_t m_port = 0;
+	std::vector<std::thread> m_threads;
+};
+
+struct ClientStats {
+	bool ordered = true;
+	int received = 0;
+	// Since the clients connected: until the first reply, and until the
+	// last
+	double firstSeconds = 0.0;
+	double seconds = 0.0;
+};
+
+// Sends one request of `payloadBytes` from a client of its own, so that
+// building and sending it does not hold up the other clients.
+class LargeRequestClient {
+public:
+	LargeRequestClient(uint16_t port, size_t payloadBytes)
+	{
+		// Many small values, which take a while to parse
+		std::string payload = "{\"seq\":0,\"items\":[0";
+
+		while (payload.size() < payloadBytes)
+			payload += ",12345678";
+
+		payload += "]}";
+
+		m_client.clear_access_channels(websocketpp::log::alevel::all);
+		m_client.clear_error_channels(websocketpp::log::elevel::all);
+		m_client.init_asio();
+		m_client.start_perpetual();
+
+		websocketpp::lib::error_code ec;
+		m_connection = m_client.get_connection(
+			"ws://127.0.0.1:" + std::to_string(port), ec);
+
+		m_connection->set_open_handler(
+			[this, payload](websocketpp::connection_hdl con_hdl) {
+				websocketpp::lib::error_code ec;
+
+				m_client.send(con_hdl, payload,
+					      websocketpp::frame::opcode::text,
+					      ec);
+			});
+
+		m_client.connect(m_connection);
+
+		m_thread = std::thread([this]() { m_client.run(); });
+	}
+
+	~LargeRequestClient()
+	{
+		m_client.stop_perpetual();
+
+		websocketpp::lib::error_code ec;
+		m_connection->close(websocketpp::close::status::normal, "", ec);
+
+		m_client.stop();
+		m_thread.join();
+	}
+
+private:
+	client_t m_client;
+	client_t::connection_ptr m_connection;
+	std::thread m_thread;
+};
+
+// `clientCount` clients send `requestCount` small requests each. Returns
+// their stats.
+inline std::vector<ClientStats> run_clients(uint16_t port, int clientCount,
+					    int requestCount)
+{
+	client_t client;
+
+	client.clear_access_channels(websocketpp::log::alevel::all);
+	client.clear_error_channels(websocketpp::log::elevel::all);
+	client.init_asio();
+	client.start_perpetual();
+
+	std::thread thread([&client]() { client.run(); });
+
+	std::mutex mutex;
+	std::condition_variable changed;
+
+	std::vector<ClientStats> stats(clientCount);
+	int done = 0;
+
+	std::vector<client_t::connection_ptr> connections;
+
+	const auto start = std::chrono::steady_clock::now();
+
+	const std::string uri = "ws://127.0.0.1:" + std::to_string(port);
+
+	for (int index = 0; index < clientCount; ++index) {
+		websocketpp::lib::error_code ec;
+		auto con = client.get_connection(uri, ec);
+
+		con->set_open_handler(
+			[&client, requestCount](websocketpp::connection_hdl
+							con_hdl) {
+				for (int seq = 0; seq < requestCount; ++seq) {
+					websocketpp::lib::error_code ec;
+
+					client.send(
+						con_hdl,
+						json11::Json(
+							json11::Json::object{
+								{"seq", seq},
+								{"padding",
+								 "some request"}})
+							.dump(),
+						websocketpp::frame::opcode::text,
+						ec);
+				}
+			});
+
+		con->set_message_handler([&, index, requestCount](
+						 websocketpp::connection_hdl,
+						 client_t::message_ptr msg) {
+			std::string err;
+			auto reply = json11::Json::parse(msg->get_payload(),
+							 err);
+
+			std::lock_guard<std::mutex> guard(mutex);
+
+			auto &client = stats[index];
+
+			if (reply["seq"].int_value() != client.received)
+				client.ordered = false;
+
+			const double seconds =
+				std::chrono::duration<double>(
+					std::chrono::steady_clock::now() - start)
+					.count();
+
+			if (!client.received)
+				client.firstSeconds = seconds;
+
+			if (++client.received == requestCount) {
+				client.seconds = seconds;
+
+				++done;
+				changed.notify_all();
+			}
+		});
+
+		client.connect(con);
+		connections.push_back(con);
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+
+		changed.wait_for(lock, std::chrono::seconds(30),
+				 [&]() { return done == clientCount; });
+	}
+
+	client.stop_perpetual();
+
+	for (auto &con : connections) {
+		websocketpp::lib::error_code ec;
+		con->close(websocketpp::close::status::normal, "", ec);
+	}
+
+	client.stop();
+	thread.join();
+
+	std::lock_guard<std::mutex> guard(mutex);
+
+	return stats;
+}
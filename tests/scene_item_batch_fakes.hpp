@@ -0,0 +1,427 @@
+#pragma once
+
+// Fake scenes with groups, and setSceneItemPropertiesById and
+// SetObsSceneItemsPropertiesById() played against them, counting lookups,
+// atomic updates, events and serialized items. Shared by
+// test_scene_item_batch and bench_scene_item_batch.
+
+#include "streamelements/StreamElementsSceneItemBatch.hpp"
+#include "streamelements/StreamElementsSceneItemEventSuppressor.hpp"
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+struct FakeScene;
+
+struct FakeItem {
+	int serial = 0;
+	FakeScene *scene = nullptr;
+	// Set for groups: the group's own scene.
+	FakeScene *group = nullptr;
+
+	// The composition: position, scale, crop and bounds
+	double x = 0;
+	double scale = 1;
+	int cropLeft = 0;
+	double bounds = 0;
+
+	bool visible = true;
+	bool locked = false;
+};
+
+struct FakeScene {
+	std::vector<FakeItem *> items;
+};
+
+// A partial property set, as the API takes it.
+struct FakeProps {
+	bool hasX = false;
+	double x = 0;
+	bool hasScale = false;
+	double scale = 1;
+	bool hasCrop = false;
+	int cropLeft = 0;
+	bool hasBounds = false;
+	double bounds = 0;
+	bool hasVisible = false;
+	bool visible = false;
+	bool hasLocked = false;
+	bool locked = false;
+	int order = -1;
+};
+
+typedef StreamElementsSceneItemBatch<FakeScene, FakeItem, FakeProps> batch_t;
+
+inline bool has_composition(const FakeProps &props)
+{
+	return props.hasX || props.hasScale || props.hasCrop || props.hasBounds;
+}
+
+struct FakeRequest {
+	std::string id;
+	FakeProps props;
+};
+
+struct FakeWorld {
+	std::vector<FakeScene *> scenes; // root scenes
+	std::vector<FakeScene *> allScenes;
+	std::vector<FakeItem *> items;
+
+	StreamElementsSceneItemEventSuppressor suppressor;
+
+	// Items whose transform changed, raised on the next video tick
+	std::vector<FakeItem *> pendingTransforms;
+
+	size_t lookups = 0;
+	size_t atomicUpdates = 0;
+	// What browsers receive, and how many items were serialized for it
+	size_t events = 0;
+	size_t serializedItems = 0;
+	std::map<FakeScene *, size_t> sceneEvents;
+
+	~FakeWorld()
+	{
+		for (auto item : items)
+			delete item;
+
+		for (auto scene : allScenes)
+			delete scene;
+	}
+
+	FakeScene *add_scene(bool rootScene)
+	{
+		auto scene = new FakeScene();
+
+		allScenes.push_back(scene);
+
+		if (rootScene)
+			scenes.push_back(scene);
+
+		return scene;
+	}
+
+	FakeItem *add_item(FakeScene *scene)
+	{
+		auto item = new FakeItem();
+		item->serial = (int)items.size();
+		item->scene = scene;
+
+		items.push_back(item);
+		scene->items.push_back(item);
+
+		return item;
+	}
+
+	FakeScene *root_of(FakeItem *item)
+	{
+		for (auto scene : scenes) {
+			for (auto candidate : scene->items) {
+				if (candidate == item)
+					return scene;
+
+				if (!candidate->group)
+					continue;
+
+				for (auto child : candidate->group->items) {
+					if (child == item)
+						return scene;
+				}
+			}
+		}
+
+		return nullptr;
+	}
+
+	// dispatch_scene_update(): serializes the whole list of the scene.
+	void dispatch_scene(FakeScene *scene)
+	{
+		++events;
+		++sceneEvents[scene];
+
+		for (auto item : scene->items) {
+			++serializedItems;
+
+			if (item->group)
+				serializedItems += item->group->items.size();
+		}
+	}
+
+	// The signal handlers: one item event and one scene update per
+	// signal, unless a batch suppressed them.
+	void signal(FakeItem *item, FakeScene *scene)
+	{
+		if (suppressor.IsSuppressed(item) ||
+		    suppressor.IsSuppressed(scene))
+			return;
+
+		++events;
+		++serializedItems;
+
+		dispatch_scene(root_of(item));
+	}
+
+	// "reorder" is about the scene only
+	void signal_reorder(FakeItem *item)
+	{
+		if (suppressor.IsSuppressed(item->scene))
+			return;
+
+		++events;
+
+		dispatch_scene(root_of(item));
+	}
+
+	void signal_transform(FakeItem *item)
+	{
+		if (suppressor.ConsumeExpectedSignal(item))
+			return;
+
+		signal(item, item->scene);
+	}
+
+	void video_tick()
+	{
+		auto pending = pendingTransforms;
+		pendingTransforms.clear();
+
+		for (auto item : pending)
+			signal_transform(item);
+	}
+
+	// DeserializeSceneItemComposition(): one call per item replaces the
+	// whole composition, a batch merges what it was given.
+	void apply(FakeItem *item, const FakeProps &props, bool merge)
+	{
+		if (has_composition(props)) {
+			if (!merge) {
+				item->x = 0;
+				item->scale = 1;
+				item->cropLeft = 0;
+				item->bounds = 0;
+			}
+
+			if (props.hasX)
+				item->x = props.x;
+			if (props.hasScale)
+				item->scale = props.scale;
+			if (props.hasCrop)
+				item->cropLeft = props.cropLeft;
+			if (props.hasBounds)
+				item->bounds = props.bounds;
+
+			pendingTransforms.push_back(item);
+		}
+
+		if (props.hasVisible) {
+			item->visible = props.visible;
+			signal(item, item->scene);
+		}
+
+		if (props.hasLocked) {
+			item->locked = props.locked;
+			signal(item, item->scene);
+		}
+
+		if (props.order >= 0) {
+			auto &items = item->scene->items;
+
+			items.erase(std::find(items.begin(), items.end(), item));
+			items.insert(items.begin() +
+					     std::min((size_t)props.order,
+						      items.size()),
+				     item);
+
+			signal_reorder(item);
+		}
+	}
+};
+
+inline std::string id_of(const void *p)
+{
+	char buf[32];
+	std::snprintf(buf, sizeof(buf), "%p", p);
+
+	return buf;
+}
+
+// GetPointerFromId()
+inline const void *pointer_from_id(const std::string &id)
+{
+	void *p = nullptr;
+
+	if (!id.size() || std::sscanf(id.c_str(), "%p", &p) != 1)
+		return nullptr;
+
+	return p;
+}
+
+/* ================================================================= */
+
+// setSceneItemPropertiesById, once per request: GetSceneItemById() walks
+// every scene until it finds the item.
+inline void apply_per_item(FakeWorld &world,
+			   const std::vector<FakeRequest> &requests)
+{
+	for (auto &request : requests) {
+		auto key = pointer_from_id(request.id);
+
+		FakeItem *found = nullptr;
+
+		for (auto scene : world.scenes) {
+			for (auto item : scene->items) {
+				++world.lookups;
+
+				if (item == key)
+					found = item;
+
+				if (found || !item->group)
+					continue;
+
+				for (auto child : item->group->items) {
+					++world.lookups;
+
+					if (child == key)
+						found = child;
+				}
+			}
+
+			if (found)
+				break;
+		}
+
+		if (found)
+			world.apply(found, request.props, false);
+	}
+
+	world.video_tick();
+}
+
+// SetObsSceneItemsPropertiesById()
+inline batch_t apply_batch(FakeWorld &world,
+			   const std::vector<FakeRequest> &requests)
+{
+	batch_t batch;
+
+	for (auto &request : requests)
+		batch.Add(request.id, pointer_from_id(request.id),
+			  request.props);
+
+	for (auto scene : world.scenes) {
+		for (auto item : scene->items) {
+			if (batch.IsResolved())
+				break;
+
+			++world.lookups;
+			batch.Resolve(item, scene, scene);
+
+			if (!item->group)
+				continue;
+
+			for (auto child : item->group->items) {
+				++world.lookups;
+				batch.Resolve(child, item->group, scene);
+			}
+		}
+	}
+
+	for (auto &entry : batch.GetEntries()) {
+		if (entry.status != batch_t::STATUS_OK)
+			continue;
+
+		world.suppressor.Suppress(entry.item);
+
+		if (has_composition(entry.props))
+			world.suppressor.ExpectSignal(entry.item);
+	}
+
+	batch.ForEachScene([&](FakeScene *scene,
+			       const std::vector<const batch_t::Entry *> &entries) {
+		world.suppressor.Suppress(scene);
+
+		++world.atomicUpdates;
+
+		for (auto entry : entries)
+			world.apply(entry->item, entry->props, true);
+
+		world.suppressor.Resume(scene);
+	});
+
+	for (auto &entry : batch.GetEntries()) {
+		if (entry.status == batch_t::STATUS_OK)
+			world.suppressor.Resume(entry.item);
+	}
+
+	for (auto scene : batch.GetRootScenes())
+		world.dispatch_scene(scene);
+
+	// After the batch returned
+	world.video_tick();
+
+	return batch;
+}
+
+/* ================================================================= */
+
+// Root scenes of `itemCount` items; a fifth are groups of up to 4 items.
+inline void build_world(FakeWorld &world, std::mt19937 &rng, int sceneCount,
+			int itemCount)
+{
+	for (int s = 0; s < sceneCount; ++s) {
+		auto scene = world.add_scene(true);
+
+		for (int i = 0; i < itemCount; ++i) {
+			auto item = world.add_item(scene);
+
+			if (rng() % 5)
+				continue;
+
+			item->group = world.add_scene(false);
+
+			const int children = 1 + rng() % 4;
+
+			for (int c = 0; c < children; ++c)
+				world.add_item(item->group);
+		}
+	}
+}
+
+inline FakeProps random_props(std::mt19937 &rng, bool withOrder)
+{
+	FakeProps props;
+
+	props.hasX = rng() % 2;
+	props.x = rng() % 1000;
+	props.hasVisible = rng() % 2;
+	props.visible = rng() % 2;
+	props.hasLocked = rng() % 3 == 0;
+	props.locked = rng() % 2;
+
+	if (withOrder && rng() % 4 == 0)
+		props.order = rng() % 8;
+
+	return props;
+}
+
+// The state both paths are compared on.
+inline std::string describe(FakeWorld &world)
+{
+	std::string result;
+
+	for (auto scene : world.allScenes) {
+		for (auto item : scene->items)
+			result += std::to_string(item->serial) + ":" +
+				  std::to_string((int)item->x) + "," +
+				  std::to_string((int)item->scale) + "," +
+				  std::to_string(item->cropLeft) + "," +
+				  std::to_string((int)item->bounds) +
+				  (item->visible ? "v" : "-") +
+				  (item->locked ? "l" : "-") + " ";
+
+		result += "\n";
+	}
+
+	return result;
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+// A fake scene of items showing fake sources, serialized and invalidated the
+// way StreamElementsObsSceneManager does, shared by
+// test_scene_item_fragment_cache and bench_scene_item_fragment_cache.
+
+#include "streamelements/StreamElementsSceneItemFragmentCache.hpp"
+
+#include <map>
+#include <string>
+#include <vector>
+
+typedef StreamElementsSceneItemFragmentCache<std::string, const void *>
+	cache_t;
+
+struct FakeSource {
+	std::string name;
+	std::map<std::string, std::string> settings;
+	std::vector<std::string> filters;
+};
+
+struct FakeItem {
+	FakeSource *source = nullptr;
+	double x = 0, y = 0, scale = 1;
+	bool visible = true;
+	bool locked = false;
+	std::string auxiliaryData;
+};
+
+struct FakeScene {
+	std::vector<FakeSource> sources;
+	std::vector<FakeItem> items;
+	std::vector<FakeItem *> order;
+};
+
+// Stands in for SerializeSourceAndSceneItem(): everything but the order.
+inline std::string serialize_item(const FakeItem &item)
+{
+	std::string result = "{\"name\":\"" + item.source->name + "\"";
+
+	result += ",\"x\":" + std::to_string(item.x);
+	result += ",\"y\":" + std::to_string(item.y);
+	result += ",\"scale\":" + std::to_string(item.scale);
+	result += item.visible ? ",\"visible\":true" : ",\"visible\":false";
+	result += item.locked ? ",\"locked\":true" : ",\"locked\":false";
+	result += ",\"auxiliaryData\":\"" + item.auxiliaryData + "\"";
+
+	result += ",\"settings\":{";
+	for (auto &kv : item.source->settings)
+		result += "\"" + kv.first + "\":\"" + kv.second + "\",";
+	result += "}";
+
+	result += ",\"filters\":[";
+	for (auto &filter : item.source->filters)
+		result += "\"" + filter + "\",";
+	result += "]}";
+
+	return result;
+}
+
+inline std::string with_order(const std::string &fragment, size_t order)
+{
+	return fragment + "@" + std::to_string(order);
+}
+
+inline std::string serialize_scene_fresh(const FakeScene &scene)
+{
+	std::string result;
+
+	for (size_t i = 0; i < scene.order.size(); ++i)
+		result += with_order(serialize_item(*scene.order[i]), i) + "\n";
+
+	return result;
+}
+
+// Stands in for SerializeObsSceneItems() with the cache.
+inline std::string serialize_scene_cached(const FakeScene &scene,
+					  cache_t &cache,
+					  const void *variant)
+{
+	std::string result;
+
+	for (size_t i = 0; i < scene.order.size(); ++i) {
+		const FakeItem *item = scene.order[i];
+
+		std::string fragment;
+
+		if (!cache.Get(item, variant, fragment)) {
+			const uint64_t generation = cache.GetGeneration();
+
+			fragment = serialize_item(*item);
+
+			cache.Put(item, item->source, variant, fragment,
+				  generation);
+		}
+
+		result += with_order(fragment, i) + "\n";
+	}
+
+	return result;
+}
+
+// What the plugin's signal handlers invalidate, per signal.
+inline void raise_item_signal(cache_t &cache, const FakeItem *item)
+{
+	// item_transform, item_visible, item_locked, item_select,
+	// item_deselect, item_add, item_remove, private settings
+	cache.InvalidateItem(item);
+}
+
+inline void raise_source_signal(cache_t &cache, const FakeSource *source)
+{
+	// rename, update, filter_add, filter_remove, reorder_filters, and a
+	// filter's own update or rename through its parent
+	cache.InvalidateSource(source);
+}
+
+inline void raise_reorder_signal(cache_t &cache)
+{
+	cache.InvalidateAll();
+}
+
+inline void build_scene(FakeScene &scene, size_t sourceCount,
+			size_t itemCount, size_t settingCount)
+{
+	scene.sources.resize(sourceCount);
+	for (size_t i = 0; i < sourceCount; ++i) {
+		scene.sources[i].name = "Source " + std::to_string(i);
+
+		for (size_t k = 0; k < settingCount; ++k)
+			scene.sources[i].settings["key" + std::to_string(k)] =
+				"value " + std::to_string(k * i);
+
+		scene.sources[i].filters = {"Color Correction", "Crop"};
+	}
+
+	scene.items.resize(itemCount);
+	scene.order.clear();
+	for (size_t i = 0; i < itemCount; ++i) {
+		// Several items may show one source.
+		scene.items[i].source = &scene.sources[i % sourceCount];
+		scene.items[i].x = (double)i;
+		scene.order.push_back(&scene.items[i]);
+	}
+}
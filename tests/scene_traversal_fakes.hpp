@@ -0,0 +1,299 @@
+#pragma once
+
+// A fake scene graph with groups, the std::function based walks
+// StreamElementsSceneTraversal replaced, and counters for allocations,
+// references and scene locks, shared by test_scene_traversal and
+// bench_scene_traversal. Replaces the global operator new and delete, so
+// include it from one translation unit per program.
+
+#include "streamelements/StreamElementsSceneTraversal.hpp"
+
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <random>
+#include <vector>
+
+static size_t s_allocations = 0;
+
+void *operator new(size_t size)
+{
+	++s_allocations;
+
+	void *p = std::malloc(size ? size : 1);
+
+	if (!p)
+		throw std::bad_alloc();
+
+	return p;
+}
+
+void operator delete(void *p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+	std::free(p);
+}
+
+/* ================================================================= */
+
+struct FakeScene;
+
+struct FakeItem {
+	int serial = 0;
+	// Set for groups: the group's own scene.
+	FakeScene *group = nullptr;
+	long refs = 1;
+};
+
+struct FakeScene {
+	std::vector<FakeItem *> items;
+	// Held while the scene's items are enumerated, as libobs would.
+	int locks = 0;
+};
+
+static long s_addrefs = 0;
+static long s_releases = 0;
+
+// Scene locks held right now, and enumerations which started while another
+// scene was locked.
+static int s_heldLocks = 0;
+static int s_nestedLocks = 0;
+
+struct FakeApi {
+	typedef FakeScene scene_t;
+	typedef FakeItem item_t;
+
+	static void enum_items(FakeScene *scene,
+			       bool (*callback)(FakeScene *, FakeItem *, void *),
+			       void *param)
+	{
+		if (s_heldLocks)
+			++s_nestedLocks;
+
+		++scene->locks;
+		++s_heldLocks;
+
+		for (auto item : scene->items) {
+			if (!callback(scene, item, param))
+				break;
+		}
+
+		--s_heldLocks;
+		--scene->locks;
+	}
+
+	static void group_enum_items(FakeItem *group,
+				     bool (*callback)(FakeScene *, FakeItem *,
+						      void *),
+				     void *param)
+	{
+		enum_items(group->group, callback, param);
+	}
+
+	static bool is_group(FakeItem *item) { return !!item->group; }
+
+	static void addref(FakeItem *item)
+	{
+		++item->refs;
+		++s_addrefs;
+	}
+
+	static void release(FakeItem *item)
+	{
+		--item->refs;
+		++s_releases;
+	}
+};
+
+typedef StreamElementsSceneTraversal<FakeApi> traversal_t;
+
+/* ================================================================= */
+
+// The old scanGroupSceneItems() / scanSceneItems().
+typedef std::function<bool(FakeItem *, FakeItem *)> scan_callback_t;
+
+inline bool old_scan_group(FakeItem *group, scan_callback_t callback,
+			   bool recursive)
+{
+	struct data_t {
+		scan_callback_t callback;
+		bool recursive;
+		FakeItem *group;
+		bool result;
+	};
+
+	data_t data = {callback, recursive, group, true};
+
+	FakeApi::group_enum_items(
+		group,
+		[](FakeScene *, FakeItem *item, void *data_p) -> bool {
+			auto data = (data_t *)data_p;
+
+			if (data->recursive && FakeApi::is_group(item))
+				data->result = old_scan_group(
+					item, data->callback, data->recursive);
+
+			if (data->result)
+				data->result = data->callback(item, data->group);
+
+			return data->result;
+		},
+		&data);
+
+	return data.result;
+}
+
+inline bool old_scan_scene(FakeScene *scene, scan_callback_t callback,
+			   bool recursive)
+{
+	struct data_t {
+		scan_callback_t callback;
+		bool recursive;
+		bool result;
+	};
+
+	data_t data = {callback, recursive, true};
+
+	FakeApi::enum_items(
+		scene,
+		[](FakeScene *, FakeItem *item, void *data_p) -> bool {
+			auto data = (data_t *)data_p;
+
+			if (data->recursive && FakeApi::is_group(item))
+				data->result = old_scan_group(
+					item, data->callback, data->recursive);
+
+			if (data->result)
+				data->result = data->callback(item, nullptr);
+
+			return data->result;
+		},
+		&data);
+
+	return data.result;
+}
+
+// The old ObsSceneEnumAllItems().
+inline void old_enum_all_items(FakeScene *scene,
+			       std::function<bool(FakeItem *)> func)
+{
+	struct local_context {
+		std::vector<FakeItem *> items;
+	};
+
+	auto collect = [](FakeScene *, FakeItem *item, void *param) -> bool {
+		FakeApi::addref(item);
+
+		((local_context *)param)->items.push_back(item);
+
+		return true;
+	};
+
+	local_context pass1_context;
+	FakeApi::enum_items(scene, collect, &pass1_context);
+
+	local_context pass2_context;
+
+	for (auto item : pass1_context.items) {
+		pass2_context.items.push_back(item);
+
+		if (FakeApi::is_group(item))
+			FakeApi::group_enum_items(item, collect,
+						  &pass2_context);
+	}
+
+	bool keepCalling = true;
+
+	for (auto item : pass2_context.items) {
+		if (keepCalling)
+			keepCalling = func(item);
+
+		FakeApi::release(item);
+	}
+}
+
+/* ================================================================= */
+
+struct FakeWorld {
+	std::vector<FakeScene *> scenes;
+	std::vector<FakeItem *> items;
+	int serial = 0;
+
+	~FakeWorld()
+	{
+		for (auto item : items)
+			delete item;
+
+		for (auto scene : scenes)
+			delete scene;
+	}
+
+	FakeScene *add_scene()
+	{
+		scenes.push_back(new FakeScene());
+
+		return scenes.back();
+	}
+
+	FakeItem *add_item(FakeScene *scene)
+	{
+		auto item = new FakeItem();
+		item->serial = serial++;
+
+		items.push_back(item);
+		scene->items.push_back(item);
+
+		return item;
+	}
+
+	FakeItem *add_group(FakeScene *scene)
+	{
+		auto item = add_item(scene);
+		item->group = add_scene();
+
+		return item;
+	}
+
+	bool refs_balanced() const
+	{
+		for (auto item : items) {
+			if (item->refs != 1)
+				return false;
+		}
+
+		return true;
+	}
+};
+
+// `itemCount` top-level items, a quarter of which are groups of up to 4
+// items, with groups nested in groups `depth` deep.
+inline FakeScene *build_scene(FakeWorld &world, std::mt19937 &rng,
+			      int itemCount, int depth)
+{
+	auto scene = world.add_scene();
+
+	for (int i = 0; i < itemCount; ++i) {
+		if (rng() % 4) {
+			world.add_item(scene);
+			continue;
+		}
+
+		auto group = world.add_group(scene);
+
+		for (int d = 0; d < depth; ++d) {
+			const int children = rng() % 5;
+
+			for (int c = 0; c < children; ++c)
+				world.add_item(group->group);
+
+			if (d + 1 < depth)
+				group = world.add_group(group->group);
+		}
+	}
+
+	return scene;
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+// StreamElementsSecretRedactor::Redact() as it was before the streaming
+// rewrite, shared by test_secret_redactor and bench_secret_redactor.
+
+#include <cctype>
+#include <cstring>
+#include <string>
+
+// Whole-buffer Redact() as it was before the streaming rewrite.
+namespace reference {
+
+static const char *const REDACTED = "[redacted]";
+
+static bool IsSecretKeyName(const std::string &name)
+{
+	return name == "key" || name == "password" || name == "bearer_token";
+}
+
+static size_t FindClosingQuote(const std::string &content, size_t start)
+{
+	for (size_t i = start; i < content.size(); ++i) {
+		if (content[i] == '\\') {
+			++i;
+
+			continue;
+		}
+
+		if (content[i] == '"')
+			return i;
+	}
+
+	return std::string::npos;
+}
+
+static bool RedactUrlUserInfo(const std::string &url, std::string &result)
+{
+	const size_t schemeEnd = url.find("://");
+
+	if (schemeEnd == std::string::npos)
+		return false;
+
+	const size_t authorityStart = schemeEnd + 3;
+
+	size_t authorityEnd = url.size();
+
+	for (size_t i = authorityStart; i < url.size(); ++i) {
+		if (url[i] == '/' || url[i] == '?' || url[i] == '#') {
+			authorityEnd = i;
+
+			break;
+		}
+	}
+
+	const size_t at = url.rfind('@', authorityEnd);
+
+	if (at == std::string::npos || at < authorityStart)
+		return false;
+
+	result = url.substr(0, authorityStart) + REDACTED +
+		 url.substr(at, url.size() - at);
+
+	return true;
+}
+
+static std::string Redact(const std::string &content)
+{
+	std::string result;
+
+	size_t i = 0;
+
+	while (i < content.size()) {
+		if (content[i] != '"') {
+			result += content[i++];
+
+			continue;
+		}
+
+		const size_t nameStart = i + 1;
+		const size_t nameEnd = FindClosingQuote(content, nameStart);
+
+		if (nameEnd == std::string::npos) {
+			result.append(content, i, std::string::npos);
+
+			break;
+		}
+
+		const std::string name =
+			content.substr(nameStart, nameEnd - nameStart);
+
+		size_t cursor = nameEnd + 1;
+
+		while (cursor < content.size() &&
+		       isspace((unsigned char)content[cursor]))
+			++cursor;
+
+		bool handled = false;
+
+		if (cursor < content.size() && content[cursor] == ':') {
+			++cursor;
+
+			while (cursor < content.size() &&
+			       isspace((unsigned char)content[cursor]))
+				++cursor;
+
+			if (cursor < content.size() && content[cursor] == '"') {
+				const size_t valueStart = cursor + 1;
+				const size_t valueEnd =
+					FindClosingQuote(content, valueStart);
+
+				if (valueEnd != std::string::npos) {
+					const std::string value = content.substr(
+						valueStart, valueEnd - valueStart);
+
+					std::string replacement;
+					bool redact = false;
+
+					if (IsSecretKeyName(name)) {
+						replacement = REDACTED;
+						redact = true;
+					} else if (name == "server") {
+						redact = RedactUrlUserInfo(
+							value, replacement);
+					}
+
+					if (redact) {
+						result.append(content, i,
+							      valueStart - i);
+						result += replacement;
+						result += '"';
+
+						i = valueEnd + 1;
+						handled = true;
+					}
+				}
+			}
+		}
+
+		if (!handled) {
+			result.append(content, i, nameEnd + 1 - i);
+
+			i = nameEnd + 1;
+		}
+	}
+
+	return result;
+}
+
+} // namespace reference
@@ -0,0 +1,492 @@
+// Behavioural test for streamelements/StreamElementsAnalyticsUploader and the
+// spool beneath it.
+//
+// A local HTTP server stands in for the analytics endpoint and can be told to
+// fail, drop (answer too late), reject or refuse gzip. Events must arrive
+// batched and compressed, exactly once and in order through failures, survive
+// a restart with the network down, and a rejected batch must not block the
+// events behind it. A compressed batch rejected with any 4xx is retried
+// uncompressed before it is dropped, and every dropped batch is logged. A
+// batch is due by the append time of its oldest record, not by the time the
+// previous batch went out.
+
+#include "streamelements/StreamElementsAnalyticsUploader.hpp"
+#include "streamelements/deps/cpp-httplib/httplib.h"
+#include "json11/json11.hpp"
+
+#define MINIZ_HEADER_FILE_ONLY
+#define MINIZ_NO_ZLIB_COMPATIBLE_NAMES
+#include "streamelements/deps/zip/miniz.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+typedef StreamElementsAnalyticsUploader Uploader;
+
+static int failures = 0;
+
+static void check(bool cond, const char *msg)
+{
+	if (!cond) {
+		std::fprintf(stderr, "FAIL: %s\n", msg);
+		++failures;
+	}
+}
+
+static std::string gunzip(const std::string &input)
+{
+	if (input.size() < 18 || (unsigned char)input[0] != 0x1f ||
+	    (unsigned char)input[1] != 0x8b)
+		return "";
+
+	size_t size = 0;
+	void *out = tinfl_decompress_mem_to_heap(input.data() + 10,
+						 input.size() - 18, &size, 0);
+	if (!out)
+		return "";
+
+	std::string result((const char *)out, size);
+	mz_free(out);
+	return result;
+}
+
+// The analytics endpoint stand-in.
+struct StandIn {
+	httplib::Server server;
+	std::thread thread;
+	int port = 0;
+
+	std::mutex mutex;
+	std::vector<int> received;
+	size_t requests = 0;
+	size_t compressed = 0;
+	std::vector<size_t> batchSizes;
+
+	std::atomic<int> failNext{0};
+	std::atomic<int> dropNext{0};
+	std::atomic<int> rejectNext{0};
+
+	StandIn()
+	{
+		server.Post("/batch", [this](const httplib::Request &req,
+					     httplib::Response &res) {
+			std::string body = req.body;
+
+			{
+				std::lock_guard<std::mutex> guard(mutex);
+				++requests;
+			}
+
+			if (failNext > 0) {
+				--failNext;
+				res.status = 503;
+				return;
+			}
+
+			if (dropNext > 0) {
+				// Answered after the client gave up.
+				--dropNext;
+				std::this_thread::sleep_for(
+					std::chrono::milliseconds(500));
+				res.status = 200;
+				return;
+			}
+
+			if (rejectNext > 0) {
+				--rejectNext;
+				res.status = 400;
+				return;
+			}
+
+			bool gzip = req.get_header_value(
+					    "X-Content-Encoding") == "gzip";
+
+			if (gzip)
+				body = gunzip(body);
+
+			std::string error;
+			auto json = json11::Json::parse(body, error);
+
+			if (!json.is_array()) {
+				res.status = 400;
+				return;
+			}
+
+			std::lock_guard<std::mutex> guard(mutex);
+
+			if (gzip)
+				++compressed;
+
+			batchSizes.push_back(json.array_items().size());
+
+			for (auto &item : json.array_items())
+				received.push_back(item["i"].int_value());
+
+			res.status = 200;
+		});
+
+		port = server.bind_to_any_port("127.0.0.1");
+		thread = std::thread([this]() { server.listen_after_bind(); });
+
+		while (!server.is_running())
+			std::this_thread::yield();
+	}
+
+	~StandIn()
+	{
+		server.stop();
+		thread.join();
+	}
+
+	std::vector<int> Received()
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+		return received;
+	}
+
+	bool WaitFor(size_t count)
+	{
+		for (int i = 0; i < 500; ++i) {
+			if (Received().size() >= count)
+				return true;
+			std::this_thread::sleep_for(
+				std::chrono::milliseconds(10));
+		}
+		return false;
+	}
+
+	// `hideEncoding` keeps httplib, built without zlib, from refusing
+	// gzip bodies itself; the stand-in decodes them.
+	Uploader::transport_t Transport(bool hideEncoding = true)
+	{
+		return [this, hideEncoding](const std::string &body,
+					    const Uploader::headers_t &headers) {
+			httplib::Client client("127.0.0.1", port);
+			client.set_read_timeout(0, 200 * 1000);
+
+			httplib::Headers requestHeaders;
+			std::string contentType;
+
+			for (auto &kv : headers) {
+				if (kv.first == "Content-Type")
+					contentType = kv.second;
+				else if (kv.first == "Content-Encoding" &&
+					 hideEncoding)
+					requestHeaders.emplace(
+						"X-Content-Encoding", kv.second);
+				else
+					requestHeaders.emplace(kv.first,
+							       kv.second);
+			}
+
+			auto result = client.Post("/batch", requestHeaders,
+						  body, contentType.c_str());
+
+			return result ? result->status : 0;
+		};
+	}
+};
+
+static std::string event(int i)
+{
+	return json11::Json(json11::Json::object{{"i", i}, {"name", "test"}})
+		.dump();
+}
+
+static std::vector<int> range(int from, int to)
+{
+	std::vector<int> result;
+	for (int i = from; i < to; ++i)
+		result.push_back(i);
+	return result;
+}
+
+static fs::path fresh_dir(const char *name)
+{
+	fs::path dir = fs::temp_directory_path() / name;
+	fs::remove_all(dir);
+	fs::create_directories(dir);
+	return dir;
+}
+
+static Uploader::Options fast_options()
+{
+	Uploader::Options options;
+	options.maxBatchEvents = 50;
+	options.maxBatchAge = std::chrono::milliseconds(300);
+	options.initialBackoff = std::chrono::milliseconds(20);
+	options.maxBackoff = std::chrono::milliseconds(200);
+	return options;
+}
+
+static void test_batching()
+{
+	fs::path dir = fresh_dir("se_analytics_batching");
+	StandIn standIn;
+
+	{
+		Uploader uploader((dir / "spool.jsonl").string(),
+				  standIn.Transport(), fast_options());
+
+		for (int i = 0; i < 120; ++i)
+			uploader.Add(event(i));
+
+		check(standIn.WaitFor(120), "every event is delivered");
+
+		// The stand-in sees a batch before the uploader counts it.
+		check(uploader.Flush(std::chrono::seconds(5)),
+		      "the spool drains");
+
+		auto stats = uploader.GetStats();
+		check(stats.eventsSent == 120 && stats.requestsSent == 3,
+		      "120 events go out as three requests");
+	}
+
+	check(standIn.Received() == range(0, 120),
+	      "events arrive once, in order");
+	check(standIn.batchSizes == std::vector<size_t>({50, 50, 20}),
+	      "batches are cut by count, the remainder by age");
+	check(standIn.compressed == 3, "batches are gzip compressed");
+	check(fs::file_size(dir / "spool.jsonl") == 0,
+	      "a drained spool is truncated");
+
+	fs::remove_all(dir);
+}
+
+static void test_failures()
+{
+	fs::path dir = fresh_dir("se_analytics_failures");
+	StandIn standIn;
+
+	standIn.failNext = 2;
+	standIn.dropNext = 1;
+
+	std::mutex logMutex;
+	std::vector<std::string> logged;
+
+	Uploader::Options options = fast_options();
+	options.log = [&](const std::string &message) {
+		std::lock_guard<std::mutex> guard(logMutex);
+		logged.push_back(message);
+	};
+
+	Uploader uploader((dir / "spool.jsonl").string(), standIn.Transport(),
+			  options);
+
+	for (int i = 0; i < 30; ++i)
+		uploader.Add(event(i));
+
+	check(uploader.Flush(std::chrono::seconds(5)),
+	      "the spool drains despite failures");
+	check(standIn.Received() == range(0, 30),
+	      "failed and dropped requests are retried without loss");
+	check(uploader.GetStats().requestsFailed == 3,
+	      "every failed attempt is counted");
+
+	// A rejected batch is dropped, not retried forever: once compressed,
+	// once plain.
+	const size_t compressedBeforeReject = standIn.compressed;
+	standIn.rejectNext = 2;
+
+	for (int i = 30; i < 40; ++i)
+		uploader.Add(event(i));
+
+	check(uploader.Flush(std::chrono::seconds(5)),
+	      "a rejected batch does not block the queue");
+
+	for (int i = 40; i < 45; ++i)
+		uploader.Add(event(i));
+
+	check(uploader.Flush(std::chrono::seconds(5)) && standIn.WaitFor(35),
+	      "events after a rejection are delivered");
+	check(uploader.GetStats().eventsRejected == 10,
+	      "the rejected events are counted");
+	check(standIn.compressed > compressedBeforeReject,
+	      "a batch rejected plain too leaves compression on");
+
+	{
+		std::lock_guard<std::mutex> guard(logMutex);
+
+		check(logged.size() == 1 &&
+			      logged[0].find("10 event(s)") != std::string::npos &&
+			      logged[0].find("400") != std::string::npos,
+		      "the dropped batch is logged");
+	}
+
+	// Rejected compressed, accepted plain: the server refuses gzip.
+	const size_t compressedBefore = standIn.compressed;
+	standIn.rejectNext = 1;
+
+	for (int i = 45; i < 50; ++i)
+		uploader.Add(event(i));
+
+	check(uploader.Flush(std::chrono::seconds(5)) && standIn.WaitFor(40),
+	      "a batch rejected compressed goes through plain");
+
+	for (int i = 50; i < 55; ++i)
+		uploader.Add(event(i));
+
+	check(uploader.Flush(std::chrono::seconds(5)) && standIn.WaitFor(45),
+	      "events after the plain retry are delivered");
+	check(standIn.compressed == compressedBefore,
+	      "a plain retry which goes through turns compression off");
+
+	std::vector<int> expected = range(0, 30);
+	for (int i = 40; i < 55; ++i)
+		expected.push_back(i);
+	check(standIn.Received() == expected,
+	      "only the rejected batch is missing");
+
+	fs::remove_all(dir);
+}
+
+static void test_survives_restart()
+{
+	fs::path dir = fresh_dir("se_analytics_restart");
+	const std::string spool = (dir / "spool.jsonl").string();
+
+	{
+		// Offline: nothing answers.
+		Uploader uploader(
+			spool,
+			[](const std::string &, const Uploader::headers_t &) {
+				return 0;
+			},
+			fast_options());
+
+		for (int i = 0; i < 25; ++i)
+			uploader.Add(event(i));
+
+		check(!uploader.Flush(std::chrono::milliseconds(300)),
+		      "nothing drains while offline");
+	}
+
+	// A record torn by a crash mid-append.
+	{
+		std::ofstream out(spool, std::ios::binary | std::ios::app);
+		out << "{\"i\":99";
+	}
+
+	StandIn standIn;
+
+	{
+		Uploader uploader(spool, standIn.Transport(), fast_options());
+
+		check(uploader.Flush(std::chrono::seconds(5)),
+		      "the next session drains the spool on its own");
+	}
+
+	check(standIn.Received() == range(0, 25),
+	      "events queued offline survive a restart; torn records do not");
+
+	fs::remove_all(dir);
+}
+
+static void test_gzip_refused()
+{
+	fs::path dir = fresh_dir("se_analytics_no_gzip");
+	StandIn standIn;
+
+	// httplib built without zlib answers gzip bodies with 415. Any other
+	// 4xx is handled the same way; see test_failures().
+	Uploader uploader((dir / "spool.jsonl").string(),
+			  standIn.Transport(false), fast_options());
+
+	for (int i = 0; i < 5; ++i)
+		uploader.Add(event(i));
+
+	check(uploader.Flush(std::chrono::seconds(5)) &&
+		      standIn.Received() == range(0, 5),
+	      "a server refusing gzip gets plain JSON");
+	check(standIn.compressed == 0, "nothing compressed after a 415");
+
+	fs::remove_all(dir);
+}
+
+static void test_spool_age()
+{
+	typedef std::chrono::steady_clock clock;
+
+	fs::path dir = fresh_dir("se_analytics_spool_age");
+	const std::string path = (dir / "spool.jsonl").string();
+
+	{
+		StreamElementsAnalyticsSpool spool(path);
+		spool.Open();
+
+		spool.Append(event(0));
+		spool.Append(event(1));
+	}
+
+	StreamElementsAnalyticsSpool spool(path);
+	spool.Open();
+
+	check(spool.GetOldestPendingTime() == clock::time_point(),
+	      "records from an earlier session are overdue");
+
+	std::vector<std::string> records;
+	uint64_t endOffset = 0;
+
+	spool.Peek(2, 1024, records, endOffset);
+	spool.Commit(endOffset);
+
+	const auto before = clock::now();
+	spool.Append(event(2));
+	const auto after = clock::now();
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+	spool.Append(event(3));
+
+	check(spool.GetOldestPendingTime() >= before &&
+		      spool.GetOldestPendingTime() <= after,
+	      "the oldest record's append time is reported");
+
+	spool.Peek(1, 1024, records, endOffset);
+	spool.Commit(endOffset);
+
+	check(spool.GetOldestPendingTime() > after,
+	      "a commit moves on to the next record's append time, not to "
+	      "the time of the commit");
+
+	fs::remove_all(dir);
+}
+
+static void test_gzip()
+{
+	std::string input;
+	for (int i = 0; i < 1000; ++i)
+		input += event(i);
+
+	const std::string gz = Uploader::Gzip(input);
+
+	check(gz.size() < input.size() / 4, "JSON compresses well");
+	check(gunzip(gz) == input, "gzip round-trips");
+}
+
+int main()
+{
+	test_gzip();
+	test_spool_age();
+	test_batching();
+	test_failures();
+	test_survives_restart();
+	test_gzip_refused();
+
+	if (failures) {
+		std::fprintf(stderr, "%d check(s) failed\n", failures);
+		return 1;
+	}
+
+	std::puts("test_analytics_uploader: all checks passed");
+	return 0;
+}
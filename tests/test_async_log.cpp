@@ -0,0 +1,415 @@
+// Behavioural test for streamelements/StreamElementsAsyncLog.
+//
+// Checks per-call-site suppression and its "suppressed N messages"
+// summaries, window roll-over, runtime severity filtering, queue overflow,
+// ordering under concurrent callers, synchronous logging after Shutdown(),
+// the marker on messages cut at MAX_MESSAGE_SIZE and the valid level range.
+
+#include "streamelements/StreamElementsAsyncLog.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef StreamElementsAsyncLog log_t;
+
+static int failures = 0;
+
+static void check(bool cond, const char *msg)
+{
+	if (!cond) {
+		std::fprintf(stderr, "FAIL: %s\n", msg);
+		++failures;
+	}
+}
+
+struct Capture {
+	std::mutex mutex;
+	std::vector<std::pair<int, std::string>> lines;
+
+	log_t::sink_t GetSink()
+	{
+		return [this](int level, const char *message) {
+			std::lock_guard<std::mutex> guard(mutex);
+			lines.emplace_back(level, message);
+		};
+	}
+
+	std::vector<std::string> Messages()
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+
+		std::vector<std::string> result;
+		for (auto &line : lines) {
+			if (line.second.find("suppressed") == std::string::npos &&
+			    line.second.find("dropped") == std::string::npos)
+				result.push_back(line.second);
+		}
+
+		return result;
+	}
+
+	// Sum of N over "suppressed N messages" summaries.
+	uint64_t Suppressed()
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+
+		uint64_t result = 0;
+		for (auto &line : lines) {
+			unsigned long long n = 0;
+			const size_t pos = line.second.find("suppressed ");
+
+			if (pos != std::string::npos &&
+			    1 == std::sscanf(line.second.c_str() + pos,
+					     "suppressed %llu messages", &n))
+				result += n;
+		}
+
+		return result;
+	}
+
+	size_t Count(const char *needle)
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+
+		return std::count_if(lines.begin(), lines.end(),
+				     [&](const std::pair<int, std::string> &l) {
+					     return l.second.find(needle) !=
+						    std::string::npos;
+				     });
+	}
+};
+
+/* ================================================================= */
+
+static void test_suppression()
+{
+	Capture capture;
+
+	log_t::Options options;
+	options.burst = 3;
+	options.windowMs = 60000;
+
+	log_t log(capture.GetSink(), options);
+
+	static log_t::CallSite site(__FILE__, 1000);
+	static log_t::CallSite other(__FILE__, 2000);
+
+	for (int i = 0; i < 10; ++i)
+		log.Log(site, log_t::LEVEL_INFO, "message %d", i);
+
+	log.Log(other, log_t::LEVEL_WARNING, "other call site");
+
+	log.Flush();
+
+	auto messages = capture.Messages();
+
+	check(messages.size() == 4, "burst messages are written");
+	check(messages.size() == 4 && messages[0] == "message 0" &&
+		      messages[2] == "message 2" &&
+		      messages[3] == "other call site",
+	      "the first messages of a window are the ones kept");
+	check(capture.Suppressed() == 7,
+	      "the summary counts the suppressed messages");
+	check(capture.Count("suppressed 7 messages from test_async_log.cpp:1000") ==
+		      1,
+	      "the summary names the call site");
+	check(log.GetStats().suppressed == 7, "suppressions are counted");
+
+	log.Flush();
+	check(capture.Count("suppressed") == 1,
+	      "a summary is only written once");
+
+	bool infoLevel = false;
+	{
+		std::lock_guard<std::mutex> guard(capture.mutex);
+		for (auto &line : capture.lines) {
+			if (line.second.find("suppressed") != std::string::npos)
+				infoLevel = line.first == log_t::LEVEL_INFO;
+		}
+	}
+	check(infoLevel, "the summary has the level of the suppressed messages");
+}
+
+static void test_window_roll_over()
+{
+	Capture capture;
+
+	log_t::Options options;
+	options.burst = 2;
+	options.windowMs = 100;
+
+	log_t log(capture.GetSink(), options);
+
+	static log_t::CallSite site(__FILE__, __LINE__);
+
+	for (int i = 0; i < 5; ++i)
+		log.Log(site, log_t::LEVEL_INFO, "first window %d", i);
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+	for (int i = 0; i < 5; ++i)
+		log.Log(site, log_t::LEVEL_INFO, "second window %d", i);
+
+	log.Flush();
+
+	auto messages = capture.Messages();
+
+	check(messages.size() == 4 && messages[0] == "first window 0" &&
+		      messages[1] == "first window 1" &&
+		      messages[2] == "second window 0" &&
+		      messages[3] == "second window 1",
+	      "each window gets its own burst");
+	check(capture.Suppressed() == 6,
+	      "summaries account for every suppressed message");
+}
+
+static void test_severity()
+{
+	Capture capture;
+
+	log_t log(capture.GetSink(), log_t::Options());
+
+	static log_t::CallSite site(__FILE__, __LINE__);
+
+	log.Log(site, log_t::LEVEL_DEBUG, "debug");
+	log.SetMinLevel(log_t::LEVEL_DEBUG);
+	log.Log(site, log_t::LEVEL_DEBUG, "debug enabled");
+	log.SetMinLevel(log_t::LEVEL_WARNING);
+	log.Log(site, log_t::LEVEL_INFO, "info");
+	log.Log(site, log_t::LEVEL_ERROR, "error");
+
+	log.Flush();
+
+	auto messages = capture.Messages();
+
+	check(messages.size() == 2 && messages[0] == "debug enabled" &&
+		      messages[1] == "error",
+	      "the minimum level applies at runtime");
+	check(log.GetStats().suppressed == 0,
+	      "filtered messages do not count as suppressed");
+
+	// SE_LOG() goes through the process-wide instance.
+	Capture global;
+	log_t::GetInstance()->SetSink(global.GetSink());
+	log_t::GetInstance()->SetMinLevel(log_t::LEVEL_INFO);
+
+	int evaluated = 0;
+	SE_LOG(log_t::LEVEL_DEBUG, "%d", ++evaluated);
+	SE_LOG(log_t::LEVEL_INFO, "evaluated %d", ++evaluated);
+
+	log_t::GetInstance()->Flush();
+
+	check(evaluated == 1,
+	      "SE_LOG() does not evaluate arguments of filtered messages");
+	check(global.Messages().size() == 1 &&
+		      global.Messages()[0] == "evaluated 1",
+	      "SE_LOG() writes through the process-wide instance");
+
+	log_t::GetInstance()->SetSink(nullptr);
+}
+
+static void test_overflow()
+{
+	Capture capture;
+
+	std::mutex gateMutex;
+	std::condition_variable gateChanged;
+	bool open = false;
+	bool entered = false;
+
+	log_t::Options options;
+	options.capacity = 8;
+	options.burst = 0;
+
+	log_t log(
+		[&](int level, const char *message) {
+			{
+				std::unique_lock<std::mutex> lock(gateMutex);
+				entered = true;
+				gateChanged.notify_all();
+				gateChanged.wait(lock, [&]() { return open; });
+			}
+
+			capture.GetSink()(level, message);
+		},
+		options);
+
+	static log_t::CallSite site(__FILE__, __LINE__);
+
+	// Park the writer inside the sink so nothing is freed.
+	log.Log(site, log_t::LEVEL_INFO, "blocker");
+
+	{
+		std::unique_lock<std::mutex> lock(gateMutex);
+		gateChanged.wait_for(lock, std::chrono::seconds(5),
+				     [&]() { return entered; });
+	}
+
+	for (int i = 0; i < 50; ++i)
+		log.Log(site, log_t::LEVEL_INFO, "overflow %d", i);
+
+	{
+		std::lock_guard<std::mutex> guard(gateMutex);
+		open = true;
+		gateChanged.notify_all();
+	}
+
+	log.Flush();
+
+	const auto stats = log.GetStats();
+	const size_t written = capture.Messages().size();
+
+	check(stats.dropped > 0, "a full queue drops messages");
+	check(written - 1 + stats.dropped == 50,
+	      "every message is either written or dropped");
+	check(capture.Count("dropped") == 1, "drops are reported once");
+
+	char expected[64];
+	std::snprintf(expected, sizeof(expected), "dropped %llu messages",
+		      (unsigned long long)stats.dropped);
+	check(capture.Count(expected) == 1, "the report carries the count");
+
+	auto messages = capture.Messages();
+	check(messages.size() > 1 && messages[1] == "overflow 0",
+	      "the oldest messages survive an overflow");
+}
+
+static void test_concurrent_ordering()
+{
+	const int THREADS = 4;
+	const int PER_THREAD = 20000;
+
+	Capture capture;
+
+	log_t::Options options;
+	options.capacity = 1 << 17;
+	options.burst = 0;
+
+	log_t log(capture.GetSink(), options);
+
+	static log_t::CallSite site(__FILE__, __LINE__);
+
+	std::vector<std::thread> threads;
+	for (int t = 0; t < THREADS; ++t) {
+		threads.emplace_back([&, t]() {
+			for (int n = 0; n < PER_THREAD; ++n)
+				log.Log(site, log_t::LEVEL_INFO, "t%d n%d", t,
+					n);
+		});
+	}
+
+	for (auto &thread : threads)
+		thread.join();
+
+	log.Flush();
+
+	auto messages = capture.Messages();
+
+	std::map<int, int> next;
+	bool ordered = true;
+
+	for (auto &message : messages) {
+		int t = -1, n = -1;
+
+		if (2 != std::sscanf(message.c_str(), "t%d n%d", &t, &n) ||
+		    n != next[t]) {
+			ordered = false;
+			break;
+		}
+
+		++next[t];
+	}
+
+	check(messages.size() == (size_t)(THREADS * PER_THREAD),
+	      "every message from concurrent callers arrives");
+	check(ordered, "each caller's messages arrive in order");
+}
+
+static void test_shutdown_and_limits()
+{
+	Capture capture;
+
+	log_t log(capture.GetSink(), log_t::Options());
+
+	static log_t::CallSite site(__FILE__, __LINE__);
+
+	const std::string longMessage(2000, 'x');
+	log.Log(site, log_t::LEVEL_INFO, "%s", longMessage.c_str());
+
+	log.Shutdown();
+
+	const std::string marker = " [truncated]";
+
+	auto is_truncated = [&](const std::string &message) {
+		return message.size() == log_t::MAX_MESSAGE_SIZE - 1 &&
+		       message.compare(message.size() - marker.size(),
+				       marker.size(), marker) == 0;
+	};
+
+	check(capture.Messages().size() == 1 &&
+		      is_truncated(capture.Messages()[0]),
+	      "long messages are cut short and marked, and Shutdown() drains them");
+
+	log.Log(site, log_t::LEVEL_INFO, "after shutdown");
+
+	check(capture.Messages().size() == 2 &&
+		      capture.Messages()[1] == "after shutdown",
+	      "messages are written synchronously after Shutdown()");
+
+	log.Log(site, log_t::LEVEL_INFO, "%s", longMessage.c_str());
+
+	check(capture.Messages().size() == 3 &&
+		      is_truncated(capture.Messages()[2]),
+	      "long synchronous messages are marked too");
+
+	// Two-byte characters, one of which straddles the cut
+	std::string wide = "x";
+	while (wide.size() < 2 * log_t::MAX_MESSAGE_SIZE)
+		wide += "\xC3\xA9";
+
+	log.Log(site, log_t::LEVEL_INFO, "%s", wide.c_str());
+
+	const std::string cut = capture.Messages()[3];
+	const size_t body = cut.size() - marker.size();
+
+	check(cut.compare(body, marker.size(), marker) == 0 &&
+		      cut.compare(0, body, wide, 0, body) == 0 &&
+		      (body - 1) % 2 == 0,
+	      "the marker does not split a UTF-8 sequence");
+
+	check(log_t::IsValidLevel(log_t::LEVEL_ERROR) &&
+		      log_t::IsValidLevel(log_t::LEVEL_DEBUG) &&
+		      !log_t::IsValidLevel(0) && !log_t::IsValidLevel(-1) &&
+		      !log_t::IsValidLevel(log_t::LEVEL_DEBUG + 1),
+	      "levels outside error..debug are invalid");
+
+	log.Flush();
+	log.Shutdown();
+}
+
+int main()
+{
+	test_suppression();
+	test_window_roll_over();
+	test_severity();
+	test_overflow();
+	test_concurrent_ordering();
+	test_shutdown_and_limits();
+
+	if (failures) {
+		std::fprintf(stderr, "%d check(s) failed\n", failures);
+		return 1;
+	}
+
+	std::puts("test_async_log: all checks passed");
+	return 0;
+}
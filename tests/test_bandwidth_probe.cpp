@@ -0,0 +1,422 @@
+// Behavioural test for streamelements/StreamElementsBandwidthProbe.
+//
+// Local TCP sinks stand in for ingest servers: each answers the first leg of
+// the RTMP handshake after an artificial delay, then reads whatever it is sent
+// no faster than its bandwidth limit. The RTT phase must probe every sink at
+// once, see each delay and drop the ones which refuse connections or never
+// answer; the throughput phase must test only the best ones, within its
+// concurrency cap, reporting each as it finishes and measuring the limits.
+// Probes must leave from the address they are bound to, and when none
+// answers every candidate is tested. Ranking is checked on fixed round trips,
+// as measured ones carry scheduler jitter.
+
+#include "streamelements/StreamElementsBandwidthProbe.hpp"
+
+#define ASIO_STANDALONE
+#include <asio.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef StreamElementsBandwidthProbe Probe;
+typedef std::chrono::steady_clock clock_type;
+
+using asio::ip::tcp;
+
+static int failures = 0;
+
+static void check(bool cond, const char *msg)
+{
+	if (!cond) {
+		std::fprintf(stderr, "FAIL: %s\n", msg);
+		++failures;
+	}
+}
+
+static const int SOCKET_BUFFER_SIZE = 64 * 1024;
+
+// An ingest server stand-in. `handshakeDelay` < 0 never answers.
+class Sink {
+public:
+	Sink(int handshakeDelayMs, size_t bytesPerSecond)
+		: m_acceptor(m_io, tcp::endpoint(asio::ip::make_address(
+							 "127.0.0.1"),
+						 0)),
+		  m_handshakeDelayMs(handshakeDelayMs),
+		  m_bytesPerSecond(bytesPerSecond)
+	{
+		m_port = m_acceptor.local_endpoint().port();
+		m_thread = std::thread([this]() { AcceptLoop(); });
+	}
+
+	~Sink()
+	{
+		m_stopping = true;
+
+		// Wake the blocking accept.
+		asio::io_context io;
+		tcp::socket wake(io);
+		asio::error_code ec;
+		wake.connect(tcp::endpoint(asio::ip::make_address("127.0.0.1"),
+					   m_port),
+			     ec);
+
+		m_thread.join();
+
+		for (auto &thread : m_connections)
+			thread.join();
+	}
+
+	std::string Url() const
+	{
+		return "rtmp://127.0.0.1:" + std::to_string(m_port) + "/live";
+	}
+
+	unsigned short Port() const { return m_port; }
+
+private:
+	void AcceptLoop()
+	{
+		for (;;) {
+			auto socket = std::make_shared<tcp::socket>(m_io);
+			asio::error_code ec;
+
+			m_acceptor.accept(*socket, ec);
+
+			if (m_stopping || ec)
+				return;
+
+			socket->set_option(asio::socket_base::receive_buffer_size(
+						   SOCKET_BUFFER_SIZE),
+					   ec);
+
+			m_connections.emplace_back(
+				[this, socket]() { Serve(*socket); });
+		}
+	}
+
+	void Serve(tcp::socket &socket)
+	{
+		std::vector<unsigned char> packet(1537);
+		asio::error_code ec;
+
+		asio::read(socket, asio::buffer(packet), ec);
+
+		if (ec || m_handshakeDelayMs < 0) {
+			// Holds the connection open, silently.
+			while (!m_stopping && !ec)
+				std::this_thread::sleep_for(
+					std::chrono::milliseconds(10));
+			return;
+		}
+
+		std::this_thread::sleep_for(
+			std::chrono::milliseconds(m_handshakeDelayMs));
+
+		packet[0] = 3;
+		asio::write(socket, asio::buffer(packet), ec);
+
+		// Reads m_bytesPerSecond, in 10 ms slices.
+		std::vector<char> buffer(m_bytesPerSecond / 100);
+		auto next = clock_type::now();
+
+		while (!ec && !m_stopping) {
+			asio::read(socket, asio::buffer(buffer), ec);
+
+			next += std::chrono::milliseconds(10);
+			std::this_thread::sleep_until(next);
+		}
+	}
+
+private:
+	asio::io_context m_io;
+	tcp::acceptor m_acceptor;
+	unsigned short m_port = 0;
+
+	int m_handshakeDelayMs;
+	size_t m_bytesPerSecond;
+
+	std::atomic<bool> m_stopping{false};
+	std::thread m_thread;
+	std::vector<std::thread> m_connections;
+};
+
+// Stands in for the full throughput test: handshake, then send as fast as
+// the sink drains, measuring only after the socket buffers have filled.
+static double measure_bytes_per_second(const std::string &url)
+{
+	std::string host, port;
+	bool handshake;
+	Probe::ParseIngestUrl(url, host, port, handshake);
+
+	asio::io_context io;
+	tcp::socket socket(io);
+	asio::error_code ec;
+
+	socket.connect(tcp::endpoint(asio::ip::make_address(host),
+				     (unsigned short)std::stoi(port)),
+		       ec);
+	socket.set_option(
+		asio::socket_base::send_buffer_size(SOCKET_BUFFER_SIZE), ec);
+
+	std::vector<unsigned char> packet(1537, 0);
+	packet[0] = 3;
+	asio::write(socket, asio::buffer(packet), ec);
+	asio::read(socket, asio::buffer(packet), ec);
+
+	if (ec)
+		return 0.0;
+
+	std::vector<char> chunk(4096, 'x');
+
+	const auto start = clock_type::now();
+	const auto measureFrom = start + std::chrono::milliseconds(250);
+	const auto end = start + std::chrono::milliseconds(750);
+
+	size_t measured = 0;
+
+	for (;;) {
+		const size_t sent = asio::write(socket, asio::buffer(chunk), ec);
+		const auto now = clock_type::now();
+
+		if (ec || now >= end)
+			break;
+
+		if (now >= measureFrom)
+			measured += sent;
+	}
+
+	return (double)measured / 0.5;
+}
+
+static void test_parse_url()
+{
+	std::string host, port;
+	bool handshake = false;
+
+	check(Probe::ParseIngestUrl("rtmp://live.example.com/app", host, port,
+				    handshake) &&
+		      host == "live.example.com" && port == "1935" &&
+		      handshake,
+	      "rtmp URLs default to port 1935 and a handshake");
+	check(Probe::ParseIngestUrl("RTMPS://live.example.com:4443/app/key",
+				    host, port, handshake) &&
+		      host == "live.example.com" && port == "4443" &&
+		      !handshake,
+	      "rtmps URLs connect only");
+	check(Probe::ParseIngestUrl("rtmps://user:pw@live.example.com", host,
+				    port, handshake) &&
+		      host == "live.example.com" && port == "443",
+	      "user info is skipped and rtmps defaults to 443");
+	check(Probe::ParseIngestUrl("rtmp://[::1]:1940/app", host, port,
+				    handshake) &&
+		      host == "::1" && port == "1940",
+	      "IPv6 literals are unbracketed");
+	check(!Probe::ParseIngestUrl("live.example.com/app", host, port,
+				     handshake),
+	      "a URL needs a scheme");
+	check(!Probe::ParseIngestUrl("rtmp://host:port/app", host, port,
+				     handshake),
+	      "ports are numeric");
+}
+
+static Probe::RttResult rtt_result(bool reachable, int connectMs,
+				   int handshakeMs)
+{
+	Probe::RttResult result;
+	result.reachable = reachable;
+	result.connectTime = std::chrono::milliseconds(connectMs);
+	result.handshakeTime = std::chrono::milliseconds(handshakeMs);
+	return result;
+}
+
+static void test_rank()
+{
+	const std::vector<Probe::RttResult> rtt = {
+		rtt_result(true, 20, 100), rtt_result(true, 5, 5),
+		rtt_result(true, 30, 30),  rtt_result(true, 100, 100),
+		rtt_result(true, 10, 20),  rtt_result(false, 0, 0),
+		rtt_result(true, 60, 0),   rtt_result(true, 50, 10),
+	};
+
+	check(Probe::Rank(rtt, 3) == std::vector<size_t>({1, 4, 2}),
+	      "the three fastest answering candidates are picked, in order");
+	check(Probe::Rank(rtt, 0) ==
+		      std::vector<size_t>({1, 4, 2, 6, 7, 0, 3}),
+	      "connect and handshake time both count; ties keep their order");
+}
+
+static void test_probe_and_test()
+{
+	// Handshake delay (ms) and bandwidth limit (bytes per second).
+	const int delays[] = {120, 10, 60, 200, 30, 90};
+	const size_t rates[] = {4000000, 1000000, 3000000,
+				4000000, 2000000, 4000000};
+
+	std::vector<std::unique_ptr<Sink>> sinks;
+	std::vector<std::string> urls;
+
+	for (size_t i = 0; i < 6; ++i) {
+		sinks.emplace_back(std::make_unique<Sink>(delays[i], rates[i]));
+		urls.push_back(sinks.back()->Url());
+	}
+
+	// Refuses connections.
+	unsigned short closedPort;
+	{
+		asio::io_context io;
+		tcp::acceptor acceptor(
+			io, tcp::endpoint(asio::ip::make_address("127.0.0.1"),
+					  0));
+		closedPort = acceptor.local_endpoint().port();
+	}
+	urls.push_back("rtmp://127.0.0.1:" + std::to_string(closedPort) +
+		       "/live");
+
+	// Accepts, but never answers the handshake.
+	sinks.emplace_back(std::make_unique<Sink>(-1, 0));
+	urls.push_back(sinks.back()->Url());
+
+	const auto timeout = std::chrono::milliseconds(400);
+
+	const auto rttStart = clock_type::now();
+	const auto rtt = Probe::MeasureRtt(urls, timeout);
+	const auto rttElapsed = clock_type::now() - rttStart;
+
+	const double rttMs =
+		std::chrono::duration<double, std::milli>(rttElapsed).count();
+
+	check(rtt.size() == urls.size(), "one result per candidate");
+	check(rttMs < 700, "candidates are probed in parallel");
+
+	for (size_t i = 0; i < 6; ++i) {
+		check(rtt[i].reachable, "answering sinks are reachable");
+		check(rtt[i].handshakeTime >=
+			      std::chrono::milliseconds(delays[i]),
+		      "the handshake includes the server's delay");
+	}
+
+	check(!rtt[6].reachable, "a refused connection is unreachable");
+	check(!rtt[7].reachable, "a silent server is unreachable");
+
+	// Measured round trips carry scheduler jitter, so the order is left
+	// to test_rank().
+	const auto top = Probe::Rank(rtt, 3);
+
+	check(top.size() == 3, "the limit caps the candidates picked");
+	check(Probe::Rank(rtt, 0).size() == 6,
+	      "no limit keeps every reachable candidate");
+
+	// Throughput phase on the top candidates, two at a time.
+	std::mutex mutex;
+	std::vector<size_t> finished;
+	std::vector<double> measured(urls.size(), 0.0);
+	int running = 0;
+	int maxRunning = 0;
+
+	Probe::RunTests(top, 2, [&](size_t index) {
+		{
+			std::lock_guard<std::mutex> guard(mutex);
+			maxRunning = std::max(maxRunning, ++running);
+		}
+
+		const double rate = measure_bytes_per_second(urls[index]);
+
+		std::lock_guard<std::mutex> guard(mutex);
+		--running;
+		measured[index] = rate;
+		finished.push_back(index);
+
+		return true;
+	});
+
+	check(finished.size() == 3, "only the top candidates are tested");
+	check(maxRunning == 2, "tests run concurrently, within the cap");
+
+	for (size_t index : top) {
+		const double expected = (double)rates[index];
+
+		check(measured[index] > expected * 0.7 &&
+			      measured[index] < expected * 1.3,
+		      "throughput matches the sink's limit");
+	}
+}
+
+static void test_bind_and_fallback()
+{
+	std::vector<std::unique_ptr<Sink>> sinks;
+	std::vector<std::string> urls;
+
+	for (int delay : {30, 10}) {
+		sinks.emplace_back(std::make_unique<Sink>(delay, 1000000));
+		urls.push_back(sinks.back()->Url());
+	}
+
+	const auto timeout = std::chrono::milliseconds(400);
+
+	auto rtt = Probe::MeasureRtt(urls, timeout, "127.0.0.1");
+
+	check(rtt[0].reachable && rtt[1].reachable,
+	      "probes bound to a local address reach the sinks");
+	check(Probe::Rank(rtt, 0).size() == 2,
+	      "bound probes are ranked like any other");
+
+	rtt = Probe::MeasureRtt(urls, timeout, "default");
+
+	check(rtt[0].reachable && rtt[1].reachable,
+	      "\"default\" connects unbound");
+
+	// TEST-NET-1: not an address of this machine, so nothing can be
+	// bound to it.
+	rtt = Probe::MeasureRtt(urls, timeout, "192.0.2.1");
+
+	check(!rtt[0].reachable && !rtt[1].reachable,
+	      "probes do not fall back to another address than the bound one");
+	check(Probe::Rank(rtt, 0) == std::vector<size_t>({0, 1}),
+	      "when nothing answers every candidate is kept, in order");
+	check(Probe::Rank(rtt, 1) == std::vector<size_t>({0}),
+	      "the fallback still honours the limit");
+}
+
+static void test_stop()
+{
+	std::atomic<int> calls{0};
+
+	Probe::RunTests({0, 1, 2, 3}, 1, [&](size_t) {
+		++calls;
+		return false;
+	});
+
+	check(calls == 1, "a stopped run starts no further tests");
+
+	calls = 0;
+	Probe::RunTests({}, 4, [&](size_t) {
+		++calls;
+		return true;
+	});
+
+	check(calls == 0, "nothing to test, nothing run");
+}
+
+int main()
+{
+	test_parse_url();
+	test_rank();
+	test_stop();
+	test_probe_and_test();
+	test_bind_and_fallback();
+
+	if (failures) {
+		std::fprintf(stderr, "%d check(s) failed\n", failures);
+		return 1;
+	}
+
+	std::puts("test_bandwidth_probe: all checks passed");
+	return 0;
+}
@@ -0,0 +1,259 @@
+// Behavioural test for streamelements/StreamElementsCompositionSceneIndex.
+//
+// Drives a model of video compositions through creation, destruction, scene
+// additions, removals and moves between compositions, invalidating the index
+// the way StreamElementsVideoCompositionManager does, and checks every
+// lookup against a walk of the model. Also checks that the index is only
+// rebuilt after it is invalidated, and that an invalidation which races a
+// rebuild is not lost.
+
+#include "streamelements/StreamElementsCompositionSceneIndex.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef StreamElementsCompositionSceneIndex index_t;
+
+static int failures = 0;
+
+static void check(bool cond, const char *msg)
+{
+	if (!cond) {
+		std::fprintf(stderr, "FAIL: %s\n", msg);
+		++failures;
+	}
+}
+
+// Composition id to the scenes it lists, in the manager's iteration order.
+typedef std::map<std::string, std::vector<const void *>> model_t;
+
+static void collect(const model_t &model, index_t::entries_t &entries)
+{
+	for (auto &kv : model) {
+		for (auto scene : kv.second)
+			entries.emplace_back(scene, kv.first);
+	}
+}
+
+// What the manager's lookups used to do.
+static std::string walk(const model_t &model, const void *scene)
+{
+	for (auto &kv : model) {
+		for (auto candidate : kv.second) {
+			if (candidate == scene)
+				return kv.first;
+		}
+	}
+
+	return "";
+}
+
+/* ================================================================= */
+
+static void test_consistency()
+{
+	index_t index;
+	model_t model;
+
+	std::vector<int> scenes(64);
+
+	auto find = [&](const void *scene) {
+		return index.Find(scene, [&](index_t::entries_t &entries) {
+			collect(model, entries);
+		});
+	};
+
+	auto matches = [&]() {
+		for (auto &scene : scenes) {
+			if (find(&scene) != walk(model, &scene))
+				return false;
+		}
+
+		return true;
+	};
+
+	check(find(&scenes[0]).empty(), "nothing is found in no compositions");
+
+	// Two compositions listing the same scenes, as the native ones do.
+	model["native"] = {&scenes[0], &scenes[1], &scenes[2]};
+	model["native-encoders"] = {&scenes[0], &scenes[1], &scenes[2]};
+	index.Invalidate();
+
+	check(find(&scenes[1]) == "native", "the first listing composition wins");
+
+	const uint64_t rebuilds = index.GetRebuildCount();
+	for (int i = 0; i < 100; ++i)
+		find(&scenes[i % 4]);
+	check(index.GetRebuildCount() == rebuilds,
+	      "lookups do not rebuild a current index");
+
+	std::mt19937 rng(42);
+	bool consistent = true;
+
+	for (int step = 0; step < 2000 && consistent; ++step) {
+		auto &scene = scenes[rng() % scenes.size()];
+		const std::string id = "custom " + std::to_string(rng() % 6);
+
+		switch (rng() % 5) {
+		case 0:
+			// Create a composition with a scene of its own.
+			if (!model.count(id) && walk(model, &scene).empty())
+				model[id] = {&scene};
+			break;
+		case 1:
+			// Destroy a composition.
+			model.erase(id);
+			break;
+		case 2:
+			// Add a scene.
+			if (model.count(id) && walk(model, &scene).empty())
+				model[id].push_back(&scene);
+			break;
+		case 3: {
+			// Move a scene to another composition.
+			const std::string from = walk(model, &scene);
+
+			if (from.empty() || from == id || !model.count(id) ||
+			    from.compare(0, 6, "native") == 0)
+				break;
+
+			auto &list = model[from];
+			for (auto it = list.begin(); it != list.end(); ++it) {
+				if (*it == &scene) {
+					list.erase(it);
+					break;
+				}
+			}
+
+			model[id].push_back(&scene);
+			break;
+		}
+		case 4:
+			// A scene collection load replaces the native scenes.
+			model["native"] = {&scenes[rng() % 4]};
+			model["native-encoders"] = model["native"];
+			break;
+		}
+
+		index.Invalidate();
+
+		consistent = matches();
+	}
+
+	check(consistent, "lookups match the compositions after every change");
+}
+
+static void test_invalidate_during_rebuild()
+{
+	index_t index;
+	model_t model;
+
+	int a, b;
+	model["first"] = {&a};
+
+	// The collection callback invalidates the index itself, as a scene
+	// list change on another thread would.
+	bool invalidated = false;
+
+	auto result = index.Find(&a, [&](index_t::entries_t &entries) {
+		collect(model, entries);
+
+		if (!invalidated) {
+			invalidated = true;
+
+			model["first"] = {&b};
+			index.Invalidate();
+		}
+	});
+
+	check(result == "first", "a racing rebuild still answers its lookup");
+	check(index.Find(&b,
+			 [&](index_t::entries_t &entries) {
+				 collect(model, entries);
+			 }) == "first",
+	      "the invalidation is not lost");
+	check(index.GetRebuildCount() == 2, "the index was rebuilt again");
+}
+
+static void test_concurrent_lookups()
+{
+	index_t index;
+	model_t model;
+	std::mutex modelMutex;
+
+	std::vector<int> scenes(16);
+	model["native"] = {};
+	for (auto &scene : scenes)
+		model["native"].push_back(&scene);
+
+	std::atomic<bool> stop(false);
+	std::atomic<int> unknown(0);
+
+	std::vector<std::thread> readers;
+	for (int t = 0; t < 4; ++t) {
+		readers.emplace_back([&, t]() {
+			for (int i = 0; !stop.load(); ++i) {
+				auto id = index.Find(
+					&scenes[(i + t) % scenes.size()],
+					[&](index_t::entries_t &entries) {
+						std::lock_guard<std::mutex> guard(
+							modelMutex);
+
+						collect(model, entries);
+					});
+
+				// Every scene is always in one of the two.
+				if (id != "native" && id != "other")
+					++unknown;
+			}
+		});
+	}
+
+	for (int i = 0; i < 2000; ++i) {
+		{
+			std::lock_guard<std::mutex> guard(modelMutex);
+
+			std::swap(model["native"], model["other"]);
+		}
+
+		index.Invalidate();
+	}
+
+	stop = true;
+	for (auto &reader : readers)
+		reader.join();
+
+	check(unknown.load() == 0, "concurrent lookups always find the scene");
+
+	bool consistent = true;
+	for (auto &scene : scenes) {
+		consistent = consistent &&
+			     index.Find(&scene,
+					[&](index_t::entries_t &entries) {
+						collect(model, entries);
+					}) == walk(model, &scene);
+	}
+
+	check(consistent, "the index settles on the final compositions");
+}
+
+int main()
+{
+	test_consistency();
+	test_invalidate_during_rebuild();
+	test_concurrent_lookups();
+
+	if (failures) {
+		std::fprintf(stderr, "%d check(s) failed\n", failures);
+		return 1;
+	}
+
+	std::puts("test_composition_scene_index: all checks passed");
+	return 0;
+}
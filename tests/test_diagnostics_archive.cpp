@@ -0,0 +1,577 @@
+// Behavioural test for streamelements/StreamElementsDiagnosticsArchive.
+//
+// Builds diagnostics archives from a generated obs-studio-like directory tree
+// -- configuration, a current and older logs, a credentials file, a log a
+// stream key was dumped into, oversized binaries, a third-party plugin -- and
+// reads them back through zip.h: credentials are redacted, the per-file limit
+// and overall budget hold, priorities decide what the budget buys, oversized
+// logs keep their head and tail around a truncation marker, and everything
+// else round-trips byte for byte. Also checks that a log which grew after it
+// was planned is cut at its planned size, and that candidates not yet queued
+// when the build is cancelled are omitted.
+
+#include "streamelements/StreamElementsDiagnosticsArchive.hpp"
+#include "streamelements/deps/zip/zip.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+typedef StreamElementsDiagnosticsArchive archive_t;
+
+static int failures = 0;
+
+static void check(bool cond, const char *msg)
+{
+	if (!cond) {
+		std::fprintf(stderr, "FAIL: %s\n", msg);
+		++failures;
+	}
+}
+
+static void write_file(const fs::path &path, const std::string &content)
+{
+	fs::create_directories(path.parent_path());
+	std::ofstream out(path, std::ios::binary);
+	out << content;
+}
+
+static std::string random_bytes(size_t size, unsigned seed)
+{
+	std::mt19937 rng(seed);
+	std::string result(size, '\0');
+	for (auto &ch : result)
+		ch = (char)(rng() & 0xFF);
+	return result;
+}
+
+// Numbered lines, like an OBS log: every line is distinct, so a slice can be
+// located in the original.
+static std::string log_text(size_t size, unsigned seed)
+{
+	std::mt19937 rng(seed);
+	std::string result;
+	for (size_t line = 0; result.size() < size; ++line) {
+		result += "12:00:00.000: [line " + std::to_string(line) +
+			  "] source 'Camera " + std::to_string(rng() % 16) +
+			  "' rendered frame\n";
+	}
+	result.resize(size);
+	return result;
+}
+
+static size_t on_extract(void *arg, unsigned long long, const void *data,
+			 size_t size)
+{
+	((std::string *)arg)->append((const char *)data, size);
+	return size;
+}
+
+static std::map<std::string, std::string> read_archive(const fs::path &path)
+{
+	std::map<std::string, std::string> result;
+
+	zip_t *zip = zip_open(path.string().c_str(), 0, 'r');
+	if (!zip)
+		return result;
+
+	for (int index = 0; index < zip_total_entries(zip) &&
+			    0 == zip_entry_openbyindex(zip, index);
+	     ++index) {
+		std::string content;
+		if (0 == zip_entry_extract(zip, on_extract, &content))
+			result[zip_entry_name(zip)] = content;
+		zip_entry_close(zip);
+	}
+
+	zip_close(zip);
+	return result;
+}
+
+static bool starts_with(const std::string &s, const std::string &prefix)
+{
+	return s.size() >= prefix.size() &&
+	       0 == s.compare(0, prefix.size(), prefix);
+}
+
+static bool ends_with(const std::string &s, const std::string &suffix)
+{
+	return s.size() >= suffix.size() &&
+	       0 == s.compare(s.size() - suffix.size(), suffix.size(), suffix);
+}
+
+/* ================================================================= */
+
+static void test_read_slices()
+{
+	fs::path dir = fs::temp_directory_path() / "se_diagnostics_slices";
+	fs::remove_all(dir);
+
+	const std::string small = log_text(1000, 1);
+	write_file(dir / "small.txt", small);
+
+	std::string content;
+	check(archive_t::ReadSlices((dir / "small.txt").string(), 600, 600,
+				    content),
+	      "small file reads");
+	check(content == small, "slices covering the file return it whole");
+
+	const std::string large = log_text(200000, 2);
+	write_file(dir / "large.txt", large);
+
+	check(archive_t::ReadSlices((dir / "large.txt").string(), 10000, 20000,
+				    content),
+	      "large file reads");
+
+	const size_t marker = content.find("[... ");
+	check(marker != std::string::npos, "cut content carries a marker");
+
+	if (marker != std::string::npos) {
+		const std::string head = content.substr(0, marker);
+		const size_t markerEnd = content.find("\n", marker);
+		const std::string tail = content.substr(markerEnd + 1);
+
+		check(starts_with(large, head), "head is the file's start");
+		check(ends_with(large, tail), "tail is the file's end");
+		check(head.size() <= 10000 && head.size() > 10000 * 7 / 8,
+		      "head stays within its slice");
+		check(tail.size() <= 20000 && tail.size() > 20000 * 7 / 8,
+		      "tail stays within its slice");
+		check(ends_with(head, "\n"), "head ends on a line boundary");
+		check(starts_with(tail, "12:00:00.000: [line "),
+		      "tail starts on a line boundary");
+
+		const std::string expectedMarker =
+			archive_t::GetTruncationMarker(large.size() -
+						       head.size() -
+						       tail.size());
+		check(content.compare(marker, expectedMarker.size(),
+				      expectedMarker) == 0,
+		      "marker states exactly how many bytes were cut");
+	}
+
+	// No newline anywhere: cuts stay where the slices put them.
+	const std::string binary(100000, 'x');
+	write_file(dir / "flat.log", binary);
+	check(archive_t::ReadSlices((dir / "flat.log").string(), 1000, 1000,
+				    content),
+	      "flat file reads");
+	check(starts_with(content, std::string(1000, 'x') + "\n[... 98000 "),
+	      "without line breaks the head is cut at its exact size");
+
+	check(!archive_t::ReadSlices((dir / "missing.txt").string(), 1, 1,
+				     content),
+	      "a missing file fails");
+
+	check(archive_t::IsLogFile("obs-studio\\logs\\2024-01-01 10-00-00.TXT"),
+	      "log extension match is case-insensitive");
+	check(archive_t::IsLogFile("crashes/crash.log"), ".log is a log");
+	check(!archive_t::IsLogFile("logs.txt/global.ini"),
+	      "a dot in a directory name is not an extension");
+	check(!archive_t::IsLogFile("basic/profiles/a/service.json"),
+	      "json is not a log");
+
+	fs::remove_all(dir);
+}
+
+static void test_plan()
+{
+	archive_t::Options options;
+	options.maxFileBytes = 1000;
+	options.maxTotalBytes = 300000;
+	options.logHeadBytes = 100;
+
+	std::vector<archive_t::Candidate> candidates;
+
+	auto add = [&](const char *path, uint64_t size, int priority,
+		       uint64_t maxBytes = 0) {
+		archive_t::Candidate candidate;
+		candidate.zipPath = path;
+		candidate.size = size;
+		candidate.priority = priority;
+		candidate.maxBytes = maxBytes;
+		candidates.push_back(candidate);
+	};
+
+	add("plugin.dll", 250000, archive_t::PRIORITY_LOW, 400000);
+	add("big.bin", 5000, archive_t::PRIORITY_NORMAL);
+	add("b.ini", 900, archive_t::PRIORITY_NORMAL);
+	add("a.ini", 100, archive_t::PRIORITY_NORMAL);
+	add("current.txt", 500000, archive_t::PRIORITY_HIGH, 200000);
+	add("old.txt", 300000, archive_t::PRIORITY_NORMAL, 150000);
+
+	auto plan = archive_t::Plan(candidates, options);
+
+	check(plan.size() == candidates.size(), "every candidate is decided");
+
+	std::vector<std::string> order;
+	std::map<std::string, archive_t::Decision> byPath;
+	uint64_t total = 0;
+
+	for (auto &decision : plan) {
+		order.push_back(decision.candidate.zipPath);
+		byPath[decision.candidate.zipPath] = decision;
+		total += decision.GetBytes();
+	}
+
+	check(order == std::vector<std::string>({"current.txt", "a.ini",
+						 "b.ini", "big.bin", "old.txt",
+						 "plugin.dll"}),
+	      "priority first, then smallest first");
+	check(total <= options.maxTotalBytes, "plan stays within budget");
+
+	auto &current = byPath["current.txt"];
+	check(current.disposition == archive_t::Disposition::Truncated,
+	      "oversized log is truncated");
+	check(current.headBytes == 100 && current.tailBytes == 199900,
+	      "truncated log gets its own limit, head first");
+
+	check(byPath["a.ini"].disposition == archive_t::Disposition::Included &&
+		      byPath["b.ini"].disposition ==
+			      archive_t::Disposition::Included,
+	      "small files are included");
+
+	check(byPath["big.bin"].disposition ==
+			      archive_t::Disposition::Omitted &&
+		      byPath["big.bin"].reason == "over per-file limit",
+	      "oversized non-log is omitted");
+
+	// 300000 - 200000 - 1000 left: less than its own limit, still enough
+	// to be worth a truncated copy.
+	auto &old = byPath["old.txt"];
+	check(old.disposition == archive_t::Disposition::Truncated &&
+		      old.GetBytes() == 99000,
+	      "log is truncated to what the budget has left");
+
+	check(byPath["plugin.dll"].disposition ==
+			      archive_t::Disposition::Omitted &&
+		      byPath["plugin.dll"].reason ==
+			      "archive budget exhausted",
+	      "low priority is what the budget runs out on");
+
+	auto lines = archive_t::DescribePlan(plan, options);
+	std::string text;
+	for (auto &line : lines)
+		text += line + "\n";
+
+	check(text.find("Files collected: 4 (300000 bytes)") !=
+		      std::string::npos,
+	      "description totals what was taken");
+	check(text.find("Files truncated: 2") != std::string::npos,
+	      "description counts truncated files");
+	check(text.find("big.bin (5000 bytes, over per-file limit)") !=
+		      std::string::npos,
+	      "description lists omitted files with a reason");
+	check(text.find("current.txt (500000 bytes, truncated to 200000 bytes)") !=
+		      std::string::npos,
+	      "description lists truncated files");
+	check(text.find("a.ini") == std::string::npos,
+	      "description does not list files taken whole");
+}
+
+static void test_archive(int level)
+{
+	fs::path dir = fs::temp_directory_path() / "se_diagnostics_archive";
+	fs::remove_all(dir);
+
+	fs::path tree = dir / "obs-studio";
+
+	std::map<std::string, std::string> files;
+
+	for (unsigned i = 0; i < 60; ++i) {
+		files["basic/scenes/collection" + std::to_string(i) + ".json"] =
+			log_text(2000 + i * 311, i);
+	}
+
+	files["global.ini"] = "[General]\nLastVersion=503316480\n";
+	files["basic/profiles/Main/service.json"] =
+		"{\"settings\": {\"key\": \"live_123456_secret\", "
+		"\"server\": \"rtmp://live.example.com/app\"}, "
+		"\"type\": \"rtmp_common\"}";
+
+	files["logs/2024-01-01 10-00-00.txt"] = log_text(3 * 1024 * 1024, 10);
+	files["logs/2024-01-02 10-00-00.txt"] = log_text(2 * 1024 * 1024, 11);
+	files["logs/2024-01-03 10-00-00.txt"] = log_text(6 * 1024 * 1024, 12);
+	files["logs/2024-01-03 09-00-00.txt"] = log_text(200 * 1024, 13);
+	files["logs/2024-01-03 08-00-00.txt"] =
+		log_text(100 * 1024, 16) +
+		"12:00:01.000: service settings: {\"key\": \"live_987654_secret\", "
+		"\"server\": \"rtmp://live.example.com/app\"}\n" +
+		log_text(100 * 1024, 17);
+
+	files["cache/blob.bin"] = random_bytes(2 * 1024 * 1024, 14);
+	files["plugins/third-party/bin/plugin.dll"] =
+		random_bytes(3 * 1024 * 1024, 15);
+
+	for (auto &file : files)
+		write_file(tree / file.first, file.second);
+
+	archive_t::Options options;
+	options.level = level;
+	options.maxFileBytes = 1024 * 1024;
+	options.maxTotalBytes = 5 * 1024 * 1024;
+	options.logHeadBytes = 128 * 1024;
+
+	const std::string newestLog = "logs/2024-01-03 10-00-00.txt";
+
+	std::vector<archive_t::Candidate> candidates;
+
+	for (auto &file : files) {
+		archive_t::Candidate candidate;
+		candidate.localPath = (tree / file.first).string();
+		candidate.zipPath = "obs-studio/" + file.first;
+		candidate.size = fs::file_size(tree / file.first);
+
+		if (file.first == newestLog)
+			candidate.priority = archive_t::PRIORITY_HIGH;
+
+		if (starts_with(file.first, "plugins/")) {
+			candidate.priority = archive_t::PRIORITY_LOW;
+			candidate.maxBytes = 4 * 1024 * 1024;
+		}
+
+		candidates.push_back(candidate);
+	}
+
+	fs::path path = dir / "report.zip";
+
+	std::vector<archive_t::Decision> plan;
+
+	{
+		archive_t archive(options);
+
+		check(archive.Open(path.string()), "archive opens for writing");
+
+		archive.AddBuffer("generator=test\n", "manifest.ini");
+
+		plan = archive.AddCandidates(candidates);
+
+		std::string description;
+		for (auto &line : archive_t::DescribePlan(plan, options))
+			description += line + "\r\n";
+
+		archive.AddBuffer(description, "omitted-files.txt");
+
+		check(archive.Close(), "archive closes cleanly");
+	}
+
+	auto actual = read_archive(path);
+
+	check(actual.count("manifest.ini") && actual.count("omitted-files.txt"),
+	      "buffers are written alongside files");
+
+	uint64_t taken = 0;
+	size_t truncated = 0;
+
+	for (auto &decision : plan) {
+		const std::string relative =
+			decision.candidate.zipPath.substr(strlen("obs-studio/"));
+		const std::string &original = files[relative];
+
+		auto it = actual.find(decision.candidate.zipPath);
+
+		switch (decision.disposition) {
+		case archive_t::Disposition::Omitted:
+			check(it == actual.end(),
+			      "omitted files are not in the archive");
+			break;
+
+		case archive_t::Disposition::Included:
+			check(it != actual.end(),
+			      "included files are in the archive");
+			if (it == actual.end())
+				break;
+
+			taken += it->second.size();
+
+			if (relative == "logs/2024-01-03 08-00-00.txt") {
+				check(it->second.find("live_987654_secret") ==
+					      std::string::npos,
+				      "stream key in a log is redacted");
+				check(it->second.find("[redacted]") !=
+						      std::string::npos &&
+					      starts_with(it->second,
+							  log_text(100 * 1024,
+								   16)),
+				      "the rest of the log is kept");
+			} else if (relative ==
+				   "basic/profiles/Main/service.json") {
+				check(it->second.find("live_123456_secret") ==
+					      std::string::npos,
+				      "stream key is redacted");
+				check(it->second.find(
+					      "rtmp://live.example.com/app") !=
+					      std::string::npos,
+				      "the rest of service.json is kept");
+			} else {
+				check(it->second == original,
+				      "included files round-trip byte for byte");
+			}
+			break;
+
+		case archive_t::Disposition::Truncated: {
+			++truncated;
+
+			check(it != actual.end(),
+			      "truncated logs are in the archive");
+			if (it == actual.end())
+				break;
+
+			const std::string &content = it->second;
+			const size_t marker = content.find("\n[... ");
+
+			check(marker != std::string::npos,
+			      "truncated log carries a marker");
+			check(content.size() <= decision.GetBytes() + 64,
+			      "truncated log stays within its slices");
+			check(starts_with(original,
+					  content.substr(0, marker + 1)),
+			      "truncated log keeps its head");
+			check(ends_with(original,
+					content.substr(content.find(
+							       "\n", marker + 1) +
+						       1)),
+			      "truncated log keeps its tail");
+
+			taken += decision.GetBytes();
+			break;
+		}
+		}
+	}
+
+	check(taken <= options.maxTotalBytes,
+	      "archive content stays within the budget");
+	check(truncated >= 2, "oversized logs are truncated, not dropped");
+
+	auto newest = std::find_if(plan.begin(), plan.end(),
+				   [&](const archive_t::Decision &d) {
+					   return d.candidate.zipPath ==
+						  "obs-studio/" + newestLog;
+				   });
+	check(newest != plan.end() && newest == plan.begin() &&
+		      newest->disposition ==
+			      archive_t::Disposition::Truncated &&
+		      newest->GetBytes() == options.maxFileBytes,
+	      "the current log is taken first, at its full limit");
+
+	check(actual.count("obs-studio/logs/2024-01-03 08-00-00.txt"),
+	      "the log carrying a stream key is in the archive");
+	check(!actual.count("obs-studio/cache/blob.bin"),
+	      "oversized binary is omitted");
+	check(!actual.count("obs-studio/plugins/third-party/bin/plugin.dll"),
+	      "plugin is what the budget runs out on");
+	check(actual["omitted-files.txt"].find(
+		      "obs-studio/cache/blob.bin (2097152 bytes, over per-file limit)") !=
+		      std::string::npos,
+	      "omitted files are listed in the archive");
+
+	check(fs::file_size(path) < taken, "text content was compressed");
+
+	fs::remove_all(dir);
+}
+
+static void test_grown_and_cancelled()
+{
+	fs::path dir = fs::temp_directory_path() / "se_diagnostics_cancelled";
+	fs::remove_all(dir);
+
+	const std::string log = log_text(300 * 1024, 20);
+	write_file(dir / "current.txt", log);
+
+	for (int i = 0; i < 4; ++i)
+		write_file(dir / ("file" + std::to_string(i) + ".json"),
+			   log_text(1000 + i, 21 + i));
+
+	std::vector<archive_t::Candidate> candidates;
+
+	{
+		// Planned before the log was written to again
+		archive_t::Candidate candidate;
+		candidate.localPath = (dir / "current.txt").string();
+		candidate.zipPath = "logs/current.txt";
+		candidate.size = 100 * 1024;
+		candidate.priority = archive_t::PRIORITY_HIGH;
+		candidates.push_back(candidate);
+	}
+
+	for (int i = 0; i < 4; ++i) {
+		const std::string name = "file" + std::to_string(i) + ".json";
+
+		archive_t::Candidate candidate;
+		candidate.localPath = (dir / name).string();
+		candidate.zipPath = name;
+		candidate.size = fs::file_size(dir / name);
+		candidates.push_back(candidate);
+	}
+
+	fs::path path = dir / "report.zip";
+
+	std::vector<archive_t::Decision> plan;
+
+	{
+		archive_t archive(archive_t::Options{});
+
+		check(archive.Open(path.string()), "archive opens for writing");
+
+		// Cancelled once the log and two files are queued
+		int polls = 0;
+		plan = archive.AddCandidates(candidates,
+					     [&]() { return ++polls > 3; });
+
+		check(archive.Close(), "cancelled archive closes cleanly");
+	}
+
+	auto actual = read_archive(path);
+
+	const std::string &content = actual["logs/current.txt"];
+	const std::string marker = archive_t::GetTruncationMarker(200 * 1024);
+
+	check(content.compare(0, 100 * 1024, log, 0, 100 * 1024) == 0 &&
+		      ends_with(content, marker + "\n") &&
+		      content.size() <= 100 * 1024 + marker.size() + 2,
+	      "a log which grew after planning is cut at its planned size");
+
+	size_t cancelled = 0;
+
+	for (auto &decision : plan) {
+		if (decision.reason == "cancelled") {
+			++cancelled;
+
+			check(decision.disposition ==
+					      archive_t::Disposition::Omitted &&
+				      !actual.count(decision.candidate.zipPath),
+			      "cancelled candidates are not in the archive");
+		}
+	}
+
+	check(cancelled == 2 && actual.size() == 3,
+	      "candidates queued before the cancel are kept");
+
+	fs::remove_all(dir);
+}
+
+int main()
+{
+	test_read_slices();
+	test_plan();
+
+	test_archive(3);
+	test_archive(9);
+	test_grown_and_cancelled();
+
+	if (failures) {
+		std::fprintf(stderr, "%d check(s) failed\n", failures);
+		return 1;
+	}
+
+	std::puts("test_diagnostics_archive: all checks passed");
+	return 0;
+}
@@ -0,0 +1,433 @@
+// Behavioural test for streamelements/StreamElementsBackupManifest.
+//
+// Drives the manifest the way CreateLocalBackupPackage does -- AddFile() per
+// referenced file, the content queued on a StreamElementsParallelZipWriter
+// only when the manifest asks for it, the package manifest embedded last --
+// across a chain of incremental packages, then restores the latest one the
+// way RestoreBackupPackageContent does: objects the package carries come from
+// it, every other object from the base package ResolveObjects() points at.
+// Identical content under different extensions must restore to both paths.
+
+#include "streamelements/StreamElementsBackupManifest.hpp"
+#include "streamelements/StreamElementsParallelZipWriter.hpp"
+#include "streamelements/deps/zip/zip.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+typedef StreamElementsBackupManifest::PackageManifest PackageManifest;
+
+static int failures = 0;
+
+static void check(bool cond, const char *msg)
+{
+	if (!cond) {
+		std::fprintf(stderr, "FAIL: %s\n", msg);
+		++failures;
+	}
+}
+
+static void write_file(const fs::path &path, const std::string &content)
+{
+	fs::create_directories(path.parent_path());
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	out << content;
+}
+
+static std::string read_file(const fs::path &path)
+{
+	std::ifstream in(path, std::ios::binary);
+	std::stringstream buffer;
+	buffer << in.rdbuf();
+	return buffer.str();
+}
+
+static std::string media(size_t size, char seed)
+{
+	std::string result(size, '\0');
+	for (size_t i = 0; i < size; ++i)
+		result[i] = (char)(seed + (i * 31) % 97);
+	return result;
+}
+
+struct Package {
+	std::string path;
+	PackageManifest manifest;
+	StreamElementsBackupManifest::Stats stats;
+};
+
+// Mirrors the incremental branch of ScanForFileReferencesToBackup() and the
+// tail of CreateLocalBackupPackage().
+static Package create_package(const fs::path &dir, const std::string &id,
+			      const std::vector<fs::path> &files,
+			      bool resetChain = false)
+{
+	StreamElementsBackupManifest manifest((dir / "state.json").string());
+	check(manifest.Load(), "state loads");
+
+	manifest.BeginPackage(id, resetChain);
+
+	Package package;
+	package.path = (dir / (id + ".zip")).string();
+
+	StreamElementsParallelZipWriter::Options options;
+	options.workerCount = 2;
+
+	StreamElementsParallelZipWriter zip(options);
+	zip.Open(package.path);
+
+	// Stands in for the rewritten scene collection JSON.
+	zip.AddBuffer("{\"collection\":\"" + id + "\"}", "basic/scenes/a.json");
+
+	for (auto &file : files) {
+		std::string zipPath;
+		bool include = false;
+
+		check(manifest.AddFile(file.string(), zipPath, include),
+		      "referenced file is readable");
+
+		if (include)
+			zip.AddFile(file.string(), zipPath);
+	}
+
+	zip.AddBuffer(manifest.GetPackageManifest().ToJson(),
+		      StreamElementsBackupManifest::MANIFEST_ZIP_PATH);
+
+	check(zip.Close(), "package is written");
+
+	manifest.CommitPackage();
+	check(manifest.Save(), "state saves");
+
+	package.manifest = manifest.GetPackageManifest();
+	package.stats = manifest.GetStats();
+
+	return package;
+}
+
+static bool read_manifest(zip_t *zip, PackageManifest &result)
+{
+	if (0 != zip_entry_open(zip,
+				StreamElementsBackupManifest::MANIFEST_ZIP_PATH))
+		return false;
+
+	void *buf = nullptr;
+	size_t size = 0;
+	bool success = false;
+
+	if (0 == zip_entry_read(zip, &buf, &size)) {
+		success = PackageManifest::FromJson(
+			std::string((const char *)buf, size), result);
+		free(buf);
+	}
+
+	zip_entry_close(zip);
+	return success;
+}
+
+static bool extract_current(zip_t *zip, const fs::path &dest)
+{
+	void *buf = nullptr;
+	size_t size = 0;
+
+	if (0 != zip_entry_read(zip, &buf, &size))
+		return false;
+
+	write_file(dest, std::string((const char *)buf, size));
+	free(buf);
+	return true;
+}
+
+// Mirrors RestoreBackupPackageContent(). Returns false when an object could
+// not be resolved from the packages given.
+static bool restore(const Package &latest, const std::vector<Package> &bases,
+		    const fs::path &out)
+{
+	fs::remove_all(out);
+
+	zip_t *zip = zip_open(latest.path.c_str(), 0, 'r');
+
+	PackageManifest manifest;
+	check(read_manifest(zip, manifest), "package manifest is embedded");
+
+	std::vector<PackageManifest> baseManifests;
+	std::vector<zip_t *> baseZips;
+
+	for (auto &base : bases) {
+		zip_t *baseZip = zip_open(base.path.c_str(), 0, 'r');
+		PackageManifest baseManifest;
+		check(read_manifest(baseZip, baseManifest),
+		      "base manifest is embedded");
+		baseManifests.push_back(baseManifest);
+		baseZips.push_back(baseZip);
+	}
+
+	std::map<std::string, size_t> sources;
+	std::vector<std::string> missing;
+
+	bool success = StreamElementsBackupManifest::ResolveObjects(
+		manifest, baseManifests, sources, missing);
+
+	for (int index = 0; success && index < zip_total_entries(zip) &&
+			    0 == zip_entry_openbyindex(zip, index);
+	     ++index) {
+		std::string name = zip_entry_name(zip);
+		if (name != StreamElementsBackupManifest::MANIFEST_ZIP_PATH)
+			success = extract_current(zip, out / name);
+		zip_entry_close(zip);
+	}
+
+	for (auto &kv : sources) {
+		if (!success)
+			break;
+		zip_t *baseZip = baseZips[kv.second];
+		success = 0 == zip_entry_open(baseZip, kv.first.c_str()) &&
+			  extract_current(baseZip, out / kv.first);
+		zip_entry_close(baseZip);
+	}
+
+	for (auto baseZip : baseZips)
+		zip_close(baseZip);
+	zip_close(zip);
+
+	return success;
+}
+
+// Every object the package references is on disk with the content of the
+// source file it was taken from.
+static bool restored_matches(const Package &package,
+			     const std::vector<fs::path> &files,
+			     const fs::path &out)
+{
+	for (auto &file : files) {
+		std::string hash;
+		uint64_t size = 0;
+		StreamElementsBackupManifest::HashFile(file.string(), hash,
+						       size);
+
+		bool found = false;
+		for (auto &object : package.manifest.objects) {
+			if (object.hash != hash)
+				continue;
+			found = read_file(out / object.zipPath) ==
+				read_file(file);
+		}
+
+		if (!found)
+			return false;
+	}
+
+	return true;
+}
+
+static void test_incremental_chain()
+{
+	fs::path dir = fs::temp_directory_path() / "se_incremental_backup";
+	fs::remove_all(dir);
+
+	fs::path src = dir / "media";
+	std::vector<fs::path> files;
+
+	for (int i = 0; i < 6; ++i) {
+		files.push_back(src / ("clip" + std::to_string(i) + ".mp4"));
+		write_file(files.back(), media(20000 + i * 1000, (char)i));
+	}
+
+	// Same content under two names: one object.
+	files.push_back(src / "copy-of-clip0.MP4");
+	write_file(files.back(), media(20000, 0));
+
+	std::vector<Package> chain;
+
+	// 1. No chain yet: a full package.
+	chain.push_back(create_package(dir, "p1", files));
+
+	check(chain[0].stats.filesIncluded == 6 &&
+		      chain[0].stats.filesSkipped == 0,
+	      "the first package carries every distinct file");
+	check(chain[0].manifest.basePackageIds.empty(),
+	      "the first package has no base");
+	check(chain[0].manifest.objects.size() == 6,
+	      "identical content maps to one object");
+
+	const std::string original2 = read_file(files[2]);
+	const uint64_t unchangedBytes = 20000 + 21000 + 23000 + 24000 + 25000;
+
+	// 2. One file modified, one added.
+	write_file(files[2], media(30000, 'x'));
+	files.push_back(src / "new.png");
+	write_file(files.back(), media(5000, 'n'));
+
+	chain.push_back(create_package(dir, "p2", files));
+
+	check(chain[1].stats.filesIncluded == 2,
+	      "only the modified and added files are included");
+	check(chain[1].stats.bytesSkipped == unchangedBytes,
+	      "skipped bytes account for every unchanged file");
+	check(chain[1].manifest.basePackageIds ==
+		      std::vector<std::string>({"p1"}),
+	      "the second package lists its base");
+
+	// 3. Nothing changed: nothing included, nothing re-hashed.
+	chain.push_back(create_package(dir, "p3", files));
+
+	check(chain[2].stats.filesIncluded == 0,
+	      "an unchanged setup produces an empty incremental");
+	check(chain[2].stats.filesHashed == 0,
+	      "unchanged files are not re-hashed");
+	check(chain[2].stats.bytesSkipped == unchangedBytes + 30000 + 5000,
+	      "every byte is skipped");
+	check(fs::file_size(chain[2].path) < 2048,
+	      "an empty incremental is only metadata");
+
+	// 4. A file reverted to content an older package holds, and another
+	// one modified.
+	write_file(files[2], original2);
+	write_file(files[5], media(26000, 'y'));
+
+	chain.push_back(create_package(dir, "p4", files));
+
+	check(chain[3].stats.filesIncluded == 1,
+	      "content already held by the chain is not included again");
+	check(chain[3].manifest.basePackageIds ==
+		      std::vector<std::string>({"p1", "p2", "p3"}),
+	      "the chain is carried forward");
+
+	// Restore of the latest package from the full chain.
+	std::vector<Package> bases(chain.begin(), chain.end() - 1);
+
+	check(restore(chain[3], bases, dir / "restored"),
+	      "restore resolves every object from the chain");
+	check(restored_matches(chain[3], files, dir / "restored"),
+	      "restore rebuilds the current content of every file");
+	check(read_file(dir / "restored/basic/scenes/a.json") ==
+		      "{\"collection\":\"p4\"}",
+	      "regular entries come from the latest package");
+
+	// Without the package holding the modified clip the restore fails
+	// rather than producing a partial tree.
+	std::vector<Package> partial = {chain[0], chain[2]};
+
+	check(!restore(chain[3], partial, dir / "restored-partial"),
+	      "a missing base package fails the restore");
+
+	// 5. Reset: a new full package, independent of the old chain.
+	Package full = create_package(dir, "p5", files, true);
+
+	check(full.stats.filesIncluded == 7 && full.stats.filesSkipped == 0,
+	      "resetting the chain includes every distinct file");
+	check(restore(full, {}, dir / "restored-full") &&
+		      restored_matches(full, files, dir / "restored-full"),
+	      "a full package restores on its own");
+
+	fs::remove_all(dir);
+}
+
+static void test_same_content_different_extensions()
+{
+	fs::path dir = fs::temp_directory_path() / "se_incremental_backup_ext";
+	fs::remove_all(dir);
+
+	fs::path png = dir / "media/logo.png";
+	fs::path jpg = dir / "media/logo.jpg";
+
+	write_file(png, media(8000, 'l'));
+	write_file(jpg, media(8000, 'l'));
+
+	// The chain holds the content as .png only when the .jpg appears.
+	Package first = create_package(dir, "p1", {png});
+	Package second = create_package(dir, "p2", {png, jpg});
+
+	check(second.stats.filesIncluded == 1 &&
+		      second.stats.filesSkipped == 1,
+	      "the same content under another extension is another object");
+	check(second.manifest.objects.size() == 2 &&
+		      second.manifest.objects[0].zipPath !=
+			      second.manifest.objects[1].zipPath,
+	      "each extension gets its own object path");
+
+	check(restore(second, {first}, dir / "restored"),
+	      "restore resolves both objects");
+
+	bool restored = second.manifest.objects.size() == 2;
+
+	for (auto &object : second.manifest.objects) {
+		restored = restored && read_file(dir / "restored" /
+						 object.zipPath) ==
+					       read_file(png);
+	}
+
+	check(restored, "both objects are restored to their own path");
+
+	// Both in a full package at once.
+	Package full = create_package(dir, "p3", {png, jpg}, true);
+
+	check(full.stats.filesIncluded == 2 &&
+		      full.manifest.objects.size() == 2,
+	      "a full package carries the content once per extension");
+	check(restore(full, {}, dir / "restored-full"),
+	      "a full package restores both objects on its own");
+
+	fs::remove_all(dir);
+}
+
+static void test_manifest_validation()
+{
+	PackageManifest manifest;
+	manifest.packageId = "p";
+
+	StreamElementsBackupManifest::Object object;
+	object.hash = std::string(64, 'a');
+	object.size = 1;
+	object.packageId = "p";
+	object.zipPath = std::string(
+				 StreamElementsBackupManifest::OBJECTS_ZIP_FOLDER) +
+			 object.hash + ".png";
+	manifest.objects.push_back(object);
+
+	PackageManifest parsed;
+	check(PackageManifest::FromJson(manifest.ToJson(), parsed) &&
+		      parsed.objects.size() == 1 &&
+		      parsed.objects[0].zipPath == object.zipPath,
+	      "manifest round-trips");
+
+	manifest.objects[0].zipPath = "../../evil.png";
+	check(!PackageManifest::FromJson(manifest.ToJson(), parsed),
+	      "object paths outside the objects folder are rejected");
+
+	manifest.objects[0].zipPath =
+		std::string(StreamElementsBackupManifest::OBJECTS_ZIP_FOLDER) +
+		"../x";
+	check(!PackageManifest::FromJson(manifest.ToJson(), parsed),
+	      "object paths climbing out of the objects folder are rejected");
+
+	manifest.objects[0].zipPath =
+		std::string(StreamElementsBackupManifest::OBJECTS_ZIP_FOLDER) +
+		std::string(64, 'b') + ".png";
+	check(!PackageManifest::FromJson(manifest.ToJson(), parsed),
+	      "object paths of another hash are rejected");
+
+	check(!PackageManifest::FromJson("{not json", parsed),
+	      "garbage is rejected");
+}
+
+int main()
+{
+	test_manifest_validation();
+	test_incremental_chain();
+	test_same_content_different_extensions();
+
+	if (failures) {
+		std::fprintf(stderr, "%d check(s) failed\n", failures);
+		return 1;
+	}
+
+	std::puts("test_incremental_backup: all checks passed");
+	return 0;
+}
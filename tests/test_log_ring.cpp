@@ -0,0 +1,217 @@
+// Behavioural test for streamelements/StreamElementsLogRing.
+//
+// Checks ordering, wrap-around and message limits, then takes snapshots
+// continuously while several writers append: every record returned must be
+// whole (its payload is derived from its header, so a torn copy shows), in
+// sequence order, and in each writer's own append order.
+
+#include "streamelements/StreamElementsLogRing.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef StreamElementsLogRing ring_t;
+
+static int failures = 0;
+
+static void check(bool cond, const char *msg)
+{
+	if (!cond) {
+		std::fprintf(stderr, "FAIL: %s\n", msg);
+		++failures;
+	}
+}
+
+// "w<writer> n<index> " followed by a payload whose length and content are
+// derived from both.
+static std::string make_message(unsigned writer, uint64_t index)
+{
+	char header[64];
+	std::snprintf(header, sizeof(header), "w%u n%llu ", writer,
+		      (unsigned long long)index);
+
+	return header + std::string((size_t)((writer * 31 + index) % 150),
+				    (char)('a' + (writer + index) % 26));
+}
+
+static bool parse_message(const std::string &message, unsigned &writer,
+			  uint64_t &index)
+{
+	unsigned long long n = 0;
+
+	if (2 != std::sscanf(message.c_str(), "w%u n%llu ", &writer, &n))
+		return false;
+
+	index = n;
+
+	return message == make_message(writer, index);
+}
+
+/* ================================================================= */
+
+static void test_basics()
+{
+	ring_t ring(5);
+
+	check(ring.GetCapacity() == 8, "capacity rounds up to a power of two");
+	check(ring.Snapshot().empty(), "a new ring is empty");
+
+	ring.Append(ring_t::Category::ApiCall, "getSceneItems");
+	ring.AppendFormat(ring_t::Category::Error, "failed: %d", 42);
+
+	auto records = ring.Snapshot();
+
+	check(records.size() == 2, "records are returned");
+
+	if (records.size() == 2) {
+		check(records[0].message == "getSceneItems" &&
+			      records[0].category ==
+				      ring_t::Category::ApiCall,
+		      "first record round-trips");
+		check(records[1].message == "failed: 42" &&
+			      records[1].category == ring_t::Category::Error,
+		      "formatted record round-trips");
+		check(records[0].sequence == 0 && records[1].sequence == 1,
+		      "sequences start at zero");
+		check(records[0].timestamp > 0 &&
+			      records[0].timestamp <= records[1].timestamp,
+		      "records are timestamped");
+		check(records[0].thread != 0, "records carry a thread id");
+
+		const std::string line = ring_t::FormatRecord(records[1]);
+		check(line.find("error") != std::string::npos &&
+			      line.find("failed: 42") != std::string::npos,
+		      "formatted line carries category and message");
+	}
+
+	const std::string longMessage(1000, 'x');
+	ring.Append(ring_t::Category::Info, longMessage.c_str());
+	ring.AppendFormat(ring_t::Category::Info, "%s", longMessage.c_str());
+
+	records = ring.Snapshot();
+	check(records.size() == 4 &&
+		      records[2].message.size() == ring_t::MAX_MESSAGE_SIZE &&
+		      records[3].message.size() == ring_t::MAX_MESSAGE_SIZE,
+	      "long messages are cut at MAX_MESSAGE_SIZE");
+
+	for (int i = 0; i < 30; ++i)
+		ring.AppendFormat(ring_t::Category::Event, "event %d", i);
+
+	records = ring.Snapshot();
+	check(records.size() == 8, "a full ring holds capacity records");
+
+	bool latest = records.size() == 8;
+	for (size_t i = 0; latest && i < records.size(); ++i) {
+		latest = records[i].message ==
+				 "event " + std::to_string(22 + i) &&
+			 records[i].sequence == 26 + i;
+	}
+	check(latest, "a wrapped ring keeps the latest records, in order");
+
+	check(ring.GetAppendCount() == 34, "appends are counted");
+	check(ring.GetDroppedCount() == 0,
+	      "nothing is dropped without contention");
+
+	const std::string text = ring.Format();
+	check(std::count(text.begin(), text.end(), '\n') == 8,
+	      "Format() writes one line per record");
+}
+
+static void test_concurrent_snapshots()
+{
+	const unsigned WRITERS = 4;
+	const uint64_t PER_WRITER = 200000;
+
+	ring_t ring(1024);
+
+	std::atomic<unsigned> running(WRITERS);
+	std::vector<std::thread> writers;
+
+	for (unsigned w = 0; w < WRITERS; ++w) {
+		writers.emplace_back([&, w]() {
+			for (uint64_t n = 0; n < PER_WRITER; ++n) {
+				const std::string message = make_message(w, n);
+				ring.Append(ring_t::Category::Info,
+					    message.c_str(), message.size());
+			}
+
+			--running;
+		});
+	}
+
+	size_t snapshots = 0;
+	bool whole = true;
+	bool ordered = true;
+	bool perWriterOrdered = true;
+
+	auto verify = [&](const std::vector<ring_t::Record> &records) {
+		std::map<unsigned, uint64_t> lastIndex;
+
+		for (size_t i = 0; i < records.size(); ++i) {
+			unsigned writer = 0;
+			uint64_t index = 0;
+
+			if (!parse_message(records[i].message, writer, index)) {
+				whole = false;
+				continue;
+			}
+
+			if (i && records[i].sequence <= records[i - 1].sequence)
+				ordered = false;
+
+			auto it = lastIndex.find(writer);
+			if (it != lastIndex.end() && index <= it->second)
+				perWriterOrdered = false;
+
+			lastIndex[writer] = index;
+		}
+	};
+
+	do {
+		auto records = ring.Snapshot();
+
+		verify(records);
+
+		++snapshots;
+	} while (running.load());
+
+	for (auto &thread : writers)
+		thread.join();
+
+	auto final = ring.Snapshot();
+	verify(final);
+
+	check(snapshots > 0, "snapshots were taken while writers ran");
+	check(whole, "no snapshot returned a torn record");
+	check(ordered, "snapshots are in sequence order");
+	check(perWriterOrdered,
+	      "each writer's records appear in its own append order");
+
+	check(ring.GetAppendCount() == WRITERS * PER_WRITER,
+	      "every append claimed a sequence");
+	check(final.size() == ring.GetCapacity(),
+	      "every slot of the settled ring holds a record");
+	check(!final.empty() &&
+		      final.back().sequence + ring.GetCapacity() >=
+			      WRITERS * PER_WRITER,
+	      "the settled ring holds the latest appends");
+}
+
+int main()
+{
+	test_basics();
+	test_concurrent_snapshots();
+
+	if (failures) {
+		std::fprintf(stderr, "%d check(s) failed\n", failures);
+		return 1;
+	}
+
+	std::puts("test_log_ring: all checks passed");
+	return 0;
+}
@@ -0,0 +1,179 @@
+// Behavioural test for streamelements/StreamElementsMessageRoutingTable.
+//
+// Resolved routes must agree with a brute-force scan of the listeners in the
+// same snapshot, including while writers keep adding and removing listeners
+// and readers keep dispatching from whatever snapshot they got.
+
+#include "streamelements/StreamElementsMessageRoutingTable.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef StreamElementsMessageRoutingTable::flags_t flags_t;
+typedef StreamElementsMessageRoutingTable::targets_t targets_t;
+
+// Same values as StreamElementsMessageBus.
+static const flags_t DEST_ALL = 0xFFFFFFFFUL;
+static const flags_t DEST_ALL_LOCAL = 0x0000FFFFUL;
+static const flags_t DEST_UI = 0x00000001UL;
+static const flags_t DEST_WORKER = 0x00000002UL;
+static const flags_t DEST_BROWSER_SOURCE = 0x00000004UL;
+static const flags_t DEST_EXTERNAL_CONTROLLER = 0x00010000UL;
+
+static const std::vector<flags_t> MASKS = {DEST_ALL, DEST_ALL_LOCAL, DEST_UI,
+					   DEST_WORKER, DEST_BROWSER_SOURCE};
+
+static const flags_t SAMPLE_FLAGS[] = {DEST_UI, DEST_WORKER,
+				       DEST_BROWSER_SOURCE,
+				       DEST_UI | DEST_WORKER};
+
+static const flags_t SAMPLE_TYPES[] = {DEST_ALL,
+				       DEST_ALL_LOCAL,
+				       DEST_UI,
+				       DEST_WORKER,
+				       DEST_BROWSER_SOURCE,
+				       DEST_UI | DEST_BROWSER_SOURCE,
+				       DEST_EXTERNAL_CONTROLLER,
+				       0};
+
+static int failures = 0;
+
+static void check(bool cond, const char *msg)
+{
+	if (!cond) {
+		std::fprintf(stderr, "FAIL: %s\n", msg);
+		++failures;
+	}
+}
+
+static targets_t brute_force(const StreamElementsMessageRoutingTable::Snapshot &s,
+			     flags_t types)
+{
+	targets_t result;
+	for (auto &kv : s.GetListeners())
+		if (kv.second & types)
+			result.push_back(kv.first);
+	return result;
+}
+
+static void test_resolve()
+{
+	StreamElementsMessageRoutingTable table(MASKS);
+
+	check(table.GetSnapshot() && table.GetSnapshot()->IsEmpty(),
+	      "a new table has an empty snapshot");
+
+	table.Set("ui", DEST_UI);
+	table.Set("worker", DEST_WORKER);
+	table.Set("source", DEST_BROWSER_SOURCE);
+	table.Set("both", DEST_UI | DEST_WORKER);
+
+	auto before = table.GetSnapshot();
+
+	check(*before->Resolve(DEST_UI) == targets_t({"both", "ui"}),
+	      "a precomputed mask resolves in target order");
+	check(*before->Resolve(DEST_UI | DEST_BROWSER_SOURCE) ==
+		      targets_t({"both", "source", "ui"}),
+	      "an arbitrary mask resolves");
+	check(before->Resolve(DEST_EXTERNAL_CONTROLLER)->empty(),
+	      "external destinations reach no local listener");
+	check(before->Resolve(DEST_ALL).get() ==
+		      before->Resolve(DEST_ALL).get(),
+	      "precomputed routes are shared, not rebuilt");
+
+	table.Set("ui", DEST_WORKER);
+	table.Remove("both");
+	table.Remove("not-there");
+
+	auto after = table.GetSnapshot();
+
+	check(*after->Resolve(DEST_UI) == targets_t(),
+	      "changes are visible in the next snapshot");
+	check(*before->Resolve(DEST_UI) == targets_t({"both", "ui"}),
+	      "a snapshot taken earlier does not change");
+
+	flags_t flags = 0;
+	check(after->GetFlags("ui", flags) && flags == DEST_WORKER &&
+		      !after->GetFlags("both", flags),
+	      "listeners are looked up by target");
+}
+
+static void test_concurrent_changes()
+{
+	StreamElementsMessageRoutingTable table(MASKS);
+
+	std::atomic<bool> stop{false};
+	std::atomic<size_t> dispatched{0};
+	std::atomic<size_t> mismatches{0};
+
+	std::vector<std::thread> threads;
+
+	for (int w = 0; w < 4; ++w) {
+		threads.emplace_back([&, w]() {
+			std::mt19937 rng(w);
+			for (int i = 0; i < 2000; ++i) {
+				const std::string target =
+					"t" + std::to_string(rng() % 64);
+				if (rng() % 3 == 0)
+					table.Remove(target);
+				else
+					table.Set(target,
+						  SAMPLE_FLAGS[rng() % 4]);
+			}
+		});
+	}
+
+	for (int r = 0; r < 4; ++r) {
+		threads.emplace_back([&, r]() {
+			std::mt19937 rng(100 + r);
+			while (!stop) {
+				auto snapshot = table.GetSnapshot();
+				const flags_t types = SAMPLE_TYPES[rng() % 8];
+
+				auto targets = snapshot->Resolve(types);
+
+				if (*targets != brute_force(*snapshot, types))
+					++mismatches;
+
+				// Stands in for DispatchJSEventContainer().
+				dispatched += targets->size();
+			}
+		});
+	}
+
+	for (int w = 0; w < 4; ++w)
+		threads[w].join();
+
+	stop = true;
+
+	for (size_t i = 4; i < threads.size(); ++i)
+		threads[i].join();
+
+	check(mismatches == 0,
+	      "every snapshot routes consistently under concurrent changes");
+	check(dispatched > 0, "readers dispatched while writers ran");
+
+	auto snapshot = table.GetSnapshot();
+	for (auto types : SAMPLE_TYPES)
+		check(*snapshot->Resolve(types) ==
+			      brute_force(*snapshot, types),
+		      "the final snapshot routes consistently");
+}
+
+int main()
+{
+	test_resolve();
+	test_concurrent_changes();
+
+	if (failures) {
+		std::fprintf(stderr, "%d check(s) failed\n", failures);
+		return 1;
+	}
+
+	std::puts("test_message_routing_table: all checks passed");
+	return 0;
+}
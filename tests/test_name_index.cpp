@@ -0,0 +1,208 @@
+// Behavioural test for streamelements/StreamElementsNameIndex.
+//
+// Checks case-insensitive collisions, suffix allocation, renames, deletions
+// that free a lower suffix, names held by several owners, and that the
+// results always match a brute-force scan over a randomly churned set of
+// names.
+
+#include "streamelements/StreamElementsNameIndex.hpp"
+
+#include <cstdio>
+#include <map>
+#include <random>
+#include <string>
+#include <strings.h>
+#include <vector>
+
+typedef StreamElementsNameIndex index_t;
+
+static int failures = 0;
+
+static void check(bool cond, const char *msg)
+{
+	if (!cond) {
+		std::fprintf(stderr, "FAIL: %s\n", msg);
+		++failures;
+	}
+}
+
+// What ObsGetUniqueSourceName() used to do, over a plain list of names.
+static std::string brute_force_unique(const std::map<int, std::string> &names,
+				      const std::string &name)
+{
+	auto taken = [&](const std::string &candidate) {
+		for (auto &kv : names) {
+			if (0 == strcasecmp(kv.second.c_str(),
+					    candidate.c_str()))
+				return true;
+		}
+
+		return false;
+	};
+
+	std::string result(name);
+
+	for (int sequence = 1; taken(result); ++sequence)
+		result = name + " " + std::to_string(sequence);
+
+	return result;
+}
+
+/* ================================================================= */
+
+static void test_collisions()
+{
+	index_t index;
+
+	int a, b, c, d;
+
+	check(index.GetUniqueName("Browser") == "Browser",
+	      "a free name is used as is");
+
+	index.Set(&a, "Browser");
+	check(index.Contains("browser") && index.Contains("BROWSER"),
+	      "lookups ignore case");
+	check(index.GetUniqueName("BROWSER") == "BROWSER 1",
+	      "a taken name gets the first suffix, keeping the requested case");
+
+	index.Set(&b, "browser 1");
+	index.Set(&c, "Browser 2");
+	check(index.GetUniqueName("Browser") == "Browser 3",
+	      "taken suffixes are skipped");
+
+	index.Set(&d, "Browser 3");
+	check(index.GetUniqueName("Browser") == "Browser 4",
+	      "the next call continues from the last suffix");
+
+	check(index.IsTaken("browser", &b) && !index.IsTaken("browser", &a),
+	      "a name is not taken by its own owner");
+	check(index.GetSize() == 4, "owners are counted");
+
+	// Non-ASCII bytes are compared as they are.
+	index.Set(&a, "Ärger");
+	check(index.Contains("Ärger") && !index.Contains("ärger"),
+	      "only ASCII letters fold");
+	check(!index.Contains("Browser"), "Set() replaces an owner's name");
+}
+
+static void test_renames_and_deletions()
+{
+	index_t index;
+
+	std::vector<int> owners(10);
+
+	for (auto &owner : owners)
+		index.Set(&owner, index.GetUniqueName("Text"));
+
+	check(index.Contains("Text") && index.Contains("Text 9") &&
+		      !index.Contains("Text 10"),
+	      "bulk naming fills consecutive suffixes");
+
+	// Free "Text 4" by renaming it away, and "Text 7" by deleting it.
+	index.Rename(&owners[4], "Title");
+	index.Erase(&owners[7]);
+
+	check(index.GetUniqueName("Text") == "Text 4",
+	      "a renamed-away suffix is reused first");
+	index.Set(&owners[4], "Text 4");
+	check(index.GetUniqueName("Text") == "Text 7",
+	      "a deleted suffix is reused next");
+
+	index.Erase(&owners[0]);
+	check(index.GetUniqueName("text") == "text",
+	      "a freed base name is reused");
+
+	int stranger;
+	index.Rename(&stranger, "Text");
+	check(!index.Contains("Text"),
+	      "Rename() ignores owners that are not indexed");
+
+	// Two owners holding one name: the name stays taken until both go.
+	int first, second;
+	index.Set(&first, "Shared");
+	index.Set(&second, "shared");
+	check(index.GetOwners("SHARED").size() == 2,
+	      "every owner of a name is listed");
+	index.Erase(&first);
+	check(index.Contains("Shared"), "a name with an owner left is taken");
+	index.Erase(&second);
+	check(!index.Contains("Shared"), "a name with no owners is free");
+
+	// A base name that itself looks like a suffixed name.
+	int x, y;
+	index.Set(&x, "Scene 1");
+	index.Set(&y, "Scene 1 1");
+	check(index.GetUniqueName("Scene 1") == "Scene 1 2",
+	      "suffixes apply to names that end in a number");
+
+	index.Clear();
+	check(index.GetSize() == 0 && index.GetUniqueName("Scene 1") ==
+						      "Scene 1",
+	      "Clear() forgets everything");
+}
+
+static void test_matches_brute_force()
+{
+	index_t index;
+	std::map<int, std::string> names;
+	std::vector<int> owners(200);
+
+	std::mt19937 rng(1234);
+	const char *bases[] = {"Image", "image", "Browser", "Scene",
+			       "Scene 1", "Text"};
+
+	bool matches = true;
+
+	for (int step = 0; step < 20000 && matches; ++step) {
+		const int owner = (int)(rng() % owners.size());
+		const std::string base = bases[rng() % 6];
+
+		switch (rng() % 4) {
+		case 0:
+		case 1: {
+			const std::string expected =
+				brute_force_unique(names, base);
+			const std::string actual = index.GetUniqueName(base);
+
+			matches = expected == actual;
+
+			index.Set(&owners[owner], actual);
+			names[owner] = actual;
+			break;
+		}
+		case 2:
+			index.Erase(&owners[owner]);
+			names.erase(owner);
+			break;
+		case 3: {
+			// Rename to an arbitrary, possibly duplicate name.
+			const std::string name =
+				base + " " + std::to_string(rng() % 8);
+
+			if (names.count(owner)) {
+				index.Rename(&owners[owner], name);
+				names[owner] = name;
+			}
+			break;
+		}
+		}
+	}
+
+	check(matches, "unique names match the brute-force scan under churn");
+	check(index.GetSize() == names.size(), "owner count matches");
+}
+
+int main()
+{
+	test_collisions();
+	test_renames_and_deletions();
+	test_matches_brute_force();
+
+	if (failures) {
+		std::fprintf(stderr, "%d check(s) failed\n", failures);
+		return 1;
+	}
+
+	std::puts("test_name_index: all checks passed");
+	return 0;
+}
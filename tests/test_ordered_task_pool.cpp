@@ -0,0 +1,228 @@
+// Behavioural test for streamelements/StreamElementsOrderedTaskPool.
+//
+// Posts tasks for many keys from many threads and checks that the tasks of
+// each key run one at a time and in order, that a key whose task blocks does
+// not hold up the others, and that Stop() discards what has not started.
+//
+// Then serves concurrent local websocket clients the way
+// StreamElementsWebsocketApiServer does: websocketpp on a pool of io
+// threads, messages parsed and answered on the task pool, keyed by
+// connection. Each client must receive its replies in the order it sent its
+// requests, also while another client sends a large payload.
+
+#include "streamelements/StreamElementsOrderedTaskPool.hpp"
+#include "ordered_task_pool_echo.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+static int failures = 0;
+
+static void check(bool cond, const char *msg)
+{
+	if (!cond) {
+		std::fprintf(stderr, "FAIL: %s\n", msg);
+		++failures;
+	}
+}
+
+/* ================================================================= */
+
+static void test_order_per_key()
+{
+	StreamElementsOrderedTaskPool pool(4);
+
+	const int keys = 16;
+	const int producers = 4;
+	const int tasksPerProducer = 2000;
+
+	// Keys are the addresses of these
+	std::vector<int> keyObjects(keys);
+
+	std::vector<std::vector<int>> ran(keys);
+	std::vector<std::atomic<int>> running(keys);
+	std::atomic<bool> overlapped = {false};
+
+	// Each producer owns keys `producer`, `producer + producers`, ...
+	std::vector<std::thread> threads;
+
+	for (int producer = 0; producer < producers; ++producer) {
+		threads.emplace_back([&, producer]() {
+			for (int i = 0; i < tasksPerProducer; ++i) {
+				const int key = producer + (i % (keys / producers)) *
+								   producers;
+
+				pool.Post(&keyObjects[key], [&, key, i]() {
+					if (running[key]++)
+						overlapped = true;
+
+					ran[key].push_back(i);
+
+					--running[key];
+				});
+			}
+		});
+	}
+
+	for (auto &thread : threads)
+		thread.join();
+
+	pool.Flush();
+
+	bool ordered = true;
+	size_t total = 0;
+
+	for (auto &list : ran) {
+		total += list.size();
+
+		for (size_t i = 1; i < list.size(); ++i)
+			ordered = ordered && list[i - 1] < list[i];
+	}
+
+	check(total == (size_t)producers * tasksPerProducer,
+	      "every task runs once");
+	check(ordered, "tasks of a key run in the order they were posted");
+	check(!overlapped, "tasks of a key never run concurrently");
+}
+
+static void test_blocked_key()
+{
+	StreamElementsOrderedTaskPool pool(2);
+
+	int a, b;
+
+	std::mutex mutex;
+	std::condition_variable released;
+	bool release = false;
+
+	std::atomic<int> ranA = {0};
+	std::atomic<int> ranB = {0};
+
+	pool.Post(&a, [&]() {
+		std::unique_lock<std::mutex> lock(mutex);
+		released.wait(lock, [&]() { return release; });
+		++ranA;
+	});
+	pool.Post(&a, [&]() { ++ranA; });
+
+	for (int i = 0; i < 100; ++i)
+		pool.Post(&b, [&]() { ++ranB; });
+
+	auto deadline =
+		std::chrono::steady_clock::now() + std::chrono::seconds(5);
+
+	while (ranB < 100 && std::chrono::steady_clock::now() < deadline)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+	check(ranB == 100, "a blocked key does not hold up other keys");
+	check(ranA == 0, "tasks behind a blocked task of their key wait");
+
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+		release = true;
+	}
+	released.notify_all();
+
+	pool.Flush();
+
+	check(ranA == 2, "a released key runs its remaining tasks");
+}
+
+static void test_stop()
+{
+	StreamElementsOrderedTaskPool pool(1);
+
+	int key;
+	std::atomic<int> ran = {0};
+	std::atomic<bool> started = {false};
+
+	pool.Post(&key, [&]() {
+		started = true;
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		++ran;
+	});
+
+	for (int i = 0; i < 10; ++i)
+		pool.Post(&key, [&]() { ++ran; });
+
+	while (!started)
+		std::this_thread::yield();
+
+	pool.Stop();
+
+	check(ran == 1, "stop waits for the running task and discards the rest");
+
+	pool.Post(&key, [&]() { ++ran; });
+	pool.Flush();
+
+	check(ran == 1, "tasks posted after stop are discarded");
+}
+
+/* ================================================================= */
+
+static void test_concurrent_clients()
+{
+	const int clientCount = 8;
+	const int requestCount = 2000;
+	const size_t largePayloadBytes = 16 * 1024 * 1024;
+
+	StreamElementsOrderedTaskPool pool(4);
+	EchoServer server(2, &pool);
+
+	const uint16_t port = server.GetPort();
+
+	// Small requests, alone and while another client sends a large one
+	auto stats = run_clients(port, clientCount, requestCount);
+
+	bool complete = true;
+	bool ordered = true;
+
+	for (auto &client : stats) {
+		complete = complete && client.received == requestCount;
+		ordered = ordered && client.ordered;
+	}
+
+	check(complete, "every client receives every reply");
+	check(ordered, "every client receives its replies in order");
+
+	LargeRequestClient largeClient(port, largePayloadBytes);
+
+	// Let the large request arrive first
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+	stats = run_clients(port, clientCount, requestCount);
+
+	complete = true;
+	ordered = true;
+
+	for (auto &client : stats) {
+		complete = complete && client.received == requestCount;
+		ordered = ordered && client.ordered;
+	}
+
+	check(complete && ordered,
+	      "replies are complete and in order next to a large request");
+}
+
+int main()
+{
+	test_order_per_key();
+	test_blocked_key();
+	test_stop();
+	test_concurrent_clients();
+
+	if (failures) {
+		std::fprintf(stderr, "%d check(s) failed\n", failures);
+		return 1;
+	}
+
+	std::puts("test_ordered_task_pool: all checks passed");
+	return 0;
+}
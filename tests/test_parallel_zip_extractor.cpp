@@ -0,0 +1,291 @@
+// Behavioural test for streamelements/StreamElementsParallelZipExtractor and
+// the package path classification RestoreBackupPackageContent filters with.
+//
+// Archives with thousands of entries are written through zip.h, filtered the
+// way the restore path filters them, extracted in parallel and compared byte
+// for byte. Unsafe entry paths must be refused, and a failed extraction must
+// leave the destination exactly as it was.
+
+#include "streamelements/StreamElementsParallelZipExtractor.hpp"
+#include "streamelements/StreamElementsBackupManifest.hpp"
+#include "streamelements/deps/zip/zip.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+typedef StreamElementsBackupManifest::PackagePathKind PackagePathKind;
+
+static int failures = 0;
+
+static void check(bool cond, const char *msg)
+{
+	if (!cond) {
+		std::fprintf(stderr, "FAIL: %s\n", msg);
+		++failures;
+	}
+}
+
+static void write_file(const fs::path &path, const std::string &content)
+{
+	fs::create_directories(path.parent_path());
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	out << content;
+}
+
+static std::string read_file(const fs::path &path)
+{
+	std::ifstream in(path, std::ios::binary);
+	std::stringstream buffer;
+	buffer << in.rdbuf();
+	return buffer.str();
+}
+
+struct Entry {
+	std::string name;
+	std::string content;
+};
+
+static void write_archive(const fs::path &path,
+			  const std::vector<Entry> &entries)
+{
+	zip_t *zip = zip_open(path.string().c_str(), 6, 'w');
+	for (auto &entry : entries) {
+		zip_entry_open(zip, entry.name.c_str());
+		zip_entry_write(zip, entry.content.data(),
+				entry.content.size());
+		zip_entry_close(zip);
+	}
+	zip_close(zip);
+}
+
+static size_t count_temp_files(const fs::path &dir)
+{
+	size_t count = 0;
+	for (auto &item : fs::recursive_directory_iterator(dir)) {
+		const std::string name = item.path().filename().string();
+		if (name.size() > 4 &&
+		    name.compare(name.size() - 4, 4, ".tmp") == 0)
+			++count;
+	}
+	return count;
+}
+
+// Mirrors IsQualifiedFileForRestore() in StreamElementsBackupManager.cpp.
+static bool is_qualified(const std::string &name,
+			 const std::set<std::string> &profiles,
+			 const std::set<std::string> &collections)
+{
+	std::string id;
+	switch (StreamElementsBackupManifest::ClassifyPackagePath(name, id)) {
+	case PackagePathKind::Profile:
+		return profiles.empty() || profiles.count(id);
+	case PackagePathKind::SceneCollection:
+		return collections.empty() || collections.count(id);
+	default:
+		return true;
+	}
+}
+
+static void test_classification()
+{
+	std::string id;
+
+	check(StreamElementsBackupManifest::ClassifyPackagePath(
+		      "basic/profiles/My_Profile/basic.ini", id) ==
+			      PackagePathKind::Profile &&
+		      id == "My_Profile",
+	      "profile files are classified with their profile id");
+	check(StreamElementsBackupManifest::ClassifyPackagePath(
+		      "basic/scenes/Untitled.json", id) ==
+			      PackagePathKind::SceneCollection &&
+		      id == "Untitled",
+	      "scene collections are classified with their id");
+	check(StreamElementsBackupManifest::ClassifyPackagePath(
+		      "basic/scenes/Untitled.json.bak", id) ==
+		      PackagePathKind::Other,
+	      "only .json files are scene collections");
+	check(StreamElementsBackupManifest::ClassifyPackagePath(
+		      "basic/profiles/", id) == PackagePathKind::Other,
+	      "a profile needs an id");
+	check(StreamElementsBackupManifest::ClassifyPackagePath(
+		      "basic/scenes/.json", id) == PackagePathKind::Other,
+	      "a scene collection needs an id");
+	check(StreamElementsBackupManifest::ClassifyPackagePath(
+		      "obslive_restored_files/x/basic/scenes/a.json", id) ==
+		      PackagePathKind::Other,
+	      "classification is anchored at the package root");
+}
+
+static void test_unsafe_paths()
+{
+	const char *unsafe[] = {"../evil.txt",
+				"a/../../evil.txt",
+				"a/..",
+				"/etc/passwd",
+				"C:/Windows/evil.dll",
+				"a\\..\\..\\evil.txt",
+				"file.txt:stream",
+				"a//b.txt",
+				"./a.txt",
+				"folder/",
+				""};
+
+	for (auto path : unsafe) {
+		if (StreamElementsParallelZipExtractor::IsSafeEntryPath(path)) {
+			std::fprintf(stderr, "accepted: %s\n", path);
+			check(false, "unsafe entry path is refused");
+		}
+	}
+
+	check(StreamElementsParallelZipExtractor::IsSafeEntryPath(
+		      "basic/scenes/a..b.json"),
+	      "dots inside a name are fine");
+	check(StreamElementsParallelZipExtractor::IsSafeEntryPath(
+		      "plugin_config/obs-browser/Cookies"),
+	      "plain relative paths are accepted");
+}
+
+static void test_thousands_of_entries()
+{
+	fs::path dir = fs::temp_directory_path() / "se_parallel_zip_extractor";
+	fs::remove_all(dir);
+
+	std::vector<Entry> entries;
+
+	for (int i = 0; i < 3000; ++i) {
+		entries.push_back(
+			{"plugin_config/obs-streamelements-core/scoped_config_storage/s/c/item" +
+				 std::to_string(i) + ".json",
+			 "{\"value\":" + std::to_string(i * 7919) + "}"});
+	}
+
+	entries.push_back({"basic/scenes/Keep.json", "{\"keep\":true}"});
+	entries.push_back({"basic/scenes/Drop.json", "{\"drop\":true}"});
+	entries.push_back({"basic/profiles/Keep/basic.ini", "[General]"});
+	entries.push_back({"basic/profiles/Drop/basic.ini", "[General]"});
+	entries.push_back({"obslive_restored_files/big.bin",
+			   std::string(3 * 1024 * 1024, 'b')});
+
+	fs::path archive = dir / "package.zip";
+	fs::create_directories(dir);
+	write_archive(archive, entries);
+
+	fs::path dest = dir / "obs-studio";
+
+	// An existing, longer file must be replaced, not overwritten in place.
+	write_file(dest / "basic/scenes/Keep.json",
+		   std::string(1000, 'x'));
+
+	StreamElementsParallelZipExtractor extractor(
+		dest.string(), StreamElementsParallelZipExtractor::Options());
+
+	size_t progressCalls = 0;
+	extractor.SetProgressCallback(
+		[&](const StreamElementsParallelZipExtractor::Stats &) {
+			++progressCalls;
+		});
+
+	const std::set<std::string> profiles = {"Keep"};
+	const std::set<std::string> collections = {"Keep"};
+
+	size_t queued = 0;
+	for (size_t i = 0; i < entries.size(); ++i) {
+		if (!is_qualified(entries[i].name, profiles, collections))
+			continue;
+		check(extractor.Add(archive.string(), (int)i, entries[i].name,
+				    entries[i].content.size()),
+		      "safe entry is queued");
+		++queued;
+	}
+
+	check(queued == entries.size() - 2, "filtered entries are skipped");
+	check(!extractor.Add(archive.string(), 0, "../outside.json", 1),
+	      "traversal entry is refused on Add");
+
+	check(extractor.Run(), "extraction succeeds");
+
+	auto stats = extractor.GetStats();
+	check(stats.entriesExtracted == queued, "every entry is extracted");
+	check(stats.entriesFailed == 0, "no entry failed");
+	check(progressCalls >= 1, "progress is reported");
+	check(stats.bytesExtracted == stats.bytesQueued,
+	      "byte counts add up");
+
+	bool identical = true;
+	for (auto &entry : entries) {
+		if (!is_qualified(entry.name, profiles, collections))
+			continue;
+		if (read_file(dest / entry.name) != entry.content)
+			identical = false;
+	}
+
+	check(identical, "extracted content matches the archive");
+	check(!fs::exists(dest / "basic/scenes/Drop.json") &&
+		      !fs::exists(dest / "basic/profiles/Drop"),
+	      "deselected profiles and scene collections are not restored");
+	check(!fs::exists(dir / "outside.json"),
+	      "nothing lands outside the destination");
+	check(count_temp_files(dest) == 0, "no temporary files remain");
+
+	fs::remove_all(dir);
+}
+
+static void test_failure_leaves_destination_untouched()
+{
+	fs::path dir = fs::temp_directory_path() / "se_parallel_zip_extractor_fail";
+	fs::remove_all(dir);
+
+	std::vector<Entry> entries;
+	for (int i = 0; i < 500; ++i)
+		entries.push_back({"data/file" + std::to_string(i) + ".txt",
+				   "new content " + std::to_string(i)});
+
+	fs::path archive = dir / "package.zip";
+	fs::create_directories(dir);
+	write_archive(archive, entries);
+
+	fs::path dest = dir / "obs-studio";
+	write_file(dest / "data/file0.txt", "old content");
+
+	StreamElementsParallelZipExtractor extractor(
+		dest.string(), StreamElementsParallelZipExtractor::Options());
+
+	for (size_t i = 0; i < entries.size(); ++i)
+		extractor.Add(archive.string(), (int)i, entries[i].name, 0);
+
+	// An entry that does not exist in the archive.
+	extractor.Add(archive.string(), 100000, "data/missing.txt", 0);
+
+	check(!extractor.Run(), "a failed entry fails the extraction");
+	check(read_file(dest / "data/file0.txt") == "old content",
+	      "existing files are untouched after a failure");
+	check(!fs::exists(dest / "data/file1.txt"),
+	      "no new files appear after a failure");
+	check(count_temp_files(dest) == 0,
+	      "temporary files are removed after a failure");
+
+	fs::remove_all(dir);
+}
+
+int main()
+{
+	test_classification();
+	test_unsafe_paths();
+	test_thousands_of_entries();
+	test_failure_leaves_destination_untouched();
+
+	if (failures) {
+		std::fprintf(stderr, "%d check(s) failed\n", failures);
+		return 1;
+	}
+
+	std::puts("test_parallel_zip_extractor: all checks passed");
+	return 0;
+}
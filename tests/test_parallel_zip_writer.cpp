@@ -0,0 +1,245 @@
+// Behavioural test for streamelements/StreamElementsParallelZipWriter.
+//
+// Builds archives from a generated directory tree -- text, incompressible
+// media, files large enough to take the streaming path, in-memory buffers --
+// and reads them back through the same zip.h calls the restore path in
+// StreamElementsBackupManager uses: zip_open(..., 'r'),
+// zip_entry_openbyindex() and zip_entry_extract(). A missing file must be
+// reported by GetFailedEntries() once Flush() returns.
+
+#include "streamelements/StreamElementsParallelZipWriter.hpp"
+#include "streamelements/deps/zip/zip.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static int failures = 0;
+
+static void check(bool cond, const char *msg)
+{
+	if (!cond) {
+		std::fprintf(stderr, "FAIL: %s\n", msg);
+		++failures;
+	}
+}
+
+static void write_file(const fs::path &path, const std::string &content)
+{
+	fs::create_directories(path.parent_path());
+	std::ofstream out(path, std::ios::binary);
+	out << content;
+}
+
+static std::string random_bytes(size_t size, unsigned seed)
+{
+	std::mt19937 rng(seed);
+	std::string result(size, '\0');
+	for (auto &ch : result)
+		ch = (char)(rng() & 0xFF);
+	return result;
+}
+
+static std::string text(size_t size, unsigned seed)
+{
+	static const char *words[] = {"scene", "source", "item", "\"name\": ",
+				      "{", "}", "\n", "transform", "0.5"};
+	std::mt19937 rng(seed);
+	std::string result;
+	while (result.size() < size)
+		result += words[rng() % 9];
+	result.resize(size);
+	return result;
+}
+
+static size_t on_extract(void *arg, unsigned long long, const void *data,
+			 size_t size)
+{
+	((std::string *)arg)->append((const char *)data, size);
+	return size;
+}
+
+struct ArchiveEntry {
+	std::string name;
+	std::string content;
+};
+
+static std::vector<ArchiveEntry> read_archive(const fs::path &path)
+{
+	std::vector<ArchiveEntry> result;
+
+	zip_t *zip = zip_open(path.string().c_str(), 0, 'r');
+	if (!zip)
+		return result;
+
+	for (int index = 0; index < zip_total_entries(zip) &&
+			    0 == zip_entry_openbyindex(zip, index);
+	     ++index) {
+		ArchiveEntry entry;
+		entry.name = zip_entry_name(zip);
+		if (0 != zip_entry_extract(zip, on_extract, &entry.content))
+			entry.name = "<extract failed>";
+		result.push_back(entry);
+		zip_entry_close(zip);
+	}
+
+	zip_close(zip);
+	return result;
+}
+
+static void test_round_trip(int level, size_t workers)
+{
+	fs::path dir = fs::temp_directory_path() / "se_parallel_zip_writer";
+	fs::remove_all(dir);
+
+	std::vector<ArchiveEntry> expected;
+
+	for (unsigned i = 0; i < 40; ++i) {
+		std::string name = "basic/scenes/collection" +
+				   std::to_string(i) + ".json";
+		std::string content = text(1000 + i * 997, i);
+		write_file(dir / name, content);
+		expected.push_back({name, content});
+	}
+
+	for (unsigned i = 0; i < 8; ++i) {
+		std::string name = "media/clip" + std::to_string(i) + ".webm";
+		std::string content = random_bytes(50000 + i, 100 + i);
+		write_file(dir / name, content);
+		expected.push_back({name, content});
+	}
+
+	// Incompressible content under a neutral extension: caught by the
+	// entropy check.
+	expected.push_back({"media/blob.bin", random_bytes(70000, 7)});
+	write_file(dir / "media/blob.bin", expected.back().content);
+
+	// Larger than maxInMemoryEntryBytes below: read and deflated by a
+	// worker in chunks, which the writer appends.
+	expected.push_back({"media/large.log", text(3 * 1024 * 1024 + 17, 9)});
+	write_file(dir / "media/large.log", expected.back().content);
+
+	expected.push_back(
+		{"media/large.bin", random_bytes(2 * 1024 * 1024, 11)});
+	write_file(dir / "media/large.bin", expected.back().content);
+
+	expected.push_back({"tiny.txt", "ab"});
+	write_file(dir / "tiny.txt", "ab");
+
+	expected.push_back({"empty.txt", ""});
+	write_file(dir / "empty.txt", "");
+
+	StreamElementsParallelZipWriter::Options options;
+	options.level = level;
+	options.workerCount = workers;
+	options.maxInMemoryEntryBytes = 1024 * 1024;
+	options.maxInFlightBytes = 256 * 1024;
+
+	fs::path archive = dir / "out.zip";
+
+	StreamElementsParallelZipWriter writer(options);
+	check(writer.Open(archive.string()), "archive opens for writing");
+
+	size_t progressCalls = 0;
+	writer.SetProgressCallback(
+		[&](const StreamElementsParallelZipWriter::Stats &) {
+			++progressCalls;
+		});
+
+	for (size_t i = 0; i < expected.size(); ++i) {
+		if (i % 5 == 4) {
+			// Interleave buffers with files, as backups do.
+			writer.AddBuffer(expected[i].content,
+					 expected[i].name);
+		} else {
+			writer.AddFile((dir / expected[i].name).string(),
+				       expected[i].name);
+		}
+	}
+
+	writer.AddFile((dir / "does-not-exist").string(), "missing.txt");
+
+	writer.Flush();
+
+	auto failed = writer.GetFailedEntries();
+	check(failed.size() == 1 && failed[0] == "missing.txt",
+	      "the missing file is reported once every entry is written");
+
+	check(!writer.Close(), "a missing file is reported by Close()");
+
+	auto stats = writer.GetStats();
+	check(stats.entriesFailed == 1, "exactly the missing file failed");
+	check(stats.entriesWritten == expected.size(),
+	      "every other entry was written");
+	check(progressCalls == expected.size() + 1,
+	      "progress is reported once per entry");
+
+	if (level > 0)
+		check(stats.entriesStored >= 10,
+		      "media, high-entropy and tiny files are stored");
+
+	auto actual = read_archive(archive);
+
+	check(actual.size() == expected.size(),
+	      "archive has one entry per successful AddFile/AddBuffer");
+
+	bool ordered = actual.size() == expected.size();
+	for (size_t i = 0; ordered && i < actual.size(); ++i) {
+		if (actual[i].name != expected[i].name ||
+		    actual[i].content != expected[i].content)
+			ordered = false;
+	}
+
+	check(ordered,
+	      "entries round-trip byte for byte, in the order they were queued");
+
+	if (level > 0) {
+		check(fs::file_size(archive) < stats.bytesIn,
+		      "compressible content was actually compressed");
+	}
+
+	fs::remove_all(dir);
+}
+
+static void test_incompressible_detection()
+{
+	std::string noise = random_bytes(65536, 3);
+	std::string prose = text(65536, 3);
+
+	check(StreamElementsParallelZipWriter::IsIncompressible(
+		      "a/b/c.bin", (const unsigned char *)noise.data(),
+		      noise.size()),
+	      "high-entropy content is incompressible");
+	check(!StreamElementsParallelZipWriter::IsIncompressible(
+		      "a/b/c.bin", (const unsigned char *)prose.data(),
+		      prose.size()),
+	      "text is compressible");
+	check(StreamElementsParallelZipWriter::IsIncompressible(
+		      "C:\\media\\Intro.MP4", (const unsigned char *)"", 0),
+	      "extension match is case-insensitive");
+	check(!StreamElementsParallelZipWriter::IsIncompressible(
+		      "dir.mp4/file", (const unsigned char *)"", 0),
+	      "a dot in a directory name is not an extension");
+}
+
+int main()
+{
+	test_incompressible_detection();
+
+	test_round_trip(6, 4);
+	test_round_trip(9, 1);
+	test_round_trip(0, 3);
+
+	if (failures) {
+		std::fprintf(stderr, "%d check(s) failed\n", failures);
+		return 1;
+	}
+
+	std::puts("test_parallel_zip_writer: all checks passed");
+	return 0;
+}
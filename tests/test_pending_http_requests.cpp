@@ -0,0 +1,258 @@
+// Behavioural test for streamelements/StreamElementsPendingHttpRequests, the
+// wait behind the message bus HTTP bridge.
+//
+// A real HttpServer forwards every request to a simulated browser the way
+// StreamElementsMessageBus::AddListener does -- Begin(), hand the id over,
+// Wait() -- and the browser answers from its own thread, out of order. Many
+// concurrent clients must each get their own answer, unanswered requests
+// must time out, and requests past the cap must be refused right away.
+
+#include "streamelements/StreamElementsPendingHttpRequests.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef StreamElementsPendingHttpRequests::Options Options;
+
+static int failures = 0;
+
+static void check(bool cond, const char *msg)
+{
+	if (!cond) {
+		std::fprintf(stderr, "FAIL: %s\n", msg);
+		++failures;
+	}
+}
+
+// Stands in for the browser: receives the ids of forwarded requests.
+struct Browser {
+	std::mutex mutex;
+	std::condition_variable cv;
+	std::deque<std::string> inbox;
+
+	void Receive(const std::string &id)
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+		inbox.push_back(id);
+		cv.notify_all();
+	}
+
+	std::vector<std::string> Take(size_t count)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		cv.wait_for(lock, std::chrono::seconds(20),
+			    [&]() { return inbox.size() >= count; });
+
+		std::vector<std::string> result(inbox.begin(), inbox.end());
+		inbox.clear();
+		return result;
+	}
+};
+
+// Mirrors the handler installed by StreamElementsMessageBus::AddListener().
+static HttpServer::request_handler_t
+make_handler(StreamElementsPendingHttpRequests &pending, Browser &browser)
+{
+	return [&](const HttpServer::request_t &req,
+		   HttpServer::response_t &res) {
+		const std::string id = req.path;
+
+		if (!pending.Begin(id)) {
+			res.status = 503;
+			res.reason = "Too Many Waiting Requests";
+			return;
+		}
+
+		browser.Receive(id);
+
+		pending.Wait(id, res);
+	};
+}
+
+static void answer(StreamElementsPendingHttpRequests &pending,
+		   const std::string &id)
+{
+	check(pending.Complete(id,
+			       [&](HttpServer::response_t &res) {
+				       res.status = 201;
+				       res.reason = "Created";
+				       res.set_header("X-Request", id.c_str());
+				       res.set_content("answer:" + id,
+						       "text/plain");
+			       }),
+	      "a waiting request can be completed");
+}
+
+static void test_out_of_order_answers()
+{
+	const size_t count = 48;
+
+	StreamElementsPendingHttpRequests pending;
+	Options options;
+	options.timeout = std::chrono::seconds(10);
+	options.maxWaitingRequests = count;
+	pending.SetOptions(options);
+
+	Browser browser;
+	HttpServer server(make_handler(pending, browser),
+			  options.maxWaitingRequests + 1);
+
+	const int port = server.Start();
+	check(port > 0, "server starts");
+
+	std::atomic<size_t> correct{0};
+	std::atomic<size_t> cors{0};
+	std::vector<std::thread> clients;
+
+	for (size_t i = 0; i < count; ++i) {
+		// httplib listens with a backlog of 5: connecting all at once
+		// would only measure SYN retransmits.
+		std::this_thread::sleep_for(std::chrono::milliseconds(2));
+
+		clients.emplace_back([&, i]() {
+			httplib::Client client("127.0.0.1", port);
+			client.set_read_timeout(10, 0);
+
+			const std::string path = "/req/" + std::to_string(i);
+			auto result = client.Get(path.c_str());
+
+			if (result && result->status == 201 &&
+			    result->body == "answer:" + path &&
+			    result->get_header_value("X-Request") == path)
+				++correct;
+
+			if (result &&
+			    result->has_header("Access-Control-Allow-Origin"))
+				++cors;
+		});
+	}
+
+	// Every request is waiting before any is answered, then they are
+	// answered in random order.
+	std::vector<std::string> ids = browser.Take(count);
+	check(ids.size() == count, "every request reaches the browser");
+
+	std::mt19937 rng(31);
+	std::shuffle(ids.begin(), ids.end(), rng);
+
+	for (auto &id : ids)
+		answer(pending, id);
+
+	for (auto &client : clients)
+		client.join();
+
+	check(correct == count, "every client gets its own answer");
+	check(cors == count, "headers set by the server are kept");
+	check(pending.GetWaitingCount() == 0, "no request is left waiting");
+
+	server.Stop();
+}
+
+static void test_timeout()
+{
+	StreamElementsPendingHttpRequests pending;
+	Options options;
+	options.timeout = std::chrono::milliseconds(200);
+	pending.SetOptions(options);
+
+	Browser browser;
+	HttpServer server(make_handler(pending, browser), 4);
+
+	const int port = server.Start();
+
+	httplib::Client client("127.0.0.1", port);
+
+	const auto start = std::chrono::steady_clock::now();
+	auto result = client.Get("/never-answered");
+	const auto elapsed = std::chrono::steady_clock::now() - start;
+
+	check(result && result->status == 404,
+	      "an unanswered request times out as not handled");
+	check(elapsed < std::chrono::seconds(5),
+	      "the configured timeout applies");
+
+	check(!pending.Complete("/never-answered",
+				[](HttpServer::response_t &) {}),
+	      "a late answer is refused");
+	check(!pending.Complete("/unknown", [](HttpServer::response_t &) {}),
+	      "an unknown request cannot be completed");
+	check(pending.GetWaitingCount() == 0,
+	      "a timed out request is forgotten");
+
+	server.Stop();
+}
+
+static void test_waiting_cap()
+{
+	StreamElementsPendingHttpRequests pending;
+	Options options;
+	options.timeout = std::chrono::seconds(10);
+	options.maxWaitingRequests = 2;
+	pending.SetOptions(options);
+
+	Browser browser;
+	HttpServer server(make_handler(pending, browser),
+			  options.maxWaitingRequests + 1);
+
+	const int port = server.Start();
+
+	std::atomic<size_t> answered{0};
+	std::vector<std::thread> clients;
+
+	for (int i = 0; i < 2; ++i) {
+		clients.emplace_back([&, i]() {
+			httplib::Client client("127.0.0.1", port);
+			auto result = client.Get(
+				("/waiting/" + std::to_string(i)).c_str());
+			if (result && result->status == 201)
+				++answered;
+		});
+	}
+
+	std::vector<std::string> ids = browser.Take(2);
+
+	httplib::Client client("127.0.0.1", port);
+
+	const auto start = std::chrono::steady_clock::now();
+	auto refused = client.Get("/one-too-many");
+	const auto elapsed = std::chrono::steady_clock::now() - start;
+
+	check(refused && refused->status == 503,
+	      "a request past the cap is refused");
+	check(elapsed < std::chrono::seconds(2),
+	      "a request past the cap is refused without waiting");
+
+	for (auto &id : ids)
+		answer(pending, id);
+
+	for (auto &thread : clients)
+		thread.join();
+
+	check(answered == 2, "requests within the cap are still answered");
+
+	server.Stop();
+}
+
+int main()
+{
+	test_out_of_order_answers();
+	test_timeout();
+	test_waiting_cap();
+
+	if (failures) {
+		std::fprintf(stderr, "%d check(s) failed\n", failures);
+		return 1;
+	}
+
+	std::puts("test_pending_http_requests: all checks passed");
+	return 0;
+}
@@ -0,0 +1,269 @@
+// Behavioural test for streamelements/StreamElementsSceneItemBatch and
+// streamelements/StreamElementsSceneItemEventSuppressor.
+//
+// Builds fake scenes with groups and applies layouts to them both the way
+// setSceneItemPropertiesById did, one item at a time, and as a batch the way
+// StreamElementsObsSceneManager::SetObsSceneItemsPropertiesById() does. The
+// requests mix valid, unknown, invalid and repeated ids. The final state must
+// be identical, each id must get the right status, each scene must be
+// updated atomically once, and browsers must see one change per scene, also
+// when the fake video tick raises the deferred transform signals afterwards.
+// A batch merges a partial composition into the item's: scale, crop and
+// bounds it leaves out are kept.
+
+#include "streamelements/StreamElementsSceneItemBatch.hpp"
+#include "streamelements/StreamElementsSceneItemEventSuppressor.hpp"
+#include "scene_item_batch_fakes.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+static int failures = 0;
+
+static void check(bool cond, const char *msg)
+{
+	if (!cond) {
+		std::fprintf(stderr, "FAIL: %s\n", msg);
+		++failures;
+	}
+}
+
+/* ================================================================= */
+
+static void test_mixed_ids()
+{
+	bool identical = true;
+	bool statuses = true;
+	bool oneAtomicUpdate = true;
+	bool oneEvent = true;
+	bool drained = true;
+
+	for (unsigned seed = 1; seed <= 30; ++seed) {
+		std::mt19937 rng(seed);
+
+		FakeWorld perItem, batched;
+
+		{
+			std::mt19937 a(seed), b(seed);
+			build_world(perItem, a, 3, 15);
+			build_world(batched, b, 3, 15);
+		}
+
+		// Requests by serial; the same serials in both worlds
+		std::vector<int> serials;
+		std::vector<FakeProps> props;
+		std::vector<batch_t::Status> expected;
+
+		std::vector<bool> requested(perItem.items.size(), false);
+		bool unknownRequested = false;
+
+		for (int r = 0; r < 40; ++r) {
+			const int serial = rng() % perItem.items.size();
+
+			serials.push_back(serial);
+			props.push_back(random_props(rng, true));
+
+			switch (rng() % 10) {
+			case 0:
+				serials.back() = -1; // Invalid
+				expected.push_back(batch_t::STATUS_INVALID);
+				break;
+			case 1:
+				serials.back() = -2; // Unknown
+				expected.push_back(
+					unknownRequested
+						? batch_t::STATUS_DUPLICATE
+						: batch_t::STATUS_NOT_FOUND);
+				unknownRequested = true;
+				break;
+			default:
+				expected.push_back(
+					requested[serial]
+						? batch_t::STATUS_DUPLICATE
+						: batch_t::STATUS_OK);
+				requested[serial] = true;
+			}
+		}
+
+		FakeItem unknown;
+
+		auto requests_for = [&](FakeWorld &world) {
+			std::vector<FakeRequest> requests;
+
+			for (size_t r = 0; r < serials.size(); ++r) {
+				FakeRequest request;
+				request.props = props[r];
+
+				if (serials[r] == -1)
+					request.id = r % 2 ? "" : "not an id";
+				else if (serials[r] == -2)
+					request.id = id_of(&unknown);
+				else if (expected[r] == batch_t::STATUS_OK)
+					request.id = id_of(
+						world.items[serials[r]]);
+				else
+					// Duplicates are not applied
+					continue;
+
+				requests.push_back(request);
+			}
+
+			return requests;
+		};
+
+		apply_per_item(perItem, requests_for(perItem));
+
+		// The batch gets the duplicates too
+		std::vector<FakeRequest> requests;
+		for (size_t r = 0; r < serials.size(); ++r) {
+			FakeRequest request;
+			request.props = props[r];
+
+			if (serials[r] == -1)
+				request.id = r % 2 ? "" : "not an id";
+			else if (serials[r] == -2)
+				request.id = id_of(&unknown);
+			else
+				request.id = id_of(batched.items[serials[r]]);
+
+			requests.push_back(request);
+		}
+
+		auto batch = apply_batch(batched, requests);
+
+		identical = identical && describe(perItem) == describe(batched);
+
+		for (size_t r = 0; r < expected.size(); ++r)
+			statuses = statuses &&
+				   batch.GetEntries()[r].status == expected[r] &&
+				   batch.GetEntries()[r].id == requests[r].id;
+
+		std::vector<FakeScene *> scenes;
+		batch.ForEachScene([&](FakeScene *scene,
+				       const std::vector<const batch_t::Entry *> &) {
+			scenes.push_back(scene);
+		});
+
+		oneAtomicUpdate = oneAtomicUpdate &&
+				  batched.atomicUpdates == scenes.size();
+
+		for (auto &pair : batched.sceneEvents)
+			oneEvent = oneEvent && pair.second == 1;
+
+		oneEvent = oneEvent && batched.events ==
+					       batch.GetRootScenes().size();
+
+		drained = drained &&
+			  batched.suppressor.GetExpectedSignalCount() == 0;
+	}
+
+	check(identical, "a batch leaves the same state as one call per item");
+	check(statuses, "each id gets its status, in request order");
+	check(oneAtomicUpdate, "each scene is updated atomically once");
+	check(oneEvent, "browsers see one change per scene");
+	check(drained, "the deferred transform signals are consumed");
+}
+
+static void test_partial_composition()
+{
+	FakeWorld world;
+
+	auto item = world.add_item(world.add_scene(true));
+
+	item->x = 5;
+	item->scale = 2;
+	item->cropLeft = 10;
+	item->bounds = 300;
+
+	FakeRequest request;
+	request.id = id_of(item);
+	request.props.hasX = true;
+	request.props.x = 50;
+
+	apply_batch(world, {request});
+
+	check(item->x == 50 && item->scale == 2 && item->cropLeft == 10 &&
+		      item->bounds == 300,
+	      "a batch moving an item keeps its scale, crop and bounds");
+
+	request.props = FakeProps();
+	request.props.hasCrop = true;
+	request.props.cropLeft = 20;
+
+	apply_batch(world, {request});
+
+	check(item->x == 50 && item->scale == 2 && item->cropLeft == 20 &&
+		      item->bounds == 300,
+	      "a batch cropping an item keeps its position");
+	check(world.suppressor.GetExpectedSignalCount() == 0,
+	      "each partial composition raises one transform signal");
+
+	request.props = FakeProps();
+	request.props.hasX = true;
+	request.props.x = 7;
+
+	apply_per_item(world, {request});
+
+	check(item->x == 7 && item->scale == 1 && item->cropLeft == 0 &&
+		      item->bounds == 0,
+	      "one call per item still replaces the whole composition");
+}
+
+static void test_suppressor()
+{
+	typedef StreamElementsSceneItemEventSuppressor::clock_t clock_t;
+
+	StreamElementsSceneItemEventSuppressor suppressor;
+
+	int a = 0, b = 0;
+
+	suppressor.Suppress(&a);
+	suppressor.Suppress(&a);
+	suppressor.Resume(&a);
+	check(suppressor.IsSuppressed(&a), "suppression nests");
+	suppressor.Resume(&a);
+	check(!suppressor.IsSuppressed(&a), "suppression ends");
+	suppressor.Resume(&a);
+	check(!suppressor.IsSuppressed(nullptr) && !suppressor.IsSuppressed(&b),
+	      "nothing else is suppressed");
+
+	const auto now = clock_t::now();
+
+	suppressor.ExpectSignal(&a, now);
+	check(suppressor.ConsumeExpectedSignal(&a, now) &&
+		      !suppressor.ConsumeExpectedSignal(&a, now),
+	      "an expected signal is swallowed once");
+
+	const auto timeout = std::chrono::milliseconds(
+		StreamElementsSceneItemEventSuppressor::
+			EXPECTED_SIGNAL_TIMEOUT_MS);
+
+	suppressor.ExpectSignal(&a, now);
+	check(!suppressor.ConsumeExpectedSignal(&a, now + 2 * timeout),
+	      "an expectation which was not met in time swallows nothing");
+
+	suppressor.ExpectSignal(&a, now);
+	suppressor.ExpectSignal(&b, now + 2 * timeout);
+	check(suppressor.GetExpectedSignalCount() == 1,
+	      "expectations which were not met are dropped");
+}
+
+int main()
+{
+	test_mixed_ids();
+	test_partial_composition();
+	test_suppressor();
+
+	if (failures) {
+		std::fprintf(stderr, "%d check(s) failed\n", failures);
+		return 1;
+	}
+
+	std::puts("test_scene_item_batch: all checks passed");
+	return 0;
+}
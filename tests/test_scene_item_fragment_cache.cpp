@@ -0,0 +1,162 @@
+// Behavioural test for streamelements/StreamElementsSceneItemFragmentCache.
+//
+// Builds a fake scene of items showing fake sources, mutates it and raises
+// fake signals, invalidating the cache the way StreamElementsObsSceneManager
+// does for each signal, and checks that assembling the scene from cached
+// fragments always equals a fresh serialization. Also checks variants, and
+// that a fragment serialized while a signal arrived is not stored.
+
+#include "streamelements/StreamElementsSceneItemFragmentCache.hpp"
+#include "scene_item_fragment_cache_fakes.hpp"
+
+#include <cstdio>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+static int failures = 0;
+
+static void check(bool cond, const char *msg)
+{
+	if (!cond) {
+		std::fprintf(stderr, "FAIL: %s\n", msg);
+		++failures;
+	}
+}
+
+/* ================================================================= */
+
+static void test_signals_keep_output_fresh()
+{
+	FakeScene scene;
+	build_scene(scene, 12, 40, 4);
+
+	cache_t cache;
+	const void *variant = &scene;
+
+	check(serialize_scene_cached(scene, cache, variant) ==
+		      serialize_scene_fresh(scene),
+	      "a cold cache serializes like a fresh serialization");
+	check(cache.GetSize() == scene.items.size(), "every item is cached");
+
+	const auto before = cache.GetStats();
+	serialize_scene_cached(scene, cache, variant);
+	check(cache.GetStats().hits - before.hits == scene.items.size(),
+	      "an unchanged scene is served from the cache");
+
+	std::mt19937 rng(7);
+	bool fresh = true;
+
+	for (int step = 0; step < 3000 && fresh; ++step) {
+		FakeItem &item = scene.items[rng() % scene.items.size()];
+		FakeSource &source = scene.sources[rng() % scene.sources.size()];
+
+		switch (rng() % 9) {
+		case 0:
+			item.x += 1;
+			item.scale *= 1.5;
+			raise_item_signal(cache, &item);
+			break;
+		case 1:
+			item.visible = !item.visible;
+			raise_item_signal(cache, &item);
+			break;
+		case 2:
+			item.locked = !item.locked;
+			raise_item_signal(cache, &item);
+			break;
+		case 3:
+			item.auxiliaryData = std::to_string(step);
+			raise_item_signal(cache, &item);
+			break;
+		case 4:
+			source.name = "Renamed " + std::to_string(step);
+			raise_source_signal(cache, &source);
+			break;
+		case 5:
+			source.settings["key0"] = std::to_string(step);
+			raise_source_signal(cache, &source);
+			break;
+		case 6:
+			source.filters.push_back("Filter " +
+						 std::to_string(step));
+			raise_source_signal(cache, &source);
+			break;
+		case 7: {
+			// Reorder: positions change, fragments do not.
+			const size_t a = rng() % scene.order.size();
+			const size_t b = rng() % scene.order.size();
+			std::swap(scene.order[a], scene.order[b]);
+			raise_reorder_signal(cache);
+			break;
+		}
+		case 8:
+			// Read-only traffic.
+			break;
+		}
+
+		fresh = serialize_scene_cached(scene, cache, variant) ==
+			serialize_scene_fresh(scene);
+	}
+
+	check(fresh, "cached output equals a fresh serialization after every "
+		     "signal");
+
+	// A source signal drops every item showing the source, and only them.
+	serialize_scene_cached(scene, cache, variant);
+	raise_source_signal(cache, &scene.sources[0]);
+
+	size_t showing = 0;
+	for (auto &item : scene.items)
+		showing += item.source == &scene.sources[0];
+
+	check(cache.GetSize() == scene.items.size() - showing,
+	      "a source signal drops exactly the items showing the source");
+}
+
+static void test_variants_and_races()
+{
+	FakeScene scene;
+	build_scene(scene, 2, 2, 1);
+
+	cache_t cache;
+	int sceneA, sceneB;
+
+	const FakeItem *item = &scene.items[0];
+
+	cache.Put(item, item->source, &sceneA, "fragment for A",
+		  cache.GetGeneration());
+
+	std::string fragment;
+	check(cache.Get(item, &sceneA, fragment) && fragment == "fragment for A",
+	      "a fragment is returned for its variant");
+	check(!cache.Get(item, &sceneB, fragment),
+	      "a fragment is not returned for another variant");
+
+	// A signal arrives while the item is being serialized.
+	const uint64_t generation = cache.GetGeneration();
+	raise_item_signal(cache, &scene.items[1]);
+	cache.Put(item, item->source, &sceneA, "stale", generation);
+
+	check(cache.Get(item, &sceneA, fragment) && fragment == "fragment for A",
+	      "a fragment serialized during a signal is not stored");
+
+	raise_item_signal(cache, item);
+	check(!cache.Get(item, &sceneA, fragment), "an item signal drops it");
+	check(cache.GetSize() == 0, "nothing is left behind");
+}
+
+int main()
+{
+	test_signals_keep_output_fresh();
+	test_variants_and_races();
+
+	if (failures) {
+		std::fprintf(stderr, "%d check(s) failed\n", failures);
+		return 1;
+	}
+
+	std::puts("test_scene_item_fragment_cache: all checks passed");
+	return 0;
+}
@@ -0,0 +1,421 @@
+// Behavioural test for
+// streamelements/StreamElementsSceneItemSerializationContext.
+//
+// Builds fake scenes with groups, including groups nested in groups and
+// groups of scenes other than the current one, and serializes them both the
+// way SerializeSourceAndSceneItem() used to, resolving the current scene,
+// composition and group of every item as it went, and through a context
+// built once per call the way StreamElementsObsSceneManager builds it. The
+// JSON must be identical.
+
+#include "streamelements/StreamElementsSceneItemSerializationContext.hpp"
+
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+static int failures = 0;
+
+static void check(bool cond, const char *msg)
+{
+	if (!cond) {
+		std::fprintf(stderr, "FAIL: %s\n", msg);
+		++failures;
+	}
+}
+
+/* ================================================================= */
+
+struct FakeScene;
+
+struct FakeItem {
+	std::string name;
+	// Set for groups: the group's own scene.
+	FakeScene *group = nullptr;
+};
+
+struct FakeScene {
+	std::string name;
+	std::vector<FakeItem *> items;
+};
+
+struct FakeComposition {
+	std::string id;
+	std::vector<FakeScene *> scenes;
+};
+
+struct FakeWorld {
+	std::vector<FakeScene *> scenes;
+	std::vector<FakeComposition *> compositions;
+	FakeScene *currentScene = nullptr;
+
+	// Scene locks and global lookups taken, as libobs would.
+	size_t lookups = 0;
+
+	~FakeWorld()
+	{
+		for (auto scene : scenes) {
+			for (auto item : scene->items)
+				delete item;
+
+			delete scene;
+		}
+
+		for (auto composition : compositions)
+			delete composition;
+	}
+};
+
+typedef StreamElementsSceneItemSerializationContext<FakeScene, FakeItem,
+						    FakeComposition>
+	context_t;
+
+// obs_frontend_get_current_scene()
+static FakeScene *get_current_scene(FakeWorld &world)
+{
+	++world.lookups;
+
+	return world.currentScene;
+}
+
+// What GetVideoCompositionByScene() used to walk.
+static FakeComposition *get_composition(FakeWorld &world, FakeScene *scene)
+{
+	++world.lookups;
+
+	for (auto composition : world.compositions) {
+		for (auto candidate : composition->scenes) {
+			if (candidate == scene)
+				return composition;
+		}
+	}
+
+	return nullptr;
+}
+
+// obs_sceneitem_get_group(): the top-level groups of `scene`, and their
+// direct children, under the scene's lock.
+static FakeItem *get_group(FakeWorld &world, FakeScene *scene, FakeItem *item)
+{
+	++world.lookups;
+
+	for (auto candidate : scene->items) {
+		if (!candidate->group)
+			continue;
+
+		for (auto child : candidate->group->items) {
+			if (child == item)
+				return candidate;
+		}
+	}
+
+	return nullptr;
+}
+
+/* ================================================================= */
+
+static std::string id_of(const void *p)
+{
+	char buf[32];
+	std::snprintf(buf, sizeof(buf), "%p", p);
+
+	return buf;
+}
+
+// The old per-item path.
+static std::string serialize_item_per_item(FakeWorld &world, FakeScene *root,
+					   FakeItem *item, size_t order)
+{
+	std::string result = "{\"id\":\"" + id_of(item) + "\"";
+
+	auto composition = get_composition(world, root);
+
+	if (composition) {
+		result += ",\"videoCompositionId\":\"" + composition->id + "\"";
+		result += ",\"sceneId\":\"" + id_of(root) + "\"";
+	}
+
+	result += ",\"name\":\"" + item->name + "\"";
+	result += ",\"order\":" + std::to_string(order);
+
+	auto current = get_current_scene(world);
+
+	if (current) {
+		auto group = get_group(world, current, item);
+
+		if (group)
+			result += ",\"parentId\":\"" + id_of(group) + "\"";
+	}
+
+	if (item->group) {
+		result += ",\"items\":[";
+
+		for (size_t i = 0; i < item->group->items.size(); ++i)
+			result += serialize_item_per_item(
+					  world, root, item->group->items[i],
+					  i) +
+				  ",";
+
+		result += "]";
+	}
+
+	return result + "}";
+}
+
+static std::string serialize_scene_per_item(FakeWorld &world,
+					    FakeScene *scene)
+{
+	std::string result;
+
+	for (size_t i = 0; i < scene->items.size(); ++i)
+		result += serialize_item_per_item(world, scene,
+						  scene->items[i], i) +
+			  "\n";
+
+	return result;
+}
+
+// What CreateSceneItemSerializationContext() does.
+static context_t create_context(FakeWorld &world, FakeScene *root)
+{
+	auto current = get_current_scene(world);
+
+	context_t context(root, current, get_composition(world, root));
+
+	if (current) {
+		++world.lookups;
+
+		std::vector<FakeItem *> groups;
+		for (auto item : current->items) {
+			if (item->group)
+				groups.push_back(item);
+		}
+
+		for (auto group : groups) {
+			++world.lookups;
+
+			for (auto child : group->group->items)
+				context.AddGroupItem(group, child);
+		}
+	}
+
+	return context;
+}
+
+static std::string serialize_item_with_context(const context_t &context,
+					       FakeItem *item, size_t order)
+{
+	std::string result = "{\"id\":\"" + id_of(item) + "\"";
+
+	if (context.GetComposition()) {
+		result += ",\"videoCompositionId\":\"" +
+			  context.GetComposition()->id + "\"";
+		result += ",\"sceneId\":\"" + id_of(context.GetRootScene()) +
+			  "\"";
+	}
+
+	result += ",\"name\":\"" + item->name + "\"";
+	result += ",\"order\":" + std::to_string(order);
+
+	auto group = context.GetGroup(item);
+
+	if (group)
+		result += ",\"parentId\":\"" + id_of(group) + "\"";
+
+	if (item->group) {
+		result += ",\"items\":[";
+
+		for (size_t i = 0; i < item->group->items.size(); ++i)
+			result += serialize_item_with_context(
+					  context, item->group->items[i], i) +
+				  ",";
+
+		result += "]";
+	}
+
+	return result + "}";
+}
+
+static std::string serialize_scene_with_context(FakeWorld &world,
+						FakeScene *scene)
+{
+	auto context = create_context(world, scene);
+
+	std::string result;
+
+	for (size_t i = 0; i < scene->items.size(); ++i)
+		result += serialize_item_with_context(context, scene->items[i],
+						      i) +
+			  "\n";
+
+	return result;
+}
+
+/* ================================================================= */
+
+static FakeScene *add_scene(FakeWorld &world, const std::string &name)
+{
+	auto scene = new FakeScene();
+	scene->name = name;
+
+	world.scenes.push_back(scene);
+
+	return scene;
+}
+
+static FakeItem *add_item(FakeScene *scene, const std::string &name)
+{
+	auto item = new FakeItem();
+	item->name = name;
+
+	scene->items.push_back(item);
+
+	return item;
+}
+
+static FakeItem *add_group(FakeWorld &world, FakeScene *scene,
+			   const std::string &name)
+{
+	auto item = add_item(scene, name);
+	item->group = add_scene(world, name + " (group)");
+
+	return item;
+}
+
+// Two compositions; scenes with items, top-level groups, and groups nested
+// in groups `depth` deep.
+static void build_world(FakeWorld &world, std::mt19937 &rng, int sceneCount,
+			int itemCount, int depth)
+{
+	auto native = new FakeComposition();
+	native->id = "native";
+	auto custom = new FakeComposition();
+	custom->id = "custom";
+
+	world.compositions = {native, custom};
+
+	std::vector<FakeScene *> roots;
+
+	for (int s = 0; s < sceneCount; ++s) {
+		auto scene = add_scene(world, "Scene " + std::to_string(s));
+		roots.push_back(scene);
+
+		(s % 2 ? custom : native)->scenes.push_back(scene);
+
+		for (int i = 0; i < itemCount; ++i) {
+			const std::string name = "Item " + std::to_string(s) +
+						 "." + std::to_string(i);
+
+			if (rng() % 4) {
+				add_item(scene, name);
+				continue;
+			}
+
+			auto group = add_group(world, scene, name);
+
+			for (int d = 0; d < depth; ++d) {
+				const int children = 1 + rng() % 3;
+
+				for (int c = 0; c < children; ++c)
+					add_item(group->group,
+						 name + " child " +
+							 std::to_string(c));
+
+				group = add_group(world, group->group,
+						  name + " nested " +
+							  std::to_string(d));
+			}
+		}
+	}
+
+	world.currentScene = roots[rng() % roots.size()];
+}
+
+/* ================================================================= */
+
+static void test_identical_json()
+{
+	bool identical = true;
+	bool sawParent = false;
+
+	for (unsigned seed = 1; seed <= 30 && identical; ++seed) {
+		std::mt19937 rng(seed);
+
+		FakeWorld world;
+		build_world(world, rng, 4, 12, 1 + seed % 3);
+
+		// Every scene: current, non-current, and the groups' own.
+		for (auto scene : world.scenes) {
+			const auto expected =
+				serialize_scene_per_item(world, scene);
+
+			identical = identical &&
+				    serialize_scene_with_context(
+					    world, scene) == expected;
+
+			sawParent = sawParent ||
+				    expected.find("parentId") !=
+					    std::string::npos;
+		}
+
+		// No current scene, as during scene collection changes.
+		world.currentScene = nullptr;
+
+		for (auto scene : world.scenes) {
+			identical = identical &&
+				    serialize_scene_with_context(world, scene) ==
+					    serialize_scene_per_item(world,
+								     scene);
+		}
+	}
+
+	check(identical, "the context serializes identical JSON");
+	check(sawParent, "the fixtures exercise parentId");
+}
+
+static void test_nested_groups()
+{
+	FakeWorld world;
+
+	auto composition = new FakeComposition();
+	composition->id = "native";
+	world.compositions = {composition};
+
+	auto scene = add_scene(world, "Scene");
+	composition->scenes.push_back(scene);
+	world.currentScene = scene;
+
+	auto top = add_item(scene, "Top");
+	auto outer = add_group(world, scene, "Outer");
+	auto child = add_item(outer->group, "Child");
+	auto inner = add_group(world, outer->group, "Inner");
+	auto grandchild = add_item(inner->group, "Grandchild");
+
+	auto context = create_context(world, scene);
+
+	check(context.GetGroup(top) == nullptr, "a top-level item has no group");
+	check(context.GetGroup(child) == outer,
+	      "a child of a top-level group has that group");
+	check(context.GetGroup(inner) == outer,
+	      "a nested group has the top-level group");
+	check(context.GetGroup(grandchild) == nullptr,
+	      "an item nested deeper has no group, as with "
+	      "obs_sceneitem_get_group()");
+	check(context.GetGroupItemCount() == 2,
+	      "only the direct children of top-level groups are listed");
+}
+
+int main()
+{
+	test_identical_json();
+	test_nested_groups();
+
+	if (failures) {
+		std::fprintf(stderr, "%d check(s) failed\n", failures);
+		return 1;
+	}
+
+	std::puts("test_scene_item_serialization_context: all checks passed");
+	return 0;
+}
@@ -0,0 +1,235 @@
+// Behavioural test for streamelements/StreamElementsSceneTraversal.
+//
+// Builds fake scenes with groups, and walks them both the way the
+// std::function based scanSceneItems() and ObsSceneEnumAllItems() used to,
+// and through the templates. The items, their order, the parents and early
+// exits must be identical; the locked scans must not take references, and
+// run while the scene is locked; ForEachItem() must release every reference
+// it took, call the visitor outside the lock, enumerate groups without holding
+// the scene's lock and spill scenes larger than its buffer to the heap.
+
+#include "streamelements/StreamElementsSceneTraversal.hpp"
+#include "scene_traversal_fakes.hpp"
+
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+static int failures = 0;
+
+static void check(bool cond, const char *msg)
+{
+	if (!cond) {
+		std::fprintf(stderr, "FAIL: %s\n", msg);
+		++failures;
+	}
+}
+
+/* ================================================================= */
+
+typedef std::vector<std::pair<int, int>> visits_t;
+
+static void visit(visits_t &visits, FakeItem *item, FakeItem *parent)
+{
+	visits.push_back({item->serial, parent ? parent->serial : -1});
+}
+
+/* ================================================================= */
+
+static void test_same_visits()
+{
+	bool scans = true;
+	bool groupScans = true;
+	bool enums = true;
+	bool locked = true;
+	bool unlocked = true;
+	bool notNested = true;
+	bool noRefs = true;
+	bool balanced = true;
+
+	for (unsigned seed = 1; seed <= 40; ++seed) {
+		std::mt19937 rng(seed);
+
+		FakeWorld world;
+		auto scene = build_scene(world, rng, 20, 1 + seed % 3);
+
+		// Stop after `limit` items; 0 never stops.
+		for (size_t limit = 0; limit < 12; limit += 3) {
+			for (bool recursive : {false, true}) {
+				visits_t expected, actual;
+
+				old_scan_scene(
+					scene,
+					[&](FakeItem *item, FakeItem *parent) {
+						visit(expected, item, parent);
+						return expected.size() != limit;
+					},
+					recursive);
+
+				const long addrefs = s_addrefs;
+
+				const bool result = traversal_t::ScanScene(
+					scene,
+					[&](FakeItem *item, FakeItem *parent) {
+						locked = locked && scene->locks;
+
+						visit(actual, item, parent);
+						return actual.size() != limit;
+					},
+					recursive);
+
+				noRefs = noRefs && s_addrefs == addrefs;
+				scans = scans && actual == expected &&
+					result == (actual.size() != limit);
+
+				for (auto item : scene->items) {
+					if (!item->group)
+						continue;
+
+					expected.clear();
+					actual.clear();
+
+					old_scan_group(
+						item,
+						[&](FakeItem *item,
+						    FakeItem *parent) {
+							visit(expected, item,
+							      parent);
+							return expected.size() !=
+							       limit;
+						},
+						recursive);
+
+					traversal_t::ScanGroup(
+						item,
+						[&](FakeItem *item,
+						    FakeItem *parent) {
+							visit(actual, item,
+							      parent);
+							return actual.size() !=
+							       limit;
+						},
+						recursive);
+
+					groupScans = groupScans &&
+						     actual == expected;
+				}
+			}
+
+			visits_t expected, actual;
+
+			old_enum_all_items(scene, [&](FakeItem *item) {
+				visit(expected, item, nullptr);
+				return expected.size() != limit;
+			});
+
+			s_nestedLocks = 0;
+
+			const bool result = traversal_t::ForEachItem(
+				scene, [&](FakeItem *item) {
+					unlocked = unlocked && !scene->locks &&
+						   item->refs > 1;
+
+					visit(actual, item, nullptr);
+					return actual.size() != limit;
+				});
+
+			enums = enums && actual == expected &&
+				result == (actual.size() != limit);
+			notNested = notNested && !s_nestedLocks;
+			balanced = balanced && world.refs_balanced();
+		}
+	}
+
+	check(scans, "ScanScene() visits what scanSceneItems() visited");
+	check(groupScans,
+	      "ScanGroup() visits what scanGroupSceneItems() visited");
+	check(enums, "ForEachItem() visits what ObsSceneEnumAllItems() visited");
+	check(locked, "scans call the visitor under the scene's lock");
+	check(noRefs, "scans take no references");
+	check(unlocked,
+	      "ForEachItem() calls the visitor outside the lock, holding a "
+	      "reference");
+	check(balanced, "ForEachItem() releases every reference it took");
+	check(notNested,
+	      "ForEachItem() enumerates groups after releasing the scene's lock");
+}
+
+static void test_buffer()
+{
+	FakeWorld world;
+	auto scene = world.add_scene();
+
+	for (int i = 0; i < 30; ++i)
+		world.add_item(scene);
+
+	auto group = world.add_group(scene);
+
+	for (int i = 0; i < 30; ++i)
+		world.add_item(group->group);
+
+	size_t count = 0;
+
+	s_allocations = 0;
+
+	traversal_t::ForEachItem(scene, [&](FakeItem *) {
+		++count;
+		return true;
+	});
+
+	check(count == 61, "every item is visited");
+	check(s_allocations == 0, "a scene which fits the buffer allocates "
+				  "nothing");
+
+	visits_t expected, actual;
+
+	old_enum_all_items(scene, [&](FakeItem *item) {
+		visit(expected, item, nullptr);
+		return true;
+	});
+
+	s_allocations = 0;
+
+	traversal_t::ForEachItem<16>(scene, [&](FakeItem *item) {
+		visit(actual, item, nullptr);
+		return true;
+	});
+
+	check(s_allocations > 0, "a scene larger than the buffer spills over");
+	check(actual == expected, "spilled items keep their order");
+	check(world.refs_balanced(), "spilled items are released");
+
+	// Captures which do not fit std::function's small object buffer.
+	std::string a = "a", b = "b", c = "c";
+	size_t scanned = 0;
+
+	s_allocations = 0;
+
+	traversal_t::ScanScene(
+		scene,
+		[&scanned, a, b, c](FakeItem *, FakeItem *) {
+			++scanned;
+			return true;
+		},
+		true);
+
+	check(scanned == 61, "a scan visits every item");
+	check(s_allocations == 0, "a scan allocates nothing for its visitor");
+}
+
+int main()
+{
+	test_same_visits();
+	test_buffer();
+
+	if (failures) {
+		std::fprintf(stderr, "%d check(s) failed\n", failures);
+		return 1;
+	}
+
+	std::puts("test_scene_traversal: all checks passed");
+	return 0;
+}
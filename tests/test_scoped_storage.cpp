@@ -0,0 +1,399 @@
+// Behavioural test for streamelements/StreamElementsScopedStorage.
+//
+// The store has no libobs dependency, so the production translation unit is
+// compiled straight into this test. Covers round-trips, prefix listing,
+// persistence across reopen, torn-tail recovery, compaction, the one-time
+// import of the legacy file-per-item layout, writes from other threads
+// waiting out a batch, and writes which fail to reach the journal leaving the
+// store as it was.
+
+#include "streamelements/StreamElementsScopedStorage.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <csignal>
+#include <sys/resource.h>
+#endif
+
+namespace fs = std::filesystem;
+
+static int failures = 0;
+
+static void check(bool cond, const char *msg)
+{
+	if (!cond) {
+		std::fprintf(stderr, "FAIL: %s\n", msg);
+		++failures;
+	}
+}
+
+static fs::path make_temp_dir(const char *name)
+{
+	fs::path dir = fs::temp_directory_path() / name;
+	fs::remove_all(dir);
+	fs::create_directories(dir);
+	return dir;
+}
+
+static void write_file(const fs::path &path, const std::string &content)
+{
+	fs::create_directories(path.parent_path());
+	std::ofstream out(path, std::ios::binary);
+	out << content;
+}
+
+static void test_round_trip_and_reopen()
+{
+	fs::path dir = make_temp_dir("se_scoped_storage_round_trip");
+	std::string journal = (dir / "store.journal").string();
+
+	{
+		StreamElementsScopedStorage s(journal);
+		check(s.Open(), "open of a fresh journal succeeds");
+
+		check(s.Write("scope", "c1", "a.json", "{\"a\":1}"),
+		      "write a");
+		check(s.Write("scope", "c1", "b.json", "{\"b\":2}"),
+		      "write b");
+		check(s.Write("scope", "c2", "a.json", "other"),
+		      "write into another container");
+		check(s.Write("scope", "c1", "a.json", "{\"a\":3}"),
+		      "overwrite a");
+		check(s.Remove("scope", "c1", "b.json"), "remove b");
+		check(!s.Remove("scope", "c1", "b.json"),
+		      "removing a missing item reports false");
+
+		std::string value;
+		check(s.Read("scope", "c1", "a.json", value) &&
+			      value == "{\"a\":3}",
+		      "read returns the latest write");
+		check(!s.Read("scope", "c1", "b.json", value),
+		      "read of a removed item fails");
+	}
+
+	{
+		StreamElementsScopedStorage s(journal);
+		check(s.Open(), "reopen succeeds");
+
+		std::string value;
+		check(s.Read("scope", "c1", "a.json", value) &&
+			      value == "{\"a\":3}",
+		      "overwrite survives reopen");
+		check(!s.Read("scope", "c1", "b.json", value),
+		      "remove survives reopen");
+		check(s.Read("scope", "c2", "a.json", value) &&
+			      value == "other",
+		      "containers are independent");
+	}
+
+	fs::remove_all(dir);
+}
+
+static void test_prefix_listing()
+{
+	fs::path dir = make_temp_dir("se_scoped_storage_listing");
+
+	StreamElementsScopedStorage s((dir / "store.journal").string());
+	check(s.Open(), "open for listing");
+
+	{
+		StreamElementsScopedStorage::Batch batch(&s);
+
+		s.Write("s", "c", "widget-2.json", "22");
+		s.Write("s", "c", "widget-1.json", "1");
+		s.Write("s", "c", "other.json", "333");
+		s.Write("s", "cc", "widget-3.json", "x");
+		s.Write("s2", "c", "widget-4.json", "x");
+	}
+
+	std::vector<StreamElementsScopedStorage::ItemInfo> items;
+	s.List("s", "c", "widget-", items);
+
+	check(items.size() == 2, "prefix listing is confined to the prefix");
+	check(items.size() == 2 && items[0].item == "widget-1.json" &&
+		      items[1].item == "widget-2.json",
+	      "listing is ordered and excludes neighbouring containers");
+	check(items.size() == 2 && items[1].contentLength == 2,
+	      "listing reports content length");
+
+	items.clear();
+	s.List("s", "c", "", items);
+	check(items.size() == 3, "empty prefix lists the whole container");
+
+	fs::remove_all(dir);
+}
+
+static void test_torn_tail_is_truncated()
+{
+	fs::path dir = make_temp_dir("se_scoped_storage_torn");
+	fs::path journal = dir / "store.journal";
+
+	{
+		StreamElementsScopedStorage s(journal.string());
+		s.Open();
+		s.Write("s", "c", "kept.json", "kept");
+		s.Write("s", "c", "torn.json", "this record gets torn");
+	}
+
+	// Simulate a crash mid-append by chopping the last record.
+	fs::resize_file(journal, fs::file_size(journal) - 5);
+
+	{
+		StreamElementsScopedStorage s(journal.string());
+		check(s.Open(), "open with a torn tail succeeds");
+
+		std::string value;
+		check(s.Read("s", "c", "kept.json", value) && value == "kept",
+		      "records before the torn one survive");
+		check(!s.Read("s", "c", "torn.json", value),
+		      "the torn record is dropped");
+
+		check(s.Write("s", "c", "after.json", "after"),
+		      "writes after recovery succeed");
+	}
+
+	{
+		StreamElementsScopedStorage s(journal.string());
+		s.Open();
+
+		std::string value;
+		check(s.Read("s", "c", "after.json", value) &&
+			      value == "after",
+		      "records appended after truncation are readable");
+	}
+
+	fs::remove_all(dir);
+}
+
+static void test_compaction_bounds_journal()
+{
+	fs::path dir = make_temp_dir("se_scoped_storage_compact");
+	fs::path journal = dir / "store.journal";
+
+	std::string big(4096, 'x');
+
+	{
+		StreamElementsScopedStorage s(journal.string());
+		s.Open();
+
+		// 4MB of writes to the same handful of keys.
+		for (int i = 0; i < 1024; ++i)
+			s.Write("s", "c", "k" + std::to_string(i % 4),
+				big + std::to_string(i));
+	}
+
+	check(fs::file_size(journal) < 2 * 1024 * 1024,
+	      "superseded records are compacted away");
+
+	{
+		StreamElementsScopedStorage s(journal.string());
+		s.Open();
+
+		std::string value;
+		check(s.Read("s", "c", "k3", value) &&
+			      value == big + "1023",
+		      "latest values survive compaction");
+	}
+
+	fs::remove_all(dir);
+}
+
+static void test_legacy_import()
+{
+	fs::path dir = make_temp_dir("se_scoped_storage_import");
+	fs::path root = dir / "scoped_config_storage";
+
+	write_file(root / "scope" / "container" / "a.json",
+		   "\xEF\xBB\xBF{\"a\":1}");
+	write_file(root / "scope" / "container" / "b.json", "{\"b\":2}");
+	write_file(root / "scope2" / "c" / "x.json", "{}");
+
+	StreamElementsScopedStorage s((dir / "store.journal").string());
+	s.Open();
+
+	check(s.ImportLegacyFiles(root.string()) == 3,
+	      "all legacy files are imported");
+
+	std::string value;
+	check(s.Read("scope", "container", "a.json", value) &&
+		      value == "{\"a\":1}",
+	      "imported content has the UTF-8 BOM stripped");
+	check(s.Read("scope2", "c", "x.json", value) && value == "{}",
+	      "every scope is imported");
+
+	check(!fs::exists(root / "scope"),
+	      "imported files and emptied directories are removed");
+	check(s.ImportLegacyFiles(root.string()) == 0,
+	      "a second import is a no-op");
+
+	// A restore extracts the legacy layout again; it wins over the store.
+	write_file(root / "scope" / "container" / "a.json", "{\"a\":9}");
+	check(s.ImportLegacyFiles(root.string()) == 1,
+	      "files appearing later are absorbed");
+	check(s.Read("scope", "container", "a.json", value) &&
+		      value == "{\"a\":9}",
+	      "absorbed files replace stored content");
+
+	fs::remove_all(dir);
+}
+
+static void test_batch_belongs_to_its_thread()
+{
+	fs::path dir = make_temp_dir("se_scoped_storage_batch_owner");
+	fs::path journal = dir / "store.journal";
+
+	{
+		StreamElementsScopedStorage s(journal.string());
+		s.Open();
+
+		std::atomic<bool> written(false);
+		bool result = false;
+		std::thread other;
+
+		{
+			StreamElementsScopedStorage::Batch batch(&s);
+
+			s.Write("s", "c", "mine.json", "1");
+
+			other = std::thread([&]() {
+				result = s.Write("s", "c", "other.json", "2");
+				written = true;
+			});
+
+			std::this_thread::sleep_for(
+				std::chrono::milliseconds(50));
+
+			check(!written,
+			      "another thread's write waits for the batch");
+
+			s.Write("s", "c", "mine.json", "3");
+		}
+
+		other.join();
+
+		check(written && result,
+		      "the waiting write goes through once the batch ends");
+	}
+
+	StreamElementsScopedStorage s(journal.string());
+	s.Open();
+
+	std::string mine, other;
+	check(s.Read("s", "c", "mine.json", mine) && mine == "3" &&
+		      s.Read("s", "c", "other.json", other) && other == "2",
+	      "both the batch and the other write reach the journal");
+
+	fs::remove_all(dir);
+}
+
+#ifndef _WIN32
+// Makes appends to the journal fail by capping the file size the process may
+// write, as a full disk would.
+static void test_failed_append_is_rolled_back()
+{
+	fs::path dir = make_temp_dir("se_scoped_storage_failed_append");
+	fs::path journal = dir / "store.journal";
+
+	const std::string big(4096, 'x');
+
+	signal(SIGXFSZ, SIG_IGN);
+
+	struct rlimit original;
+	getrlimit(RLIMIT_FSIZE, &original);
+
+	{
+		StreamElementsScopedStorage s(journal.string());
+		s.Open();
+
+		s.Write("s", "c", "a.json", "a1");
+		s.Write("s", "c", "b.json", "b1");
+
+		struct rlimit limit = original;
+		limit.rlim_cur = (rlim_t)fs::file_size(journal) + 16;
+		setrlimit(RLIMIT_FSIZE, &limit);
+
+		std::string value;
+
+		check(!s.Write("s", "c", "a.json", big),
+		      "a write which does not reach the journal fails");
+		check(s.Read("s", "c", "a.json", value) && value == "a1",
+		      "a failed overwrite keeps the previous value");
+
+		check(!s.Write("s", "c", "new.json", big),
+		      "a new item which does not reach the journal fails");
+		check(!s.Read("s", "c", "new.json", value),
+		      "a failed write does not create the item");
+
+		check(!s.Remove("s", "c", "b.json") &&
+			      s.Read("s", "c", "b.json", value) && value == "b1",
+		      "a failed remove keeps the item");
+
+		{
+			StreamElementsScopedStorage::Batch batch(&s);
+
+			s.Write("s", "c", "a.json", big);
+			s.Remove("s", "c", "b.json");
+			s.Write("s", "c", "a.json", "a2");
+			s.Write("s", "c", "c.json", big);
+		}
+
+		std::vector<StreamElementsScopedStorage::ItemInfo> items;
+		s.List("s", "c", "", items);
+
+		check(items.size() == 2 && s.Read("s", "c", "a.json", value) &&
+			      value == "a1" &&
+			      s.Read("s", "c", "b.json", value) && value == "b1",
+		      "a failed batch undoes every write of the batch");
+
+		setrlimit(RLIMIT_FSIZE, &original);
+
+		check(s.Write("s", "c", "a.json", "a3"),
+		      "writes succeed once the journal can grow again");
+	}
+
+	{
+		StreamElementsScopedStorage s(journal.string());
+		s.Open();
+
+		std::string value;
+		check(s.Read("s", "c", "a.json", value) && value == "a3" &&
+			      s.Read("s", "c", "b.json", value) &&
+			      value == "b1" &&
+			      !s.Read("s", "c", "c.json", value),
+		      "the journal holds exactly the writes which succeeded");
+	}
+
+	signal(SIGXFSZ, SIG_DFL);
+
+	fs::remove_all(dir);
+}
+#endif
+
+int main()
+{
+	test_round_trip_and_reopen();
+	test_prefix_listing();
+	test_torn_tail_is_truncated();
+	test_compaction_bounds_journal();
+	test_legacy_import();
+	test_batch_belongs_to_its_thread();
+#ifndef _WIN32
+	test_failed_append_is_rolled_back();
+#endif
+
+	if (failures) {
+		std::fprintf(stderr, "%d check(s) failed\n", failures);
+		return 1;
+	}
+
+	std::puts("test_scoped_storage: all checks passed");
+	return 0;
+}
@@ -0,0 +1,208 @@
+// Behavioural test for the counters behind streamelements/SETrace.hpp:
+// StreamElementsShardedCounter (ENABLE_SETRACE 1) and
+// StreamElementsRefTracker (ENABLE_SETRACE 2 outside Windows).
+//
+// Churns references on shared and private objects from several threads and
+// checks that the balance and the per-pointer books come out exact, that
+// leaks are grouped by the call site that took them, and that releasing
+// an untracked pointer is reported.
+
+#include "streamelements/StreamElementsRefTracker.hpp"
+#include "streamelements/StreamElementsShardedCounter.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+static int failures = 0;
+
+static void check(bool cond, const char *msg)
+{
+	if (!cond) {
+		std::fprintf(stderr, "FAIL: %s\n", msg);
+		++failures;
+	}
+}
+
+// Constant-initialized, like g_seTrace_refcountBalance.
+static StreamElementsShardedCounter s_counter;
+
+/* ================================================================= */
+
+static void test_counter_churn()
+{
+	const int THREADS = 8;
+	const int ROUNDS = 200000;
+
+	std::vector<std::thread> threads;
+	std::atomic<long> expected(0);
+	std::atomic<bool> stop(false);
+
+	// Reads while the writers run must not disturb them.
+	std::thread reader([&]() {
+		while (!stop.load())
+			(void)s_counter.Get();
+	});
+
+	for (int t = 0; t < THREADS; ++t) {
+		threads.emplace_back([&, t]() {
+			long local = 0;
+
+			for (int i = 0; i < ROUNDS; ++i) {
+				s_counter.Add(1);
+				s_counter.Add(1);
+				s_counter.Add(-1);
+
+				// Leave a thread-specific residue behind
+				// every so often.
+				if (i % (t + 2))
+					s_counter.Add(-1);
+				else
+					++local;
+			}
+
+			expected += local;
+		});
+	}
+
+	for (auto &thread : threads)
+		thread.join();
+
+	stop = true;
+	reader.join();
+
+	check(s_counter.Get() == expected.load(),
+	      "the sharded balance is exact once writers stop");
+
+	s_counter.Add(-expected.load());
+	check(s_counter.Get() == 0, "the balance returns to zero");
+}
+
+static void test_tracker_churn()
+{
+	const int THREADS = 8;
+	const int ROUNDS = 20000;
+	const int SHARED = 16;
+
+	StreamElementsRefTracker::Options options;
+	options.stripeCount = 16;
+
+	StreamElementsRefTracker tracker(options);
+
+	int shared[SHARED];
+	std::vector<std::vector<int>> owned(THREADS, std::vector<int>(64));
+
+	std::vector<std::thread> threads;
+	std::atomic<int> refused(0);
+
+	for (int t = 0; t < THREADS; ++t) {
+		threads.emplace_back([&, t]() {
+			for (int i = 0; i < ROUNDS; ++i) {
+				const void *ptr = &shared[(i + t) % SHARED];
+
+				tracker.AddRef(__FILE__, 100, "acquire shared",
+					       ptr);
+				tracker.AddRef(__FILE__, 101, "acquire again",
+					       ptr);
+				if (!tracker.DecRef(__FILE__, 200,
+						    "release shared", ptr) ||
+				    !tracker.DecRef(__FILE__, 201,
+						    "release again", ptr))
+					++refused;
+			}
+
+			// Leak one reference per owned object from one site,
+			// and two more on every fourth from another.
+			for (size_t i = 0; i < owned[t].size(); ++i) {
+				tracker.AddRef(__FILE__, 300, "leak", &owned[t][i]);
+
+				// One call, so one stack and one site.
+				for (int r = 0; i % 4 == 0 && r < 2; ++r)
+					tracker.AddRef(__FILE__, 400, "leak twice",
+						       &owned[t][i]);
+			}
+		});
+	}
+
+	for (auto &thread : threads)
+		thread.join();
+
+	check(refused.load() == 0, "referenced pointers can be released");
+
+	const size_t ownedCount = THREADS * owned[0].size();
+
+	check(tracker.GetTrackedCount() == ownedCount,
+	      "balanced pointers are forgotten, leaked ones are kept");
+
+	auto leaks = tracker.GetLeaks();
+
+	size_t leakPointers = 0, leakTwicePointers = 0;
+	long leakReferences = 0, leakTwiceReferences = 0;
+	bool otherSites = false;
+
+	for (auto &leak : leaks) {
+		if (leak.line == 300) {
+			leakPointers += leak.pointers;
+			leakReferences += leak.references;
+		} else if (leak.line == 400) {
+			leakTwicePointers += leak.pointers;
+			leakTwiceReferences += leak.references;
+		} else {
+			otherSites = true;
+		}
+
+		check(leak.file == "test_setrace.cpp",
+		      "leak sites carry the file name");
+
+		if (StreamElementsRefTracker::IsStackCaptureSupported())
+			check(!leak.stack.empty(),
+			      "leak sites carry a stack where supported");
+	}
+
+	check(!otherSites, "balanced sites do not show up as leaks");
+	check(leakPointers == ownedCount && leakReferences == (long)ownedCount,
+	      "leaks are attributed to the site that took them");
+	check(leakTwicePointers == ownedCount / 4 &&
+		      leakTwiceReferences == (long)ownedCount / 2,
+	      "references from one site are counted per pointer");
+
+	const std::string report = tracker.FormatLeakReport();
+	check(report.find(std::to_string(ownedCount) + " pointers") !=
+			      std::string::npos &&
+		      report.find("test_setrace.cpp:300 leak") !=
+			      std::string::npos,
+	      "the report names leaking sites");
+
+	int stray = 0;
+	check(!tracker.DecRef(__FILE__, 500, "stray", &stray),
+	      "releasing an untracked pointer is reported");
+
+	for (int t = 0; t < THREADS; ++t) {
+		for (size_t i = 0; i < owned[t].size(); ++i) {
+			const int refs = i % 4 == 0 ? 3 : 1;
+
+			for (int r = 0; r < refs; ++r)
+				tracker.DecRef(__FILE__, 600, "cleanup",
+					       &owned[t][i]);
+		}
+	}
+
+	check(tracker.GetTrackedCount() == 0 && tracker.GetLeaks().empty(),
+	      "everything balances after cleanup");
+}
+
+int main()
+{
+	test_counter_churn();
+	test_tracker_churn();
+
+	if (failures) {
+		std::fprintf(stderr, "%d check(s) failed\n", failures);
+		return 1;
+	}
+
+	std::puts("test_setrace: all checks passed");
+	return 0;
+}
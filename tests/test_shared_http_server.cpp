@@ -0,0 +1,289 @@
+// Behavioural test for streamelements/StreamElementsSharedHttpServer.
+//
+// Routes are registered, queried and removed concurrently against the one
+// shared server, each answering with its own token so a misrouted request is
+// caught. Removing the last route while one of its requests is in flight
+// must not block other calls. The thread count of the process is compared
+// against one dedicated HttpServer per route -- what every browser HTTP
+// server costs by default.
+
+#include "streamelements/StreamElementsSharedHttpServer.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+static int failures = 0;
+
+static void check(bool cond, const char *msg)
+{
+	if (!cond) {
+		std::fprintf(stderr, "FAIL: %s\n", msg);
+		++failures;
+	}
+}
+
+static size_t count_threads()
+{
+	size_t count = 0;
+	std::error_code ec;
+	for (auto &entry :
+	     std::filesystem::directory_iterator("/proc/self/task", ec)) {
+		(void)entry;
+		++count;
+	}
+	return count;
+}
+
+static HttpServer::request_handler_t make_handler(const std::string &name)
+{
+	return [name](const HttpServer::request_t &req,
+		      HttpServer::response_t &res) {
+		res.set_content(name + ":" + req.path, "text/plain");
+	};
+}
+
+static bool get(int port, const std::string &path, std::string &body,
+		int &status)
+{
+	httplib::Client client("127.0.0.1", port);
+	client.set_read_timeout(5, 0);
+
+	auto result = client.Get(path.c_str());
+
+	if (!result)
+		return false;
+
+	status = result->status;
+	body = result->body;
+	return true;
+}
+
+static void test_routing()
+{
+	StreamElementsSharedHttpServer server(4);
+
+	check(server.GetPortNumber() == 0, "no server runs without routes");
+
+	const std::string a = server.AddRoute(make_handler("a"));
+	const std::string b = server.AddRoute(make_handler("b"));
+
+	check(!a.empty() && !b.empty() && a != b, "routes get distinct tokens");
+
+	const int port = server.GetPortNumber();
+	check(port > 0, "the server starts with the first route");
+
+	std::string body;
+	int status = 0;
+
+	check(get(port,
+		  StreamElementsSharedHttpServer::GetRoutePathPrefix(a) +
+			  "/x/y?q=1",
+		  body, status) &&
+		      body == "a:/x/y",
+	      "a request reaches its route with the prefix stripped");
+	check(get(port, StreamElementsSharedHttpServer::GetRoutePathPrefix(b),
+		  body, status) &&
+		      body == "b:/",
+	      "the route root maps to /");
+	check(get(port, "/not-a-route/x", body, status) && status == 404,
+	      "an unknown route is not found");
+	check(get(port, "/", body, status) && status == 404,
+	      "the server root is not found");
+
+	server.RemoveRoute(a);
+
+	check(get(port, StreamElementsSharedHttpServer::GetRoutePathPrefix(a),
+		  body, status) &&
+		      status == 404,
+	      "a removed route is not found");
+
+	server.RemoveRoute(b);
+
+	check(server.GetPortNumber() == 0,
+	      "the server stops with the last route");
+}
+
+static void test_concurrent_routes()
+{
+	const size_t routeCount = 24;
+	const size_t requestsPerRoute = 20;
+
+	StreamElementsSharedHttpServer server(8);
+
+	// Keeps the server up while routes come and go.
+	const std::string anchor = server.AddRoute(make_handler("anchor"));
+	const int port = server.GetPortNumber();
+
+	std::atomic<size_t> correct{0};
+	std::atomic<size_t> wrong{0};
+	std::vector<std::thread> threads;
+
+	for (size_t i = 0; i < routeCount; ++i) {
+		threads.emplace_back([&, i]() {
+			const std::string name = "r" + std::to_string(i);
+			const std::string route =
+				server.AddRoute(make_handler(name));
+			const std::string prefix =
+				StreamElementsSharedHttpServer::GetRoutePathPrefix(
+					route);
+
+			for (size_t n = 0; n < requestsPerRoute; ++n) {
+				const std::string path =
+					"/p" + std::to_string(n);
+
+				std::string body;
+				int status = 0;
+
+				if (get(port, prefix + path, body, status) &&
+				    body == name + ":" + path)
+					++correct;
+				else
+					++wrong;
+			}
+
+			server.RemoveRoute(route);
+
+			std::string body;
+			int status = 0;
+
+			if (!get(port, prefix + "/gone", body, status) ||
+			    status != 404)
+				++wrong;
+		});
+	}
+
+	for (auto &thread : threads)
+		thread.join();
+
+	check(correct == routeCount * requestsPerRoute,
+	      "every request is routed to its own route");
+	check(wrong == 0, "no request is misrouted or lost");
+	check(server.GetRouteCount() == 1, "removed routes are gone");
+
+	server.RemoveRoute(anchor);
+}
+
+static void test_remove_while_in_flight()
+{
+	StreamElementsSharedHttpServer server(4);
+
+	std::atomic<bool> entered{false};
+	std::atomic<bool> release{false};
+
+	const std::string route = server.AddRoute(
+		[&](const HttpServer::request_t &, HttpServer::response_t &res) {
+			entered = true;
+
+			while (!release)
+				std::this_thread::sleep_for(
+					std::chrono::milliseconds(1));
+
+			res.set_content("slow", "text/plain");
+		});
+
+	const int port = server.GetPortNumber();
+
+	std::thread request([&]() {
+		std::string body;
+		int status = 0;
+
+		get(port, StreamElementsSharedHttpServer::GetRoutePathPrefix(route),
+		    body, status);
+	});
+
+	while (!entered)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+	// Stops the server, which waits for the request above.
+	std::thread remove([&]() { server.RemoveRoute(route); });
+
+	while (server.GetRouteCount())
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+	const std::string next = server.AddRoute(make_handler("next"));
+	const int nextPort = server.GetPortNumber();
+
+	check(!release && !next.empty() && nextPort > 0,
+	      "routes are added while a removed server drains");
+
+	std::string body;
+	int status = 0;
+
+	check(get(nextPort,
+		  StreamElementsSharedHttpServer::GetRoutePathPrefix(next),
+		  body, status) &&
+		      body == "next:/",
+	      "a route added meanwhile is served");
+
+	release = true;
+
+	remove.join();
+	request.join();
+
+	server.RemoveRoute(next);
+}
+
+static void test_thread_count()
+{
+	const size_t routeCount = 12;
+	const size_t base = count_threads();
+
+	size_t shared = 0;
+
+	{
+		StreamElementsSharedHttpServer server(8);
+		std::vector<std::string> routes;
+
+		for (size_t i = 0; i < routeCount; ++i)
+			routes.push_back(server.AddRoute(make_handler("s")));
+
+		// The listening thread creates its pool asynchronously.
+		std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+		shared = count_threads() - base;
+
+		for (auto &route : routes)
+			server.RemoveRoute(route);
+	}
+
+	size_t dedicated = 0;
+
+	{
+		std::vector<std::unique_ptr<HttpServer>> servers;
+
+		for (size_t i = 0; i < routeCount; ++i) {
+			servers.emplace_back(
+				new HttpServer(make_handler("d")));
+			servers.back()->Start();
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+		dedicated = count_threads() - base;
+	}
+
+	check(shared <= 8 + 1, "the shared server's thread count is bounded");
+	check(shared < dedicated, "sharing uses fewer threads");
+}
+
+int main()
+{
+	test_routing();
+	test_concurrent_routes();
+	test_remove_while_in_flight();
+	test_thread_count();
+
+	if (failures) {
+		std::fprintf(stderr, "%d check(s) failed\n", failures);
+		return 1;
+	}
+
+	std::puts("test_shared_http_server: all checks passed");
+	return 0;
+}
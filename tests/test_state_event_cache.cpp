@@ -0,0 +1,257 @@
+// Behavioural test for streamelements/StreamElementsStateEventCache.
+//
+// Dispatches sequences of state events, events of other groups and events
+// which are not state events, both to all clients and to single targets,
+// and checks what a client registering afterwards is replayed: the last
+// event of each group and scope, in dispatch order, with its payload and
+// generation untouched. Also checks that the entries updated least recently
+// are evicted when the cache is full, and that the entries of a removed
+// scope are evicted on request.
+
+#include "streamelements/StreamElementsStateEventCache.hpp"
+
+#include "json11/json11.hpp"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+static int failures = 0;
+
+static void check(bool cond, const char *msg)
+{
+	if (!cond) {
+		std::fprintf(stderr, "FAIL: %s\n", msg);
+		++failures;
+	}
+}
+
+/* ================================================================= */
+
+typedef StreamElementsStateEventCache::Entry Entry;
+
+static void add_state_events(StreamElementsStateEventCache &cache)
+{
+	for (auto state : {"Starting", "Started", "Stopping", "Stopped"})
+		cache.AddStateEvent(std::string("hostStreaming") + state,
+				    "hostStreamingState");
+
+	for (auto state : {"Starting", "Started", "Stopping", "Stopped"})
+		cache.AddStateEvent(std::string("hostStreamingOutput") + state,
+				    "hostStreamingOutputState", "outputId");
+
+	cache.AddStateEvent("hostActiveSceneChanged", "hostActiveSceneChanged",
+			    "videoCompositionId");
+}
+
+static std::string describe(const std::vector<Entry> &entries)
+{
+	std::string result;
+
+	for (auto &entry : entries) {
+		if (!result.empty())
+			result += ",";
+
+		result += entry.event;
+	}
+
+	return result;
+}
+
+static void test_replacement_and_order()
+{
+	StreamElementsStateEventCache cache;
+	add_state_events(cache);
+
+	uint64_t generation = 0;
+
+	check(cache.Update("system", "", "hostStreamingStarting", "null",
+			   ++generation),
+	      "state event is kept");
+	check(!cache.Update("system", "", "hostHotkeyPressed", "null",
+			    ++generation),
+	      "other events are not kept");
+	cache.Update("system", "", "hostActiveSceneChanged",
+		     R"({"sceneId":"a","videoCompositionId":"c1"})", ++generation);
+	cache.Update("system", "", "hostStreamingOutputStarting",
+		     R"({"outputId":"o1"})", ++generation);
+	cache.Update("system", "", "hostStreamingOutputStarting",
+		     R"({"outputId":"o2"})", ++generation);
+	cache.Update("system", "", "hostActiveSceneChanged",
+		     R"({"sceneId":"b","videoCompositionId":"c2"})", ++generation);
+	cache.Update("system", "", "hostStreamingStarted", "null",
+		     ++generation);
+	cache.Update("system", "", "hostStreamingOutputStarted",
+		     R"({"outputId":"o1"})", ++generation);
+
+	auto entries = cache.GetEntries("dock");
+
+	check(describe(entries) ==
+		      "hostActiveSceneChanged,hostStreamingOutputStarting,"
+		      "hostActiveSceneChanged,hostStreamingStarted,"
+		      "hostStreamingOutputStarted",
+	      "last event of each group and scope, in dispatch order");
+	check(cache.GetCount() == 5, "replaced entries are not kept");
+
+	check(entries.size() == 5 &&
+		      entries[0].json ==
+			      R"({"sceneId":"a","videoCompositionId":"c1"})" &&
+		      entries[0].generation == 3 &&
+		      entries[1].json == R"({"outputId":"o2"})" &&
+		      entries[1].generation == 5 &&
+		      entries[3].generation == 7 &&
+		      entries[4].json == R"({"outputId":"o1"})" &&
+		      entries[4].generation == 8,
+	      "payloads and generations are kept as dispatched");
+
+	// A scene change on c1 replaces the first entry, which moves last
+	cache.Update("system", "", "hostActiveSceneChanged",
+		     R"({"sceneId":"c","videoCompositionId":"c1"})", ++generation);
+
+	entries = cache.GetEntries("dock");
+
+	check(entries.size() == 5 &&
+		      entries[4].json ==
+			      R"({"sceneId":"c","videoCompositionId":"c1"})" &&
+		      entries[0].json == R"({"outputId":"o2"})",
+	      "a replaced entry is replayed in its new place");
+
+	cache.Update("system", "", "hostStreamingStopped", "null",
+		     ++generation);
+
+	entries = cache.GetEntries("dock");
+
+	check(entries.back().event == "hostStreamingStopped" &&
+		      describe(entries).find("hostStreamingStarted") ==
+			      std::string::npos,
+	      "a state replaces the other states of its group");
+
+	cache.Clear();
+
+	check(cache.GetEntries("dock").empty() && cache.GetBytes() == 0,
+	      "clear drops every entry");
+}
+
+static void test_targets()
+{
+	StreamElementsStateEventCache cache;
+	add_state_events(cache);
+
+	cache.Update("system", "", "hostStreamingStarted", "null", 1);
+	cache.Update("system", "dock1", "hostStreamingStopped", "null", 2);
+	cache.Update("system", "dock2", "hostStreamingStarting", "null", 3);
+
+	check(describe(cache.GetEntries("dock1")) ==
+		      "hostStreamingStarted,hostStreamingStopped",
+	      "targets receive events for all clients and their own");
+	check(describe(cache.GetEntries("dock2")) ==
+		      "hostStreamingStarted,hostStreamingStarting",
+	      "targets do not receive events of other targets");
+	check(describe(cache.GetEntries("dock3")) == "hostStreamingStarted",
+	      "other targets receive events for all clients only");
+}
+
+static void test_bounds()
+{
+	StreamElementsStateEventCache cache(3, 1024);
+	add_state_events(cache);
+
+	for (int i = 0; i < 5; ++i) {
+		cache.Update("system", "", "hostStreamingOutputStarted",
+			     "{\"outputId\":\"o" + std::to_string(i) + "\"}",
+			     i + 1);
+	}
+
+	auto entries = cache.GetEntries("");
+
+	check(entries.size() == 3 && entries[0].generation == 3 &&
+		      entries[2].generation == 5,
+	      "the oldest entries are evicted beyond maxEntries");
+
+	// o3 was updated last, o4 is now the oldest
+	cache.Update("system", "", "hostStreamingOutputStopped",
+		     R"({"outputId":"o3"})", 6);
+	cache.Update("system", "", "hostStreamingOutputStopped",
+		     R"({"outputId":"o5"})", 7);
+
+	entries = cache.GetEntries("");
+
+	check(entries.size() == 3 && entries[0].generation == 5 &&
+		      entries[1].generation == 6 && entries[2].generation == 7,
+	      "eviction follows the last update, not the first");
+
+	StreamElementsStateEventCache small(100, 200);
+	add_state_events(small);
+
+	const std::string payload(80, 'x');
+
+	for (int i = 0; i < 5; ++i) {
+		small.Update("system", "", "hostStreamingOutputStarted",
+			     json11::Json(json11::Json::object{
+						  {"outputId", std::to_string(i)},
+						  {"padding", payload}})
+				     .dump(),
+			     i + 1);
+	}
+
+	check(small.GetBytes() <= 200 && small.GetCount() == 1,
+	      "entries are evicted beyond maxBytes");
+
+	small.Update("system", "", "hostStreamingOutputStarted",
+		     json11::Json(json11::Json::object{
+					  {"outputId", "4"},
+					  {"padding", std::string(300, 'x')}})
+			     .dump(),
+		     6);
+
+	check(small.GetCount() == 0,
+	      "an entry larger than maxBytes is dropped, with the one it replaces");
+}
+
+static void test_remove_scope()
+{
+	StreamElementsStateEventCache cache;
+	add_state_events(cache);
+
+	cache.Update("system", "", "hostStreamingStarted", "null", 1);
+	cache.Update("system", "", "hostStreamingOutputStarted",
+		     R"({"outputId":"o1"})", 2);
+	cache.Update("system", "dock1", "hostStreamingOutputStopped",
+		     R"({"outputId":"o1"})", 3);
+	cache.Update("system", "", "hostStreamingOutputStarted",
+		     R"({"outputId":"o2"})", 4);
+	cache.Update("system", "", "hostActiveSceneChanged",
+		     R"({"sceneId":"a","videoCompositionId":"o1"})", 5);
+
+	const size_t bytes = cache.GetBytes();
+
+	check(cache.RemoveScope("outputId", "o1") == 2,
+	      "every entry of the scope is removed, for every target");
+	check(describe(cache.GetEntries("dock1")) ==
+		      "hostStreamingStarted,hostStreamingOutputStarted,"
+		      "hostActiveSceneChanged",
+	      "other scopes, unscoped entries and other scope fields are kept");
+	check(cache.GetBytes() < bytes, "removed entries free their bytes");
+	check(cache.RemoveScope("outputId", "o1") == 0,
+	      "removing a scope twice removes nothing");
+
+	check(cache.RemoveScope("videoCompositionId", "o1") == 1 &&
+		      cache.GetCount() == 2,
+	      "scopes are matched by their field");
+}
+
+int main()
+{
+	test_replacement_and_order();
+	test_targets();
+	test_bounds();
+	test_remove_scope();
+
+	if (failures) {
+		std::fprintf(stderr, "%d check(s) failed\n", failures);
+		return 1;
+	}
+
+	std::puts("test_state_event_cache: all checks passed");
+	return 0;
+}
@@ -0,0 +1,553 @@
+// Behavioural test for streamelements/StreamElementsSyntheticMediaPayload.
+//
+// The SPS/PPS and AudioSpecificConfig headers are decoded back, packets are
+// checked for Annex-B framing and keyframe cadence, and the byte schedule must
+// add up exactly. Then the payload is streamed the way an output would carry
+// it -- FLV tags paced by the video and audio frame clocks -- to a local
+// RTMP-like sink, which must measure the target bitrate within a few percent.
+
+#include "streamelements/StreamElementsSyntheticMediaPayload.hpp"
+
+#define ASIO_STANDALONE
+#include <asio.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef StreamElementsSyntheticMediaPayload Payload;
+typedef std::chrono::steady_clock clock_type;
+
+using asio::ip::tcp;
+
+static int failures = 0;
+
+static void check(bool cond, const char *msg)
+{
+	if (!cond) {
+		std::fprintf(stderr, "FAIL: %s\n", msg);
+		++failures;
+	}
+}
+
+/* ================================================================= */
+
+// Splits Annex-B data into NAL units, start codes removed.
+static std::vector<std::vector<uint8_t>>
+split_nals(const std::vector<uint8_t> &data)
+{
+	std::vector<std::vector<uint8_t>> result;
+
+	size_t i = 0;
+	while (i + 4 <= data.size()) {
+		if (!(data[i] == 0 && data[i + 1] == 0 && data[i + 2] == 0 &&
+		      data[i + 3] == 1)) {
+			++i;
+			continue;
+		}
+
+		size_t end = i + 4;
+		while (end + 4 <= data.size() &&
+		       !(data[end] == 0 && data[end + 1] == 0 &&
+			 data[end + 2] == 0 && data[end + 3] == 1))
+			++end;
+		if (end + 4 > data.size())
+			end = data.size();
+
+		result.emplace_back(data.begin() + i + 4, data.begin() + end);
+		i = end;
+	}
+
+	return result;
+}
+
+class BitReader {
+public:
+	BitReader(const std::vector<uint8_t> &nal)
+	{
+		// Drop the NAL header and emulation prevention bytes.
+		int zeros = 0;
+		for (size_t i = 1; i < nal.size(); ++i) {
+			if (zeros >= 2 && nal[i] == 3) {
+				zeros = 0;
+				continue;
+			}
+			m_bytes.push_back(nal[i]);
+			zeros = nal[i] ? 0 : zeros + 1;
+		}
+	}
+
+	uint32_t Bits(int count)
+	{
+		uint32_t value = 0;
+		for (int i = 0; i < count; ++i) {
+			const size_t byte = m_pos / 8;
+			const uint32_t bit =
+				byte < m_bytes.size()
+					? (m_bytes[byte] >> (7 - m_pos % 8)) & 1
+					: 0;
+			value = (value << 1) | bit;
+			++m_pos;
+		}
+		return value;
+	}
+
+	uint32_t UE()
+	{
+		int zeros = 0;
+		while (!Bits(1) && zeros < 32)
+			++zeros;
+		return ((1u << zeros) - 1) + Bits(zeros);
+	}
+
+private:
+	std::vector<uint8_t> m_bytes;
+	size_t m_pos = 0;
+};
+
+// Frame size coded in a baseline SPS as written by the payload.
+static bool decode_sps(const std::vector<uint8_t> &sps, uint32_t &width,
+		       uint32_t &height, uint32_t &profile)
+{
+	BitReader reader(sps);
+
+	profile = reader.Bits(8);
+	reader.Bits(8); // constraints
+	reader.Bits(8); // level
+	reader.UE(); // sps id
+	reader.UE(); // log2_max_frame_num_minus4
+	if (reader.UE() != 2) // pic_order_cnt_type
+		return false;
+	reader.UE(); // max_num_ref_frames
+	reader.Bits(1);
+
+	const uint32_t widthMbs = reader.UE() + 1;
+	const uint32_t heightMbs = reader.UE() + 1;
+
+	if (!reader.Bits(1)) // frame_mbs_only_flag
+		return false;
+	reader.Bits(1);
+
+	uint32_t cropLeft = 0, cropRight = 0, cropTop = 0, cropBottom = 0;
+
+	if (reader.Bits(1)) {
+		cropLeft = reader.UE();
+		cropRight = reader.UE();
+		cropTop = reader.UE();
+		cropBottom = reader.UE();
+	}
+
+	width = widthMbs * 16 - 2 * (cropLeft + cropRight);
+	height = heightMbs * 16 - 2 * (cropTop + cropBottom);
+
+	return true;
+}
+
+static void test_video_header()
+{
+	const uint32_t sizes[][2] = {{1280, 720}, {1920, 1080}, {1366, 768},
+				     {854, 480}};
+
+	for (auto &size : sizes) {
+		Payload::Video::Options options;
+		options.width = size[0];
+		options.height = size[1];
+
+		Payload::Video video(options);
+
+		auto nals = split_nals(video.GetHeader());
+
+		check(nals.size() == 2, "the header carries SPS and PPS");
+		if (nals.size() != 2)
+			continue;
+
+		check(nals[0][0] == 0x67 && nals[1][0] == 0x68,
+		      "SPS then PPS");
+
+		uint32_t width = 0, height = 0, profile = 0;
+		check(decode_sps(nals[0], width, height, profile),
+		      "the SPS decodes");
+		check(profile == 66, "baseline profile");
+
+		if (width != size[0] || height != size[1]) {
+			std::fprintf(stderr, "SPS codes %ux%u for %ux%u\n",
+				     width, height, size[0], size[1]);
+			check(false, "the SPS codes the frame size");
+		}
+	}
+}
+
+static void test_video_packets()
+{
+	Payload::Video::Options options;
+	options.bitsPerSecond = 6000000;
+	options.fpsNum = 30000;
+	options.fpsDen = 1001;
+	options.keyframeIntervalFrames = 60;
+
+	Payload::Video video(options);
+
+	const int64_t frames = 3000;
+	uint64_t total = 0;
+	bool framing = true;
+	bool cadence = true;
+
+	for (int64_t i = 0; i < frames; ++i) {
+		const uint8_t *data;
+		size_t size;
+		bool keyframe;
+
+		video.GetPacket(i, data, size, keyframe);
+		total += size;
+
+		cadence = cadence && keyframe == (i % 60 == 0);
+
+		framing = framing && size > 5 && data[0] == 0 && data[1] == 0 &&
+			  data[2] == 0 && data[3] == 1 &&
+			  data[4] == (keyframe ? 0x65 : 0x41);
+
+		for (size_t j = 5; j < size && framing; ++j)
+			framing = data[j] != 0;
+	}
+
+	check(framing, "packets are single Annex-B slices with no zero bytes");
+	check(cadence, "keyframes come at the configured interval");
+	check(total == Payload::GetScheduledBytes(6000000, 1001, 30000,
+						  frames),
+	      "packet sizes add up to the schedule exactly");
+
+	const double seconds = (double)frames * 1001 / 30000;
+	const double rate = (double)total * 8 / seconds;
+	check(rate > 5999000 && rate < 6001000,
+	      "the schedule carries the target bitrate");
+}
+
+static void test_audio()
+{
+	Payload::Audio::Options options;
+
+	Payload::Audio stereo(options);
+	check(stereo.GetHeader() == std::vector<uint8_t>({0x11, 0x90}),
+	      "AAC-LC 48 kHz stereo config");
+
+	options.sampleRate = 44100;
+	options.channels = 1;
+	check(Payload::Audio(options).GetHeader() ==
+		      std::vector<uint8_t>({0x12, 0x08}),
+	      "AAC-LC 44.1 kHz mono config");
+
+	options.sampleRate = 48000;
+	options.channels = 8;
+	check(Payload::Audio(options).GetHeader() ==
+		      std::vector<uint8_t>({0x11, 0xB8}),
+	      "7.1 is channel configuration 7");
+
+	uint64_t total = 0;
+	for (int64_t i = 0; i < 1000; ++i) {
+		const uint8_t *data;
+		size_t size;
+		stereo.GetPacket(i, data, size);
+		total += size;
+	}
+
+	check(total == Payload::GetScheduledBytes(128000, 1024, 48000, 1000),
+	      "audio packet sizes add up to the schedule exactly");
+}
+
+static void test_schedule_overflow()
+{
+	// 1 Gbps at 60000/1001 fps for a year of frames.
+	const int64_t frames = 60LL * 60 * 24 * 365 * 60;
+	const uint64_t bytes =
+		Payload::GetScheduledBytes(1000000000, 1001, 60000, frames);
+	const double expected = (double)frames * 1001 / 60000 * 1e9 / 8;
+
+	check(std::abs((double)bytes - expected) / expected < 1e-9,
+	      "the schedule does not overflow");
+}
+
+/* ================================================================= */
+
+// RTMP-like sink: answers the handshake, then parses FLV tags and times
+// their arrival.
+class Sink {
+public:
+	struct Tag {
+		clock_type::time_point arrival;
+		uint8_t type;
+		size_t mediaBytes;
+	};
+
+	Sink()
+		: m_acceptor(m_io,
+			     tcp::endpoint(asio::ip::make_address("127.0.0.1"),
+					   0))
+	{
+		m_thread = std::thread([this]() { Serve(); });
+	}
+
+	~Sink() { Finish(); }
+
+	// Waits for the end of the stream.
+	void Finish()
+	{
+		if (m_thread.joinable())
+			m_thread.join();
+	}
+
+	unsigned short Port() { return m_acceptor.local_endpoint().port(); }
+
+	std::vector<Tag> Tags()
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		return m_tags;
+	}
+
+	bool headersValid = false;
+
+private:
+	void Serve()
+	{
+		tcp::socket socket(m_io);
+		asio::error_code ec;
+
+		m_acceptor.accept(socket, ec);
+
+		// C0+C1 in, S0+S1+S2 out, C2 in.
+		std::vector<uint8_t> c0c1(1537), s0s1s2(1 + 2 * 1536, 0), c2(1536);
+		asio::read(socket, asio::buffer(c0c1), ec);
+		s0s1s2[0] = 3;
+		asio::write(socket, asio::buffer(s0s1s2), ec);
+		asio::read(socket, asio::buffer(c2), ec);
+
+		bool videoHeader = false, audioHeader = false;
+
+		while (!ec) {
+			uint8_t header[11];
+			asio::read(socket, asio::buffer(header), ec);
+			if (ec)
+				break;
+
+			const size_t size = (header[1] << 16) |
+					    (header[2] << 8) | header[3];
+
+			std::vector<uint8_t> data(size + 4);
+			asio::read(socket, asio::buffer(data), ec);
+			if (ec)
+				break;
+
+			const auto arrival = clock_type::now();
+
+			if (header[0] == 9 && data[1] == 0) {
+				// AVCDecoderConfigurationRecord, baseline
+				videoHeader = data[0] == 0x17 && data[5] == 1 &&
+					      data[6] == 66;
+				continue;
+			}
+
+			if (header[0] == 8 && data[1] == 0) {
+				audioHeader = data[0] == 0xAF && size == 4;
+				continue;
+			}
+
+			const size_t overhead = header[0] == 9 ? 5 : 2;
+
+			std::lock_guard<std::mutex> guard(m_mutex);
+			m_tags.push_back({arrival, header[0], size - overhead});
+		}
+
+		headersValid = videoHeader && audioHeader;
+	}
+
+	asio::io_context m_io;
+	tcp::acceptor m_acceptor;
+	std::thread m_thread;
+	std::mutex m_mutex;
+	std::vector<Tag> m_tags;
+};
+
+static void write_tag(tcp::socket &socket, uint8_t type, uint32_t timestamp,
+		      const std::vector<uint8_t> &data)
+{
+	std::vector<uint8_t> tag = {type,
+				    (uint8_t)(data.size() >> 16),
+				    (uint8_t)(data.size() >> 8),
+				    (uint8_t)data.size(),
+				    (uint8_t)(timestamp >> 16),
+				    (uint8_t)(timestamp >> 8),
+				    (uint8_t)timestamp,
+				    (uint8_t)(timestamp >> 24),
+				    0,
+				    0,
+				    0};
+	tag.insert(tag.end(), data.begin(), data.end());
+
+	const uint32_t previous = (uint32_t)(11 + data.size());
+	tag.push_back((uint8_t)(previous >> 24));
+	tag.push_back((uint8_t)(previous >> 16));
+	tag.push_back((uint8_t)(previous >> 8));
+	tag.push_back((uint8_t)previous);
+
+	asio::write(socket, asio::buffer(tag));
+}
+
+// Streams `seconds` of payload the way rtmp_output muxes encoder packets:
+// Annex-B converted to length-prefixed NAL units, each packet sent when its
+// frame is due.
+static void stream(unsigned short port, const Payload::Video &video,
+		   const Payload::Audio &audio, uint32_t fpsNum,
+		   uint32_t fpsDen, double seconds)
+{
+	asio::io_context io;
+	tcp::socket socket(io);
+	socket.connect(
+		tcp::endpoint(asio::ip::make_address("127.0.0.1"), port));
+
+	std::vector<uint8_t> handshake(1537, 0), reply(1 + 2 * 1536);
+	handshake[0] = 3;
+	asio::write(socket, asio::buffer(handshake));
+	asio::read(socket, asio::buffer(reply));
+	asio::write(socket, asio::buffer(handshake.data() + 1, 1536));
+
+	// Sequence headers
+	auto nals = split_nals(video.GetHeader());
+	const auto &sps = nals[0];
+	const auto &pps = nals[1];
+
+	std::vector<uint8_t> avc = {0x17, 0, 0, 0, 0, 1, sps[1], sps[2],
+				    sps[3], 0xFF, 0xE1,
+				    (uint8_t)(sps.size() >> 8),
+				    (uint8_t)sps.size()};
+	avc.insert(avc.end(), sps.begin(), sps.end());
+	avc.push_back(1);
+	avc.push_back((uint8_t)(pps.size() >> 8));
+	avc.push_back((uint8_t)pps.size());
+	avc.insert(avc.end(), pps.begin(), pps.end());
+	write_tag(socket, 9, 0, avc);
+
+	std::vector<uint8_t> aac = {0xAF, 0};
+	aac.insert(aac.end(), audio.GetHeader().begin(),
+		   audio.GetHeader().end());
+	write_tag(socket, 8, 0, aac);
+
+	const auto start = clock_type::now();
+	const double frameSeconds = (double)fpsDen / fpsNum;
+	const double audioSeconds =
+		(double)Payload::Audio::FRAME_SAMPLES / 48000;
+
+	int64_t videoIndex = 0, audioIndex = 0;
+
+	for (;;) {
+		const double videoDue = videoIndex * frameSeconds;
+		const double audioDue = audioIndex * audioSeconds;
+		const bool isVideo = videoDue <= audioDue;
+		const double due = isVideo ? videoDue : audioDue;
+
+		if (due >= seconds)
+			break;
+
+		std::this_thread::sleep_until(
+			start + std::chrono::duration_cast<clock_type::duration>(
+					std::chrono::duration<double>(due)));
+
+		const uint8_t *data;
+		size_t size;
+		std::vector<uint8_t> body;
+
+		if (isVideo) {
+			bool keyframe;
+			video.GetPacket(videoIndex++, data, size, keyframe);
+
+			const uint32_t length = (uint32_t)size - 4;
+			body = {(uint8_t)(keyframe ? 0x17 : 0x27),
+				1,
+				0,
+				0,
+				0,
+				(uint8_t)(length >> 24),
+				(uint8_t)(length >> 16),
+				(uint8_t)(length >> 8),
+				(uint8_t)length};
+			body.insert(body.end(), data + 4, data + size);
+		} else {
+			audio.GetPacket(audioIndex++, data, size);
+
+			body = {0xAF, 1};
+			body.insert(body.end(), data, data + size);
+		}
+
+		write_tag(socket, isVideo ? 9 : 8,
+			  (uint32_t)(due * 1000), body);
+	}
+
+	socket.shutdown(tcp::socket::shutdown_both);
+}
+
+static void test_paced_stream()
+{
+	const uint64_t videoBits = 4000000;
+	const uint64_t audioBits = 128000;
+
+	Payload::Video::Options videoOptions;
+	videoOptions.bitsPerSecond = videoBits;
+	videoOptions.fpsNum = 30;
+	videoOptions.fpsDen = 1;
+
+	Payload::Audio::Options audioOptions;
+	audioOptions.bitsPerSecond = audioBits;
+
+	Payload::Video video(videoOptions);
+	Payload::Audio audio(audioOptions);
+
+	Sink sink;
+	stream(sink.Port(), video, audio, 30, 1, 3.5);
+	sink.Finish();
+
+	const auto tags = sink.Tags();
+
+	check(sink.headersValid, "sequence headers are well formed");
+	check(!tags.empty(), "the sink receives media");
+	if (tags.empty())
+		return;
+
+	// Skip the first half second, then measure 2.5 s of arrivals.
+	const auto from = tags.front().arrival + std::chrono::milliseconds(500);
+	const auto to = from + std::chrono::milliseconds(2500);
+
+	uint64_t videoBytes = 0, audioBytes = 0;
+
+	for (auto &tag : tags) {
+		if (tag.arrival < from || tag.arrival >= to)
+			continue;
+		(tag.type == 9 ? videoBytes : audioBytes) += tag.mediaBytes;
+	}
+
+	const double videoRate = (double)videoBytes * 8 / 2.5;
+	const double audioRate = (double)audioBytes * 8 / 2.5;
+
+	check(std::abs(videoRate - (double)videoBits) / videoBits < 0.04,
+	      "the sink measures the video target within 4%");
+	check(std::abs(audioRate - (double)audioBits) / audioBits < 0.04,
+	      "the sink measures the audio target within 4%");
+}
+
+int main()
+{
+	test_video_header();
+	test_video_packets();
+	test_audio();
+	test_schedule_overflow();
+	test_paced_stream();
+
+	if (failures) {
+		std::fprintf(stderr, "%d check(s) failed\n", failures);
+		return 1;
+	}
+
+	std::puts("test_synthetic_media_payload: all checks passed");
+	return 0;
+}
@@ -0,0 +1,259 @@
+// Behavioural test for streamelements/StreamElementsVersionedList.
+//
+// Drives a model list of scene items through randomized sequences of
+// additions, removals, field changes, removed fields and reorders. A client
+// which started from a snapshot applies every delta, and must always equal a
+// fresh serialization of the model. Also checks that a client which missed a
+// delta notices and resynchronizes from a snapshot, that versions increase
+// across lists, and that keyed lists are taken like arrays.
+
+#include "streamelements/StreamElementsVersionedList.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+typedef StreamElementsVersionedList list_t;
+
+static int failures = 0;
+
+static void check(bool cond, const char *msg)
+{
+	if (!cond) {
+		std::fprintf(stderr, "FAIL: %s\n", msg);
+		++failures;
+	}
+}
+
+/* ================================================================= */
+
+struct FakeItem {
+	std::string id;
+	std::string name;
+	double x = 0, y = 0;
+	bool visible = true;
+	bool hasAuxiliaryData = false;
+	std::vector<std::string> filters;
+};
+
+// Stands in for SerializeObsSceneItems().
+static json11::Json serialize(const std::vector<FakeItem> &items)
+{
+	json11::Json::array result;
+
+	for (size_t i = 0; i < items.size(); ++i) {
+		auto &item = items[i];
+
+		json11::Json::object d{
+			{"id", item.id},
+			{"name", item.name},
+			{"order", (double)i},
+			{"visible", item.visible},
+			{"transform",
+			 json11::Json::object{{"x", item.x}, {"y", item.y}}},
+			{"filters", json11::Json::array(item.filters.begin(),
+							item.filters.end())}};
+
+		if (item.hasAuxiliaryData)
+			d["auxiliaryData"] = json11::Json::object{
+				{"tag", item.name}};
+
+		result.push_back(d);
+	}
+
+	return result;
+}
+
+static FakeItem make_item(int serial)
+{
+	FakeItem item;
+	item.id = "item " + std::to_string(serial);
+	item.name = "Source " + std::to_string(serial);
+	item.x = serial;
+	item.filters = {"Crop"};
+
+	return item;
+}
+
+static bool snapshot_equals(const json11::Json &snapshot,
+			    const std::vector<FakeItem> &items)
+{
+	return snapshot["items"] == serialize(items);
+}
+
+/* ================================================================= */
+
+static void test_basics()
+{
+	list_t list;
+
+	std::vector<FakeItem> items = {make_item(0), make_item(1),
+				       make_item(2)};
+
+	auto client = list.GetSnapshot();
+	check(client["items"].array_items().empty(),
+	      "a new list is empty");
+
+	auto delta = list.Update(serialize(items));
+	check(delta["added"].array_items().size() == 3,
+	      "the first update adds everything");
+	check(delta["baseVersion"] == client["version"],
+	      "the delta references the snapshot's version");
+	check(list.GetVersion() > (uint64_t)client["version"].number_value(),
+	      "the version increases");
+	check(list_t::Apply(client, delta) && snapshot_equals(client, items),
+	      "the delta brings the snapshot up to date");
+
+	check(list.Update(serialize(items)).is_null(),
+	      "an unchanged list has no delta");
+
+	items[1].x = 100;
+	delta = list.Update(serialize(items));
+	check(delta["changed"].array_items().size() == 1 &&
+		      delta["added"].array_items().empty() &&
+		      delta["removed"].array_items().empty() &&
+		      delta["order"].is_null(),
+	      "one changed item is one change");
+	check(delta["changed"][0]["fields"].object_items().size() == 1 &&
+		      delta["changed"][0]["fields"]["transform"].is_object(),
+	      "only the changed field is sent");
+	check(list_t::Apply(client, delta) && snapshot_equals(client, items),
+	      "a change applies");
+
+	// Moving the last item first changes the position of every item.
+	std::rotate(items.begin(), items.end() - 1, items.end());
+	delta = list.Update(serialize(items));
+	check(delta["order"].array_items().size() == 3,
+	      "a reorder carries the order");
+	check(list_t::Apply(client, delta) && snapshot_equals(client, items),
+	      "a reorder applies");
+
+	// The same list, keyed by id as the output lists are serialized.
+	auto serialized = serialize(items);
+
+	json11::Json::object keyed;
+	for (auto &item : serialized.array_items())
+		keyed[item["id"].string_value()] = item;
+
+	list_t other;
+	other.Update(json11::Json(keyed));
+	check(other.GetSnapshot()["items"].array_items().size() == 3,
+	      "keyed lists are taken like arrays");
+	check(other.GetVersion() > list.GetVersion(),
+	      "versions increase across lists");
+
+	check(list.Update(std::string("[{\"id\":\"a\"},{\"id\":\"a\"},{}]"))
+			      ["added"]
+				      .array_items()
+				      .size() == 1,
+	      "items without an id and repeated ids are left out");
+}
+
+static void test_randomized_sequences()
+{
+	bool fresh = true;
+	bool applied = true;
+	bool resynchronized = true;
+
+	for (unsigned seed = 1; seed <= 20 && fresh && applied; ++seed) {
+		std::mt19937 rng(seed);
+
+		list_t list;
+		std::vector<FakeItem> items;
+		int serial = 0;
+
+		for (int i = 0; i < 20; ++i)
+			items.push_back(make_item(serial++));
+
+		list.Update(serialize(items));
+
+		auto client = list.GetSnapshot();
+		auto laggingClient = client;
+
+		for (int step = 0; step < 300 && fresh && applied; ++step) {
+			// Several mutations may land in one update
+			const int mutations = 1 + rng() % 3;
+
+			for (int m = 0; m < mutations; ++m) {
+				const size_t i =
+					items.empty() ? 0 : rng() % items.size();
+
+				switch (items.empty() ? 0 : rng() % 8) {
+				case 0:
+					items.insert(items.begin() + i,
+						     make_item(serial++));
+					break;
+				case 1:
+					items.erase(items.begin() + i);
+					break;
+				case 2:
+					items[i].x += 1;
+					break;
+				case 3:
+					items[i].visible = !items[i].visible;
+					break;
+				case 4:
+					// A field appears or goes away
+					items[i].hasAuxiliaryData =
+						!items[i].hasAuxiliaryData;
+					break;
+				case 5:
+					items[i].filters.push_back(
+						std::to_string(step));
+					break;
+				case 6: {
+					const size_t j = rng() % items.size();
+					std::swap(items[i], items[j]);
+					break;
+				}
+				case 7:
+					items[i].name =
+						"Renamed " +
+						std::to_string(step);
+					break;
+				}
+			}
+
+			auto delta = list.Update(serialize(items));
+
+			if (delta.is_null())
+				continue;
+
+			applied = list_t::Apply(client, delta);
+			fresh = snapshot_equals(client, items) &&
+				client == list.GetSnapshot();
+
+			// A client which misses every third delta.
+			if (step % 3 == 0)
+				continue;
+
+			if (!list_t::Apply(laggingClient, delta))
+				laggingClient = list.GetSnapshot();
+
+			resynchronized = resynchronized &&
+					 snapshot_equals(laggingClient, items);
+		}
+	}
+
+	check(applied, "every delta applies to the previous version");
+	check(fresh, "applied deltas equal a fresh serialization after every "
+		     "update");
+	check(resynchronized,
+	      "a client which missed a delta notices and resynchronizes");
+}
+
+int main()
+{
+	test_basics();
+	test_randomized_sequences();
+
+	if (failures) {
+		std::fprintf(stderr, "%d check(s) failed\n", failures);
+		return 1;
+	}
+
+	std::puts("test_versioned_list: all checks passed");
+	return 0;
+}
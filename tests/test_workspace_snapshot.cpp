@@ -0,0 +1,528 @@
+// Behavioural test for streamelements/StreamElementsWorkspaceSnapshot.
+//
+// Captures snapshots of a fake workspace on one thread while another thread
+// keeps changing it. Some changes take two steps, the way a scene item moved
+// between scenes is removed from one and added to the other; like API calls
+// they are made under the API call mutex, which the snapshot holds as well.
+// Others are single step, like a source renamed from the OBS UI, and raise
+// events stamped with the next generation. Every snapshot must hold all
+// items exactly once, and replaying the events which follow it must bring it
+// to the final state. Also checks retries, state shared by the sections of
+// an attempt, section selection and field selection.
+
+#include "streamelements/StreamElementsWorkspaceSnapshot.hpp"
+#include "json11/json11.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+static int failures = 0;
+
+static void check(bool cond, const char *msg)
+{
+	if (!cond) {
+		std::fprintf(stderr, "FAIL: %s\n", msg);
+		++failures;
+	}
+}
+
+/* ================================================================= */
+
+struct json_traits {
+	typedef json11::Json value_t;
+
+	static value_t Bool(bool value) { return value; }
+	static value_t Number(double value) { return value; }
+
+	static value_t Array(const std::vector<value_t> &items)
+	{
+		return json11::Json::array(items.begin(), items.end());
+	}
+
+	static value_t Object(const std::map<std::string, value_t> &items)
+	{
+		return json11::Json::object(items.begin(), items.end());
+	}
+
+	static bool IsString(const value_t &value) { return value.is_string(); }
+
+	static std::string GetString(const value_t &value)
+	{
+		return value.string_value();
+	}
+
+	static bool IsArray(const value_t &value) { return value.is_array(); }
+	static bool IsObject(const value_t &value) { return value.is_object(); }
+
+	static value_t Get(const value_t &value, const std::string &key)
+	{
+		return value[key];
+	}
+
+	template<typename TFunc>
+	static void ForEachArrayItem(const value_t &value, TFunc &&func)
+	{
+		for (auto &item : value.array_items())
+			func(item);
+	}
+
+	template<typename TFunc>
+	static void ForEachObjectItem(const value_t &value, TFunc &&func)
+	{
+		for (auto &kv : value.object_items())
+			func(kv.first, kv.second);
+	}
+};
+
+typedef StreamElementsWorkspaceSnapshot<json_traits> snapshot_t;
+
+/* ================================================================= */
+
+struct FakeItem {
+	std::string id;
+	std::string name;
+	bool visible = true;
+};
+
+struct FakeEvent {
+	uint64_t generation;
+	std::string sceneId;
+	json11::Json items;
+};
+
+// Scenes holding items, the event stream, and the API call mutex.
+class FakeWorkspace {
+public:
+	static const int SCENE_COUNT = 4;
+	static const int ITEM_COUNT = 40;
+
+	FakeWorkspace()
+	{
+		for (int i = 0; i < SCENE_COUNT; ++i)
+			m_scenes["scene" + std::to_string(i)];
+
+		for (int i = 0; i < ITEM_COUNT; ++i) {
+			FakeItem item;
+			item.id = "item" + std::to_string(i);
+			item.name = "Item " + std::to_string(i);
+
+			m_scenes["scene" + std::to_string(i % SCENE_COUNT)]
+				.push_back(item);
+		}
+	}
+
+	std::mutex &GetApiMutex() { return m_apiMutex; }
+
+	uint64_t GetEventGeneration() const { return m_generation; }
+
+	// Two steps, like an API call: remove, then add.
+	void MoveItem(const std::string &from, const std::string &to)
+	{
+		FakeItem item;
+
+		{
+			std::lock_guard<std::mutex> guard(m_mutex);
+
+			auto &items = m_scenes[from];
+			if (items.empty())
+				return;
+
+			item = items.front();
+			items.erase(items.begin());
+		}
+
+		Dispatch(from);
+
+		std::this_thread::yield();
+
+		{
+			std::lock_guard<std::mutex> guard(m_mutex);
+
+			m_scenes[to].push_back(item);
+		}
+
+		Dispatch(to);
+	}
+
+	// One step, like a change from the OBS UI.
+	void RenameItem(const std::string &sceneId, size_t index,
+			const std::string &name)
+	{
+		{
+			std::lock_guard<std::mutex> guard(m_mutex);
+
+			auto &items = m_scenes[sceneId];
+			if (items.empty())
+				return;
+
+			auto &item = items[index % items.size()];
+			item.name = name;
+			item.visible = !item.visible;
+		}
+
+		Dispatch(sceneId);
+	}
+
+	json11::Json SerializeScenes()
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+
+		++m_sceneSerializations;
+
+		json11::Json::array result;
+
+		for (auto &kv : m_scenes) {
+			result.push_back(json11::Json::object{
+				{"id", kv.first}, {"name", "Scene " + kv.first}});
+		}
+
+		return result;
+	}
+
+	// One call per scene of `scenes`, like the scene item list API.
+	json11::Json SerializeSceneItems(const json11::Json &scenes)
+	{
+		json11::Json::object result;
+
+		for (auto &scene : scenes.array_items()) {
+			const std::string sceneId = scene["id"].string_value();
+
+			std::this_thread::yield();
+
+			result[sceneId] = SerializeItems(sceneId);
+		}
+
+		return result;
+	}
+
+	size_t GetSceneSerializations() const { return m_sceneSerializations; }
+
+	std::vector<FakeEvent> GetEvents()
+	{
+		std::lock_guard<std::mutex> guard(m_eventsMutex);
+
+		return m_events;
+	}
+
+private:
+	json11::Json SerializeItems(const std::string &sceneId)
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+
+		json11::Json::array result;
+
+		for (auto &item : m_scenes[sceneId]) {
+			result.push_back(json11::Json::object{
+				{"id", item.id},
+				{"name", item.name},
+				{"visible", item.visible}});
+		}
+
+		return result;
+	}
+
+	// Events carry the whole item list of the changed scene, like
+	// hostSceneItemListChanged.
+	void Dispatch(const std::string &sceneId)
+	{
+		auto items = SerializeItems(sceneId);
+
+		std::lock_guard<std::mutex> guard(m_eventsMutex);
+
+		m_events.push_back({++m_generation, sceneId, items});
+	}
+
+private:
+	std::mutex m_apiMutex;
+	std::mutex m_mutex;
+	std::map<std::string, std::vector<FakeItem>> m_scenes;
+	size_t m_sceneSerializations = 0;
+
+	std::mutex m_eventsMutex;
+	std::atomic<uint64_t> m_generation = {0};
+	std::vector<FakeEvent> m_events;
+};
+
+// Like SerializeWorkspaceSnapshot(): the scenes are serialized once per
+// attempt, and the scene items are listed for those scenes.
+static void add_sections(snapshot_t &snapshot, FakeWorkspace &workspace)
+{
+	auto scenes = std::make_shared<json11::Json>();
+
+	auto getScenes = [&workspace, scenes]() {
+		if (scenes->is_null())
+			*scenes = workspace.SerializeScenes();
+
+		return *scenes;
+	};
+
+	snapshot.SetAttemptCallback([scenes]() { *scenes = nullptr; });
+
+	snapshot.AddSection("scenes", getScenes);
+	snapshot.AddSection("sceneItems", [&workspace, getScenes]() {
+		return workspace.SerializeSceneItems(getScenes());
+	});
+}
+
+// Whether every item is held by exactly one scene.
+static bool holds_all_items_once(const json11::Json &sceneItems)
+{
+	std::map<std::string, int> counts;
+
+	for (auto &kv : sceneItems.object_items()) {
+		for (auto &item : kv.second.array_items())
+			++counts[item["id"].string_value()];
+	}
+
+	if (counts.size() != FakeWorkspace::ITEM_COUNT)
+		return false;
+
+	for (auto &kv : counts) {
+		if (kv.second != 1)
+			return false;
+	}
+
+	return true;
+}
+
+/* ================================================================= */
+
+static void test_concurrent_mutation()
+{
+	FakeWorkspace workspace;
+
+	snapshot_t snapshot(
+		[&workspace]() { return workspace.GetEventGeneration(); });
+	add_sections(snapshot, workspace);
+
+	std::atomic<bool> done = {false};
+
+	std::thread writer([&]() {
+		std::mt19937 rng(1234);
+
+		for (int i = 0; i < 4000; ++i) {
+			const std::string from = "scene" + std::to_string(
+				rng() % FakeWorkspace::SCENE_COUNT);
+			const std::string to = "scene" + std::to_string(
+				rng() % FakeWorkspace::SCENE_COUNT);
+
+			if (rng() % 2) {
+				std::lock_guard<std::mutex> guard(
+					workspace.GetApiMutex());
+
+				workspace.MoveItem(from, to);
+			} else {
+				workspace.RenameItem(from, rng(),
+						     "Renamed " +
+							     std::to_string(i));
+			}
+		}
+
+		done = true;
+	});
+
+	std::vector<json11::Json> snapshots;
+
+	bool allItemsOnce = true;
+	bool monotonic = true;
+	uint64_t lastGeneration = 0;
+
+	while (!done || snapshots.empty()) {
+		json11::Json result;
+
+		{
+			std::lock_guard<std::mutex> guard(
+				workspace.GetApiMutex());
+
+			result = snapshot.Capture(json11::Json());
+		}
+
+		const uint64_t generation =
+			(uint64_t)result["generation"].number_value();
+
+		allItemsOnce = allItemsOnce &&
+			       holds_all_items_once(result["sceneItems"]);
+		monotonic = monotonic && generation >= lastGeneration;
+		lastGeneration = generation;
+
+		snapshots.push_back(result);
+
+		// Lets the writer take the API call mutex
+		std::this_thread::sleep_for(std::chrono::microseconds(50));
+	}
+
+	writer.join();
+
+	check(allItemsOnce, "every snapshot holds every item exactly once");
+	check(monotonic, "snapshot generations never decrease");
+
+	const auto events = workspace.GetEvents();
+	const auto final =
+		workspace.SerializeSceneItems(workspace.SerializeScenes());
+
+	bool converges = true;
+
+	for (auto &result : snapshots) {
+		const uint64_t generation =
+			(uint64_t)result["generation"].number_value();
+
+		auto sceneItems = result["sceneItems"].object_items();
+
+		for (auto &event : events) {
+			if (event.generation > generation)
+				sceneItems[event.sceneId] = event.items;
+		}
+
+		converges = converges && json11::Json(sceneItems) == final;
+	}
+
+	check(converges,
+	      "applying the events which follow a snapshot reaches the final state");
+}
+
+static void test_retries()
+{
+	int serializations = 0;
+
+	// Changes during every attempt
+	{
+		uint64_t generation = 0;
+
+		snapshot_t snapshot(
+			[&generation]() { return ++generation; });
+		snapshot.AddSection("a", [&serializations]() {
+			++serializations;
+			return json11::Json(1);
+		});
+
+		auto result = snapshot.Capture(json11::Json(), 3);
+
+		check(!result["consistent"].bool_value(),
+		      "a snapshot is inconsistent when every attempt sees events");
+		check(serializations == 3, "gives up after maxAttempts");
+		check(result["a"] == json11::Json(1),
+		      "an inconsistent snapshot still holds the last attempt");
+	}
+
+	// Changes during the first attempt only
+	{
+		uint64_t generation = 7;
+		serializations = 0;
+
+		snapshot_t snapshot(
+			[&generation]() { return generation; });
+		snapshot.AddSection("a", [&]() {
+			if (++serializations == 1)
+				++generation;
+			return json11::Json(serializations);
+		});
+
+		auto result = snapshot.Capture(json11::Json());
+
+		check(result["consistent"].bool_value(),
+		      "a snapshot is consistent once an attempt sees no events");
+		check(serializations == 2, "retries once");
+		check(result["generation"].number_value() == 8,
+		      "generation is the one the consistent attempt saw");
+		check(result["a"] == json11::Json(2),
+		      "holds the consistent attempt");
+	}
+}
+
+static void test_shared_state()
+{
+	FakeWorkspace workspace;
+
+	uint64_t generation = 0;
+	int attempts = 0;
+
+	snapshot_t snapshot([&generation]() { return generation; });
+	add_sections(snapshot, workspace);
+
+	// An event during the first attempt
+	snapshot.AddSection("events", [&]() {
+		if (++attempts == 1)
+			++generation;
+		return json11::Json();
+	});
+
+	auto result = snapshot.Capture(json11::Json());
+
+	check(result["consistent"].bool_value() && attempts == 2,
+	      "the second attempt is consistent");
+	check(workspace.GetSceneSerializations() == 2,
+	      "sections share one serialization of the scenes per attempt");
+}
+
+static void test_selection()
+{
+	FakeWorkspace workspace;
+
+	snapshot_t snapshot(
+		[&workspace]() { return workspace.GetEventGeneration(); });
+	add_sections(snapshot, workspace);
+
+	std::string err;
+
+	auto result = snapshot.Capture(
+		json11::Json::parse(R"({ "sections": [ "scenes" ] })", err));
+
+	check(result["scenes"].is_array(), "selected section is serialized");
+	check(result["sceneItems"].is_null(),
+	      "unselected section is not serialized");
+	check(result["generation"].is_number() && result["consistent"].is_bool(),
+	      "generation and consistent are always present");
+
+	result = snapshot.Capture(json11::Json::parse(
+		R"({ "fields": { "sceneItems": [ "name" ] } })", err));
+
+	bool onlyIdAndName = !result["sceneItems"].object_items().empty();
+
+	for (auto &kv : result["sceneItems"].object_items()) {
+		for (auto &item : kv.second.array_items()) {
+			onlyIdAndName = onlyIdAndName &&
+					item.object_items().size() == 2 &&
+					item["id"].is_string() &&
+					item["name"].is_string();
+		}
+	}
+
+	check(onlyIdAndName, "field selection keeps id and selected fields");
+	check(result["scenes"] == workspace.SerializeScenes(),
+	      "field selection leaves other sections alone");
+
+	auto nested = snapshot_t::SelectFields(
+		json11::Json::parse(
+			R"({ "a": { "id": "x", "b": 1, "c": { "id": "y", "b": 2, "d": 3 } } })",
+			err),
+		{"c"});
+
+	check(nested["a"]["b"].is_null() && nested["a"]["c"]["id"] == "y" &&
+		      nested["a"]["c"]["b"].is_null() &&
+		      nested["a"]["c"]["d"].is_null(),
+	      "field selection applies to nested objects with an id");
+}
+
+int main()
+{
+	test_concurrent_mutation();
+	test_retries();
+	test_shared_state();
+	test_selection();
+
+	if (failures) {
+		std::fprintf(stderr, "%d check(s) failed\n", failures);
+		return 1;
+	}
+
+	std::puts("test_workspace_snapshot: all checks passed");
+	return 0;
+}